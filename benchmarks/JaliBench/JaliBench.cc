@@ -0,0 +1,786 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+// jali_bench - time the hot paths of Jali (topology queries, geometry
+// updates, tiling, mesh set algebra, state vector lookup and
+// multi-material access, Exodus output) on generated meshes of a
+// range of sizes in 2D and 3D and write the timings as JSON so that
+// they can be compared between releases
+//
+// Usage: jali_bench [options]
+//
+//   --cells N1,N2,...       Approximate global number of cells of the
+//                           meshes (default 1e4,1e5,1e6,1e7)
+//   --dims D1,D2            Mesh dimensions (default 2,3)
+//   --frameworks F1,F2,...  Mesh frameworks - mstk, simple, structured
+//                           (default mstk,simple)
+//   --reps N                Repetitions of each timed kernel (default 5)
+//   --heavy-reps N          Repetitions of the kernels which create
+//                           meshes or write files (default 1)
+//   --tiles N               Number of tiles for the partitioner
+//                           benchmarks (default 64)
+//   --tile-counts N1,N2,... Numbers of tiles for the tile building
+//                           benchmarks (default 16,64,256)
+//   --halo-layers H1,H2,... Tile halo depths for the tile building
+//                           benchmarks (default 0,1,2)
+//   --filter STRING         Only run benchmarks whose name contains STRING
+//   --output FILE           JSON output file, '-' for standard output
+//                           (default jali_bench.json)
+//
+// Frameworks that cannot generate meshes of a dimension (e.g. Simple
+// in 2D, or any serial framework in parallel) and benchmarks that a
+// framework does not support are recorded as skipped. Times are the
+// maximum over all ranks of each repetition; the JSON output gives
+// their minimum, mean and maximum over the repetitions and, where it
+// makes sense, the number of items (entities, lookups) processed per
+// repetition
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "mpi.h"
+
+#include "Mesh.hh"
+#include "MeshSet.hh"
+#include "MeshFactory.hh"
+#include "JaliState.h"
+#include "instrumentation.hh"
+
+#ifndef JALI_VERSION_STRING
+#define JALI_VERSION_STRING "unknown"
+#endif
+
+using namespace Jali;
+
+namespace {
+
+struct Options {
+  std::vector<double> cells = {1.0e4, 1.0e5, 1.0e6, 1.0e7};
+  std::vector<int> dims = {2, 3};
+  std::vector<std::string> frameworks = {"mstk", "simple"};
+  int reps = 5;
+  int heavy_reps = 1;
+  int ntiles = 64;
+  std::vector<int> tile_counts = {16, 64, 256};
+  std::vector<int> halo_layers = {0, 1, 2};
+  std::string filter;
+  std::string output = "jali_bench.json";
+};
+
+struct Result {
+  std::string name;
+  std::string framework;
+  int dim;
+  long long cells;
+  std::string status;  // "ok" or "skipped"
+  std::string note;
+  int reps = 0;
+  double tmin = 0.0, tmean = 0.0, tmax = 0.0;
+  long long items = 0;
+};
+
+// Context of the benchmarks on one mesh
+
+struct Context {
+  MPI_Comm comm;
+  int rank;
+  Options const *opts;
+  std::string framework;
+  int dim;
+  long long cells;
+  std::vector<Result> *results;
+  long long checksum;  // keeps the compiler from eliding the kernels
+  bool quiet;
+};
+
+std::vector<std::string> split(std::string const& s) {
+  std::vector<std::string> parts;
+  std::stringstream ss(s);
+  std::string part;
+  while (std::getline(ss, part, ','))
+    if (!part.empty()) parts.push_back(part);
+  return parts;
+}
+
+bool selected(Context const& ctx, std::string const& name) {
+  return ctx.opts->filter.empty() ||
+      name.find(ctx.opts->filter) != std::string::npos;
+}
+
+void print(Context const& ctx, Result const& r) {
+  if (ctx.rank || ctx.quiet) return;
+  std::cout << "  " << std::left << std::setw(36) << r.name << std::right;
+  if (r.status == "ok") {
+    std::cout << std::scientific << std::setprecision(3)
+              << std::setw(12) << r.tmin << std::setw(12) << r.tmean;
+    if (r.items && r.tmin > 0.0)
+      std::cout << std::setw(12) << r.items/r.tmin << " items/s";
+  } else {
+    std::cout << "  skipped (" << r.note << ")";
+  }
+  std::cout << std::endl;
+}
+
+void skip(Context& ctx, std::string const& name, std::string const& why) {
+  if (!selected(ctx, name)) return;
+  Result r;
+  r.name = name;
+  r.framework = ctx.framework;
+  r.dim = ctx.dim;
+  r.cells = ctx.cells;
+  r.status = "skipped";
+  r.note = why;
+  print(ctx, r);
+  ctx.results->push_back(r);
+}
+
+// Time 'kernel' nreps times. 'setup' is called untimed before each
+// repetition and the kernel returns a checksum. The time of a
+// repetition is the maximum over the ranks
+
+void run(Context& ctx, std::string const& name, int nreps, long long items,
+         std::function<long long()> const& kernel,
+         std::function<void()> const& setup = std::function<void()>()) {
+  if (!selected(ctx, name)) return;
+
+  std::vector<double> times;
+  for (int r = 0; r < nreps; r++) {
+    if (setup) setup();
+    MPI_Barrier(ctx.comm);
+    double t0 = MPI_Wtime();
+    ctx.checksum += kernel();
+    double t = MPI_Wtime() - t0, tmax;
+    MPI_Allreduce(&t, &tmax, 1, MPI_DOUBLE, MPI_MAX, ctx.comm);
+    times.push_back(tmax);
+  }
+
+  Result res;
+  res.name = name;
+  res.framework = ctx.framework;
+  res.dim = ctx.dim;
+  res.cells = ctx.cells;
+  res.status = "ok";
+  res.reps = nreps;
+  res.tmin = *std::min_element(times.begin(), times.end());
+  res.tmax = *std::max_element(times.begin(), times.end());
+  for (auto const& t : times) res.tmean += t/nreps;
+  res.items = items;
+  print(ctx, res);
+  ctx.results->push_back(res);
+}
+
+bool framework_id(std::string const& name, MeshFramework_t *framework) {
+  if (name == "mstk")
+    *framework = MSTK;
+  else if (name == "simple")
+    *framework = Simple;
+  else if (name == "structured")
+    *framework = Structured;
+  else
+    return false;
+  return true;
+}
+
+std::string json_escape(std::string const& s) {
+  std::string escaped;
+  for (auto const& ch : s) {
+    if (ch == '"' || ch == '\\') escaped += '\\';
+    if (ch == '\n') escaped += "\\n";
+    else escaped += ch;
+  }
+  return escaped;
+}
+
+std::shared_ptr<Mesh> make_mesh(MeshFactory& factory, int dim, int n) {
+  if (dim == 2)
+    return factory(0.0, 0.0, 1.0, 1.0, n, n);
+  else
+    return factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, n, n, n);
+}
+
+
+// Topology queries and geometry
+
+void bench_topology(Context& ctx, std::shared_ptr<Mesh> mesh) {
+  int const nreps = ctx.opts->reps;
+  long long ncells = mesh->num_cells<Entity_type::PARALLEL_OWNED>();
+  long long nnodes = mesh->num_nodes<Entity_type::PARALLEL_OWNED>();
+  Entity_ID_List list;
+
+  run(ctx, "topology.cell_get_faces", nreps, ncells, [&]() {
+      long long sum = 0;
+      for (auto const& c : mesh->cells<Entity_type::PARALLEL_OWNED>()) {
+        mesh->cell_get_faces(c, &list);
+        for (auto const& f : list) sum += f;
+      }
+      return sum;
+    });
+
+  run(ctx, "topology.cell_get_faces_view", nreps, ncells, [&]() {
+      long long sum = 0;
+      for (auto const& c : mesh->cells<Entity_type::PARALLEL_OWNED>())
+        for (auto const& f : mesh->cell_get_faces_view(c)) sum += f;
+      return sum;
+    });
+
+  run(ctx, "topology.node_get_cells", nreps, nnodes, [&]() {
+      long long sum = 0;
+      for (auto const& n : mesh->nodes<Entity_type::PARALLEL_OWNED>()) {
+        mesh->node_get_cells(n, Entity_type::ALL, &list);
+        for (auto const& c : list) sum += c;
+      }
+      return sum;
+    });
+
+  run(ctx, "topology.node_get_cells_view", nreps, nnodes, [&]() {
+      long long sum = 0;
+      for (auto const& n : mesh->nodes<Entity_type::PARALLEL_OWNED>())
+        for (auto const& c : mesh->node_get_cells_view(n)) sum += c;
+      return sum;
+    });
+
+  try {
+    run(ctx, "topology.cell_get_node_adj_cells", nreps, ncells, [&]() {
+        long long sum = 0;
+        for (auto const& c : mesh->cells<Entity_type::PARALLEL_OWNED>()) {
+          mesh->cell_get_node_adj_cells(c, Entity_type::ALL, &list);
+          for (auto const& c2 : list) sum += c2;
+        }
+        return sum;
+      });
+  } catch (Errors::Message const& e) {
+    skip(ctx, "topology.cell_get_node_adj_cells", "not supported");
+  }
+
+  run(ctx, "geometry.update_geometric_quantities", nreps, ncells, [&]() {
+      mesh->update_geometric_quantities();
+      return static_cast<long long>(mesh->cell_volume(0) > 0.0);
+    });
+}
+
+
+// Mesh creation and tiling. Tiles are built when the mesh is created,
+// so the time to build them is read from the Mesh::build_tiles timer
+// if Jali is instrumented and is otherwise the time to create a mesh
+// with tiles less the time to create one without. The tiles are built
+// with each
+// partitioner (--tiles tiles, no halo) and, with the default
+// partitioner, for each combination of --tile-counts and
+// --halo-layers
+
+void bench_tiles(Context& ctx, MeshFactory& factory, int n) {
+  int const nreps = ctx.opts->heavy_reps;
+
+  struct Tiling {
+    std::string name;
+    int ntiles, nhalo;
+    Partitioner_type partitioner;
+  };
+  std::vector<Tiling> tilings;
+  for (int p = 0; p < NUM_PARTITIONER_TYPES; p++) {
+    Partitioner_type partitioner = static_cast<Partitioner_type>(p);
+    tilings.push_back({"tiles.build_tiles." +
+            Partitioner_type_string(partitioner).substr(18),
+            ctx.opts->ntiles, 0, partitioner});
+  }
+  for (auto const& ntiles : ctx.opts->tile_counts)
+    for (auto const& nhalo : ctx.opts->halo_layers) {
+      std::stringstream name;
+      name << "tiles.build_tiles.n" << ntiles << ".halo" << nhalo;
+      tilings.push_back({name.str(), ntiles, nhalo, factory.partitioner()});
+    }
+
+  // Only create meshes if some benchmark here is selected
+
+  bool any = selected(ctx, "mesh.create");
+  for (auto const& tiling : tilings)
+    any = any || selected(ctx, tiling.name);
+  if (!any) return;
+
+  Result create;
+  {
+    Context create_ctx = ctx;
+    Options opts = *ctx.opts;
+    opts.filter.clear();
+    create_ctx.opts = &opts;
+    create_ctx.quiet = !selected(ctx, "mesh.create");
+    std::vector<Result> create_results;
+    create_ctx.results = &create_results;
+    run(create_ctx, "mesh.create", nreps, ctx.cells,
+        [&]() { return static_cast<long long>(make_mesh(factory, ctx.dim, n)->
+                                              num_cells()); });
+    ctx.checksum += create_ctx.checksum;
+    create = create_results[0];
+    if (selected(ctx, "mesh.create")) ctx.results->push_back(create);
+  }
+
+  for (auto const& tiling : tilings) {
+    if (!selected(ctx, tiling.name)) continue;
+
+    Partitioner_type partitioner0 = factory.partitioner();
+    int const nhalo0 = factory.num_ghost_layers_tile();
+    factory.num_tiles(tiling.ntiles);
+    factory.num_ghost_layers_tile(tiling.nhalo);
+    factory.partitioner(tiling.partitioner);
+
+    std::vector<Result> tiled_results;
+    Context tiled_ctx = ctx;
+    tiled_ctx.results = &tiled_results;
+    tiled_ctx.quiet = true;
+    std::vector<double> build_times;
+#ifdef Jali_HAVE_INSTRUMENTATION
+    Instrumentation::Entry& build_entry =
+        Instrumentation::entry("Mesh::build_tiles");
+    bool const instrumented = Instrumentation::enabled();
+    Instrumentation::enable(true);
+#endif
+    bool supported = true;
+    try {
+      run(tiled_ctx, tiling.name, nreps, tiling.ntiles, [&]() {
+#ifdef Jali_HAVE_INSTRUMENTATION
+          long long const ns0 = build_entry.nanoseconds;
+#endif
+          long long ntiles = make_mesh(factory, ctx.dim, n)->num_tiles();
+#ifdef Jali_HAVE_INSTRUMENTATION
+          build_times.push_back(1.0e-9*(build_entry.nanoseconds - ns0));
+#endif
+          return ntiles;
+        });
+    } catch (Errors::Message const& e) {
+      supported = false;
+    }
+#ifdef Jali_HAVE_INSTRUMENTATION
+    Instrumentation::enable(instrumented);
+#endif
+    factory.num_tiles(0);
+    factory.num_ghost_layers_tile(nhalo0);
+    factory.partitioner(partitioner0);
+    if (!supported) {
+      skip(ctx, tiling.name, "not supported");
+      continue;
+    }
+    ctx.checksum += tiled_ctx.checksum;
+
+    Result r = tiled_results[0];
+    if (!build_times.empty()) {
+      MPI_Allreduce(MPI_IN_PLACE, build_times.data(), build_times.size(),
+                    MPI_DOUBLE, MPI_MAX, ctx.comm);
+      r.tmin = *std::min_element(build_times.begin(), build_times.end());
+      r.tmax = *std::max_element(build_times.begin(), build_times.end());
+      r.tmean = 0.0;
+      for (auto const& t : build_times) r.tmean += t/build_times.size();
+      r.note = "Mesh::build_tiles timer";
+    } else {
+      r.tmin = std::max(r.tmin - create.tmin, 0.0);
+      r.tmean = std::max(r.tmean - create.tmean, 0.0);
+      r.tmax = std::max(r.tmax - create.tmin, 0.0);
+      r.note = "mesh creation time subtracted";
+    }
+    print(ctx, r);
+    ctx.results->push_back(r);
+  }
+}
+
+
+// Set algebra on cell sets - dense sets (1/2 and 1/3 of the cells)
+// and a sparse set (~1% of the cells)
+
+void bench_meshsets(Context& ctx, std::shared_ptr<Mesh> mesh) {
+  int const nreps = ctx.opts->reps;
+
+  Entity_ID_List half, third, sparse, noghosts;
+  for (auto const& c : mesh->cells<Entity_type::PARALLEL_OWNED>()) {
+    if (c % 2 == 0) half.push_back(c);
+    if (c % 3 == 0) third.push_back(c);
+    if (c % 97 == 0) sparse.push_back(c);
+  }
+  std::shared_ptr<MeshSet> set_half =
+      make_meshset("half", *mesh, Entity_kind::CELL, half, noghosts);
+  std::shared_ptr<MeshSet> set_third =
+      make_meshset("third", *mesh, Entity_kind::CELL, third, noghosts);
+  std::shared_ptr<MeshSet> set_sparse =
+      make_meshset("sparse", *mesh, Entity_kind::CELL, sparse, noghosts);
+  long long nin = half.size() + third.size() + sparse.size();
+
+  run(ctx, "meshset.merge", nreps, nin, [&]() {
+      return static_cast<long long>(merge({set_half, set_third, set_sparse},
+                                          true)->entities().size());
+    });
+  run(ctx, "meshset.intersect", nreps, nin, [&]() {
+      return static_cast<long long>(intersect({set_half, set_third,
+                                               set_sparse},
+                                              true)->entities().size());
+    });
+  run(ctx, "meshset.subtract", nreps, nin, [&]() {
+      return static_cast<long long>(subtract(set_half, {set_third, set_sparse},
+                                             true)->entities().size());
+    });
+  run(ctx, "meshset.complement", nreps, nin, [&]() {
+      return static_cast<long long>(complement({set_half, set_sparse},
+                                               true)->entities().size());
+    });
+}
+
+
+// Adding and finding state vectors by name
+
+void bench_state(Context& ctx, std::shared_ptr<Mesh> mesh) {
+  int const nreps = ctx.opts->reps;
+  int const nvectors = 100;
+  int const nlookups = 100000;
+
+  std::vector<std::string> names;
+  for (int i = 0; i < nvectors; i++)
+    names.push_back("field" + std::to_string(i));
+  std::vector<double> data(mesh->num_cells(), 1.0);
+
+  std::shared_ptr<State> state;
+  auto fill = [&]() {
+    long long sum = 0;
+    for (int i = 0; i < nvectors; i++)
+      sum += state->add(names[i], mesh, Entity_kind::CELL, Entity_type::ALL,
+                        data.data()).size();
+    return sum;
+  };
+
+  run(ctx, "state.add", nreps, nvectors, fill,
+      [&]() { state = State::create(mesh); });
+
+  state = State::create(mesh);
+  fill();
+  run(ctx, "state.find", nreps, nlookups, [&]() {
+      long long sum = 0;
+      for (int i = 0; i < nlookups; i++)
+        sum += (state->find(names[(i*7919) % nvectors], Entity_kind::CELL) -
+                state->begin());
+      return sum;
+    });
+}
+
+
+// Access to multi-material data. Material 0 fills the lower half of
+// the cells, material 1 the upper two thirds, and material 2 every
+// tenth cell, so many cells have more than one material
+
+void bench_multimaterial(Context& ctx, std::shared_ptr<Mesh> mesh) {
+  int const nreps = ctx.opts->reps;
+  int ncells = mesh->num_cells();
+
+  std::shared_ptr<State> state = State::create(mesh);
+  std::vector<int> matcells[3];
+  for (int c = 0; c < ncells; c++) {
+    if (c < ncells/2) matcells[0].push_back(c);
+    if (c >= ncells/3) matcells[1].push_back(c);
+    if (c % 10 == 0) matcells[2].push_back(c);
+  }
+  for (int m = 0; m < 3; m++)
+    state->add_material("mat" + std::to_string(m), matcells[m]);
+  long long nentries = (matcells[0].size() + matcells[1].size() +
+                        matcells[2].size());
+
+  MultiStateVector<double, Mesh>& rho =
+      state->add<double, Mesh, MultiStateVector>("density", mesh,
+                                                 Entity_kind::CELL,
+                                                 Entity_type::ALL);
+  for (int m = 0; m < 3; m++)
+    for (auto const& c : matcells[m])
+      rho(m, c) = m + 0.001*c;
+
+  run(ctx, "multimat.material_centric.by_cell_id", nreps, nentries, [&]() {
+      double sum = 0.0;
+      for (int m = 0; m < 3; m++)
+        for (auto const& c : matcells[m])
+          sum += rho(m, c);
+      return static_cast<long long>(sum);
+    });
+
+  run(ctx, "multimat.material_centric.matdata", nreps, nentries, [&]() {
+      double sum = 0.0;
+      for (int m = 0; m < 3; m++)
+        for (auto const& val : rho.get_matdata(m))
+          sum += val;
+      return static_cast<long long>(sum);
+    });
+
+  run(ctx, "multimat.to_cell_centric", nreps, nentries, [&]() {
+      rho.set_storage_layout(Data_layout::CELL_CENTRIC);
+      return static_cast<long long>(rho.get_cell_centric_data().size());
+    }, [&]() { rho.set_storage_layout(Data_layout::MATERIAL_CENTRIC); });
+
+  rho.set_storage_layout(Data_layout::CELL_CENTRIC);
+  run(ctx, "multimat.cell_centric.by_cell", nreps, nentries, [&]() {
+      MaterialMap const& map = rho.cell_centric_map();
+      std::vector<double> const& cdata = rho.get_cell_centric_data();
+      double sum = 0.0;
+      for (int c = 0; c < ncells; c++)
+        for (int k = map.offsets()[c]; k < map.offsets()[c+1]; k++)
+          sum += cdata[k];
+      return static_cast<long long>(sum);
+    });
+}
+
+
+// Export of the mesh and a few fields to an Exodus II file
+
+void bench_exodus(Context& ctx, std::shared_ptr<Mesh> mesh) {
+  if (ctx.framework != "mstk") {
+    skip(ctx, "io.write_exodus", "framework cannot write Exodus II files");
+    return;
+  }
+
+  std::shared_ptr<State> state = State::create(mesh);
+  std::vector<double> cdata(mesh->num_cells(), 1.0);
+  std::vector<double> ndata(mesh->num_nodes(), 2.0);
+  state->add("cellvar", mesh, Entity_kind::CELL, Entity_type::ALL,
+             cdata.data());
+  state->add("nodevar", mesh, Entity_kind::NODE, Entity_type::ALL,
+             ndata.data());
+
+  std::string filename = "jali_bench_tmp.exo";
+  run(ctx, "io.write_exodus", ctx.opts->heavy_reps, ctx.cells, [&]() {
+      state->export_to_mesh();
+      mesh->write_to_exodus_file(filename);
+      return 1LL;
+    });
+  std::remove(filename.c_str());
+}
+
+
+void write_json(std::ostream& os, Options const& opts, int nprocs,
+                std::vector<Result> const& results) {
+  char date[32];
+  std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+  os << "{\n";
+  os << "  \"suite\": \"jali_bench\",\n";
+  os << "  \"jali_version\": \"" << JALI_VERSION_STRING << "\",\n";
+  os << "  \"date\": \"" << date << "\",\n";
+  os << "  \"nprocs\": " << nprocs << ",\n";
+  os << "  \"reps\": " << opts.reps << ",\n";
+  os << "  \"heavy_reps\": " << opts.heavy_reps << ",\n";
+  os << "  \"tiles\": " << opts.ntiles << ",\n";
+  os << "  \"threads\": " << num_threads() << ",\n";
+  os << "  \"results\": [";
+  os << std::scientific << std::setprecision(6);
+  for (int i = 0; i < results.size(); i++) {
+    Result const& r = results[i];
+    os << (i ? ",\n" : "\n");
+    os << "    {\"name\": \"" << r.name << "\", \"framework\": \"" <<
+        r.framework << "\", \"dim\": " << r.dim << ", \"cells\": " <<
+        r.cells << ", \"status\": \"" << r.status << "\"";
+    if (r.status == "ok") {
+      os << ", \"reps\": " << r.reps << ", \"min_s\": " << r.tmin <<
+          ", \"mean_s\": " << r.tmean << ", \"max_s\": " << r.tmax;
+      if (r.items)
+        os << ", \"items\": " << r.items << ", \"items_per_s\": " <<
+            (r.tmin > 0.0 ? r.items/r.tmin : 0.0);
+    }
+    if (!r.note.empty())
+      os << ", \"note\": \"" << json_escape(r.note) << "\"";
+    os << "}";
+  }
+  os << "\n  ]\n}\n";
+}
+
+
+bool parse_options(int argc, char *argv[], Options *opts) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i+1 == argc) return false;
+    std::string val = argv[++i];
+    if (arg == "--cells") {
+      opts->cells.clear();
+      for (auto const& s : split(val)) opts->cells.push_back(std::stod(s));
+    } else if (arg == "--dims") {
+      opts->dims.clear();
+      for (auto const& s : split(val)) opts->dims.push_back(std::stoi(s));
+    } else if (arg == "--frameworks") {
+      opts->frameworks = split(val);
+    } else if (arg == "--reps") {
+      opts->reps = std::stoi(val);
+    } else if (arg == "--heavy-reps") {
+      opts->heavy_reps = std::stoi(val);
+    } else if (arg == "--tiles") {
+      opts->ntiles = std::stoi(val);
+    } else if (arg == "--tile-counts") {
+      opts->tile_counts.clear();
+      for (auto const& s : split(val))
+        opts->tile_counts.push_back(std::stoi(s));
+    } else if (arg == "--halo-layers") {
+      opts->halo_layers.clear();
+      for (auto const& s : split(val))
+        opts->halo_layers.push_back(std::stoi(s));
+    } else if (arg == "--filter") {
+      opts->filter = val;
+    } else if (arg == "--output") {
+      opts->output = val;
+    } else {
+      return false;
+    }
+  }
+  MeshFramework_t framework;
+  for (auto const& f : opts->frameworks)
+    if (!framework_id(f, &framework)) return false;
+  for (auto const& d : opts->dims)
+    if (d != 2 && d != 3) return false;
+  for (auto const& t : opts->tile_counts)
+    if (t <= 0) return false;
+  for (auto const& h : opts->halo_layers)
+    if (h < 0) return false;
+  return (opts->reps > 0 && opts->heavy_reps > 0 && opts->ntiles > 0);
+}
+
+}  // namespace
+
+
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+  MPI_Comm comm = MPI_COMM_WORLD;
+  int rank, nprocs;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nprocs);
+
+  Options opts;
+  if (!parse_options(argc, argv, &opts)) {
+    if (rank == 0)
+      std::cerr << "Usage: jali_bench [--cells N1,N2,...] [--dims 2,3] " <<
+          "[--frameworks mstk,simple,structured] [--reps N] " <<
+          "[--heavy-reps N] [--tiles N] [--tile-counts N1,N2,...] " <<
+          "[--halo-layers H1,H2,...] [--filter STRING] " <<
+          "[--output FILE|-]\n";
+    MPI_Finalize();
+    return 1;
+  }
+
+  std::vector<Result> results;
+  long long checksum = 0;
+
+  for (auto const& fwname : opts.frameworks) {
+    for (auto const& dim : opts.dims) {
+      for (auto const& ncells_target : opts.cells) {
+        int n = std::max(1, static_cast<int>(std::round(std::pow(ncells_target,
+                                                                 1.0/dim))));
+        long long ncells = (dim == 2) ? 1LL*n*n : 1LL*n*n*n;
+
+        Context ctx;
+        ctx.comm = comm;
+        ctx.rank = rank;
+        ctx.opts = &opts;
+        ctx.framework = fwname;
+        ctx.dim = dim;
+        ctx.cells = ncells;
+        ctx.results = &results;
+        ctx.checksum = 0;
+        ctx.quiet = false;
+
+        if (rank == 0)
+          std::cout << "\n" << fwname << ", " << dim << "D, " << ncells <<
+              " cells" << std::endl;
+
+        MeshFramework_t framework;
+        framework_id(fwname, &framework);
+        if (!framework_available(framework) ||
+            !framework_generates(framework, nprocs > 1, dim)) {
+          skip(ctx, "mesh.create",
+               "framework cannot generate this mesh in this configuration");
+          continue;
+        }
+
+        MeshFactory factory(comm);
+        factory.framework(framework);
+        factory.included_entities({Entity_kind::FACE});
+
+        std::shared_ptr<Mesh> mesh;
+        try {
+          mesh = make_mesh(factory, dim, n);
+        } catch (Errors::Message const& e) {
+          skip(ctx, "mesh.create", e.what());
+          continue;
+        }
+        if (!mesh) {
+          skip(ctx, "mesh.create", "mesh generation failed");
+          continue;
+        }
+
+        bench_tiles(ctx, factory, n);
+        bench_topology(ctx, mesh);
+        bench_meshsets(ctx, mesh);
+        bench_state(ctx, mesh);
+        bench_multimaterial(ctx, mesh);
+        bench_exodus(ctx, mesh);
+
+        checksum += ctx.checksum;
+      }
+    }
+  }
+
+  if (rank == 0) {
+    std::cout << "\n(checksum " << checksum << ")" << std::endl;
+    if (opts.output == "-") {
+      write_json(std::cout, opts, nprocs, results);
+    } else {
+      std::ofstream ofs(opts.output);
+      write_json(ofs, opts, nprocs, results);
+      std::cout << "Results written to " << opts.output << std::endl;
+    }
+  }
+
+  MPI_Finalize();
+}
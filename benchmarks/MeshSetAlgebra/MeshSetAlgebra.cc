@@ -0,0 +1,253 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+// Time the set operations (merge, intersect, subtract, complement) on
+// cell sets of a mesh with ~1M cells, and compare them with the
+// earlier implementation which searched the output (or the other
+// sets) with std::find for every input entity
+//
+// Usage: bench_meshset_algebra [N]
+//
+// The mesh has NxNxN cells (default N = 100). The earlier
+// implementation is O(n*m) and would take hours on sets of this
+// size, so its time is estimated by timing the searches for a sample
+// of the input entities and scaling up. The estimates ignore the
+// growth of the output list during a merge and are therefore lower
+// bounds
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+
+#include "mpi.h"
+
+#include "Mesh.hh"
+#include "MeshSet.hh"
+#include "MeshFactory.hh"
+
+using namespace Jali;
+
+// Number of input entities for which the linear searches of the
+// earlier implementation are timed
+
+int const nsample = 2000;
+
+// Estimated time of one std::find in 'haystack' for every entity of
+// 'queries'
+
+double estimate_linear_searches(std::vector<Entity_ID_List const *> queries,
+                                Entity_ID_List const& haystack,
+                                long long *checksum) {
+  std::size_t nqueries = 0;
+  for (auto const& q : queries) nqueries += q->size();
+  if (!nqueries) return 0.0;
+
+  // Sample entities evenly spread over all the queries
+
+  std::size_t stride = std::max<std::size_t>(nqueries/nsample, 1);
+  Entity_ID_List sample;
+  std::size_t i = 0;
+  for (auto const& q : queries)
+    for (auto const& ent : *q)
+      if (i++ % stride == 0) sample.push_back(ent);
+
+  double t0 = MPI_Wtime();
+  for (auto const& ent : sample)
+    *checksum += (std::find(haystack.begin(), haystack.end(), ent) -
+                  haystack.begin());
+  return (MPI_Wtime() - t0)*nqueries/sample.size();
+}
+
+double time_operation(std::function<std::shared_ptr<MeshSet>()> op,
+                      long long *checksum) {
+  double t0 = MPI_Wtime();
+  std::shared_ptr<MeshSet> result = op();
+  double t = MPI_Wtime() - t0;
+  *checksum += result->entities().size();
+  return t;
+}
+
+void report(std::string const& name, std::size_t nin,
+            double t_old, double t_new) {
+  std::cout << "  " << std::left << std::setw(26) << name << std::right
+            << std::setw(10) << nin
+            << std::scientific << std::setprecision(3)
+            << std::setw(14) << t_old << std::setw(12) << t_new
+            << std::fixed << std::setprecision(0)
+            << std::setw(12) << t_old/t_new << "x" << std::endl;
+}
+
+
+void run_benchmark(MPI_Comm comm, int n) {
+  MeshFactory factory(comm);
+  factory.framework(framework_available(MSTK) ? MSTK : Simple);
+  std::shared_ptr<Mesh> mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                       n, n, n);
+  int ncells = mesh->num_cells<Entity_type::PARALLEL_OWNED>();
+
+  // Dense sets (1/2, 1/3 and 1/8 of the cells) and sparse sets (~1%
+  // of the cells, in no particular order)
+
+  auto make_set = [&](std::string const& name,
+                      std::function<bool(int)> rule) {
+    Entity_ID_List owned, ghost;
+    for (int c = 0; c < ncells; c++)
+      if (rule(c)) owned.push_back(c);
+    return make_meshset(name, *mesh, Entity_kind::CELL, owned, ghost);
+  };
+  auto half = make_set("half", [](int c) { return c % 2 == 0; });
+  auto third = make_set("third", [](int c) { return c % 3 == 0; });
+  std::vector<std::shared_ptr<MeshSet>> eighths;
+  for (int k = 0; k < 8; k++)
+    eighths.push_back(make_set("eighth" + std::to_string(k),
+                               [k](int c) { return c % 8 == k; }));
+  auto sparse1 = make_set("sparse1", [](int c) {
+      return (c*2654435761u) % 100 == 0; });
+  auto sparse2 = make_set("sparse2", [](int c) {
+      return (c*2246822519u) % 100 == 0; });
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (rank == 0) {
+    std::cout << "\nMesh " << n << "x" << n << "x" << n << " ("
+              << ncells << " owned cells on rank 0)" << std::endl;
+    std::cout << "  " << std::left << std::setw(26) << "operation"
+              << std::right << std::setw(10) << "inputs"
+              << std::setw(14) << "old est. (s)" << std::setw(12) << "new (s)"
+              << std::setw(13) << "speedup" << std::endl;
+  }
+
+  long long checksum = 0;  // keeps the compiler from eliding the searches
+  auto owned = [](std::shared_ptr<MeshSet> const& set) {
+    return &(set->entities<Entity_type::PARALLEL_OWNED>());
+  };
+  double t_old, t_new;
+  std::size_t nin;
+
+  // Merge: every entity of the second set was looked up in the output
+
+  nin = half->entities().size() + third->entities().size();
+  t_old = estimate_linear_searches({owned(third)}, *owned(half), &checksum);
+  t_new = time_operation([&]() { return merge({half, third}, true); },
+                         &checksum);
+  if (rank == 0) report("merge (dense)", nin, t_old, t_new);
+
+  nin = sparse1->entities().size() + sparse2->entities().size();
+  t_old = estimate_linear_searches({owned(sparse2)}, *owned(sparse1),
+                                   &checksum);
+  t_new = time_operation([&]() { return merge({sparse1, sparse2}, true); },
+                         &checksum);
+  if (rank == 0) report("merge (sparse)", nin, t_old, t_new);
+
+  // n-ary merge of 8 sets
+
+  nin = 0;
+  std::vector<Entity_ID_List const *> others;
+  for (auto const& set : eighths) {
+    nin += set->entities().size();
+    if (set != eighths[0]) others.push_back(owned(set));
+  }
+  t_old = estimate_linear_searches(others, *owned(eighths[0]), &checksum);
+  t_new = time_operation([&]() { return merge(eighths, true); }, &checksum);
+  if (rank == 0) report("merge (8 sets)", nin, t_old, t_new);
+
+  // Intersect: every entity of the first set was looked up in the others
+
+  nin = half->entities().size() + third->entities().size();
+  t_old = estimate_linear_searches({owned(half)}, *owned(third), &checksum);
+  t_new = time_operation([&]() { return intersect({half, third}, true); },
+                         &checksum);
+  if (rank == 0) report("intersect (dense)", nin, t_old, t_new);
+
+  nin = sparse1->entities().size() + sparse2->entities().size();
+  t_old = estimate_linear_searches({owned(sparse1)}, *owned(sparse2),
+                                   &checksum);
+  t_new = time_operation([&]() { return intersect({sparse1, sparse2}, true); },
+                         &checksum);
+  if (rank == 0) report("intersect (sparse)", nin, t_old, t_new);
+
+  // Subtract: every entity of the first set was looked up in the union
+  // of the others
+
+  nin = half->entities().size() + third->entities().size();
+  t_old = estimate_linear_searches({owned(half)}, *owned(third), &checksum);
+  t_new = time_operation([&]() { return subtract(half, {third}, true); },
+                         &checksum);
+  if (rank == 0) report("subtract (dense)", nin, t_old, t_new);
+
+  // Complement: the sets were merged and then every entity of the mesh
+  // was looked up in the union
+
+  Entity_ID_List all(ncells);
+  for (int c = 0; c < ncells; c++) all[c] = c;
+  auto setunion = merge({half, third}, true);
+  nin = half->entities().size() + third->entities().size();
+  t_old = estimate_linear_searches({owned(third)}, *owned(half), &checksum) +
+      estimate_linear_searches({&all}, *owned(setunion), &checksum);
+  t_new = time_operation([&]() { return complement({half, third}, true); },
+                         &checksum);
+  if (rank == 0) report("complement (dense)", nin, t_old, t_new);
+
+  if (rank == 0)
+    std::cout << "  (checksum " << checksum << ")" << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+
+  int n = (argc > 1) ? std::atoi(argv[1]) : 100;  // 1M cells by default
+  run_benchmark(MPI_COMM_WORLD, n);
+
+  MPI_Finalize();
+}
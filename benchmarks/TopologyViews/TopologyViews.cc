@@ -0,0 +1,257 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+// Compare the list based topology queries (which copy into a caller
+// supplied std::vector) with the view based queries (which return a
+// pointer and length into the cached adjacency arrays)
+//
+// Usage: bench_topology_views [N [nreps]]
+//
+// Without arguments, the benchmark is run on a 2x2x2 mesh (the size
+// used in test_mesh_geometry) and on a 216x216x216 mesh (~10M
+// cells). With arguments, it is run on an NxNxN mesh nreps times
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include "mpi.h"
+
+#include "Mesh.hh"
+#include "MeshFactory.hh"
+
+using namespace Jali;
+
+// Time a kernel nreps times and return the time per repetition
+
+template<typename Kernel>
+double time_kernel(int nreps, Kernel const& kernel, long long *checksum) {
+  double t0 = MPI_Wtime();
+  for (int r = 0; r < nreps; r++)
+    *checksum += kernel();
+  return (MPI_Wtime() - t0)/nreps;
+}
+
+void report(std::string const& name, double t_list, double t_view) {
+  std::cout << "  " << std::left << std::setw(28) << name << std::right
+            << std::scientific << std::setprecision(3)
+            << std::setw(12) << t_list << std::setw(12) << t_view
+            << std::fixed << std::setprecision(2)
+            << std::setw(10) << t_list/t_view << "x" << std::endl;
+}
+
+
+void run_benchmark(MPI_Comm comm, int n, int nreps) {
+  MeshFactory factory(comm);
+  std::shared_ptr<Mesh> mesh;
+
+  bool have_corners = false;
+  if (framework_available(MSTK)) {
+    factory.framework(MSTK);
+    factory.included_entities(Entity_kind::ALL_KIND);
+    have_corners = true;
+  } else {
+    factory.framework(Simple);
+    factory.included_entities({Entity_kind::FACE});
+  }
+  mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, n, n, n);
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (rank == 0) {
+    std::cout << "\nMesh " << n << "x" << n << "x" << n << " ("
+              << mesh->num_cells() << " cells on rank 0), " << nreps
+              << " repetitions" << std::endl;
+    std::cout << "  " << std::left << std::setw(28) << "query" << std::right
+              << std::setw(12) << "list (s)" << std::setw(12) << "view (s)"
+              << std::setw(11) << "speedup" << std::endl;
+  }
+
+  long long checksum = 0;  // keeps the compiler from eliding the loops
+  Entity_ID_List list;
+  double t_list, t_view;
+
+  // Faces of all cells
+
+  t_list = time_kernel(nreps, [&]() {
+      long long sum = 0;
+      for (auto const& c : mesh->cells()) {
+        mesh->cell_get_faces(c, &list);
+        for (auto const& f : list) sum += f;
+      }
+      return sum;
+    }, &checksum);
+  t_view = time_kernel(nreps, [&]() {
+      long long sum = 0;
+      for (auto const& c : mesh->cells())
+        for (auto const& f : mesh->cell_get_faces_view(c)) sum += f;
+      return sum;
+    }, &checksum);
+  if (rank == 0) report("cell_get_faces", t_list, t_view);
+
+  // Nodes of all cells
+
+  t_list = time_kernel(nreps, [&]() {
+      long long sum = 0;
+      for (auto const& c : mesh->cells()) {
+        mesh->cell_get_nodes(c, &list);
+        for (auto const& nd : list) sum += nd;
+      }
+      return sum;
+    }, &checksum);
+  t_view = time_kernel(nreps, [&]() {
+      long long sum = 0;
+      for (auto const& c : mesh->cells())
+        for (auto const& nd : mesh->cell_get_nodes_view(c)) sum += nd;
+      return sum;
+    }, &checksum);
+  if (rank == 0) report("cell_get_nodes", t_list, t_view);
+
+  // Owned cells of all faces (typical face flux loop)
+
+  t_list = time_kernel(nreps, [&]() {
+      long long sum = 0;
+      for (auto const& f : mesh->faces()) {
+        mesh->face_get_cells(f, Entity_type::PARALLEL_OWNED, &list);
+        for (auto const& c : list) sum += c;
+      }
+      return sum;
+    }, &checksum);
+  t_view = time_kernel(nreps, [&]() {
+      long long sum = 0;
+      for (auto const& f : mesh->faces())
+        for (auto const& c :
+                 mesh->face_get_cells_view(f, Entity_type::PARALLEL_OWNED))
+          sum += c;
+      return sum;
+    }, &checksum);
+  if (rank == 0) report("face_get_cells (OWNED)", t_list, t_view);
+
+  // Owned cells of all nodes
+
+  t_list = time_kernel(nreps, [&]() {
+      long long sum = 0;
+      for (auto const& nd : mesh->nodes()) {
+        mesh->node_get_cells(nd, Entity_type::PARALLEL_OWNED, &list);
+        for (auto const& c : list) sum += c;
+      }
+      return sum;
+    }, &checksum);
+  t_view = time_kernel(nreps, [&]() {
+      long long sum = 0;
+      for (auto const& nd : mesh->nodes())
+        for (auto const& c :
+                 mesh->node_get_cells_view(nd, Entity_type::PARALLEL_OWNED))
+          sum += c;
+      return sum;
+    }, &checksum);
+  if (rank == 0) report("node_get_cells (OWNED)", t_list, t_view);
+
+  if (have_corners) {
+    // Sides of all cells
+
+    t_list = time_kernel(nreps, [&]() {
+        long long sum = 0;
+        for (auto const& c : mesh->cells()) {
+          mesh->cell_get_sides(c, &list);
+          for (auto const& s : list) sum += s;
+        }
+        return sum;
+      }, &checksum);
+    t_view = time_kernel(nreps, [&]() {
+        long long sum = 0;
+        for (auto const& c : mesh->cells())
+          for (auto const& s : mesh->cell_get_sides_view(c)) sum += s;
+        return sum;
+      }, &checksum);
+    if (rank == 0) report("cell_get_sides", t_list, t_view);
+
+    // Owned corners of all nodes
+
+    t_list = time_kernel(nreps, [&]() {
+        long long sum = 0;
+        for (auto const& nd : mesh->nodes()) {
+          mesh->node_get_corners(nd, Entity_type::PARALLEL_OWNED, &list);
+          for (auto const& cn : list) sum += cn;
+        }
+        return sum;
+      }, &checksum);
+    t_view = time_kernel(nreps, [&]() {
+        long long sum = 0;
+        for (auto const& nd : mesh->nodes())
+          for (auto const& cn :
+                   mesh->node_get_corners_view(nd,
+                                               Entity_type::PARALLEL_OWNED))
+            sum += cn;
+        return sum;
+      }, &checksum);
+    if (rank == 0) report("node_get_corners (OWNED)", t_list, t_view);
+  }
+
+  if (rank == 0)
+    std::cout << "  (checksum " << checksum << ")" << std::endl;
+}
+
+
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+
+  if (argc > 1) {
+    int n = std::atoi(argv[1]);
+    int nreps = (argc > 2) ? std::atoi(argv[2]) : 10;
+    run_benchmark(MPI_COMM_WORLD, n, nreps);
+  } else {
+    run_benchmark(MPI_COMM_WORLD, 2, 100000);  // test_mesh_geometry size
+    run_benchmark(MPI_COMM_WORLD, 216, 5);     // ~10M cells
+  }
+
+  MPI_Finalize();
+}
@@ -169,8 +169,12 @@ int main(int argc, char *argv[]) {
   double *ave_density = new double[nc];
   for (int i = 0; i < nc; ++i) ave_density[i] = 0.0;
 
-  for (auto const& t : mymesh->tiles()) {
-    for (auto const& c : t->cells()) {
+  // The tiles are processed concurrently by the on-node thread
+  // pool. Each tile updates only the cells it owns so that no two
+  // threads write the same entry
+
+  mymesh->for_each_tile([&](MeshTile const& t, int ithread) {
+    for (auto const& c : t.cells<Entity_type::PARALLEL_OWNED>()) {
 
       // Get all (owned or ghost) node connected/adjacent neighbors of a cell
 
@@ -181,7 +185,7 @@ int main(int argc, char *argv[]) {
         ave_density[c] += rhovec[cnbr];
       ave_density[c] /= nbrs.size();
     }
-  }
+  });
 
   // Add the average density data as a new state vector
 
@@ -208,8 +212,8 @@ int main(int argc, char *argv[]) {
   // Update them to be the average of the centroids of the connected
   // cells weighted by the average cell density
 
-  for (auto const& t : mymesh->tiles()) {
-    for (auto const n : t->nodes()) {
+  mymesh->for_each_tile([&](MeshTile const& t, int ithread) {
+    for (auto const n : t.nodes<Entity_type::PARALLEL_OWNED>()) {
 
       // Get the cells using (connected to) this node
 
@@ -232,7 +236,7 @@ int main(int argc, char *argv[]) {
 
       vels[n] = tmpvels;
     }
-  }
+  });
 
 
 
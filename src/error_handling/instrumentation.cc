@@ -0,0 +1,229 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "instrumentation.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <vector>
+
+namespace Instrumentation {
+
+namespace {
+
+bool enabled_from_environment() {
+  char const *value = std::getenv("JALI_INSTRUMENTATION");
+  return value && (!std::strcmp(value, "1") || !std::strcmp(value, "on") ||
+                   !std::strcmp(value, "ON"));
+}
+
+// Registry of entries - a function local static so that it can be
+// used during static initialization of other translation units
+
+struct Registry {
+  std::mutex mutex;
+  std::map<std::string, std::unique_ptr<Entry>> entries;
+};
+
+Registry& registry() {
+  static Registry reg;
+  return reg;
+}
+
+}  // namespace
+
+
+std::atomic<bool> enabled_(enabled_from_environment());
+
+void enable(bool on) {
+  enabled_ = on;
+}
+
+
+Entry& entry(std::string const& name) {
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  std::unique_ptr<Entry>& e = reg.entries[name];
+  if (!e) e.reset(new Entry);
+  return *e;
+}
+
+
+void reset() {
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for (auto& kv : reg.entries) {
+    kv.second->calls = 0;
+    kv.second->nanoseconds = 0;
+    kv.second->bytes = 0;
+  }
+}
+
+
+void report(MPI_Comm comm, std::ostream& os) {
+  int rank, nprocs;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nprocs);
+
+  // Names measured on this rank, one per line
+
+  std::string local_names;
+  {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (auto const& kv : reg.entries)
+      local_names += kv.first + "\n";
+  }
+
+  // Union of the names over all ranks, gathered on rank 0 and sent
+  // back to everyone
+
+  int nchars = local_names.size();
+  std::vector<int> counts(rank == 0 ? nprocs : 0);
+  MPI_Gather(&nchars, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+
+  std::vector<int> displs(counts.size(), 0);
+  int total = 0;
+  for (std::size_t p = 0; p < counts.size(); p++) {
+    displs[p] = total;
+    total += counts[p];
+  }
+  std::vector<char> all_names(rank == 0 ? total : 0);
+  MPI_Gatherv(const_cast<char *>(local_names.data()), nchars, MPI_CHAR,
+              all_names.data(), counts.data(), displs.data(), MPI_CHAR, 0,
+              comm);
+
+  std::string names_str;
+  if (rank == 0) {
+    std::set<std::string> names;
+    std::istringstream iss(std::string(all_names.begin(), all_names.end()));
+    std::string name;
+    while (std::getline(iss, name))
+      names.insert(name);
+    for (auto const& nm : names)
+      names_str += nm + "\n";
+  }
+  int nnames_chars = names_str.size();
+  MPI_Bcast(&nnames_chars, 1, MPI_INT, 0, comm);
+  names_str.resize(nnames_chars);
+  MPI_Bcast(&names_str[0], nnames_chars, MPI_CHAR, 0, comm);
+
+  std::vector<std::string> names;
+  {
+    std::istringstream iss(names_str);
+    std::string name;
+    while (std::getline(iss, name))
+      names.push_back(name);
+  }
+
+  // Local values in the common order (zero for names not measured
+  // here) and their reductions
+
+  int n = names.size();
+  std::vector<double> values(3*n, 0.0);
+  {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (int i = 0; i < n; i++) {
+      auto it = reg.entries.find(names[i]);
+      if (it == reg.entries.end()) continue;
+      values[3*i] = it->second->calls;
+      values[3*i+1] = 1.0e-9*it->second->nanoseconds;
+      values[3*i+2] = it->second->bytes;
+    }
+  }
+
+  std::vector<double> vmin(3*n), vmax(3*n), vsum(3*n);
+  MPI_Reduce(values.data(), vmin.data(), 3*n, MPI_DOUBLE, MPI_MIN, 0, comm);
+  MPI_Reduce(values.data(), vmax.data(), 3*n, MPI_DOUBLE, MPI_MAX, 0, comm);
+  MPI_Reduce(values.data(), vsum.data(), 3*n, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+  if (rank != 0) return;
+
+  static const char *fields[3] = {"calls", "seconds", "bytes"};
+
+  std::ostringstream oss;
+  oss << std::setprecision(9);
+  oss << "{\n";
+  oss << "  \"nprocs\": " << nprocs << ",\n";
+  oss << "  \"entries\": {";
+  for (int i = 0; i < n; i++) {
+    oss << (i ? ",\n" : "\n");
+    oss << "    \"" << names[i] << "\": {\n";
+    for (int j = 0; j < 3; j++) {
+      int k = 3*i+j;
+      oss << "      \"" << fields[j] << "\": {\"min\": " << vmin[k] <<
+          ", \"max\": " << vmax[k] << ", \"avg\": " << vsum[k]/nprocs << "}" <<
+          (j < 2 ? ",\n" : "\n");
+    }
+    oss << "    }";
+  }
+  oss << "\n  }\n}\n";
+  os << oss.str();
+}
+
+
+void write_report(MPI_Comm comm, std::string const& filename) {
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (rank == 0) {
+    std::ofstream ofs(filename);
+    report(comm, ofs);
+  } else {
+    report(comm, std::cout);  // nothing is written on other ranks
+  }
+}
+
+}  // namespace Instrumentation
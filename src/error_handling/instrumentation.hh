@@ -0,0 +1,208 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*!
+ * @file   instrumentation.hh
+ * @brief  Lightweight phase timers, call counters and byte counters
+ *
+ * Regions of code are instrumented with the macros
+ *
+ *   JALI_TIME_SCOPE("Mesh::build_tiles");        // time enclosing scope
+ *   JALI_COUNT("Mesh::face_get_cells", 1);       // count calls/events
+ *   JALI_COUNT_BYTES("Mesh::cell_face_ids", n);  // count bytes allocated
+ *
+ * Each name accumulates the number of calls, the elapsed (wall clock)
+ * time and the bytes allocated on each MPI rank. Times of nested
+ * regions are inclusive.
+ *
+ * The macros expand to nothing unless Jali is built with
+ * ENABLE_INSTRUMENTATION (which defines Jali_HAVE_INSTRUMENTATION).
+ * Even then nothing is recorded unless instrumentation is switched on
+ * at run time with Instrumentation::enable(true) or by setting the
+ * environment variable JALI_INSTRUMENTATION to 1 - when it is off, an
+ * instrumented region costs one test of a flag.
+ *
+ * Instrumentation::report reduces the measurements over the ranks of
+ * a communicator to their minimum, maximum and average and writes
+ * them as JSON.
+ */
+
+#ifndef _JALI_INSTRUMENTATION_H_
+#define _JALI_INSTRUMENTATION_H_
+
+#include <mpi.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace Instrumentation {
+
+// Accumulated measurements for one name
+
+struct Entry {
+  std::atomic<long long> calls{0};
+  std::atomic<long long> nanoseconds{0};
+  std::atomic<long long> bytes{0};
+};
+
+// Run time switch
+
+extern std::atomic<bool> enabled_;
+
+inline bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+void enable(bool on);
+
+// Entry for a name, created on first use. References stay valid for
+// the life of the program
+
+Entry& entry(std::string const& name);
+
+// Zero all the measurements
+
+void reset();
+
+// Reduce the measurements over the ranks of 'comm' and write them as
+// JSON on rank 0 of 'comm'. This is a collective call; the ranks do
+// not need to have measured the same names
+//
+// {
+//   "nprocs": 4,
+//   "entries": {
+//     "Mesh::build_tiles": {
+//       "calls": {"min": 1, "max": 1, "avg": 1},
+//       "seconds": {"min": 0.12, "max": 0.15, "avg": 0.13},
+//       "bytes": {"min": 0, "max": 0, "avg": 0}
+//     },
+//     ...
+//   }
+// }
+
+void report(MPI_Comm comm, std::ostream& os);
+
+// Same as report but write to a file (on rank 0)
+
+void write_report(MPI_Comm comm, std::string const& filename);
+
+
+// Add the time between construction and destruction to an entry and
+// count one call
+
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(Entry& e) : entry_(enabled() ? &e : nullptr) {
+    if (entry_) start_ = std::chrono::steady_clock::now();
+  }
+
+  ~ScopedTimer() {
+    if (!entry_) return;
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    entry_->nanoseconds +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    entry_->calls++;
+  }
+
+  ScopedTimer(ScopedTimer const&) = delete;
+  ScopedTimer& operator=(ScopedTimer const&) = delete;
+
+ private:
+  Entry *entry_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+inline void count(Entry& e, long long const n) {
+  if (enabled()) e.calls += n;
+}
+
+inline void count_bytes(Entry& e, long long const nbytes) {
+  if (enabled()) e.bytes += nbytes;
+}
+
+}  // namespace Instrumentation
+
+
+// Each macro looks up its entry once (thread-safe initialization of
+// a function local static) so that recording is just atomic adds
+
+#define JALI_INSTRUMENTATION_CAT_(a, b) a ## b
+#define JALI_INSTRUMENTATION_CAT(a, b) JALI_INSTRUMENTATION_CAT_(a, b)
+
+#ifdef Jali_HAVE_INSTRUMENTATION
+
+#define JALI_TIME_SCOPE(name)                                           \
+  static Instrumentation::Entry&                                        \
+  JALI_INSTRUMENTATION_CAT(jali_instr_entry_, __LINE__) =               \
+      Instrumentation::entry(name);                                     \
+  Instrumentation::ScopedTimer                                          \
+  JALI_INSTRUMENTATION_CAT(jali_instr_timer_, __LINE__)                 \
+  (JALI_INSTRUMENTATION_CAT(jali_instr_entry_, __LINE__))
+
+#define JALI_COUNT(name, n)                                             \
+  do {                                                                  \
+    static Instrumentation::Entry& jali_instr_entry_ =                  \
+        Instrumentation::entry(name);                                   \
+    Instrumentation::count(jali_instr_entry_, (n));                     \
+  } while (0)
+
+#define JALI_COUNT_BYTES(name, nbytes)                                  \
+  do {                                                                  \
+    static Instrumentation::Entry& jali_instr_entry_ =                  \
+        Instrumentation::entry(name);                                   \
+    Instrumentation::count_bytes(jali_instr_entry_, (nbytes));          \
+  } while (0)
+
+#else
+
+#define JALI_TIME_SCOPE(name)
+#define JALI_COUNT(name, n) do {} while (0)
+#define JALI_COUNT_BYTES(name, nbytes) do {} while (0)
+
+#endif
+
+#endif /* _JALI_INSTRUMENTATION_H_ */
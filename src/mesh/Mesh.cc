@@ -59,9 +59,13 @@
 #include <cmath>
 #include <vector>
 #include <cassert>
+#include <algorithm>
+#include <numeric>
+#include <limits>
 
 #include "Geometry.hh"
 #include "errors.hh"
+#include "instrumentation.hh"
 #include "LabeledSetRegion.hh"
 #include "BoxRegion.hh"
 #include "PlaneRegion.hh"
@@ -70,13 +74,54 @@
 #include "LogicalRegion.hh"
 #include "MeshTile.hh"
 #include "MeshSet.hh"
+#include "parallel_for.hh"
+#include "entity_ordering.hh"
+#include "geometric_partition.hh"
 
 namespace Jali {
 
+namespace {
+
+// Bytes held by cached arrays (see memory_report; also reported as
+// bytes allocated by the cache_* routines when instrumentation is on)
+
+template<typename T>
+long long memory_bytes(std::vector<T> const& v) {
+  return v.capacity()*sizeof(T);
+}
+
+long long memory_bytes(std::vector<bool> const& v) {
+  return (v.capacity()+7)/8;
+}
+
+template<typename T>
+long long memory_bytes(CSRArray<T> const& a) {
+  return a.memory_size();
+}
+
+// Free the memory of an array (clear() keeps the capacity)
+
+template<typename T>
+void free_memory(std::vector<T> *v) {
+  std::vector<T>().swap(*v);
+}
+
+template<typename T, typename... Rest>
+long long memory_bytes(T const& first, Rest const&... rest) {
+  return memory_bytes(first) + memory_bytes(rest...);
+}
+
+}  // namespace
+
 // Gather and cache type info for cells, faces, edges and nodes.
 // The parallel type for other entities is derived
 
 void Mesh::cache_type_info() const {
+  if (type_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (type_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_type_info");
+
   cell_type.resize(num_cells());
   for (auto const& c : cells<Entity_type::PARALLEL_OWNED>())
     cell_type[c] = Entity_type::PARALLEL_OWNED;
@@ -107,6 +152,9 @@ void Mesh::cache_type_info() const {
   for (auto const& n : nodes<Entity_type::PARALLEL_GHOST>())
     node_type[n] = Entity_type::PARALLEL_GHOST;
 
+  JALI_COUNT_BYTES("Mesh::cache_type_info",
+                   memory_bytes(cell_type, face_type, edge_type, node_type));
+
   type_info_cached = true;
 }
 
@@ -117,44 +165,227 @@ void Mesh::cache_type_info() const {
 // declaration of Mesh class for further explanation
 
 void Mesh::cache_cell2face_info() const {
+  if (cell2face_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (cell2face_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_cell2face_info");
+
   int ncells = num_cells<Entity_type::ALL>();
-  cell_face_ids.resize(ncells);
-  cell_face_dirs.resize(ncells);
+  cell_face_ids.clear();
+  cell_face_dirs.clear();
 
-  for (int c = 0; c < ncells; c++)
-    cell_get_faces_and_dirs_internal(c, &(cell_face_ids[c]),
-                                     &(cell_face_dirs[c]), false);
+  // Rows are appended in cell order; the temporary lists are reused
+  // so there is no per-cell allocation once they reach full size
 
+  Entity_ID_List cfaces;
+  std::vector<dir_t> cfdirs;
+  for (int c = 0; c < ncells; c++) {
+    cell_get_faces_and_dirs_internal(c, &cfaces, &cfdirs, false);
+    cell_face_ids.append_row(cfaces);
+    cell_face_dirs.append_row(cfdirs);
+  }
+
+  JALI_COUNT_BYTES("Mesh::cache_cell2face_info",
+                   memory_bytes(cell_face_ids, cell_face_dirs));
+
+  cache_used(Mesh_cache::CELL2FACE);
   cell2face_info_cached = true;
 }
 
 
-// Gather and cache face to cell connectivity info.
+// Gather and cache face to cell connectivity info along with the
+// position of the face in the face list of each of its cells and the
+// direction in which the cell uses it, so that the orientation of a
+// face with respect to a neighboring cell does not require a search
 //
 // Method is declared constant because it is not modifying the mesh
 // itself; rather it is modifying mutable data structures - see
 // declaration of Mesh class for further explanation
 
 void Mesh::cache_face2cell_info() const {
+  if (face2cell_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (face2cell_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_face2cell_info");
+
+  cache_cell2face_info();
+
   int nfaces = num_faces<Entity_type::ALL>();
   face_cell_ids.resize(nfaces);
+  face_cell_slots.assign(nfaces, {{-1, -1}});
+  face_cell_dirs.assign(nfaces, {{0, 0}});
 
   std::vector<Entity_ID> fcells;
 
   for (int f = 0; f < nfaces; f++) {
     face_get_cells_internal(f, Entity_type::ALL, &fcells);
 
-    face_cell_ids[f].resize(2);
-
     for (int i = 0; i < fcells.size(); ++i)
       face_cell_ids[f][i] = fcells[i];
     for (int i = fcells.size(); i < 2; i++)
       face_cell_ids[f][i] = -1;
   }
 
+  // One pass over the cell to face lists fills in the slot and
+  // direction of every (face, cell) pair
+
+  int ncells = num_cells<Entity_type::ALL>();
+  for (int c = 0; c < ncells; c++) {
+    Entity_ID_View cfaces = cell_face_ids[c];
+    Dir_View cfdirs = cell_face_dirs[c];
+    for (std::size_t j = 0; j < cfaces.size(); j++) {
+      std::array<Entity_ID, 2> const& fcellids = face_cell_ids[cfaces[j]];
+      int i = (fcellids[0] == c) ? 0 : 1;
+      assert(fcellids[i] == c);
+      face_cell_slots[cfaces[j]][i] = j;
+      face_cell_dirs[cfaces[j]][i] = cfdirs[j];
+    }
+  }
+
+  JALI_COUNT_BYTES("Mesh::cache_face2cell_info",
+                   memory_bytes(face_cell_ids, face_cell_slots,
+                                face_cell_dirs));
+
+  cache_used(Mesh_cache::FACE2CELL);
   face2cell_info_cached = true;
 }
 
+// Gather and cache cell to node connectivity info.
+//
+// Method is declared constant because it is not modifying the mesh
+// itself; rather it is modifying mutable data structures - see
+// declaration of Mesh class for further explanation
+
+void Mesh::cache_cell2node_info() const {
+  if (cell2node_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (cell2node_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_cell2node_info");
+
+  int ncells = num_cells<Entity_type::ALL>();
+  cell_node_ids.clear();
+
+  Entity_ID_List cnodes;
+  for (int c = 0; c < ncells; ++c) {
+    cell_get_nodes(c, &cnodes);
+    cell_node_ids.append_row(cnodes);
+  }
+
+  JALI_COUNT_BYTES("Mesh::cache_cell2node_info",
+                   memory_bytes(cell_node_ids));
+
+  cache_used(Mesh_cache::CELL2NODE);
+  cell2node_info_cached = true;
+}
+
+// Gather node coordinates into one contiguous array (space_dim_
+// values per node)
+
+void Mesh::cache_node_coordinates() const {
+  if (node_coords_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (node_coords_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_node_coordinates");
+
+  int nnodes = num_nodes<Entity_type::ALL>();
+  node_coords_.resize(space_dim_*nnodes);
+
+  JaliGeometry::Point p;
+  for (int n = 0; n < nnodes; ++n) {
+    node_get_coordinates(n, &p);
+    for (unsigned int d = 0; d < space_dim_; ++d)
+      node_coords_[space_dim_*n+d] = p[d];
+  }
+
+  JALI_COUNT_BYTES("Mesh::cache_node_coordinates",
+                   memory_bytes(node_coords_));
+
+  cache_used(Mesh_cache::NODE_COORDINATES);
+  node_coords_cached = true;
+}
+
+// Gather node coordinates into one array per coordinate direction
+
+void Mesh::cache_node_coordinates_soa() const {
+  if (node_coords_soa_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (node_coords_soa_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_node_coordinates_soa");
+
+  cache_node_coordinates();
+
+  int nnodes = num_nodes<Entity_type::ALL>();
+  node_coords_soa_.resize(space_dim_*nnodes);
+  for (int n = 0; n < nnodes; ++n)
+    for (unsigned int d = 0; d < space_dim_; ++d)
+      node_coords_soa_[d*nnodes+n] = node_coords_[space_dim_*n+d];
+
+  JALI_COUNT_BYTES("Mesh::cache_node_coordinates_soa",
+                   memory_bytes(node_coords_soa_));
+
+  cache_used(Mesh_cache::NODE_COORDINATES);
+  node_coords_soa_cached = true;
+}
+
+// Gather and cache node to cell connectivity info by inverting the
+// cell to node info. The cells of each node are stored in the order
+// of the cells() list, i.e. OWNED cells first, then GHOST cells and
+// then BOUNDARY_GHOST cells, so that the cells of a particular type
+// form a contiguous range (see node_get_cells_view)
+
+void Mesh::cache_node2cell_info() const {
+  if (node2cell_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (node2cell_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_node2cell_info");
+
+  cache_cell2node_info();
+
+  int nnodes = num_nodes<Entity_type::ALL>();
+
+  std::vector<int> num_cells_of_node(nnodes, 0);
+  for (auto const& c : cells())
+    for (auto const& n : cell_node_ids[c])
+      num_cells_of_node[n]++;
+
+  node_cell_ids.set_row_sizes(num_cells_of_node);
+
+  std::vector<int> inodecell(nnodes, 0);
+  for (auto const& c : cells())
+    for (auto const& n : cell_node_ids[c])
+      node_cell_ids.row_data(n)[inodecell[n]++] = c;
+
+  JALI_COUNT_BYTES("Mesh::cache_node2cell_info",
+                   memory_bytes(node_cell_ids));
+
+  cache_used(Mesh_cache::NODE2CELL);
+  node2cell_info_cached = true;
+}
+
+// Gather and cache face to node connectivity info.
+
+void Mesh::cache_face2node_info() const {
+  if (face2node_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (face2node_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_face2node_info");
+
+  int nfaces = num_faces<Entity_type::ALL>();
+  face_node_ids.clear();
+
+  Entity_ID_List fnodes;
+  for (int f = 0; f < nfaces; ++f) {
+    face_get_nodes(f, &fnodes);
+    face_node_ids.append_row(fnodes);
+  }
+
+  JALI_COUNT_BYTES("Mesh::cache_face2node_info",
+                   memory_bytes(face_node_ids));
+
+  cache_used(Mesh_cache::FACE2NODE);
+  face2node_info_cached = true;
+}
+
 // Gather and cache face to edge connectivity info.
 //
 // Method is declared constant because it is not modifying the mesh
@@ -162,14 +393,27 @@ void Mesh::cache_face2cell_info() const {
 // declaration of Mesh class for further explanation
 
 void Mesh::cache_face2edge_info() const {
+  if (face2edge_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (face2edge_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_face2edge_info");
+
   int nfaces = num_faces<Entity_type::ALL>();
-  face_edge_ids.resize(nfaces);
-  face_edge_dirs.resize(nfaces);
+  face_edge_ids.clear();
+  face_edge_dirs.clear();
+
+  Entity_ID_List fedges;
+  std::vector<dir_t> fedirs;
+  for (int f = 0; f < nfaces; ++f) {
+    face_get_edges_and_dirs_internal(f, &fedges, &fedirs, true);
+    face_edge_ids.append_row(fedges);
+    face_edge_dirs.append_row(fedirs);
+  }
 
-  for (int f = 0; f < nfaces; ++f)
-    face_get_edges_and_dirs_internal(f, &(face_edge_ids[f]),
-                                     &(face_edge_dirs[f]), true);
+  JALI_COUNT_BYTES("Mesh::cache_face2edge_info",
+                   memory_bytes(face_edge_ids, face_edge_dirs));
 
+  cache_used(Mesh_cache::FACE2EDGE);
   face2edge_info_cached = true;
 }
 
@@ -180,22 +424,42 @@ void Mesh::cache_face2edge_info() const {
 // declaration of Mesh class for further explanation
 
 void Mesh::cache_cell2edge_info() const {
+  if (cell2edge_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (cell2edge_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_cell2edge_info");
+
   int ncells = num_cells<Entity_type::ALL>();
-  cell_edge_ids.resize(ncells);
+  cell_edge_ids.clear();
+  cell_2D_edge_dirs.clear();
+
+  // Rows have to be appended in cell ID order so loop over the
+  // index space rather than the cells() list
 
+  Entity_ID_List cedges;
+  std::vector<dir_t> cedirs;
   if (space_dim_ == 1) {
-    for (auto const& c : cells())
-      cell_get_nodes(c, &(cell_edge_ids[c]));   // edges are same as nodes
+    for (int c = 0; c < ncells; ++c) {
+      cell_get_nodes(c, &cedges);   // edges are same as nodes
+      cell_edge_ids.append_row(cedges);
+    }
   } else if (space_dim_ == 2) {
-    cell_2D_edge_dirs.resize(ncells);
-    for (auto const& c : cells())
-      cell_2D_get_edges_and_dirs_internal(c, &(cell_edge_ids[c]),
-                                          &(cell_2D_edge_dirs[c]));
+    for (int c = 0; c < ncells; ++c) {
+      cell_2D_get_edges_and_dirs_internal(c, &cedges, &cedirs);
+      cell_edge_ids.append_row(cedges);
+      cell_2D_edge_dirs.append_row(cedirs);
+    }
   } else if (space_dim_ == 3) {
-    for (auto const& c : cells())
-      cell_get_edges_internal(c, &(cell_edge_ids[c]));
+    for (int c = 0; c < ncells; ++c) {
+      cell_get_edges_internal(c, &cedges);
+      cell_edge_ids.append_row(cedges);
+    }
   }
 
+  JALI_COUNT_BYTES("Mesh::cache_cell2edge_info",
+                   memory_bytes(cell_edge_ids, cell_2D_edge_dirs));
+
+  cache_used(Mesh_cache::CELL2EDGE);
   cell2edge_info_cached = true;
 }
 
@@ -207,6 +471,11 @@ void Mesh::cache_cell2edge_info() const {
 // declaration of Mesh class for further explanation
 
 void Mesh::cache_edge2node_info() const {
+  if (edge2node_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (edge2node_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_edge2node_info");
+
   int nedges = num_edges<Entity_type::ALL>();
   edge_node_ids.resize(nedges);
 
@@ -221,19 +490,27 @@ void Mesh::cache_edge2node_info() const {
                               &(edge_node_ids[e][1]));
   }
 
+  JALI_COUNT_BYTES("Mesh::cache_edge2node_info",
+                   memory_bytes(edge_node_ids));
+
+  cache_used(Mesh_cache::EDGE2NODE);
   edge2node_info_cached = true;
 }
 
 // Gather and cache side information
 
 void Mesh::cache_side_info() const {
+  if (side_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (side_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_side_info");
+
   int ncells_owned = num_cells<Entity_type::PARALLEL_OWNED>();
   int ncells_ghost = num_cells<Entity_type::PARALLEL_GHOST>();
   int ncells_bndry_ghost = num_cells<Entity_type::BOUNDARY_GHOST>();
   int ncells = ncells_owned + ncells_ghost + ncells_bndry_ghost;
 
-  cell_side_ids.resize(ncells);
-
+  std::vector<int> num_sides_in_cell(ncells, 0);
 
   int num_sides_all = 0;
   int num_sides_owned = 0;
@@ -247,7 +524,7 @@ void Mesh::cache_side_info() const {
     num_sides_bndry_ghost = 2*ncells_bndry_ghost;
 
     for (auto const & c : cells())
-      cell_side_ids[c].reserve(2);
+      num_sides_in_cell[c] = 2;
   } else {
     for (auto const & c : cells()) {
       std::vector<Entity_ID> cfaces;
@@ -271,10 +548,15 @@ void Mesh::cache_side_info() const {
           num_sides_bndry_ghost += nfedges;
       }
 
-      cell_side_ids[c].reserve(numsides_in_cell);
+      num_sides_in_cell[c] = numsides_in_cell;
     }
   }
 
+  // Size the rows of the cell to side map upfront; they are filled
+  // in below as the sides of each cell are created
+
+  cell_side_ids.set_row_sizes(num_sides_in_cell);
+
   sideids_owned_.resize(num_sides_owned);
   sideids_ghost_.resize(num_sides_ghost);
   sideids_boundary_ghost_.resize(num_sides_bndry_ghost);
@@ -296,8 +578,9 @@ void Mesh::cache_side_info() const {
       Entity_ID_List nodeids;
       cell_get_nodes(c, &nodeids);
       
-      cell_side_ids[c].push_back(sideid);
-      cell_side_ids[c].push_back(sideid+1);
+      Entity_ID *csides = cell_side_ids.row_data(c);
+      csides[0] = sideid;
+      csides[1] = sideid+1;
       sideids_all_[iall++] = sideid;
       sideids_all_[iall++] = sideid+1;
       if (cell_type[c] == Entity_type::PARALLEL_OWNED) {
@@ -341,7 +624,10 @@ void Mesh::cache_side_info() const {
       std::vector<Entity_ID> cfaces;
       std::vector<dir_t> cfdirs;
       cell_get_faces_and_dirs(c, &cfaces, &cfdirs);
-      
+
+      Entity_ID *csides = cell_side_ids.row_data(c);
+      int icside = 0;
+
       Entity_ID_List::iterator itf = cfaces.begin();
       std::vector<dir_t>::iterator itfd = cfdirs.begin();
       while (itf != cfaces.end()) {
@@ -386,7 +672,7 @@ void Mesh::cache_side_info() const {
           side_edge_id[sideid] = e;
           side_face_id[sideid] = f;
           side_cell_id[sideid] = c;
-          cell_side_ids[c].push_back(sideid);
+          csides[icside++] = sideid;
           
           sideids_all_[iall++] = sideid;
           if (cell_type[c] == Entity_type::PARALLEL_OWNED)
@@ -422,6 +708,12 @@ void Mesh::cache_side_info() const {
     }  // for (c : cells())
   }  // if (manifold_dim_)
 
+  JALI_COUNT_BYTES("Mesh::cache_side_info",
+                   memory_bytes(side_cell_id, side_face_id, side_edge_id,
+                                side_node_ids, side_opp_side_id,
+                                cell_side_ids));
+
+  cache_used(Mesh_cache::SIDE);
   side_info_cached = true;
 }  // cache_side_info
 
@@ -429,6 +721,12 @@ void Mesh::cache_side_info() const {
 // Gather and cache wedge information
 
 void Mesh::cache_wedge_info() const {
+  if (wedge_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (wedge_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_wedge_info");
+
+  cache_side_info();  // wedges are numbered by their sides
 
   int nsides_owned = num_sides<Entity_type::PARALLEL_OWNED>();
   int nsides_ghost = num_sides<Entity_type::PARALLEL_GHOST>();
@@ -470,11 +768,22 @@ void Mesh::cache_wedge_info() const {
   wedgeids_all_.insert(wedgeids_all_.end(), wedgeids_boundary_ghost_.begin(),
               wedgeids_boundary_ghost_.end());
 
+  JALI_COUNT_BYTES("Mesh::cache_wedge_info",
+                   memory_bytes(wedge_corner_id, wedgeids_all_));
+
+  cache_used(Mesh_cache::WEDGE);
   wedge_info_cached = true;
 }  // cache_wedge_info
 
 
 void Mesh::cache_corner_info() const {
+  if (corner_info_cached) return;
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (corner_info_cached) return;  // built by another thread meanwhile
+  JALI_TIME_SCOPE("Mesh::cache_corner_info");
+
+  cache_wedge_info();  // corners fill in wedge_corner_id
+
   int ncells_owned = num_cells<Entity_type::PARALLEL_OWNED>();
   int ncells_ghost = num_cells<Entity_type::PARALLEL_GHOST>();
   int ncells_boundary_ghost = num_cells<Entity_type::BOUNDARY_GHOST>();
@@ -484,8 +793,8 @@ void Mesh::cache_corner_info() const {
   int nnodes_ghost = num_nodes<Entity_type::PARALLEL_GHOST>();
   int nnodes = nnodes_owned + nnodes_ghost;
 
-  cell_corner_ids.resize(ncells);
-  node_corner_ids.resize(nnodes);
+  std::vector<int> num_corners_in_cell(ncells, 0);
+  std::vector<int> num_corners_of_node(nnodes, 0);
 
   int num_corners_all = 0;
   int num_corners_owned = 0;
@@ -495,7 +804,9 @@ void Mesh::cache_corner_info() const {
   for (auto const& c : cells()) {
     std::vector<Entity_ID> cnodes;
     cell_get_nodes(c, &cnodes);
-    cell_corner_ids[c].reserve(cnodes.size());
+    num_corners_in_cell[c] = cnodes.size();
+    for (auto const& n : cnodes)
+      num_corners_of_node[n]++;
 
     num_corners_all += cnodes.size();  // as many corners as nodes in cell
     if (cell_type[c] == Entity_type::PARALLEL_OWNED)
@@ -509,20 +820,33 @@ void Mesh::cache_corner_info() const {
   cornerids_owned_.resize(num_corners_owned);
   cornerids_ghost_.resize(num_corners_ghost);
   cornerids_boundary_ghost_.resize(num_corners_boundary_ghost);
-  corner_wedge_ids.resize(num_corners_all);
+
+  // The cell and node rows are sized upfront and filled in as corners
+  // are created. Corner IDs are assigned sequentially, so the corner
+  // to wedge rows can simply be appended in order. Since cells() lists
+  // OWNED cells before GHOST and BOUNDARY_GHOST cells, the corners of
+  // each node end up sorted by type (see node_get_corners_view)
+
+  cell_corner_ids.set_row_sizes(num_corners_in_cell);
+  node_corner_ids.set_row_sizes(num_corners_of_node);
+  std::vector<int> inodecorner(nnodes, 0);
+
+  corner_wedge_ids.clear();
+  corner_wedge_ids.reserve(num_corners_all, num_wedges<Entity_type::ALL>());
 
   int cornerid = 0;
   int iown = 0, ighost = 0, ibndry = 0;
+  std::vector<Entity_ID> cnodes, cwedges, cnwedges;
   for (auto const& c : cells()) {
-    std::vector<Entity_ID> cnodes;
     cell_get_nodes(c, &cnodes);
-
-    std::vector<Entity_ID> cwedges;
     cell_get_wedges(c, &cwedges);
 
+    Entity_ID *ccorners = cell_corner_ids.row_data(c);
+    int iccorner = 0;
+
     for (auto const& n : cnodes) {
-      cell_corner_ids[c].push_back(cornerid);
-      node_corner_ids[n].push_back(cornerid);
+      ccorners[iccorner++] = cornerid;
+      node_corner_ids.row_data(n)[inodecorner[n]++] = cornerid;
 
       if (cell_type[c] == Entity_type::PARALLEL_OWNED)
         cornerids_owned_[iown++] = cornerid;
@@ -531,13 +855,15 @@ void Mesh::cache_corner_info() const {
       else if (cell_type[c] == Entity_type::BOUNDARY_GHOST)
         cornerids_boundary_ghost_[ibndry++] = cornerid;
 
+      cnwedges.clear();
       for (auto const& w : cwedges) {
         Entity_ID n2 = wedge_get_node(w);
         if (n == n2) {
-          corner_wedge_ids[cornerid].push_back(w);
+          cnwedges.push_back(w);
           wedge_corner_id[w] = cornerid;
         }
       }  // for (w : cwedges)
+      corner_wedge_ids.append_row(cnwedges);
 
       ++cornerid;
     }  // for (n : cnodes)
@@ -550,10 +876,57 @@ void Mesh::cache_corner_info() const {
   cornerids_all_.insert(cornerids_all_.end(), cornerids_boundary_ghost_.begin(),
                         cornerids_boundary_ghost_.end());
 
+  JALI_COUNT_BYTES("Mesh::cache_corner_info",
+                   memory_bytes(cell_corner_ids, node_corner_ids,
+                                corner_wedge_ids, cornerids_all_));
+
+  cache_used(Mesh_cache::CORNER);
   corner_info_cached = true;
 }  // cache_corner_info
 
+// Contiguous node coordinates
+
+Coordinate_View Mesh::node_coordinates() const {
+  cache_node_coordinates();
+  cache_accessed(Mesh_cache::NODE_COORDINATES);
+  return Coordinate_View(node_coords_);
+}
+
+Coordinate_View Mesh::node_coordinates(int const dir) const {
+  assert(dir >= 0 && dir < static_cast<int>(space_dim_));
+  cache_node_coordinates_soa();
+  cache_accessed(Mesh_cache::NODE_COORDINATES);
+  int nnodes = num_nodes<Entity_type::ALL>();
+  return Coordinate_View(node_coords_soa_.data() + dir*nnodes, nnodes);
+}
+
+// Called by the frameworks when the coordinates of a node change
+
+void Mesh::node_coordinates_changed(const Entity_ID nodeid,
+                                    const double *ncoord) {
+  if (node_coords_cached)
+    for (unsigned int d = 0; d < space_dim_; ++d)
+      node_coords_[space_dim_*nodeid+d] = ncoord[d];
+  if (node_coords_soa_cached) {
+    int nnodes = num_nodes<Entity_type::ALL>();
+    for (unsigned int d = 0; d < space_dim_; ++d)
+      node_coords_soa_[d*nnodes+nodeid] = ncoord[d];
+  }
+}
+
 void Mesh::update_geometric_quantities() {
+  JALI_TIME_SCOPE("Mesh::update_geometric_quantities");
+
+  {
+    std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+    spatial_index_.reset();  // built with the old coordinates
+  }
+
+  // Adjacencies are read by all the threads computing the geometry,
+  // so rebuild any that were released before starting them
+
+  cache_topology();
+
   if (faces_requested) compute_face_geometric_quantities();
   if (edges_requested) compute_edge_geometric_quantities();
   compute_cell_geometric_quantities();
@@ -563,39 +936,1079 @@ void Mesh::update_geometric_quantities() {
 
 
 void Mesh::cache_extra_variables() {
+  JALI_TIME_SCOPE("Mesh::cache_extra_variables");
+
+  cache_topology();
+  update_geometric_quantities();
+}
+
+
+void Mesh::cache_topology() const {
   // Should be before side, wedge and corner info is processed
   cache_type_info();
-    
+
+  // Frameworks with implicit topology answer the queries of the
+  // geometry computations themselves
+
+  if (!implicit_topology_) {
+    cache_cell2node_info();
+    cache_node2cell_info();
+    cache_node_coordinates();  // used by all the geometry computations
+
+    if (faces_requested) {
+      cache_cell2face_info();
+      cache_face2cell_info();
+      cache_face2node_info();
+    }
+
+    if (edges_requested) {
+      cache_face2edge_info();
+      cache_cell2edge_info();
+      cache_edge2node_info();
+    }
+  }
+
+  if (sides_requested)
+    cache_side_info();
+  if (wedges_requested) {  // keep this order
+    cache_side_info();
+    cache_wedge_info();
+  }
+  if (corners_requested) {  // Keep this order
+    cache_side_info();
+    cache_wedge_info();
+    cache_corner_info();
+  }
+}
+
+
+namespace {
+
+// Caches that are built by Mesh::prepare for each kind of entity
+
+std::vector<Mesh_cache> const& prepared_caches(Entity_kind const kind) {
+  static const std::vector<Mesh_cache> cell_caches =
+      {Mesh_cache::CELL2NODE, Mesh_cache::NODE2CELL};
+  static const std::vector<Mesh_cache> face_caches =
+      {Mesh_cache::CELL2FACE, Mesh_cache::FACE2CELL, Mesh_cache::FACE2NODE};
+  static const std::vector<Mesh_cache> edge_caches =
+      {Mesh_cache::FACE2EDGE, Mesh_cache::CELL2EDGE, Mesh_cache::EDGE2NODE};
+  static const std::vector<Mesh_cache> side_caches =
+      {Mesh_cache::SIDE, Mesh_cache::SIDE_GEOMETRY};
+  static const std::vector<Mesh_cache> wedge_caches =
+      {Mesh_cache::SIDE, Mesh_cache::WEDGE, Mesh_cache::SIDE_GEOMETRY};
+  static const std::vector<Mesh_cache> corner_caches =
+      {Mesh_cache::SIDE, Mesh_cache::WEDGE, Mesh_cache::CORNER,
+       Mesh_cache::SIDE_GEOMETRY, Mesh_cache::CORNER_GEOMETRY};
+  static const std::vector<Mesh_cache> no_caches;
+
+  switch (kind) {
+    case Entity_kind::NODE:
+    case Entity_kind::CELL: return cell_caches;
+    case Entity_kind::FACE: return face_caches;
+    case Entity_kind::EDGE: return edge_caches;
+    case Entity_kind::SIDE: return side_caches;
+    case Entity_kind::WEDGE: return wedge_caches;
+    case Entity_kind::CORNER: return corner_caches;
+    default: return no_caches;
+  }
+}
+
+}  // namespace
+
+
+// Build the caches needed to query entities of the given kinds. The
+// cache_* routines each build their data once under cache_mutex_;
+// the lock here additionally keeps the requested flags and the
+// geometry of newly enabled kinds consistent between threads
+
+void Mesh::prepare(std::vector<Entity_kind> const& kinds) const {
+  // Record the use of the caches for the memory budget (nothing is
+  // evicted here, see trim_caches)
+
+  for (auto const& kind : kinds)
+    for (auto const& cache : prepared_caches(kind))
+      cache_used(cache);
+
+  // Lock-free check for the common case that everything is built
+
+  auto is_prepared = [&](Entity_kind const kind) {
+    switch (kind) {
+      case Entity_kind::NODE:
+      case Entity_kind::CELL:
+        return (type_info_cached && cell2node_info_cached &&
+                node2cell_info_cached);
+      case Entity_kind::FACE:
+        return (cell2face_info_cached && face2cell_info_cached &&
+                face2node_info_cached);
+      case Entity_kind::EDGE:
+        return (face2edge_info_cached && cell2edge_info_cached &&
+                edge2node_info_cached);
+      case Entity_kind::SIDE:
+        return (side_info_cached && side_geometry_precomputed);
+      case Entity_kind::WEDGE:
+        return (side_info_cached && wedge_info_cached &&
+                side_geometry_precomputed);
+      case Entity_kind::CORNER:
+        return (side_info_cached && wedge_info_cached &&
+                corner_info_cached && side_geometry_precomputed &&
+                corner_geometry_precomputed);
+      default:
+        return true;
+    }
+  };
+  if (!std::all_of(kinds.begin(), kinds.end(), is_prepared))
+    prepare_caches(kinds);
+}
+
+
+void Mesh::prepare_caches(std::vector<Entity_kind> const& kinds) const {
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+
+  for (auto const& kind : kinds) {
+    switch (kind) {
+      case Entity_kind::NODE:
+      case Entity_kind::CELL:
+        cache_type_info();
+        cache_cell2node_info();
+        cache_node2cell_info();
+        break;
+      case Entity_kind::FACE:
+        if (!faces_requested) {
+          Errors::Message mesg("Faces must be requested when the mesh is created");
+          Exceptions::Jali_throw(mesg);
+        }
+        cache_cell2face_info();
+        cache_face2cell_info();
+        cache_face2node_info();
+        break;
+      case Entity_kind::EDGE:
+        if (!edges_requested) {
+          Errors::Message mesg("Edges must be requested when the mesh is created");
+          Exceptions::Jali_throw(mesg);
+        }
+        cache_face2edge_info();
+        cache_cell2edge_info();
+        cache_edge2node_info();
+        break;
+      case Entity_kind::SIDE:
+      case Entity_kind::WEDGE:
+      case Entity_kind::CORNER: {
+        // sides (and through them wedges and corners) are built from
+        // faces and edges
+
+        prepare_caches({Entity_kind::CELL, Entity_kind::FACE,
+                Entity_kind::EDGE});
+
+        sides_requested = true;
+        cache_side_info();
+        if (kind == Entity_kind::WEDGE || kind == Entity_kind::CORNER) {
+          wedges_requested = true;
+          cache_wedge_info();
+        }
+        if (kind == Entity_kind::CORNER) {
+          corners_requested = true;
+          cache_corner_info();
+        }
+
+        rebuild_cache(Mesh_cache::SIDE_GEOMETRY);
+        if (kind == Entity_kind::CORNER)
+          rebuild_cache(Mesh_cache::CORNER_GEOMETRY);
+        break;
+      }
+      default: {}
+    }
+  }
+}
+
+
+// Build a cache that is not built. Adjacencies are built by their
+// cache_* routines (which do nothing if they are built); geometric
+// quantities are computed by all threads, so everything they read is
+// built first
+
+void Mesh::rebuild_cache(Mesh_cache const cache) const {
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+
+  switch (cache) {
+    case Mesh_cache::CELL2NODE: cache_cell2node_info(); break;
+    case Mesh_cache::NODE2CELL: cache_node2cell_info(); break;
+    case Mesh_cache::CELL2FACE: cache_cell2face_info(); break;
+    case Mesh_cache::FACE2CELL: cache_face2cell_info(); break;
+    case Mesh_cache::FACE2NODE: cache_face2node_info(); break;
+    case Mesh_cache::CELL2EDGE: cache_cell2edge_info(); break;
+    case Mesh_cache::FACE2EDGE: cache_face2edge_info(); break;
+    case Mesh_cache::EDGE2NODE: cache_edge2node_info(); break;
+    case Mesh_cache::SIDE: cache_side_info(); break;
+    case Mesh_cache::WEDGE: cache_wedge_info(); break;
+    case Mesh_cache::CORNER: cache_corner_info(); break;
+    case Mesh_cache::NODE_COORDINATES: cache_node_coordinates(); break;
+    case Mesh_cache::CELL_GEOMETRY:
+      if (cell_geometry_precomputed) break;
+      cache_topology();
+      compute_cell_geometric_quantities();
+      break;
+    case Mesh_cache::FACE_GEOMETRY:
+      if (face_geometry_precomputed) break;
+      cache_topology();
+      compute_face_geometric_quantities();
+      break;
+    case Mesh_cache::EDGE_GEOMETRY:
+      if (edge_geometry_precomputed) break;
+      cache_topology();
+      compute_edge_geometric_quantities();
+      break;
+    case Mesh_cache::SIDE_GEOMETRY:
+      if (side_geometry_precomputed) break;
+      cache_topology();
+      cache_side_info();  // sides may have been added by prepare
+      rebuild_cache(Mesh_cache::CELL_GEOMETRY);
+      rebuild_cache(Mesh_cache::FACE_GEOMETRY);
+      rebuild_cache(Mesh_cache::EDGE_GEOMETRY);
+      compute_side_geometric_quantities();
+      break;
+    case Mesh_cache::CORNER_GEOMETRY:
+      if (corner_geometry_precomputed) break;
+      cache_topology();
+      cache_corner_info();
+      rebuild_cache(Mesh_cache::SIDE_GEOMETRY);
+      compute_corner_geometric_quantities();
+      break;
+  }
+}
+
+
+// Memory held by the caches
+
+bool Mesh::cache_built(Mesh_cache const cache) const {
+  switch (cache) {
+    case Mesh_cache::CELL2NODE: return cell2node_info_cached;
+    case Mesh_cache::NODE2CELL: return node2cell_info_cached;
+    case Mesh_cache::CELL2FACE: return cell2face_info_cached;
+    case Mesh_cache::FACE2CELL: return face2cell_info_cached;
+    case Mesh_cache::FACE2NODE: return face2node_info_cached;
+    case Mesh_cache::CELL2EDGE: return cell2edge_info_cached;
+    case Mesh_cache::FACE2EDGE: return face2edge_info_cached;
+    case Mesh_cache::EDGE2NODE: return edge2node_info_cached;
+    case Mesh_cache::SIDE: return side_info_cached;
+    case Mesh_cache::WEDGE: return wedge_info_cached;
+    case Mesh_cache::CORNER: return corner_info_cached;
+    case Mesh_cache::NODE_COORDINATES:
+      return (node_coords_cached || node_coords_soa_cached);
+    case Mesh_cache::CELL_GEOMETRY: return cell_geometry_precomputed;
+    case Mesh_cache::FACE_GEOMETRY: return face_geometry_precomputed;
+    case Mesh_cache::EDGE_GEOMETRY: return edge_geometry_precomputed;
+    case Mesh_cache::SIDE_GEOMETRY: return side_geometry_precomputed;
+    case Mesh_cache::CORNER_GEOMETRY: return corner_geometry_precomputed;
+  }
+  return false;
+}
+
+std::size_t Mesh::cache_memory_size(Mesh_cache const cache) const {
+  if (!cache_built(cache)) return 0;
+
+  switch (cache) {
+    case Mesh_cache::CELL2NODE: return memory_bytes(cell_node_ids);
+    case Mesh_cache::NODE2CELL: return memory_bytes(node_cell_ids);
+    case Mesh_cache::CELL2FACE:
+      return memory_bytes(cell_face_ids, cell_face_dirs);
+    case Mesh_cache::FACE2CELL:
+      return memory_bytes(face_cell_ids, face_cell_slots, face_cell_dirs);
+    case Mesh_cache::FACE2NODE: return memory_bytes(face_node_ids);
+    case Mesh_cache::CELL2EDGE:
+      return memory_bytes(cell_edge_ids, cell_2D_edge_dirs);
+    case Mesh_cache::FACE2EDGE:
+      return memory_bytes(face_edge_ids, face_edge_dirs);
+    case Mesh_cache::EDGE2NODE: return memory_bytes(edge_node_ids);
+    case Mesh_cache::SIDE:
+      return memory_bytes(side_cell_id, side_face_id, side_edge_id,
+                          side_edge_use, side_node_ids, side_opp_side_id,
+                          cell_side_ids);
+    case Mesh_cache::WEDGE: return memory_bytes(wedge_corner_id);
+    case Mesh_cache::CORNER:
+      return memory_bytes(cell_corner_ids, node_corner_ids, corner_wedge_ids);
+    case Mesh_cache::NODE_COORDINATES:
+      return memory_bytes(node_coords_, node_coords_soa_);
+    case Mesh_cache::CELL_GEOMETRY:
+      return memory_bytes(cell_volumes, cell_centroids);
+    case Mesh_cache::FACE_GEOMETRY:
+      return memory_bytes(face_areas, face_centroids, face_normal0,
+                          face_normal1);
+    case Mesh_cache::EDGE_GEOMETRY:
+      return memory_bytes(edge_lengths, edge_vectors, edge_centroids);
+    case Mesh_cache::SIDE_GEOMETRY:
+      return memory_bytes(side_volumes, side_outward_facet_normal,
+                          side_mid_facet_normal);
+    case Mesh_cache::CORNER_GEOMETRY: return memory_bytes(corner_volumes);
+  }
+  return 0;
+}
+
+std::map<Mesh_cache, std::size_t> Mesh::memory_report() const {
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+
+  std::map<Mesh_cache, std::size_t> report;
+  for (int i = 0; i < NUM_MESH_CACHES; i++) {
+    Mesh_cache cache = static_cast<Mesh_cache>(i);
+    report[cache] = cache_memory_size(cache);
+  }
+  return report;
+}
+
+std::size_t Mesh::memory_size(Entity_kind const kind) const {
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+
+  std::size_t nbytes = 0;
+  for (int i = 0; i < NUM_MESH_CACHES; i++) {
+    Mesh_cache cache = static_cast<Mesh_cache>(i);
+    if (kind == Entity_kind::ALL_KIND || Mesh_cache_entity_kind(cache) == kind)
+      nbytes += cache_memory_size(cache);
+  }
+  return nbytes;
+}
+
+
+// Release the memory of caches. The flags are reset first so that
+// the caches are rebuilt by the next query. Entity lists (e.g. the
+// lists of sides) are kept; they are needed to number the entities
+
+void Mesh::release(Mesh_cache const cache) const {
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  release_cache(cache);
+}
+
+void Mesh::release_cache(Mesh_cache const cache) const {
+  switch (cache) {
+    case Mesh_cache::CELL2NODE:
+      cell2node_info_cached = false;
+      cell_node_ids.release();
+      vtk_cells.reset();
+      break;
+    case Mesh_cache::NODE2CELL:
+      node2cell_info_cached = false;
+      node_cell_ids.release();
+      break;
+    case Mesh_cache::CELL2FACE:
+      cell2face_info_cached = false;
+      cell_face_ids.release();
+      cell_face_dirs.release();
+      break;
+    case Mesh_cache::FACE2CELL:
+      face2cell_info_cached = false;
+      free_memory(&face_cell_ids);
+      free_memory(&face_cell_slots);
+      free_memory(&face_cell_dirs);
+      break;
+    case Mesh_cache::FACE2NODE:
+      face2node_info_cached = false;
+      face_node_ids.release();
+      break;
+    case Mesh_cache::CELL2EDGE:
+      cell2edge_info_cached = false;
+      cell_edge_ids.release();
+      cell_2D_edge_dirs.release();
+      break;
+    case Mesh_cache::FACE2EDGE:
+      face2edge_info_cached = false;
+      face_edge_ids.release();
+      face_edge_dirs.release();
+      break;
+    case Mesh_cache::EDGE2NODE:
+      edge2node_info_cached = false;
+      free_memory(&edge_node_ids);
+      break;
+    case Mesh_cache::SIDE:
+      side_info_cached = false;
+      free_memory(&side_cell_id);
+      free_memory(&side_face_id);
+      free_memory(&side_edge_id);
+      free_memory(&side_edge_use);
+      free_memory(&side_node_ids);
+      free_memory(&side_opp_side_id);
+      cell_side_ids.release();
+      break;
+    case Mesh_cache::WEDGE:
+      release_cache(Mesh_cache::CORNER);  // corners fill wedge_corner_id
+      wedge_info_cached = false;
+      free_memory(&wedge_corner_id);
+      break;
+    case Mesh_cache::CORNER:
+      corner_info_cached = false;
+      cell_corner_ids.release();
+      node_corner_ids.release();
+      corner_wedge_ids.release();
+      break;
+    case Mesh_cache::NODE_COORDINATES:
+      node_coords_cached = false;
+      node_coords_soa_cached = false;
+      free_memory(&node_coords_);
+      free_memory(&node_coords_soa_);
+      break;
+    case Mesh_cache::CELL_GEOMETRY:
+      cell_geometry_precomputed = false;
+      free_memory(&cell_volumes);
+      free_memory(&cell_centroids);
+      break;
+    case Mesh_cache::FACE_GEOMETRY:
+      face_geometry_precomputed = false;
+      free_memory(&face_areas);
+      free_memory(&face_centroids);
+      free_memory(&face_normal0);
+      free_memory(&face_normal1);
+      break;
+    case Mesh_cache::EDGE_GEOMETRY:
+      edge_geometry_precomputed = false;
+      free_memory(&edge_lengths);
+      free_memory(&edge_vectors);
+      free_memory(&edge_centroids);
+      break;
+    case Mesh_cache::SIDE_GEOMETRY:
+      side_geometry_precomputed = false;
+      free_memory(&side_volumes);
+      free_memory(&side_outward_facet_normal);
+      free_memory(&side_mid_facet_normal);
+      break;
+    case Mesh_cache::CORNER_GEOMETRY:
+      corner_geometry_precomputed = false;
+      free_memory(&corner_volumes);
+      break;
+  }
+}
+
+
+void Mesh::cache_used(Mesh_cache const cache) const {
+  cache_last_use_[static_cast<int>(cache)] = ++cache_clock_;
+}
+
+void Mesh::memory_budget(std::size_t const bytes) {
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+
+  memory_budget_ = bytes;
+  if (bytes) enforce_memory_budget(cache_clock_);
+  last_trim_ = ++cache_clock_;
+}
+
+// Evict the caches that were not used since the previous call (or
+// since the budget was set) until the caches fit in the budget. The
+// clock is advanced so that uses from here on count as the next phase
+
+void Mesh::trim_caches() const {
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+
+  if (memory_budget_) enforce_memory_budget(last_trim_ - 1);
+  last_trim_ = ++cache_clock_;
+}
+
+// Release least recently used caches until the caches fit in the
+// memory budget or only caches used after 'protect_after' are left
+
+void Mesh::enforce_memory_budget(std::uint64_t const protect_after) const {
+  std::size_t nbytes = memory_size();
+  while (nbytes > memory_budget_) {
+    int lru = -1;
+    for (int i = 0; i < NUM_MESH_CACHES; i++) {
+      if (cache_last_use_[i] > protect_after) continue;
+      if (!cache_built(static_cast<Mesh_cache>(i))) continue;
+      if (lru == -1 || cache_last_use_[i] < cache_last_use_[lru])
+        lru = i;
+    }
+    if (lru == -1) break;
+
+    release_cache(static_cast<Mesh_cache>(lru));
+    nbytes = memory_size();
+  }
+}
+
+
+// List of entities of a kind and parallel type
+
+const std::vector<Entity_ID>& Mesh::entities(Entity_kind const kind,
+                                             Entity_type const type) const {
+  switch (kind) {
+    case Entity_kind::NODE:
+      switch (type) {
+        case Entity_type::PARALLEL_OWNED:
+          return nodes<Entity_type::PARALLEL_OWNED>();
+        case Entity_type::PARALLEL_GHOST:
+          return nodes<Entity_type::PARALLEL_GHOST>();
+        case Entity_type::ALL: return nodes<Entity_type::ALL>();
+        default: return dummy_list_;
+      }
+    case Entity_kind::EDGE:
+      switch (type) {
+        case Entity_type::PARALLEL_OWNED:
+          return edges<Entity_type::PARALLEL_OWNED>();
+        case Entity_type::PARALLEL_GHOST:
+          return edges<Entity_type::PARALLEL_GHOST>();
+        case Entity_type::ALL: return edges<Entity_type::ALL>();
+        default: return dummy_list_;
+      }
+    case Entity_kind::FACE:
+      switch (type) {
+        case Entity_type::PARALLEL_OWNED:
+          return faces<Entity_type::PARALLEL_OWNED>();
+        case Entity_type::PARALLEL_GHOST:
+          return faces<Entity_type::PARALLEL_GHOST>();
+        case Entity_type::ALL: return faces<Entity_type::ALL>();
+        default: return dummy_list_;
+      }
+    case Entity_kind::SIDE:
+      switch (type) {
+        case Entity_type::PARALLEL_OWNED:
+          return sides<Entity_type::PARALLEL_OWNED>();
+        case Entity_type::PARALLEL_GHOST:
+          return sides<Entity_type::PARALLEL_GHOST>();
+        case Entity_type::BOUNDARY_GHOST:
+          return sides<Entity_type::BOUNDARY_GHOST>();
+        case Entity_type::ALL: return sides<Entity_type::ALL>();
+        default: return dummy_list_;
+      }
+    case Entity_kind::WEDGE:
+      switch (type) {
+        case Entity_type::PARALLEL_OWNED:
+          return wedges<Entity_type::PARALLEL_OWNED>();
+        case Entity_type::PARALLEL_GHOST:
+          return wedges<Entity_type::PARALLEL_GHOST>();
+        case Entity_type::BOUNDARY_GHOST:
+          return wedges<Entity_type::BOUNDARY_GHOST>();
+        case Entity_type::ALL: return wedges<Entity_type::ALL>();
+        default: return dummy_list_;
+      }
+    case Entity_kind::CORNER:
+      switch (type) {
+        case Entity_type::PARALLEL_OWNED:
+          return corners<Entity_type::PARALLEL_OWNED>();
+        case Entity_type::PARALLEL_GHOST:
+          return corners<Entity_type::PARALLEL_GHOST>();
+        case Entity_type::BOUNDARY_GHOST:
+          return corners<Entity_type::BOUNDARY_GHOST>();
+        case Entity_type::ALL: return corners<Entity_type::ALL>();
+        default: return dummy_list_;
+      }
+    case Entity_kind::CELL:
+      switch (type) {
+        case Entity_type::PARALLEL_OWNED:
+          return cells<Entity_type::PARALLEL_OWNED>();
+        case Entity_type::PARALLEL_GHOST:
+          return cells<Entity_type::PARALLEL_GHOST>();
+        case Entity_type::BOUNDARY_GHOST:
+          return cells<Entity_type::BOUNDARY_GHOST>();
+        case Entity_type::ALL: return cells<Entity_type::ALL>();
+        default: return dummy_list_;
+      }
+    default:
+      return dummy_list_;
+  }
+}
+
+
+// Communication plan for ghost entities of a kind
+
+std::shared_ptr<MeshHalo const> Mesh::halo(Entity_kind const kind) const {
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+
+  auto it = halos_.find(kind);
+  if (it != halos_.end()) return it->second;
+
+  std::shared_ptr<MeshHalo const> halo = std::make_shared<MeshHalo>(*this,
+                                                                    kind);
+  halos_[kind] = halo;
+  return halo;
+}
+
+
+// Default for frameworks that cannot renumber their entities
+
+void Mesh::renumber_entities_internal(const Entity_kind kind,
+                                      std::vector<Entity_ID> const& new2old) {
+  Errors::Message mesg("Renumbering entities is not supported by this mesh framework");
+  Exceptions::Jali_throw(mesg);
+}
+
+
+// Discard all cached data so that it is rebuilt from the framework
+
+void Mesh::clear_cached_data() {
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+
+  type_info_cached = false;
+  cell2face_info_cached = false;
+  face2cell_info_cached = false;
+  cell2edge_info_cached = false;
+  face2edge_info_cached = false;
+  edge2node_info_cached = false;
+  cell2node_info_cached = false;
+  node2cell_info_cached = false;
+  face2node_info_cached = false;
+  side_info_cached = false;
+  wedge_info_cached = false;
+  corner_info_cached = false;
+  cell_geometry_precomputed = false;
+  face_geometry_precomputed = false;
+  edge_geometry_precomputed = false;
+  side_geometry_precomputed = false;
+  corner_geometry_precomputed = false;
+  node_coords_cached = false;
+  node_coords_soa_cached = false;
+
+  cell_type.clear();
+  face_type.clear();
+  edge_type.clear();
+  node_type.clear();
+
+  cell_face_ids.clear();
+  cell_face_dirs.clear();
+  face_cell_ids.clear();
+  face_cell_slots.clear();
+  face_cell_dirs.clear();
+  cell_node_ids.clear();
+  vtk_cells.reset();
+  node_cell_ids.clear();
+  face_node_ids.clear();
+  cell_edge_ids.clear();
+  face_edge_ids.clear();
+  face_edge_dirs.clear();
+  edge_node_ids.clear();
+  cell_2D_edge_dirs.clear();
+
+  side_cell_id.clear();
+  side_face_id.clear();
+  side_edge_id.clear();
+  side_edge_use.clear();
+  side_node_ids.clear();
+  side_opp_side_id.clear();
+  wedge_corner_id.clear();
+  cell_side_ids.clear();
+  cell_corner_ids.clear();
+  node_corner_ids.clear();
+  corner_wedge_ids.clear();
+  for (auto list : {&sideids_owned_, &sideids_ghost_, &sideids_boundary_ghost_,
+          &sideids_all_, &wedgeids_owned_, &wedgeids_ghost_,
+          &wedgeids_boundary_ghost_, &wedgeids_all_, &cornerids_owned_,
+          &cornerids_ghost_, &cornerids_boundary_ghost_, &cornerids_all_})
+    list->clear();
+
+  cell_volumes.clear();
+  face_areas.clear();
+  edge_lengths.clear();
+  side_volumes.clear();
+  corner_volumes.clear();
+  cell_centroids.clear();
+  face_centroids.clear();
+  face_normal0.clear();
+  face_normal1.clear();
+  edge_vectors.clear();
+  edge_centroids.clear();
+  side_outward_facet_normal.clear();
+  side_mid_facet_normal.clear();
+
+  node_coords_.clear();
+  node_coords_soa_.clear();
+  halos_.clear();
+  spatial_index_.reset();
+}
+
+
+namespace {
+
+// Renumber entities among the IDs of each block of entities (e.g. the
+// owned and the ghost entities). order_block(ents, &order) receives
+// the entities of a block sorted by ID and returns the positions in
+// 'ents' of the entities in their new order
+
+template<typename OrderBlock>
+std::vector<Entity_ID>
+order_by_blocks(int const nentities,
+                std::vector<std::vector<int> const *> const& blocks,
+                OrderBlock order_block) {
+  std::vector<Entity_ID> new2old(nentities);
+  std::iota(new2old.begin(), new2old.end(), 0);
+
+  std::vector<Entity_ID> ents;
+  std::vector<int> order;
+  for (auto const& block : blocks) {
+    ents = *block;
+    std::sort(ents.begin(), ents.end());
+    order_block(ents, &order);
+    assert(order.size() == ents.size());
+    for (std::size_t k = 0; k < ents.size(); k++)
+      new2old[ents[k]] = ents[order[k]];
+  }
+  return new2old;
+}
+
+// Rank of each entity in the order in which the cells, visited in
+// the order cell_new2old, first use it
+
+std::vector<int> first_use_rank(int const nentities,
+                                std::vector<Entity_ID> const& cell_new2old,
+                                CSRArray<Entity_ID> const& cell_entities) {
+  std::vector<int> rank(nentities, std::numeric_limits<int>::max());
+  int next = 0;
+  for (auto const& c : cell_new2old)
+    for (auto const& e : cell_entities.row(c))
+      if (rank[e] == std::numeric_limits<int>::max())
+        rank[e] = next++;
+  return rank;
+}
+
+// Order the entities of a block by increasing rank (ties keep their
+// order by ID)
+
+void order_by_rank(std::vector<int> const& rank,
+                   std::vector<Entity_ID> const& ents,
+                   std::vector<int> *order) {
+  order->resize(ents.size());
+  std::iota(order->begin(), order->end(), 0);
+  std::stable_sort(order->begin(), order->end(),
+                   [&](int const i, int const j) {
+                     return rank[ents[i]] < rank[ents[j]];
+                   });
+}
+
+// Old IDs of entities that are built per cell (sides, corners) given
+// the cell to entity maps before and after the cells were renumbered
+
+std::vector<Entity_ID>
+per_cell_new2old(int const nentities,
+                 std::vector<Entity_ID> const& cell_new2old,
+                 CSRArray<Entity_ID> const& old_cell_entities,
+                 CSRArray<Entity_ID> const& new_cell_entities) {
+  std::vector<Entity_ID> new2old(nentities);
+  for (std::size_t c = 0; c < cell_new2old.size(); c++) {
+    Entity_ID_View newents = new_cell_entities.row(c);
+    Entity_ID_View oldents = old_cell_entities.row(cell_new2old[c]);
+    assert(newents.size() == oldents.size());
+    for (std::size_t k = 0; k < newents.size(); k++)
+      new2old[newents[k]] = oldents[k];
+  }
+  return new2old;
+}
+
+}  // namespace
+
+
+// Renumber entities of the mesh to improve locality
+
+void Mesh::reorder_entities(Entity_ordering const ordering) {
+  JALI_TIME_SCOPE("Mesh::reorder_entities");
+
+  entity_new2old_.clear();
+  if (ordering == Entity_ordering::NONE) return;
+
+  // Adjacencies in the current numbering
+
+  cache_type_info();
+  cache_cell2node_info();
+  cache_node2cell_info();
   if (faces_requested) {
     cache_cell2face_info();
     cache_face2cell_info();
   }
+  if (edges_requested)
+    cache_cell2edge_info();
+
+  int const ncells = num_cells<Entity_type::ALL>();
+  int const nnodes = num_nodes<Entity_type::ALL>();
+  int const nfaces = faces_requested ? num_faces<Entity_type::ALL>() : 0;
+  int const nedges = edges_requested ? num_edges<Entity_type::ALL>() : 0;
+  int const dim = space_dim_;
+
+  std::vector<std::vector<int> const *> cell_blocks =
+      {&cellids_owned_, &cellids_ghost_, &cellids_boundary_ghost_};
+
+  // Cells
+
+  std::vector<Entity_ID> cell_new2old;
+  if (ordering == Entity_ordering::RCM) {
+    std::vector<int> local(ncells, -1);
+    cell_new2old = order_by_blocks(ncells, cell_blocks,
+                                   [&](std::vector<Entity_ID> const& ents,
+                                       std::vector<int> *order) {
+      // Face adjacency graph of the cells of the block (node adjacency
+      // if the mesh has no faces)
+
+      for (std::size_t k = 0; k < ents.size(); k++)
+        local[ents[k]] = k;
+      std::vector<int> offsets(1, 0), adjacency;
+      std::vector<int> nbrs;
+      for (auto const& c : ents) {
+        nbrs.clear();
+        if (faces_requested) {
+          for (auto const& f : cell_face_ids.row(c))
+            for (auto const& c2 : face_cell_ids[f])
+              if (c2 >= 0 && c2 != c && local[c2] >= 0)
+                nbrs.push_back(local[c2]);
+        } else {
+          for (auto const& n : cell_node_ids.row(c))
+            for (auto const& c2 : node_cell_ids.row(n))
+              if (c2 != c && local[c2] >= 0)
+                nbrs.push_back(local[c2]);
+          std::sort(nbrs.begin(), nbrs.end());
+          nbrs.erase(std::unique(nbrs.begin(), nbrs.end()), nbrs.end());
+        }
+        adjacency.insert(adjacency.end(), nbrs.begin(), nbrs.end());
+        offsets.push_back(adjacency.size());
+      }
+      for (auto const& c : ents)
+        local[c] = -1;
+
+      rcm_order(offsets, adjacency, order);
+    });
+  } else {
+    std::vector<double> coords;
+    cell_new2old = order_by_blocks(ncells, cell_blocks,
+                                   [&](std::vector<Entity_ID> const& ents,
+                                       std::vector<int> *order) {
+      coords.resize(dim*ents.size());
+      for (std::size_t k = 0; k < ents.size(); k++) {
+        JaliGeometry::Point cen = cell_centroid(ents[k]);
+        for (int d = 0; d < dim; d++)
+          coords[dim*k+d] = cen[d];
+      }
+      sfc_order(ordering, dim, ents.size(), coords.data(), order);
+    });
+  }
 
+  // Nodes
+
+  std::vector<std::vector<int> const *> node_blocks =
+      {&nodeids_owned_, &nodeids_ghost_};
+  std::vector<Entity_ID> node_new2old;
+  if (ordering == Entity_ordering::RCM) {
+    std::vector<int> rank = first_use_rank(nnodes, cell_new2old,
+                                           cell_node_ids);
+    node_new2old = order_by_blocks(nnodes, node_blocks,
+                                   [&](std::vector<Entity_ID> const& ents,
+                                       std::vector<int> *order) {
+      order_by_rank(rank, ents, order);
+    });
+  } else {
+    std::vector<double> coords;
+    node_new2old = order_by_blocks(nnodes, node_blocks,
+                                   [&](std::vector<Entity_ID> const& ents,
+                                       std::vector<int> *order) {
+      coords.resize(dim*ents.size());
+      JaliGeometry::Point p(dim);
+      for (std::size_t k = 0; k < ents.size(); k++) {
+        node_get_point(ents[k], &p);
+        for (int d = 0; d < dim; d++)
+          coords[dim*k+d] = p[d];
+      }
+      sfc_order(ordering, dim, ents.size(), coords.data(), order);
+    });
+  }
+
+  // Faces and edges
+
+  std::vector<Entity_ID> face_new2old, edge_new2old;
+  if (faces_requested) {
+    std::vector<int> rank = first_use_rank(nfaces, cell_new2old,
+                                           cell_face_ids);
+    face_new2old = order_by_blocks(nfaces, {&faceids_owned_, &faceids_ghost_},
+                                   [&](std::vector<Entity_ID> const& ents,
+                                       std::vector<int> *order) {
+      order_by_rank(rank, ents, order);
+    });
+  }
   if (edges_requested) {
-    cache_face2edge_info();
-    cache_cell2edge_info();
-    cache_edge2node_info();
+    if (manifold_dim_ == 1 && nedges == nnodes) {
+      edge_new2old = node_new2old;  // edges are points in 1D
+    } else if (manifold_dim_ == 2 && nedges == nfaces) {
+      edge_new2old = face_new2old;  // edges are the faces in 2D
+    } else {
+      std::vector<int> rank = first_use_rank(nedges, cell_new2old,
+                                             cell_edge_ids);
+      edge_new2old = order_by_blocks(nedges,
+                                     {&edgeids_owned_, &edgeids_ghost_},
+                                     [&](std::vector<Entity_ID> const& ents,
+                                         std::vector<int> *order) {
+        order_by_rank(rank, ents, order);
+      });
+    }
   }
 
-  if (sides_requested)
+  // Renumber the entities in the framework and in the entity lists
+  // of the base class
+
+  auto renumber_lists = [](std::vector<Entity_ID> const& new2old,
+                           std::vector<std::vector<int> *> const& lists) {
+    std::vector<Entity_ID> old2new(new2old.size());
+    for (std::size_t i = 0; i < new2old.size(); i++)
+      old2new[new2old[i]] = i;
+    for (auto list : lists) {
+      bool sorted = std::is_sorted(list->begin(), list->end());
+      for (auto& e : *list)
+        e = old2new[e];
+      if (sorted) std::sort(list->begin(), list->end());
+    }
+  };
+
+  renumber_entities_internal(Entity_kind::NODE, node_new2old);
+  renumber_lists(node_new2old,
+                 {&nodeids_owned_, &nodeids_ghost_, &nodeids_all_});
+  if (edges_requested) {
+    renumber_entities_internal(Entity_kind::EDGE, edge_new2old);
+    renumber_lists(edge_new2old,
+                   {&edgeids_owned_, &edgeids_ghost_, &edgeids_all_});
+  }
+  if (faces_requested) {
+    renumber_entities_internal(Entity_kind::FACE, face_new2old);
+    renumber_lists(face_new2old,
+                   {&faceids_owned_, &faceids_ghost_, &faceids_all_});
+  }
+  renumber_entities_internal(Entity_kind::CELL, cell_new2old);
+  renumber_lists(cell_new2old, {&cellids_owned_, &cellids_ghost_,
+          &cellids_boundary_ghost_, &cellids_all_});
+
+  entity_new2old_[Entity_kind::NODE] = node_new2old;
+  entity_new2old_[Entity_kind::EDGE] = edge_new2old;
+  entity_new2old_[Entity_kind::FACE] = face_new2old;
+  entity_new2old_[Entity_kind::CELL] = cell_new2old;
+
+  // Rebuild everything derived from the old numbering. Sides, wedges
+  // and corners are rebuilt cell by cell in the same local order, so
+  // their old IDs follow from the old IDs of the cells
+
+  bool const had_sides = sides_requested;
+  bool const had_wedges = wedges_requested;
+  bool const had_corners = corners_requested;
+  if (had_sides) cache_side_info();  // may have been released
+  if (had_corners) cache_corner_info();
+  CSRArray<Entity_ID> old_cell_side_ids, old_cell_corner_ids;
+  std::swap(old_cell_side_ids, cell_side_ids);
+  std::swap(old_cell_corner_ids, cell_corner_ids);
+
+  // Tile cell weights follow their (owned) cells
+
+  if (!tile_cell_weights_.empty()) {
+    std::vector<double> new_weights(tile_cell_weights_.size());
+    for (std::size_t c = 0; c < new_weights.size(); c++)
+      new_weights[c] = tile_cell_weights_[cell_new2old[c]];
+    tile_cell_weights_.swap(new_weights);
+  }
+
+  clear_cached_data();
+  meshtiles.clear();
+  clear_colorings();
+  tiles_initialized_ = false;
+  node_master_tile_ID_.clear();
+  edge_master_tile_ID_.clear();
+  face_master_tile_ID_.clear();
+  cell_master_tile_ID_.clear();
+
+  cache_extra_variables();
+
+  if (had_sides) {
     cache_side_info();
-  if (wedges_requested) {  // keep this order
-    if (!side_info_cached) cache_side_info();
-    cache_wedge_info();
+    std::vector<Entity_ID> side_new2old =
+        per_cell_new2old(num_sides<Entity_type::ALL>(), cell_new2old,
+                         old_cell_side_ids, cell_side_ids);
+    if (had_wedges) {
+      cache_wedge_info();
+      std::vector<Entity_ID> wedge_new2old(2*side_new2old.size());
+      for (std::size_t s = 0; s < side_new2old.size(); s++) {
+        wedge_new2old[2*s] = 2*side_new2old[s];
+        wedge_new2old[2*s+1] = 2*side_new2old[s]+1;
+      }
+      entity_new2old_[Entity_kind::WEDGE] = wedge_new2old;
+    }
+    entity_new2old_[Entity_kind::SIDE] = side_new2old;
   }
-  if (corners_requested) {  // Keep this order
-    if (!side_info_cached) cache_side_info();
-    if (!wedge_info_cached) cache_wedge_info();
+  if (had_corners) {
     cache_corner_info();
+    entity_new2old_[Entity_kind::CORNER] =
+        per_cell_new2old(num_corners<Entity_type::ALL>(), cell_new2old,
+                         old_cell_corner_ids, cell_corner_ids);
   }
 
-  update_geometric_quantities();
+  // Values of fields stored with the mesh follow their entities
+
+  for (auto& kv : fields_) {
+    FieldArray& field = kv.second;
+    auto it = entity_new2old_.find(field.kind);
+    if (it == entity_new2old_.end() || it->second.empty()) continue;
+    std::vector<Entity_ID> const& new2old = it->second;
+    std::size_t const valsize = field.values.size()/new2old.size();
+    std::vector<char> new_values(field.values.size());
+    for (std::size_t i = 0; i < new2old.size(); i++)
+      std::memcpy(&new_values[i*valsize], &field.values[new2old[i]*valsize],
+                  valsize);
+    field.values.swap(new_values);
+  }
+
+  // Mesh sets
+
+  std::map<Entity_kind, std::vector<Entity_ID>> old2new;
+  for (auto const& kv : entity_new2old_) {
+    std::vector<Entity_ID>& o2n = old2new[kv.first];
+    o2n.resize(kv.second.size());
+    for (std::size_t i = 0; i < kv.second.size(); i++)
+      o2n[kv.second[i]] = i;
+  }
+  for (auto const& set : meshsets_) {
+    auto it = old2new.find(set->kind());
+    if (it != old2new.end()) {
+      set->renumber(it->second);
+    } else if (set->num_entities()) {
+      Errors::Message mesg("Mesh set \"" + set->name() + "\" is on entities that were not renumbered");
+      Exceptions::Jali_throw(mesg);
+    }
+  }
+
+  if (num_tiles_ini_)
+    build_tiles();
+}
+
+
+std::vector<Entity_ID> const&
+Mesh::entity_new_to_old(Entity_kind const kind) const {
+  auto it = entity_new2old_.find(kind);
+  return (it != entity_new2old_.end()) ? it->second : dummy_list_;
+}
+
+
+// Fields stored with the mesh on a kind of entity
+
+void Mesh::get_field_info(Entity_kind on_what, int *num,
+                          std::vector<std::string> *varnames,
+                          std::vector<std::string> *vartypes) const {
+  varnames->clear();
+  vartypes->clear();
+  for (auto const& kv : fields_) {
+    if (kv.second.kind != on_what) continue;
+    varnames->push_back(kv.first);
+    vartypes->push_back(kv.second.vartype);
+  }
+  *num = varnames->size();
+}
+
+
+void Mesh::rebuild_tiles(std::vector<double> const& cell_weights) {
+  if (!cell_weights.empty() &&
+      cell_weights.size() != num_cells<Entity_type::PARALLEL_OWNED>()) {
+    Errors::Message mesg("Mesh::rebuild_tiles - number of cell weights does not match number of owned cells");
+    Exceptions::Jali_throw(mesg);
+  }
+  tile_cell_weights_ = cell_weights;
+
+  meshtiles.clear();
+  clear_colorings();
+  tiles_initialized_ = false;
+  node_master_tile_ID_.clear();
+  edge_master_tile_ID_.clear();
+  face_master_tile_ID_.clear();
+  cell_master_tile_ID_.clear();
+
+  if (num_tiles_ini_)
+    build_tiles();
 }
 
 
 // Partition the mesh on this compute node into submeshes or tiles
 
 void Mesh::build_tiles() {
+  JALI_TIME_SCOPE("Mesh::build_tiles");
 
   std::vector<std::vector<int>> partitions;
   partitions.resize(num_tiles_ini_);
@@ -603,13 +2016,61 @@ void Mesh::build_tiles() {
   std::cerr << "Calling partitioner " << partitioner_pref_ << "\n";
   get_partitioning(num_tiles_ini_, partitioner_pref_, &partitions);
 
-  // Make the tiles - make mesh tile will also call a routine of this mesh
-  // to add the tile to the mesh's list of tiles
+  build_tiles(partitions);
+}
+
+
+// Make one tile for each list of owned cells in partitions
+
+void Mesh::build_tiles(std::vector<std::vector<Entity_ID>> const& partitions) {
+  int const ntiles = partitions.size();
+
+  // Build the adjacency information the tiles are made from so that
+  // building the tiles only reads the caches
+
+  std::vector<Entity_kind> kinds = {Entity_kind::CELL};
+  if (faces_requested) kinds.push_back(Entity_kind::FACE);
+  if (edges_requested) kinds.push_back(Entity_kind::EDGE);
+  if (sides_requested) kinds.push_back(Entity_kind::SIDE);
+  if (wedges_requested) kinds.push_back(Entity_kind::WEDGE);
+  if (corners_requested) kinds.push_back(Entity_kind::CORNER);
+  prepare_caches(kinds);
+
+  // Make the master tile of each node, face and edge the first tile
+  // whose owned cells use it (as if the tiles were built one after
+  // another). Then the tiles only read the master tile IDs and can
+  // be built concurrently
+
+  int const tileid0 = meshtiles.size();
+  if (!tiles_initialized_) init_tiles();
+  for (int i = 0; i < ntiles; ++i) {
+    int const tileid = tileid0 + i;
+    for (auto const& c : partitions[i]) {
+      cell_master_tile_ID_[c] = tileid;
+      for (auto const& n : cell_get_nodes_view(c))
+        if (node_master_tile_ID_[n] == -1) node_master_tile_ID_[n] = tileid;
+      if (faces_requested)
+        for (auto const& f : cell_get_faces_view(c))
+          if (face_master_tile_ID_[f] == -1) face_master_tile_ID_[f] = tileid;
+      if (edges_requested)
+        for (auto const& e : cell_get_edges_view(c))
+          if (edge_master_tile_ID_[e] == -1) edge_master_tile_ID_[e] = tileid;
+    }
+  }
 
-  for (int i = 0; i < num_tiles_ini_; ++i)
-    make_meshtile(*this, partitions[i], num_ghost_layers_tile_, faces_requested,
-                  edges_requested, sides_requested, wedges_requested,
-                  corners_requested);
+  std::vector<std::shared_ptr<MeshTile>> newtiles(ntiles);
+  ThreadPool::instance().run(ntiles, [&](int i, int ithread) {
+      newtiles[i] = std::make_shared<MeshTile>(*this, partitions[i],
+                                               num_ghost_layers_tile_,
+                                               faces_requested,
+                                               edges_requested,
+                                               sides_requested,
+                                               wedges_requested,
+                                               corners_requested,
+                                               tileid0 + i);
+    });
+  for (auto const& tile : newtiles)
+    add_tile(tile);
 }
 
 
@@ -631,6 +2092,133 @@ void Mesh::init_tiles() {
 
 void Mesh::add_tile(std::shared_ptr<MeshTile> const tile2add) {
   meshtiles.emplace_back(tile2add);
+  clear_colorings();
+}
+
+
+namespace {
+
+// Greedy coloring: each item gets the smallest color not taken by one
+// of its neighbors colored before it (neighbors(item, &nbrs) lists
+// them). color[] is indexed by item and must be -1 for uncolored
+// items; entries of neighbors outside 'items' must stay -1. Returns
+// the items grouped by color, each group in the order of 'items'
+
+template<typename Neighbors>
+std::vector<std::vector<int>> greedy_coloring(std::vector<int> const& items,
+                                              Neighbors const& neighbors,
+                                              std::vector<int> *color) {
+  std::vector<std::vector<int>> groups;
+  std::vector<int> taken_by;  // taken_by[k] == i if color k is used
+                              // by a neighbor of items[i]
+  std::vector<int> nbrs;
+  int const nitems = items.size();
+  for (int i = 0; i < nitems; i++) {
+    int const item = items[i];
+    nbrs.clear();
+    neighbors(item, &nbrs);
+    for (auto const& nbr : nbrs)
+      if ((*color)[nbr] >= 0) taken_by[(*color)[nbr]] = i;
+
+    int const ncolors = taken_by.size();
+    int k = 0;
+    while (k < ncolors && taken_by[k] == i) k++;
+    if (k == ncolors) {
+      taken_by.push_back(-1);
+      groups.emplace_back();
+    }
+    (*color)[item] = k;
+    groups[k].push_back(item);
+  }
+  return groups;
+}
+
+}  // namespace
+
+
+// Color the tiles so that tiles sharing a node of their owned cells
+// get different colors
+
+std::vector<std::vector<int>> const& Mesh::tile_colors() const {
+  if (tile_colors_cached_) return tile_colors_;
+
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (tile_colors_cached_) return tile_colors_;  // built meanwhile
+
+  int const ntiles = meshtiles.size();
+
+  // Tiles whose owned cells use each node (in increasing order since
+  // the tiles are visited in order)
+
+  std::vector<std::vector<int>> node_tiles(num_nodes());
+  for (int t = 0; t < ntiles; t++)
+    for (auto const& c :
+             meshtiles[t]->cells<Entity_type::PARALLEL_OWNED>())
+      for (auto const& n : cell_get_nodes_view(c))
+        if (node_tiles[n].empty() || node_tiles[n].back() != t)
+          node_tiles[n].push_back(t);
+
+  auto tile_neighbors = [&](int const t, std::vector<int> *nbrs) {
+    for (auto const& c : meshtiles[t]->cells<Entity_type::PARALLEL_OWNED>())
+      for (auto const& n : cell_get_nodes_view(c))
+        nbrs->insert(nbrs->end(), node_tiles[n].begin(), node_tiles[n].end());
+  };
+
+  std::vector<int> tileids(ntiles), color(ntiles, -1);
+  for (int t = 0; t < ntiles; t++) tileids[t] = t;
+  tile_colors_ = greedy_coloring(tileids, tile_neighbors, &color);
+
+  tile_colors_cached_ = true;
+  return tile_colors_;
+}
+
+
+// Color the owned cells of each tile so that cells sharing a node get
+// different colors. The tiles are colored concurrently; each only
+// writes the colors of its own cells
+
+std::vector<std::vector<Entity_ID>> const&
+Mesh::cell_colors(int const tileid) const {
+  if (tileid < 0 || tileid >= static_cast<int>(meshtiles.size())) {
+    Errors::Message mesg("Mesh::cell_colors - invalid tile ID");
+    Exceptions::Jali_throw(mesg);
+  }
+  if (cell_colors_cached_) return tile_cell_colors_[tileid];
+
+  // Build outside cache_mutex_ since the tiles are processed by the
+  // thread pool and the adjacency views may need to lock it
+
+  std::vector<std::vector<std::vector<Entity_ID>>> colors(meshtiles.size());
+  std::vector<int> color(num_cells(), -1);
+  for_each_tile([&](MeshTile const& tile, int ithread) {
+      int const t = tile.ID();
+      auto cell_neighbors = [&](Entity_ID const c, std::vector<int> *nbrs) {
+        for (auto const& n : cell_get_nodes_view(c))
+          for (auto const& c2 : node_get_cells_view(n))
+            if (c2 != c && master_tile_ID_of_cell(c2) == t)
+              nbrs->push_back(c2);
+      };
+      colors[t] = greedy_coloring(tile.cells<Entity_type::PARALLEL_OWNED>(),
+                                  cell_neighbors, &color);
+    });
+
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  if (!cell_colors_cached_) {
+    tile_cell_colors_.swap(colors);
+    cell_colors_cached_ = true;
+  }
+  return tile_cell_colors_[tileid];
+}
+
+
+// Discard the colorings (the tiles changed)
+
+void Mesh::clear_colorings() {
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+  tile_colors_cached_ = false;
+  cell_colors_cached_ = false;
+  tile_colors_.clear();
+  tile_cell_colors_.clear();
 }
 
   
@@ -649,9 +2237,16 @@ unsigned int Mesh::cell_get_num_faces(const Entity_ID cellid) const {
   //
   // Cached version - turn off for profiling or to save memory
   //
-  assert(cell2face_info_cached);
+  if (implicit_topology_) {
+    Entity_ID_List cfaceids;
+    cell_get_faces_and_dirs_internal(cellid, &cfaceids, nullptr, false);
+    return cfaceids.size();
+  }
+
+  if (!cell2face_info_cached) cache_cell2face_info();
+  cache_accessed(Mesh_cache::CELL2FACE);
 
-  return cell_face_ids[cellid].size();
+  return cell_face_ids.row_size(cellid);
 
 #else
 
@@ -678,18 +2273,23 @@ void Mesh::cell_get_faces_and_dirs(const Entity_ID cellid,
   //
   // Cached version - turn off for profiling or to save memory
   //
-  assert(cell2face_info_cached);
+  if (implicit_topology_) {
+    cell_get_faces_and_dirs_internal(cellid, faceids, face_dirs, ordered);
+    return;
+  }
+
+  if (!cell2face_info_cached) cache_cell2face_info();
+  cache_accessed(Mesh_cache::CELL2FACE);
 
   if (ordered) {
     cell_get_faces_and_dirs_internal(cellid, faceids, face_dirs, ordered);
   } else {
-    Entity_ID_List &cfaceids = cell_face_ids[cellid];
-
-    *faceids = cfaceids;  // copy operation
+    Entity_ID_View cfaceids = cell_face_ids[cellid];
+    faceids->assign(cfaceids.begin(), cfaceids.end());  // copy operation
 
     if (face_dirs) {
-      std::vector<dir_t> &cfacedirs = cell_face_dirs[cellid];
-      *face_dirs = cfacedirs;  // copy operation
+      Dir_View cfacedirs = cell_face_dirs[cellid];
+      face_dirs->assign(cfacedirs.begin(), cfacedirs.end());  // copy
     }
   }
 
@@ -717,7 +2317,21 @@ void Mesh::face_get_cells(const Entity_ID faceid, const Entity_type ptype,
   // Cached version - turn off for profiling or to save memory
   //
 
-  assert(face2cell_info_cached);
+  if (implicit_topology_) {
+    face_get_cells_internal(faceid, Entity_type::ALL, cellids);
+    if (ptype != Entity_type::ALL) {
+      cache_type_info();
+      cellids->erase(std::remove_if(cellids->begin(), cellids->end(),
+                                    [&](Entity_ID const c) {
+                                      return cell_type[c] != ptype;
+                                    }),
+                     cellids->end());
+    }
+    return;
+  }
+
+  if (!face2cell_info_cached) cache_face2cell_info();
+  cache_accessed(Mesh_cache::FACE2CELL);
 
 
   cellids->clear();
@@ -796,13 +2410,20 @@ void Mesh::face_get_edges_and_dirs(const Entity_ID faceid,
   // Cached version - turn off for profiling or to save memory
   //
 
-  assert(face2edge_info_cached);
+  if (implicit_topology_) {
+    face_get_edges_and_dirs_internal(faceid, edgeids, edge_dirs, ordered);
+    return;
+  }
+
+  if (!face2edge_info_cached) cache_face2edge_info();
+  cache_accessed(Mesh_cache::FACE2EDGE);
 
-  *edgeids = face_edge_ids[faceid];  // copy operation
+  Entity_ID_View fedgeids = face_edge_ids[faceid];
+  edgeids->assign(fedgeids.begin(), fedgeids.end());  // copy operation
 
   if (edge_dirs) {
-    std::vector<dir_t> &fedgedirs = face_edge_dirs[faceid];
-    *edge_dirs = fedgedirs;  // copy operation
+    Dir_View fedgedirs = face_edge_dirs[faceid];
+    edge_dirs->assign(fedgedirs.begin(), fedgedirs.end());  // copy
   }
 
 
@@ -829,14 +2450,32 @@ void Mesh::face_to_cell_edge_map(const Entity_ID faceid,
   // Cached version - turn off for profiling or to save memory
   //
 
-  assert(face2edge_info_cached && cell2edge_info_cached);
+  if (implicit_topology_) {
+    Entity_ID_List fedgeids, cedgeids;
+    face_get_edges_and_dirs_internal(faceid, &fedgeids, nullptr, true);
+    cell_get_edges_internal(cellid, &cedgeids);
+    map->assign(fedgeids.size(), -1);
+    for (std::size_t f = 0; f < fedgeids.size(); ++f) {
+      auto it = std::find(cedgeids.begin(), cedgeids.end(), fedgeids[f]);
+      if (it != cedgeids.end()) (*map)[f] = it - cedgeids.begin();
+    }
+    return;
+  }
+
+  if (!face2edge_info_cached) cache_face2edge_info();
+  if (!cell2edge_info_cached) cache_cell2edge_info();
+  cache_accessed(Mesh_cache::FACE2EDGE);
+  cache_accessed(Mesh_cache::CELL2EDGE);
 
-  map->resize(face_edge_ids[faceid].size());
-  for (int f = 0; f < face_edge_ids[faceid].size(); ++f) {
-    Entity_ID fedge = face_edge_ids[faceid][f];
+  Entity_ID_View fedgeids = face_edge_ids[faceid];
+  Entity_ID_View cedgeids = cell_edge_ids[cellid];
 
-    for (int c = 0; c < cell_edge_ids[cellid].size(); ++c) {
-      if (fedge == cell_edge_ids[cellid][c]) {
+  map->resize(fedgeids.size());
+  for (std::size_t f = 0; f < fedgeids.size(); ++f) {
+    Entity_ID fedge = fedgeids[f];
+
+    for (std::size_t c = 0; c < cedgeids.size(); ++c) {
+      if (fedge == cedgeids[c]) {
         (*map)[f] = c;
         break;
       }
@@ -875,9 +2514,21 @@ void Mesh::cell_get_edges(const Entity_ID cellid,
   // Cached version - turn off for profiling
   //
 
-  assert(cell2edge_info_cached);
+  if (implicit_topology_) {
+    if (space_dim_ == 1)
+      cell_get_nodes(cellid, edgeids);  // edges are same as nodes
+    else if (space_dim_ == 2)
+      cell_2D_get_edges_and_dirs_internal(cellid, edgeids, nullptr);
+    else
+      cell_get_edges_internal(cellid, edgeids);
+    return;
+  }
+
+  if (!cell2edge_info_cached) cache_cell2edge_info();
+  cache_accessed(Mesh_cache::CELL2EDGE);
 
-  *edgeids = cell_edge_ids[cellid];  // copy operation
+  Entity_ID_View cedgeids = cell_edge_ids[cellid];
+  edgeids->assign(cedgeids.begin(), cedgeids.end());  // copy operation
 
 #else
 
@@ -900,10 +2551,18 @@ void Mesh::cell_2D_get_edges_and_dirs(const Entity_ID cellid,
   // Cached version - turn off for profiling
   //
 
-  assert(cell2edge_info_cached);
+  if (implicit_topology_) {
+    cell_2D_get_edges_and_dirs_internal(cellid, edgeids, edgedirs);
+    return;
+  }
+
+  if (!cell2edge_info_cached) cache_cell2edge_info();
+  cache_accessed(Mesh_cache::CELL2EDGE);
 
-  *edgeids = cell_edge_ids[cellid];  // copy operation
-  *edgedirs = cell_2D_edge_dirs[cellid];
+  Entity_ID_View cedgeids = cell_edge_ids[cellid];
+  Dir_View cedgedirs = cell_2D_edge_dirs[cellid];
+  edgeids->assign(cedgeids.begin(), cedgeids.end());  // copy operation
+  edgedirs->assign(cedgedirs.begin(), cedgedirs.end());
 
 #else
 
@@ -920,21 +2579,21 @@ void Mesh::cell_2D_get_edges_and_dirs(const Entity_ID cellid,
 void Mesh::cell_get_sides(const Entity_ID cellid,
                            Entity_ID_List *sideids) const {
   assert(sides_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
 
-  int nsides = cell_side_ids[cellid].size();
-  sideids->resize(nsides);
-  std::copy(cell_side_ids[cellid].begin(), cell_side_ids[cellid].end(),
-            sideids->begin());
+  Entity_ID_View csides = cell_side_ids[cellid];
+  sideids->assign(csides.begin(), csides.end());
 }
 
 
 void Mesh::cell_get_wedges(const Entity_ID cellid,
                            Entity_ID_List *wedgeids) const {
   assert(wedges_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
 
-  std::vector<Entity_ID>& csides = cell_side_ids[cellid];
+  Entity_ID_View csides = cell_side_ids[cellid];
   int nsides = csides.size();
   int nwedges = 2*nsides;
   wedgeids->resize(nwedges);
@@ -948,27 +2607,23 @@ void Mesh::cell_get_wedges(const Entity_ID cellid,
 void Mesh::cell_get_corners(const Entity_ID cellid,
                             Entity_ID_List *cornerids) const {
   assert(corners_requested);
-  assert(corner_info_cached);
+  if (!corner_info_cached) cache_corner_info();
+  cache_accessed(Mesh_cache::CORNER);
 
-  int ncorners = cell_corner_ids[cellid].size();
-  cornerids->resize(ncorners);
-  std::copy(cell_corner_ids[cellid].begin(), cell_corner_ids[cellid].end(),
-            cornerids->begin());
+  Entity_ID_View ccorners = cell_corner_ids[cellid];
+  cornerids->assign(ccorners.begin(), ccorners.end());
 }
 
 
 Entity_ID Mesh::cell_get_corner_at_node(const Entity_ID cellid,
                                         const Entity_ID nodeid) const {
   assert(corners_requested);
-  assert(corner_info_cached);
+  if (!corner_info_cached) cache_corner_info();
+  cache_accessed(Mesh_cache::CORNER);
 
-  Entity_ID_List::iterator itc = cell_corner_ids[cellid].begin();
-  while (itc != cell_corner_ids[cellid].end()) {
-    int cornerid = *itc;
+  for (auto const& cornerid : cell_corner_ids[cellid]) {
     if (corner_get_node(cornerid) == nodeid)
       return cornerid;
-    else
-      ++itc;
   }
   return -1;   // shouldn't come here unless node does not belong to cell
 }
@@ -977,11 +2632,14 @@ Entity_ID Mesh::cell_get_corner_at_node(const Entity_ID cellid,
 void Mesh::node_get_wedges(const Entity_ID nodeid, Entity_type ptype,
                            Entity_ID_List *wedgeids) const {
   assert(wedges_requested);
-  assert(wedge_info_cached && corner_info_cached);
+  if (!wedge_info_cached) cache_wedge_info();
+  if (!corner_info_cached) cache_corner_info();
+  cache_accessed(Mesh_cache::WEDGE);
+  cache_accessed(Mesh_cache::CORNER);
 
   wedgeids->clear();
   for (auto const& cn : node_corner_ids[nodeid]) {
-    Entity_ID_List cnwedges = corner_wedge_ids[cn];
+    Entity_ID_View cnwedges = corner_wedge_ids[cn];
     for (auto const& w : cnwedges) {
       Entity_ID s = static_cast<Entity_ID>(w/2);
       Entity_ID c = side_cell_id[s];
@@ -995,57 +2653,55 @@ void Mesh::node_get_wedges(const Entity_ID nodeid, Entity_type ptype,
 void Mesh::node_get_corners(const Entity_ID nodeid, Entity_type ptype,
                             Entity_ID_List *cornerids) const {
   assert(corners_requested);
-  assert(corner_info_cached);
+  if (!corner_info_cached) cache_corner_info();
+  cache_accessed(Mesh_cache::CORNER);
 
-  switch (ptype) {
-    case Entity_type::ALL:
-      cornerids->resize(node_corner_ids[nodeid].size());
-      std::copy(node_corner_ids[nodeid].begin(), node_corner_ids[nodeid].end(),
-                cornerids->begin());
-      break;
-    default:
-      cornerids->clear();
-      for (auto const& cn : node_corner_ids[nodeid]) {
-        Entity_ID w0 = corner_wedge_ids[cn][0];
-        Entity_ID s = static_cast<Entity_ID>(w0/2);
-        Entity_ID c = side_cell_id[s];
-        if (cell_type[c] == ptype)
-          cornerids->push_back(cn);
-      }
-      break;
-  }
+  Entity_ID_View ncorners = node_get_corners_view(nodeid, ptype);
+  cornerids->assign(ncorners.begin(), ncorners.end());
 }
 
 
 int Mesh::compute_cell_geometric_quantities() const {
+  JALI_TIME_SCOPE("Mesh::compute_cell_geometric_quantities");
+
   int ncells = num_cells<Entity_type::ALL>();
 
   cell_volumes.resize(ncells);
   cell_centroids.resize(ncells);
-  
+
+  std::vector<Geometry_scratch> scratch(num_threads());
+
   std::vector<double> zerovec(space_dim_, 0.0);
-  for (int c = 0; c < ncells; c++) {
-    if (cell_type[c] == Entity_type::BOUNDARY_GHOST) {
-      cell_volumes[c] = 0.0;
-      cell_centroids[c].set(space_dim_, &(zerovec[0]));
-    } else {
-      double volume;
-      JaliGeometry::Point centroid(space_dim_);
-      
-      compute_cell_geometry(c, &volume, &centroid);
-      
-      cell_volumes[c] = volume;
-      cell_centroids[c] = centroid;
-    }
-  }
+  Jali::parallel_for(ncells, [&](int cbegin, int cend, int ithread) {
+      for (int c = cbegin; c < cend; c++) {
+        if (cell_type[c] == Entity_type::BOUNDARY_GHOST) {
+          cell_volumes[c] = 0.0;
+          cell_centroids[c].set(space_dim_, &(zerovec[0]));
+        } else {
+          double volume;
+          JaliGeometry::Point centroid(space_dim_);
+
+          compute_cell_geometry(c, &volume, &centroid, &(scratch[ithread]));
+
+          cell_volumes[c] = volume;
+          cell_centroids[c] = centroid;
+        }
+      }
+    });
 
+  cache_used(Mesh_cache::CELL_GEOMETRY);
   cell_geometry_precomputed = true;
+  JALI_COUNT_BYTES("Mesh::compute_cell_geometric_quantities",
+                   memory_bytes(cell_volumes, cell_centroids));
+
   return 1;
 }  // Mesh::compute_cell_geometric_quantities
 
 
 
 int Mesh::compute_face_geometric_quantities() const {
+  JALI_TIME_SCOPE("Mesh::compute_face_geometric_quantities");
+
   int nfaces = num_faces<Entity_type::ALL>();
 
   face_areas.resize(nfaces);
@@ -1053,99 +2709,188 @@ int Mesh::compute_face_geometric_quantities() const {
   face_normal0.resize(nfaces);
   face_normal1.resize(nfaces);
 
-  for (int i = 0; i < nfaces; i++) {
-    double area;
-    JaliGeometry::Point centroid(space_dim_), normal0(space_dim_),
-        normal1(space_dim_);
+  std::vector<Geometry_scratch> scratch(num_threads());
 
-    // normal0 and normal1 are outward normals of the face with
-    // respect to the cell0 and cell1 of the face. The natural normal
-    // of the face points out of cell0 and into cell1. If one of these
-    // cells do not exist, then the normal is the null vector.
+  Jali::parallel_for(nfaces, [&](int fbegin, int fend, int ithread) {
+      for (int i = fbegin; i < fend; i++) {
+        double area;
+        JaliGeometry::Point centroid(space_dim_), normal0(space_dim_),
+            normal1(space_dim_);
 
-    compute_face_geometry(i, &area, &centroid, &normal0, &normal1);
+        // normal0 and normal1 are outward normals of the face with
+        // respect to the cell0 and cell1 of the face. The natural
+        // normal of the face points out of cell0 and into cell1. If
+        // one of these cells do not exist, then the normal is the
+        // null vector.
 
-    face_areas[i] = area;
-    face_centroids[i] = centroid;
-    face_normal0[i] = normal0;
-    face_normal1[i] = normal1;
-  }
+        compute_face_geometry(i, &area, &centroid, &normal0, &normal1,
+                              &(scratch[ithread]));
+
+        face_areas[i] = area;
+        face_centroids[i] = centroid;
+        face_normal0[i] = normal0;
+        face_normal1[i] = normal1;
+      }
+    });
 
+  cache_used(Mesh_cache::FACE_GEOMETRY);
   face_geometry_precomputed = true;
+  JALI_COUNT_BYTES("Mesh::compute_face_geometric_quantities",
+                   memory_bytes(face_areas, face_centroids, face_normal0,
+                                face_normal1));
+
   return 1;
 }  // Mesh::compute_face_geometric_quantities
 
 
 
 int Mesh::compute_edge_geometric_quantities() const {
+  JALI_TIME_SCOPE("Mesh::compute_edge_geometric_quantities");
+
   int nedges = num_edges<Entity_type::ALL>();
 
   edge_vectors.resize(nedges);
   edge_lengths.resize(nedges);
 
-  for (int i = 0; i < nedges; i++) {
-    double length;
-    JaliGeometry::Point evector(space_dim_), ecenter;
+  Jali::parallel_for(nedges, [&](int ebegin, int eend, int ithread) {
+      for (int i = ebegin; i < eend; i++) {
+        double length;
+        JaliGeometry::Point evector(space_dim_), ecenter;
 
-    compute_edge_geometry(i, &length, &evector, &ecenter);
+        compute_edge_geometry(i, &length, &evector, &ecenter);
 
-    edge_lengths[i] = length;
-    edge_vectors[i] = evector;
-  }
+        edge_lengths[i] = length;
+        edge_vectors[i] = evector;
+      }
+    });
 
+  cache_used(Mesh_cache::EDGE_GEOMETRY);
   edge_geometry_precomputed = true;
+  JALI_COUNT_BYTES("Mesh::compute_edge_geometric_quantities",
+                   memory_bytes(edge_vectors, edge_lengths));
+
   return 1;
 }  // Mesh::compute_edge_geometric_quantities
 
 
 int Mesh::compute_side_geometric_quantities() const {
-  side_volumes.resize(num_sides());
-
-  // Cannot use resize for the facet normals because we cannot tell
-  // the initialization operator what the dimensionality of the points
-  // will be, unless we can write a statement like this
-  //
-  //  wedge_facet_normals0.resize(nwedges, Point(3));
-  //
-  // It is also unclear that this is good to do because it will cause
-  // a copy operator to be triggered for each element (?)
-
-  side_outward_facet_normal.reserve(num_sides());
-  side_mid_facet_normal.reserve(num_sides());
-
-  JaliGeometry::Point outward_facet_normal(space_dim_);
-  JaliGeometry::Point mid_facet_normal(space_dim_);
-  for (auto const & s : sides()) {
-    if (entity_get_type(Entity_kind::SIDE, s) == Entity_type::BOUNDARY_GHOST) {
-      side_volumes[s] = 0.0;
-      outward_facet_normal.set(0.0);
-      mid_facet_normal.set(0.0);
-    } else {
-      compute_side_geometry(s, &(side_volumes[s]),
-                            &(outward_facet_normal),
-                            &(mid_facet_normal));
-    }
-    side_outward_facet_normal.push_back(outward_facet_normal);
-    side_mid_facet_normal.push_back(mid_facet_normal);
-  }
+  JALI_TIME_SCOPE("Mesh::compute_side_geometric_quantities");
+
+  int nsides = num_sides();
+
+  // Sized up front (rather than grown with push_back) so that each
+  // thread can write its own sides and so that recomputing the
+  // geometry overwrites the old values instead of appending to them
+
+  side_volumes.resize(nsides);
+  side_outward_facet_normal.assign(nsides, JaliGeometry::Point(space_dim_));
+  side_mid_facet_normal.assign(nsides, JaliGeometry::Point(space_dim_));
+
+  std::vector<Geometry_scratch> scratch(num_threads());
+
+  Jali::parallel_for(nsides, [&](int sbegin, int send, int ithread) {
+      for (int s = sbegin; s < send; s++) {
+        if (entity_get_type(Entity_kind::SIDE, s) ==
+            Entity_type::BOUNDARY_GHOST) {
+          side_volumes[s] = 0.0;
+          side_outward_facet_normal[s].set(0.0);
+          side_mid_facet_normal[s].set(0.0);
+        } else {
+          compute_side_geometry(s, &(side_volumes[s]),
+                                &(side_outward_facet_normal[s]),
+                                &(side_mid_facet_normal[s]),
+                                &(scratch[ithread]));
+        }
+      }
+    });
 
+  cache_used(Mesh_cache::SIDE_GEOMETRY);
   side_geometry_precomputed = true;
+  JALI_COUNT_BYTES("Mesh::compute_side_geometric_quantities",
+                   memory_bytes(side_volumes, side_outward_facet_normal,
+                                side_mid_facet_normal));
+
   return 1;
 }
 
 int Mesh::compute_corner_geometric_quantities() const {
-  corner_volumes.resize(num_corners());
-  for (auto const & cn : corners())
-    if (entity_get_type(Entity_kind::CORNER, cn) == Entity_type::BOUNDARY_GHOST)
-      corner_volumes[cn] = 0.0;
-    else
-      compute_corner_geometry(cn, &(corner_volumes[cn]));
+  JALI_TIME_SCOPE("Mesh::compute_corner_geometric_quantities");
+
+  int ncorners = num_corners();
+  corner_volumes.resize(ncorners);
+  Jali::parallel_for(ncorners, [&](int cnbegin, int cnend, int ithread) {
+      for (int cn = cnbegin; cn < cnend; cn++)
+        if (entity_get_type(Entity_kind::CORNER, cn) ==
+            Entity_type::BOUNDARY_GHOST)
+          corner_volumes[cn] = 0.0;
+        else
+          compute_corner_geometry(cn, &(corner_volumes[cn]));
+    });
+  cache_used(Mesh_cache::CORNER_GEOMETRY);
   corner_geometry_precomputed = true;
+  JALI_COUNT_BYTES("Mesh::compute_corner_geometric_quantities",
+                   memory_bytes(corner_volumes));
+
   return 1;
 }
 
+
+void Mesh::get_node_coordinates(Entity_ID_View const& nodeids,
+                                std::vector<JaliGeometry::Point> *coords)
+    const {
+  coords->resize(nodeids.size());
+  for (std::size_t i = 0; i < nodeids.size(); i++)
+    node_get_point(nodeids[i], &((*coords)[i]));
+}
+
+
+// Faces of a cell and the directions in which the cell uses them
+
+void Mesh::cell_faces_for_geometry(const Entity_ID cellid,
+                                   Geometry_scratch *sc,
+                                   Entity_ID_View *faceids,
+                                   Dir_View *face_dirs) const {
+  if (!implicit_topology_) {
+    *faceids = cell_get_faces_view(cellid);
+    *face_dirs = cell_get_face_dirs_view(cellid);
+    return;
+  }
+  cell_get_faces_and_dirs_internal(cellid, &sc->ids, &sc->dirs, false);
+  *faceids = sc->ids;
+  *face_dirs = sc->dirs;
+}
+
+
+// Cells of a face and the directions in which they use the face
+
+void Mesh::face_cells_for_geometry(const Entity_ID faceid,
+                                   Geometry_scratch *sc,
+                                   Entity_ID_View *cellids,
+                                   Dir_View *cell_dirs) const {
+  if (!implicit_topology_) {
+    *cellids = face_get_cells_view(faceid);
+    *cell_dirs = face_get_cell_dirs_view(faceid);
+    return;
+  }
+  face_get_cells_internal(faceid, Entity_type::ALL, &sc->ids);
+  sc->dirs.assign(sc->ids.size(), 0);
+  for (std::size_t i = 0; i < sc->ids.size(); i++) {
+    cell_get_faces_and_dirs_internal(sc->ids[i], &sc->ids3, &sc->dirs2,
+                                     false);
+    for (std::size_t j = 0; j < sc->ids3.size(); j++)
+      if (sc->ids3[j] == faceid) sc->dirs[i] = sc->dirs2[j];
+  }
+  *cellids = sc->ids;
+  *cell_dirs = sc->dirs;
+}
+
+
 int Mesh::compute_cell_geometry(const Entity_ID cellid, double *volume,
-                                JaliGeometry::Point *centroid) const {
+                                JaliGeometry::Point *centroid,
+                                Geometry_scratch *scratch) const {
+  Geometry_scratch local_scratch;
+  Geometry_scratch& sc = scratch ? *scratch : local_scratch;
+
   if (manifold_dim_ == 3) {
 
     // 3D Elements with possibly curved faces
@@ -1158,19 +2903,22 @@ int Mesh::compute_cell_geometry(const Entity_ID cellid, double *volume,
     // without (but we have yet to put in the code for the standard
     // node ordering and computation for these special elements)
 
-    Entity_ID_List cfaces;
-    std::vector<unsigned int> nfnodes;
-    std::vector<dir_t> fdirs;
-    std::vector<JaliGeometry::Point> ccoords, cfcoords, fcoords;
-
-    cell_get_faces_and_dirs(cellid, &cfaces, &fdirs);
+    Entity_ID_View cfaces;
+    Dir_View fdirs;
+    cell_faces_for_geometry(cellid, &sc, &cfaces, &fdirs);
+    std::vector<unsigned int>& nfnodes = sc.nfnodes;
+    std::vector<JaliGeometry::Point>& ccoords = sc.coords;
+    std::vector<JaliGeometry::Point>& cfcoords = sc.coords2;
+    std::vector<JaliGeometry::Point>& fcoords = sc.coords3;
 
     int nf = cfaces.size();
     nfnodes.resize(nf);
+    cfcoords.clear();
 
     for (int j = 0; j < nf; j++) {
 
-      face_get_coordinates(cfaces[j], &fcoords);
+      get_node_coordinates(face_nodes_for_geometry(cfaces[j], &sc.ids2),
+                           &fcoords);
       nfnodes[j] = fcoords.size();
 
       if (fdirs[j] == 1) {
@@ -1182,15 +2930,15 @@ int Mesh::compute_cell_geometry(const Entity_ID cellid, double *volume,
       }
     }
 
-    cell_get_coordinates(cellid, &ccoords);
+    get_node_coordinates(cell_nodes_for_geometry(cellid, &sc.ids2), &ccoords);
 
     JaliGeometry::polyhed_get_vol_centroid(ccoords, nf, nfnodes, cfcoords,
                                            volume, centroid);
     return 1;
   } else if (manifold_dim_ == 2) {
-    std::vector<JaliGeometry::Point> ccoords;
+    std::vector<JaliGeometry::Point>& ccoords = sc.coords;
 
-    cell_get_coordinates(cellid, &ccoords);
+    get_node_coordinates(cell_nodes_for_geometry(cellid, &sc.ids), &ccoords);
 
     JaliGeometry::Point normal(space_dim_);
 
@@ -1199,9 +2947,9 @@ int Mesh::compute_cell_geometry(const Entity_ID cellid, double *volume,
 
     return 1;
   } else if (manifold_dim_ == 1) {
-    std::vector<JaliGeometry::Point> ccoords;
+    std::vector<JaliGeometry::Point>& ccoords = sc.coords;
 
-    cell_get_coordinates(cellid, &ccoords);
+    get_node_coordinates(cell_nodes_for_geometry(cellid, &sc.ids), &ccoords);
 
     JaliGeometry::segment_get_vol_centroid(ccoords, geomtype,
                                            volume, centroid);
@@ -1215,12 +2963,23 @@ int Mesh::compute_cell_geometry(const Entity_ID cellid, double *volume,
 int Mesh::compute_face_geometry(const Entity_ID faceid, double *area,
                                 JaliGeometry::Point *centroid,
                                 JaliGeometry::Point *normal0,
-                                JaliGeometry::Point *normal1) const {
-  JaliGeometry::Point_List fcoords;
+                                JaliGeometry::Point *normal1,
+                                Geometry_scratch *scratch) const {
+  Geometry_scratch local_scratch;
+  Geometry_scratch& sc = scratch ? *scratch : local_scratch;
+  JaliGeometry::Point_List& fcoords = sc.coords;
 
   (*normal0).set(0.0L);
   (*normal1).set(0.0L);
 
+  get_node_coordinates(face_nodes_for_geometry(faceid, &sc.ids2), &fcoords);
+
+  // Cells of the face and the directions in which they use the face
+
+  Entity_ID_View cellids;
+  Dir_View celldirs;
+  face_cells_for_geometry(faceid, &sc, &cellids, &celldirs);
+
   if (manifold_dim_ == 3) {
 
     // 3D Elements with possibly curved faces
@@ -1228,34 +2987,12 @@ int Mesh::compute_face_geometry(const Entity_ID faceid, double *area,
     // and send it into the polyhedron volume and centroid
     // calculation routine
 
-    face_get_coordinates(faceid, &fcoords);
-
     JaliGeometry::Point normal(3);
     JaliGeometry::polygon_get_area_centroid_normal(fcoords, area, centroid,
                                                    &normal);
 
-    Entity_ID_List cellids;
-    face_get_cells(faceid, Entity_type::ALL, &cellids);
-
     for (int i = 0; i < cellids.size(); i++) {
-      Entity_ID_List cellfaceids;
-      std::vector<dir_t> cellfacedirs;
-      dir_t dir = 1;
-
-      cell_get_faces_and_dirs(cellids[i], &cellfaceids, &cellfacedirs);
-
-      bool found = false;
-      for (int j = 0; j < cellfaceids.size(); j++) {
-        if (cellfaceids[j] == faceid) {
-          found = true;
-          dir = cellfacedirs[j];
-          break;
-        }
-      }
-
-      assert(found);
-
-      if (dir == 1)
+      if (celldirs[i] == 1)
         *normal0 = normal;
       else
         *normal1 = -normal;
@@ -1266,8 +3003,6 @@ int Mesh::compute_face_geometry(const Entity_ID faceid, double *area,
 
     if (space_dim_ == 2) {   // 2D mesh
 
-      face_get_coordinates(faceid, &fcoords);
-
       JaliGeometry::Point evec = fcoords[1]-fcoords[0];
       *area = sqrt(evec*evec);
 
@@ -1275,28 +3010,8 @@ int Mesh::compute_face_geometry(const Entity_ID faceid, double *area,
 
       JaliGeometry::Point normal(evec[1], -evec[0]);
 
-      Entity_ID_List cellids;
-      face_get_cells(faceid, Entity_type::ALL, &cellids);
-
       for (int i = 0; i < cellids.size(); i++) {
-        Entity_ID_List cellfaceids;
-        std::vector<dir_t> cellfacedirs;
-        dir_t dir = 1;
-
-        cell_get_faces_and_dirs(cellids[i], &cellfaceids, &cellfacedirs);
-
-        bool found = false;
-        for (int j = 0; j < cellfaceids.size(); j++) {
-          if (cellfaceids[j] == faceid) {
-            found = true;
-            dir = cellfacedirs[j];
-            break;
-          }
-        }
-
-        assert(found);
-
-        if (dir == 1)
+        if (celldirs[i] == 1)
           *normal0 = normal;
         else
           *normal1 = -normal;
@@ -1307,37 +3022,19 @@ int Mesh::compute_face_geometry(const Entity_ID faceid, double *area,
       // edge normals are ambiguous for surface mesh
       // So we won't compute them
 
-      face_get_coordinates(faceid, &fcoords);
-
       JaliGeometry::Point evec = fcoords[1]-fcoords[0];
       *area = sqrt(evec*evec);
 
       *centroid = 0.5*(fcoords[0]+fcoords[1]);
 
-      Entity_ID_List cellids;
-      face_get_cells(faceid, Entity_type::ALL, &cellids);
+      std::vector<JaliGeometry::Point>& ccoords = sc.coords2;
 
       for (int i = 0; i < cellids.size(); i++) {
-        Entity_ID_List cellfaceids;
-        std::vector<dir_t> cellfacedirs;
-        dir_t dir = 1;
-
-        cell_get_faces_and_dirs(cellids[i], &cellfaceids, &cellfacedirs);
-
-        bool found = false;
-        for (int j = 0; j < cellfaceids.size(); j++) {
-          if (cellfaceids[j] == faceid) {
-            found = true;
-            dir = cellfacedirs[j];
-            break;
-          }
-        }
-
-        assert(found);
+        dir_t dir = celldirs[i];
 
         JaliGeometry::Point cellcen;
-        std::vector<JaliGeometry::Point> ccoords;
-        cell_get_coordinates(cellids[i], &ccoords);
+        get_node_coordinates(cell_nodes_for_geometry(cellids[i], &sc.ids2),
+                             &ccoords);
 
         for (int j = 0; j < ccoords.size(); j++)
           cellcen += ccoords[j];
@@ -1362,34 +3059,12 @@ int Mesh::compute_face_geometry(const Entity_ID faceid, double *area,
     }
 
   } else if (manifold_dim_ == 1) {
-    face_get_coordinates(faceid, &fcoords);
-
     JaliGeometry::face1d_get_area(fcoords, geomtype, area);
     JaliGeometry::Point normal(space_dim_);
     normal.set(*area);
 
-    Entity_ID_List cellids;
-    face_get_cells(faceid, Entity_type::ALL, &cellids);
-
     for (int i = 0; i < cellids.size(); i++) {
-      Entity_ID_List cellfaceids;
-      std::vector<dir_t> cellfacedirs;
-      dir_t dir = 1;
-
-      cell_get_faces_and_dirs(cellids[i], &cellfaceids, &cellfacedirs);
-
-      bool found = false;
-      for (int j = 0; j < cellfaceids.size(); j++) {
-        if (cellfaceids[j] == faceid) {
-          found = true;
-          dir = cellfacedirs[j];
-          break;
-        }
-      }
-
-      assert(found);
-
-      if (dir == 1)
+      if (celldirs[i] == 1)
         *normal0 = normal;
       else
         *normal1 = -normal;
@@ -1413,8 +3088,8 @@ int Mesh::compute_edge_geometry(const Entity_ID edgeid, double *edge_length,
   edge_get_nodes(edgeid, &node0, &node1);
 
   JaliGeometry::Point point0, point1;
-  node_get_coordinates(node0, &point0);
-  node_get_coordinates(node1, &point1);
+  node_get_point(node0, &point0);
+  node_get_point(node1, &point1);
 
   *edge_vector = point1 - point0;
   *edge_length = norm(*edge_vector);
@@ -1428,9 +3103,13 @@ int Mesh::compute_edge_geometry(const Entity_ID edgeid, double *edge_length,
 void Mesh::compute_side_geometry(Entity_ID const sideid,
                                  double *side_volume,
                                  JaliGeometry::Point *outward_facet_normal,
-                                 JaliGeometry::Point *mid_facet_normal) const {
+                                 JaliGeometry::Point *mid_facet_normal,
+                                 Geometry_scratch *scratch) const {
+  Geometry_scratch local_scratch;
+  Geometry_scratch& sc = scratch ? *scratch : local_scratch;
+  std::vector<JaliGeometry::Point>& scoords = sc.coords;
+
   if (manifold_dim_ == 3) {
-    std::vector<JaliGeometry::Point> scoords;
 
     // Get vertex coordinates of side
     //
@@ -1472,8 +3151,6 @@ void Mesh::compute_side_geometry(Entity_ID const sideid,
     *mid_facet_normal = 0.5*(vec3^vec4);
 
   } else if (manifold_dim_ == 2) {
-    std::vector<JaliGeometry::Point> scoords;
-    
     // Get vertex coordinates of side
     //
     // These are always - node coordinate, edge/face center, cell center
@@ -1502,8 +3179,6 @@ void Mesh::compute_side_geometry(Entity_ID const sideid,
     *mid_facet_normal = JaliGeometry::Point(vec1[1], -vec1[0]);
 
   } else if (manifold_dim_ == 1) {
-    std::vector<JaliGeometry::Point> scoords;
-
     // Get vertex coordinates of side
     //
     // These are always - node coordinate and cell center
@@ -1532,8 +3207,7 @@ void Mesh::compute_side_geometry(Entity_ID const sideid,
     Entity_ID nodeid = side_node_ids[sideid][0];
     Entity_ID cellid = side_cell_id[sideid];
 
-    Entity_ID_List cnodes;
-    cell_get_nodes(cellid, &cnodes);
+    Entity_ID_View cnodes = cell_get_nodes_view(cellid);
     if (nodeid == cnodes[1]) {  // have to reverse sign of volume and normal
       *side_volume = -(*side_volume);
       *outward_facet_normal = -(*outward_facet_normal);
@@ -1547,11 +3221,10 @@ void Mesh::compute_side_geometry(Entity_ID const sideid,
 
 void Mesh::compute_corner_geometry(const Entity_ID cornerid,
                                    double *volume) const {
-  Entity_ID_List cwedges;
-  corner_get_wedges(cornerid, &cwedges);
+  Entity_ID_View cwedges = corner_get_wedges_view(cornerid);
 
   *volume = 0;
-  Entity_ID_List::iterator itw = cwedges.begin();
+  Entity_ID_View::iterator itw = cwedges.begin();
   while (itw != cwedges.end()) {
     Entity_ID w = *itw;
     *volume += wedge_volume(w);
@@ -1562,6 +3235,9 @@ void Mesh::compute_corner_geometry(const Entity_ID cornerid,
 // Volume/Area of cell
 
 double Mesh::cell_volume(const Entity_ID cellid, const bool recompute) const {
+  if (!cell_geometry_precomputed) rebuild_cache(Mesh_cache::CELL_GEOMETRY);
+  cache_accessed(Mesh_cache::CELL_GEOMETRY);
+
   if (recompute) {
     double volume;
     JaliGeometry::Point centroid(space_dim_);
@@ -1576,7 +3252,8 @@ double Mesh::cell_volume(const Entity_ID cellid, const bool recompute) const {
 
 double Mesh::face_area(const Entity_ID faceid, const bool recompute) const {
   assert(faces_requested);
-  assert(face_geometry_precomputed);
+  if (!face_geometry_precomputed) rebuild_cache(Mesh_cache::FACE_GEOMETRY);
+  cache_accessed(Mesh_cache::FACE_GEOMETRY);
 
   if (recompute) {
     double area;
@@ -1593,7 +3270,8 @@ double Mesh::face_area(const Entity_ID faceid, const bool recompute) const {
 
 double Mesh::edge_length(const Entity_ID edgeid, const bool recompute) const {
   assert(edges_requested);
-  assert(edge_geometry_precomputed);
+  if (!edge_geometry_precomputed) rebuild_cache(Mesh_cache::EDGE_GEOMETRY);
+  cache_accessed(Mesh_cache::EDGE_GEOMETRY);
 
   if (recompute) {
     double length;
@@ -1609,7 +3287,8 @@ double Mesh::edge_length(const Entity_ID edgeid, const bool recompute) const {
 
 double Mesh::side_volume(const Entity_ID sideid, const bool recompute) const {
   assert(sides_requested);
-  assert(side_geometry_precomputed);
+  if (!side_geometry_precomputed) rebuild_cache(Mesh_cache::SIDE_GEOMETRY);
+  cache_accessed(Mesh_cache::SIDE_GEOMETRY);
 
   if (recompute) {
     double side_volume;
@@ -1626,7 +3305,8 @@ double Mesh::side_volume(const Entity_ID sideid, const bool recompute) const {
 
 double Mesh::wedge_volume(const Entity_ID wedgeid, const bool recompute) const {
   assert(wedges_requested);
-  assert(side_geometry_precomputed);
+  if (!side_geometry_precomputed) rebuild_cache(Mesh_cache::SIDE_GEOMETRY);
+  cache_accessed(Mesh_cache::SIDE_GEOMETRY);
 
   Entity_ID sideid = static_cast<Entity_ID>(wedgeid/2);
 
@@ -1646,7 +3326,8 @@ double Mesh::wedge_volume(const Entity_ID wedgeid, const bool recompute) const {
 double Mesh::corner_volume(const Entity_ID cornerid,
                            const bool recompute) const {
   assert(corners_requested);
-  assert(corner_geometry_precomputed);
+  if (!corner_geometry_precomputed) rebuild_cache(Mesh_cache::CORNER_GEOMETRY);
+  cache_accessed(Mesh_cache::CORNER_GEOMETRY);
 
   if (recompute) {
     double volume;
@@ -1661,7 +3342,8 @@ double Mesh::corner_volume(const Entity_ID cornerid,
 
 JaliGeometry::Point Mesh::cell_centroid(const Entity_ID cellid,
                                         const bool recompute) const {
-  assert(cell_geometry_precomputed);
+  if (!cell_geometry_precomputed) rebuild_cache(Mesh_cache::CELL_GEOMETRY);
+  cache_accessed(Mesh_cache::CELL_GEOMETRY);
 
   if (recompute) {
     double volume;
@@ -1678,7 +3360,8 @@ JaliGeometry::Point Mesh::cell_centroid(const Entity_ID cellid,
 JaliGeometry::Point Mesh::face_centroid(const Entity_ID faceid,
                                         const bool recompute) const {
   assert(faces_requested);
-  assert(face_geometry_precomputed);
+  if (!face_geometry_precomputed) rebuild_cache(Mesh_cache::FACE_GEOMETRY);
+  cache_accessed(Mesh_cache::FACE_GEOMETRY);
 
   if (recompute) {
     double area;
@@ -1715,7 +3398,8 @@ JaliGeometry::Point Mesh::face_normal(const Entity_ID faceid,
                                       const Entity_ID cellid,
                                       int *orientation) const {
   assert(faces_requested);
-  assert(face_geometry_precomputed);
+  if (!face_geometry_precomputed) rebuild_cache(Mesh_cache::FACE_GEOMETRY);
+  cache_accessed(Mesh_cache::FACE_GEOMETRY);
 
   JaliGeometry::Point normal0(space_dim_);
   JaliGeometry::Point normal1(space_dim_);
@@ -1746,22 +3430,9 @@ JaliGeometry::Point Mesh::face_normal(const Entity_ID faceid,
       return -normal1;
     }
   } else {
-    Entity_ID_List faceids;
-    std::vector<dir_t> face_dirs;
-
-    cell_get_faces_and_dirs(cellid, &faceids, &face_dirs);
-
-    int nf = faceids.size();
-    bool found = false;
-    dir_t dir = 1;
-    for (int i = 0; i < nf; i++)
-      if (faceids[i] == faceid) {
-        dir = face_dirs[i];
-        found = true;
-        break;
-      }
+    dir_t dir = face_get_dir_in_cell(faceid, cellid);
 
-    assert(found);
+    assert(dir != 0);
 
     if (orientation) *orientation = dir;
     if (dir == 1) {
@@ -1784,7 +3455,8 @@ JaliGeometry::Point Mesh::edge_vector(const Entity_ID edgeid,
                                       const Entity_ID pointid,
                                       int *orientation) const {
   assert(edges_requested);
-  assert(edge_geometry_precomputed);
+  if (!edge_geometry_precomputed) rebuild_cache(Mesh_cache::EDGE_GEOMETRY);
+  cache_accessed(Mesh_cache::EDGE_GEOMETRY);
 
   JaliGeometry::Point evector(space_dim_), ecenter(space_dim_);
   JaliGeometry::Point& evector_ref = evector;  // to avoid extra copying
@@ -1822,11 +3494,12 @@ JaliGeometry::Point Mesh::edge_centroid(const Entity_ID edgeid) const {
   JaliGeometry::Point xyz0, xyz1;
 
   assert(edges_requested);
-  assert(edge_geometry_precomputed);
+  if (!edge_geometry_precomputed) rebuild_cache(Mesh_cache::EDGE_GEOMETRY);
+  cache_accessed(Mesh_cache::EDGE_GEOMETRY);
 
   edge_get_nodes(edgeid, &p0, &p1);
-  node_get_coordinates(p0, &xyz0);
-  node_get_coordinates(p1, &xyz1);
+  node_get_point(p0, &xyz0);
+  node_get_point(p1, &xyz1);
   return (xyz0+xyz1)/2.0;
 }
 
@@ -1854,10 +3527,10 @@ void Mesh::side_get_coordinates(const Entity_ID sideid,
   if (manifold_dim_ == 3) {
     scoords->resize(4);  // sides are tets in 3D cells
     Entity_ID n0 = side_get_node(sideid, 0);
-    node_get_coordinates(n0, &((*scoords)[0]));
+    node_get_point(n0, &((*scoords)[0]));
 
     Entity_ID n1 = side_get_node(sideid, 1);
-    node_get_coordinates(n1, &((*scoords)[1]));
+    node_get_point(n1, &((*scoords)[1]));
 
     Entity_ID f = side_get_face(sideid);
     (*scoords)[2] = face_centroid(f);
@@ -1869,10 +3542,10 @@ void Mesh::side_get_coordinates(const Entity_ID sideid,
 
     scoords->resize(3);  // sides are tris in 2D cells
     Entity_ID n0 = side_get_node(sideid, 0);
-    node_get_coordinates(n0, &((*scoords)[0]));
+    node_get_point(n0, &((*scoords)[0]));
 
     Entity_ID n1 = side_get_node(sideid, 1);
-    node_get_coordinates(n1, &((*scoords)[1]));
+    node_get_point(n1, &((*scoords)[1]));
 
     Entity_ID c = side_get_cell(sideid);
     (*scoords)[2] = cell_centroid(c);
@@ -1881,7 +3554,7 @@ void Mesh::side_get_coordinates(const Entity_ID sideid,
 
     scoords->resize(2);  // sides are segments in 1D cells
     Entity_ID n0 = side_get_node(sideid, 0);
-    node_get_coordinates(n0, &((*scoords)[0]));
+    node_get_point(n0, &((*scoords)[0]));
 
     Entity_ID c = side_get_cell(sideid);
     (*scoords)[1] = cell_centroid(c);
@@ -1923,7 +3596,7 @@ void Mesh::wedge_get_coordinates(const Entity_ID wedgeid,
   wcoords->resize(np);
 
   Entity_ID n = wedge_get_node(wedgeid);
-  node_get_coordinates(n, &((*wcoords)[0]));
+  node_get_point(n, &((*wcoords)[0]));
 
   if (manifold_dim_ == 3) {
     Entity_ID e = wedge_get_edge(wedgeid);
@@ -1964,7 +3637,8 @@ void Mesh::wedge_get_coordinates(const Entity_ID wedgeid,
 JaliGeometry::Point Mesh::side_facet_normal(const int sideid,
                                             const bool recompute) const {
   assert(sides_requested);
-  assert(side_geometry_precomputed);
+  if (!side_geometry_precomputed) rebuild_cache(Mesh_cache::SIDE_GEOMETRY);
+  cache_accessed(Mesh_cache::SIDE_GEOMETRY);
 
   JaliGeometry::Point normal(space_dim_);
 
@@ -1996,7 +3670,8 @@ JaliGeometry::Point Mesh::wedge_facet_normal(const int wedgeid,
                                              const unsigned int which_facet,
                                              const bool recompute) const {
   assert(wedges_requested);
-  assert(side_geometry_precomputed);
+  if (!side_geometry_precomputed) rebuild_cache(Mesh_cache::SIDE_GEOMETRY);
+  cache_accessed(Mesh_cache::SIDE_GEOMETRY);
   assert(which_facet == 0 || which_facet == 1);
 
   Entity_ID sideid = static_cast<Entity_ID>(wedgeid/2);
@@ -2031,7 +3706,8 @@ Mesh::corner_get_facetization(const Entity_ID cornerid,
                               std::vector<std::array<Entity_ID, 3>>
                               *facetpoints) const {
   assert(corners_requested);
-  assert(corner_geometry_precomputed);
+  if (!corner_geometry_precomputed) rebuild_cache(Mesh_cache::CORNER_GEOMETRY);
+  cache_accessed(Mesh_cache::CORNER_GEOMETRY);
 
   Entity_ID_List cwedges;
   corner_get_wedges(cornerid, &cwedges);
@@ -2048,7 +3724,7 @@ Mesh::corner_get_facetization(const Entity_ID cornerid,
   std::vector< std::pair<Entity_ID, Entity_kind> > point_entity_list;
 
   int n = corner_get_node(cornerid);
-  node_get_coordinates(n, &p);
+  node_get_point(n, &p);
   pointcoords->push_back(p);        // emplace_back when we switch to C++11
   point_entity_list.push_back(std::pair<Entity_ID, Entity_kind>(n, Entity_kind::NODE));
 
@@ -2132,7 +3808,8 @@ Mesh::corner_get_facetization(const Entity_ID cornerid,
                               std::vector< std::array<Entity_ID, 2> >
                               *facetpoints) const {
   assert(corners_requested);
-  assert(corner_info_cached);
+  if (!corner_info_cached) cache_corner_info();
+  cache_accessed(Mesh_cache::CORNER);
 
   Entity_ID_List cwedges;
   corner_get_wedges(cornerid, &cwedges);
@@ -2147,7 +3824,7 @@ Mesh::corner_get_facetization(const Entity_ID cornerid,
   JaliGeometry::Point p(space_dim_);
 
   int n = corner_get_node(cornerid);
-  node_get_coordinates(n, &p);
+  node_get_point(n, &p);
   pointcoords->push_back(p);        // emplace_back when we switch to C++11
 
   int c = corner_get_cell(cornerid);
@@ -2187,7 +3864,8 @@ Mesh::corner_get_facetization(const Entity_ID cornerid,
                               std::vector< std::array<Entity_ID, 1> >
                               *facetpoints) const {
   assert(corners_requested);
-  assert(corner_info_cached);
+  if (!corner_info_cached) cache_corner_info();
+  cache_accessed(Mesh_cache::CORNER);
 
   // corner and wedge are the same in 1d
   Entity_ID_List cwedges;
@@ -2208,7 +3886,8 @@ Mesh::corner_get_coordinates(const Entity_ID cornerid,
                              std::vector<JaliGeometry::Point>
                              *pointcoords) const {
   assert(corners_requested);
-  assert(corner_info_cached);
+  if (!corner_info_cached) cache_corner_info();
+  cache_accessed(Mesh_cache::CORNER);
 
   Entity_ID_List cwedges;
   corner_get_wedges(cornerid, &cwedges);
@@ -2256,7 +3935,7 @@ Mesh::corner_get_coordinates(const Entity_ID cornerid,
     std::vector< std::pair<Entity_ID, Entity_kind> > point_entity_list;
 
     int n = corner_get_node(cornerid);
-    node_get_coordinates(n, &p);
+    node_get_point(n, &p);
     pointcoords->push_back(p);        // emplace_back when we switch to C++11
     point_entity_list.push_back(std::pair<Entity_ID, Entity_kind>(n, Entity_kind::NODE));
 
@@ -2324,6 +4003,8 @@ Entity_type Mesh::entity_get_type(const Entity_kind kind,
       break;
     case Entity_kind::SIDE:
       if (sides_requested) {
+        if (!side_info_cached) cache_side_info();
+        cache_accessed(Mesh_cache::SIDE);
         Entity_ID cellid = side_cell_id[entid];
         return cell_type[cellid];
       } else
@@ -2331,6 +4012,8 @@ Entity_type Mesh::entity_get_type(const Entity_kind kind,
       break;
     case Entity_kind::WEDGE:
       if (wedges_requested) {
+        if (!side_info_cached) cache_side_info();
+        cache_accessed(Mesh_cache::SIDE);
         Entity_ID sideid = static_cast<int>(entid/2);
         Entity_ID cellid = side_cell_id[sideid];
         return cell_type[cellid];
@@ -2339,6 +4022,8 @@ Entity_type Mesh::entity_get_type(const Entity_kind kind,
       break;
     case Entity_kind::CORNER:
       if (corners_requested) {
+        if (!corner_info_cached) cache_corner_info();
+        cache_accessed(Mesh_cache::CORNER);
         Entity_ID wedgeid = corner_wedge_ids[entid][0];
         Entity_ID sideid = static_cast<int>(wedgeid/2);
         Entity_ID cellid = side_cell_id[sideid];
@@ -2370,6 +4055,8 @@ void Mesh::init_sets_from_geometric_model() {
 void Mesh::init_sets_from_geometric_model(
     std::map<std::string, std::vector<Entity_kind>> region_to_entity_kinds_map
                                           ) {
+  JALI_TIME_SCOPE("Mesh::init_sets_from_geometric_model");
+
   if (!geometric_model_) return;
 
   std::map<std::string, Entity_kind> str_to_kind = {
@@ -2668,6 +4355,13 @@ std::shared_ptr<MeshSet> Mesh::build_set_from_region(const std::string setname,
     Exceptions::Jali_throw(mesg);
   }
 
+  // Corners of box regions - only entities in or near the box are
+  // tested using the spatial index
+
+  JaliGeometry::Point box_lo(spacedim), box_hi(spacedim);
+  if (region->type() == JaliGeometry::Region_type::BOX)
+    ((JaliGeometry::BoxRegionPtr)region)->corners(&box_lo, &box_hi);
+
   // Create entity set based on the region defintion
   std::shared_ptr<MeshSet> mset;
   switch (kind) {
@@ -2675,8 +4369,28 @@ std::shared_ptr<MeshSet> Mesh::build_set_from_region(const std::string setname,
 
       Entity_ID_List owned_cells, ghost_cells;
 
-      if (region->type() == JaliGeometry::Region_type::BOX ||
-          region->type() == JaliGeometry::Region_type::COLORFUNCTION) {
+      if (region->type() == JaliGeometry::Region_type::BOX) {
+
+        // Only cells whose bounding boxes intersect the region can
+        // have their centroid in it
+
+        Entity_ID_List cells1;
+        spatial_index()->cells_in_box(box_lo, box_hi, &cells1);
+
+        for (auto const& icell : cells1) {
+          if (region->inside(cell_centroid(icell))) {
+            Entity_type ctype = entity_get_type(Entity_kind::CELL, icell);
+            if (ctype == Entity_type::PARALLEL_OWNED)
+              owned_cells.push_back(icell);
+            else if (ctype == Entity_type::PARALLEL_GHOST)
+              ghost_cells.push_back(icell);
+          }
+        }
+
+        mset = make_meshset(setname, *this, Entity_kind::CELL,
+                            owned_cells, ghost_cells, with_reverse_map);
+
+      } else if (region->type() == JaliGeometry::Region_type::COLORFUNCTION) {
 
         int ncell_owned = Mesh::num_entities(Entity_kind::CELL,
                                              Entity_type::PARALLEL_OWNED);
@@ -2694,43 +4408,19 @@ std::shared_ptr<MeshSet> Mesh::build_set_from_region(const std::string setname,
                             owned_cells, ghost_cells, with_reverse_map);
 
       } else if (region->type() == JaliGeometry::Region_type::POINT) {
-        JaliGeometry::Point vpnt(spacedim);
         JaliGeometry::Point rgnpnt(spacedim);
 
         rgnpnt = ((JaliGeometry::PointRegionPtr)region)->point();
 
-        int nnode = Mesh::num_entities(Entity_kind::NODE,
-                                       Entity_type::ALL);
-
-        double mindist2 = 1.e+16;
-        int minnode = -1;
-        for (int inode = 0; inode < nnode; inode++) {
-          node_get_coordinates(inode, &vpnt);
-
-          double dist2 = (vpnt-rgnpnt)*(vpnt-rgnpnt);
-          if (dist2 < mindist2) {
-            mindist2 = dist2;
-            minnode = inode;
-            if (mindist2 <= 1.0e-32)
-              break;
-          }
-        }
-
         Entity_ID_List cells1;
-        node_get_cells(minnode, Entity_type::ALL, &cells1);
-
-        int ncells = cells1.size();
-        for (int ic = 0; ic < ncells; ic++) {
-          Entity_ID icell = cells1[ic];
+        spatial_index()->cells_containing(rgnpnt, &cells1);
 
-          // Check if point is contained in cell
-          if (point_in_cell(rgnpnt, icell)) {
-            Entity_type ctype = entity_get_type(Entity_kind::CELL, icell);
-            if (ctype == Entity_type::PARALLEL_OWNED)
-              owned_cells.push_back(icell);
-            else if (ctype == Entity_type::PARALLEL_GHOST)
-              ghost_cells.push_back(icell);
-          }
+        for (auto const& icell : cells1) {
+          Entity_type ctype = entity_get_type(Entity_kind::CELL, icell);
+          if (ctype == Entity_type::PARALLEL_OWNED)
+            owned_cells.push_back(icell);
+          else if (ctype == Entity_type::PARALLEL_GHOST)
+            ghost_cells.push_back(icell);
         }
 
         mset = make_meshset(setname, *this, Entity_kind::CELL,
@@ -2813,11 +4503,19 @@ std::shared_ptr<MeshSet> Mesh::build_set_from_region(const std::string setname,
 
       if (region->type() == JaliGeometry::Region_type::BOX)  {
 
-        int nface = Mesh::num_entities(Entity_kind::FACE,
-                                       Entity_type::ALL);
+        // A face centroid lies in the bounding box of the cells of
+        // the face so only faces of cells whose bounding boxes
+        // intersect the region need to be tested
 
-        for (int iface = 0; iface < nface; iface++) {
-          JaliGeometry::Point fcen = face_centroid(iface);
+        Entity_ID_List cells1, faces1;
+        spatial_index()->cells_in_box(box_lo, box_hi, &cells1);
+        for (auto const& icell : cells1)
+          for (auto const& iface : cell_get_faces_view(icell))
+            faces1.push_back(iface);
+        std::sort(faces1.begin(), faces1.end());
+        faces1.erase(std::unique(faces1.begin(), faces1.end()), faces1.end());
+
+        for (auto const& iface : faces1) {
           if (region->inside(face_centroid(iface))) {
             Entity_type ftype = entity_get_type(Entity_kind::FACE, iface);
             if (ftype == Entity_type::PARALLEL_OWNED)
@@ -2897,10 +4595,28 @@ std::shared_ptr<MeshSet> Mesh::build_set_from_region(const std::string setname,
           region->type() == JaliGeometry::Region_type::POLYGON ||
           region->type() == JaliGeometry::Region_type::POINT) {
 
-        int nnode = Mesh::num_entities(Entity_kind::NODE,
-                                       Entity_type::ALL);
+        // Candidate nodes - for box and point regions only the nodes
+        // in a box around the region, enlarged by the tolerance of
+        // BoxRegion::inside
+
+        Entity_ID_List nodes1;
+        if (region->type() == JaliGeometry::Region_type::BOX ||
+            region->type() == JaliGeometry::Region_type::POINT) {
+          JaliGeometry::Point lo(spacedim), hi(spacedim);
+          if (region->type() == JaliGeometry::Region_type::POINT)
+            box_lo = box_hi = ((JaliGeometry::PointRegionPtr)region)->point();
+          for (int d = 0; d < spacedim; d++) {
+            lo[d] = std::min(box_lo[d], box_hi[d]) - 1.0e-08;
+            hi[d] = std::max(box_lo[d], box_hi[d]) + 1.0e-08;
+          }
+          spatial_index()->nodes_in_box(lo, hi, &nodes1);
+        } else {
+          nodes1.resize(Mesh::num_entities(Entity_kind::NODE,
+                                           Entity_type::ALL));
+          std::iota(nodes1.begin(), nodes1.end(), 0);
+        }
 
-        for (int inode = 0; inode < nnode; inode++) {
+        for (auto const& inode : nodes1) {
 
           JaliGeometry::Point vpnt(spacedim);
           node_get_coordinates(inode, &vpnt);
@@ -3078,6 +4794,32 @@ bool Mesh::point_in_cell(const JaliGeometry::Point &p,
 }
 
 
+// Lowest numbered cell containing the point
+
+Entity_ID Mesh::find_cell_containing(const JaliGeometry::Point &p) const {
+  return spatial_index()->find_cell_containing(p);
+}
+
+
+// Nodes within distance 'radius' of a point
+
+void Mesh::nodes_near(const JaliGeometry::Point &p, const double radius,
+                      Entity_ID_List *nodeids) const {
+  spatial_index()->nodes_near(p, radius, nodeids);
+}
+
+
+// Spatial search structures (built on first request)
+
+std::shared_ptr<MeshSpatialIndex const> Mesh::spatial_index() const {
+  std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+
+  if (!spatial_index_)
+    spatial_index_ = std::make_shared<MeshSpatialIndex>(*this);
+  return spatial_index_;
+}
+
+
 void
 Mesh::get_partitioning(int const num_parts,
                        Partitioner_type const partitioner,
@@ -3102,9 +4844,10 @@ Mesh::get_partitioning(int const num_parts,
 #else
     std::cerr << "Mesh::get_partitioning() - " <<
         "Preferred partitioner METIS not available. " <<
-        "Partitioning by entity IDs.\n";
+        "Using built-in RCB partitioner.\n";
 
-     get_partitioning_by_index_space(num_parts, partitions);
+    get_partitioning_by_geometry(num_parts, Partitioner_type::RCB,
+                                 partitions);
 
 #endif
   } else if ((partitioner == Partitioner_type::ZOLTAN_GRAPH ||
@@ -3127,11 +4870,17 @@ Mesh::get_partitioning(int const num_parts,
 
     std::cerr << "Mesh::get_partitioning() - " <<
         "Requested partitioner ZOLTAN not available. " <<
-        "Partitioning by entity IDs\n";
+        "Using built-in RCB partitioner.\n";
 
-    get_partitioning_by_index_space(num_parts, partitions);
+    get_partitioning_by_geometry(num_parts, Partitioner_type::RCB,
+                                 partitions);
 
 // #endif
+  } else if (partitioner == Partitioner_type::RCB ||
+             partitioner == Partitioner_type::HILBERT) {
+
+    get_partitioning_by_geometry(num_parts, partitioner, partitions);
+
   } else if (partitioner == Partitioner_type::BLOCK) {
 
     get_partitioning_by_blocks(num_parts, partitions);
@@ -3148,6 +4897,40 @@ Mesh::get_partitioning(int const num_parts,
 }
 
 
+void Mesh::get_partitioning_by_geometry(int const num_parts,
+                                        Partitioner_type const parttype,
+                                  std::vector<std::vector<int>> *partitions) {
+
+  int const ncells = num_cells<Entity_type::PARALLEL_OWNED>();
+  int const dim = space_dim_;
+
+  std::vector<double> coords(dim*ncells);
+  Jali::parallel_for(ncells, [&](int ibegin, int iend, int ithread) {
+      for (int c = ibegin; c < iend; c++) {
+        JaliGeometry::Point cen = cell_centroid(c);
+        for (int d = 0; d < dim; d++)
+          coords[dim*c+d] = cen[d];
+      }
+    });
+
+  double const * const weights =
+      (static_cast<int>(tile_cell_weights_.size()) == ncells) ?
+      tile_cell_weights_.data() : nullptr;
+
+  std::vector<int> part;
+  if (parttype == Partitioner_type::HILBERT)
+    sfc_partition(Entity_ordering::HILBERT, dim, ncells, coords.data(),
+                  weights, num_parts, &part);
+  else
+    rcb_partition(dim, ncells, coords.data(), weights, num_parts, &part);
+
+  for (auto& p : *partitions)
+    p.clear();
+  for (int c = 0; c < ncells; c++)
+    (*partitions)[part[c]].push_back(c);
+}
+
+
 void Mesh::get_partitioning_by_index_space(int const num_parts,
                                  std::vector<std::vector<int>> *partitions) {
         
@@ -54,13 +54,18 @@
 #include <memory>
 #include <vector>
 #include <array>
+#include <atomic>
+#include <mutex>
 #include <map>
 #include <string>
 #include <algorithm>
 #include <cassert>
 #include <typeinfo>
+#include <typeindex>
+#include <cstring>
 
 #include "MeshDefs.hh"
+#include "MeshCSR.hh"
 #include "Point.hh"
 #include "GeometricModel.hh"
 #include "Region.hh"
@@ -68,8 +73,12 @@
 #include "Geometry.hh"
 #include "MeshTile.hh"
 #include "MeshSet.hh"
+#include "MeshHalo.hh"
+#include "MeshSpatialIndex.hh"
+#include "MeshVTK.hh"
 
 #include "block_partition.hh"
+#include "ThreadPool.hh"
 
 #define JALI_CACHE_VARS 1  // Switch to 0 to turn caching off
 
@@ -177,8 +186,11 @@ class Mesh {
     partitioner_pref_(partitioner),
     cell2face_info_cached(false), face2cell_info_cached(false),
     cell2edge_info_cached(false), face2edge_info_cached(false),
+    edge2node_info_cached(false), cell2node_info_cached(false),
+    node2cell_info_cached(false), face2node_info_cached(false),
     side_info_cached(false), wedge_info_cached(false),
     corner_info_cached(false), type_info_cached(false),
+    node_coords_cached(false), node_coords_soa_cached(false),
     geometric_model_(NULL), comm(incomm),
     geomtype(geom_type) {
     
@@ -334,6 +346,13 @@ class Mesh {
   virtual
   Entity_ID GID(const Entity_ID lid, const Entity_kind kind) const = 0;
 
+  //! Communication plan for refreshing ghost entities of 'kind'
+  //! (NODE, EDGE, FACE or CELL) from their owners on other ranks. The
+  //! plan is built on first use, which is collective over the mesh
+  //! communicator, and then reused (see HaloUpdate)
+
+  std::shared_ptr<MeshHalo const> halo(Entity_kind const kind) const;
+
 
   //! List of references to mesh tiles (collections of mesh cells)
   // Don't want to make the vector contain const references to tiles
@@ -347,6 +366,73 @@ class Mesh {
 
   int num_tiles() const {return meshtiles.size();}
 
+  //! Discard the mesh tiles and partition the mesh into tiles again
+  //! (with the number of tiles and partitioner the mesh was created
+  //! with). cell_weights, if not empty, gives the cost of each
+  //! PARALLEL_OWNED cell; the RCB and HILBERT partitioners then make
+  //! tiles of about equal total cost instead of equal numbers of
+  //! cells. The weights are kept for later rebuilds (e.g. by
+  //! reorder_entities). Tile colorings are recomputed on next use
+
+  void rebuild_tiles(std::vector<double> const& cell_weights =
+                     std::vector<double>());
+
+  //! Apply kernel(tile, ithread) to every mesh tile using the on-node
+  //! thread pool (see ThreadPool.hh). Tile i is queued first on
+  //! thread i % nthreads, so with balanced tiles each tile runs on the
+  //! same thread on every call; idle threads steal tiles from busy
+  //! ones. ithread can be used to index per-thread scratch space
+  //! (PerThread). The kernel should only write data of the entities
+  //! owned by its tile (MeshTile::cells<PARALLEL_OWNED>() etc.) since
+  //! the ghost entities of a tile are owned by other tiles that may
+  //! be processed at the same time. Does nothing if the mesh has no
+  //! tiles
+
+  template<typename Kernel>
+  void for_each_tile(Kernel const& kernel) const;
+
+  //! Reduce over mesh tiles: kernel(tile, ithread) returns the partial
+  //! result of a tile and the partial results are folded into 'init'
+  //! with combine(T, T) in the order of the tiles, so the result does
+  //! not depend on the number of threads or on which thread ran which
+  //! tile
+
+  template<typename T, typename Kernel, typename Combine>
+  T reduce_tiles(T init, Kernel const& kernel, Combine const& combine) const;
+
+  //! Apply kernel(entity, ithread) to every entity of 'kind' and
+  //! parallel 'type' using the on-node thread pool. The list of
+  //! entities (see entities()) is split into contiguous blocks of
+  //! about 'grain' entities, which are scheduled like tiles in
+  //! for_each_tile. Entities may be processed in any order
+
+  template<typename Kernel>
+  void parallel_for(Entity_kind const kind, Entity_type const type,
+                    Kernel const& kernel, int const grain = 1024) const;
+
+  //! Coloring of the mesh tiles as lists of tile IDs by color. No two
+  //! tiles of the same color own cells that share a node (and hence
+  //! an edge or face), so the tiles of one color can scatter data from
+  //! their owned cells to the nodes, edges, faces or corners of those
+  //! cells concurrently without atomics or locks. Computed on first
+  //! use and again after the tiles are rebuilt
+
+  std::vector<std::vector<int>> const& tile_colors() const;
+
+  //! Coloring of the cells owned by tile 'tileid' as lists of cells by
+  //! color; no two cells of the same color share a node. Computed for
+  //! all tiles on first use and again after the tiles are rebuilt
+
+  std::vector<std::vector<Entity_ID>> const&
+  cell_colors(int const tileid) const;
+
+  //! Like for_each_tile but the colors of tile_colors() are processed
+  //! one after another and only the tiles of one color concurrently,
+  //! so kernels may accumulate into entities shared with other tiles
+
+  template<typename Kernel>
+  void for_each_tile_by_color(Kernel const& kernel) const;
+
   //! Nodes of mesh (of a particular parallel type OWNED, GHOST or ALL)
 
   template<Entity_type type = Entity_type::ALL>
@@ -382,6 +468,12 @@ class Mesh {
   template<Entity_type type = Entity_type::ALL>
   const std::vector<Entity_ID> & cells() const;
 
+  //! Entities of 'kind' and parallel 'type' (list of the matching
+  //! nodes(), edges(), ... cells() above)
+
+  const std::vector<Entity_ID> & entities(Entity_kind const kind,
+                                          Entity_type const type) const;
+
 
   // Master tile ID for entities
 
@@ -736,6 +828,122 @@ class Mesh {
   Entity_ID wedge_get_adjacent_wedge(const Entity_ID wedgeid) const;
 
 
+  // Views of cached adjacencies
+  //----------------------------
+  //
+  // These return a read-only view (pointer + length) directly into
+  // the cached adjacency arrays instead of copying the entities into
+  // a caller supplied list. A view is only valid until the cached
+  // information it refers to is rebuilt. The entities are in the same
+  // order as returned by the corresponding list based routines
+  // (unordered variants) unless noted otherwise.
+  //
+  // Views of upward adjacencies can be restricted to entities of a
+  // particular parallel type; the cached lists are sorted by type
+  // (OWNED, GHOST, BOUNDARY_GHOST) so this only involves narrowing
+  // the range of the view, not copying
+
+  //! View of the nodes of a cell
+
+  Entity_ID_View cell_get_nodes_view(const Entity_ID cellid) const;
+
+  //! View of the faces of a cell
+
+  Entity_ID_View cell_get_faces_view(const Entity_ID cellid) const;
+
+  //! View of the directions in which a cell uses its faces (matches
+  //! cell_get_faces_view entry by entry)
+
+  Dir_View cell_get_face_dirs_view(const Entity_ID cellid) const;
+
+  //! View of the edges of a cell
+
+  Entity_ID_View cell_get_edges_view(const Entity_ID cellid) const;
+
+  //! View of the directions in which a 2D cell uses its edges
+  //! (matches cell_get_edges_view entry by entry)
+
+  Dir_View cell_2D_get_edge_dirs_view(const Entity_ID cellid) const;
+
+  //! View of the edges of a face
+
+  Entity_ID_View face_get_edges_view(const Entity_ID faceid) const;
+
+  //! View of the directions in which a face uses its edges (matches
+  //! face_get_edges_view entry by entry)
+
+  Dir_View face_get_edge_dirs_view(const Entity_ID faceid) const;
+
+  //! View of the nodes of a face
+
+  Entity_ID_View face_get_nodes_view(const Entity_ID faceid) const;
+
+  //! View of the sides of a cell
+
+  Entity_ID_View cell_get_sides_view(const Entity_ID cellid) const;
+
+  //! View of the corners of a cell
+
+  Entity_ID_View cell_get_corners_view(const Entity_ID cellid) const;
+
+  //! View of the cells of type 'type' connected to a face (in the
+  //! same order as face_get_cells)
+
+  Entity_ID_View face_get_cells_view(const Entity_ID faceid,
+                                     const Entity_type type =
+                                     Entity_type::ALL) const;
+
+  //! View of the directions in which the cells of type 'type'
+  //! connected to a face use the face (same order as
+  //! face_get_cells_view)
+
+  Dir_View face_get_cell_dirs_view(const Entity_ID faceid,
+                                   const Entity_type type =
+                                   Entity_type::ALL) const;
+
+  //! View of the local indices of a face in the face lists of the
+  //! cells of type 'type' connected to it (same order as
+  //! face_get_cells_view), i.e. face_get_cells_view(f)[i] has f at
+  //! position face_get_cell_local_indices_view(f)[i] of
+  //! cell_get_faces_view
+
+  ArrayView<int> face_get_cell_local_indices_view(const Entity_ID faceid,
+                                                  const Entity_type type =
+                                                  Entity_type::ALL) const;
+
+  //! Local index of a face in the face list of a cell connected to
+  //! it, or -1 if the cell is not connected to the face. This is
+  //! constant time unlike searching the faces of the cell
+
+  int face_get_local_index_in_cell(const Entity_ID faceid,
+                                   const Entity_ID cellid) const;
+
+  //! Direction in which a cell uses a face connected to it (as in
+  //! cell_get_faces_and_dirs), or 0 if the cell is not connected to
+  //! the face. This is constant time unlike searching the faces of
+  //! the cell
+
+  dir_t face_get_dir_in_cell(const Entity_ID faceid,
+                             const Entity_ID cellid) const;
+
+  //! View of the cells of type 'type' connected to a node. The order
+  //! may differ from node_get_cells (cells are sorted by type)
+
+  Entity_ID_View node_get_cells_view(const Entity_ID nodeid,
+                                     const Entity_type type =
+                                     Entity_type::ALL) const;
+
+  //! View of the corners of type 'type' connected to a node
+
+  Entity_ID_View node_get_corners_view(const Entity_ID nodeid,
+                                       const Entity_type type =
+                                       Entity_type::ALL) const;
+
+  //! View of the wedges of a corner
+
+  Entity_ID_View corner_get_wedges_view(const Entity_ID cornerid) const;
+
+
   //
   // Mesh entity geometry
   //--------------
@@ -757,6 +965,20 @@ class Mesh {
   virtual
   void node_get_coordinates(const Entity_ID nodeid, double *ncoord) const;
 
+  //! Coordinates of all nodes (owned, then ghost) in one contiguous
+  //! array of space_dimension() values per node. Built from
+  //! node_get_coordinates on first use and kept in sync by
+  //! node_set_coordinates, so kernels can stream coordinates without
+  //! going through the mesh framework
+
+  Coordinate_View node_coordinates() const;
+
+  //! Coordinate 'dir' (0 for x, 1 for y, 2 for z) of all nodes in one
+  //! contiguous array - node coordinates as a structure of
+  //! arrays. Same lifetime and update rules as node_coordinates()
+
+  Coordinate_View node_coordinates(int const dir) const;
+
   //! Face coordinates - conventions same as face_to_nodes call
   //! Number of nodes is the vector size divided by number of spatial dimensions
 
@@ -954,6 +1176,22 @@ class Mesh {
   bool point_in_cell(const JaliGeometry::Point &p,
                       const Entity_ID cellid) const;
 
+  //! Lowest numbered cell (owned or ghost) containing the point or -1
+  //! if the point is not in any cell. Uses the spatial index
+
+  Entity_ID find_cell_containing(const JaliGeometry::Point &p) const;
+
+  //! Nodes within distance 'radius' of a point. Uses the spatial index
+
+  void nodes_near(const JaliGeometry::Point &p, const double radius,
+                  Entity_ID_List *nodeids) const;
+
+  //! Spatial search structures over cells and nodes for point
+  //! location and box queries. Built on first use and rebuilt after
+  //! update_geometric_quantities
+
+  std::shared_ptr<MeshSpatialIndex const> spatial_index() const;
+
 
   //! Outward normal to facet of side that is shared with side from
   //! neighboring cell.
@@ -991,6 +1229,9 @@ class Mesh {
   //-------------------
 
   //! Set coordinates of node
+  //!
+  //! Implementations must call node_coordinates_changed so that the
+  //! contiguous coordinate arrays stay in sync with the framework
 
   virtual
   void node_set_coordinates(const Entity_ID nodeid,
@@ -1008,6 +1249,91 @@ class Mesh {
 
   void update_geometric_quantities();
 
+  //! Make sure that the cached adjacencies and geometric quantities
+  //! needed to query entities of the given kinds are built. Sides,
+  //! wedges and corners that were not requested when the mesh was
+  //! created are built here (this needs faces and edges, which
+  //! cannot be added after the mesh is created). Kinds
+  //! that are already prepared cost only a check of their flags.
+  //!
+  //! Each cache is built exactly once even if several threads call
+  //! this at the same time, so threads working on different mesh
+  //! tiles can prepare the mesh themselves without a serial warm-up
+  //! pass. Caches must not be built concurrently with
+  //! node_set_coordinates or update_geometric_quantities
+
+  void prepare(std::vector<Entity_kind> const& kinds) const;
+
+  //! Bytes held by each cached adjacency, coordinate and geometry
+  //! array (see Mesh_cache; Mesh_cache_entity_kind gives the kind of
+  //! entity each cache belongs to). Caches that are not built hold
+  //! no memory. Entity lists, sets, halos and tiles are not included
+
+  std::map<Mesh_cache, std::size_t> memory_report() const;
+
+  //! Total bytes held by the caches of entities of 'kind' (of all
+  //! kinds for ALL_KIND)
+
+  std::size_t memory_size(Entity_kind const kind = Entity_kind::ALL_KIND)
+      const;
+
+  //! Free the memory of a cache. The cache is rebuilt the next time
+  //! it is needed, so this only trades memory for time (e.g. to drop
+  //! sides and wedges after a setup phase). Releasing WEDGE also
+  //! releases CORNER, which refers to it.
+  //!
+  //! Views into a released cache are invalidated. Caches must not be
+  //! released while other threads query the mesh
+
+  void release(Mesh_cache const cache) const;
+
+  //! Limit the memory held by the caches to 'bytes' (0 for no
+  //! limit). Setting a limit releases least recently used caches
+  //! until the caches fit. Use of a cache is recorded when it is
+  //! built, when prepare() is called for its kind and when it is
+  //! queried. Caches are never released by queries or by prepare(),
+  //! only here and by trim_caches(), so this must not be called
+  //! while other threads query the mesh
+
+  void memory_budget(std::size_t const bytes);
+  std::size_t memory_budget() const { return memory_budget_; }
+
+  //! Release least recently used caches until the caches fit in the
+  //! memory budget, keeping the ones used since the previous call
+  //! (or since the budget was set). Meant to be called between the
+  //! phases of a computation, when no other thread queries the mesh,
+  //! so that the data of an earlier phase makes room for the next
+
+  void trim_caches() const;
+
+  //! Renumber nodes, edges, faces and cells so that entities that are
+  //! close in the mesh are close in memory. Cells are sorted along a
+  //! space filling curve through their centroids (MORTON, HILBERT)
+  //! or by reverse Cuthill-McKee on their face adjacency graph
+  //! (RCM). Nodes are sorted along the same curve (MORTON, HILBERT)
+  //! or in the order in which the reordered cells first use them
+  //! (RCM); edges and faces are always numbered in the order in
+  //! which the reordered cells first use them.
+  //!
+  //! Entities are only renumbered among the IDs of their own
+  //! parallel type (owned, ghost, boundary ghost), so the ranges of
+  //! IDs of each type are unchanged. Mesh sets are renumbered and
+  //! all cached adjacencies, geometry, halos and tiles are rebuilt;
+  //! sides, wedges and corners are rebuilt in the new order of
+  //! their cells. The mesh framework must support renumbering
+  //! (Simple and MSTK do). Fields stored with the mesh are permuted
+  //! with their entities; data stored elsewhere can be carried over
+  //! with entity_new_to_old (see State::renumber_entities)
+
+  void reorder_entities(Entity_ordering const ordering);
+
+  //! Old ID of each entity of 'kind' (new2old[newID] = oldID) for the
+  //! most recent call to reorder_entities. Empty if the entities were
+  //! not renumbered
+
+  std::vector<Entity_ID> const& entity_new_to_old(Entity_kind const kind)
+      const;
+
   //
   // Mesh Sets for ICs, BCs, Material Properties and whatever else
   //--------------------------------------------------------------
@@ -1092,6 +1418,46 @@ class Mesh {
   void write_to_gmv_file(const std::string gmvfilename,
                          const bool with_fields = true) const {}
 
+  //! \brief Write a Jali-native binary snapshot of the mesh
+  //! Each rank writes the topology, node coordinates, global IDs,
+  //! entity lists, mesh sets and tile partition of its partition as
+  //! they are now (i.e. in the final local numbering) to its own file
+  //! (see MeshSnapshot.hh). MeshFactory maps a snapshot back into a
+  //! ready-to-use mesh without going through the original framework.
+  //! Fields and geometric quantities are not written
+
+  void write_snapshot(std::string const& filename) const;
+
+  //! \brief Export to parallel VTK XML files
+  //! Each rank writes its partition as a .vtu piece and rank 0 a
+  //! .pvtu index of the pieces (see MeshVTK.hh). If with_fields is
+  //! true, the node and cell fields stored on the mesh (e.g. by
+  //! State::export_to_mesh) are written too. With compress the data
+  //! is compressed with zlib if Jali was built with it. Collective
+
+  void write_to_vtk_file(const std::string filename,
+                         const bool with_fields = true,
+                         const bool compress = false) const;
+
+  //! \brief Export to parallel VTK XML files with the given arrays
+  //! Same as above but writes the node and cell arrays in 'fields'
+  //! (see vtk_field in MeshVTK.hh) straight from where they live
+
+  void write_to_vtk_file(const std::string filename,
+                         std::vector<VTKField> const& fields,
+                         const bool compress = false) const;
+
+  //! \brief Values of a field stored with the mesh
+  //! Contiguous array of the values of a field stored on the mesh
+  //! (e.g. by State::export_to_mesh), one per entity of 'kind' in
+  //! local ID order, or nullptr if the mesh keeps no such field with
+  //! values of type T. Lets writers that take whole arrays skip
+  //! copying the field through get_field
+
+  template <class T>
+  T const * field_data(std::string const& field_name,
+                       Entity_kind const kind) const;
+
   //! \brief Precompute and cache corners, wedges, edges, cells
   // WHY IS THIS VIRTUAL?
 
@@ -1133,6 +1499,11 @@ class Mesh {
 
  protected:
 
+  // Compute and store geometric quantities of all entities of a
+  // kind. The entities are distributed over on-node threads (see
+  // parallel_for.hh); each entity is computed independently, so the
+  // results do not depend on the number of threads
+
   int compute_cell_geometric_quantities() const;
   int compute_face_geometric_quantities() const;
   int compute_edge_geometric_quantities() const;
@@ -1204,17 +1575,29 @@ class Mesh {
                                 Entity_ID_List *owned_entities,
                                 Entity_ID_List *ghost_entities) const = 0;
 
+  // Renumber entities of a kind (NODE, EDGE, FACE or CELL) in the
+  // mesh framework so that new entity i is old entity new2old[i]. The
+  // adjacency and set queries of the framework must return the new
+  // IDs afterwards. Called by reorder_entities (which takes care of
+  // the base class caches); frameworks that cannot renumber their
+  // entities keep this default which throws an exception
+
+  virtual
+  void renumber_entities_internal(const Entity_kind kind,
+                                  std::vector<Entity_ID> const& new2old);
+
   //! \brief Get info about mesh fields on a particular type of entity
 
   //! Get info about the number of fields, their names and their types
   //! on a particular type of entity on the mesh - DESIGNED TO BE
   //! CALLED ONLY BY THE JALI STATE MANAGER FOR INITIALIZATION OF MESH
-  //! STATE FROM THE MESH FILE
+  //! STATE FROM THE MESH FILE. By default these are the fields stored
+  //! with store_field
 
   virtual
   void get_field_info(Entity_kind on_what, int *num,
                       std::vector<std::string> *varnames,
-                      std::vector<std::string> *vartypes) const {*num = 0;}
+                      std::vector<std::string> *vartypes) const;
 
   //! \brief Retrieve a field on the mesh - cannot template virtual funcs
 
@@ -1229,20 +1612,24 @@ class Mesh {
 
   virtual
   bool get_field(std::string field_name, Entity_kind on_what, int *data) const
-  {return false;}
+  {return get_field_array(field_name, on_what, data);}
   virtual
   bool get_field(std::string field_name, Entity_kind on_what,
-                 double *data) const {return false;}
+                 double *data) const
+  {return get_field_array(field_name, on_what, data);}
   virtual
   bool
   get_field(std::string field_name, Entity_kind on_what,
-            std::array<double, (std::size_t)2> *data) const {return false;}
+            std::array<double, (std::size_t)2> *data) const
+  {return get_field_array(field_name, on_what, data);}
   virtual
   bool get_field(std::string field_name, Entity_kind on_what,
-                 std::array<double, (std::size_t)3> *data) const {return false;}
+                 std::array<double, (std::size_t)3> *data) const
+  {return get_field_array(field_name, on_what, data);}
   virtual
   bool get_field(std::string field_name, Entity_kind on_what,
-                 std::array<double, (std::size_t)6> *data) const {return false;}
+                 std::array<double, (std::size_t)6> *data) const
+  {return get_field_array(field_name, on_what, data);}
 
   //! \brief Store a field on the mesh - cannot template as its virtual
 
@@ -1250,35 +1637,133 @@ class Mesh {
   //! means that the mesh already has a field of that name but it's of
   //! a different type or it's on a different type of entity - DESIGNED
   //! TO BE CALLED ONLY BY THE JALI STATE MANAGER FOR INITIALIZATION
-  //! OF MESH STATE FROM THE MESH FILE
+  //! OF MESH STATE FROM THE MESH FILE. By default the values are
+  //! copied into a contiguous array kept with the mesh (see
+  //! field_data)
 
   virtual
   bool store_field(std::string field_name, Entity_kind on_what, int *data)
-  {return false;}
+  {return store_field_array(field_name, on_what, data);}
   virtual
   bool store_field(std::string field_name, Entity_kind on_what, double *data)
-  {return false;}
+  {return store_field_array(field_name, on_what, data);}
   virtual
   bool store_field(std::string field_name, Entity_kind on_what,
-                   std::array<double, (std::size_t)2> *data) {return false;}
+                   std::array<double, (std::size_t)2> *data)
+  {return store_field_array(field_name, on_what, data);}
   virtual
   bool store_field(std::string field_name, Entity_kind on_what,
-                   std::array<double, (std::size_t)3> *data) {return false;}
+                   std::array<double, (std::size_t)3> *data)
+  {return store_field_array(field_name, on_what, data);}
   virtual
   bool store_field(std::string field_name, Entity_kind on_what,
-                   std::array<double, (std::size_t)6> *data) {return false;}
+                   std::array<double, (std::size_t)6> *data)
+  {return store_field_array(field_name, on_what, data);}
+
+  // Fields kept with the mesh as contiguous arrays of one value per
+  // entity (of all types) of a kind. Field names are unique over all
+  // kinds. Storing a field again overwrites its values if the kind
+  // and the value type match and fails otherwise
+
+  template <class T>
+  bool store_field_array(std::string const& field_name, Entity_kind on_what,
+                         T const *data);
+
+  template <class T>
+  bool get_field_array(std::string const& field_name, Entity_kind on_what,
+                       T *data) const;
+
+  // Type of the values of a field as reported by get_field_info
+
+  static std::string field_vartype(int const *, int) { return "INT"; }
+  static std::string field_vartype(double const *, int) { return "DOUBLE"; }
+  template <std::size_t N>
+  static std::string field_vartype(std::array<double, N> const *,
+                                   int space_dim) {
+    // 3 components are a symmetric 2x2 tensor in 2D
+    return (N == 2 || (N == 3 && space_dim == 3)) ? "VECTOR" : "TENSOR";
+  }
+
+  // Update the contiguous coordinate arrays (if built) after the
+  // framework changed the coordinates of a node
+
+  void node_coordinates_changed(const Entity_ID nodeid,
+                                const double *ncoord);
+
+  // Coordinates of a node from the contiguous coordinate array if it
+  // is built (and from the framework if not)
+
+  void node_get_point(const Entity_ID nodeid, JaliGeometry::Point *p) const {
+    if (node_coords_cached)
+      p->set(space_dim_, &(node_coords_[space_dim_*nodeid]));
+    else
+      node_get_coordinates(nodeid, p);
+  }
+
+  // Scratch space for computing the geometry of one entity at a
+  // time, so that the per-entity routines below do not have to
+  // allocate temporaries for every entity. When geometric quantities
+  // are computed with multiple threads, each thread has its own
+  // instance
+
+  struct Geometry_scratch {
+    std::vector<unsigned int> nfnodes;
+    std::vector<JaliGeometry::Point> coords, coords2, coords3;
+    Entity_ID_List ids, ids2, ids3;
+    std::vector<dir_t> dirs, dirs2;
+  };
+
+  // Adjacencies read by the geometry routines - views of the caches
+  // or, for frameworks with implicit topology, the answers of the
+  // framework copied into scratch lists (so the caches are not built)
+
+  Entity_ID_View cell_nodes_for_geometry(const Entity_ID cellid,
+                                         Entity_ID_List *scratch) const {
+    if (!implicit_topology_) return cell_get_nodes_view(cellid);
+    cell_get_nodes(cellid, scratch);
+    return *scratch;
+  }
+
+  Entity_ID_View face_nodes_for_geometry(const Entity_ID faceid,
+                                         Entity_ID_List *scratch) const {
+    if (!implicit_topology_) return face_get_nodes_view(faceid);
+    face_get_nodes(faceid, scratch);
+    return *scratch;
+  }
+
+  void cell_faces_for_geometry(const Entity_ID cellid, Geometry_scratch *sc,
+                               Entity_ID_View *faceids,
+                               Dir_View *face_dirs) const;
+
+  void face_cells_for_geometry(const Entity_ID faceid, Geometry_scratch *sc,
+                               Entity_ID_View *cellids,
+                               Dir_View *cell_dirs) const;
+
+  // Coordinates of a list of nodes (reads the contiguous coordinate
+  // array or calls node_get_coordinates of the framework, so it is
+  // safe to call from multiple threads)
+
+  void get_node_coordinates(Entity_ID_View const& nodeids,
+                            std::vector<JaliGeometry::Point> *coords) const;
 
   // The following methods are declared const since they do not modify the
-  // mesh but just modify cached variables declared as mutable
+  // mesh but just modify cached variables declared as mutable.
+  //
+  // The geometry of an entity is computed from cached adjacencies
+  // (or the framework's, see implicit_topology_) and node coordinates
+  // only, so these routines can be called concurrently for different
+  // entities
 
   int compute_cell_geometry(const Entity_ID cellid,
                             double *volume,
-                            JaliGeometry::Point *centroid) const;
+                            JaliGeometry::Point *centroid,
+                            Geometry_scratch *scratch = nullptr) const;
   int compute_face_geometry(const Entity_ID faceid,
                             double *area,
                             JaliGeometry::Point *centroid,
                             JaliGeometry::Point *normal0,
-                            JaliGeometry::Point *normal1) const;
+                            JaliGeometry::Point *normal1,
+                            Geometry_scratch *scratch = nullptr) const;
   int compute_edge_geometry(const Entity_ID edgeid,
                             double *length,
                             JaliGeometry::Point *edge_vector,
@@ -1293,7 +1778,8 @@ class Mesh {
   void compute_side_geometry(const Entity_ID sideid,
                              double *volume,
                              JaliGeometry::Point *outward_facet_normal,
-                             JaliGeometry::Point *mid_facet_normal) const;
+                             JaliGeometry::Point *mid_facet_normal,
+                             Geometry_scratch *scratch = nullptr) const;
 
   void compute_corner_geometry(const Entity_ID cornerid,
                               double *volume) const;
@@ -1304,13 +1790,79 @@ class Mesh {
   void cache_cell2edge_info() const;
   void cache_face2edge_info() const;
   void cache_edge2node_info() const;
+  void cache_cell2node_info() const;
+  void cache_node_coordinates() const;
+  void cache_node_coordinates_soa() const;
+  void cache_node2cell_info() const;
+  void cache_face2node_info() const;
   void cache_side_info() const;
   void cache_wedge_info() const;
   void cache_corner_info() const;
 
+  // Build a cache if it is not built (e.g. after it was released),
+  // including the caches it is computed from
+
+  void rebuild_cache(Mesh_cache const cache) const;
+
+  // Build all the requested adjacencies (but no geometry)
+
+  void cache_topology() const;
+
+  // Build the caches needed to query entities of the given kinds
+  // (prepare without recording their use)
+
+  void prepare_caches(std::vector<Entity_kind> const& kinds) const;
+
+  // Bookkeeping for release and the memory budget: whether a cache
+  // is built, bytes held by a cache (0 if it is not built), freeing
+  // a cache without locking, recording the use of a cache and
+  // releasing least recently used caches (except those used after
+  // 'protect_after') to fit the budget
+
+  bool cache_built(Mesh_cache const cache) const;
+  std::size_t cache_memory_size(Mesh_cache const cache) const;
+  void release_cache(Mesh_cache const cache) const;
+  void cache_used(Mesh_cache const cache) const;
+  void enforce_memory_budget(std::uint64_t const protect_after) const;
+
+  // Record the use of a cache by a query. Unlike cache_used this
+  // does not advance the clock, and it only writes when the clock
+  // moved since the last use, so the queries of many threads read
+  // but rarely write the shared use times
+
+  void cache_accessed(Mesh_cache const cache) const {
+    std::atomic<std::uint64_t>& last =
+        cache_last_use_[static_cast<int>(cache)];
+    std::uint64_t const now = cache_clock_.load(std::memory_order_relaxed);
+    if (last.load(std::memory_order_relaxed) != now)
+      last.store(now, std::memory_order_relaxed);
+  }
+
+  // Discard all cached adjacencies, geometric quantities, coordinate
+  // arrays, halos and spatial indexes so that they are rebuilt from
+  // the framework (after it renumbered its entities)
+
+  void clear_cached_data();
+
+  // Narrow a list of entities sorted by parallel type to the range
+  // of entities of a particular type
+
+  template<typename TypeOf>
+  static Entity_ID_View slice_by_type(Entity_ID_View const& entities,
+                                      Entity_type const type,
+                                      TypeOf const& type_of);
+
+  // Position range of the cells of a particular type in the (at most
+  // two) cells of a face
+
+  void face_cells_of_type(const Entity_ID faceid, const Entity_type type,
+                          int *first, int *count) const;
+
   void build_tiles();
+  void build_tiles(std::vector<std::vector<Entity_ID>> const& partitions);
   void add_tile(std::shared_ptr<MeshTile> tile2add);
   void init_tiles();
+  void clear_colorings();
   int get_new_tile_ID() const { return meshtiles.size(); }
 
   // Set master tile ID for entities
@@ -1356,6 +1908,42 @@ class Mesh {
   const Partitioner_type partitioner_pref_;
   bool tiles_initialized_ = false;
   std::vector<std::shared_ptr<MeshTile>> meshtiles;
+  std::vector<double> tile_cell_weights_;  // cost of each owned cell
+
+  // Fields stored with the mesh (see store_field_array)
+
+  struct FieldArray {
+    Entity_kind kind;
+    std::type_index type;      // type of the values
+    std::string vartype;       // INT, DOUBLE, VECTOR or TENSOR
+    std::vector<char> values;
+  };
+  std::map<std::string, FieldArray> fields_;
+
+  // Colorings of the tiles and of the owned cells of each tile, built
+  // on demand (see tile_colors and cell_colors)
+
+  mutable std::atomic<bool> tile_colors_cached_{false};
+  mutable std::atomic<bool> cell_colors_cached_{false};
+  mutable std::vector<std::vector<int>> tile_colors_;
+  mutable std::vector<std::vector<std::vector<Entity_ID>>> tile_cell_colors_;
+
+  // Communication plans for ghost entities, built on demand
+
+  mutable std::map<Entity_kind, std::shared_ptr<MeshHalo const>> halos_;
+
+  // Spatial search structures, built on demand
+
+  mutable std::shared_ptr<MeshSpatialIndex const> spatial_index_;
+
+  // Old IDs of entities renumbered by the last reorder_entities call
+
+  std::map<Entity_kind, std::vector<Entity_ID>> entity_new2old_;
+
+  // Contiguous node coordinates, interleaved and as a structure of
+  // arrays, built on demand (see node_coordinates)
+
+  mutable std::vector<double> node_coords_, node_coords_soa_;
   std::vector<int> node_master_tile_ID_, edge_master_tile_ID_;
   std::vector<int> face_master_tile_ID_, cell_master_tile_ID_;
 
@@ -1403,18 +1991,39 @@ class Mesh {
   // Some standard topological relationships that are cached. The rest
   // are computed on the fly or obtained from the derived class
 
-  mutable std::vector<Entity_ID_List> cell_face_ids;
-  mutable std::vector<std::vector<dir_t>> cell_face_dirs;
-  mutable std::vector<Entity_ID_List> face_cell_ids;
-  mutable std::vector<Entity_ID_List> cell_edge_ids;
-  mutable std::vector<Entity_ID_List> face_edge_ids;
-  mutable std::vector<std::vector<dir_t>> face_edge_dirs;
+  //
+  // One-to-many relationships are stored in compressed row format
+  // (see MeshCSR.hh) so that the cache does not incur one heap
+  // allocation per entity
+
+  mutable CSRArray<Entity_ID> cell_face_ids;
+  mutable CSRArray<dir_t> cell_face_dirs;
+  mutable std::vector<std::array<Entity_ID, 2>> face_cell_ids;  // -1 padded
+  mutable std::vector<std::array<int, 2>> face_cell_slots;  // -1 padded
+  mutable std::vector<std::array<dir_t, 2>> face_cell_dirs;  // 0 padded
+  mutable CSRArray<Entity_ID> cell_node_ids;
+  mutable std::shared_ptr<VTKCells const> vtk_cells;  // from cell_node_ids
+  mutable CSRArray<Entity_ID> node_cell_ids;  // sorted by cell type
+  mutable CSRArray<Entity_ID> face_node_ids;
+  mutable CSRArray<Entity_ID> cell_edge_ids;
+  mutable CSRArray<Entity_ID> face_edge_ids;
+  mutable CSRArray<dir_t> face_edge_dirs;
   mutable std::vector<std::array<Entity_ID, 2>> edge_node_ids;
 
   // cell_2D_edge_dirs is an unusual topological relationship
   // requested by MHD discretization - It has no equivalent in 3D
 
-  mutable std::vector<std::vector<dir_t>> cell_2D_edge_dirs;
+  mutable CSRArray<dir_t> cell_2D_edge_dirs;
+
+  // Set by frameworks that compute adjacencies from indices or read
+  // them from memory as cheaply as they can be looked up
+  // (Mesh_structured, Mesh_snapshot). The list
+  // based adjacency queries and the geometry computations then call
+  // the framework instead of building the caches above, so the mesh
+  // does not store its topology. Views still build the cache they
+  // point into on first use, as do sides, wedges, corners and tiles
+
+  bool implicit_topology_ = false;
 
 
   // Topological relationships involving standard and non-standard
@@ -1450,27 +2059,49 @@ class Mesh {
   mutable std::vector<Entity_ID> wedge_corner_id;
 
   // some other one-many adjacencies
-  mutable std::vector<std::vector<Entity_ID>> cell_side_ids;
-  mutable std::vector<std::vector<Entity_ID>> cell_corner_ids;
-  //  mutable std::vector<std::vector<Entity_ID>> edge_side_ids;
-  mutable std::vector<std::vector<Entity_ID>> node_corner_ids;
-  mutable std::vector<std::vector<Entity_ID>> corner_wedge_ids;
+  mutable CSRArray<Entity_ID> cell_side_ids;
+  mutable CSRArray<Entity_ID> cell_corner_ids;
+  //  mutable CSRArray<Entity_ID> edge_side_ids;
+  mutable CSRArray<Entity_ID> node_corner_ids;
+  mutable CSRArray<Entity_ID> corner_wedge_ids;
 
   // Rectangular or general
   mutable Mesh_type mesh_type_;
 
-  // flags to indicate what data is current
-
-  mutable bool faces_requested, edges_requested, sides_requested,
-    wedges_requested, corners_requested;
-  mutable bool type_info_cached;
-  mutable bool cell2face_info_cached, face2cell_info_cached;
-  mutable bool cell2edge_info_cached, face2edge_info_cached;
-  mutable bool edge2node_info_cached;
-  mutable bool side_info_cached, wedge_info_cached, corner_info_cached;
-  mutable bool cell_geometry_precomputed, face_geometry_precomputed,
-    edge_geometry_precomputed, side_geometry_precomputed,
-    corner_geometry_precomputed;
+  // flags to indicate what data is current. A flag is set only after
+  // the data it guards is completely built, and the data is built
+  // while holding cache_mutex_, so a thread that sees a flag set can
+  // use the data without locking
+
+  mutable std::atomic<bool> faces_requested, edges_requested,
+    sides_requested, wedges_requested, corners_requested;
+  mutable std::atomic<bool> type_info_cached;
+  mutable std::atomic<bool> cell2face_info_cached, face2cell_info_cached;
+  mutable std::atomic<bool> cell2edge_info_cached, face2edge_info_cached;
+  mutable std::atomic<bool> edge2node_info_cached;
+  mutable std::atomic<bool> cell2node_info_cached, node2cell_info_cached;
+  mutable std::atomic<bool> face2node_info_cached;
+  mutable std::atomic<bool> side_info_cached, wedge_info_cached,
+    corner_info_cached;
+  mutable std::atomic<bool> cell_geometry_precomputed,
+    face_geometry_precomputed, edge_geometry_precomputed,
+    side_geometry_precomputed, corner_geometry_precomputed;
+  mutable std::atomic<bool> node_coords_cached, node_coords_soa_cached;
+
+  // Serializes building of the cached data (recursive because some
+  // caches build the caches they depend on)
+
+  mutable std::recursive_mutex cache_mutex_;
+
+  // Memory budget for the caches (0 if none), when each cache was
+  // last used, as ticks of a counter that advances when caches are
+  // built or prepared, and the tick of the last trim_caches()
+
+  std::atomic<std::size_t> memory_budget_{0};
+  mutable std::atomic<std::uint64_t> cache_clock_{0};
+  mutable std::uint64_t last_trim_ = 0;
+  mutable std::array<std::atomic<std::uint64_t>, NUM_MESH_CACHES>
+  cache_last_use_ = {};
 
   // Pointer to geometric model that contains descriptions of
   // geometric regions - These geometric regions are used to define
@@ -1545,6 +2176,14 @@ class Mesh {
                                     std::vector<std::vector<int>> *partitions);
 #endif
 
+  /// Method to get partitioning of a mesh into num parts with the
+  /// built-in RCB or HILBERT partitioners applied to the cell
+  /// centroids, weighted by tile_cell_weights_ if set
+
+  void get_partitioning_by_geometry(int const num_parts,
+                                    Partitioner_type const parttype,
+                                    std::vector<std::vector<int>> *partitions);
+
 };  // End class Mesh
 
 
@@ -2005,6 +2644,12 @@ inline
 void Mesh::edge_get_nodes(const Entity_ID edgeid, Entity_ID *nodeid0,
                           Entity_ID *nodeid1) const {
 #ifdef JALI_CACHE_VARS
+  if (implicit_topology_) {
+    edge_get_nodes_internal(edgeid, nodeid0, nodeid1);
+    return;
+  }
+  if (!edge2node_info_cached) cache_edge2node_info();
+  cache_accessed(Mesh_cache::EDGE2NODE);
   *nodeid0 = edge_node_ids[edgeid][0];
   *nodeid1 = edge_node_ids[edgeid][1];
 #else
@@ -2021,35 +2666,42 @@ Entity_ID Mesh::side_get_wedge(const Entity_ID sideid, int iwedge) const {
 inline
 Entity_ID Mesh::side_get_face(const Entity_ID sideid) const {
   assert(sides_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
   return side_face_id[sideid];
 }
 
 inline
 Entity_ID Mesh::side_get_edge(const Entity_ID sideid) const {
   assert(sides_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
   return side_edge_id[sideid];
 }
 
 inline
 int Mesh::side_get_edge_use(const Entity_ID sideid) const {
   assert(sides_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
   return static_cast<int>(side_edge_use[sideid]);
 }
 
 inline
 Entity_ID Mesh::side_get_cell(const Entity_ID sideid) const {
   assert(sides_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
   return side_cell_id[sideid];
 }
 
 inline
 Entity_ID Mesh::side_get_node(const Entity_ID sideid, const int inode) const {
   assert(sides_requested);
-  assert(side_info_cached && edge2node_info_cached);
+  if (!side_info_cached) cache_side_info();
+  if (!edge2node_info_cached) cache_edge2node_info();
+  cache_accessed(Mesh_cache::SIDE);
+  cache_accessed(Mesh_cache::EDGE2NODE);
   assert(inode == 0 || inode == 1);
 
   Entity_ID edgeid = side_edge_id[sideid];
@@ -2062,14 +2714,16 @@ Entity_ID Mesh::side_get_node(const Entity_ID sideid, const int inode) const {
 inline
 Entity_ID Mesh::side_get_opposite_side(const Entity_ID sideid) const {
   assert(sides_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
   return side_opp_side_id[sideid];
 }
 
 inline
 Entity_ID Mesh::wedge_get_cell(const Entity_ID wedgeid) const {
   assert(sides_requested && wedges_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
   int sideid = wedgeid/2;  // which side does wedge belong to
   return side_get_cell(sideid);
 }
@@ -2077,7 +2731,8 @@ Entity_ID Mesh::wedge_get_cell(const Entity_ID wedgeid) const {
 inline
 Entity_ID Mesh::wedge_get_face(const Entity_ID wedgeid) const {
   assert(sides_requested && wedges_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
   Entity_ID sideid = static_cast<Entity_ID>(wedgeid/2);
   return side_get_face(sideid);
 }
@@ -2085,7 +2740,8 @@ Entity_ID Mesh::wedge_get_face(const Entity_ID wedgeid) const {
 inline
 Entity_ID Mesh::wedge_get_edge(const Entity_ID wedgeid) const {
   assert(sides_requested && wedges_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
   Entity_ID sideid = static_cast<Entity_ID>(wedgeid/2);
   return side_get_edge(sideid);
 }
@@ -2093,7 +2749,8 @@ Entity_ID Mesh::wedge_get_edge(const Entity_ID wedgeid) const {
 inline
 Entity_ID Mesh::wedge_get_node(const Entity_ID wedgeid) const {
   assert(sides_requested && wedges_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
   Entity_ID sideid = static_cast<Entity_ID>(wedgeid/2);
   int iwedge = wedgeid%2;  // Is it wedge 0 or wedge 1 of side
   return side_get_node(sideid, iwedge);
@@ -2102,7 +2759,10 @@ Entity_ID Mesh::wedge_get_node(const Entity_ID wedgeid) const {
 inline
 Entity_ID Mesh::wedge_get_corner(const Entity_ID wedgeid) const {
   assert(sides_requested && wedges_requested);
-  assert(side_info_cached && wedge_info_cached);
+  if (!side_info_cached) cache_side_info();
+  if (!wedge_info_cached) cache_wedge_info();
+  cache_accessed(Mesh_cache::SIDE);
+  cache_accessed(Mesh_cache::WEDGE);
   return wedge_corner_id[wedgeid];
 }
 
@@ -2121,7 +2781,8 @@ Entity_ID Mesh::wedge_get_adjacent_wedge(Entity_ID const wedgeid) const {
 inline
 Entity_ID Mesh::wedge_get_opposite_wedge(Entity_ID const wedgeid) const {
   assert(wedges_requested);
-  assert(side_info_cached);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
 
   Entity_ID sideid = static_cast<Entity_ID>(wedgeid/2);
   int iwedge = wedgeid%2;  // Is it wedge 0 or wedge 1 of side
@@ -2141,20 +2802,21 @@ inline
 void Mesh::corner_get_wedges(const Entity_ID cornerid,
                              Entity_ID_List *cwedges) const {
   assert(corners_requested);
-  assert(corner_info_cached);
+  if (!corner_info_cached) cache_corner_info();
+  cache_accessed(Mesh_cache::CORNER);
 
-  int nwedges = corner_wedge_ids[cornerid].size();
-  (*cwedges).resize(nwedges);
-  std::copy(corner_wedge_ids[cornerid].begin(),
-            corner_wedge_ids[cornerid].end(),
-            cwedges->begin());
+  Entity_ID_View cnwedges = corner_wedge_ids[cornerid];
+  cwedges->assign(cnwedges.begin(), cnwedges.end());
 }
 
 inline
 Entity_ID Mesh::corner_get_node(const Entity_ID cornerid) const {
   assert(corners_requested);
-  assert(corner_info_cached && side_info_cached);
-  assert(corner_wedge_ids[cornerid].size());
+  if (!corner_info_cached) cache_corner_info();
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::CORNER);
+  cache_accessed(Mesh_cache::SIDE);
+  assert(corner_wedge_ids.row_size(cornerid));
 
   // Instead of calling corner_get_wedges which involves a list copy,
   // we will directly access the first element of the corner_wedge_ids
@@ -2166,8 +2828,11 @@ Entity_ID Mesh::corner_get_node(const Entity_ID cornerid) const {
 inline
 Entity_ID Mesh::corner_get_cell(const Entity_ID cornerid) const {
   assert(corners_requested);
-  assert(corner_info_cached && side_info_cached);
-  assert(corner_wedge_ids[cornerid].size());
+  if (!corner_info_cached) cache_corner_info();
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::CORNER);
+  cache_accessed(Mesh_cache::SIDE);
+  assert(corner_wedge_ids.row_size(cornerid));
 
   // Instead of calling corner_get_wedges which involves a list copy,
   // we will directly access the first element of the corner_wedge_ids
@@ -2176,6 +2841,195 @@ Entity_ID Mesh::corner_get_cell(const Entity_ID cornerid) const {
   return wedge_get_cell(w0);
 }
 
+template<typename TypeOf>
+inline
+Entity_ID_View Mesh::slice_by_type(Entity_ID_View const& entities,
+                                   Entity_type const type,
+                                   TypeOf const& type_of) {
+  if (type == Entity_type::ALL)
+    return entities;
+
+  Entity_ID const *first =
+      std::partition_point(entities.begin(), entities.end(),
+                           [&](Entity_ID const e) {
+                             return type_of(e) < type;
+                           });
+  Entity_ID const *last =
+      std::partition_point(first, entities.end(),
+                           [&](Entity_ID const e) {
+                             return type_of(e) == type;
+                           });
+  return Entity_ID_View(first, last-first);
+}
+
+inline
+Entity_ID_View Mesh::cell_get_nodes_view(const Entity_ID cellid) const {
+  if (!cell2node_info_cached) cache_cell2node_info();
+  cache_accessed(Mesh_cache::CELL2NODE);
+  return cell_node_ids[cellid];
+}
+
+inline
+Entity_ID_View Mesh::cell_get_faces_view(const Entity_ID cellid) const {
+  if (!cell2face_info_cached) cache_cell2face_info();
+  cache_accessed(Mesh_cache::CELL2FACE);
+  return cell_face_ids[cellid];
+}
+
+inline
+Dir_View Mesh::cell_get_face_dirs_view(const Entity_ID cellid) const {
+  if (!cell2face_info_cached) cache_cell2face_info();
+  cache_accessed(Mesh_cache::CELL2FACE);
+  return cell_face_dirs[cellid];
+}
+
+inline
+Entity_ID_View Mesh::cell_get_edges_view(const Entity_ID cellid) const {
+  if (!cell2edge_info_cached) cache_cell2edge_info();
+  cache_accessed(Mesh_cache::CELL2EDGE);
+  return cell_edge_ids[cellid];
+}
+
+inline
+Dir_View Mesh::cell_2D_get_edge_dirs_view(const Entity_ID cellid) const {
+  assert(space_dim_ == 2);
+  if (!cell2edge_info_cached) cache_cell2edge_info();
+  cache_accessed(Mesh_cache::CELL2EDGE);
+  return cell_2D_edge_dirs[cellid];
+}
+
+inline
+Entity_ID_View Mesh::face_get_edges_view(const Entity_ID faceid) const {
+  if (!face2edge_info_cached) cache_face2edge_info();
+  cache_accessed(Mesh_cache::FACE2EDGE);
+  return face_edge_ids[faceid];
+}
+
+inline
+Dir_View Mesh::face_get_edge_dirs_view(const Entity_ID faceid) const {
+  if (!face2edge_info_cached) cache_face2edge_info();
+  cache_accessed(Mesh_cache::FACE2EDGE);
+  return face_edge_dirs[faceid];
+}
+
+inline
+Entity_ID_View Mesh::face_get_nodes_view(const Entity_ID faceid) const {
+  if (!face2node_info_cached) cache_face2node_info();
+  cache_accessed(Mesh_cache::FACE2NODE);
+  return face_node_ids[faceid];
+}
+
+inline
+void Mesh::face_cells_of_type(const Entity_ID faceid, const Entity_type type,
+                              int *first, int *count) const {
+  if (!face2cell_info_cached) cache_face2cell_info();
+  cache_accessed(Mesh_cache::FACE2CELL);
+
+  // At most two cells and the unused slot is always the last one, so
+  // cells of any one type are always contiguous
+
+  std::array<Entity_ID, 2> const& fcells = face_cell_ids[faceid];
+  *first = 0;
+  *count = 0;
+  for (int i = 0; i < 2; i++) {
+    if (fcells[i] == -1) break;
+    if (type == Entity_type::ALL || cell_type[fcells[i]] == type) {
+      if (!*count) *first = i;
+      (*count)++;
+    }
+  }
+}
+
+inline
+Entity_ID_View Mesh::face_get_cells_view(const Entity_ID faceid,
+                                         const Entity_type type) const {
+  int first, count;
+  face_cells_of_type(faceid, type, &first, &count);
+  return Entity_ID_View(face_cell_ids[faceid].data() + first, count);
+}
+
+inline
+Dir_View Mesh::face_get_cell_dirs_view(const Entity_ID faceid,
+                                       const Entity_type type) const {
+  int first, count;
+  face_cells_of_type(faceid, type, &first, &count);
+  return Dir_View(face_cell_dirs[faceid].data() + first, count);
+}
+
+inline
+ArrayView<int>
+Mesh::face_get_cell_local_indices_view(const Entity_ID faceid,
+                                       const Entity_type type) const {
+  int first, count;
+  face_cells_of_type(faceid, type, &first, &count);
+  return ArrayView<int>(face_cell_slots[faceid].data() + first, count);
+}
+
+inline
+int Mesh::face_get_local_index_in_cell(const Entity_ID faceid,
+                                       const Entity_ID cellid) const {
+  if (!face2cell_info_cached) cache_face2cell_info();
+  cache_accessed(Mesh_cache::FACE2CELL);
+  std::array<Entity_ID, 2> const& fcells = face_cell_ids[faceid];
+  return (fcells[0] == cellid) ? face_cell_slots[faceid][0] :
+      (fcells[1] == cellid && cellid != -1) ? face_cell_slots[faceid][1] : -1;
+}
+
+inline
+dir_t Mesh::face_get_dir_in_cell(const Entity_ID faceid,
+                                 const Entity_ID cellid) const {
+  if (!face2cell_info_cached) cache_face2cell_info();
+  cache_accessed(Mesh_cache::FACE2CELL);
+  std::array<Entity_ID, 2> const& fcells = face_cell_ids[faceid];
+  return (fcells[0] == cellid) ? face_cell_dirs[faceid][0] :
+      (fcells[1] == cellid && cellid != -1) ? face_cell_dirs[faceid][1] : 0;
+}
+
+inline
+Entity_ID_View Mesh::node_get_cells_view(const Entity_ID nodeid,
+                                         const Entity_type type) const {
+  if (!node2cell_info_cached) cache_node2cell_info();
+  cache_accessed(Mesh_cache::NODE2CELL);
+  return slice_by_type(node_cell_ids[nodeid], type,
+                       [this](Entity_ID const c) { return cell_type[c]; });
+}
+
+inline
+Entity_ID_View Mesh::cell_get_sides_view(const Entity_ID cellid) const {
+  assert(sides_requested);
+  if (!side_info_cached) cache_side_info();
+  cache_accessed(Mesh_cache::SIDE);
+  return cell_side_ids[cellid];
+}
+
+inline
+Entity_ID_View Mesh::cell_get_corners_view(const Entity_ID cellid) const {
+  assert(corners_requested);
+  if (!corner_info_cached) cache_corner_info();
+  cache_accessed(Mesh_cache::CORNER);
+  return cell_corner_ids[cellid];
+}
+
+inline
+Entity_ID_View Mesh::node_get_corners_view(const Entity_ID nodeid,
+                                           const Entity_type type) const {
+  assert(corners_requested);
+  if (!corner_info_cached) cache_corner_info();
+  cache_accessed(Mesh_cache::CORNER);
+  return slice_by_type(node_corner_ids[nodeid], type,
+                       [this](Entity_ID const cn) {
+                         return cell_type[corner_get_cell(cn)];
+                       });
+}
+
+inline
+Entity_ID_View Mesh::corner_get_wedges_view(const Entity_ID cornerid) const {
+  assert(corners_requested);
+  if (!corner_info_cached) cache_corner_info();
+  cache_accessed(Mesh_cache::CORNER);
+  return corner_wedge_ids[cornerid];
+}
+
 // Inefficient fallback implementation - hopefully the derived class
 // has a more direct implementation
 
@@ -2215,6 +3069,106 @@ void Mesh::node_get_coordinates(const Entity_ID nodeid, double *ncoord) const {
 }
 
 
+template<typename Kernel>
+void Mesh::for_each_tile(Kernel const& kernel) const {
+  ThreadPool::instance().run(meshtiles.size(), [&](int itile, int ithread) {
+      kernel(static_cast<MeshTile const&>(*meshtiles[itile]), ithread);
+    });
+}
+
+
+template<typename Kernel>
+void Mesh::for_each_tile_by_color(Kernel const& kernel) const {
+  for (auto const& tileids : tile_colors())
+    ThreadPool::instance().run(tileids.size(), [&](int i, int ithread) {
+        kernel(static_cast<MeshTile const&>(*meshtiles[tileids[i]]),
+               ithread);
+      });
+}
+
+
+template<typename T, typename Kernel, typename Combine>
+T Mesh::reduce_tiles(T init, Kernel const& kernel,
+                     Combine const& combine) const {
+  // One slot per tile rather than per thread so that the partial
+  // results are combined in a fixed order
+
+  std::vector<T> partial(meshtiles.size(), init);
+  ThreadPool::instance().run(meshtiles.size(), [&](int itile, int ithread) {
+      partial[itile] =
+          kernel(static_cast<MeshTile const&>(*meshtiles[itile]), ithread);
+    });
+  for (auto const& p : partial)
+    init = combine(init, p);
+  return init;
+}
+
+
+template<typename Kernel>
+void Mesh::parallel_for(Entity_kind const kind, Entity_type const type,
+                        Kernel const& kernel, int const grain) const {
+  std::vector<Entity_ID> const& ents = entities(kind, type);
+  int const n = ents.size();
+  if (n == 0) return;
+
+  ThreadPool& pool = ThreadPool::instance();
+  int const blocksize = std::max(grain, 1);
+  int const nblocks = std::min((n + blocksize - 1)/blocksize,
+                               4*pool.num_threads());
+  int const chunk = n/nblocks;
+  int const remainder = n%nblocks;
+  pool.run(nblocks, [&](int iblock, int ithread) {
+      int const ibegin = iblock*chunk + std::min(iblock, remainder);
+      int const iend = ibegin + chunk + (iblock < remainder ? 1 : 0);
+      for (int i = ibegin; i < iend; i++)
+        kernel(ents[i], ithread);
+    });
+}
+
+
+
+template <class T>
+bool Mesh::store_field_array(std::string const& field_name,
+                             Entity_kind const on_what, T const *data) {
+  std::size_t const nbytes = num_entities(on_what, Entity_type::ALL)*sizeof(T);
+
+  auto it = fields_.find(field_name);
+  if (it == fields_.end()) {
+    FieldArray field = {on_what, std::type_index(typeid(T)),
+                        field_vartype(data, space_dim_),
+                        std::vector<char>(nbytes)};
+    it = fields_.emplace(field_name, std::move(field)).first;
+  } else if (it->second.kind != on_what ||
+             it->second.type != std::type_index(typeid(T))) {
+    return false;
+  } else {
+    it->second.values.resize(nbytes);  // the mesh may have been renumbered
+  }
+  if (nbytes) std::memcpy(it->second.values.data(), data, nbytes);
+  return true;
+}
+
+
+template <class T>
+bool Mesh::get_field_array(std::string const& field_name,
+                           Entity_kind const on_what, T *data) const {
+  T const *values = field_data<T>(field_name, on_what);
+  if (!values) return false;
+  std::copy(values, values + num_entities(on_what, Entity_type::ALL), data);
+  return true;
+}
+
+
+template <class T>
+T const * Mesh::field_data(std::string const& field_name,
+                           Entity_kind const kind) const {
+  auto it = fields_.find(field_name);
+  if (it == fields_.end() || it->second.kind != kind ||
+      it->second.type != std::type_index(typeid(T)))
+    return nullptr;
+  return reinterpret_cast<T const *>(it->second.values.data());
+}
+
 }  // end namespace Jali
 
 
@@ -0,0 +1,241 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+/*!
+ * @file   MeshCSR.hh
+ * @brief  Compressed row storage for cached one-to-many mesh adjacencies
+ *         and lightweight read-only views into it
+ *
+ */
+
+#ifndef _MeshCSR_hh_
+#define _MeshCSR_hh_
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "MeshDefs.hh"
+
+namespace Jali {
+
+/*!
+  @class ArrayView
+  @brief Read-only, non-owning view (pointer + length) of a contiguous
+  range of values
+
+  An ArrayView is only valid as long as the storage it points into is
+  not modified or destroyed. It can be used in range based for loops
+  and indexed like a std::vector
+*/
+
+template<typename T>
+class ArrayView {
+ public:
+  typedef T value_type;
+  typedef T const * const_iterator;
+  typedef T const * iterator;
+
+  ArrayView() : data_(nullptr), size_(0) {}
+  ArrayView(T const * const data, std::size_t const size) :
+      data_(data), size_(size) {}
+  ArrayView(std::vector<T> const& vec) :
+      data_(vec.data()), size_(vec.size()) {}
+
+  T const * begin() const { return data_; }
+  T const * end() const { return data_ + size_; }
+  T const * data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  T const& operator[](std::size_t const i) const {
+    assert(i < size_);
+    return data_[i];
+  }
+  T const& front() const { assert(size_); return data_[0]; }
+  T const& back() const { assert(size_); return data_[size_-1]; }
+
+  //! Sub-range [pos, pos+count) of this view
+
+  ArrayView<T> slice(std::size_t const pos, std::size_t const count) const {
+    assert(pos + count <= size_);
+    return ArrayView<T>(data_ + pos, count);
+  }
+
+  //! Copy contents into a std::vector (for callers that need ownership)
+
+  std::vector<T> to_vector() const {
+    return std::vector<T>(data_, data_ + size_);
+  }
+
+ private:
+  T const * data_;
+  std::size_t size_;
+};
+
+typedef ArrayView<Entity_ID> Entity_ID_View;
+typedef ArrayView<dir_t> Dir_View;
+typedef ArrayView<double> Coordinate_View;
+
+
+/*!
+  @class CSRArray
+  @brief One-to-many relationship stored in compressed row format
+
+  The entries of row i live in data[offsets[i], offsets[i+1]) so all
+  rows share two allocations instead of one heap allocation per row.
+  Rows are built either by appending them in order (append_row) or by
+  declaring all row sizes upfront (set_row_sizes) and then filling
+  them in any order through row_data()
+*/
+
+template<typename T>
+class CSRArray {
+ public:
+  CSRArray() : offsets_(1, 0) {}
+
+  //! Remove all rows
+
+  void clear() {
+    offsets_.assign(1, 0);
+    data_.clear();
+  }
+
+  //! Remove all rows and give the memory back
+
+  void release() {
+    std::vector<std::size_t>(1, 0).swap(offsets_);
+    std::vector<T>().swap(data_);
+  }
+
+  //! Reserve space for nrows rows with a total of nentries entries
+
+  void reserve(std::size_t const nrows, std::size_t const nentries) {
+    offsets_.reserve(nrows+1);
+    data_.reserve(nentries);
+  }
+
+  //! Append a row at the end
+
+  template<typename InputIterator>
+  void append_row(InputIterator first, InputIterator last) {
+    data_.insert(data_.end(), first, last);
+    offsets_.push_back(data_.size());
+  }
+
+  void append_row(std::vector<T> const& row) {
+    append_row(row.begin(), row.end());
+  }
+
+  //! Discard current contents and size the rows according to
+  //! rowsizes. Entries are value initialized and must be filled in
+  //! through row_data()
+
+  template<typename SizeType>
+  void set_row_sizes(std::vector<SizeType> const& rowsizes) {
+    std::size_t nrows = rowsizes.size();
+    offsets_.resize(nrows+1);
+    offsets_[0] = 0;
+    for (std::size_t i = 0; i < nrows; ++i)
+      offsets_[i+1] = offsets_[i] + rowsizes[i];
+    data_.assign(offsets_[nrows], T());
+  }
+
+  //! Number of rows
+
+  std::size_t num_rows() const { return offsets_.size()-1; }
+
+  //! Total number of entries in all rows
+
+  std::size_t num_entries() const { return data_.size(); }
+
+  //! Number of entries in a row
+
+  std::size_t row_size(std::size_t const i) const {
+    assert(i < num_rows());
+    return offsets_[i+1] - offsets_[i];
+  }
+
+  //! Read-only view of a row
+
+  ArrayView<T> row(std::size_t const i) const {
+    assert(i < num_rows());
+    return ArrayView<T>(data_.data() + offsets_[i],
+                        offsets_[i+1] - offsets_[i]);
+  }
+
+  ArrayView<T> operator[](std::size_t const i) const { return row(i); }
+
+  //! Writable pointer to the start of a row
+
+  T * row_data(std::size_t const i) {
+    assert(i < num_rows());
+    return data_.data() + offsets_[i];
+  }
+
+  //! Underlying offsets (size num_rows()+1) and flat entry arrays
+
+  std::vector<std::size_t> const& offsets() const { return offsets_; }
+  std::vector<T> const& data() const { return data_; }
+
+  //! Bytes held by this structure
+
+  std::size_t memory_size() const {
+    return (offsets_.capacity()*sizeof(std::size_t) +
+            data_.capacity()*sizeof(T));
+  }
+
+ private:
+  std::vector<std::size_t> offsets_;
+  std::vector<T> data_;
+};
+
+}  // end namespace Jali
+
+#endif  /* _MeshCSR_hh_ */
@@ -244,16 +244,20 @@ bool cell_valid_type(const Cell_type type) {
 }
 
 
-// Types of partitioners (partitioning scheme bundled into the name)
+// Types of partitioners (partitioning scheme bundled into the name).
+// RCB (recursive coordinate bisection) and HILBERT (Hilbert space
+// filling curve) are built into Jali and need no third party library
 
 enum class Partitioner_type : std::uint8_t {
     INDEX,
     BLOCK,
     METIS,
     ZOLTAN_GRAPH,
-    ZOLTAN_RCB
+    ZOLTAN_RCB,
+    RCB,
+    HILBERT
 };
-constexpr int NUM_PARTITIONER_TYPES = 5;
+constexpr int NUM_PARTITIONER_TYPES = 7;
 constexpr Partitioner_type PARTITIONER_DEFAULT = Partitioner_type::METIS;
 
 // Return an string description for each partitioner type
@@ -262,7 +266,8 @@ std::string Partitioner_type_string(const Partitioner_type partitioner_type) {
   static std::string partitioner_type_str[NUM_PARTITIONER_TYPES] =
       {"Partitioner_type::INDEX", "Partitioner_type::BLOCK",
        "Partitioner_type::METIS",
-       "Partitioner_type::ZOLTAN_GRAPH", "Partitioner_type::ZOLTAN_RCB"};
+       "Partitioner_type::ZOLTAN_GRAPH", "Partitioner_type::ZOLTAN_RCB",
+       "Partitioner_type::RCB", "Partitioner_type::HILBERT"};
 
   int iptype = static_cast<int>(partitioner_type);
   return (iptype >= 0 && iptype < NUM_PARTITIONER_TYPES) ?
@@ -277,6 +282,106 @@ std::ostream& operator<<(std::ostream& os,
   return os;
 }
 
+
+// Orderings of mesh entities that improve memory locality (see
+// Mesh::reorder_entities). NONE keeps the numbering of the mesh
+// framework; MORTON and HILBERT sort entities along a space filling
+// curve through their centroids; RCM applies reverse Cuthill-McKee
+// to the face adjacency graph of cells
+
+enum class Entity_ordering : std::uint8_t {
+    NONE,
+    MORTON,
+    HILBERT,
+    RCM
+};
+constexpr int NUM_ENTITY_ORDERINGS = 4;
+
+// Return an string description for each entity ordering
+inline
+std::string Entity_ordering_string(const Entity_ordering ordering) {
+  static std::string ordering_str[NUM_ENTITY_ORDERINGS] =
+      {"Entity_ordering::NONE", "Entity_ordering::MORTON",
+       "Entity_ordering::HILBERT", "Entity_ordering::RCM"};
+
+  int iordering = static_cast<int>(ordering);
+  return (iordering >= 0 && iordering < NUM_ENTITY_ORDERINGS) ?
+      ordering_str[iordering] : "";
+}
+
+// Output operator for Entity_ordering
+inline
+std::ostream& operator<<(std::ostream& os, const Entity_ordering& ordering) {
+  os << " " << Entity_ordering_string(ordering) << " ";
+  return os;
+}
+
+
+// Data that a Mesh builds on demand and caches (see Mesh::memory_report
+// and Mesh::release). Each cache belongs to one entity kind - the
+// kind of the entities it is indexed by
+
+enum class Mesh_cache : std::uint8_t {
+    CELL2NODE,
+    NODE2CELL,
+    CELL2FACE,
+    FACE2CELL,
+    FACE2NODE,
+    CELL2EDGE,
+    FACE2EDGE,
+    EDGE2NODE,
+    SIDE,                // side adjacencies (cell, face, edge, nodes, ...)
+    WEDGE,
+    CORNER,
+    NODE_COORDINATES,    // contiguous node coordinate arrays
+    CELL_GEOMETRY,       // volumes, centroids
+    FACE_GEOMETRY,       // areas, centroids, normals
+    EDGE_GEOMETRY,       // lengths, vectors
+    SIDE_GEOMETRY,       // volumes, facet normals
+    CORNER_GEOMETRY      // volumes
+};
+constexpr int NUM_MESH_CACHES = 17;
+
+// Return an string description for each mesh cache
+inline
+std::string Mesh_cache_string(const Mesh_cache cache) {
+  static std::string cache_str[NUM_MESH_CACHES] =
+      {"Mesh_cache::CELL2NODE", "Mesh_cache::NODE2CELL",
+       "Mesh_cache::CELL2FACE", "Mesh_cache::FACE2CELL",
+       "Mesh_cache::FACE2NODE", "Mesh_cache::CELL2EDGE",
+       "Mesh_cache::FACE2EDGE", "Mesh_cache::EDGE2NODE",
+       "Mesh_cache::SIDE", "Mesh_cache::WEDGE", "Mesh_cache::CORNER",
+       "Mesh_cache::NODE_COORDINATES", "Mesh_cache::CELL_GEOMETRY",
+       "Mesh_cache::FACE_GEOMETRY", "Mesh_cache::EDGE_GEOMETRY",
+       "Mesh_cache::SIDE_GEOMETRY", "Mesh_cache::CORNER_GEOMETRY"};
+
+  int icache = static_cast<int>(cache);
+  return (icache >= 0 && icache < NUM_MESH_CACHES) ? cache_str[icache] : "";
+}
+
+// Output operator for Mesh_cache
+inline
+std::ostream& operator<<(std::ostream& os, const Mesh_cache& cache) {
+  os << " " << Mesh_cache_string(cache) << " ";
+  return os;
+}
+
+// Entity kind that a mesh cache belongs to
+inline
+Entity_kind Mesh_cache_entity_kind(const Mesh_cache cache) {
+  static const Entity_kind cache_kind[NUM_MESH_CACHES] =
+      {Entity_kind::CELL, Entity_kind::NODE, Entity_kind::CELL,
+       Entity_kind::FACE, Entity_kind::FACE, Entity_kind::CELL,
+       Entity_kind::FACE, Entity_kind::EDGE, Entity_kind::SIDE,
+       Entity_kind::WEDGE, Entity_kind::CORNER, Entity_kind::NODE,
+       Entity_kind::CELL, Entity_kind::FACE, Entity_kind::EDGE,
+       Entity_kind::SIDE, Entity_kind::CORNER};
+
+  int icache = static_cast<int>(cache);
+  return (icache >= 0 && icache < NUM_MESH_CACHES) ? cache_kind[icache] :
+      Entity_kind::UNKNOWN_KIND;
+}
+
 }  // close namespace Jali
 
 
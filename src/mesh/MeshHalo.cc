@@ -0,0 +1,349 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "MeshHalo.hh"
+
+#include <mpi.h>
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+
+#include "errors.hh"
+#include "Mesh.hh"
+#include "MeshSet.hh"
+
+namespace Jali {
+
+namespace {
+
+// MPI tag of halo update messages
+
+int const halo_update_tag = 2701;
+
+// Send sendlists[p] to rank p for every rank p and return the lists
+// received from every rank
+
+std::vector<std::vector<Entity_ID>>
+exchange_lists(std::vector<std::vector<Entity_ID>> const& sendlists,
+               MPI_Comm comm) {
+  int nproc = sendlists.size();
+
+  std::vector<int> sendcounts(nproc), recvcounts(nproc);
+  for (int p = 0; p < nproc; p++)
+    sendcounts[p] = sendlists[p].size();
+  MPI_Alltoall(sendcounts.data(), 1, MPI_INT, recvcounts.data(), 1, MPI_INT,
+               comm);
+
+  std::vector<int> senddispls(nproc+1, 0), recvdispls(nproc+1, 0);
+  for (int p = 0; p < nproc; p++) {
+    senddispls[p+1] = senddispls[p] + sendcounts[p];
+    recvdispls[p+1] = recvdispls[p] + recvcounts[p];
+  }
+
+  std::vector<Entity_ID> sendbuf, recvbuf(recvdispls[nproc]);
+  sendbuf.reserve(senddispls[nproc]);
+  for (auto const& list : sendlists)
+    sendbuf.insert(sendbuf.end(), list.begin(), list.end());
+
+  MPI_Alltoallv(sendbuf.data(), sendcounts.data(), senddispls.data(), MPI_INT,
+                recvbuf.data(), recvcounts.data(), recvdispls.data(), MPI_INT,
+                comm);
+
+  std::vector<std::vector<Entity_ID>> recvlists(nproc);
+  for (int p = 0; p < nproc; p++)
+    recvlists[p].assign(recvbuf.begin() + recvdispls[p],
+                        recvbuf.begin() + recvdispls[p+1]);
+  return recvlists;
+}
+
+}  // namespace
+
+
+MeshHalo::MeshHalo(Mesh const& mesh, Entity_kind const kind) :
+    kind_(kind), comm_(mesh.get_comm()) {
+  std::vector<Entity_ID> owned, ghost;
+  switch (kind) {
+    case Entity_kind::NODE:
+      owned = mesh.nodes<Entity_type::PARALLEL_OWNED>();
+      ghost = mesh.nodes<Entity_type::PARALLEL_GHOST>();
+      break;
+    case Entity_kind::EDGE:
+      owned = mesh.edges<Entity_type::PARALLEL_OWNED>();
+      ghost = mesh.edges<Entity_type::PARALLEL_GHOST>();
+      break;
+    case Entity_kind::FACE:
+      owned = mesh.faces<Entity_type::PARALLEL_OWNED>();
+      ghost = mesh.faces<Entity_type::PARALLEL_GHOST>();
+      break;
+    case Entity_kind::CELL:
+      owned = mesh.cells<Entity_type::PARALLEL_OWNED>();
+      ghost = mesh.cells<Entity_type::PARALLEL_GHOST>();
+      break;
+    default: {
+      Errors::Message mesg("Halos can only be built for nodes, edges, faces and cells");
+      Exceptions::Jali_throw(mesg);
+    }
+  }
+
+  std::vector<Entity_ID> owned_gids(owned.size()), ghost_gids(ghost.size());
+  for (std::size_t i = 0; i < owned.size(); i++)
+    owned_gids[i] = mesh.GID(owned[i], kind);
+  for (std::size_t i = 0; i < ghost.size(); i++)
+    ghost_gids[i] = mesh.GID(ghost[i], kind);
+
+  build(owned, owned_gids, ghost, ghost_gids);
+}
+
+
+MeshHalo::MeshHalo(Entity_kind const kind,
+                   std::vector<Entity_ID> const& owned,
+                   std::vector<Entity_ID> const& owned_gids,
+                   std::vector<Entity_ID> const& ghost,
+                   std::vector<Entity_ID> const& ghost_gids,
+                   MPI_Comm comm) :
+    kind_(kind), comm_(comm) {
+  build(owned, owned_gids, ghost, ghost_gids);
+}
+
+
+// Find the owners of ghost entities through a directory distributed
+// by global ID (the entity with global ID g is registered on rank g %
+// nproc), so no rank ever needs the global list of entities. Each
+// rank then asks the owners of its ghosts to send their values; the
+// requests fix the order of the send and receive lists
+
+void MeshHalo::build(std::vector<Entity_ID> const& owned,
+                     std::vector<Entity_ID> const& owned_gids,
+                     std::vector<Entity_ID> const& ghost,
+                     std::vector<Entity_ID> const& ghost_gids) {
+  assert(owned.size() == owned_gids.size());
+  assert(ghost.size() == ghost_gids.size());
+
+  int nproc;
+  MPI_Comm_size(comm_, &nproc);
+  if (nproc == 1) return;
+
+  // Register owned entities with the directory
+
+  std::vector<std::vector<Entity_ID>> lists(nproc);
+  for (auto const& gid : owned_gids) {
+    assert(gid >= 0);
+    lists[gid % nproc].push_back(gid);
+  }
+  std::vector<std::vector<Entity_ID>> registered =
+      exchange_lists(lists, comm_);
+
+  std::unordered_map<Entity_ID, int> owner_of;
+  for (int p = 0; p < nproc; p++)
+    for (auto const& gid : registered[p])
+      owner_of[gid] = p;
+
+  // Ask the directory who owns our ghosts
+
+  for (auto& list : lists) list.clear();
+  for (auto const& gid : ghost_gids) {
+    assert(gid >= 0);
+    lists[gid % nproc].push_back(gid);
+  }
+  std::vector<std::vector<Entity_ID>> queries = exchange_lists(lists, comm_);
+
+  for (int p = 0; p < nproc; p++)
+    for (auto& gid : queries[p]) {
+      auto it = owner_of.find(gid);
+      if (it == owner_of.end()) {
+        Errors::Message mesg("Ghost entity has no owner on any rank");
+        Exceptions::Jali_throw(mesg);
+      }
+      gid = it->second;  // reply in place with the owner
+    }
+  std::vector<std::vector<Entity_ID>> owners = exchange_lists(queries, comm_);
+
+  // Request values of our ghosts from their owners. Replies come
+  // back in the order of the queries, so walk the ghosts in the same
+  // order as when the queries were made
+
+  std::vector<std::vector<Entity_ID>> requests(nproc), ghosts_of_owner(nproc);
+  std::vector<int> ireply(nproc, 0);
+  for (std::size_t i = 0; i < ghost.size(); i++) {
+    int d = ghost_gids[i] % nproc;
+    int owner = owners[d][ireply[d]++];
+    requests[owner].push_back(ghost_gids[i]);
+    ghosts_of_owner[owner].push_back(ghost[i]);
+  }
+  std::vector<std::vector<Entity_ID>> requested =
+      exchange_lists(requests, comm_);
+
+  std::unordered_map<Entity_ID, Entity_ID> owned_lid_of;
+  for (std::size_t i = 0; i < owned.size(); i++)
+    owned_lid_of[owned_gids[i]] = owned[i];
+
+  for (int p = 0; p < nproc; p++) {
+    if (requested[p].empty()) continue;
+    send_ranks_.push_back(p);
+    Entity_ID_List sendlids(requested[p].size());
+    for (std::size_t i = 0; i < requested[p].size(); i++)
+      sendlids[i] = owned_lid_of.at(requested[p][i]);
+    send_ids_.append_row(sendlids);
+  }
+
+  for (int p = 0; p < nproc; p++) {
+    if (ghosts_of_owner[p].empty()) continue;
+    recv_ranks_.push_back(p);
+    recv_ids_.append_row(ghosts_of_owner[p]);
+  }
+}
+
+
+HaloUpdate::HaloUpdate(std::shared_ptr<MeshHalo const> halo) :
+    halo_(halo), in_progress_(false) {
+  assert(halo_);
+}
+
+
+HaloUpdate::~HaloUpdate() {
+  if (in_progress_) finish();
+}
+
+
+void HaloUpdate::add(void *data, std::size_t const entity_bytes,
+                     std::shared_ptr<MeshSet> subset) {
+  if (in_progress_) {
+    Errors::Message mesg("Cannot add fields to a halo update in progress");
+    Exceptions::Jali_throw(mesg);
+  }
+  fields_.push_back({static_cast<char *>(data), entity_bytes, subset});
+}
+
+
+// Number of bytes exchanged for a list of entities
+
+std::size_t HaloUpdate::message_size(Entity_ID_View const& entities) const {
+  std::size_t nbytes = 0;
+  for (auto const& field : fields_) {
+    if (field.subset) {
+      for (auto const& ent : entities)
+        if (field.subset->index_in_set(ent) >= 0)
+          nbytes += field.entity_bytes;
+    } else {
+      nbytes += entities.size()*field.entity_bytes;
+    }
+  }
+  return nbytes;
+}
+
+
+void HaloUpdate::start() {
+  if (in_progress_) {
+    Errors::Message mesg("Halo update already in progress");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  MPI_Comm comm = halo_->comm();
+  int nrecv = halo_->num_recv_neighbors();
+  int nsend = halo_->num_send_neighbors();
+  requests_.resize(nrecv + nsend);
+
+  // Post receives first so that messages can land directly in the
+  // receive buffers
+
+  recv_buffers_.resize(nrecv);
+  for (int i = 0; i < nrecv; i++) {
+    recv_buffers_[i].resize(message_size(halo_->recv_entities(i)));
+    MPI_Irecv(recv_buffers_[i].data(), recv_buffers_[i].size(), MPI_BYTE,
+              halo_->recv_neighbor(i), halo_update_tag, comm, &(requests_[i]));
+  }
+
+  send_buffers_.resize(nsend);
+  for (int i = 0; i < nsend; i++) {
+    Entity_ID_View entities = halo_->send_entities(i);
+    std::vector<char>& buffer = send_buffers_[i];
+    buffer.resize(message_size(entities));
+
+    char *pos = buffer.data();
+    for (auto const& field : fields_)
+      for (auto const& ent : entities) {
+        Entity_ID slot = field.subset ? field.subset->index_in_set(ent) : ent;
+        if (slot < 0) continue;
+        std::memcpy(pos, field.data + slot*field.entity_bytes,
+                    field.entity_bytes);
+        pos += field.entity_bytes;
+      }
+
+    MPI_Isend(buffer.data(), buffer.size(), MPI_BYTE, halo_->send_neighbor(i),
+              halo_update_tag, comm, &(requests_[nrecv+i]));
+  }
+
+  in_progress_ = true;
+}
+
+
+void HaloUpdate::finish() {
+  if (!in_progress_) return;
+
+  MPI_Waitall(requests_.size(), requests_.data(), MPI_STATUSES_IGNORE);
+
+  int nrecv = halo_->num_recv_neighbors();
+  for (int i = 0; i < nrecv; i++) {
+    Entity_ID_View entities = halo_->recv_entities(i);
+    char const *pos = recv_buffers_[i].data();
+    for (auto const& field : fields_)
+      for (auto const& ent : entities) {
+        Entity_ID slot = field.subset ? field.subset->index_in_set(ent) : ent;
+        if (slot < 0) continue;
+        std::memcpy(field.data + slot*field.entity_bytes, pos,
+                    field.entity_bytes);
+        pos += field.entity_bytes;
+      }
+  }
+
+  in_progress_ = false;
+}
+
+}  // end namespace Jali
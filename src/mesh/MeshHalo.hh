@@ -0,0 +1,253 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _JALI_MESHHALO_H_
+#define _JALI_MESHHALO_H_
+
+#include <mpi.h>
+
+#include <cstddef>
+#include <vector>
+#include <memory>
+
+#include "MeshDefs.hh"
+#include "MeshCSR.hh"
+
+namespace Jali {
+
+class Mesh;
+class MeshSet;
+
+/*!
+  @class MeshHalo "MeshHalo.hh"
+  @brief Persistent plan for refreshing ghost copies of mesh entities
+
+  A halo lists, for one entity kind, which OWNED entities of this
+  rank have ghost copies on which other ranks (send lists) and which
+  GHOST entities of this rank are owned by which other ranks (receive
+  lists). The lists for a neighbor are in the same order on both
+  ranks, so data packed from a send list can be unpacked directly
+  into the matching receive list.
+
+  The plan is built once (collectively) from the global IDs of the
+  entities and reused by every exchange; see Mesh::halo() and
+  HaloUpdate. BOUNDARY_GHOST entities are never exchanged.
+*/
+
+class MeshHalo {
+ public:
+
+  /// @brief Build the plan for entities of 'kind' of 'mesh' (collective)
+
+  MeshHalo(Mesh const& mesh, Entity_kind const kind);
+
+  /*!
+    @brief Build the plan from lists of local and global IDs (collective)
+    @param kind          Kind of entities
+    @param owned         Local IDs of entities owned by this rank
+    @param owned_gids    Global IDs of the owned entities
+    @param ghost         Local IDs of ghost entities on this rank
+    @param ghost_gids    Global IDs of the ghost entities
+    @param comm          Communicator over which entities are distributed
+  */
+
+  MeshHalo(Entity_kind const kind,
+           std::vector<Entity_ID> const& owned,
+           std::vector<Entity_ID> const& owned_gids,
+           std::vector<Entity_ID> const& ghost,
+           std::vector<Entity_ID> const& ghost_gids,
+           MPI_Comm comm);
+
+  MeshHalo(MeshHalo const&) = delete;
+  MeshHalo & operator=(MeshHalo const&) = delete;
+
+  /// @brief Kind of entities exchanged by this plan
+
+  Entity_kind kind() const { return kind_; }
+
+  /// @brief Communicator of the plan
+
+  MPI_Comm comm() const { return comm_; }
+
+  /// @brief Number of ranks that have ghost copies of our entities
+
+  int num_send_neighbors() const { return send_ranks_.size(); }
+
+  /// @brief Rank of i'th send neighbor
+
+  int send_neighbor(int const i) const { return send_ranks_[i]; }
+
+  /// @brief Owned entities whose values are sent to i'th send neighbor
+
+  Entity_ID_View send_entities(int const i) const { return send_ids_[i]; }
+
+  /// @brief Number of ranks that own our ghost entities
+
+  int num_recv_neighbors() const { return recv_ranks_.size(); }
+
+  /// @brief Rank of i'th receive neighbor
+
+  int recv_neighbor(int const i) const { return recv_ranks_[i]; }
+
+  /// @brief Ghost entities whose values come from i'th receive neighbor
+
+  Entity_ID_View recv_entities(int const i) const { return recv_ids_[i]; }
+
+ private:
+
+  void build(std::vector<Entity_ID> const& owned,
+             std::vector<Entity_ID> const& owned_gids,
+             std::vector<Entity_ID> const& ghost,
+             std::vector<Entity_ID> const& ghost_gids);
+
+  Entity_kind kind_;
+  MPI_Comm comm_;
+  std::vector<int> send_ranks_, recv_ranks_;
+  CSRArray<Entity_ID> send_ids_, recv_ids_;
+};
+
+
+/*!
+  @class HaloUpdate "MeshHalo.hh"
+  @brief Non-blocking update of ghost values of one or more fields
+
+  Fields registered with add() are refreshed together, with one
+  message per neighbor rank carrying the values of all the
+  fields. start() packs and posts the messages and returns
+  immediately so that work on owned entities can overlap the
+  communication; finish() waits for the messages and writes the
+  received values into the ghost entries. The values of owned entries
+  must not change between start() and finish() and ghost entries must
+  not be read until finish() returns.
+
+  All ranks of the communicator must call start() and finish(), and
+  must register the same fields in the same order.
+
+  Example:
+
+      HaloUpdate update(mesh->halo(Entity_kind::CELL));
+      update.add(density_data);
+      update.add(velocity_data);
+      update.start();
+      ... compute on interior cells ...
+      update.finish();
+*/
+
+class HaloUpdate {
+ public:
+
+  explicit HaloUpdate(std::shared_ptr<MeshHalo const> halo);
+
+  /// @brief Waits for an update still in progress
+
+  ~HaloUpdate();
+
+  HaloUpdate(HaloUpdate const&) = delete;
+  HaloUpdate & operator=(HaloUpdate const&) = delete;
+
+  /// @brief Plan used by the update
+
+  std::shared_ptr<MeshHalo const> halo() const { return halo_; }
+
+  /// @brief Register a field with one value of type T per entity,
+  /// indexed by local entity ID. T must be trivially copyable
+
+  template<typename T>
+  void add(T *data) {
+    add(static_cast<void *>(data), sizeof(T));
+  }
+
+  /*!
+    @brief Register a field stored only on the entities of a set
+    @param data     Values indexed by position of the entity in the set
+    @param subset   Set of entities (must have a reverse map); an
+                    entity must be in the set on its owner rank exactly
+                    when it is in the set on the ranks that ghost it
+  */
+
+  template<typename T>
+  void add(T *data, std::shared_ptr<MeshSet> subset) {
+    add(static_cast<void *>(data), sizeof(T), subset);
+  }
+
+  /// @brief Register a field of 'entity_bytes' bytes per entity
+
+  void add(void *data, std::size_t const entity_bytes,
+           std::shared_ptr<MeshSet> subset = nullptr);
+
+  /// @brief Post the messages (collective, returns immediately)
+
+  void start();
+
+  /// @brief Complete the update started by start()
+
+  void finish();
+
+  /// @brief Is an update started but not finished?
+
+  bool in_progress() const { return in_progress_; }
+
+ private:
+
+  struct Field {
+    char *data;
+    std::size_t entity_bytes;
+    std::shared_ptr<MeshSet> subset;
+  };
+
+  std::size_t message_size(Entity_ID_View const& entities) const;
+
+  std::shared_ptr<MeshHalo const> halo_;
+  std::vector<Field> fields_;
+  std::vector<std::vector<char>> send_buffers_, recv_buffers_;
+  std::vector<MPI_Request> requests_;
+  bool in_progress_;
+};
+
+}  // end namespace Jali
+
+#endif  // _JALI_MESHHALO_H_
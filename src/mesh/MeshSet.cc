@@ -51,7 +51,9 @@
 #include <mpi.h>
 
 #include <vector>
+#include <string>
 #include <algorithm>
+#include <iterator>
 #include <memory>
 #include <cassert>
 
@@ -101,9 +103,14 @@ MeshSet::MeshSet(std::string const& name,
 }  // MeshSet::MeshSet
 
 
-// Add entity to meshset (no check for duplicates)
+// Add entity to meshset (ignored if it is already in the set). This
+// does not go through stage/commit - adding a ghost entity is O(1)
+// and adding an owned entity costs O(number of ghosts in the set)
 
 void MeshSet::add_entity(Entity_ID const& mesh_entity) {
+  build_reverse_map();
+  if (mesh2subset_[mesh_entity] >= 0) return;  // already in set
+
   Entity_type etype = mesh_.entity_get_type(kind_, mesh_entity);
 
   if (etype == Entity_type::PARALLEL_OWNED) {
@@ -112,158 +119,197 @@ void MeshSet::add_entity(Entity_ID const& mesh_entity) {
     entityids_owned_.push_back(mesh_entity);
     entityids_all_.insert(entityids_all_.begin()+nowned_old, mesh_entity);
 
-    if (have_reverse_map_) mesh2subset_[mesh_entity] = nowned_old;
+    int nall = entityids_all_.size();
+    for (int i = nowned_old; i < nall; i++)
+      mesh2subset_[entityids_all_[i]] = i;
 
   } else if (etype == Entity_type::PARALLEL_GHOST) {
 
     entityids_ghost_.push_back(mesh_entity);
-
     entityids_all_.push_back(mesh_entity);
-    if (have_reverse_map_) mesh2subset_[mesh_entity] = entityids_all_.size()-1;
-
-  } else
-    return;  // Doesn't make sense to add any other type like BOUNDARY_GHOST
+    mesh2subset_[mesh_entity] = entityids_all_.size()-1;
 
+  }  // Doesn't make sense to add any other type like BOUNDARY_GHOST
 }
 
 
-// Remove entity from meshset (PREFERABLY USE rem_entities)
+// Remove entity from meshset (PREFERABLY USE rem_entities). The last
+// owned or ghost entity takes the place of the removed one, so
+// removing a ghost entity is O(1) and removing an owned entity costs
+// O(number of ghosts in the set)
 
 void MeshSet::rem_entity(Entity_ID const& mesh_entity) {
-  Entity_type etype = mesh_.entity_get_type(kind_, mesh_entity);
-    int size;
-    if (etype == Entity_type::PARALLEL_OWNED) {
-      size = entityids_owned_.size();
-      auto const& it = std::find(entityids_owned_.begin(),
-                                 entityids_owned_.end(), mesh_entity);
-      if (it != entityids_owned_.end()) {
-        *it = entityids_owned_[size-1];  // replace mesh_entity with last entry
-        entityids_owned_.resize(size-1);
-      }
-    } else if (etype == Entity_type::PARALLEL_GHOST) {
-      size = entityids_ghost_.size();
-      auto const& it = std::find(entityids_ghost_.begin(),
-                                 entityids_ghost_.end(), mesh_entity);
-      if (it != entityids_ghost_.end()) {
-        *it = entityids_ghost_[size-1];  // replace mesh_entity with last entry
-        entityids_ghost_.resize(size-1);
-      }
-    }
-    else
-      return;  // No other type like BOUNDARY_GHOST can be part of set
-
-    size = entityids_all_.size();
-    auto const& it = std::find(entityids_all_.begin(),
-                               entityids_all_.end(), mesh_entity);
-    if (it != entityids_all_.end()) {
-      *it = entityids_all_[size-1];  // replace mesh_entity with last entry
-      entityids_all_.resize(size-1);
-    }
+  build_reverse_map();
+  int i = mesh2subset_[mesh_entity];
+  if (i < 0) return;  // not in set
+
+  int nowned = entityids_owned_.size();
+  mesh2subset_[mesh_entity] = -1;
+
+  if (i < nowned) {
+    entityids_owned_[i] = entityids_owned_[nowned-1];
+    entityids_owned_.pop_back();
+
+    entityids_all_[i] = entityids_all_[nowned-1];
+    entityids_all_.erase(entityids_all_.begin()+nowned-1);
+
+    int nall = entityids_all_.size();
+    if (i < nowned-1) mesh2subset_[entityids_all_[i]] = i;
+    for (int j = nowned-1; j < nall; j++)
+      mesh2subset_[entityids_all_[j]] = j;
+
+  } else {
+    int nall = entityids_all_.size();
+    entityids_ghost_[i-nowned] = entityids_ghost_[nall-nowned-1];
+    entityids_ghost_.pop_back();
+
+    entityids_all_[i] = entityids_all_[nall-1];
+    entityids_all_.pop_back();
 
-    if (have_reverse_map_) mesh2subset_[mesh_entity] = -1;
+    if (i < nall-1) mesh2subset_[entityids_all_[i]] = i;
   }
+}
 
 
-// Add a group of entities to meshset (no check for duplicates)
+// Add a group of entities to meshset (entities already in the set
+// are ignored)
 
 void MeshSet::add_entities(std::vector<Entity_ID> const& in_entities) {
-  int nowned_old = entityids_owned_.size();
-  int nghost_old = entityids_ghost_.size();
-  int nall = in_entities.size();
-  int nowned = 0;
-  int nghost = 0;
-  for (auto const& mesh_entity : in_entities) {
-    Entity_type etype = mesh_.entity_get_type(kind_, mesh_entity);
-    if (etype == Entity_type::PARALLEL_OWNED)
-      nowned++;
-    else if (etype == Entity_type::PARALLEL_GHOST)
-      nghost++;
-  }
-  if (nall == nowned)
-    entityids_owned_.insert(entityids_owned_.end(), in_entities.begin(),
-                            in_entities.end());
-  else if (nall == nghost)
-    entityids_owned_.insert(entityids_ghost_.end(), in_entities.begin(),
-                            in_entities.end());
-  else
-    for (auto const& mesh_entity : in_entities)
-      add_entity(mesh_entity);
-  
-  // entityids_all should always have owned entities first and ghost
-  // entities last - so we can't just put in entities at the end -
-  // we have to make a new list with the updated owned and ghost
-  // entities and concatenate them (if there are any ghosts)
-  
-  if (entityids_ghost_.size()) {
-    std::vector<Entity_ID> tmp_list(entityids_owned_);
-    tmp_list.insert(tmp_list.end(), entityids_ghost_.begin(),
-                    entityids_ghost_.end());
-    entityids_all_.swap(tmp_list);
-  } else
-    entityids_all_.insert(entityids_all_.begin(), in_entities.begin(),
-                          in_entities.end());
-
-  if (have_reverse_map_) {  // have to update mesh to subset map
-    // new owned entities should have gone in after old owned entities
-    int start = nowned_old;
-    for (int i = start; i < start + nowned; i++)
-      mesh2subset_[entityids_all_[i]] = i;
-    
-    // new ghost entities should have gone in after old+new owned
-    // entities and old ghost entities
-    start = nowned_old + nowned + nghost_old;
-    for (int i = start; i < start + nghost; i++)
-      mesh2subset_[entityids_all_[i]] = i;
-  }
+  stage_add_entities(in_entities);
+  commit();
 }
 
 
 // Remove a group of entities from a subset
 
 void MeshSet::rem_entities(std::vector<Entity_ID> const& in_entities) {
-  // Replace each to-be-removed entry with an entry from the end of
-  // the list.  Then shrink the lists.
-  
-  int size = entityids_owned_.size();
-  int ndel = 0;
-  for (auto const& mesh_entity : in_entities) {
-    Entity_type etype = mesh_.entity_get_type(kind_, mesh_entity);
-    if (etype == Entity_type::PARALLEL_OWNED) {
-      auto const& it = std::find(entityids_owned_.begin(),
-                                 entityids_owned_.end(), mesh_entity);
-      if (it != entityids_owned_.end()) {
-        *it = entityids_owned_[size-ndel-1];
-        ndel++;
-      }
+  stage_rem_entities(in_entities);
+  commit();
+}
+
+
+// Queue entities for addition to the set
+
+void MeshSet::stage_add_entities(std::vector<Entity_ID> const& in_entities) {
+  pending_add_.insert(pending_add_.end(), in_entities.begin(),
+                      in_entities.end());
+}
+
+
+// Queue entities for removal from the set
+
+void MeshSet::stage_rem_entities(std::vector<Entity_ID> const& in_entities) {
+  pending_rem_.insert(pending_rem_.end(), in_entities.begin(),
+                      in_entities.end());
+}
+
+
+// Apply queued removals and additions, rebuilding the entity lists
+// and the mesh to set map once
+
+void MeshSet::commit(std::vector<int> *new2old) {
+  int nowned_old = entityids_owned_.size();
+  int nall_old = entityids_all_.size();
+
+  if (!has_staged_changes()) {
+    if (new2old) {
+      new2old->resize(nall_old);
+      for (int i = 0; i < nall_old; i++) (*new2old)[i] = i;
     }
+    return;
   }
-  entityids_owned_.resize(size-ndel);
-  
-  size = entityids_ghost_.size();
-  ndel = 0;
-  for (auto const& mesh_entity : in_entities) {
-    auto const& it = std::find(entityids_ghost_.begin(),
-                               entityids_ghost_.end(), mesh_entity);
-    if (it != entityids_ghost_.end()) {
-      *it = entityids_ghost_[size-ndel-1];
-      ndel++;
+
+  // Build the mesh to set map if we don't have one - we need it to
+  // find entities without searching the lists
+
+  build_reverse_map();
+
+  // Tombstone the removed entries
+
+  std::vector<char> removed(nall_old, 0);
+  for (auto const& mesh_entity : pending_rem_) {
+    int i = mesh2subset_[mesh_entity];
+    if (i >= 0) {
+      removed[i] = 1;
+      mesh2subset_[mesh_entity] = -1;
     }
   }
-  entityids_ghost_.resize(size-ndel);
-  
-  size = entityids_all_.size();
-  ndel = 0;
-  for (auto const& mesh_entity : in_entities) {
-    auto const& it = std::find(entityids_all_.begin(),
-                               entityids_all_.end(), mesh_entity);
-    if (it != entityids_all_.end()) {
-      *it = entityids_all_[size-ndel-1];
-      ndel++;
+
+  // Compact the remaining entries and append the new ones. A
+  // provisional index of nall_old marks added entities so that
+  // duplicates are added only once
+
+  Entity_ID_List owned_list, ghost_list;
+  std::vector<int> owned_old, ghost_old;
+  owned_list.reserve(nowned_old + pending_add_.size());
+  owned_old.reserve(nowned_old + pending_add_.size());
+  for (int i = 0; i < nowned_old; i++)
+    if (!removed[i]) {
+      owned_list.push_back(entityids_all_[i]);
+      owned_old.push_back(i);
     }
+  for (int i = nowned_old; i < nall_old; i++)
+    if (!removed[i]) {
+      ghost_list.push_back(entityids_all_[i]);
+      ghost_old.push_back(i);
+    }
+
+  for (auto const& mesh_entity : pending_add_) {
+    if (mesh2subset_[mesh_entity] >= 0) continue;  // already in set
+
+    // Doesn't make sense to add any other type like BOUNDARY_GHOST
+    Entity_type etype = mesh_.entity_get_type(kind_, mesh_entity);
+    if (etype == Entity_type::PARALLEL_OWNED) {
+      owned_list.push_back(mesh_entity);
+      owned_old.push_back(-1);
+    } else if (etype == Entity_type::PARALLEL_GHOST) {
+      ghost_list.push_back(mesh_entity);
+      ghost_old.push_back(-1);
+    } else
+      continue;
+    mesh2subset_[mesh_entity] = nall_old;
+  }
+
+  pending_add_.clear();
+  pending_rem_.clear();
+
+  entityids_owned_.swap(owned_list);
+  entityids_ghost_.swap(ghost_list);
+  entityids_all_ = entityids_owned_;
+  entityids_all_.insert(entityids_all_.end(), entityids_ghost_.begin(),
+                        entityids_ghost_.end());
+
+  int nall = entityids_all_.size();
+  for (int i = 0; i < nall; i++)
+    mesh2subset_[entityids_all_[i]] = i;
+
+  if (new2old) {
+    new2old->swap(owned_old);
+    new2old->insert(new2old->end(), ghost_old.begin(), ghost_old.end());
   }
-  entityids_all_.resize(size-ndel);
+}
+
+// Build the mesh to set map if the set does not have one
+
+void MeshSet::build_reverse_map() {
+  if (have_reverse_map_) return;
+  have_reverse_map_ = true;
+  mesh2subset_.assign(mesh_.num_entities(kind_, Entity_type::ALL), -1);
+  int nall = entityids_all_.size();
+  for (int i = 0; i < nall; ++i)
+    mesh2subset_[entityids_all_[i]] = i;
+}
+
+// Map the entity IDs of the set to the new IDs of the mesh entities
+
+void MeshSet::renumber(std::vector<Entity_ID> const& old2new) {
+  for (auto list : {&entityids_owned_, &entityids_ghost_, &entityids_all_,
+          &pending_add_, &pending_rem_})
+    for (auto& e : *list)
+      e = old2new[e];
 
   if (have_reverse_map_) {
+    mesh2subset_.assign(old2new.size(), -1);
     int nall = entityids_all_.size();
     for (int i = 0; i < nall; i++)
       mesh2subset_[entityids_all_[i]] = i;
@@ -298,6 +344,142 @@ std::shared_ptr<MeshSet> make_meshset(std::string const& name,
 }
 
 
+// Helpers for set algebra on lists of entity IDs
+
+namespace {
+
+// Use a dense bitmap over the range of entity IDs rather than sorting
+// when the input lists have at least one entry per this many IDs
+
+int const bitmap_density_ratio = 16;
+
+enum class Set_operation {UNION, INTERSECTION, DIFFERENCE};
+
+// Combine lists of entity IDs in the range [idmin, idmax) and return
+// the result sorted and without duplicates. For DIFFERENCE the result
+// is the entries of the first list that are in none of the others.
+// All lists are combined in one pass - sparse lists by sorting and
+// merging (O(n log n)), dense lists by marking them in a bitmap
+// (O(n + idmax - idmin))
+
+Entity_ID_List combine_lists(std::vector<Entity_ID_List const *> const& lists,
+                             Set_operation const op,
+                             int const idmin, int const idmax) {
+  Entity_ID_List result;
+  int nlists = lists.size();
+  if (!nlists) return result;
+
+  std::size_t total = 0;
+  for (auto const& list : lists)
+    total += list->size();
+  std::size_t range = idmax - idmin;
+
+  if (total*bitmap_density_ratio >= range) {
+
+    // Entry for an ID is the number of lists (in order) that have it
+    // so far, which also takes care of duplicates within a list
+
+    std::vector<int> count(range, 0);
+    for (int k = 0; k < nlists; k++) {
+      for (auto const& ent : *(lists[k])) {
+        assert(ent >= idmin && ent < idmax);
+        int& c = count[ent-idmin];
+        if (op == Set_operation::UNION)
+          c = 1;
+        else if (op == Set_operation::INTERSECTION) {
+          if (c == k) c = k+1;
+        } else {  // DIFFERENCE
+          c = (k == 0) ? 1 : 0;
+        }
+      }
+    }
+    int wanted = (op == Set_operation::INTERSECTION) ? nlists : 1;
+    for (std::size_t i = 0; i < range; i++)
+      if (count[i] == wanted)
+        result.push_back(idmin+i);
+
+  } else {
+
+    auto sorted_copy = [](Entity_ID_List const& list) {
+      Entity_ID_List sorted(list);
+      if (!std::is_sorted(sorted.begin(), sorted.end()))
+        std::sort(sorted.begin(), sorted.end());
+      sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+      return sorted;
+    };
+
+    // Sorted union of lists[ibegin, nlists)
+    auto sorted_union = [&](int const ibegin) {
+      Entity_ID_List all;
+      std::size_t n = 0;
+      for (int k = ibegin; k < nlists; k++) n += lists[k]->size();
+      all.reserve(n);
+      for (int k = ibegin; k < nlists; k++)
+        all.insert(all.end(), lists[k]->begin(), lists[k]->end());
+      std::sort(all.begin(), all.end());
+      all.erase(std::unique(all.begin(), all.end()), all.end());
+      return all;
+    };
+
+    if (op == Set_operation::UNION) {
+      result = sorted_union(0);
+    } else if (op == Set_operation::INTERSECTION) {
+      // Start with the smallest list so that the result stays small
+      int kmin = 0;
+      for (int k = 1; k < nlists; k++)
+        if (lists[k]->size() < lists[kmin]->size()) kmin = k;
+      result = sorted_copy(*(lists[kmin]));
+      Entity_ID_List tmp;
+      for (int k = 0; k < nlists && !result.empty(); k++) {
+        if (k == kmin) continue;
+        Entity_ID_List other = sorted_copy(*(lists[k]));
+        tmp.clear();
+        std::set_intersection(result.begin(), result.end(),
+                              other.begin(), other.end(),
+                              std::back_inserter(tmp));
+        result.swap(tmp);
+      }
+    } else {  // DIFFERENCE
+      Entity_ID_List first = sorted_copy(*(lists[0]));
+      Entity_ID_List rest = sorted_union(1);
+      std::set_difference(first.begin(), first.end(),
+                          rest.begin(), rest.end(),
+                          std::back_inserter(result));
+    }
+  }
+
+  return result;
+}
+
+// Entity lists of one parallel type from a group of sets
+
+std::vector<Entity_ID_List const *>
+set_lists(std::vector<std::shared_ptr<MeshSet>> const& sets,
+          Entity_type const type) {
+  std::vector<Entity_ID_List const *> lists;
+  lists.reserve(sets.size());
+  for (auto const& set : sets)
+    lists.push_back(type == Entity_type::PARALLEL_OWNED ?
+                    &(set->entities<Entity_type::PARALLEL_OWNED>()) :
+                    &(set->entities<Entity_type::PARALLEL_GHOST>()));
+  return lists;
+}
+
+// Name of the union of sets (as given by merge)
+
+std::string union_name(std::vector<std::shared_ptr<MeshSet>> const& sets) {
+  if (sets.size() == 1) return sets[0]->name();
+  std::string name = "(" + sets[0]->name() + ")";
+  for (auto const& set : sets) {
+    if (set == sets[0]) continue;
+    name += "_PLUS_(" + set->name() + ")";
+  }
+  return name;
+}
+
+}  // end anonymous namespace
+
+
 // Union of two or more mesh sets
 
 std::shared_ptr<MeshSet>
@@ -314,45 +496,23 @@ merge(std::vector<std::shared_ptr<MeshSet>> const& inpsets, bool temporary) {
     assert(set0->kind_ == set->kind_);
   }
 
-  
-  // Add elements that are in any of the sets to result
-  
-  Entity_ID_List owned_list = set0->entityids_owned_;
-  int maxownsize = 0;
-  for (auto const& set : inpsets)
-    maxownsize += set->entityids_owned_.size();
-  owned_list.reserve(maxownsize);
+  // Add elements that are in any of the sets to result (in one pass
+  // over all the sets)
 
-  for (auto const& set : inpsets) {
-    if (set == set0) continue;
-    for (auto const& ent : set->entityids_owned_)
-      if (std::find(owned_list.begin(), owned_list.end(), ent) ==
-          owned_list.end())
-        owned_list.push_back(ent);
-  }
-  
-  
-  Entity_ID_List ghost_list = set0->entityids_ghost_;
-  int maxghostsize = 0;
-  for (auto const& set : inpsets)
-    maxghostsize += set->entityids_ghost_.size();
-  ghost_list.reserve(maxghostsize);
+  int nent_owned = set0->mesh_.num_entities(set0->kind_,
+                                            Entity_type::PARALLEL_OWNED);
+  int nent_ghost = set0->mesh_.num_entities(set0->kind_,
+                                            Entity_type::PARALLEL_GHOST);
+
+  Entity_ID_List owned_list =
+      combine_lists(set_lists(inpsets, Entity_type::PARALLEL_OWNED),
+                    Set_operation::UNION, 0, nent_owned);
+  Entity_ID_List ghost_list =
+      combine_lists(set_lists(inpsets, Entity_type::PARALLEL_GHOST),
+                    Set_operation::UNION, nent_owned, nent_owned+nent_ghost);
+
+  std::string newname = union_name(inpsets);
 
-  for (auto const& set : inpsets) {
-    if (set == set0) continue;
-    for (auto const& ent : set->entityids_ghost_)
-      if (std::find(ghost_list.begin(), ghost_list.end(), ent) ==
-          ghost_list.end())
-        ghost_list.push_back(ent);
-  }
-  
-  
-  std::string newname = "(" + set0->name_ + ")";
-  for (auto const& set : inpsets) {
-    if (set == set0) continue;
-    newname += "_PLUS_(" + set->name_ + ")";
-  }
-  
   // If either of these sets has the reverse map, then the result has it too
   bool build_reverse_map = set0->mesh2subset_.size() ? true : false;
   
@@ -374,37 +534,34 @@ std::shared_ptr<MeshSet>
 subtract(std::shared_ptr<MeshSet> const& set0,
          std::vector<std::shared_ptr<MeshSet>> const& subtractsets,
          bool temporary) {
+  assert(subtractsets.size());
 
   for (auto const& set : subtractsets) {
     assert(&(set0->mesh_) == &(set->mesh_));
     assert(set0->kind_ == set->kind_);
   }
 
-  // Make a temporary union of all the sets to be subtracted
-  std::shared_ptr<MeshSet> setunion = merge(subtractsets, true);
-
   // Add elements that are in set0 and but not in the rest of the sets
   // to the result
-  
-  Entity_ID_List owned_list;
-  owned_list.reserve(set0->entityids_owned_.size());
-  for (auto const& ent : set0->entityids_owned_) {
-    if (std::find(setunion->entityids_owned_.begin(),
-                  setunion->entityids_owned_.end(),
-                  ent) == setunion->entityids_owned_.end())
-      owned_list.push_back(ent);
-  }
-  
-  Entity_ID_List ghost_list;
-  ghost_list.reserve(set0->entityids_ghost_.size());
-  for (auto const& ent : set0->entityids_ghost_) {
-    if (std::find(setunion->entityids_ghost_.begin(),
-                  setunion->entityids_ghost_.end(),
-                  ent) == setunion->entityids_ghost_.end())
-      ghost_list.push_back(ent);
-  }
-  
-  std::string newname = "(" + set0->name_ + ")_MINUS_(" + setunion->name_ + ")";
+
+  int nent_owned = set0->mesh_.num_entities(set0->kind_,
+                                            Entity_type::PARALLEL_OWNED);
+  int nent_ghost = set0->mesh_.num_entities(set0->kind_,
+                                            Entity_type::PARALLEL_GHOST);
+
+  std::vector<std::shared_ptr<MeshSet>> allsets(1, set0);
+  allsets.insert(allsets.end(), subtractsets.begin(), subtractsets.end());
+
+  Entity_ID_List owned_list =
+      combine_lists(set_lists(allsets, Entity_type::PARALLEL_OWNED),
+                    Set_operation::DIFFERENCE, 0, nent_owned);
+  Entity_ID_List ghost_list =
+      combine_lists(set_lists(allsets, Entity_type::PARALLEL_GHOST),
+                    Set_operation::DIFFERENCE,
+                    nent_owned, nent_owned+nent_ghost);
+
+  std::string newname = "(" + set0->name_ + ")_MINUS_(" +
+      union_name(subtractsets) + ")";
 
   // If either of these sets has the reverse map, then the result has it too
   bool build_reverse_map = set0->mesh2subset_.size() ? true : false;
@@ -433,44 +590,20 @@ intersect(std::vector<std::shared_ptr<MeshSet>> const& inpsets,
   }
 
   // Add elements that are in every set to the result
-  
-  Entity_ID_List owned_list;
-  owned_list.reserve(set0->entityids_owned_.size());
-  for (auto const& ent : set0->entityids_owned_) {
-    bool present_in_all = true;
-    for (auto const& set : inpsets) {
-      if (set == set0) continue;
-      if (std::find(set->entityids_owned_.begin(),
-                    set->entityids_owned_.end(),
-                    ent) == set->entityids_owned_.end()) {
-        present_in_all = false;
-        break;
-      }
-      if (!present_in_all) break;
-    }
-    if (present_in_all)
-      owned_list.push_back(ent);
-  }
-  
-  Entity_ID_List ghost_list;
-  ghost_list.reserve(set0->entityids_ghost_.size());
-  for (auto const& ent : set0->entityids_ghost_) {
-    bool present_in_all = true;
-    for (auto const& set : inpsets) {
-      if (set == set0) continue;
-      if (std::find(set->entityids_ghost_.begin(),
-                    set->entityids_ghost_.end(),
-                    ent) == set->entityids_ghost_.end()) {
-        present_in_all = false;
-        break;
-      }
-      if (!present_in_all) break;
-    }
-    if (present_in_all)
-      ghost_list.push_back(ent);
-  }
-  
-  
+
+  int nent_owned = set0->mesh_.num_entities(set0->kind_,
+                                            Entity_type::PARALLEL_OWNED);
+  int nent_ghost = set0->mesh_.num_entities(set0->kind_,
+                                            Entity_type::PARALLEL_GHOST);
+
+  Entity_ID_List owned_list =
+      combine_lists(set_lists(inpsets, Entity_type::PARALLEL_OWNED),
+                    Set_operation::INTERSECTION, 0, nent_owned);
+  Entity_ID_List ghost_list =
+      combine_lists(set_lists(inpsets, Entity_type::PARALLEL_GHOST),
+                    Set_operation::INTERSECTION,
+                    nent_owned, nent_owned+nent_ghost);
+
   std::string newname = "(" + set0->name_ + ")";
   for (auto const& set : inpsets) {
     if (set == set0) continue;
@@ -501,27 +634,35 @@ complement(std::vector<std::shared_ptr<MeshSet>> inpsets, bool temporary) {
   int nent_ghost = set0->mesh_.num_entities(set0->kind_,
                                             Entity_type::PARALLEL_GHOST);
 
-  // Create a temporary union of the input sets
-
-  std::shared_ptr<MeshSet> setunion = merge(inpsets, true);
-
-  Entity_ID_List owned_list;
-  owned_list.reserve(nent_owned - setunion->entityids_owned_.size());
-  for (int ent = 0; ent < nent_owned; ent++)
-    if (std::find(setunion->entityids_owned_.begin(),
-                  setunion->entityids_owned_.end(),
-                  ent) == setunion->entityids_owned_.end())
-      owned_list.push_back(ent);
-  
-  Entity_ID_List ghost_list;
-  ghost_list.reserve(nent_ghost - setunion->entityids_ghost_.size());
-  for (int ent = 0; ent < nent_ghost; ent++)
-    if (std::find(setunion->entityids_ghost_.begin(),
-                  setunion->entityids_ghost_.end(),
-                  ent) == setunion->entityids_ghost_.end())
-      ghost_list.push_back(ent);
-  
-  std::string newname = "NOT_(" + setunion->name_ + ")";
+  // Union of the input sets (sorted) and the IDs not in it
+
+  auto complement_list = [](Entity_ID_List const& sorted_union,
+                            int const idmin, int const idmax) {
+    Entity_ID_List list;
+    list.reserve(idmax - idmin - sorted_union.size());
+    auto it = sorted_union.begin();
+    for (int ent = idmin; ent < idmax; ent++) {
+      if (it != sorted_union.end() && *it == ent)
+        ++it;
+      else
+        list.push_back(ent);
+    }
+    return list;
+  };
+
+  Entity_ID_List owned_list =
+      complement_list(combine_lists(set_lists(inpsets,
+                                              Entity_type::PARALLEL_OWNED),
+                                    Set_operation::UNION, 0, nent_owned),
+                      0, nent_owned);
+  Entity_ID_List ghost_list =
+      complement_list(combine_lists(set_lists(inpsets,
+                                              Entity_type::PARALLEL_GHOST),
+                                    Set_operation::UNION,
+                                    nent_owned, nent_owned+nent_ghost),
+                      nent_owned, nent_owned+nent_ghost);
+
+  std::string newname = "NOT_(" + union_name(inpsets) + ")";
   
   // If this set has the reverse map, then the result has it too
   bool build_reverse_map = set0->mesh2subset_.size() ? true : false;
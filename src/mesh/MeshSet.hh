@@ -131,7 +131,9 @@ class MeshSet {
       entityids_ghost_(meshset_in.entityids_ghost_),
       entityids_all_(meshset_in.entityids_all_),
       have_reverse_map_(meshset_in.have_reverse_map_),
-      mesh2subset_(meshset_in.mesh2subset_) {}
+      mesh2subset_(meshset_in.mesh2subset_),
+      pending_add_(meshset_in.pending_add_),
+      pending_rem_(meshset_in.pending_rem_) {}
 
   /// @brief Assignment operator - deleted because we cannot reassign
   /// the reference to the Mesh
@@ -226,15 +228,18 @@ class MeshSet {
     return (mesh2subset_.size() ? mesh2subset_[mesh_entity] : -1);
   }
   
-  /// @brief add entity to meshset (no check for duplicates)
+  /// @brief add entity to meshset (ignored if already in the set;
+  /// applied immediately, not through stage/commit)
 
   void add_entity(Entity_ID const& mesh_entity);
 
-  /// @brief rem entity from meshset (PREFERABLY USE rem_entities)
+  /// @brief rem entity from meshset (PREFERABLY USE rem_entities;
+  /// the last owned or ghost entity takes its place in the set)
 
   void rem_entity(Entity_ID const& mesh_entity);
 
-  /// @brief add a group of entities to meshset (no check for duplicates)
+  /// @brief add a group of entities to meshset (entities already in
+  /// the set are ignored)
 
   void add_entities(std::vector<Entity_ID> const& entities);
 
@@ -242,15 +247,64 @@ class MeshSet {
 
   void rem_entities(std::vector<Entity_ID> const& entities);
 
+  /// @brief Queue entities to be added to the set by the next commit()
+
+  void stage_add_entities(std::vector<Entity_ID> const& entities);
+
+  /// @brief Queue entities to be removed from the set by the next commit()
+
+  void stage_rem_entities(std::vector<Entity_ID> const& entities);
+
+  /// @brief Are there queued additions or removals?
+
+  bool has_staged_changes() const {
+    return !pending_add_.empty() || !pending_rem_.empty();
+  }
+
+  /*!
+    @brief Apply all queued removals and then all queued additions
+    @param new2old   If not null, filled with the index in the set
+                     before the commit of each entity in the set after
+                     the commit (-1 for added entities)
+
+    Membership queries (entities, index_in_set, num_entities) reflect
+    the set before the commit until commit() is called. Removals cost
+    O(1) each (through the mesh to set map, which is built first if
+    the set did not have one) and the entity lists are compacted once
+    per commit. Remaining entities keep their relative order; added
+    owned entities go after the remaining owned entities and added
+    ghost entities after the remaining ghost entities, so data stored
+    in set order can be carried over using 'new2old'
+  */
+
+  void commit(std::vector<int> *new2old = nullptr);
+
+  /*!
+    @brief Replace the IDs of the entities after the mesh renumbered them
+    @param old2new   New ID of each mesh entity of the set's kind
+
+    Entities keep their position in the set (and queued changes are
+    renumbered too) so data stored in set order stays valid
+  */
+
+  void renumber(std::vector<Entity_ID> const& old2new);
+
   void clear() {
     entityids_owned_.clear();
     entityids_ghost_.clear();
     entityids_all_.clear();
     mesh2subset_.clear();
+    pending_add_.clear();
+    pending_rem_.clear();
     name_ = "";
     kind_ = Entity_kind::UNKNOWN_KIND;
   }
 
+  // The set operations below combine any number of sets in one pass,
+  // by sorting and merging the entity lists or, if the sets are dense
+  // relative to the number of mesh entities, by marking them in a
+  // bitmap. Entities of the resulting sets are sorted by ID.
+
   /// @brief Union of arbitrary number of mesh sets
   ///
   /// @param inpsets     Sets to be unioned
@@ -310,6 +364,14 @@ class MeshSet {
   bool have_reverse_map_;
   Entity_ID_List mesh2subset_;
 
+  // Changes queued for the next commit
+
+  Entity_ID_List pending_add_, pending_rem_;
+
+  // Build the mesh to set map if the set does not have one
+
+  void build_reverse_map();
+
   // Make the State class a friend so that it can access protected
   // methods for retrieving and storing mesh fields
 
@@ -0,0 +1,520 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "MeshSnapshot.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "Mesh.hh"
+#include "MeshSet.hh"
+#include "MeshTile.hh"
+#include "instrumentation.hh"
+
+namespace Jali {
+
+namespace {
+
+char const SNAPSHOT_MAGIC[8] = {'J', 'A', 'L', 'I', 'S', 'N', 'A', 'P'};
+std::uint32_t const SNAPSHOT_BYTE_ORDER = 0x01020304;
+std::size_t const SNAPSHOT_ALIGNMENT = 64;
+
+// Stream sections into a snapshot file and write the section table
+// and header at the end
+
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(std::string const& filename) :
+      filename_(filename),
+      os_(filename.c_str(), std::ios::binary | std::ios::trunc) {
+    if (!os_) {
+      Errors::Message mesg("Cannot open snapshot file " + filename +
+                           " for writing");
+      Exceptions::Jali_throw(mesg);
+    }
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    os_.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    pos_ = sizeof(header);
+  }
+
+  template<typename T>
+  void add(std::string const& name, T const * const data,
+           std::size_t const n) {
+    if (name.size() >= sizeof(SnapshotSection::name)) {
+      Errors::Message mesg("Snapshot section name too long: " + name);
+      Exceptions::Jali_throw(mesg);
+    }
+    pad();
+    SnapshotSection section;
+    std::memset(&section, 0, sizeof(section));
+    std::strncpy(section.name, name.c_str(), sizeof(section.name)-1);
+    section.offset = pos_;
+    section.nbytes = n*sizeof(T);
+    table_.push_back(section);
+    os_.write(reinterpret_cast<char const *>(data), section.nbytes);
+    pos_ += section.nbytes;
+  }
+
+  template<typename T>
+  void add(std::string const& name, std::vector<T> const& values) {
+    add(name, values.data(), values.size());
+  }
+
+  // One-to-many relationship with rows get_row(i, &row), i < nrows
+
+  template<typename T, typename GetRow>
+  void add_csr(std::string const& name, int const nrows, GetRow get_row) {
+    std::vector<std::uint64_t> offsets(1, 0);
+    offsets.reserve(nrows+1);
+    std::vector<T> data, row;
+    for (int i = 0; i < nrows; i++) {
+      get_row(i, &row);
+      data.insert(data.end(), row.begin(), row.end());
+      offsets.push_back(data.size());
+    }
+    add(name + ".offsets", offsets);
+    add(name + ".data", data);
+  }
+
+  // Same with a direction for each entry, get_row(i, &row, &dirs)
+
+  template<typename GetRow>
+  void add_csr_with_dirs(std::string const& name, int const nrows,
+                         GetRow get_row) {
+    std::vector<std::uint64_t> offsets(1, 0);
+    offsets.reserve(nrows+1);
+    std::vector<Entity_ID> data, row;
+    std::vector<dir_t> dirs, rowdirs;
+    for (int i = 0; i < nrows; i++) {
+      get_row(i, &row, &rowdirs);
+      data.insert(data.end(), row.begin(), row.end());
+      dirs.insert(dirs.end(), rowdirs.begin(), rowdirs.end());
+      offsets.push_back(data.size());
+    }
+    add(name + ".offsets", offsets);
+    add(name + ".data", data);
+    add(name + ".dirs", dirs);
+  }
+
+  void finish(SnapshotHeader header) {
+    pad();
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.id_size = sizeof(Entity_ID);
+    header.num_sections = table_.size();
+    header.table_offset = pos_;
+    header.file_size = pos_ + table_.size()*sizeof(SnapshotSection);
+    os_.write(reinterpret_cast<char const *>(table_.data()),
+              table_.size()*sizeof(SnapshotSection));
+    os_.seekp(0);
+    os_.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    os_.close();
+    if (!os_) {
+      Errors::Message mesg("Error writing snapshot file " + filename_);
+      Exceptions::Jali_throw(mesg);
+    }
+  }
+
+ private:
+  void pad() {
+    static char const zeros[SNAPSHOT_ALIGNMENT] = {};
+    std::size_t const npad = (SNAPSHOT_ALIGNMENT -
+                              pos_ % SNAPSHOT_ALIGNMENT) % SNAPSHOT_ALIGNMENT;
+    os_.write(zeros, npad);
+    pos_ += npad;
+  }
+
+  std::string filename_;
+  std::ofstream os_;
+  std::uint64_t pos_ = 0;
+  std::vector<SnapshotSection> table_;
+};
+
+}  // namespace
+
+
+std::string snapshot_filename(std::string const& filename,
+                              MPI_Comm const comm) {
+  int nprocs, rank;
+  MPI_Comm_size(comm, &nprocs);
+  MPI_Comm_rank(comm, &rank);
+  if (nprocs == 1) return filename;
+
+  std::stringstream name;
+  name << filename << "." << nprocs << "." << rank;
+  return name.str();
+}
+
+
+bool is_mesh_snapshot(std::string const& filename, MPI_Comm const comm) {
+  char magic[sizeof(SNAPSHOT_MAGIC)] = {};
+  std::ifstream is(snapshot_filename(filename, comm).c_str(),
+                   std::ios::binary);
+  if (is) is.read(magic, sizeof(magic));
+  int local = (is && std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0);
+  int global = 0;
+  MPI_Allreduce(&local, &global, 1, MPI_INT, MPI_MIN, comm);
+  return global != 0;
+}
+
+
+// -------------------------------------------------------------
+//  class MeshSnapshotFile
+// -------------------------------------------------------------
+
+MeshSnapshotFile::MeshSnapshotFile(std::string const& filename,
+                                   MPI_Comm const comm) :
+    filename_(snapshot_filename(filename, comm)) {
+  JALI_TIME_SCOPE("MeshSnapshotFile::map");
+
+  int const fd = open(filename_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    Errors::Message mesg("Cannot open snapshot file " + filename_);
+    Exceptions::Jali_throw(mesg);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<std::size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+    close(fd);
+    Errors::Message mesg("Snapshot file " + filename_ + " is truncated");
+    Exceptions::Jali_throw(mesg);
+  }
+  size_ = st.st_size;
+
+  // Private mapping - pages are only copied if they are written to
+
+  void *addr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                    fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    Errors::Message mesg("Cannot map snapshot file " + filename_);
+    Exceptions::Jali_throw(mesg);
+  }
+  addr_ = static_cast<char *>(addr);
+
+  std::string error;
+  SnapshotHeader const& hdr = header();
+  int nprocs, rank;
+  MPI_Comm_size(comm, &nprocs);
+  MPI_Comm_rank(comm, &rank);
+  if (std::memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic)) != 0)
+    error = "is not a Jali mesh snapshot";
+  else if (hdr.byte_order != SNAPSHOT_BYTE_ORDER)
+    error = "was written on a machine with a different byte order";
+  else if (hdr.version != SNAPSHOT_VERSION)
+    error = "has unsupported version " + std::to_string(hdr.version) +
+        " (expected " + std::to_string(SNAPSHOT_VERSION) + ")";
+  else if (hdr.id_size != sizeof(Entity_ID))
+    error = "was written with a different size of Entity_ID";
+  else if (hdr.nprocs != nprocs || hdr.rank != rank)
+    error = "was written for rank " + std::to_string(hdr.rank) + " of " +
+        std::to_string(hdr.nprocs) + " (reading on rank " +
+        std::to_string(rank) + " of " + std::to_string(nprocs) + ")";
+  else if (hdr.file_size != size_ || hdr.num_sections < 0 ||
+           hdr.table_offset + hdr.num_sections*sizeof(SnapshotSection) >
+           size_)
+    error = "is truncated or corrupted";
+
+  if (error.empty()) {
+    SnapshotSection const *table =
+        reinterpret_cast<SnapshotSection const *>(addr_ + hdr.table_offset);
+    for (int i = 0; i < hdr.num_sections; i++) {
+      SnapshotSection const& section = table[i];
+      if (section.name[sizeof(section.name)-1] != '\0' ||
+          section.offset % SNAPSHOT_ALIGNMENT ||
+          section.offset + section.nbytes > hdr.table_offset) {
+        error = "has a corrupted section table";
+        break;
+      }
+      sections_[section.name] = &section;
+    }
+  }
+
+  if (!error.empty()) {
+    munmap(addr_, size_);
+    addr_ = nullptr;
+    Errors::Message mesg("Snapshot file " + filename_ + " " + error);
+    Exceptions::Jali_throw(mesg);
+  }
+}
+
+
+MeshSnapshotFile::~MeshSnapshotFile() {
+  if (addr_) munmap(addr_, size_);
+}
+
+
+char * MeshSnapshotFile::find(std::string const& name,
+                              std::size_t const elemsize,
+                              std::size_t *nbytes) const {
+  auto it = sections_.find(name);
+  if (it == sections_.end()) {
+    *nbytes = 0;
+    return nullptr;
+  }
+  *nbytes = it->second->nbytes;
+  if (*nbytes % elemsize) {
+    Errors::Message mesg("Snapshot file " + filename_ + " section " + name +
+                         " has an invalid size");
+    Exceptions::Jali_throw(mesg);
+  }
+  return addr_ + it->second->offset;
+}
+
+
+void MeshSnapshotFile::check_offsets(std::string const& name,
+                                     ArrayView<std::uint64_t> const& offsets,
+                                     std::size_t const datasize) const {
+  bool valid;
+  if (offsets.empty())
+    valid = (datasize == 0);  // relationship not written
+  else {
+    valid = (offsets[0] == 0 && offsets[offsets.size()-1] == datasize);
+    for (std::size_t i = 1; valid && i < offsets.size(); i++)
+      valid = (offsets[i-1] <= offsets[i]);
+  }
+  if (!valid) {
+    Errors::Message mesg("Snapshot file " + filename_ + " section " + name +
+                         ".offsets is corrupted");
+    Exceptions::Jali_throw(mesg);
+  }
+}
+
+
+// -------------------------------------------------------------
+//  Mesh::write_snapshot
+// -------------------------------------------------------------
+
+void Mesh::write_snapshot(std::string const& filename) const {
+  JALI_TIME_SCOPE("Mesh::write_snapshot");
+
+  int nprocs, rank;
+  MPI_Comm_size(comm, &nprocs);
+  MPI_Comm_rank(comm, &rank);
+
+  // Write to a temporary file and move it into place when complete so
+  // that a failed write does not leave a partial snapshot behind
+
+  std::string const rankfile = snapshot_filename(filename, comm);
+  std::string const tmpfile = rankfile + ".tmp";
+
+  SnapshotWriter writer(tmpfile);
+
+  int const dim = space_dim_;
+  int const nnodes = num_nodes<Entity_type::ALL>();
+  int const nedges = edges_requested ? num_edges<Entity_type::ALL>() : 0;
+  int const nfaces = faces_requested ? num_faces<Entity_type::ALL>() : 0;
+  int const ncells = num_cells<Entity_type::ALL>();
+
+  // Entity lists and global IDs
+
+  auto add_gids = [&](std::string const& name, Entity_kind const kind,
+                      int const n) {
+    std::vector<Entity_ID> gids(n);
+    for (int i = 0; i < n; i++)
+      gids[i] = GID(i, kind);
+    writer.add(name, gids);
+  };
+
+  writer.add("node.owned", nodeids_owned_);
+  writer.add("node.ghost", nodeids_ghost_);
+  add_gids("node.gid", Entity_kind::NODE, nnodes);
+  if (edges_requested) {
+    writer.add("edge.owned", edgeids_owned_);
+    writer.add("edge.ghost", edgeids_ghost_);
+    add_gids("edge.gid", Entity_kind::EDGE, nedges);
+  }
+  if (faces_requested) {
+    writer.add("face.owned", faceids_owned_);
+    writer.add("face.ghost", faceids_ghost_);
+    add_gids("face.gid", Entity_kind::FACE, nfaces);
+  }
+  writer.add("cell.owned", cellids_owned_);
+  writer.add("cell.ghost", cellids_ghost_);
+  writer.add("cell.boundary_ghost", cellids_boundary_ghost_);
+  add_gids("cell.gid", Entity_kind::CELL, ncells);
+
+  // Geometry
+
+  std::vector<double> coords(dim*nnodes);
+  JaliGeometry::Point p;
+  for (int n = 0; n < nnodes; n++) {
+    node_get_coordinates(n, &p);
+    for (int d = 0; d < dim; d++)
+      coords[dim*n+d] = p[d];
+  }
+  writer.add("node.coords", coords);
+
+  std::vector<std::uint8_t> celltypes(ncells);
+  for (int c = 0; c < ncells; c++)
+    celltypes[c] = static_cast<std::uint8_t>(cell_get_type(c));
+  writer.add("cell.type", celltypes);
+
+  // Topology - both the cached (unordered) and the ordered faces of
+  // cells are kept since they may differ
+
+  writer.add_csr<Entity_ID>("cell.nodes", ncells,
+                            [&](int c, Entity_ID_List *l) {
+                              cell_get_nodes(c, l);
+                            });
+  writer.add_csr<Entity_ID>("node.cells", nnodes,
+                            [&](int n, Entity_ID_List *l) {
+                              node_get_cells(n, Entity_type::ALL, l);
+                            });
+  if (faces_requested) {
+    writer.add_csr_with_dirs("cell.faces", ncells,
+                             [&](int c, Entity_ID_List *l,
+                                 std::vector<dir_t> *d) {
+                               cell_get_faces_and_dirs(c, l, d, false);
+                             });
+    writer.add_csr_with_dirs("cell.faces_ordered", ncells,
+                             [&](int c, Entity_ID_List *l,
+                                 std::vector<dir_t> *d) {
+                               cell_get_faces_and_dirs(c, l, d, true);
+                             });
+    writer.add_csr<Entity_ID>("face.nodes", nfaces,
+                              [&](int f, Entity_ID_List *l) {
+                                face_get_nodes(f, l);
+                              });
+    writer.add_csr<Entity_ID>("face.cells", nfaces,
+                              [&](int f, Entity_ID_List *l) {
+                                face_get_cells(f, Entity_type::ALL, l);
+                              });
+    writer.add_csr<Entity_ID>("node.faces", nnodes,
+                              [&](int n, Entity_ID_List *l) {
+                                node_get_faces(n, Entity_type::ALL, l);
+                              });
+  }
+  if (edges_requested) {
+    std::vector<Entity_ID> edgenodes(2*nedges);
+    for (int e = 0; e < nedges; e++)
+      edge_get_nodes(e, &edgenodes[2*e], &edgenodes[2*e+1]);
+    writer.add("edge.nodes", edgenodes);
+
+    writer.add_csr<Entity_ID>("cell.edges", ncells,
+                              [&](int c, Entity_ID_List *l) {
+                                cell_get_edges(c, l);
+                              });
+    if (faces_requested)
+      writer.add_csr_with_dirs("face.edges", nfaces,
+                               [&](int f, Entity_ID_List *l,
+                                   std::vector<dir_t> *d) {
+                                 face_get_edges_and_dirs(f, l, d, true);
+                               });
+    if (manifold_dim_ == 2)
+      writer.add_csr_with_dirs("cell.edges2d", ncells,
+                               [&](int c, Entity_ID_List *l,
+                                   std::vector<dir_t> *d) {
+                                 cell_2D_get_edges_and_dirs(c, l, d);
+                               });
+  }
+
+  // Mesh sets - names are stored one after another, each terminated
+  // by a null character
+
+  std::vector<char> setnames;
+  std::vector<std::int8_t> setkinds;
+  for (auto const& set : meshsets_) {
+    setnames.insert(setnames.end(), set->name().begin(), set->name().end());
+    setnames.push_back('\0');
+    setkinds.push_back(static_cast<std::int8_t>(set->kind()));
+  }
+  writer.add("set.names", setnames);
+  writer.add("set.kinds", setkinds);
+  writer.add_csr<Entity_ID>("set.owned", meshsets_.size(),
+                            [&](int i, Entity_ID_List *l) {
+      *l = meshsets_[i]->entities<Entity_type::PARALLEL_OWNED>();
+    });
+  writer.add_csr<Entity_ID>("set.ghost", meshsets_.size(),
+                            [&](int i, Entity_ID_List *l) {
+      *l = meshsets_[i]->entities<Entity_type::PARALLEL_GHOST>();
+    });
+
+  // Tile partition (owned cells of each tile)
+
+  writer.add_csr<Entity_ID>("tile.cells", meshtiles.size(),
+                            [&](int i, Entity_ID_List *l) {
+      *l = meshtiles[i]->cells<Entity_type::PARALLEL_OWNED>();
+    });
+
+  SnapshotHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.nprocs = nprocs;
+  header.rank = rank;
+  header.space_dim = space_dim_;
+  header.manifold_dim = manifold_dim_;
+  header.mesh_type = static_cast<int>(mesh_type_);
+  header.geom_type = static_cast<int>(geomtype);
+  header.faces = faces_requested;
+  header.edges = edges_requested;
+  header.sides = sides_requested;
+  header.wedges = wedges_requested;
+  header.corners = corners_requested;
+  header.boundary_ghosts = boundary_ghosts_requested_;
+  header.num_tiles = meshtiles.size();
+  header.num_ghost_layers_tile = num_ghost_layers_tile_;
+  header.num_ghost_layers_distmesh = num_ghost_layers_distmesh_;
+  header.partitioner = static_cast<int>(partitioner_pref_);
+  writer.finish(header);
+
+  if (std::rename(tmpfile.c_str(), rankfile.c_str()) != 0) {
+    Errors::Message mesg("Cannot rename " + tmpfile + " to " + rankfile);
+    Exceptions::Jali_throw(mesg);
+  }
+}
+
+}  // namespace Jali
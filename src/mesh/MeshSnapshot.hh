@@ -0,0 +1,258 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*!
+ * @file   MeshSnapshot.hh
+ * @brief  Jali-native binary snapshot of a finalized mesh partition
+ *
+ * A snapshot holds everything needed to bring back a mesh partition
+ * without reconstructing it - the local topology in the final
+ * (renumbered) local IDs, node coordinates, global IDs and the
+ * owned/ghost entity lists, the mesh sets and the tile partition.
+ * It is written with Mesh::write_snapshot and read back by the
+ * Mesh_snapshot framework (through MeshFactory) which maps the file
+ * into memory and answers topological queries straight from it
+ * (entity lists, mesh sets, tiles and geometry are rebuilt in memory
+ * from what is stored).
+ *
+ * Each rank writes and maps its own file - 'filename' on one rank
+ * and 'filename.<nprocs>.<rank>' (like Nemesis files) on more. A
+ * snapshot can only be read on the number of ranks it was written
+ * on.
+ *
+ * File layout (all in the byte order of the writing machine which
+ * must match that of the reading machine)
+ *
+ *   SnapshotHeader
+ *   sections, each starting at a multiple of 64 bytes
+ *   table of num_sections SnapshotSection entries at table_offset
+ *
+ * A section is a flat array of a fixed element type found by its
+ * name. One-to-many relationships are stored as two sections
+ * "<name>.offsets" (std::uint64_t, one more than the number of rows)
+ * and "<name>.data" plus an optional "<name>.dirs" (dir_t, parallel
+ * to data).
+ */
+
+#ifndef _JALI_MESHSNAPSHOT_H_
+#define _JALI_MESHSNAPSHOT_H_
+
+#include <mpi.h>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "MeshDefs.hh"
+#include "MeshCSR.hh"
+#include "errors.hh"
+
+namespace Jali {
+
+/// Version of the snapshot format written by this code. Files of
+/// any other version are rejected
+
+const std::uint32_t SNAPSHOT_VERSION = 1;
+
+/// Fixed size header at the start of a snapshot file
+
+struct SnapshotHeader {
+  char magic[8];               // "JALISNAP"
+  std::uint32_t version;       // SNAPSHOT_VERSION
+  std::uint32_t byte_order;    // 0x01020304 as written
+  std::uint32_t id_size;       // sizeof(Entity_ID)
+  std::int32_t nprocs, rank;   // of the writing communicator
+  std::int32_t space_dim, manifold_dim;
+  std::int32_t mesh_type, geom_type;
+  std::int32_t faces, edges, sides, wedges, corners;  // kinds present
+  std::int32_t boundary_ghosts;
+  std::int32_t num_tiles, num_ghost_layers_tile, num_ghost_layers_distmesh;
+  std::int32_t partitioner;
+  std::int32_t num_sections;
+  std::uint64_t table_offset;  // position of the section table
+  std::uint64_t file_size;
+};
+
+/// Entry of the section table
+
+struct SnapshotSection {
+  char name[48];               // null terminated
+  std::uint64_t offset;        // from the start of the file
+  std::uint64_t nbytes;
+};
+
+
+/// Name of the file of this rank for a snapshot 'filename'
+
+std::string snapshot_filename(std::string const& filename,
+                              MPI_Comm const comm);
+
+/// Is 'filename' a mesh snapshot (on all ranks of comm)? Collective
+
+bool is_mesh_snapshot(std::string const& filename, MPI_Comm const comm);
+
+
+/*!
+  @class SnapshotCSR
+  @brief Read-only view of a one-to-many relationship in a snapshot
+*/
+
+template<typename T>
+class SnapshotCSR {
+ public:
+  SnapshotCSR() {}
+  SnapshotCSR(ArrayView<std::uint64_t> const& offsets,
+              ArrayView<T> const& data) : offsets_(offsets), data_(data) {}
+
+  std::size_t num_rows() const {
+    return offsets_.empty() ? 0 : offsets_.size()-1;
+  }
+
+  ArrayView<T> row(std::size_t const i) const {
+    return data_.slice(offsets_[i], offsets_[i+1]-offsets_[i]);
+  }
+
+  ArrayView<T> operator[](std::size_t const i) const { return row(i); }
+
+  ArrayView<std::uint64_t> const& offsets() const { return offsets_; }
+  ArrayView<T> const& data() const { return data_; }
+
+ private:
+  ArrayView<std::uint64_t> offsets_;
+  ArrayView<T> data_;
+};
+
+
+/*!
+  @class MeshSnapshotFile
+  @brief A snapshot file of this rank mapped into memory
+
+  The file is mapped privately (copy-on-write) so that the sections
+  can be modified in memory (e.g. when nodes are moved) without
+  changing the file. The mapping lives as long as this object
+*/
+
+class MeshSnapshotFile {
+ public:
+
+  /// Map the file of this rank for snapshot 'filename' and check
+  /// its header (throws an Errors::Message if it is not a valid
+  /// snapshot of this version written on as many ranks as in comm)
+
+  MeshSnapshotFile(std::string const& filename, MPI_Comm const comm);
+
+  ~MeshSnapshotFile();
+
+  MeshSnapshotFile(MeshSnapshotFile const&) = delete;
+  MeshSnapshotFile& operator=(MeshSnapshotFile const&) = delete;
+
+  SnapshotHeader const& header() const {
+    return *reinterpret_cast<SnapshotHeader const *>(addr_);
+  }
+
+  /// Name of the file of this rank
+
+  std::string const& filename() const { return filename_; }
+
+  /// Size of the mapped file in bytes
+
+  std::size_t size() const { return size_; }
+
+  bool has_section(std::string const& name) const {
+    return sections_.count(name) != 0;
+  }
+
+  /// Contents of a section as an array of T (empty if the section is
+  /// absent)
+
+  template<typename T>
+  ArrayView<T> section(std::string const& name) const {
+    std::size_t nbytes;
+    char *data = find(name, sizeof(T), &nbytes);
+    return ArrayView<T>(reinterpret_cast<T const *>(data), nbytes/sizeof(T));
+  }
+
+  /// Writable pointer to a section (modifies only the mapping)
+
+  template<typename T>
+  T * writable_section(std::string const& name) {
+    std::size_t nbytes;
+    return reinterpret_cast<T *>(find(name, sizeof(T), &nbytes));
+  }
+
+  /// One-to-many relationship stored as "<name>.offsets" and
+  /// "<name>.data" (throws an Errors::Message if the offsets do not
+  /// start at 0, decrease or do not end at the size of the data)
+
+  template<typename T>
+  SnapshotCSR<T> csr(std::string const& name) const {
+    ArrayView<std::uint64_t> offsets = section<std::uint64_t>(name +
+                                                              ".offsets");
+    ArrayView<T> data = section<T>(name + ".data");
+    check_offsets(name, offsets, data.size());
+    return SnapshotCSR<T>(offsets, data);
+  }
+
+ private:
+  char * find(std::string const& name, std::size_t const elemsize,
+              std::size_t *nbytes) const;
+
+  void check_offsets(std::string const& name,
+                     ArrayView<std::uint64_t> const& offsets,
+                     std::size_t const datasize) const;
+
+  std::string filename_;
+  char *addr_ = nullptr;
+  std::size_t size_ = 0;
+  std::map<std::string, SnapshotSection const *> sections_;
+};
+
+}  // namespace Jali
+
+#endif  /* _JALI_MESHSNAPSHOT_H_ */
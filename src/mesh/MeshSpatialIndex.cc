@@ -0,0 +1,410 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "MeshSpatialIndex.hh"
+
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "Mesh.hh"
+
+namespace Jali {
+
+namespace {
+
+// Cells and nodes in a leaf of the trees
+
+int const bvh_leaf_size = 4;
+int const kdtree_leaf_size = 8;
+
+void pad_coordinates(JaliGeometry::Point const& p, double *xyz) {
+  xyz[0] = p.x();
+  xyz[1] = p.y();
+  xyz[2] = p.z();
+}
+
+bool boxes_overlap(double const *lo1, double const *hi1,
+                   double const *lo2, double const *hi2) {
+  for (int d = 0; d < 3; d++)
+    if (hi1[d] < lo2[d] || hi2[d] < lo1[d]) return false;
+  return true;
+}
+
+}  // end anonymous namespace
+
+
+MeshSpatialIndex::MeshSpatialIndex(Mesh const& mesh) : mesh_(mesh) {
+
+  // Gather node coordinates and the extent of the mesh
+
+  int nnodes = mesh_.num_nodes<Entity_type::ALL>();
+  nodexyz_.resize(3*nnodes);
+  double meshlo[3] = {0.0, 0.0, 0.0}, meshhi[3] = {0.0, 0.0, 0.0};
+  JaliGeometry::Point xyz;
+  for (int n = 0; n < nnodes; n++) {
+    mesh_.node_get_coordinates(n, &xyz);
+    pad_coordinates(xyz, &(nodexyz_[3*n]));
+    for (int d = 0; d < 3; d++) {
+      double x = nodexyz_[3*n+d];
+      if (n == 0 || x < meshlo[d]) meshlo[d] = x;
+      if (n == 0 || x > meshhi[d]) meshhi[d] = x;
+    }
+  }
+  double extent = 0.0;
+  for (int d = 0; d < 3; d++)
+    extent = std::max(extent, meshhi[d]-meshlo[d]);
+  tol_ = 1.0e-08*extent;
+
+  nodeperm_.resize(nnodes);
+  for (int n = 0; n < nnodes; n++) nodeperm_[n] = n;
+  splitaxis_.assign(nnodes, 0);
+  build_kdtree(0, nnodes);
+
+  // Bounding boxes of cells, slightly enlarged so that points on
+  // cell boundaries are not missed due to roundoff
+
+  int ncells = mesh_.num_cells<Entity_type::PARALLEL_OWNED>() +
+      mesh_.num_cells<Entity_type::PARALLEL_GHOST>();
+  cellbox_.resize(6*ncells);
+  std::vector<double> centroids(3*ncells);
+  for (int c = 0; c < ncells; c++) {
+    double *lo = &(cellbox_[6*c]);
+    double *hi = lo + 3;
+    bool first = true;
+    for (auto const& n : mesh_.cell_get_nodes_view(c)) {
+      for (int d = 0; d < 3; d++) {
+        double x = nodexyz_[3*n+d];
+        if (first || x < lo[d]) lo[d] = x;
+        if (first || x > hi[d]) hi[d] = x;
+      }
+      first = false;
+    }
+    for (int d = 0; d < 3; d++) {
+      centroids[3*c+d] = 0.5*(lo[d]+hi[d]);
+      lo[d] -= tol_;
+      hi[d] += tol_;
+    }
+  }
+
+  cellperm_.resize(ncells);
+  for (int c = 0; c < ncells; c++) cellperm_[c] = c;
+  bvh_.reserve(ncells ? 2*(ncells/bvh_leaf_size)+1 : 0);
+  if (ncells) build_bvh(0, ncells, centroids);
+}
+
+
+// Build the subtree of the hierarchy for cells cellperm_[begin, end)
+// and return the index of its root
+
+int MeshSpatialIndex::build_bvh(int const begin, int const end,
+                                std::vector<double> const& centroids) {
+  int inode = bvh_.size();
+  bvh_.emplace_back();
+
+  BVHNode node;
+  node.first = begin;
+  node.num = 0;
+  node.right = -1;
+
+  double clo[3], chi[3];  // extent of cell centroids
+  for (int i = begin; i < end; i++) {
+    int c = cellperm_[i];
+    for (int d = 0; d < 3; d++) {
+      double lo = cellbox_[6*c+d], hi = cellbox_[6*c+3+d];
+      double x = centroids[3*c+d];
+      if (i == begin || lo < node.lo[d]) node.lo[d] = lo;
+      if (i == begin || hi > node.hi[d]) node.hi[d] = hi;
+      if (i == begin || x < clo[d]) clo[d] = x;
+      if (i == begin || x > chi[d]) chi[d] = x;
+    }
+  }
+
+  if (end-begin <= bvh_leaf_size) {
+    node.num = end-begin;
+    bvh_[inode] = node;
+    return inode;
+  }
+
+  // Split at the median centroid along the longest axis
+
+  int axis = 0;
+  for (int d = 1; d < 3; d++)
+    if (chi[d]-clo[d] > chi[axis]-clo[axis]) axis = d;
+
+  int mid = (begin+end)/2;
+  std::nth_element(cellperm_.begin()+begin, cellperm_.begin()+mid,
+                   cellperm_.begin()+end,
+                   [&](Entity_ID const c1, Entity_ID const c2) {
+                     return centroids[3*c1+axis] < centroids[3*c2+axis];
+                   });
+
+  build_bvh(begin, mid, centroids);
+  node.right = build_bvh(mid, end, centroids);
+  bvh_[inode] = node;
+  return inode;
+}
+
+
+// Build a balanced k-d tree on nodeperm_[begin, end) in place: the
+// median along the split axis is at the middle of the range, nodes
+// before it are not greater and nodes after it are not smaller
+
+void MeshSpatialIndex::build_kdtree(int const begin, int const end) {
+  if (end-begin <= kdtree_leaf_size) return;
+
+  double lo[3], hi[3];
+  for (int i = begin; i < end; i++) {
+    double const *xyz = &(nodexyz_[3*nodeperm_[i]]);
+    for (int d = 0; d < 3; d++) {
+      if (i == begin || xyz[d] < lo[d]) lo[d] = xyz[d];
+      if (i == begin || xyz[d] > hi[d]) hi[d] = xyz[d];
+    }
+  }
+  int axis = 0;
+  for (int d = 1; d < 3; d++)
+    if (hi[d]-lo[d] > hi[axis]-lo[axis]) axis = d;
+
+  int mid = (begin+end)/2;
+  std::nth_element(nodeperm_.begin()+begin, nodeperm_.begin()+mid,
+                   nodeperm_.begin()+end,
+                   [&](Entity_ID const n1, Entity_ID const n2) {
+                     return nodexyz_[3*n1+axis] < nodexyz_[3*n2+axis];
+                   });
+  splitaxis_[mid] = axis;
+
+  build_kdtree(begin, mid);
+  build_kdtree(mid+1, end);
+}
+
+
+void MeshSpatialIndex::cells_in_box(JaliGeometry::Point const& lo,
+                                    JaliGeometry::Point const& hi,
+                                    Entity_ID_List *cellids) const {
+  assert(cellids);
+  cellids->clear();
+  if (bvh_.empty()) return;
+
+  double qlo[3], qhi[3], xyz0[3], xyz1[3];
+  pad_coordinates(lo, xyz0);
+  pad_coordinates(hi, xyz1);
+  for (int d = 0; d < 3; d++) {
+    qlo[d] = std::min(xyz0[d], xyz1[d]);
+    qhi[d] = std::max(xyz0[d], xyz1[d]);
+  }
+
+  std::vector<int> stack(1, 0);
+  while (!stack.empty()) {
+    BVHNode const& node = bvh_[stack.back()];
+    int inode = stack.back();
+    stack.pop_back();
+    if (!boxes_overlap(node.lo, node.hi, qlo, qhi)) continue;
+
+    if (node.num) {
+      for (int i = node.first; i < node.first+node.num; i++) {
+        int c = cellperm_[i];
+        if (boxes_overlap(&(cellbox_[6*c]), &(cellbox_[6*c+3]), qlo, qhi))
+          cellids->push_back(c);
+      }
+    } else {
+      stack.push_back(node.right);
+      stack.push_back(inode+1);
+    }
+  }
+  std::sort(cellids->begin(), cellids->end());
+}
+
+
+void MeshSpatialIndex::cells_containing(JaliGeometry::Point const& p,
+                                        Entity_ID_List *cellids) const {
+  Entity_ID_List candidates;
+  cells_in_box(p, p, &candidates);
+
+  cellids->clear();
+  for (auto const& c : candidates)
+    if (mesh_.point_in_cell(p, c))
+      cellids->push_back(c);
+}
+
+
+Entity_ID
+MeshSpatialIndex::find_cell_containing(JaliGeometry::Point const& p) const {
+  Entity_ID_List candidates;
+  cells_in_box(p, p, &candidates);
+
+  for (auto const& c : candidates)
+    if (mesh_.point_in_cell(p, c))
+      return c;
+  return -1;
+}
+
+
+void MeshSpatialIndex::query_kdtree(int const begin, int const end,
+                                    double const *lo, double const *hi,
+                                    Entity_ID_List *nodeids) const {
+  if (end-begin <= kdtree_leaf_size) {
+    for (int i = begin; i < end; i++) {
+      double const *xyz = &(nodexyz_[3*nodeperm_[i]]);
+      if (boxes_overlap(xyz, xyz, lo, hi))
+        nodeids->push_back(nodeperm_[i]);
+    }
+    return;
+  }
+
+  int mid = (begin+end)/2;
+  int axis = splitaxis_[mid];
+  double const *xyz = &(nodexyz_[3*nodeperm_[mid]]);
+  if (boxes_overlap(xyz, xyz, lo, hi))
+    nodeids->push_back(nodeperm_[mid]);
+  if (lo[axis] <= xyz[axis])
+    query_kdtree(begin, mid, lo, hi, nodeids);
+  if (hi[axis] >= xyz[axis])
+    query_kdtree(mid+1, end, lo, hi, nodeids);
+}
+
+
+void MeshSpatialIndex::nodes_in_box(JaliGeometry::Point const& lo,
+                                    JaliGeometry::Point const& hi,
+                                    Entity_ID_List *nodeids) const {
+  assert(nodeids);
+  nodeids->clear();
+
+  double qlo[3], qhi[3], xyz0[3], xyz1[3];
+  pad_coordinates(lo, xyz0);
+  pad_coordinates(hi, xyz1);
+  for (int d = 0; d < 3; d++) {
+    qlo[d] = std::min(xyz0[d], xyz1[d]);
+    qhi[d] = std::max(xyz0[d], xyz1[d]);
+  }
+
+  query_kdtree(0, nodeperm_.size(), qlo, qhi, nodeids);
+  std::sort(nodeids->begin(), nodeids->end());
+}
+
+
+void MeshSpatialIndex::nodes_near(JaliGeometry::Point const& p,
+                                  double const radius,
+                                  Entity_ID_List *nodeids) const {
+  assert(nodeids);
+  nodeids->clear();
+
+  double xyz[3], qlo[3], qhi[3];
+  pad_coordinates(p, xyz);
+  for (int d = 0; d < 3; d++) {
+    qlo[d] = xyz[d]-radius;
+    qhi[d] = xyz[d]+radius;
+  }
+
+  Entity_ID_List inbox;
+  query_kdtree(0, nodeperm_.size(), qlo, qhi, &inbox);
+  for (auto const& n : inbox) {
+    double dist2 = 0.0;
+    for (int d = 0; d < 3; d++) {
+      double dx = nodexyz_[3*n+d]-xyz[d];
+      dist2 += dx*dx;
+    }
+    if (dist2 <= radius*radius)
+      nodeids->push_back(n);
+  }
+  std::sort(nodeids->begin(), nodeids->end());
+}
+
+
+void MeshSpatialIndex::nearest_in_kdtree(int const begin, int const end,
+                                         double const *p, Entity_ID *nearest,
+                                         double *mindist2) const {
+  auto consider = [&](Entity_ID const n) {
+    double dist2 = 0.0;
+    for (int d = 0; d < 3; d++) {
+      double dx = nodexyz_[3*n+d]-p[d];
+      dist2 += dx*dx;
+    }
+    if (dist2 < *mindist2 || (dist2 == *mindist2 && n < *nearest)) {
+      *mindist2 = dist2;
+      *nearest = n;
+    }
+  };
+
+  if (end-begin <= kdtree_leaf_size) {
+    for (int i = begin; i < end; i++)
+      consider(nodeperm_[i]);
+    return;
+  }
+
+  int mid = (begin+end)/2;
+  int axis = splitaxis_[mid];
+  consider(nodeperm_[mid]);
+
+  // Search the side of the split containing the point first and the
+  // other side only if it can have a node at least as close
+
+  double diff = p[axis] - nodexyz_[3*nodeperm_[mid]+axis];
+  if (diff < 0.0) {
+    nearest_in_kdtree(begin, mid, p, nearest, mindist2);
+    if (diff*diff <= *mindist2)
+      nearest_in_kdtree(mid+1, end, p, nearest, mindist2);
+  } else {
+    nearest_in_kdtree(mid+1, end, p, nearest, mindist2);
+    if (diff*diff <= *mindist2)
+      nearest_in_kdtree(begin, mid, p, nearest, mindist2);
+  }
+}
+
+
+Entity_ID MeshSpatialIndex::nearest_node(JaliGeometry::Point const& p) const {
+  double xyz[3];
+  pad_coordinates(p, xyz);
+
+  Entity_ID nearest = -1;
+  double mindist2 = std::numeric_limits<double>::max();
+  nearest_in_kdtree(0, nodeperm_.size(), xyz, &nearest, &mindist2);
+  return nearest;
+}
+
+}  // end namespace Jali
@@ -0,0 +1,162 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#ifndef _JALI_MESHSPATIALINDEX_H_
+#define _JALI_MESHSPATIALINDEX_H_
+
+#include <vector>
+
+#include "MeshDefs.hh"
+#include "Point.hh"
+
+namespace Jali {
+
+class Mesh;
+
+/*!
+  @class MeshSpatialIndex "MeshSpatialIndex.hh"
+  @brief Search structures for locating cells and nodes of a mesh in space
+
+  Cells are organized in a bounding volume hierarchy (a binary tree
+  of axis aligned boxes, each enclosing the boxes of its children)
+  and nodes in a k-d tree, so that point location and box queries
+  visit O(log N) entities instead of the whole mesh.
+
+  Only PARALLEL_OWNED and PARALLEL_GHOST cells are indexed; all nodes
+  are. Entities returned by the queries are sorted by ID. The index
+  captures the node coordinates at the time it is built - use
+  Mesh::spatial_index() to get an index that is current. All queries
+  are const and may be called concurrently.
+*/
+
+class MeshSpatialIndex {
+ public:
+
+  /// @brief Build the index for the current coordinates of 'mesh'
+
+  explicit MeshSpatialIndex(Mesh const& mesh);
+
+  MeshSpatialIndex(MeshSpatialIndex const&) = delete;
+  MeshSpatialIndex & operator=(MeshSpatialIndex const&) = delete;
+
+  /// @brief Lowest numbered cell containing point (-1 if none)
+
+  Entity_ID find_cell_containing(JaliGeometry::Point const& p) const;
+
+  /// @brief All cells containing point (more than one if the point is
+  /// on a cell boundary)
+
+  void cells_containing(JaliGeometry::Point const& p,
+                        Entity_ID_List *cellids) const;
+
+  /// @brief Cells whose bounding boxes intersect the box with corners
+  /// 'lo' and 'hi'
+
+  void cells_in_box(JaliGeometry::Point const& lo,
+                    JaliGeometry::Point const& hi,
+                    Entity_ID_List *cellids) const;
+
+  /// @brief Nodes inside the box with corners 'lo' and 'hi' (inclusive)
+
+  void nodes_in_box(JaliGeometry::Point const& lo,
+                    JaliGeometry::Point const& hi,
+                    Entity_ID_List *nodeids) const;
+
+  /// @brief Nodes within distance 'radius' of point (inclusive)
+
+  void nodes_near(JaliGeometry::Point const& p, double const radius,
+                  Entity_ID_List *nodeids) const;
+
+  /// @brief Node closest to point (lowest numbered one if several
+  /// are equally close; -1 if the mesh has no nodes)
+
+  Entity_ID nearest_node(JaliGeometry::Point const& p) const;
+
+ private:
+
+  // Node of the bounding volume hierarchy. Leaves have num > 0 and
+  // own cells cellperm_[first, first+num). Interior nodes have num =
+  // 0, their left child immediately follows them and the right child
+  // is at index 'right'
+
+  struct BVHNode {
+    double lo[3], hi[3];
+    int first, num, right;
+  };
+
+  int build_bvh(int const begin, int const end,
+                std::vector<double> const& centroids);
+
+  void build_kdtree(int const begin, int const end);
+
+  void query_kdtree(int const begin, int const end,
+                    double const *lo, double const *hi,
+                    Entity_ID_List *nodeids) const;
+
+  void nearest_in_kdtree(int const begin, int const end, double const *p,
+                         Entity_ID *nearest, double *mindist2) const;
+
+  Mesh const& mesh_;
+  double tol_;  // slack for boundary points, relative to mesh extent
+
+  // Cell boxes (lo, hi - 6 doubles per cell) and hierarchy
+
+  std::vector<double> cellbox_;
+  std::vector<Entity_ID> cellperm_;
+  std::vector<BVHNode> bvh_;
+
+  // Node coordinates (3 doubles per node, padded with zeros in lower
+  // dimensions), node IDs in tree order and split axes of the tree
+
+  std::vector<double> nodexyz_;
+  std::vector<Entity_ID> nodeperm_;
+  std::vector<char> splitaxis_;
+};
+
+}  // end namespace Jali
+
+#endif  // _JALI_MESHSPATIALINDEX_H_
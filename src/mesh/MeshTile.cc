@@ -53,6 +53,7 @@
 #include <vector>
 #include <algorithm>
 #include <memory>
+#include <limits>
 
 
 #include "MeshDefs.hh"
@@ -79,54 +80,133 @@ namespace Jali {
 */
 
 
+namespace {
+
+// Marks entities as visited while the lists of a tile are built, in
+// time proportional to the number of entities visited rather than to
+// the size of the mesh. Each thread reuses one array of stamps for
+// all the tiles it builds and a new Marker only advances the stamp,
+// so a thread may only use one Marker at a time
+
+class Marker {
+ public:
+  explicit Marker(int const n) : marks_(thread_marks()) {
+    if (static_cast<int>(marks_.size()) < n) marks_.resize(n, 0);
+    int& stamp = thread_stamp();
+    if (stamp == std::numeric_limits<int>::max()) {
+      std::fill(marks_.begin(), marks_.end(), 0);
+      stamp = 0;
+    }
+    stamp_ = ++stamp;
+  }
+
+  // Mark entity i; returns false if it was already marked
+
+  bool mark(int const i) {
+    if (marks_[i] == stamp_) return false;
+    marks_[i] = stamp_;
+    return true;
+  }
+
+ private:
+  static std::vector<int>& thread_marks() {
+    thread_local std::vector<int> marks;
+    return marks;
+  }
+  static int& thread_stamp() {
+    thread_local int stamp = 0;
+    return stamp;
+  }
+
+  std::vector<int>& marks_;
+  int stamp_;
+};
+
+
+// Collect the entities of the owned and ghost cells of a tile into
+// owned and ghost lists, each in the order in which the entities are
+// first encountered. An entity of an owned cell is owned by the tile
+// if the tile is its master tile or if it has no master tile yet (the
+// tile then becomes its master); all other entities are ghosts.
+// cell_entities(c) returns a view of the entities of cell c
+
+template<typename CellEntities, typename MasterTile, typename SetMasterTile>
+void collect_entities(std::vector<Entity_ID> const& owned_cells,
+                      std::vector<Entity_ID> const& ghost_cells,
+                      int const nentities, int const tileid,
+                      CellEntities const& cell_entities,
+                      MasterTile const& master_tile,
+                      SetMasterTile const& set_master_tile,
+                      std::vector<Entity_ID> *owned,
+                      std::vector<Entity_ID> *ghost,
+                      std::vector<Entity_ID> *all) {
+  Marker seen(nentities);
+
+  for (auto const& c : owned_cells)
+    for (auto const& e : cell_entities(c)) {
+      if (!seen.mark(e)) continue;
+      int const master = master_tile(e);
+      if (master == -1) set_master_tile(e, tileid);
+      if (master == -1 || master == tileid)
+        owned->push_back(e);
+      else
+        ghost->push_back(e);
+    }
+
+  for (auto const& c : ghost_cells)
+    for (auto const& e : cell_entities(c))
+      if (seen.mark(e)) ghost->push_back(e);
+
+  *all = *owned;
+  all->insert(all->end(), ghost->begin(), ghost->end());
+}
+
+}  // namespace
+
+
 // Constructor - should we make this private and only allow Mesh to
 // call it as a friend? MeshTile can send a reference to itself to the
 // parent_mesh so that it can be added to the list of tiles
+//
+// All lists are built with marker arrays and the cached adjacency
+// views of the mesh, so the time taken is proportional to the size of
+// the tile and several tiles can be built concurrently
 
 MeshTile::MeshTile(Mesh& parent_mesh,
                    std::vector<Entity_ID> const& meshcells_owned,
                    int const num_halo_layers,
                    bool const request_faces, bool const request_edges,
                    bool const request_sides, bool const request_wedges,
-                   bool const request_corners) :
+                   bool const request_corners, int const tileid) :
     mesh_(parent_mesh),
-    mytileid_(parent_mesh.tiles().size()) {
+    mytileid_(tileid >= 0 ? tileid : parent_mesh.tiles().size()) {
 
   cellids_owned_ = meshcells_owned;
   cellids_all_ = meshcells_owned;
 
-  // Build up halos if requested
+  // Build up halos if requested. Each halo layer consists of the
+  // cells that share a node with a cell of the previous layer and
+  // are not in the tile yet
 
   if (num_halo_layers > 0) {
+    Marker in_tile(mesh_.num_cells());
+    for (auto const& c : cellids_owned_)
+      in_tile.mark(c);
 
-    // Make a list of halo/ghost cells
-
+    int layer_begin = 0;
     for (int i = 0; i < num_halo_layers; ++i) {
-      Entity_ID_List next_halo_layer;
-
-      for (auto const& c : cellids_all_) {
-        Entity_ID_List nbrs;
-        mesh_.cell_get_node_adj_cells(c, Entity_type::ALL, &nbrs);
-        
-        for (auto const& cnbr : nbrs) {
-          // Check if the neighbor is already in the all cells list or
-          // in this halo
-
-          if (std::find(next_halo_layer.begin(), next_halo_layer.end(), cnbr)
-              != next_halo_layer.end()) continue;
-          if (std::find(cellids_all_.begin(), cellids_all_.end(), cnbr) !=
-              cellids_all_.end()) continue;
-
-          // Add neighbor to the next halo layer
-          next_halo_layer.push_back(cnbr);
-        }
+      int const layer_end = cellids_all_.size();
+      for (int k = layer_begin; k < layer_end; ++k) {
+        Entity_ID const c = cellids_all_[k];
+        for (auto const& n : mesh_.cell_get_nodes_view(c))
+          for (auto const& cnbr : mesh_.node_get_cells_view(n))
+            if (in_tile.mark(cnbr)) cellids_all_.push_back(cnbr);
       }
-
-      cellids_all_.insert(cellids_all_.end(),
-                          next_halo_layer.begin(), next_halo_layer.end());
-      cellids_ghost_.insert(cellids_ghost_.end(),
-                            next_halo_layer.begin(), next_halo_layer.end());
+      layer_begin = layer_end;
     }
+
+    cellids_ghost_.assign(cellids_all_.begin() + cellids_owned_.size(),
+                          cellids_all_.end());
   }
 
 
@@ -135,134 +215,62 @@ MeshTile::MeshTile(Mesh& parent_mesh,
 
   // Make a list of nodeids in the tile
 
-  for (auto const& c : cellids_owned_) {
-    std::vector<int> cnodes;
-    mesh_.cell_get_nodes(c, &cnodes);
-    for (auto const& n : cnodes) {
-      int tileid = mesh_.master_tile_ID_of_node(n);
-      if (tileid == -1) {
-        // Node not yet in any tile - so this tile owns it
-        nodeids_owned_.emplace_back(n);
-        mesh_.set_master_tile_ID_of_node(n, mytileid_);
-      } else {
-        // If node is owned by another tile put it in the ghost list
-        if (tileid != mytileid_ &&
-            std::find(nodeids_ghost_.begin(), nodeids_ghost_.end(), n) ==
-            nodeids_ghost_.end())
-          nodeids_ghost_.emplace_back(n);
-      }
-    }
-  }
-
-  for (auto const& c : cellids_ghost_) {
-    std::vector<int> cnodes;
-    mesh_.cell_get_nodes(c, &cnodes);
-    for (auto const& n : cnodes) {
-      int tileid = mesh_.master_tile_ID_of_node(n);  // may be -1 (unassigned)
-      if (tileid != mytileid_ &&
-          std::find(nodeids_ghost_.begin(), nodeids_ghost_.end(), n) ==
-          nodeids_ghost_.end())
-        nodeids_ghost_.emplace_back(n);
-    }
-  }
-
-  nodeids_all_ = nodeids_owned_;
-  nodeids_all_.insert(nodeids_all_.end(),
-                      nodeids_ghost_.begin(), nodeids_ghost_.end());
+  collect_entities(cellids_owned_, cellids_ghost_, mesh_.num_nodes(),
+                   mytileid_,
+                   [&](Entity_ID const c) {
+                     return mesh_.cell_get_nodes_view(c);
+                   },
+                   [&](Entity_ID const n) {
+                     return mesh_.master_tile_ID_of_node(n);
+                   },
+                   [&](Entity_ID const n, int const t) {
+                     mesh_.set_master_tile_ID_of_node(n, t);
+                   },
+                   &nodeids_owned_, &nodeids_ghost_, &nodeids_all_);
 
   // Make a list of faces similarly if requested
 
-  if (request_faces) {
-
-    for (auto const& c : cellids_owned_) {
-      std::vector<int> cfaces;
-      mesh_.cell_get_faces(c, &cfaces);
-      for (auto const& f : cfaces) {
-        int tileid = mesh_.master_tile_ID_of_face(f);
-        if (tileid == -1) {
-          // face not yet in any tile - so this tile owns it
-          faceids_owned_.emplace_back(f);
-          mesh_.set_master_tile_ID_of_face(f, mytileid_);
-        } else {
-          // If face is owned by another tile put it in the ghost list
-          if (tileid != mytileid_ &&
-              std::find(faceids_ghost_.begin(), faceids_ghost_.end(), f) ==
-              faceids_ghost_.end())
-            faceids_ghost_.emplace_back(f);
-        }
-      }
-    }
-
-    for (auto const& c : cellids_ghost_) {
-      std::vector<int> cfaces;
-      mesh_.cell_get_faces(c, &cfaces);
-      for (auto const& f : cfaces) {
-        int tileid = mesh_.master_tile_ID_of_face(f);  // may be -1 (unassigned)
-        if (tileid != mytileid_ &&
-            std::find(faceids_ghost_.begin(), faceids_ghost_.end(), f) ==
-            faceids_ghost_.end())
-          faceids_ghost_.emplace_back(f);
-      }
-    }
-
-    faceids_all_ = faceids_owned_;
-    faceids_all_.insert(faceids_all_.end(),
-                        faceids_ghost_.begin(), faceids_ghost_.end());
-  }
+  if (request_faces)
+    collect_entities(cellids_owned_, cellids_ghost_, mesh_.num_faces(),
+                     mytileid_,
+                     [&](Entity_ID const c) {
+                       return mesh_.cell_get_faces_view(c);
+                     },
+                     [&](Entity_ID const f) {
+                       return mesh_.master_tile_ID_of_face(f);
+                     },
+                     [&](Entity_ID const f, int const t) {
+                       mesh_.set_master_tile_ID_of_face(f, t);
+                     },
+                     &faceids_owned_, &faceids_ghost_, &faceids_all_);
 
   // Make a list of edges similarly if requested
 
-  if (request_edges) {
-    for (auto const& c : cellids_owned_) {
-      std::vector<int> cedges;
-      mesh_.cell_get_edges(c, &cedges);
-      for (auto const& e : cedges) {
-        int etileid = mesh_.master_tile_ID_of_edge(e);
-        if (etileid == -1) {
-          // Edge not yet in any tile - so this tile owns it
-          edgeids_owned_.emplace_back(e);
-          mesh_.set_master_tile_ID_of_edge(e, mytileid_);
-        } else {
-          // If edge is owned by another tile put it in the ghost list
-          if (etileid != mytileid_ &&
-              std::find(edgeids_ghost_.begin(), edgeids_ghost_.end(), e) ==
-              edgeids_ghost_.end())
-            edgeids_ghost_.emplace_back(e);
-        }
-      }
-    }
-
-    for (auto const& c : cellids_ghost_) {
-      std::vector<int> cedges;
-      mesh_.cell_get_edges(c, &cedges);
-      for (auto const& e : cedges) {
-        int tileid = mesh_.master_tile_ID_of_edge(e);  // may be -1 (unassigned)
-        if (tileid != mytileid_ &&
-            std::find(edgeids_ghost_.begin(), edgeids_ghost_.end(), e) ==
-            edgeids_ghost_.end())
-          edgeids_ghost_.emplace_back(e);
-      }
-    }
-
-    edgeids_all_ = edgeids_owned_;
-    edgeids_all_.insert(edgeids_all_.end(),
-                        edgeids_ghost_.begin(), edgeids_ghost_.end());
-  }
-
-  if (request_wedges) {
-    for (auto const& c : cellids_owned_) {
-      std::vector<int> csides;
-      mesh_.cell_get_sides(c, &csides);
-      for (auto const& s : csides)
+  if (request_edges)
+    collect_entities(cellids_owned_, cellids_ghost_, mesh_.num_edges(),
+                     mytileid_,
+                     [&](Entity_ID const c) {
+                       return mesh_.cell_get_edges_view(c);
+                     },
+                     [&](Entity_ID const e) {
+                       return mesh_.master_tile_ID_of_edge(e);
+                     },
+                     [&](Entity_ID const e, int const t) {
+                       mesh_.set_master_tile_ID_of_edge(e, t);
+                     },
+                     &edgeids_owned_, &edgeids_ghost_, &edgeids_all_);
+
+  // Sides, wedges and corners belong to a single cell, so they are
+  // owned by the tile if their cell is
+
+  if (request_sides || request_wedges) {
+    for (auto const& c : cellids_owned_)
+      for (auto const& s : mesh_.cell_get_sides_view(c))
         sideids_owned_.emplace_back(s);
-    }
 
-    for (auto const& c : cellids_ghost_) {
-      std::vector<int> csides;
-      mesh_.cell_get_sides(c, &csides);
-      for (auto const& s : csides)
+    for (auto const& c : cellids_ghost_)
+      for (auto const& s : mesh_.cell_get_sides_view(c))
         sideids_ghost_.emplace_back(s);
-    }
 
     sideids_all_ = sideids_owned_;
     sideids_all_.insert(sideids_all_.end(),
@@ -270,18 +278,17 @@ MeshTile::MeshTile(Mesh& parent_mesh,
   }
 
   if (request_wedges) {
+    std::vector<int> cwedges;
     for (auto const& c : cellids_owned_) {
-      std::vector<int> cwedges;
       mesh_.cell_get_wedges(c, &cwedges);
-      for (auto const& w : cwedges)
-        wedgeids_owned_.emplace_back(w);
+      wedgeids_owned_.insert(wedgeids_owned_.end(),
+                             cwedges.begin(), cwedges.end());
     }
 
     for (auto const& c : cellids_ghost_) {
-      std::vector<int> cwedges;
       mesh_.cell_get_wedges(c, &cwedges);
-      for (auto const& w : cwedges)
-        wedgeids_ghost_.emplace_back(w);
+      wedgeids_ghost_.insert(wedgeids_ghost_.end(),
+                             cwedges.begin(), cwedges.end());
     }
 
     wedgeids_all_ = wedgeids_owned_;
@@ -290,19 +297,13 @@ MeshTile::MeshTile(Mesh& parent_mesh,
   }
 
   if (request_corners) {
-    for (auto const& c : cellids_owned_) {
-      std::vector<int> ccorners;
-      mesh_.cell_get_corners(c, &ccorners);
-      for (auto const& cn : ccorners)
+    for (auto const& c : cellids_owned_)
+      for (auto const& cn : mesh_.cell_get_corners_view(c))
         cornerids_owned_.emplace_back(cn);
-    }
 
-    for (auto const& c : cellids_ghost_) {
-      std::vector<int> ccorners;
-      mesh_.cell_get_corners(c, &ccorners);
-      for (auto const& cn : ccorners)
+    for (auto const& c : cellids_ghost_)
+      for (auto const& cn : mesh_.cell_get_corners_view(c))
         cornerids_ghost_.emplace_back(cn);
-    }
 
     cornerids_all_ = cornerids_owned_;
     cornerids_all_.insert(cornerids_all_.end(),
@@ -110,7 +110,11 @@ class MeshTile {
   // call it as a friend? MeshTile can send a reference to itself to the
   // parent_mesh so that it can be added to the list of tiles. I ran into
   // C++ trouble when trying to do this so I will need C++ guru help
-  
+  //
+  // tileid is the ID of the new tile; by default it is the number of
+  // tiles the mesh already has. The master tile IDs of the entities
+  // of the tile's cells may have been set beforehand (Mesh::build_tiles
+  // does this so that it can construct the tiles concurrently)
 
   MeshTile(Mesh& parent_mesh,
            std::vector<Entity_ID> const& meshcells_owned,
@@ -119,7 +123,8 @@ class MeshTile {
            bool const request_edges = false,
            bool const request_sides = false,
            bool const request_wedges = false,
-           bool const request_corners = false);
+           bool const request_corners = false,
+           int const tileid = -1);
 
 
   /// @brief Copy Constructor - deleted
@@ -0,0 +1,856 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "MeshVTK.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <typeindex>
+#include <vector>
+
+#ifdef Jali_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "Mesh.hh"
+#include "MeshSnapshot.hh"
+#include "instrumentation.hh"
+
+namespace Jali {
+
+// VTK cell types of the cells of a mesh and the few node lists that
+// have to be reordered for VTK
+
+struct VTKCells {
+  std::vector<std::uint8_t> types;
+  std::vector<Entity_ID> reordered_cells;  // in increasing order
+  std::vector<Entity_ID> reordered_nodes;  // their node lists, in turn
+  std::vector<Entity_ID> polyhedra;        // in increasing order
+  std::uint64_t num_face_entries = 0;      // length of the faces array
+};
+
+
+namespace {
+
+// VTK cell types
+
+std::uint8_t const VTK_LINE = 3;
+std::uint8_t const VTK_POLY_LINE = 4;
+std::uint8_t const VTK_TRIANGLE = 5;
+std::uint8_t const VTK_POLYGON = 7;
+std::uint8_t const VTK_QUAD = 9;
+std::uint8_t const VTK_TETRA = 10;
+std::uint8_t const VTK_HEXAHEDRON = 12;
+std::uint8_t const VTK_WEDGE = 13;
+std::uint8_t const VTK_PYRAMID = 14;
+std::uint8_t const VTK_POLYHEDRON = 42;
+
+// Flags of the vtkGhostType arrays
+
+std::uint8_t const VTK_DUPLICATE = 1;     // DUPLICATEPOINT/DUPLICATECELL
+std::uint8_t const VTK_HIDDENCELL = 32;
+
+// Size of the blocks in which arrays are generated and compressed
+
+std::size_t const VTK_BLOCK_SIZE = 1 << 20;
+
+// Width of the offset attributes of the data arrays which are filled
+// in once the appended data has been written
+
+int const VTK_OFFSET_WIDTH = 20;
+
+
+template <typename T> char const * vtk_type_name();
+template <> char const * vtk_type_name<std::int32_t>() { return "Int32"; }
+template <> char const * vtk_type_name<std::int64_t>() { return "Int64"; }
+template <> char const * vtk_type_name<std::uint8_t>() { return "UInt8"; }
+template <> char const * vtk_type_name<std::uint64_t>() { return "UInt64"; }
+template <> char const * vtk_type_name<float>() { return "Float32"; }
+template <> char const * vtk_type_name<double>() { return "Float64"; }
+
+char const * vtk_type_name(VTK_scalar const type) {
+  switch (type) {
+    case VTK_scalar::INT32: return vtk_type_name<std::int32_t>();
+    case VTK_scalar::FLOAT32: return vtk_type_name<float>();
+    default: return vtk_type_name<double>();
+  }
+}
+
+std::size_t vtk_type_size(VTK_scalar const type) {
+  return (type == VTK_scalar::FLOAT64) ? 8 : 4;
+}
+
+std::string xml_escape(std::string const& s) {
+  std::string escaped;
+  for (char const c : s) {
+    switch (c) {
+      case '&': escaped += "&amp;"; break;
+      case '<': escaped += "&lt;"; break;
+      case '>': escaped += "&gt;"; break;
+      case '"': escaped += "&quot;"; break;
+      default: escaped += c;
+    }
+  }
+  return escaped;
+}
+
+char const * byte_order() {
+  std::uint16_t const one = 1;
+  return (*reinterpret_cast<unsigned char const *>(&one) == 1) ?
+      "LittleEndian" : "BigEndian";
+}
+
+
+// Standard 3D cell shape in VTK node order - its faces as local node
+// indices (the first listed with its outward normal, -1 terminated)
+// and the node permutation turning its mirror image into it
+
+struct VTKShape {
+  std::uint8_t type;
+  int num_nodes, num_faces;
+  int faces[6][5];
+  int mirror[8];
+};
+
+VTKShape const vtk_shapes[4] = {
+  {VTK_TETRA, 4, 4,
+   {{0, 2, 1, -1}, {0, 1, 3, -1}, {1, 2, 3, -1}, {2, 0, 3, -1}},
+   {0, 2, 1, 3}},
+  {VTK_PYRAMID, 5, 5,
+   {{0, 3, 2, 1, -1}, {0, 1, 4, -1}, {1, 2, 4, -1}, {2, 3, 4, -1},
+    {3, 0, 4, -1}},
+   {0, 3, 2, 1, 4}},
+  {VTK_WEDGE, 6, 5,
+   {{0, 1, 2, -1}, {3, 5, 4, -1}, {0, 3, 4, 1, -1}, {1, 4, 5, 2, -1},
+    {2, 5, 3, 0, -1}},
+   {0, 2, 1, 3, 5, 4}},
+  {VTK_HEXAHEDRON, 8, 6,
+   {{0, 3, 2, 1, -1}, {4, 5, 6, 7, -1}, {0, 1, 5, 4, -1}, {1, 2, 6, 5, -1},
+    {2, 3, 7, 6, -1}, {3, 0, 4, 7, -1}},
+   {0, 3, 2, 1, 4, 7, 6, 5}}
+};
+
+
+// Position of node n in the node list of a cell
+
+int local_index(Entity_ID_View const& nodes, Entity_ID const n) {
+  for (std::size_t i = 0; i < nodes.size(); i++)
+    if (nodes[i] == n) return i;
+  return -1;
+}
+
+
+// Does a 3D cell with faces have the faces of 'shape' if its nodes
+// are taken in the given order? Returns 1 if so, -1 if it is the
+// mirror image of the shape and 0 if it has a different topology
+
+int match_shape(Mesh const& mesh, Entity_ID const c,
+                Entity_ID_View const& nodes, VTKShape const& shape) {
+  Entity_ID_View faces = mesh.cell_get_faces_view(c);
+  Dir_View dirs = mesh.cell_get_face_dirs_view(c);
+  if (static_cast<int>(nodes.size()) != shape.num_nodes ||
+      static_cast<int>(faces.size()) != shape.num_faces)
+    return 0;
+
+  unsigned int shapemasks[6];
+  for (int i = 0; i < shape.num_faces; i++) {
+    shapemasks[i] = 0;
+    for (int const *k = shape.faces[i]; *k >= 0; k++)
+      shapemasks[i] |= 1u << *k;
+  }
+
+  int orientation = 0;
+  unsigned int matched = 0;
+  for (std::size_t i = 0; i < faces.size(); i++) {
+    Entity_ID_View fnodes = mesh.face_get_nodes_view(faces[i]);
+    unsigned int mask = 0;
+    for (Entity_ID const n : fnodes) {
+      int const k = local_index(nodes, n);
+      if (k < 0) return 0;
+      mask |= 1u << k;
+    }
+    int j = 0;
+    while (j < shape.num_faces && shapemasks[j] != mask) j++;
+    if (j == shape.num_faces || (matched & (1u << j))) return 0;
+    matched |= 1u << j;
+
+    if (j == 0) {
+      // Compare the outward order of the nodes of the face (reversed
+      // if the face points into the cell) with that of the shape
+
+      int const nfn = fnodes.size();
+      int const first = shape.faces[0][0], second = shape.faces[0][1];
+      for (int k = 0; k < nfn; k++) {
+        if (fnodes[k] != nodes[first]) continue;
+        Entity_ID const next = (dirs[i] > 0) ? fnodes[(k+1)%nfn] :
+            fnodes[(k+nfn-1)%nfn];
+        orientation = (next == nodes[second]) ? 1 : -1;
+      }
+    }
+  }
+  return orientation;
+}
+
+
+// Nodes of a polygon in the order in which they are connected by its
+// faces (edges). Returns false if they already are in that order
+
+bool order_polygon(Mesh const& mesh, Entity_ID const c,
+                   Entity_ID_View const& nodes,
+                   std::vector<Entity_ID> *ring) {
+  Entity_ID_View faces = mesh.cell_get_faces_view(c);
+  Dir_View dirs = mesh.cell_get_face_dirs_view(c);
+  int const nn = nodes.size();
+
+  bool ordered = true;
+  for (std::size_t i = 0; i < faces.size() && ordered; i++) {
+    Entity_ID_View fnodes = mesh.face_get_nodes_view(faces[i]);
+    int const k0 = local_index(nodes, fnodes[0]);
+    int const k1 = local_index(nodes, fnodes[1]);
+    int const gap = (k1 - k0 + nn) % nn;
+    ordered = (k0 >= 0 && k1 >= 0 && (gap == 1 || gap == nn-1));
+  }
+  if (ordered || static_cast<int>(faces.size()) != nn) return false;
+
+  // Follow the faces (tail to head in the cell's orientation)
+
+  std::vector<Entity_ID> tails(nn), heads(nn);
+  for (int i = 0; i < nn; i++) {
+    Entity_ID_View fnodes = mesh.face_get_nodes_view(faces[i]);
+    tails[i] = (dirs[i] > 0) ? fnodes[0] : fnodes[1];
+    heads[i] = (dirs[i] > 0) ? fnodes[1] : fnodes[0];
+  }
+  ring->assign(1, tails[0]);
+  for (int i = 1; i < nn; i++) {
+    int const j = std::find(tails.begin(), tails.end(), ring->back()) -
+        tails.begin();
+    if (j == nn) return false;
+    ring->push_back(heads[j]);
+  }
+  return true;
+}
+
+
+// VTK types of all cells, reordering the nodes of standard cells that
+// the framework lists in a different order. Without faces the node
+// order of the framework is taken as it is
+
+void classify_cells(Mesh const& mesh, CSRArray<Entity_ID> const& cellnodes,
+                    bool const have_faces, VTKCells *cells) {
+  int const ncells = cellnodes.num_rows();
+  int const dim = mesh.manifold_dimension();
+  cells->types.resize(ncells);
+
+  std::vector<Entity_ID> ring;
+  for (int c = 0; c < ncells; c++) {
+    Entity_ID_View nodes = cellnodes[c];
+    int const nn = nodes.size();
+    std::uint8_t type;
+
+    if (dim == 1) {
+      type = (nn == 2) ? VTK_LINE : VTK_POLY_LINE;
+    } else if (dim == 2) {
+      type = (nn == 3) ? VTK_TRIANGLE : (nn == 4) ? VTK_QUAD : VTK_POLYGON;
+      if (have_faces && nn > 3 && order_polygon(mesh, c, nodes, &ring)) {
+        cells->reordered_cells.push_back(c);
+        cells->reordered_nodes.insert(cells->reordered_nodes.end(),
+                                      ring.begin(), ring.end());
+      }
+    } else {
+      type = VTK_POLYHEDRON;
+      int const nfaces = have_faces ? mesh.cell_get_faces_view(c).size() : 0;
+      for (VTKShape const& shape : vtk_shapes) {
+        if (nn != shape.num_nodes) continue;
+        if (!have_faces) {
+          type = shape.type;
+          break;
+        }
+        int const orientation = match_shape(mesh, c, nodes, shape);
+        if (orientation == 0) continue;
+        type = shape.type;
+        if (orientation < 0) {
+          cells->reordered_cells.push_back(c);
+          for (int i = 0; i < nn; i++)
+            cells->reordered_nodes.push_back(nodes[shape.mirror[i]]);
+        }
+        break;
+      }
+      if (type == VTK_POLYHEDRON) {
+        if (!have_faces) {
+          Errors::Message mesg("Writing polyhedral cells to a VTK file "
+                               "requires the faces of the mesh");
+          Exceptions::Jali_throw(mesg);
+        }
+        cells->polyhedra.push_back(c);
+        cells->num_face_entries += 1 + nfaces;
+        for (Entity_ID const f : mesh.cell_get_faces_view(c))
+          cells->num_face_entries += mesh.face_get_nodes_view(f).size();
+      }
+    }
+    cells->types[c] = type;
+  }
+}
+
+
+// Streams arrays into the appended data block of a piece, each
+// preceded by its UInt64 header - the number of bytes for raw data
+// or, for zlib compressed data, the number of blocks, the block size,
+// the size of the last partial block and the compressed size of each
+// block (the format of vtkZLibDataCompressor)
+
+class AppendedData {
+ public:
+  AppendedData(std::ofstream& os, bool const compress) :
+      os_(os), compress_(compress) {}
+
+  // Start an array of nbytes bytes
+
+  void begin(std::uint64_t const nbytes) {
+    nbytes_ = nbytes;
+    written_ = 0;
+    if (!compress_) {
+      os_.write(reinterpret_cast<char const *>(&nbytes), sizeof(nbytes));
+      return;
+    }
+    std::uint64_t const nblocks = (nbytes + VTK_BLOCK_SIZE - 1)/VTK_BLOCK_SIZE;
+    header_.assign(3 + nblocks, 0);
+    header_[0] = nblocks;
+    header_[1] = VTK_BLOCK_SIZE;
+    header_[2] = nbytes % VTK_BLOCK_SIZE;
+    iblock_ = 0;
+    block_.clear();
+    header_pos_ = os_.tellp();
+    write_header();  // filled in by end()
+  }
+
+  void write(void const *data, std::size_t nbytes) {
+    written_ += nbytes;
+    char const *p = static_cast<char const *>(data);
+    if (!compress_) {
+      os_.write(p, nbytes);
+      return;
+    }
+    while (nbytes) {
+      if (block_.empty() && nbytes >= VTK_BLOCK_SIZE) {  // skip the copy
+        compress_block(p, VTK_BLOCK_SIZE);
+        p += VTK_BLOCK_SIZE;
+        nbytes -= VTK_BLOCK_SIZE;
+        continue;
+      }
+      std::size_t const n = std::min(nbytes, VTK_BLOCK_SIZE - block_.size());
+      block_.insert(block_.end(), p, p + n);
+      p += n;
+      nbytes -= n;
+      if (block_.size() == VTK_BLOCK_SIZE) {
+        compress_block(block_.data(), block_.size());
+        block_.clear();
+      }
+    }
+  }
+
+  template <typename T>
+  void write(std::vector<T> const& values) {
+    write(values.data(), values.size()*sizeof(T));
+  }
+
+  void end() {
+    assert(written_ == nbytes_);
+    if (!compress_) return;
+    if (!block_.empty()) {
+      compress_block(block_.data(), block_.size());
+      block_.clear();
+    }
+    std::streampos const pos = os_.tellp();
+    os_.seekp(header_pos_);
+    write_header();
+    os_.seekp(pos);
+  }
+
+ private:
+  void write_header() {
+    os_.write(reinterpret_cast<char const *>(header_.data()),
+              header_.size()*sizeof(std::uint64_t));
+  }
+
+  void compress_block(char const *data, std::size_t const nbytes) {
+#ifdef Jali_HAVE_ZLIB
+    uLongf zsize = compressBound(nbytes);
+    zbuffer_.resize(zsize);
+    if (compress2(reinterpret_cast<Bytef *>(zbuffer_.data()), &zsize,
+                  reinterpret_cast<Bytef const *>(data), nbytes,
+                  Z_BEST_SPEED) != Z_OK) {
+      Errors::Message mesg("zlib compression of VTK data failed");
+      Exceptions::Jali_throw(mesg);
+    }
+    os_.write(zbuffer_.data(), zsize);
+    header_[3 + iblock_++] = zsize;
+#endif
+  }
+
+  std::ofstream& os_;
+  bool const compress_;
+  std::uint64_t nbytes_ = 0, written_ = 0;
+  std::vector<std::uint64_t> header_;
+  std::streampos header_pos_;
+  std::size_t iblock_ = 0;
+  std::vector<char> block_, zbuffer_;
+};
+
+
+// Values of an array generated one at a time and written a block at
+// a time
+
+template <typename T>
+class ValueStream {
+ public:
+  ValueStream(AppendedData& out, std::uint64_t const n) : out_(out) {
+    out_.begin(n*sizeof(T));
+    buffer_.reserve(std::min<std::uint64_t>(n, VTK_BLOCK_SIZE/sizeof(T)));
+  }
+
+  void push(T const value) {
+    buffer_.push_back(value);
+    if (buffer_.size() == buffer_.capacity()) flush();
+  }
+
+  template <typename Iterator>
+  void push(Iterator first, Iterator last) {
+    for (; first != last; ++first) push(*first);
+  }
+
+  void finish() {
+    flush();
+    out_.end();
+  }
+
+ private:
+  void flush() {
+    out_.write(buffer_);
+    buffer_.clear();
+  }
+
+  AppendedData& out_;
+  std::vector<T> buffer_;
+};
+
+
+// An array of a piece as declared in the XML and a function that
+// writes its data
+
+struct VTKArray {
+  std::string name;
+  char const *type;
+  int num_components;
+  std::function<void(AppendedData&)> write;
+};
+
+
+// Write an array written in one piece (contiguous data)
+
+std::function<void(AppendedData&)> write_contiguous(void const *data,
+                                                    std::uint64_t nbytes) {
+  return [=](AppendedData& out) {
+    out.begin(nbytes);
+    out.write(data, nbytes);
+    out.end();
+  };
+}
+
+
+// Declare the arrays of a section of a piece in the XML, leaving room
+// for their offsets which are only known once they are written
+
+void declare_arrays(std::ofstream& os, std::string const& section,
+                    std::vector<VTKArray> const& arrays,
+                    std::vector<std::streampos> *offset_positions) {
+  os << "      <" << section << ">\n";
+  for (VTKArray const& a : arrays) {
+    os << "        <DataArray type=\"" << a.type << "\"";
+    if (!a.name.empty()) os << " Name=\"" << xml_escape(a.name) << "\"";
+    os << " NumberOfComponents=\"" << a.num_components
+       << "\" format=\"appended\" offset=\"";
+    offset_positions->push_back(os.tellp());
+    os << std::string(VTK_OFFSET_WIDTH, ' ') << "\"/>\n";
+  }
+  os << "      </" << section << ">\n";
+}
+
+
+// Declare the arrays of a section in the .pvtu file
+
+void declare_parallel_arrays(std::ofstream& os, std::string const& section,
+                             std::vector<VTKArray> const& arrays) {
+  os << "    <P" << section << ">\n";
+  for (VTKArray const& a : arrays) {
+    os << "      <PDataArray type=\"" << a.type << "\"";
+    if (!a.name.empty()) os << " Name=\"" << xml_escape(a.name) << "\"";
+    os << " NumberOfComponents=\"" << a.num_components << "\"/>\n";
+  }
+  os << "    </P" << section << ">\n";
+}
+
+
+void rename_file(std::string const& from, std::string const& to) {
+  if (std::rename(from.c_str(), to.c_str()) != 0) {
+    Errors::Message mesg("Cannot rename " + from + " to " + to);
+    Exceptions::Jali_throw(mesg);
+  }
+}
+
+}  // namespace
+
+
+// -------------------------------------------------------------
+//  Mesh::write_to_vtk_file
+// -------------------------------------------------------------
+
+void Mesh::write_to_vtk_file(const std::string filename,
+                             const bool with_fields,
+                             const bool compress) const {
+  std::vector<VTKField> fields;
+  if (with_fields) {
+    for (auto const& kv : fields_) {
+      FieldArray const& field = kv.second;
+      if (field.kind != Entity_kind::NODE && field.kind != Entity_kind::CELL)
+        continue;
+      VTKField vtkfield = {kv.first, field.kind, VTK_scalar::FLOAT64, 1,
+                           field.values.data()};
+      if (field.type == std::type_index(typeid(int)))
+        vtkfield.scalar_type = VTK_scalar::INT32;
+      else if (field.type == std::type_index(typeid(std::array<double, 2>)))
+        vtkfield.num_components = 2;
+      else if (field.type == std::type_index(typeid(std::array<double, 3>)))
+        vtkfield.num_components = 3;
+      else if (field.type == std::type_index(typeid(std::array<double, 6>)))
+        vtkfield.num_components = 6;
+      fields.push_back(vtkfield);
+    }
+  }
+  write_to_vtk_file(filename, fields, compress);
+}
+
+
+void Mesh::write_to_vtk_file(const std::string filename,
+                             std::vector<VTKField> const& fields,
+                             const bool compress) const {
+  JALI_TIME_SCOPE("Mesh::write_to_vtk_file");
+  static_assert(sizeof(std::size_t) == sizeof(std::uint64_t),
+                "CSR offsets are written as UInt64");
+
+  int nprocs, rank;
+  MPI_Comm_size(comm, &nprocs);
+  MPI_Comm_rank(comm, &rank);
+
+  bool zlib = compress;
+#ifndef Jali_HAVE_ZLIB
+  if (compress && rank == 0)
+    std::cerr << "Jali was built without zlib - writing uncompressed " <<
+        "VTK files\n";
+  zlib = false;
+#endif
+
+  std::string base = filename;
+  for (std::string const ext : {".pvtu", ".vtu"})
+    if (base.size() > ext.size() &&
+        base.compare(base.size() - ext.size(), ext.size(), ext) == 0)
+      base.erase(base.size() - ext.size());
+  std::string const piecefile = (nprocs == 1) ? base + ".vtu" :
+      snapshot_filename(base, comm) + ".vtu";
+
+  int const nnodes = num_nodes<Entity_type::ALL>();
+  int const ncells = num_cells<Entity_type::ALL>();
+
+  cache_node_coordinates();
+  if (!cell2node_info_cached) cache_cell2node_info();
+
+  // Finding the VTK types of the cells means looking at all their
+  // faces, so it is only done once for a mesh (until its cell-node
+  // lists are rebuilt)
+
+  std::shared_ptr<VTKCells const> vtkcells;
+  {
+    std::lock_guard<std::recursive_mutex> lock(cache_mutex_);
+    if (!vtk_cells) {
+      JALI_TIME_SCOPE("Mesh::write_to_vtk_file::classify_cells");
+      auto newcells = std::make_shared<VTKCells>();
+      classify_cells(*this, cell_node_ids, faces_requested, newcells.get());
+      vtk_cells = newcells;
+    }
+    vtkcells = vtk_cells;
+  }
+  VTKCells const& cells = *vtkcells;
+
+  // Field data
+
+  std::vector<VTKArray> pointdata, celldata;
+  for (VTKField const& field : fields) {
+    if (field.kind != Entity_kind::NODE && field.kind != Entity_kind::CELL) {
+      Errors::Message mesg("Only node and cell fields can be written to a "
+                           "VTK file (field " + field.name + ")");
+      Exceptions::Jali_throw(mesg);
+    }
+    std::uint64_t const nbytes = num_entities(field.kind, Entity_type::ALL) *
+        field.num_components * vtk_type_size(field.scalar_type);
+    VTKArray array = {field.name, vtk_type_name(field.scalar_type),
+                      field.num_components,
+                      write_contiguous(field.data, nbytes)};
+    (field.kind == Entity_kind::NODE ? pointdata : celldata).push_back(array);
+  }
+
+  // Ghost flags
+
+  pointdata.push_back({"vtkGhostType", vtk_type_name<std::uint8_t>(), 1,
+          [&](AppendedData& out) {
+            std::vector<std::uint8_t> ghost(nnodes, 0);
+            for (Entity_ID const n : nodeids_ghost_)
+              ghost[n] = VTK_DUPLICATE;
+            out.begin(nnodes);
+            out.write(ghost);
+            out.end();
+          }});
+  celldata.push_back({"vtkGhostType", vtk_type_name<std::uint8_t>(), 1,
+          [&](AppendedData& out) {
+            std::vector<std::uint8_t> ghost(ncells, 0);
+            for (Entity_ID const c : cellids_ghost_)
+              ghost[c] = VTK_DUPLICATE;
+            for (Entity_ID const c : cellids_boundary_ghost_)
+              ghost[c] = VTK_HIDDENCELL;
+            out.begin(ncells);
+            out.write(ghost);
+            out.end();
+          }});
+
+  // Node coordinates, padded to 3D
+
+  std::vector<VTKArray> points;
+  if (space_dim_ == 3) {
+    points.push_back({"", vtk_type_name<double>(), 3,
+            write_contiguous(node_coords_.data(),
+                             node_coords_.size()*sizeof(double))});
+  } else {
+    points.push_back({"", vtk_type_name<double>(), 3,
+            [&](AppendedData& out) {
+              ValueStream<double> coords(out, 3*nnodes);
+              for (int n = 0; n < nnodes; n++)
+                for (unsigned int d = 0; d < 3; d++)
+                  coords.push(d < space_dim_ ?
+                              node_coords_[space_dim_*n+d] : 0.0);
+              coords.finish();
+            }});
+  }
+
+  // Cells - the node lists of the cells straight from the cached
+  // cell-node arrays unless some of them had to be reordered, and the
+  // outward oriented faces of polyhedra
+
+  std::vector<VTKArray> topology;
+  std::vector<Entity_ID> const& cellnodes = cell_node_ids.data();
+  std::vector<std::size_t> const& celloffsets = cell_node_ids.offsets();
+
+  if (cells.reordered_cells.empty()) {
+    topology.push_back({"connectivity", vtk_type_name<Entity_ID>(), 1,
+            write_contiguous(cellnodes.data(),
+                             cellnodes.size()*sizeof(Entity_ID))});
+  } else {
+    topology.push_back({"connectivity", vtk_type_name<Entity_ID>(), 1,
+            [&](AppendedData& out) {
+              ValueStream<Entity_ID> nodes(out, cellnodes.size());
+              auto next = cells.reordered_cells.begin();
+              auto reordered = cells.reordered_nodes.begin();
+              for (int c = 0; c < ncells; c++) {
+                auto first = cellnodes.begin() + celloffsets[c];
+                auto last = cellnodes.begin() + celloffsets[c+1];
+                if (next != cells.reordered_cells.end() && *next == c) {
+                  nodes.push(reordered, reordered + (last - first));
+                  reordered += last - first;
+                  ++next;
+                } else {
+                  nodes.push(first, last);
+                }
+              }
+              nodes.finish();
+            }});
+  }
+  topology.push_back({"offsets", vtk_type_name<std::uint64_t>(), 1,
+          write_contiguous(celloffsets.data() + 1,
+                           ncells*sizeof(std::uint64_t))});
+  topology.push_back({"types", vtk_type_name<std::uint8_t>(), 1,
+          write_contiguous(cells.types.data(), ncells)});
+
+  if (!cells.polyhedra.empty()) {
+    topology.push_back({"faces", vtk_type_name<Entity_ID>(), 1,
+            [&](AppendedData& out) {
+              ValueStream<Entity_ID> faces(out, cells.num_face_entries);
+              for (Entity_ID const c : cells.polyhedra) {
+                Entity_ID_View cfaces = cell_get_faces_view(c);
+                Dir_View cfacedirs = cell_get_face_dirs_view(c);
+                faces.push(cfaces.size());
+                for (std::size_t i = 0; i < cfaces.size(); i++) {
+                  Entity_ID_View fnodes = face_get_nodes_view(cfaces[i]);
+                  faces.push(fnodes.size());
+                  if (cfacedirs[i] > 0)
+                    faces.push(fnodes.begin(), fnodes.end());
+                  else
+                    faces.push(std::reverse_iterator<Entity_ID const *>
+                               (fnodes.end()),
+                               std::reverse_iterator<Entity_ID const *>
+                               (fnodes.begin()));
+                }
+              }
+              faces.finish();
+            }});
+    topology.push_back({"faceoffsets", vtk_type_name<std::int64_t>(), 1,
+            [&](AppendedData& out) {
+              ValueStream<std::int64_t> offsets(out, ncells);
+              std::int64_t end = 0;
+              auto next = cells.polyhedra.begin();
+              for (int c = 0; c < ncells; c++) {
+                if (next != cells.polyhedra.end() && *next == c) {
+                  end++;
+                  for (Entity_ID const f : cell_get_faces_view(c))
+                    end += 1 + face_get_nodes_view(f).size();
+                  offsets.push(end);
+                  ++next;
+                } else {
+                  offsets.push(-1);
+                }
+              }
+              offsets.finish();
+            }});
+  }
+
+  // Write the piece to a temporary file and move it into place when
+  // complete
+
+  std::string const tmpfile = piecefile + ".tmp";
+  std::ofstream os(tmpfile.c_str(), std::ios::binary | std::ios::trunc);
+  if (!os) {
+    Errors::Message mesg("Cannot open VTK file " + tmpfile + " for writing");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  os << "<?xml version=\"1.0\"?>\n"
+     << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\""
+     << byte_order() << "\" header_type=\"UInt64\"";
+  if (zlib) os << " compressor=\"vtkZLibDataCompressor\"";
+  os << ">\n"
+     << "  <UnstructuredGrid>\n"
+     << "    <Piece NumberOfPoints=\"" << nnodes
+     << "\" NumberOfCells=\"" << ncells << "\">\n";
+
+  std::vector<std::streampos> offset_positions;
+  declare_arrays(os, "PointData", pointdata, &offset_positions);
+  declare_arrays(os, "CellData", celldata, &offset_positions);
+  declare_arrays(os, "Points", points, &offset_positions);
+  declare_arrays(os, "Cells", topology, &offset_positions);
+
+  os << "    </Piece>\n"
+     << "  </UnstructuredGrid>\n"
+     << "  <AppendedData encoding=\"raw\">\n"
+     << "   _";
+
+  std::streampos const start = os.tellp();
+  std::vector<std::uint64_t> offsets;
+  AppendedData out(os, zlib);
+  for (auto const section : {&pointdata, &celldata, &points, &topology})
+    for (VTKArray const& array : *section) {
+      offsets.push_back(os.tellp() - start);
+      array.write(out);
+    }
+  os << "\n  </AppendedData>\n"
+     << "</VTKFile>\n";
+
+  for (std::size_t i = 0; i < offsets.size(); i++) {
+    os.seekp(offset_positions[i]);
+    os << std::setw(VTK_OFFSET_WIDTH) << offsets[i];
+  }
+  os.close();
+  if (!os) {
+    Errors::Message mesg("Error writing VTK file " + tmpfile);
+    Exceptions::Jali_throw(mesg);
+  }
+  rename_file(tmpfile, piecefile);
+
+  // Index of the pieces (all ranks are expected to write the same
+  // fields)
+
+  if (nprocs == 1 || rank != 0) return;
+
+  std::string const pvtufile = base + ".pvtu";
+  std::string const tmppvtu = pvtufile + ".tmp";
+  std::string const piecebase = base.substr(base.find_last_of('/') + 1);
+  std::ofstream pos(tmppvtu.c_str(), std::ios::trunc);
+  pos << "<?xml version=\"1.0\"?>\n"
+      << "<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" byte_order=\""
+      << byte_order() << "\" header_type=\"UInt64\">\n"
+      << "  <PUnstructuredGrid GhostLevel=\"" << num_ghost_layers_distmesh_
+      << "\">\n";
+  declare_parallel_arrays(pos, "PointData", pointdata);
+  declare_parallel_arrays(pos, "CellData", celldata);
+  declare_parallel_arrays(pos, "Points", points);
+  for (int p = 0; p < nprocs; p++)
+    pos << "    <Piece Source=\"" << xml_escape(piecebase) << "." << nprocs
+        << "." << p << ".vtu\"/>\n";
+  pos << "  </PUnstructuredGrid>\n"
+      << "</VTKFile>\n";
+  pos.close();
+  if (!pos) {
+    Errors::Message mesg("Error writing VTK file " + tmppvtu);
+    Exceptions::Jali_throw(mesg);
+  }
+  rename_file(tmppvtu, pvtufile);
+}
+
+}  // namespace Jali
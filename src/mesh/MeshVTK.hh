@@ -0,0 +1,142 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*!
+ * @file   MeshVTK.hh
+ * @brief  Parallel VTK XML (.vtu/.pvtu) output of a mesh and its fields
+ *
+ * Mesh::write_to_vtk_file writes the local partition of each rank as
+ * an unstructured grid piece (.vtu) and, on more than one rank, a
+ * parallel index (.pvtu) on rank 0 listing the pieces. For a file
+ * name "dump" (or "dump.pvtu" or "dump.vtu") the files are
+ *
+ *   dump.vtu                          on one rank
+ *   dump.pvtu, dump.<nprocs>.<rank>.vtu  on more
+ *
+ * All data is in one raw appended block per piece (with UInt64 size
+ * headers), optionally compressed with zlib in the VTK block format.
+ * Arrays are streamed straight from the contiguous coordinate and
+ * cell-node arrays of the mesh and from the field arrays so a dump
+ * mostly costs the write itself.
+ *
+ * Each piece holds all nodes and cells of the partition. Ghosts are
+ * flagged in the standard vtkGhostType arrays (duplicate for
+ * parallel ghosts, hidden for boundary ghosts) so that viewers show
+ * every cell once. Cells with a standard VTK shape (line, triangle,
+ * quad, polygon, tet, pyramid, wedge, hex) are written as such,
+ * reordering their nodes to the VTK convention when the framework
+ * lists them differently. All other 3D cells are written as
+ * VTK_POLYHEDRON with their faces oriented outward, which needs the
+ * faces of the mesh.
+ */
+
+#ifndef _JALI_MESHVTK_H_
+#define _JALI_MESHVTK_H_
+
+#include <array>
+#include <string>
+
+#include "MeshDefs.hh"
+
+namespace Jali {
+
+/// Scalar type of the values of an array written to a VTK file
+
+enum class VTK_scalar {INT32, FLOAT32, FLOAT64};
+
+
+/// An array of values to write with a mesh - num_components values
+/// per entity of 'kind' (NODE or CELL) in local ID order for all
+/// entities of the partition (Entity_type::ALL). The data is only
+/// read while the file is being written
+
+struct VTKField {
+  std::string name;
+  Entity_kind kind;
+  VTK_scalar scalar_type;
+  int num_components;
+  void const *data;
+};
+
+
+/// VTK cell types and node orders of the cells of a mesh, cached by
+/// the mesh with its cell-node lists (defined in MeshVTK.cc)
+
+struct VTKCells;
+
+
+/// Describe an array of values for Mesh::write_to_vtk_file
+
+inline
+VTKField vtk_field(std::string const& name, Entity_kind const kind,
+                   int const *data) {
+  return VTKField{name, kind, VTK_scalar::INT32, 1, data};
+}
+
+inline
+VTKField vtk_field(std::string const& name, Entity_kind const kind,
+                   float const *data) {
+  return VTKField{name, kind, VTK_scalar::FLOAT32, 1, data};
+}
+
+inline
+VTKField vtk_field(std::string const& name, Entity_kind const kind,
+                   double const *data) {
+  return VTKField{name, kind, VTK_scalar::FLOAT64, 1, data};
+}
+
+template <std::size_t N>
+VTKField vtk_field(std::string const& name, Entity_kind const kind,
+                   std::array<double, N> const *data) {
+  return VTKField{name, kind, VTK_scalar::FLOAT64, static_cast<int>(N),
+        data};
+}
+
+}  // namespace Jali
+
+#endif  /* _JALI_MESHVTK_H_ */
@@ -0,0 +1,258 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "ThreadPool.hh"
+
+#include <algorithm>
+
+namespace Jali {
+
+namespace {
+
+// Thread number within the pool of the current thread while it
+// executes a task, -1 otherwise
+
+thread_local int executing_thread = -1;
+
+}  // namespace
+
+
+ThreadPool& ThreadPool::instance() {
+  static ThreadPool pool;
+  return pool;
+}
+
+
+ThreadPool::~ThreadPool() {
+  resize(1);
+}
+
+
+int ThreadPool::num_threads() const {
+  return std::max(Jali::num_threads(), 1);
+}
+
+
+bool ThreadPool::in_task() {
+  return executing_thread >= 0;
+}
+
+
+// Create the queues (and with std::thread, the workers) for
+// 'nthreads' threads. Only called from run() while no tasks are
+// executing
+
+void ThreadPool::resize(int const nthreads) {
+#if defined(Jali_HAVE_STD_THREAD)
+  if (!workers_.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(state_mutex_);
+      stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& w : workers_) w.join();
+    workers_.clear();
+    stop_ = false;
+  }
+#endif
+
+  nthreads_ = nthreads;
+  queues_.reset(new TaskQueue[nthreads]);
+
+#if defined(Jali_HAVE_STD_THREAD)
+  workers_.reserve(nthreads-1);
+  for (int t = 1; t < nthreads; t++)
+    workers_.emplace_back(&ThreadPool::worker_loop, this, t, generation_);
+#endif
+}
+
+
+// Take a task from the front of our own queue or else from the back
+// of another thread's queue, visiting the other threads in a fixed
+// order starting after our own
+
+bool ThreadPool::next_task(int const ithread, int *itask) {
+  if (failed_) return false;
+
+  for (int i = 0; i < nthreads_; i++) {
+    int const victim = (ithread + i) % nthreads_;
+    TaskQueue& queue = queues_[victim];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) continue;
+    if (victim == ithread) {
+      *itask = queue.tasks.front();
+      queue.tasks.pop_front();
+    } else {
+      *itask = queue.tasks.back();
+      queue.tasks.pop_back();
+    }
+    return true;
+  }
+  return false;
+}
+
+
+// Execute tasks until all queues are empty. No tasks are added while
+// the queues are drained, so a thread that finds every queue empty
+// is done
+
+void ThreadPool::drain(int const ithread) {
+  executing_thread = ithread;
+  int itask;
+  while (next_task(ithread, &itask)) {
+    try {
+      (*task_)(itask, ithread);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(error_mutex_);
+      if (!error_) error_ = std::current_exception();
+      failed_ = true;
+    }
+  }
+  executing_thread = -1;
+}
+
+
+#if defined(Jali_HAVE_STD_THREAD)
+// Wait for each new call to run() (generation) after 'seen' and help
+// drain its tasks
+
+void ThreadPool::worker_loop(int const ithread, std::size_t seen) {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(state_mutex_);
+      start_cv_.wait(lock, [&]() { return stop_ || generation_ != seen; });
+      if (stop_) return;
+      seen = generation_;
+    }
+
+    drain(ithread);
+
+    {
+      std::lock_guard<std::mutex> lock(state_mutex_);
+      if (--busy_workers_ == 0) done_cv_.notify_one();
+    }
+  }
+}
+#endif
+
+
+void ThreadPool::run(int const ntasks,
+                     std::function<void(int, int)> const& task) {
+  if (ntasks <= 0) return;
+
+  // Nested calls and calls without a threading backend run serially
+  // on the calling thread (as its thread number within the pool)
+
+#if defined(Jali_HAVE_OPENMP)
+  bool const serial = in_task() || omp_in_parallel();
+  int const ithread = in_task() ? executing_thread : omp_get_thread_num();
+#else
+  bool const serial = in_task();
+  int const ithread = std::max(executing_thread, 0);
+#endif
+  if (serial || num_threads() == 1) {
+    int const previous = executing_thread;
+    executing_thread = ithread;
+    try {
+      for (int i = 0; i < ntasks; i++)
+        task(i, ithread);
+    } catch (...) {
+      executing_thread = previous;
+      throw;
+    }
+    executing_thread = previous;
+    return;
+  }
+
+  std::lock_guard<std::mutex> run_lock(run_mutex_);
+
+  int const nthreads = num_threads();
+  if (nthreads != nthreads_ || !queues_) resize(nthreads);
+
+  for (int i = 0; i < ntasks; i++)
+    queues_[i % nthreads].tasks.push_back(i);
+  task_ = &task;
+  failed_ = false;
+  error_ = nullptr;
+
+#if defined(Jali_HAVE_OPENMP)
+#pragma omp parallel num_threads(nthreads)
+  {
+    // The runtime may give us fewer threads than requested; the
+    // queues of the missing threads are emptied by stealing
+    drain(omp_get_thread_num());
+  }
+#elif defined(Jali_HAVE_STD_THREAD)
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    busy_workers_ = nthreads-1;
+    generation_++;
+  }
+  start_cv_.notify_all();
+
+  drain(0);  // calling thread
+
+  {
+    std::unique_lock<std::mutex> lock(state_mutex_);
+    done_cv_.wait(lock, [&]() { return busy_workers_ == 0; });
+  }
+#else
+  drain(0);
+#endif
+
+  task_ = nullptr;
+
+  // Tasks skipped after an error are still in the queues
+
+  for (int t = 0; t < nthreads; t++)
+    queues_[t].tasks.clear();
+
+  if (error_) std::rethrow_exception(error_);
+}
+
+}  // end namespace Jali
@@ -0,0 +1,246 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+/*!
+ * @file   ThreadPool.hh
+ * @brief  Persistent work-stealing pool running tile kernels on-node
+ *
+ * Uses the same backend as parallel_for.hh (Jali_THREAD_BACKEND). With
+ * std::thread the worker threads are created once and reused by every
+ * call; with OpenMP the tasks are drained by the threads of a parallel
+ * region; without a threading backend the tasks run on the calling
+ * thread.
+ */
+
+#ifndef _JALI_THREADPOOL_HH_
+#define _JALI_THREADPOOL_HH_
+
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <functional>
+
+#if defined(Jali_HAVE_STD_THREAD)
+#include <thread>
+#include <condition_variable>
+#endif
+
+#include "parallel_for.hh"
+
+namespace Jali {
+
+// Size of the padding that keeps data updated by different threads on
+// separate cache lines. Over-aligned types (alignas) are not honored
+// by new or std::allocator in C++11, so structures are padded by a
+// full cache line instead, which separates their data whatever the
+// alignment of the allocation
+
+constexpr std::size_t cache_line_size = 64;
+
+/*!
+  @class ThreadPool "ThreadPool.hh"
+  @brief Work-stealing pool of on-node threads
+
+  A call to run() queues tasks 0..ntasks-1 round-robin on the threads
+  of the pool, so task i always starts out on thread i % nthreads
+  (its home thread). Each thread pops tasks from the front of its own
+  queue and, once that is empty, steals from the back of the queues of
+  the other threads. With balanced tasks each task therefore runs on
+  its home thread on every call, which keeps the data a task touches
+  in the cache of the same core from one call to the next; unbalanced
+  tasks are evened out by stealing.
+
+  The calling thread takes part as thread 0. A kernel that itself
+  calls run() (directly or through Mesh::for_each_tile) executes the
+  nested tasks serially on its own thread, and calls from different
+  external threads are serialized. The pool follows num_threads()
+  (see parallel_for.hh) and is resized on the next call if that
+  changes.
+*/
+
+class ThreadPool {
+ public:
+
+  /// @brief The pool shared by all meshes in the process
+
+  static ThreadPool& instance();
+
+  /// @brief Destructor - joins the worker threads
+
+  ~ThreadPool();
+
+  ThreadPool(ThreadPool const&) = delete;
+  ThreadPool& operator=(ThreadPool const&) = delete;
+
+  /// @brief Number of threads (including the calling thread) used by run()
+
+  int num_threads() const;
+
+  /// @brief Thread on which task 'itask' is queued first
+
+  int home_thread(int const itask) const {
+    return itask % num_threads();
+  }
+
+  /*!
+    @brief Execute task(itask, ithread) for itask in [0, ntasks)
+    @param ntasks  Number of tasks
+    @param task    Callable as task(itask, ithread); ithread is in
+                   [0, num_threads()) and no two tasks run concurrently
+                   with the same ithread, so it can index per-thread
+                   scratch space (see PerThread)
+
+    Returns when all tasks have completed. If a task throws, tasks
+    that have not started yet are skipped and the first exception is
+    rethrown on the calling thread.
+  */
+
+  void run(int const ntasks, std::function<void(int, int)> const& task);
+
+  /// @brief Whether the calling thread is currently executing a task
+
+  static bool in_task();
+
+ private:
+
+  ThreadPool() = default;
+
+  // Queue of task indices of one thread; padded so that the queues of
+  // different threads do not share cache lines
+
+  struct TaskQueue {
+    std::mutex mutex;
+    std::deque<int> tasks;
+    char pad_[cache_line_size];
+  };
+
+  void resize(int const nthreads);
+  bool next_task(int const ithread, int *itask);
+  void drain(int const ithread);
+
+  int nthreads_ = 1;
+  std::unique_ptr<TaskQueue[]> queues_;
+
+  // State of the current call to run()
+
+  std::function<void(int, int)> const *task_ = nullptr;
+  std::atomic<bool> failed_{false};
+  std::exception_ptr error_ = nullptr;
+  std::mutex error_mutex_;
+
+  // Serializes calls to run() from different external threads
+
+  std::mutex run_mutex_;
+
+#if defined(Jali_HAVE_STD_THREAD)
+  void worker_loop(int const ithread, std::size_t seen);
+
+  std::vector<std::thread> workers_;
+  std::mutex state_mutex_;
+  std::condition_variable start_cv_, done_cv_;
+  std::size_t generation_ = 0;
+  int busy_workers_ = 0;
+  bool stop_ = false;
+#endif
+};
+
+
+/*!
+  @class PerThread "ThreadPool.hh"
+  @brief One instance of T per pool thread, e.g. scratch arrays or
+  partial sums indexed by the ithread argument of a kernel
+
+  The instances are padded to separate cache lines so that threads
+  updating their own instance do not contend with each other.
+*/
+
+template<typename T>
+class PerThread {
+ public:
+
+  /// @brief One copy of 'init' for each thread of the pool
+
+  explicit PerThread(T const& init = T())
+      : slots_(ThreadPool::instance().num_threads(), Slot{init, {}}) {}
+
+  /// @brief Instance of thread 'ithread'
+
+  T& operator[](int const ithread) { return slots_[ithread].value; }
+  T const& operator[](int const ithread) const {
+    return slots_[ithread].value;
+  }
+
+  /// @brief Number of instances
+
+  int size() const { return slots_.size(); }
+
+  /// @brief Fold the instances in thread order with combine(T, T)
+
+  template<typename Combine>
+  T combine(T init, Combine const& combine) const {
+    for (auto const& slot : slots_)
+      init = combine(init, slot.value);
+    return init;
+  }
+
+ private:
+  struct Slot {
+    T value;
+    char pad_[cache_line_size];
+  };
+  std::vector<Slot> slots_;
+};
+
+}  // end namespace Jali
+
+#endif  /* _JALI_THREADPOOL_HH_ */
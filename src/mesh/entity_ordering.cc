@@ -0,0 +1,266 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "entity_ordering.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+#include "parallel_for.hh"
+
+namespace Jali {
+
+namespace {
+
+// Convert grid coordinates (each with 'nbits' bits) in place to the
+// "transposed" Hilbert index using Skilling's algorithm (J. Skilling,
+// Programming the Hilbert curve, AIP Conf. Proc. 707, 2004)
+
+void axes_to_transpose(std::uint32_t *x, int const nbits, int const dim) {
+  std::uint32_t const m = std::uint32_t(1) << (nbits-1);
+
+  // Inverse undo excess work
+
+  for (std::uint32_t q = m; q > 1; q >>= 1) {
+    std::uint32_t const p = q-1;
+    for (int i = 0; i < dim; i++) {
+      if (x[i] & q) {
+        x[0] ^= p;  // invert
+      } else {
+        std::uint32_t const t = (x[0] ^ x[i]) & p;  // exchange
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
+  }
+
+  // Gray encode
+
+  for (int i = 1; i < dim; i++)
+    x[i] ^= x[i-1];
+  std::uint32_t t = 0;
+  for (std::uint32_t q = m; q > 1; q >>= 1)
+    if (x[dim-1] & q) t ^= q-1;
+  for (int i = 0; i < dim; i++)
+    x[i] ^= t;
+}
+
+// Interleave the bits of the grid coordinates, most significant bits
+// first and the first coordinate leading within each bit level
+
+std::uint64_t interleave(std::uint32_t const * const x, int const nbits,
+                         int const dim) {
+  std::uint64_t key = 0;
+  for (int b = nbits-1; b >= 0; b--)
+    for (int i = 0; i < dim; i++)
+      key = (key << 1) | ((x[i] >> b) & 1);
+  return key;
+}
+
+}  // namespace
+
+
+void sfc_order(Entity_ordering const ordering, int const dim,
+               int const npoints, double const * const coords,
+               std::vector<int> *order) {
+  assert(dim >= 1 && dim <= 3);
+  assert(ordering == Entity_ordering::MORTON ||
+         ordering == Entity_ordering::HILBERT);
+
+  order->resize(npoints);
+  std::iota(order->begin(), order->end(), 0);
+  if (npoints < 2) return;
+
+  // Map the bounding box of the points (stretched to a cube so that
+  // the curve does not favor any direction) onto the grid
+
+  double lo[3], hi[3];
+  for (int d = 0; d < dim; d++) {
+    lo[d] = std::numeric_limits<double>::max();
+    hi[d] = -std::numeric_limits<double>::max();
+  }
+  for (int i = 0; i < npoints; i++)
+    for (int d = 0; d < dim; d++) {
+      lo[d] = std::min(lo[d], coords[dim*i+d]);
+      hi[d] = std::max(hi[d], coords[dim*i+d]);
+    }
+  double extent = 0.0;
+  for (int d = 0; d < dim; d++)
+    extent = std::max(extent, hi[d]-lo[d]);
+
+  int const nbits = std::min(63/dim, 21);
+  double const maxcoord = double((std::uint32_t(1) << nbits) - 1);
+  double const scale = (extent > 0.0) ? maxcoord/extent : 0.0;
+
+  std::vector<std::uint64_t> keys(npoints);
+  parallel_for(npoints, [&](int ibegin, int iend, int ithread) {
+      for (int i = ibegin; i < iend; i++) {
+        std::uint32_t x[3];
+        for (int d = 0; d < dim; d++) {
+          double const xd = (coords[dim*i+d]-lo[d])*scale;
+          x[d] = static_cast<std::uint32_t>(std::min(std::max(xd, 0.0),
+                                                     maxcoord));
+        }
+        if (ordering == Entity_ordering::HILBERT && dim > 1)
+          axes_to_transpose(x, nbits, dim);
+        keys[i] = interleave(x, nbits, dim);
+      }
+    });
+
+  std::stable_sort(order->begin(), order->end(),
+                   [&keys](int const i, int const j) {
+                     return keys[i] < keys[j];
+                   });
+}
+
+
+void rcm_order(std::vector<int> const& offsets,
+               std::vector<int> const& adjacency,
+               std::vector<int> *order) {
+  int const n = offsets.size()-1;
+  order->clear();
+  order->reserve(n);
+  if (n <= 0) return;
+
+  auto degree = [&offsets](int const v) { return offsets[v+1]-offsets[v]; };
+
+  std::vector<bool> numbered(n, false);
+
+  // Breadth first search through the unnumbered vertices connected
+  // to 'root'. Returns the number of levels and the vertices of the
+  // last level
+
+  std::vector<int> stamp(n, -1), queue;
+  queue.reserve(n);
+  int nsearch = 0;
+  auto level_structure = [&](int const root, std::vector<int> *lastlevel) {
+    queue.clear();
+    queue.push_back(root);
+    stamp[root] = nsearch;
+    int nlevels = 0;
+    std::size_t begin = 0;
+    while (begin < queue.size()) {
+      std::size_t const end = queue.size();
+      lastlevel->assign(queue.begin()+begin, queue.end());
+      for (std::size_t k = begin; k < end; k++) {
+        int const v = queue[k];
+        for (int j = offsets[v]; j < offsets[v+1]; j++) {
+          int const w = adjacency[j];
+          if (!numbered[w] && stamp[w] != nsearch) {
+            stamp[w] = nsearch;
+            queue.push_back(w);
+          }
+        }
+      }
+      begin = end;
+      nlevels++;
+    }
+    nsearch++;
+    return nlevels;
+  };
+
+  // Vertices in the order of increasing degree so that each
+  // component is started from a vertex of low degree
+
+  std::vector<int> by_degree(n);
+  std::iota(by_degree.begin(), by_degree.end(), 0);
+  std::stable_sort(by_degree.begin(), by_degree.end(),
+                   [&](int const v, int const w) {
+                     return degree(v) < degree(w);
+                   });
+
+  std::vector<int> lastlevel, nbrs;
+  for (int const start : by_degree) {
+    if (numbered[start]) continue;
+
+    // Find a pseudo-peripheral vertex of the component (George and
+    // Liu) by moving to a minimum degree vertex of the last level of
+    // the level structure as long as that makes it deeper
+
+    int root = start;
+    int depth = level_structure(root, &lastlevel);
+    while (true) {
+      int candidate = *std::min_element(lastlevel.begin(), lastlevel.end(),
+                                        [&](int const v, int const w) {
+                                          return degree(v) < degree(w);
+                                        });
+      int const cdepth = level_structure(candidate, &lastlevel);
+      if (cdepth <= depth) break;
+      root = candidate;
+      depth = cdepth;
+    }
+
+    // Cuthill-McKee: number the vertices level by level, visiting the
+    // neighbors of each vertex in the order of increasing degree
+
+    std::size_t next = order->size();
+    order->push_back(root);
+    numbered[root] = true;
+    while (next < order->size()) {
+      int const v = (*order)[next++];
+      nbrs.clear();
+      for (int j = offsets[v]; j < offsets[v+1]; j++)
+        if (!numbered[adjacency[j]]) {
+          nbrs.push_back(adjacency[j]);
+          numbered[adjacency[j]] = true;
+        }
+      std::stable_sort(nbrs.begin(), nbrs.end(),
+                       [&](int const u, int const w) {
+                         return degree(u) < degree(w);
+                       });
+      order->insert(order->end(), nbrs.begin(), nbrs.end());
+    }
+  }
+
+  std::reverse(order->begin(), order->end());
+}
+
+}  // namespace Jali
@@ -0,0 +1,103 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*!
+ * @file   entity_ordering.hh
+ * @brief  Orderings of points and graphs that improve memory locality
+ *         (space filling curves and reverse Cuthill-McKee)
+ *
+ */
+
+#ifndef _entity_ordering_hh_
+#define _entity_ordering_hh_
+
+#include <vector>
+
+#include "MeshDefs.hh"
+
+namespace Jali {
+
+/*!
+  @brief Order points along a Morton (Z-order) or Hilbert curve
+
+  @param ordering   Entity_ordering::MORTON or Entity_ordering::HILBERT
+  @param dim        Dimension of the points - 1, 2 or 3
+  @param npoints    Number of points
+  @param coords     npoints*dim coordinates, interleaved
+  @param order      order[k] is the index of the k'th point along the curve
+
+  The bounding box of the points is mapped onto a grid of 2^(63/dim)
+  (at most 2^21) intervals per direction. Points falling in the same
+  grid box keep their relative order
+*/
+
+void sfc_order(Entity_ordering const ordering, int const dim,
+               int const npoints, double const * const coords,
+               std::vector<int> *order);
+
+
+/*!
+  @brief Reverse Cuthill-McKee ordering of the vertices of a graph
+
+  @param offsets    Neighbors of vertex i are adjacency[offsets[i]] to
+                    adjacency[offsets[i+1]-1] (size is number of vertices+1)
+  @param adjacency  Neighbors of all vertices
+  @param order      order[k] is the index of the k'th vertex in the new order
+
+  Each connected component is started from a pseudo-peripheral vertex
+  of minimum degree. The ordering reduces the bandwidth of the
+  adjacency matrix of the graph
+*/
+
+void rcm_order(std::vector<int> const& offsets,
+               std::vector<int> const& adjacency,
+               std::vector<int> *order);
+
+}  // namespace Jali
+
+#endif
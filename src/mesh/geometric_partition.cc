@@ -0,0 +1,187 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "geometric_partition.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "entity_ordering.hh"
+#include "ThreadPool.hh"
+
+namespace Jali {
+
+namespace {
+
+// Points perm[begin] to perm[end-1] that are to be divided into
+// parts first_part to first_part+nparts-1
+
+struct RCB_group {
+  int begin, end;
+  int first_part, nparts;
+};
+
+}  // namespace
+
+
+void rcb_partition(int const dim, int const npoints,
+                   double const * const coords,
+                   double const * const weights,
+                   int const num_parts, std::vector<int> *part) {
+  assert(dim >= 1 && dim <= 3);
+  assert(num_parts > 0);
+
+  part->assign(npoints, 0);
+  if (npoints == 0 || num_parts == 1) return;
+
+  auto weight = [&](int const i) { return weights ? weights[i] : 1.0; };
+
+  std::vector<int> perm(npoints);
+  std::iota(perm.begin(), perm.end(), 0);
+
+  // Split all groups of a level, then move on to the groups they
+  // were split into. A group of one part is final
+
+  std::vector<RCB_group> groups = {{0, npoints, 0, num_parts}};
+  while (!groups.empty()) {
+    std::vector<RCB_group> split(2*groups.size());
+    ThreadPool::instance().run(groups.size(), [&](int g, int ithread) {
+        RCB_group const& group = groups[g];
+
+        // Cut across the longest extent of the bounding box
+
+        double lo[3], hi[3];
+        for (int d = 0; d < dim; d++) {
+          lo[d] = std::numeric_limits<double>::max();
+          hi[d] = -std::numeric_limits<double>::max();
+        }
+        for (int k = group.begin; k < group.end; k++)
+          for (int d = 0; d < dim; d++) {
+            lo[d] = std::min(lo[d], coords[dim*perm[k]+d]);
+            hi[d] = std::max(hi[d], coords[dim*perm[k]+d]);
+          }
+        int axis = 0;
+        for (int d = 1; d < dim; d++)
+          if (hi[d]-lo[d] > hi[axis]-lo[axis]) axis = d;
+
+        // Ties are broken by index so that the cut is deterministic
+
+        std::sort(perm.begin() + group.begin, perm.begin() + group.end,
+                  [&](int const i, int const j) {
+                    double const xi = coords[dim*i+axis];
+                    double const xj = coords[dim*j+axis];
+                    return xi < xj || (xi == xj && i < j);
+                  });
+
+        // Cut where the weight of the lower half is closest to its
+        // share of the weight of the group
+
+        int const nlower = group.nparts/2;
+        double total = 0.0;
+        for (int k = group.begin; k < group.end; k++)
+          total += weight(perm[k]);
+        double const target = total*nlower/group.nparts;
+
+        int cut = group.begin;
+        double sum = 0.0;
+        while (cut < group.end && sum + weight(perm[cut])/2 < target)
+          sum += weight(perm[cut++]);
+
+        split[2*g] = {group.begin, cut, group.first_part, nlower};
+        split[2*g+1] = {cut, group.end, group.first_part + nlower,
+                        group.nparts - nlower};
+      });
+
+    groups.clear();
+    for (auto const& group : split) {
+      if (group.nparts > 1) {
+        groups.push_back(group);
+      } else {
+        for (int k = group.begin; k < group.end; k++)
+          (*part)[perm[k]] = group.first_part;
+      }
+    }
+  }
+}
+
+
+void sfc_partition(Entity_ordering const ordering, int const dim,
+                   int const npoints, double const * const coords,
+                   double const * const weights,
+                   int const num_parts, std::vector<int> *part) {
+  assert(num_parts > 0);
+
+  part->assign(npoints, 0);
+  if (npoints == 0 || num_parts == 1) return;
+
+  std::vector<int> order;
+  sfc_order(ordering, dim, npoints, coords, &order);
+
+  auto weight = [&](int const i) { return weights ? weights[i] : 1.0; };
+
+  double total = 0.0;
+  for (int i = 0; i < npoints; i++)
+    total += weight(i);
+
+  // A point goes to the part that contains the middle of its stretch
+  // of the curve when the curve is divided into pieces of equal weight
+
+  double sum = 0.0;
+  for (auto const& i : order) {
+    double const middle = sum + weight(i)/2;
+    int const p = (total > 0.0) ?
+        static_cast<int>(std::floor(middle/total*num_parts)) : 0;
+    (*part)[i] = std::min(std::max(p, 0), num_parts-1);
+    sum += weight(i);
+  }
+}
+
+}  // namespace Jali
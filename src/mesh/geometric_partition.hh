@@ -0,0 +1,115 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/*!
+ * @file   geometric_partition.hh
+ * @brief  Dependency-free partitioners of weighted points (e.g. cell
+ *         centroids) by recursive coordinate bisection or along a
+ *         space filling curve
+ *
+ */
+
+#ifndef _geometric_partition_hh_
+#define _geometric_partition_hh_
+
+#include <vector>
+
+#include "MeshDefs.hh"
+
+namespace Jali {
+
+/*!
+  @brief Partition points by recursive coordinate bisection (RCB)
+
+  @param dim        Dimension of the points - 1, 2 or 3
+  @param npoints    Number of points
+  @param coords     npoints*dim coordinates, interleaved
+  @param weights    npoints weights (cost of each point), or nullptr
+                    for unit weights
+  @param num_parts  Number of parts
+  @param part       part[i] is the part (0 to num_parts-1) of point i
+
+  The points are split across the longest extent of their bounding
+  box into two groups whose weights are in the ratio of the number of
+  parts assigned to each group, recursively, so the parts are compact
+  and of about equal weight. The groups of a level are split
+  concurrently on the thread pool; the result does not depend on the
+  number of threads
+*/
+
+void rcb_partition(int const dim, int const npoints,
+                   double const * const coords,
+                   double const * const weights,
+                   int const num_parts, std::vector<int> *part);
+
+
+/*!
+  @brief Partition points into contiguous pieces of a space filling
+  curve
+
+  @param ordering   Entity_ordering::MORTON or Entity_ordering::HILBERT
+  @param dim        Dimension of the points - 1, 2 or 3
+  @param npoints    Number of points
+  @param coords     npoints*dim coordinates, interleaved
+  @param weights    npoints weights (cost of each point), or nullptr
+                    for unit weights
+  @param num_parts  Number of parts
+  @param part       part[i] is the part (0 to num_parts-1) of point i
+
+  The points are ordered along the curve (see sfc_order) and the
+  curve is cut into num_parts pieces of about equal weight
+*/
+
+void sfc_partition(Entity_ordering const ordering, int const dim,
+                   int const npoints, double const * const coords,
+                   double const * const weights,
+                   int const num_parts, std::vector<int> *part);
+
+}  // namespace Jali
+
+#endif
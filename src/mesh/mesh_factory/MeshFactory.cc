@@ -48,8 +48,11 @@
 
 #include "MeshFactory.hh"
 #include "Geometry.hh"
+#include "instrumentation.hh"
 
 #include "Mesh_simple.hh"
+#include "Mesh_structured.hh"
+#include "Mesh_snapshot.hh"
 
 #ifdef HAVE_MSTK_MESH
 #include "Mesh_MSTK.hh"
@@ -81,6 +84,9 @@ std::string framework_name(MeshFramework_t const& f) {
     case (MSTK):
       return "MSTK";
       break;
+    case (Structured):
+      return "Structured";
+      break;
     default:
       Errors::Message mesg("Unknown framework");
       Exceptions::Jali_throw(mesg);
@@ -90,7 +96,7 @@ std::string framework_name(MeshFramework_t const& f) {
 
 /// Check if a framework is available for use
 bool framework_available(MeshFramework_t const& f) {
-  if (f == Simple || f == MSTK)
+  if (f == Simple || f == MSTK || f == Structured)
     return true;
   else
     return false;
@@ -106,6 +112,8 @@ bool framework_generates(MeshFramework_t const& f, bool const parallel,
       return (dim == 2 || dim == 3);
     case Jali::STKMESH:
       return (dim == 3 && !parallel);
+    case Jali::Structured:
+      return !parallel;
     default:
       return false;
   }
@@ -113,6 +121,9 @@ bool framework_generates(MeshFramework_t const& f, bool const parallel,
 
 bool framework_reads(MeshFramework_t const& f, bool const parallel,
                      MeshFormat_t const& format) {
+  if (format == Jali::JaliSnapshot)  // read without a framework
+    return framework_available(f);
+
   switch (f) {
     case Jali::MSTK:
       return (format == Jali::ExodusII);
@@ -169,6 +180,9 @@ void MeshFactory::reset_options(void) {
   /// Partitioner type
   partitioner_ = partitioner_default_;
 
+  /// Ordering of entities
+  ordering_ = ordering_default_;
+
   /// Geometry type
   geom_type_ = geom_type_default_;
 
@@ -179,6 +193,21 @@ void MeshFactory::reset_options(void) {
   contiguous_gids_ = false;
 }
 
+/**
+ * @brief Renumber the entities of a newly created mesh if an ordering
+ * other than Entity_ordering::NONE was requested
+ *
+ * @param mesh mesh instance
+ * @return the same mesh instance
+ */
+
+std::shared_ptr<Mesh>
+MeshFactory::reorder(std::shared_ptr<Mesh> mesh) const {
+  if (mesh && ordering_ != Entity_ordering::NONE)
+    mesh->reorder_entities(ordering_);
+  return mesh;
+}
+
 /**
  *
  * @brief Create a mesh by reading the specified file (or file set).
@@ -188,10 +217,32 @@ void MeshFactory::reset_options(void) {
 
 std::shared_ptr<Mesh>
 MeshFactory::create(std::string const& filename) {
+  JALI_TIME_SCOPE("MeshFactory::create(file)");
   Errors::Message errmsg("MeshFactory:: unable to create mesh");
   int ierr = 0, aerr = 0;
 
   std::shared_ptr<Mesh> result;
+
+  // Snapshots are mapped back directly whatever the framework
+
+  if (is_mesh_snapshot(filename, comm_)) {
+    try {
+      result = std::make_shared<Mesh_snapshot>(filename, comm_,
+                                               geometric_model_);
+      if (geometric_model_ &&
+          (geometric_model_->dimension() != result->space_dimension())) {
+        ierr = 1;
+        errmsg.add_data("Geometric model and mesh dimension do not match");
+      }
+    } catch (const Errors::Message& msg) {
+      ierr = 1;
+      errmsg.add_data(msg.what());
+    }
+    MPI_Allreduce(&ierr, &aerr, 1, MPI_INT, MPI_SUM, comm_);
+    if (aerr > 0) Exceptions::Jali_throw(errmsg);
+    return result;
+  }
+
   try {
     switch (framework_) {
 #ifdef HAVE_MSTK_MESH
@@ -252,6 +303,7 @@ std::shared_ptr<Mesh>
 MeshFactory::create(double const x0, double const y0, double const z0,
                     double const x1, double const y1, double const z1,
                     int const nx, int const ny, int const nz) {
+  JALI_TIME_SCOPE("MeshFactory::create(3d)");
   std::stringstream mesgstr;
   std::shared_ptr<Mesh> result;
   Errors::Message errmsg("MeshFactory::create - Unable to create 3D mesh");
@@ -307,6 +359,28 @@ MeshFactory::create(double const x0, double const y0, double const z0,
         }
         break;
       }
+      case Structured: {
+        if (numprocs == 1) {
+          result =
+              std::make_shared<Mesh_structured>(x0, y0, z0,
+                                                x1, y1, z1,
+                                                nx, ny, nz,
+                                                comm_, geometric_model_,
+                                                request_faces_, request_edges_,
+                                                request_sides_, request_wedges_,
+                                                request_corners_,
+                                                num_tiles_,
+                                                num_ghost_layers_tile_,
+                                                num_ghost_layers_distmesh_,
+                                                request_boundary_ghosts_,
+                                                partitioner_);
+          return result;
+        } else {
+          ierr = 1;
+          errmsg.add_data("Structured framework cannot generate parallel meshes");
+        }
+        break;
+      }
 #ifdef HAVE_MSTK_MESH
       case MSTK: {
         result =
@@ -357,6 +431,7 @@ std::shared_ptr<Mesh>
 MeshFactory::create(double const x0, double const y0,
                     double const x1, double const y1,
                     int const nx, int const ny) {
+  JALI_TIME_SCOPE("MeshFactory::create(2d)");
   std::shared_ptr<Mesh> result;
   Errors::Message errmsg("MeshFactory::create: error: ");
   int ierr = 0, aerr = 0;
@@ -411,6 +486,26 @@ MeshFactory::create(double const x0, double const y0,
         }
         break;
       }
+      case Structured: {
+        if (numprocs == 1) {
+          result =
+              std::make_shared<Mesh_structured>(x0, y0, x1, y1, nx, ny,
+                                                comm_, geometric_model_,
+                                                request_faces_, request_edges_,
+                                                request_sides_, request_wedges_,
+                                                request_corners_,
+                                                num_tiles_,
+                                                num_ghost_layers_tile_,
+                                                num_ghost_layers_distmesh_,
+                                                request_boundary_ghosts_,
+                                                partitioner_, geom_type_);
+          return result;
+        } else {
+          ierr = 1;
+          errmsg.add_data("Structured framework cannot generate mesh in parallel");
+        }
+        break;
+      }
 #ifdef HAVE_MSTK_MESH
       case MSTK: {
         result =
@@ -454,6 +549,7 @@ MeshFactory::create(double const x0, double const y0,
 
 std::shared_ptr<Mesh>
 MeshFactory::create(std::vector<double> const& x) {
+  JALI_TIME_SCOPE("MeshFactory::create(1d)");
   std::shared_ptr<Mesh> result;
   Errors::Message errmsg("MeshFactory::create: error: ");
   int ierr = 0, aerr = 0;
@@ -507,6 +603,25 @@ MeshFactory::create(std::vector<double> const& x) {
         }
         break;
       }
+      case Structured: {
+        if (numprocs == 1) {
+          result =
+              std::make_shared<Mesh_structured>(x, comm_, geometric_model_,
+                                                request_faces_, request_edges_,
+                                                request_sides_, request_wedges_,
+                                                request_corners_,
+                                                num_tiles_,
+                                                num_ghost_layers_tile_,
+                                                num_ghost_layers_distmesh_,
+                                                request_boundary_ghosts_,
+                                                partitioner_, geom_type_);
+          return result;
+        } else {
+          ierr = 1;
+          errmsg.add_data("Structured framework cannot generate parallel 1D mesh");
+        }
+        break;
+      }
       default: {
         ierr = 1;
         errmsg.add_data("Chosen framework cannot generate 1D mesh");
@@ -545,6 +660,7 @@ MeshFactory::create(std::shared_ptr<Mesh> const inmesh,
                     std::vector<std::string> const& setnames,
                     Entity_kind const setkind,
                     bool const flatten, bool const extrude) {
+  JALI_TIME_SCOPE("MeshFactory::create(extract)");
   std::shared_ptr<Mesh> result;
   Errors::Message errmsg("MeshFactory::create: error: ");
   int ierr = 0, aerr = 0;
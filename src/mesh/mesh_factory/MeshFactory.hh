@@ -78,14 +78,16 @@ enum MeshFramework_t {
   Simple = 1,
   MSTK,
   MOAB,
-  STKMESH
+  STKMESH,
+  Structured   // implicit topology for logically rectangular meshes
 };
 
 /// A type to identify mesh file formats
 enum MeshFormat_t {
   ExodusII = 1,
   MOABHDF5,
-  FLAGX3D
+  FLAGX3D,
+  JaliSnapshot   // written by Mesh::write_snapshot
 };
 
 /// Get a name for a given framework
@@ -131,7 +133,7 @@ class MeshFactory {
 
   /// Set the framework to use
   void framework(MeshFramework_t const& framework) {
-    if (framework == Simple || framework == MSTK) {
+    if (framework_available(framework)) {
       framework_ = framework;
     } else {
       std::stringstream mesgstrm;
@@ -151,6 +153,20 @@ class MeshFactory {
     partitioner_ = partitioner;
   }
 
+  /// Get the ordering of entities in the meshes to be created
+  /// (default Entity_ordering::NONE, i.e. the framework's numbering)
+  Entity_ordering ordering(void) const {
+    return ordering_;
+  }
+
+  /// Set the ordering of entities in the meshes to be created. Other
+  /// orderings renumber nodes, edges, faces and cells to improve
+  /// memory locality once the mesh is created (see
+  /// Mesh::reorder_entities and Mesh::entity_new_to_old)
+  void ordering(Entity_ordering ordering) {
+    ordering_ = ordering;
+  }
+
   /// Get the geometry type for the meshes to be created (default CARTESIAN)
   JaliGeometry::Geom_type mesh_geometry(void) const {
     return geom_type_;
@@ -307,8 +323,12 @@ class MeshFactory {
   }
 
   /// Create a mesh by reading the specified file (or set of files) -- operator
+  ///
+  /// Jali snapshots (see Mesh::write_snapshot) are recognized by their
+  /// contents and mapped back with the entity kinds and tiles they were
+  /// written with, whatever the framework and options set here
   std::shared_ptr<Mesh> operator() (std::string const& filename) {
-    return create(filename);
+    return reorder(create(filename));
   }
 
   /// Create a hexahedral mesh of the specified dimensions -- operator
@@ -317,19 +337,19 @@ class MeshFactory {
                                     double const x1, double const y1,
                                     double const z1,
                                     int const nx, int const ny, int const nz) {
-    return create(x0, y0, z0, x1, y1, z1, nx, ny, nz);
+    return reorder(create(x0, y0, z0, x1, y1, z1, nx, ny, nz));
   }
 
   /// Create a quadrilateral mesh of the specified dimensions -- operator
   std::shared_ptr<Mesh> operator() (double const x0, double const y0,
                                     double const x1, double const y1,
                                     int const nx, int const ny) {
-    return create(x0, y0, x1, y1, nx, ny);
+    return reorder(create(x0, y0, x1, y1, nx, ny));
   }
 
   /// Create a 1d mesh -- operator
   std::shared_ptr<Mesh> operator() (std::vector<double> const& x) {
-    return create(x);
+    return reorder(create(x));
   }
 
   /// Create a 1d mesh -- operator
@@ -344,7 +364,7 @@ class MeshFactory {
       myX += dX;
     }
 
-    return create(x);
+    return reorder(create(x));
   }
 
   /// Create a mesh by extract subsets of entities from an existing mesh
@@ -353,7 +373,7 @@ class MeshFactory {
                                     Entity_kind const setkind,
                                     bool const flatten = false,
                                     bool const extrude = false) {
-    return create(inmesh, setnames, setkind, flatten, extrude);
+    return reorder(create(inmesh, setnames, setkind, flatten, extrude));
   }
 
  private:
@@ -387,6 +407,10 @@ class MeshFactory {
                                bool const extrude = false);
 
 
+  /// Renumber the entities of a newly created mesh as requested
+  std::shared_ptr<Mesh> reorder(std::shared_ptr<Mesh> mesh) const;
+
+
   /// The parallel environment
   MPI_Comm const comm_;
 
@@ -432,6 +456,10 @@ class MeshFactory {
   Partitioner_type const partitioner_default_ = Partitioner_type::INDEX;
   Partitioner_type partitioner_ = partitioner_default_;
 
+  /// Ordering of entities
+  Entity_ordering const ordering_default_ = Entity_ordering::NONE;
+  Entity_ordering ordering_ = ordering_default_;
+
   /// Geometry type
   JaliGeometry::Geom_type const geom_type_default_ =
       JaliGeometry::Geom_type::CARTESIAN;
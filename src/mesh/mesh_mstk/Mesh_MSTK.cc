@@ -57,12 +57,14 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <mpi.h>
 
 #include "errors.hh"
+#include "instrumentation.hh"
 
 
 namespace Jali {
 
 void Mesh_MSTK::init_mesh_from_file_(std::string const filename,
                                      const Partitioner_type partitioner) {
+  JALI_TIME_SCOPE("Mesh_MSTK::init_mesh_from_file_");
 
   int ok = 0;
 
@@ -84,8 +86,20 @@ void Mesh_MSTK::init_mesh_from_file_(std::string const filename,
       int topo_dim = MESH_Num_Regions(mesh) ? 3 : 2;
       int with_attr = 1;  // Redistribute any attributes and sets
 
-      // MSTK does not know about INDEX, BLOCK partitioners
-      int method = static_cast<int>(partitioner)-2; 
+      // MSTK does not know about INDEX, BLOCK partitioners or the
+      // built-in RCB, HILBERT (tile) partitioners - distribute the
+      // mesh with the nearest one MSTK has
+      int method;
+      if (partitioner == Partitioner_type::RCB ||
+          partitioner == Partitioner_type::HILBERT) {
+#ifdef Jali_HAVE_ZOLTAN
+        method = static_cast<int>(Partitioner_type::ZOLTAN_RCB)-2;
+#else
+        method = static_cast<int>(Partitioner_type::METIS)-2;
+#endif
+      } else {
+        method = static_cast<int>(partitioner)-2;
+      }
 
       int del_inmesh = 1;  // Delete input mesh (on P0) after distribution
       
@@ -2459,6 +2473,14 @@ void Mesh_MSTK::cell_get_coordinates(const Entity_ID cellid,
 
   assert(ccoords != NULL);
 
+  // Nodes are in the same order as in cell_get_nodes, so once the cell
+  // nodes and the node coordinates are cached read them from there
+
+  if (cell2node_info_cached && node_coords_cached) {
+    get_node_coordinates(cell_get_nodes_view(cellid), ccoords);
+    return;
+  }
+
   cell = cell_id_to_handle[cellid];
 
   if (celldim == 3) {
@@ -2511,6 +2533,14 @@ void Mesh_MSTK::face_get_coordinates(const Entity_ID faceid,
   assert(faces_initialized);
   assert(fcoords != NULL);
 
+  // Nodes are in the same order as in face_get_nodes, so once the face
+  // nodes and the node coordinates are cached read them from there
+
+  if (face2node_info_cached && node_coords_cached) {
+    get_node_coordinates(face_get_nodes_view(faceid), fcoords);
+    return;
+  }
+
   genface = face_id_to_handle[faceid];
 
   if (celldim == 3) {
@@ -2558,6 +2588,7 @@ void Mesh_MSTK::node_set_coordinates(const Jali::Entity_ID nodeid,
                                       const double *coords) {
   MVertex_ptr v = vtx_id_to_handle[nodeid];
   MV_Set_Coords(v, (double *) coords);
+  Mesh::node_coordinates_changed(nodeid, coords);
 }
 
 void Mesh_MSTK::node_set_coordinates(const Jali::Entity_ID nodeid,
@@ -2569,6 +2600,7 @@ void Mesh_MSTK::node_set_coordinates(const Jali::Entity_ID nodeid,
     coordarray[i] = coords[i];
 
   MV_Set_Coords(v, (double *) coordarray);
+  Mesh::node_coordinates_changed(nodeid, coordarray);
 }
 
 
@@ -3359,6 +3391,8 @@ Entity_ID Mesh_MSTK::GID(const Entity_ID lid, const Entity_kind kind) const {
 // Procedure to perform all the post-mesh creation steps in a constructor
 
 void Mesh_MSTK::post_create_steps_() {
+  JALI_TIME_SCOPE("Mesh_MSTK::post_create_steps_");
+
   // Create boundary ghost elements (if requested). Regardless of what
   // the requested number of layers is, we will create only 1 layer
 
@@ -3732,6 +3766,53 @@ void Mesh_MSTK::init_cell_id2handle_maps() {
 }  // Mesh_MSTK::init_id_handle_maps
 
 
+// Renumber entities of a kind - new entity i is old entity new2old[i]
+
+void Mesh_MSTK::renumber_entities_internal(const Entity_kind kind,
+                                           std::vector<Entity_ID> const&
+                                           new2old) {
+  std::vector<MEntity_ptr> *id_to_handle;
+  bool *flip = nullptr;  // per entity flags indexed by ID
+
+  switch (kind) {
+    case Entity_kind::NODE:
+      id_to_handle = &vtx_id_to_handle;
+      break;
+    case Entity_kind::EDGE:
+      id_to_handle = &edge_id_to_handle;
+      flip = edgeflip;
+      break;
+    case Entity_kind::FACE:
+      id_to_handle = &face_id_to_handle;
+      flip = faceflip;
+      break;
+    case Entity_kind::CELL:
+      id_to_handle = &cell_id_to_handle;
+      break;
+    default: {
+      Errors::Message mesg("Mesh_MSTK::renumber_entities_internal - Cannot renumber this kind of entity");
+      Exceptions::Jali_throw(mesg);
+    }
+  }
+
+  int n = new2old.size();
+  assert(new2old.size() == id_to_handle->size());
+
+  std::vector<MEntity_ptr> old_handles(*id_to_handle);
+  for (int i = 0; i < n; i++) {
+    MEntity_ptr ent = old_handles[new2old[i]];
+    (*id_to_handle)[i] = ent;
+    MEnt_Set_ID(ent, i+1);  // MSTK IDs start from 1
+  }
+
+  if (flip) {
+    std::vector<bool> old_flip(flip, flip+n);
+    for (int i = 0; i < n; i++)
+      flip[i] = old_flip[new2old[i]];
+  }
+}
+
+
 // create lists of owned and not owned vertices
 
 void Mesh_MSTK::init_pvert_lists() {
@@ -5303,7 +5384,6 @@ void Mesh_MSTK::inherit_labeled_sets(MAttrib_ptr copyatt,
 // Get the number of fields on entities of a particular type
 // along with their names and variable types
 
-inline
 void Mesh_MSTK::get_field_info(Entity_kind on_what, int *num,
                                std::vector<std::string> *varnames,
                                std::vector<std::string> *vartypes) const {
@@ -5332,188 +5412,81 @@ void Mesh_MSTK::get_field_info(Entity_kind on_what, int *num,
     }
   }
 
-  *num = varnames->size();
+  // Fields stored with the mesh that are not attributes yet
 
-}
-
-// Retrieve integer field data from the mesh
-
-bool Mesh_MSTK::get_field(std::string field_name, Entity_kind on_what,
-                          int *data) const {
-  MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
-  if (!mattrib) return false;
-
-  if (entity_kind_to_mtype(on_what) != (int) MAttrib_Get_EntDim(mattrib))
-    return false;
-
-  if (MAttrib_Get_Type(mattrib) != INT) return false;
-
-  MType enttype = MAttrib_Get_EntDim(mattrib);
-
-  int nent;
-  switch (enttype) {
-    case MVERTEX: nent = MESH_Num_Vertices(mesh); break;
-    case MEDGE: nent = MESH_Num_Edges(mesh); break;
-    case MFACE: nent = MESH_Num_Faces(mesh); break;
-    case MREGION: nent = MESH_Num_Regions(mesh); break;
-    default: nent = 0; break;
-  }
-
-  MEntity_ptr ment;
-  for (int i = 0; i < nent; i++) {
-    switch (enttype) {
-      case MVERTEX: ment = MESH_Vertex(mesh, i); break;
-      case MEDGE: ment = MESH_Edge(mesh, i); break;
-      case MFACE: ment = MESH_Face(mesh, i); break;
-      case MREGION: ment = MESH_Region(mesh, i); break;
-      default: ment = NULL; break;
+  int nstored;
+  std::vector<std::string> storednames, storedtypes;
+  Mesh::get_field_info(on_what, &nstored, &storednames, &storedtypes);
+  for (int i = 0; i < nstored; i++) {
+    if (std::find(varnames->begin(), varnames->end(), storednames[i]) ==
+        varnames->end()) {
+      varnames->push_back(storednames[i]);
+      vartypes->push_back(storedtypes[i]);
     }
-    if (ment == NULL) continue;  // not needed since nent=0 but here anyway
-
-    double rval;
-    void *pval;
-    MEnt_Get_AttVal(ment, mattrib, &(data[i]), &rval, &pval);
-  }  // for
-
-  return true;
-}  // Mesh_MSTK::get_mesh_field
-
-
-
-// Retrieve real field data from the mesh
-
-bool Mesh_MSTK::get_field(std::string field_name, Entity_kind on_what,
-                          double *data) const {
-  MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
-  if (!mattrib) return false;
-
-  if (entity_kind_to_mtype(on_what) != (int) MAttrib_Get_EntDim(mattrib))
-    return false;
-
-  if (MAttrib_Get_Type(mattrib) != DOUBLE) return false;
-
-  MType enttype = MAttrib_Get_EntDim(mattrib);
-
-  int nent;
-  switch (enttype) {
-    case MVERTEX: nent = MESH_Num_Vertices(mesh); break;
-    case MEDGE: nent = MESH_Num_Edges(mesh); break;
-    case MFACE: nent = MESH_Num_Faces(mesh); break;
-    case MREGION: nent = MESH_Num_Regions(mesh); break;
-    default: nent = 0; break;
   }
 
-  MEntity_ptr ment;
-  for (int i = 0; i < nent; i++) {
-    switch (enttype) {
-      case MVERTEX: ment = MESH_Vertex(mesh, i); break;
-      case MEDGE: ment = MESH_Edge(mesh, i); break;
-      case MFACE: ment = MESH_Face(mesh, i); break;
-      case MREGION: ment = MESH_Region(mesh, i); break;
-      default: ment = NULL; break;
-    }
-    if (ment == NULL) continue;  // not needed since nent=0 but here anyway
-
-    int ival;
-    void *pval;
-    MEnt_Get_AttVal(ment, mattrib, &ival, &(data[i]), &pval);
-  }  // for
-
-  return true;
-}  // Mesh_MSTK::get_mesh_field
-
-
-// Store integer field data with the mesh
-
-bool Mesh_MSTK::store_field(std::string field_name, Entity_kind on_what,
-                            int *data) {
-  MType mtype = entity_kind_to_mtype(on_what);
-
-  MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
-  if (mattrib) {
-    if (mtype != (int) MAttrib_Get_EntDim(mattrib))
-      return false;
+  *num = varnames->size();
+}
 
-    if (MAttrib_Get_Type(mattrib) != INT) {
-      std::cerr << "Mesh_MSTK::store_field -" <<
-          " found attribute with same name but different type" << std::endl;
-      return false;
-    }
-  } else
-    mattrib = MAttrib_New(mesh, field_name.c_str(), INT, mtype);
+// MSTK entities of a kind in the order of their Jali IDs
 
-  int nent;
-  switch (mtype) {
-    case MVERTEX: nent = MESH_Num_Vertices(mesh); break;
-    case MEDGE: nent = MESH_Num_Edges(mesh); break;
-    case MFACE: nent = MESH_Num_Faces(mesh); break;
-    case MREGION: nent = MESH_Num_Regions(mesh); break;
-    default: nent = 0; break;
+std::vector<MEntity_ptr> Mesh_MSTK::field_entities(Entity_kind on_what) const {
+  std::vector<MEntity_ptr> const *id_to_handle = nullptr;
+  switch (on_what) {
+    case Entity_kind::NODE: id_to_handle = &vtx_id_to_handle; break;
+    case Entity_kind::EDGE: id_to_handle = &edge_id_to_handle; break;
+    case Entity_kind::FACE: id_to_handle = &face_id_to_handle; break;
+    case Entity_kind::CELL: id_to_handle = &cell_id_to_handle; break;
+    default: break;
   }
+  if (id_to_handle && !id_to_handle->empty()) return *id_to_handle;
 
-  MEntity_ptr ment;
-  for (int i = 0; i < nent; i++) {
-    switch (mtype) {
-      case MVERTEX: ment = MESH_Vertex(mesh, i); break;
-      case MEDGE: ment = MESH_Edge(mesh, i); break;
-      case MFACE: ment = MESH_Face(mesh, i); break;
-      case MREGION: ment = MESH_Region(mesh, i); break;
-      default: ment = NULL; break;
-    }
-    if (ment == NULL) continue;  // not needed since nent=0 but here anyway
-
-    MEnt_Set_AttVal(ment, mattrib, data[i], 0.0, NULL);
-
-  }  // for (int i...);
-
-  return true;
-}  // Mesh_MSTK::store_mesh_field
-
+  // Jali does not have these entities (e.g. edges were not
+  // requested) - go by MSTK's order
 
-// Store real field data with the mesh
-
-bool Mesh_MSTK::store_field(std::string field_name, Entity_kind on_what,
-                            double *data) {
-  MType mtype = entity_kind_to_mtype(on_what);
-
-  MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
-  if (mattrib) {
-    if (mtype != (int) MAttrib_Get_EntDim(mattrib))
-      return false;
-
-    if (MAttrib_Get_Type(mattrib) != DOUBLE) {
-      std::cerr << "Mesh_MSTK::store_field -" <<
-          " found attribute with same name but different type" << std::endl;
-      return false;
-    }
-  } else
-    mattrib = MAttrib_New(mesh, field_name.c_str(), DOUBLE, mtype);
-
-  int nent;
+  std::vector<MEntity_ptr> ents;
+  MType const mtype = entity_kind_to_mtype(on_what);
+  MEntity_ptr ment;
+  int idx = 0;
   switch (mtype) {
-    case MVERTEX: nent = MESH_Num_Vertices(mesh); break;
-    case MEDGE: nent = MESH_Num_Edges(mesh); break;
-    case MFACE: nent = MESH_Num_Faces(mesh); break;
-    case MREGION: nent = MESH_Num_Regions(mesh); break;
-    default: nent = 0; break;
+    case MVERTEX:
+      while ((ment = MESH_Next_Vertex(mesh, &idx))) ents.push_back(ment);
+      break;
+    case MEDGE:
+      while ((ment = MESH_Next_Edge(mesh, &idx))) ents.push_back(ment);
+      break;
+    case MFACE:
+      while ((ment = MESH_Next_Face(mesh, &idx))) ents.push_back(ment);
+      break;
+    case MREGION:
+      while ((ment = MESH_Next_Region(mesh, &idx))) ents.push_back(ment);
+      break;
+    default: break;
   }
+  return ents;
+}
 
-  MEntity_ptr ment;
-  for (int i = 0; i < nent; i++) {
-    switch (mtype) {
-      case MVERTEX: ment = MESH_Vertex(mesh, i); break;
-      case MEDGE: ment = MESH_Edge(mesh, i); break;
-      case MFACE: ment = MESH_Face(mesh, i); break;
-      case MREGION: ment = MESH_Region(mesh, i); break;
-      default: ment = NULL; break;
-    }
-    if (ment == NULL) continue;  // not needed since nent=0 but here anyway
-
-    MEnt_Set_AttVal(ment, mattrib, 0.0, data[i], NULL);
-  }  // for (int i...);
 
-  return true;
-}  // Mesh_MSTK::store_mesh_field
+// Move the fields stored since the last export to MSTK attributes so
+// that MSTK's writers see them
+
+void Mesh_MSTK::export_fields_to_attributes() const {
+  for (auto const& kv : fields_to_export_) {
+    std::string const& name = kv.first;
+    Entity_kind const kind = kv.second;
+    if (auto data = field_data<int>(name, kind))
+      store_attrib_field(name, kind, data);
+    else if (auto data = field_data<double>(name, kind))
+      store_attrib_field(name, kind, data);
+    else if (auto data = field_data<std::array<double, 2>>(name, kind))
+      store_attrib_field(name, kind, data);
+    else if (auto data = field_data<std::array<double, 3>>(name, kind))
+      store_attrib_field(name, kind, data);
+    else if (auto data = field_data<std::array<double, 6>>(name, kind))
+      store_attrib_field(name, kind, data);
+  }
+  fields_to_export_.clear();
+}
 
 
 // Run MSTK's internal checks - meant for debugging only
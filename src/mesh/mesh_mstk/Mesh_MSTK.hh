@@ -51,7 +51,10 @@
 #include "MSTK.h"
 
 #include <cstdint>
+#include <array>
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 #include <sstream>
 #include <typeinfo>
@@ -404,12 +407,14 @@ class Mesh_MSTK : public Mesh {
 
   void write_to_exodus_file(const std::string exodusfilename,
                             bool with_fields = true) const {
-    if (with_fields)
+    if (with_fields) {
+      export_fields_to_attributes();
       MESH_ExportToFile(mesh, exodusfilename.c_str(), "exodusii", 0, NULL,
                         NULL, mpicomm);
-    else
+    } else {
       MESH_ExportToFile(mesh, exodusfilename.c_str(), "exodusii", -1, NULL,
                         NULL, mpicomm);
+    }
   }
 
 
@@ -419,12 +424,14 @@ class Mesh_MSTK : public Mesh {
 
   void write_to_gmv_file(const std::string gmvfilename,
                          bool with_fields = true) const {
-    if (with_fields)
+    if (with_fields) {
+      export_fields_to_attributes();
       MESH_ExportToFile(mesh, gmvfilename.c_str(), "gmv", 0, NULL, NULL,
                         mpicomm);
-    else
+    } else {
       MESH_ExportToFile(mesh, gmvfilename.c_str(), "gmv", -1, NULL, NULL,
                         mpicomm);
+    }
   }
 
   // Run MSTK's internal checks - meant for debugging only
@@ -437,94 +444,70 @@ class Mesh_MSTK : public Mesh {
   //! Get the number of fields on entities of a particular type along
   //! with their names and variable types - DESIGNED TO BE CALLED ONLY
   //! BY THE JALI STATE MANAGER FOR INITIALIZATION OF MESH STATE FROM
-  //! THE MESH FILE
+  //! THE MESH FILE. These are the fields read from the mesh file
+  //! (MSTK attributes) and the fields stored with store_field
 
   void get_field_info(Entity_kind on_what, int *num,
                       std::vector<std::string> *varnames,
                       std::vector<std::string> *vartypes) const;
 
-  //! Retrieve an integer field on the mesh. If the return value is
-  //! false, it could be that (1) the field does not exist (2) it
-  //! exists but is associated with a different type of entity (3) the
-  //! variable type sent in was the wrong type (int instead of double
-  //! or double instead of std::array<double,2> or
-  //! std::array<double,2> instead of std::array<double,3> etc -
-  //! DESIGNED TO BE CALLED ONLY BY THE JALI STATE MANAGER FOR
-  //! INITIALIZATION OF MESH STATE FROM THE MESH FILE
-
-  bool get_field(std::string field_name, Entity_kind on_what, int *data) const;
-
-  //! Retrieve an integer field on the mesh. If the return value is
-  //! false, it could be that (1) the field does not exist (2) it
-  //! exists but is associated with a different type of entity (3) the
-  //! variable type sent in was the wrong type (int instead of double
-  //! or double instead of std::array<double,2> or
-  //! std::array<double,2> instead of std::array<double,3> etc -
-  //! DESIGNED TO BE CALLED ONLY BY THE JALI STATE MANAGER FOR
-  //! INITIALIZATION OF MESH STATE FROM THE MESH FILE
+  //! Retrieve a field on the mesh. If the return value is false, it
+  //! could be that (1) the field does not exist (2) it exists but is
+  //! associated with a different type of entity (3) the variable type
+  //! sent in was the wrong type (int instead of double or double
+  //! instead of std::array<double,2> or std::array<double,2> instead
+  //! of std::array<double,3> etc - DESIGNED TO BE CALLED ONLY BY THE
+  //! JALI STATE MANAGER FOR INITIALIZATION OF MESH STATE FROM THE
+  //! MESH FILE
+  //!
+  //! The overloads only exist because virtual functions cannot be
+  //! templates - they all go through get_field_internal
 
   bool get_field(std::string field_name, Entity_kind on_what,
-                 double *data) const;
-
-  //! Retrieve an array field on the mesh. If the return value is
-  //! false, it could be that (1) the field does not exist (2) it
-  //! exists but is associated with a different type of entity (3) the
-  //! variable type sent in was the wrong type (int instead of double
-  //! or double instead of std::array<double,2> or
-  //! std::array<double,2> instead of std::array<double,3> etc -
-  //! DESIGNED TO BE CALLED ONLY BY THE JALI STATE MANAGER FOR
-  //! INITIALIZATION OF MESH STATE FROM THE MESH FILE
-
-  //! HAVE TO DO THIS WONKY THING BECAUSE COMPILER COMPLAINS THAT IT
-  //! CANNOT FIND A get_field IMPLEMENTATION WITH std::array<double,2ul>
-
-  template<std::size_t N>
-  bool get_field_internal(std::string field_name, Entity_kind on_what,
-                          std::array<double, N> *data) const;
+                 int *data) const {
+    return get_field_internal(field_name, on_what, data);
+  }
+  bool get_field(std::string field_name, Entity_kind on_what,
+                 double *data) const {
+    return get_field_internal(field_name, on_what, data);
+  }
   bool get_field(std::string field_name, Entity_kind on_what,
                  std::array<double, 2> *data) const {
-    return get_field_internal(field_name, on_what,data);
+    return get_field_internal(field_name, on_what, data);
   }
   bool get_field(std::string field_name, Entity_kind on_what,
                  std::array<double, 3> *data) const {
-    return get_field_internal(field_name, on_what,data);
+    return get_field_internal(field_name, on_what, data);
   }
   bool get_field(std::string field_name, Entity_kind on_what,
                  std::array<double, 6> *data) const {
-    return get_field_internal(field_name, on_what,data);
+    return get_field_internal(field_name, on_what, data);
   }
 
-  //! Store an integer field on the mesh. If the return value is false, it
-  //! means that the mesh already has a field of that name but its of
-  //! a different type or its on a different type of entity - DESIGNED
-  //! TO BE CALLED ONLY BY THE JALI STATE MANAGER FOR INITIALIZATION
-  //! OF MESH STATE FROM THE MESH FILE
-
-  bool store_field(std::string field_name, Entity_kind on_what, int *data);
-
-  //! Store an real field on the mesh. If the return value is false, it
+  //! Store a field on the mesh. If the return value is false, it
   //! means that the mesh already has a field of that name but its of
   //! a different type or its on a different type of entity - DESIGNED
   //! TO BE CALLED ONLY BY THE JALI STATE MANAGER FOR INITIALIZATION
   //! OF MESH STATE FROM THE MESH FILE
+  //!
+  //! The values are copied into a contiguous array kept with the
+  //! mesh; they are only transferred to MSTK attributes when the mesh
+  //! is written out with its fields through MSTK
 
-  bool store_field(std::string field_name, Entity_kind on_what, double *data);
-
-  // Store a vector or tensor field data with the mesh
-
-  //! HAVE TO DO THIS WONKY THING BECAUSE COMPILER COMPLAINS THAT IT
-  //! CANNOT FIND A get_field IMPLEMENTATION WITH std::array<double,2ul>
-
-  template<std::size_t N>
-  bool store_field_internal(std::string field_name, Entity_kind on_what,
-                            std::array<double, N> *data);
+  bool store_field(std::string field_name, Entity_kind on_what, int *data) {
+    return store_field_internal(field_name, on_what, data);
+  }
+  bool store_field(std::string field_name, Entity_kind on_what,
+                   double *data) {
+    return store_field_internal(field_name, on_what, data);
+  }
   bool store_field(std::string field_name, Entity_kind on_what,
                    std::array<double, 2> *data) {
-    return store_field_internal(field_name, on_what,data);
+    return store_field_internal(field_name, on_what, data);
   }
   bool store_field(std::string field_name, Entity_kind on_what,
                    std::array<double, 3> *data) {
-    return store_field_internal(field_name, on_what,data);
+    return store_field_internal(field_name, on_what, data);
   }
   bool store_field(std::string field_name, Entity_kind on_what,
                    std::array<double, 6> *data) {
@@ -536,6 +519,12 @@ class Mesh_MSTK : public Mesh {
                                 Entity_ID_List *owned_entities,
                                 Entity_ID_List *ghost_entities) const;
 
+  // Renumber entities of a kind by permuting the ID to handle maps
+  // and resetting the MSTK IDs of the entities
+
+  void renumber_entities_internal(const Entity_kind kind,
+                                  std::vector<Entity_ID> const& new2old);
+
  private:
 
   // Private methods
@@ -747,6 +736,100 @@ class Mesh_MSTK : public Mesh {
     return kind2mtype[manifold_dimension()][(int)kind];
   }
 
+  // Fields - values are kept in contiguous arrays by the base class
+  // (which the state manager and writers that take arrays use
+  // directly) and moved to MSTK attributes only for MSTK's writers.
+  // Fields read from a mesh file are MSTK attributes
+
+  template <class T>
+  bool get_field_internal(std::string const& field_name, Entity_kind on_what,
+                          T *data) const;
+  template <class T>
+  bool store_field_internal(std::string const& field_name,
+                            Entity_kind on_what, T const *data);
+
+  // Copy fields between arrays and MSTK attributes in one pass over
+  // the entities of a kind, in the order of their Jali IDs
+
+  template <class T>
+  bool get_attrib_field(std::string const& field_name, Entity_kind on_what,
+                        T *data) const;
+  template <class T>
+  bool store_attrib_field(std::string const& field_name, Entity_kind on_what,
+                          T const *data) const;
+
+  // Check that an MSTK attribute can hold values of type T
+
+  template <class T>
+  bool attrib_matches(MAttrib_ptr mattrib, Entity_kind on_what,
+                      T const *) const;
+
+  // Move fields stored since the last export to MSTK attributes
+
+  void export_fields_to_attributes() const;
+
+  // MSTK entities of a kind in the order of their Jali IDs (in MSTK's
+  // order if Jali does not have entities of this kind)
+
+  std::vector<MEntity_ptr> field_entities(Entity_kind on_what) const;
+
+  // Attribute values of the types fields can have
+
+  static MAttType attrib_type(int const *, int) { return INT; }
+  static MAttType attrib_type(double const *, int) { return DOUBLE; }
+  template <std::size_t N>
+  static MAttType attrib_type(std::array<double, N> const *data, int dim) {
+    return (field_vartype(data, dim) == "VECTOR") ? VECTOR : TENSOR;
+  }
+
+  static void get_attrib_value(MEntity_ptr ment, MAttrib_ptr mattrib,
+                               int *value) {
+    double rval;
+    void *pval;
+    MEnt_Get_AttVal(ment, mattrib, value, &rval, &pval);
+  }
+  static void get_attrib_value(MEntity_ptr ment, MAttrib_ptr mattrib,
+                               double *value) {
+    int ival;
+    void *pval;
+    MEnt_Get_AttVal(ment, mattrib, &ival, value, &pval);
+  }
+  template <std::size_t N>
+  static void get_attrib_value(MEntity_ptr ment, MAttrib_ptr mattrib,
+                               std::array<double, N> *value) {
+    int ival;
+    double rval;
+    void *pval = nullptr;
+    MEnt_Get_AttVal(ment, mattrib, &ival, &rval, &pval);
+    if (pval)
+      std::copy((double *) pval, (double *) pval + N, value->begin());
+  }
+
+  static void set_attrib_value(MEntity_ptr ment, MAttrib_ptr mattrib,
+                               int const& value) {
+    MEnt_Set_AttVal(ment, mattrib, value, 0.0, NULL);
+  }
+  static void set_attrib_value(MEntity_ptr ment, MAttrib_ptr mattrib,
+                               double const& value) {
+    MEnt_Set_AttVal(ment, mattrib, 0, value, NULL);
+  }
+  template <std::size_t N>
+  static void set_attrib_value(MEntity_ptr ment, MAttrib_ptr mattrib,
+                               std::array<double, N> const& value) {
+    // Reuse the entity's array if it has one, the attribute keeps
+    // the pointer it is given
+
+    int ival;
+    double rval;
+    void *pval = nullptr;
+    MEnt_Get_AttVal(ment, mattrib, &ival, &rval, &pval);
+    if (!pval) {
+      pval = new double[N];
+      MEnt_Set_AttVal(ment, mattrib, 0, 0.0, pval);
+    }
+    std::copy(value.begin(), value.end(), (double *) pval);
+  }
+
 
   // Private data
 
@@ -836,132 +919,103 @@ class Mesh_MSTK : public Mesh {
 
   // whether to make GIDs continguous or not
   bool contiguous_gids_;
-};
 
+  // Fields stored since they were last moved to MSTK attributes
 
-// Retrieve field data from the mesh - special implementation for
-// std::array<double,N>. Other implementations are in .cc file
-template<std::size_t N>
-inline
-bool Mesh_MSTK::get_field_internal(std::string field_name, Entity_kind on_what,
-                                   std::array<double, N> *data) const {
-  MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
-  if (!mattrib) return false;
+  mutable std::map<std::string, Entity_kind> fields_to_export_;
+};
 
-  if (entity_kind_to_mtype(on_what) != (int) MAttrib_Get_EntDim(mattrib))
-    return false;
 
-  MAttType atttype = MAttrib_Get_Type(mattrib);
-  if (atttype != VECTOR && atttype != TENSOR)
-    return false;
+// Retrieve field data - the last values stored with the mesh or, if
+// none were, the values read from the mesh file
+
+template <class T>
+inline
+bool Mesh_MSTK::get_field_internal(std::string const& field_name,
+                                   Entity_kind on_what, T *data) const {
+  if (get_field_array(field_name, on_what, data)) return true;
+  return get_attrib_field(field_name, on_what, data);
+}
 
-  MType enttype = MAttrib_Get_EntDim(mattrib);
-  int ncomp = MAttrib_Get_NumComps(mattrib);
 
-  if (ncomp != N) return false;
+// Store field data with the mesh. The check against an attribute of
+// the same name (e.g. read from the mesh file) keeps the two from
+// clashing when the fields are exported
 
-  int nent;
-  switch (enttype) {
-    case MVERTEX: nent = MESH_Num_Vertices(mesh); break;
-    case MEDGE: nent = MESH_Num_Edges(mesh); break;
-    case MFACE: nent = MESH_Num_Faces(mesh); break;
-    case MREGION: nent = MESH_Num_Regions(mesh); break;
-    default: nent = 0; break;
+template <class T>
+inline
+bool Mesh_MSTK::store_field_internal(std::string const& field_name,
+                                     Entity_kind on_what, T const *data) {
+  MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
+  if (mattrib && !attrib_matches(mattrib, on_what, data)) {
+    std::cerr << "Mesh_MSTK::store_field -" <<
+        " found attribute with same name but different type" << std::endl;
+    return false;
   }
 
-  MEntity_ptr ment;
-  for (int i = 0; i < nent; i++) {
-    switch (enttype) {
-      case MVERTEX: ment = MESH_Vertex(mesh, i); break;
-      case MEDGE: ment = MESH_Edge(mesh, i); break;
-      case MFACE: ment = MESH_Face(mesh, i); break;
-      case MREGION: ment = MESH_Region(mesh, i); break;
-      default: ment = NULL; break;
-    }
-    if (ment == NULL) continue;  // not needed since nent=0 but here anyway
+  if (!store_field_array(field_name, on_what, data)) return false;
+  fields_to_export_[field_name] = on_what;
+  return true;
+}
 
-    int ival;
-    double rval;
-    void *pval;
-    MEnt_Get_AttVal(ment, mattrib, &ival, &rval, &pval);
 
-    for (int j = 0; j < N; j++)
-      data[i][j] = ((double *)pval)[j];
+template <class T>
+inline
+bool Mesh_MSTK::attrib_matches(MAttrib_ptr mattrib, Entity_kind on_what,
+                               T const *data) const {
+  if (entity_kind_to_mtype(on_what) != (int) MAttrib_Get_EntDim(mattrib))
+    return false;
 
-  }  // for (int i...);
+  MAttType const atttype = MAttrib_Get_Type(mattrib);
+  MAttType const wanted = attrib_type(data, Mesh::space_dimension());
+  if (wanted == INT || wanted == DOUBLE)
+    return atttype == wanted;
 
-  return true;
-}  // Mesh_MSTK::get_mesh_field
+  // A vector and a tensor with the same number of components hold
+  // the same values
+  return ((atttype == VECTOR || atttype == TENSOR) &&
+          MAttrib_Get_NumComps(mattrib) == (int) (sizeof(T)/sizeof(double)));
+}
 
 
+template <class T>
+inline
+bool Mesh_MSTK::get_attrib_field(std::string const& field_name,
+                                 Entity_kind on_what, T *data) const {
+  MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
+  if (!mattrib || !attrib_matches(mattrib, on_what, data)) return false;
 
+  std::vector<MEntity_ptr> const ents = field_entities(on_what);
+  int const nent = ents.size();
+  for (int i = 0; i < nent; i++)
+    get_attrib_value(ents[i], mattrib, &data[i]);
+  return true;
+}
 
-// Store field data with the mesh - special implementation for
-// std::array<double,N>. Other implementations are in .cc file
 
-template<std::size_t N>
+template <class T>
 inline
-bool Mesh_MSTK::store_field_internal(std::string field_name,
-                                     Entity_kind on_what,
-                                     std::array<double,N> *data) {
-  MType mtype = entity_kind_to_mtype(on_what);
-  MAttType atttype;
-
+bool Mesh_MSTK::store_attrib_field(std::string const& field_name,
+                                   Entity_kind on_what, T const *data) const {
   MAttrib_ptr mattrib = MESH_AttribByName(mesh, field_name.c_str());
   if (mattrib) {
-    if (mtype != (int) MAttrib_Get_EntDim(mattrib))
-      return false;
-
-    atttype = MAttrib_Get_Type(mattrib);
-    if (atttype != VECTOR || atttype != TENSOR) {
-      std::cerr << "Mesh_MSTK::store_field -" <<
-          " found attribute with same name but different type" << std::endl;
-      return false;
-    }
-    int ncomp = MAttrib_Get_NumComps(mattrib);
-    if (ncomp != N) {
-      std::cerr << "Mesh_MSTK::store_field - found vector/tensor attribute " <<
-          "but with different number of components" << std::endl;
-      return false;
-    }
-  }
-  else {
-    if (N != 2 && N != 3 && N != 6) return false;
-    atttype =  (N == 2 || (N == 3 && Mesh::space_dimension() == 3)) ? VECTOR :
-        TENSOR;
-    mattrib = MAttrib_New(mesh, field_name.c_str(), atttype, mtype, N);
-  }
-
-  int nent;
-  switch (mtype) {
-    case MVERTEX: nent = MESH_Num_Vertices(mesh); break;
-    case MEDGE: nent = MESH_Num_Edges(mesh); break;
-    case MFACE: nent = MESH_Num_Faces(mesh); break;
-    case MREGION: nent = MESH_Num_Regions(mesh); break;
-    default: nent = 0; break;
+    if (!attrib_matches(mattrib, on_what, data)) return false;
+  } else {
+    MType const mtype = entity_kind_to_mtype(on_what);
+    MAttType const atttype = attrib_type(data, Mesh::space_dimension());
+    if (atttype == INT || atttype == DOUBLE)
+      mattrib = MAttrib_New(mesh, field_name.c_str(), atttype, mtype);
+    else
+      mattrib = MAttrib_New(mesh, field_name.c_str(), atttype, mtype,
+                            (int) (sizeof(T)/sizeof(double)));
   }
 
-  MEntity_ptr ment;
-  for (int i = 0; i < nent; i++) {
-    switch (mtype) {
-      case MVERTEX: ment = MESH_Vertex(mesh, i); break;
-      case MEDGE: ment = MESH_Edge(mesh, i); break;
-      case MFACE: ment = MESH_Face(mesh, i); break;
-      case MREGION: ment = MESH_Region(mesh, i); break;
-      default: ment = NULL; break;
-    }
-    if (ment == NULL) continue;  // not needed since nent=0 but here anyway
-
-    void *pval;
-    double *vec = new double[N];
-    std::copy(&(data[i][0]), &(data[i][0]) + N, vec);
-    pval = vec;
-
-    MEnt_Set_AttVal(ment, mattrib, 0, 0.0, pval);
-  } // for
-
+  std::vector<MEntity_ptr> const ents = field_entities(on_what);
+  int const nent = ents.size();
+  for (int i = 0; i < nent; i++)
+    set_attrib_value(ents[i], mattrib, data[i]);
   return true;
-}  // Mesh_MSTK::store_mesh_field
+}
 
 }  // End namespace Jali
 
@@ -53,6 +53,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "mpi.h"   // only for MPI_COMM_WORLD in Mesh constructor
 
 #include "errors.hh"
+#include "instrumentation.hh"
 
 namespace Jali {
 
@@ -249,6 +250,7 @@ void Mesh_simple::clear_internals_1d_() {
 }
 
 void Mesh_simple::update_internals_1d_() {
+  JALI_TIME_SCOPE("Mesh_simple::update_internals_1d_");
   num_cells_ = nx_;
   num_nodes_ = nx_+1;
   num_faces_ = num_nodes_;
@@ -364,6 +366,7 @@ void Mesh_simple::update_internals_1d_() {
 
 
 void Mesh_simple::update_internals_3d_() {
+  JALI_TIME_SCOPE("Mesh_simple::update_internals_3d_");
   num_cells_ = nx_ * ny_ * nz_;
   num_nodes_ = (nx_+1)*(ny_+1)*(nz_+1);
   num_faces_ = (nx_+1)*(ny_)*(nz_) + (nx_)*(ny_+1)*(nz_) + (nx_)*(ny_)*(nz_+1);
@@ -770,6 +773,8 @@ void Mesh_simple::node_set_coordinates(const Jali::Entity_ID local_node_id,
     *destination_begin = ncoord[i];
     destination_begin++;
   }
+
+  Mesh::node_coordinates_changed(local_node_id, &(coordinates_[offset]));
 }
 
 void Mesh_simple::node_set_coordinates(const Jali::Entity_ID local_node_id,
@@ -783,6 +788,8 @@ void Mesh_simple::node_set_coordinates(const Jali::Entity_ID local_node_id,
     *destination_begin = ncoord[i];
     destination_begin++;
   }
+
+  Mesh::node_coordinates_changed(local_node_id, &(coordinates_[offset]));
 }
 
 
@@ -947,4 +954,81 @@ Mesh_simple::get_labeled_set_entities(const JaliGeometry::LabeledSetRegionPtr r,
 
 
 
+
+// Make row i of a table with 'stride' entries per row the old row
+// new2old[i]
+
+template<typename T>
+static void permute_rows(std::vector<Entity_ID> const& new2old,
+                         int const stride, std::vector<T> *table) {
+  std::vector<T> old(*table);
+  int n = new2old.size();
+  for (int i = 0; i < n; i++)
+    std::copy(old.begin() + stride*new2old[i],
+              old.begin() + stride*(new2old[i]+1),
+              table->begin() + stride*i);
+}
+
+// Renumber entities of a kind. Rows of tables indexed by the entity
+// are permuted and references to the entity in other tables are
+// mapped to the new IDs
+
+void Mesh_simple::renumber_entities_internal(const Entity_kind kind,
+                                             std::vector<Entity_ID> const&
+                                             new2old) {
+  int n = new2old.size();
+  std::vector<Entity_ID> old2new(n);
+  for (int i = 0; i < n; i++)
+    old2new[new2old[i]] = i;
+
+  // Map references (-1 means none)
+
+  auto map_ids = [&](std::vector<Entity_ID> *table) {
+    for (auto& id : *table)
+      if (id >= 0) id = old2new[id];
+  };
+
+  // Map references in tables whose rows start with the number of
+  // entries in the row
+
+  auto map_counted_ids = [&](int const stride, std::vector<Entity_ID> *table) {
+    int nrows = table->size()/stride;
+    for (int i = 0; i < nrows; i++) {
+      Entity_ID *row = table->data() + stride*i;
+      for (int j = 1; j <= row[0]; j++)
+        row[j] = old2new[row[j]];
+    }
+  };
+
+  switch (kind) {
+    case Entity_kind::NODE:
+      permute_rows(new2old, Mesh::space_dimension(), &coordinates_);
+      permute_rows(new2old, faces_per_node_aug_, &node_to_face_);
+      permute_rows(new2old, cells_per_node_aug_, &node_to_cell_);
+      map_ids(&cell_to_node_);
+      map_ids(&face_to_node_);
+      break;
+    case Entity_kind::FACE:
+      permute_rows(new2old, nodes_per_face_, &face_to_node_);
+      permute_rows(new2old, 2, &face_to_cell_);
+      map_ids(&cell_to_face_);
+      map_counted_ids(faces_per_node_aug_, &node_to_face_);
+      break;
+    case Entity_kind::CELL:
+      permute_rows(new2old, faces_per_cell_, &cell_to_face_);
+      permute_rows(new2old, faces_per_cell_, &cell_to_face_dirs_);
+      permute_rows(new2old, nodes_per_cell_, &cell_to_node_);
+      map_ids(&face_to_cell_);
+      map_counted_ids(cells_per_node_aug_, &node_to_cell_);
+      break;
+    case Entity_kind::EDGE:
+      if (space_dim_ == 1) break;  // edge IDs are the node IDs in 1D
+      // fall through
+    default: {
+      Errors::Message mesg("Edges not implemented in this framework. Use MSTK");
+      Exceptions::Jali_throw(mesg);
+    }
+  }
+}
+
 }  // close namespace Jali
@@ -347,6 +347,11 @@ public:
                                 Entity_ID_List *owned_entities,
                                 Entity_ID_List *ghost_entities) const;
 
+  // Renumber nodes, faces or cells by permuting the local-id tables
+
+  void renumber_entities_internal(const Entity_kind kind,
+                                  std::vector<Entity_ID> const& new2old);
+
 
 
 
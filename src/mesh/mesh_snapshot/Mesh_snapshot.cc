@@ -0,0 +1,534 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "Mesh_snapshot.hh"
+
+#include <algorithm>
+#include <cassert>
+
+#include "LabeledSetRegion.hh"
+#include "MeshSet.hh"
+#include "instrumentation.hh"
+
+namespace Jali {
+
+Mesh_snapshot::Mesh_snapshot(const std::string& filename,
+                             const MPI_Comm& mycomm,
+                             const JaliGeometry::GeometricModelPtr& gm) :
+    Mesh_snapshot(std::make_shared<MeshSnapshotFile>(filename, mycomm),
+                  mycomm, gm) {}
+
+
+Mesh_snapshot::Mesh_snapshot(std::shared_ptr<MeshSnapshotFile> file,
+                             const MPI_Comm& mycomm,
+                             const JaliGeometry::GeometricModelPtr& gm) :
+    Mesh(file->header().faces, file->header().edges, file->header().sides,
+         file->header().wedges, file->header().corners,
+         file->header().num_tiles, file->header().num_ghost_layers_tile,
+         file->header().num_ghost_layers_distmesh,
+         file->header().boundary_ghosts,
+         static_cast<Partitioner_type>(file->header().partitioner),
+         static_cast<JaliGeometry::Geom_type>(file->header().geom_type),
+         mycomm),
+    file_(file) {
+  JALI_TIME_SCOPE("Mesh_snapshot::Mesh_snapshot");
+
+  SnapshotHeader const& hdr = file_->header();
+  set_space_dimension(hdr.space_dim);
+  set_manifold_dimension(hdr.manifold_dim);
+  Mesh::set_mesh_type(static_cast<Mesh_type>(hdr.mesh_type));
+  if (gm != (JaliGeometry::GeometricModelPtr) NULL)
+    Mesh::set_geometric_model(gm);
+
+  coords_ = file_->writable_section<double>("node.coords");
+  cell_types_ = file_->section<std::uint8_t>("cell.type");
+  node_gids_ = file_->section<Entity_ID>("node.gid");
+  edge_gids_ = file_->section<Entity_ID>("edge.gid");
+  face_gids_ = file_->section<Entity_ID>("face.gid");
+  cell_gids_ = file_->section<Entity_ID>("cell.gid");
+
+  cell_nodes_ = file_->csr<Entity_ID>("cell.nodes");
+  node_cells_ = file_->csr<Entity_ID>("node.cells");
+  face_nodes_ = file_->csr<Entity_ID>("face.nodes");
+  face_cells_ = file_->csr<Entity_ID>("face.cells");
+  node_faces_ = file_->csr<Entity_ID>("node.faces");
+  cell_faces_ = file_->csr<Entity_ID>("cell.faces");
+  cell_face_dirs_ = file_->section<dir_t>("cell.faces.dirs");
+  cell_faces_ordered_ = file_->csr<Entity_ID>("cell.faces_ordered");
+  cell_face_dirs_ordered_ = file_->section<dir_t>("cell.faces_ordered.dirs");
+
+  edge_nodes_ = file_->section<Entity_ID>("edge.nodes");
+  cell_edges_ = file_->csr<Entity_ID>("cell.edges");
+  face_edges_ = file_->csr<Entity_ID>("face.edges");
+  face_edge_dirs_ = file_->section<dir_t>("face.edges.dirs");
+  cell_edges2d_ = file_->csr<Entity_ID>("cell.edges2d");
+  cell_edge_dirs2d_ = file_->section<dir_t>("cell.edges2d.dirs");
+
+  init_entity_lists_();
+
+  // Check the sizes of what every mesh needs and that the
+  // relationships only refer to existing entities so that a damaged
+  // file fails here and not in some later query
+
+  std::size_t const nnodes = nodeids_all_.size();
+  std::size_t const nedges = edgeids_all_.size();
+  std::size_t const nfaces = faceids_all_.size();
+  std::size_t const ncells = cellids_all_.size();
+  std::size_t const dim = space_dim_;
+  bool const edges2d = edges_requested && manifold_dim_ == 2;
+  if (file_->section<double>("node.coords").size() != dim*nnodes ||
+      node_gids_.size() != nnodes || cell_gids_.size() != ncells ||
+      cell_types_.size() != ncells ||
+      !valid_csr_(cell_nodes_, ncells, nnodes) ||
+      !valid_csr_(node_cells_, nnodes, ncells) ||
+      (faces_requested &&
+       (face_gids_.size() != nfaces ||
+        !valid_csr_(cell_faces_, ncells, nfaces, cell_face_dirs_) ||
+        !valid_csr_(cell_faces_ordered_, ncells, nfaces,
+                    cell_face_dirs_ordered_) ||
+        !valid_csr_(face_nodes_, nfaces, nnodes) ||
+        !valid_csr_(face_cells_, nfaces, ncells) ||
+        !valid_csr_(node_faces_, nnodes, nfaces))) ||
+      (edges_requested &&
+       (edge_gids_.size() != nedges || edge_nodes_.size() != 2*nedges ||
+        !valid_ids_(edge_nodes_, nnodes) ||
+        !valid_csr_(cell_edges_, ncells, nedges))) ||
+      (edges_requested && faces_requested &&
+       !valid_csr_(face_edges_, nfaces, nedges, face_edge_dirs_)) ||
+      (edges2d &&
+       !valid_csr_(cell_edges2d_, ncells, nedges, cell_edge_dirs2d_))) {
+    Errors::Message mesg("Snapshot file " + file_->filename() +
+                         " is inconsistent");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  // The queries read the mapped relationships, so the base class
+  // need not copy them into its adjacency caches
+
+  implicit_topology_ = true;
+  cache_extra_variables();
+
+  init_sets_();
+  init_tiles_();
+}
+
+
+Mesh_snapshot::~Mesh_snapshot() { }
+
+
+void Mesh_snapshot::init_entity_lists_() {
+  auto fill = [&](std::string const& kind, std::vector<Entity_ID> *owned,
+                  std::vector<Entity_ID> *ghost,
+                  std::vector<Entity_ID> *boundary_ghost,
+                  std::vector<Entity_ID> *all) {
+    *owned = file_->section<Entity_ID>(kind + ".owned").to_vector();
+    *ghost = file_->section<Entity_ID>(kind + ".ghost").to_vector();
+    *all = *owned;
+    all->insert(all->end(), ghost->begin(), ghost->end());
+    if (boundary_ghost) {
+      *boundary_ghost =
+          file_->section<Entity_ID>(kind + ".boundary_ghost").to_vector();
+      all->insert(all->end(), boundary_ghost->begin(), boundary_ghost->end());
+    }
+  };
+
+  fill("node", &nodeids_owned_, &nodeids_ghost_, nullptr, &nodeids_all_);
+  fill("edge", &edgeids_owned_, &edgeids_ghost_, nullptr, &edgeids_all_);
+  fill("face", &faceids_owned_, &faceids_ghost_, nullptr, &faceids_all_);
+  fill("cell", &cellids_owned_, &cellids_ghost_, &cellids_boundary_ghost_,
+       &cellids_all_);
+}
+
+
+// Recreate the mesh sets that were written
+
+void Mesh_snapshot::init_sets_() {
+  ArrayView<char> names = file_->section<char>("set.names");
+  ArrayView<std::int8_t> kinds = file_->section<std::int8_t>("set.kinds");
+  SnapshotCSR<Entity_ID> owned = file_->csr<Entity_ID>("set.owned");
+  SnapshotCSR<Entity_ID> ghost = file_->csr<Entity_ID>("set.ghost");
+
+  std::size_t const nsets = kinds.size();
+  bool valid = (owned.num_rows() == nsets && ghost.num_rows() == nsets &&
+                std::count(names.begin(), names.end(), '\0') ==
+                static_cast<std::ptrdiff_t>(nsets));
+  for (std::size_t i = 0; valid && i < nsets; i++) {
+    std::size_t const n = num_entities(static_cast<Entity_kind>(kinds[i]),
+                                       Entity_type::ALL);
+    valid = valid_ids_(owned.data(), n) && valid_ids_(ghost.data(), n);
+  }
+  if (!valid) {
+    Errors::Message mesg("Snapshot file " + file_->filename() +
+                         " has inconsistent mesh sets");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  char const *name = names.data();
+  for (std::size_t i = 0; i < nsets; i++) {
+    std::string setname(name);
+    name += setname.size() + 1;
+    make_meshset(setname, *this, static_cast<Entity_kind>(kinds[i]),
+                 owned[i].to_vector(), ghost[i].to_vector(), true);
+  }
+}
+
+
+// Rebuild the tiles from the owned cells of each tile that were
+// written (no partitioning)
+
+void Mesh_snapshot::init_tiles_() {
+  if (!num_tiles_ini_) return;
+
+  SnapshotCSR<Entity_ID> tilecells = file_->csr<Entity_ID>("tile.cells");
+  if (!valid_ids_(tilecells.data(), cellids_owned_.size())) {
+    Errors::Message mesg("Snapshot file " + file_->filename() +
+                         " has inconsistent tiles");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  std::vector<std::vector<Entity_ID>> partitions(tilecells.num_rows());
+  for (std::size_t i = 0; i < partitions.size(); i++)
+    partitions[i] = tilecells[i].to_vector();
+  build_tiles(partitions);
+}
+
+
+bool Mesh_snapshot::valid_ids_(ArrayView<Entity_ID> const& ids,
+                               std::size_t const n) const {
+  for (auto const& id : ids)
+    if (id < 0 || static_cast<std::size_t>(id) >= n) return false;
+  return true;
+}
+
+
+bool Mesh_snapshot::valid_csr_(SnapshotCSR<Entity_ID> const& csr,
+                               std::size_t const nrows,
+                               std::size_t const n) const {
+  return csr.num_rows() == nrows && valid_ids_(csr.data(), n);
+}
+
+
+bool Mesh_snapshot::valid_csr_(SnapshotCSR<Entity_ID> const& csr,
+                               std::size_t const nrows, std::size_t const n,
+                               ArrayView<dir_t> const& dirs) const {
+  return valid_csr_(csr, nrows, n) && dirs.size() == csr.data().size();
+}
+
+
+void Mesh_snapshot::require_(bool const present,
+                             std::string const& what) const {
+  if (!present) {
+    Errors::Message mesg("Mesh_snapshot: " + what + " not in snapshot");
+    Exceptions::Jali_throw(mesg);
+  }
+}
+
+
+void Mesh_snapshot::filter_by_type_(Entity_kind const kind,
+                                    ArrayView<Entity_ID> const& row,
+                                    Entity_type const ptype,
+                                    Entity_ID_List *list) const {
+  if (ptype == Entity_type::ALL) {
+    list->assign(row.begin(), row.end());
+    return;
+  }
+  cache_type_info();
+  list->clear();
+  for (auto const& id : row)
+    if (entity_get_type(kind, id) == ptype)
+      list->push_back(id);
+}
+
+
+Cell_type Mesh_snapshot::cell_get_type(const Entity_ID cellid) const {
+  return static_cast<Cell_type>(cell_types_[cellid]);
+}
+
+
+Entity_ID Mesh_snapshot::GID(const Entity_ID lid,
+                             const Entity_kind kind) const {
+  switch (kind) {
+    case Entity_kind::NODE: return node_gids_[lid];
+    case Entity_kind::EDGE: return edge_gids_[lid];
+    case Entity_kind::FACE: return face_gids_[lid];
+    case Entity_kind::CELL: return cell_gids_[lid];
+    default:
+      std::cerr << "Global ID requested for unknown entity type" << std::endl;
+      return -1;
+  }
+}
+
+
+void Mesh_snapshot::cell_get_nodes(const Entity_ID cellid,
+                                   Entity_ID_List *nodeids) const {
+  ArrayView<Entity_ID> cnodes = cell_nodes_[cellid];
+  nodeids->assign(cnodes.begin(), cnodes.end());
+}
+
+
+void Mesh_snapshot::face_get_nodes(const Entity_ID faceid,
+                                   Entity_ID_List *nodeids) const {
+  require_(faces_requested, "Faces");
+  ArrayView<Entity_ID> fnodes = face_nodes_[faceid];
+  nodeids->assign(fnodes.begin(), fnodes.end());
+}
+
+
+void Mesh_snapshot::node_get_cells(const Entity_ID nodeid,
+                                   const Entity_type ptype,
+                                   Entity_ID_List *cellids) const {
+  filter_by_type_(Entity_kind::CELL, node_cells_[nodeid], ptype, cellids);
+}
+
+
+void Mesh_snapshot::node_get_faces(const Entity_ID nodeid,
+                                   const Entity_type ptype,
+                                   Entity_ID_List *faceids) const {
+  require_(faces_requested, "Faces");
+  filter_by_type_(Entity_kind::FACE, node_faces_[nodeid], ptype, faceids);
+}
+
+
+void Mesh_snapshot::node_get_cell_faces(const Entity_ID nodeid,
+                                        const Entity_ID cellid,
+                                        const Entity_type ptype,
+                                        Entity_ID_List *faceids) const {
+  require_(faces_requested, "Faces");
+  if (ptype != Entity_type::ALL) cache_type_info();
+  faceids->clear();
+  for (auto const& f : cell_faces_[cellid]) {
+    if (ptype != Entity_type::ALL &&
+        entity_get_type(Entity_kind::FACE, f) != ptype)
+      continue;
+    ArrayView<Entity_ID> fnodes = face_nodes_[f];
+    if (std::find(fnodes.begin(), fnodes.end(), nodeid) != fnodes.end())
+      faceids->push_back(f);
+  }
+}
+
+
+void Mesh_snapshot::cell_get_face_adj_cells(const Entity_ID cellid,
+                                            const Entity_type ptype,
+                                            Entity_ID_List *fadj_cellids)
+    const {
+  require_(faces_requested, "Faces");
+  if (ptype != Entity_type::ALL) cache_type_info();
+  fadj_cellids->clear();
+  for (auto const& f : cell_faces_[cellid])
+    for (auto const& c : face_cells_[f])
+      if (c != cellid && (ptype == Entity_type::ALL ||
+                          entity_get_type(Entity_kind::CELL, c) == ptype))
+        fadj_cellids->push_back(c);
+}
+
+
+void Mesh_snapshot::cell_get_node_adj_cells(const Entity_ID cellid,
+                                            const Entity_type ptype,
+                                            Entity_ID_List *nadj_cellids)
+    const {
+  if (ptype != Entity_type::ALL) cache_type_info();
+  nadj_cellids->clear();
+  for (auto const& n : cell_nodes_[cellid])
+    for (auto const& c : node_cells_[n])
+      if (c != cellid && (ptype == Entity_type::ALL ||
+                          entity_get_type(Entity_kind::CELL, c) == ptype))
+        nadj_cellids->push_back(c);
+  std::sort(nadj_cellids->begin(), nadj_cellids->end());
+  nadj_cellids->erase(std::unique(nadj_cellids->begin(),
+                                  nadj_cellids->end()),
+                      nadj_cellids->end());
+}
+
+
+void Mesh_snapshot::node_get_coordinates(const Entity_ID nodeid,
+                                         JaliGeometry::Point *ncoord) const {
+  ncoord->set(space_dim_, coords_ + space_dim_*nodeid);
+}
+
+
+void Mesh_snapshot::face_get_coordinates(const Entity_ID faceid,
+                                         std::vector<JaliGeometry::Point>
+                                         *fcoords) const {
+  require_(faces_requested, "Faces");
+  fcoords->clear();
+  JaliGeometry::Point p(space_dim_);
+  for (auto const& n : face_nodes_[faceid]) {
+    node_get_coordinates(n, &p);
+    fcoords->push_back(p);
+  }
+}
+
+
+void Mesh_snapshot::cell_get_coordinates(const Entity_ID cellid,
+                                         std::vector<JaliGeometry::Point>
+                                         *ccoords) const {
+  ccoords->clear();
+  JaliGeometry::Point p(space_dim_);
+  for (auto const& n : cell_nodes_[cellid]) {
+    node_get_coordinates(n, &p);
+    ccoords->push_back(p);
+  }
+}
+
+
+void Mesh_snapshot::node_set_coordinates(const Entity_ID nodeid,
+                                         const double *ncoord) {
+  assert(ncoord != NULL);
+  std::copy(ncoord, ncoord+space_dim_, coords_ + space_dim_*nodeid);
+  Mesh::node_coordinates_changed(nodeid, coords_ + space_dim_*nodeid);
+}
+
+
+void Mesh_snapshot::node_set_coordinates(const Entity_ID nodeid,
+                                         const JaliGeometry::Point ncoord) {
+  double xyz[3];
+  for (unsigned int d = 0; d < space_dim_; d++)
+    xyz[d] = ncoord[d];
+  node_set_coordinates(nodeid, xyz);
+}
+
+
+void Mesh_snapshot::get_labeled_set_entities(
+    const JaliGeometry::LabeledSetRegionPtr r, const Entity_kind kind,
+    Entity_ID_List *owned_entities, Entity_ID_List *ghost_entities) const {
+  owned_entities->clear();
+  ghost_entities->clear();
+
+  ArrayView<char> names = file_->section<char>("set.names");
+  ArrayView<std::int8_t> kinds = file_->section<std::int8_t>("set.kinds");
+  char const *name = names.data();
+  for (std::size_t i = 0; i < kinds.size(); i++) {
+    std::string setname(name);
+    name += setname.size() + 1;
+    if (setname == r->name() && static_cast<Entity_kind>(kinds[i]) == kind) {
+      *owned_entities = file_->csr<Entity_ID>("set.owned")[i].to_vector();
+      *ghost_entities = file_->csr<Entity_ID>("set.ghost")[i].to_vector();
+      return;
+    }
+  }
+}
+
+
+void Mesh_snapshot::cell_get_faces_and_dirs_internal(const Entity_ID cellid,
+                                                     Entity_ID_List *faceids,
+                                                     std::vector<dir_t>
+                                                     *face_dirs,
+                                                     const bool ordered)
+    const {
+  require_(faces_requested, "Faces");
+  SnapshotCSR<Entity_ID> const& cfaces =
+      ordered ? cell_faces_ordered_ : cell_faces_;
+  ArrayView<dir_t> const& cfdirs =
+      ordered ? cell_face_dirs_ordered_ : cell_face_dirs_;
+
+  ArrayView<Entity_ID> row = cfaces[cellid];
+  faceids->assign(row.begin(), row.end());
+  if (face_dirs) {
+    std::size_t const offset = cfaces.offsets()[cellid];
+    face_dirs->assign(cfdirs.begin() + offset,
+                      cfdirs.begin() + offset + row.size());
+  }
+}
+
+
+void Mesh_snapshot::face_get_cells_internal(const Entity_ID faceid,
+                                            const Entity_type ptype,
+                                            Entity_ID_List *cellids) const {
+  require_(faces_requested, "Faces");
+  filter_by_type_(Entity_kind::CELL, face_cells_[faceid], ptype, cellids);
+}
+
+
+void Mesh_snapshot::face_get_edges_and_dirs_internal(const Entity_ID faceid,
+                                                     Entity_ID_List *edgeids,
+                                                     std::vector<dir_t>
+                                                     *edge_dirs,
+                                                     const bool ordered)
+    const {
+  require_(edges_requested && faces_requested, "Edges");
+  ArrayView<Entity_ID> row = face_edges_[faceid];
+  edgeids->assign(row.begin(), row.end());
+  if (edge_dirs) {
+    std::size_t const offset = face_edges_.offsets()[faceid];
+    edge_dirs->assign(face_edge_dirs_.begin() + offset,
+                      face_edge_dirs_.begin() + offset + row.size());
+  }
+}
+
+
+void Mesh_snapshot::cell_get_edges_internal(const Entity_ID cellid,
+                                            Entity_ID_List *edgeids) const {
+  require_(edges_requested, "Edges");
+  ArrayView<Entity_ID> row = cell_edges_[cellid];
+  edgeids->assign(row.begin(), row.end());
+}
+
+
+void Mesh_snapshot::cell_2D_get_edges_and_dirs_internal(
+    const Entity_ID cellid, Entity_ID_List *edgeids,
+    std::vector<dir_t> *edge_dirs) const {
+  require_(edges_requested && manifold_dim_ == 2, "2D cell edges");
+  ArrayView<Entity_ID> row = cell_edges2d_[cellid];
+  edgeids->assign(row.begin(), row.end());
+  if (edge_dirs) {
+    std::size_t const offset = cell_edges2d_.offsets()[cellid];
+    edge_dirs->assign(cell_edge_dirs2d_.begin() + offset,
+                      cell_edge_dirs2d_.begin() + offset + row.size());
+  }
+}
+
+
+void Mesh_snapshot::edge_get_nodes_internal(const Entity_ID edgeid,
+                                            Entity_ID *nodeid0,
+                                            Entity_ID *nodeid1) const {
+  require_(edges_requested, "Edges");
+  *nodeid0 = edge_nodes_[2*edgeid];
+  *nodeid1 = edge_nodes_[2*edgeid+1];
+}
+
+}  // close namespace Jali
@@ -0,0 +1,270 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef _MESH_SNAPSHOT_H_
+#define _MESH_SNAPSHOT_H_
+
+#include <memory>
+#include <vector>
+#include <string>
+#include "mpi.h"
+
+#include "Mesh.hh"
+#include "MeshSnapshot.hh"
+#include "Region.hh"
+
+#include "Geometry.hh"
+#include "GeometricModel.hh"
+#include "errors.hh"
+
+namespace Jali {
+
+// Mesh framework for meshes read back from a Jali-native snapshot
+// (see Mesh::write_snapshot and MeshSnapshot.hh).
+//
+// The snapshot file of this rank is mapped into memory and the
+// adjacency queries are answered from the mapped arrays (the base
+// class only copies them into its caches when a view or the tiles
+// need one), so a mesh partition comes back with its local numbering,
+// ghost entities, global IDs, mesh sets and tiles exactly as they
+// were written, without repeating the import, distribution,
+// renumbering or partitioning steps of the original framework. The
+// entity lists, mesh sets and tiles are still rebuilt from the stored
+// lists, and the geometry is recomputed. The entity kinds, tiling and
+// other options are those of the mesh that was written.
+//
+// The relationships are checked when the file is mapped so that a
+// damaged file fails in the constructor rather than in a later query.
+//
+// Node coordinates may be changed; the changes are only made to the
+// mapped copy in memory, never to the file
+
+class Mesh_snapshot : public virtual Mesh {
+ public:
+  // Map the snapshot 'filename' written on as many ranks as there
+  // are in 'communicator'
+  Mesh_snapshot(const std::string& filename, const MPI_Comm& communicator,
+                const JaliGeometry::GeometricModelPtr& gm =
+                (JaliGeometry::GeometricModelPtr) NULL);
+
+  virtual ~Mesh_snapshot();
+
+  // Get cell type
+  Cell_type cell_get_type(const Entity_ID cellid) const;
+
+  // Global ID of any entity
+  Entity_ID GID(const Entity_ID lid, const Entity_kind kind) const;
+
+  //
+  // Mesh Entity Adjacencies
+  //-------------------------
+
+  // Downward Adjacencies
+  //---------------------
+
+  // Get nodes of cell (in the order of the framework the snapshot was
+  // written from)
+  void cell_get_nodes(const Entity_ID cellid,
+                      Entity_ID_List *nodeids) const;
+
+  // Get nodes of face
+  void face_get_nodes(const Entity_ID faceid,
+                      Entity_ID_List *nodeids) const;
+
+  // Upward adjacencies
+  //-------------------
+
+  // Cells of type 'ptype' connected to a node
+  void node_get_cells(const Entity_ID nodeid,
+                      const Entity_type ptype,
+                      Entity_ID_List *cellids) const;
+
+  // Faces of type 'ptype' connected to a node
+  void node_get_faces(const Entity_ID nodeid,
+                      const Entity_type ptype,
+                      Entity_ID_List *faceids) const;
+
+  // Get faces of ptype of a particular cell that are connected to the
+  // given node
+  void node_get_cell_faces(const Entity_ID nodeid,
+                           const Entity_ID cellid,
+                           const Entity_type ptype,
+                           Entity_ID_List *faceids) const;
+
+  // Same level adjacencies
+  //-----------------------
+
+  // Face connected neighboring cells of given cell in the order of
+  // the cell's faces (boundary faces are skipped)
+  void cell_get_face_adj_cells(const Entity_ID cellid,
+                               const Entity_type ptype,
+                               Entity_ID_List *fadj_cellids) const;
+
+  // Node connected neighboring cells of given cell in ascending order
+  void cell_get_node_adj_cells(const Entity_ID cellid,
+                               const Entity_type ptype,
+                               Entity_ID_List *nadj_cellids) const;
+
+  //
+  // Mesh entity geometry
+  //--------------
+  //
+
+  // Node coordinates (the other variants come from the base class)
+  using Mesh::node_get_coordinates;
+  void node_get_coordinates(const Entity_ID nodeid,
+                            JaliGeometry::Point *ncoord) const;
+
+  // Face coordinates - conventions same as face_get_nodes
+  void face_get_coordinates(const Entity_ID faceid,
+                            std::vector<JaliGeometry::Point> *fcoords) const;
+
+  // Cell coordinates - conventions same as cell_get_nodes
+  void cell_get_coordinates(const Entity_ID cellid,
+                            std::vector<JaliGeometry::Point> *ccoords) const;
+
+  // Modify the coordinates of a node (in memory only)
+  void node_set_coordinates(const Entity_ID nodeid,
+                            const JaliGeometry::Point coords);
+
+  void node_set_coordinates(const Entity_ID nodeid, const double *coords);
+
+  void write_to_exodus_file(const std::string exodusfilename,
+                            const bool with_fields) const
+  {}
+
+  void write_to_gmv_file(const std::string gmvfilename,
+                         const bool with_fields) const
+  {}
+
+ protected:
+  // Boundary Conditions or Sets
+  //----------------------------
+
+  // Entities of a labeled set that was written with the mesh (none
+  // if there is no set of that name and kind in the snapshot)
+  void get_labeled_set_entities(const JaliGeometry::LabeledSetRegionPtr r,
+                                const Entity_kind kind,
+                                Entity_ID_List *owned_entities,
+                                Entity_ID_List *ghost_entities) const;
+
+  // Framework queries cached by the base class
+  //-------------------------------------------
+
+  void cell_get_faces_and_dirs_internal(const Entity_ID cellid,
+                                        Entity_ID_List *faceids,
+                                        std::vector<dir_t> *face_dirs,
+                                        const bool ordered = false) const;
+
+  void face_get_cells_internal(const Entity_ID faceid,
+                               const Entity_type ptype,
+                               Entity_ID_List *cellids) const;
+
+  void face_get_edges_and_dirs_internal(const Entity_ID faceid,
+                                        Entity_ID_List *edgeids,
+                                        std::vector<dir_t> *edge_dirs,
+                                        const bool ordered = true) const;
+
+  void cell_get_edges_internal(const Entity_ID cellid,
+                               Entity_ID_List *edgeids) const;
+
+  void cell_2D_get_edges_and_dirs_internal(const Entity_ID cellid,
+                                           Entity_ID_List *edgeids,
+                                           std::vector<dir_t> *edge_dirs)
+      const;
+
+  void edge_get_nodes_internal(const Entity_ID edgeid, Entity_ID *nodeid0,
+                               Entity_ID *nodeid1) const;
+
+ private:
+  // Constructor that the public one delegates to once the file is
+  // mapped (the base class is set up from the snapshot header)
+  Mesh_snapshot(std::shared_ptr<MeshSnapshotFile> file,
+                const MPI_Comm& communicator,
+                const JaliGeometry::GeometricModelPtr& gm);
+
+  void init_entity_lists_();
+  void init_sets_();
+  void init_tiles_();
+
+  // Do all 'ids' lie in [0, n)?
+  bool valid_ids_(ArrayView<Entity_ID> const& ids, std::size_t const n) const;
+
+  // Does 'csr' have 'nrows' rows of IDs in [0, n) (and as many
+  // directions as IDs)?
+  bool valid_csr_(SnapshotCSR<Entity_ID> const& csr, std::size_t const nrows,
+                  std::size_t const n) const;
+  bool valid_csr_(SnapshotCSR<Entity_ID> const& csr, std::size_t const nrows,
+                  std::size_t const n, ArrayView<dir_t> const& dirs) const;
+
+  // Throw if a relationship the query needs was not written
+  void require_(bool const present, std::string const& what) const;
+
+  // Copy the entities of 'row' of type 'ptype' into 'list'
+  void filter_by_type_(Entity_kind const kind, ArrayView<Entity_ID> const& row,
+                       Entity_type const ptype, Entity_ID_List *list) const;
+
+  std::shared_ptr<MeshSnapshotFile> file_;
+
+  // Views into the mapped file
+
+  double *coords_ = nullptr;
+  ArrayView<std::uint8_t> cell_types_;
+  ArrayView<Entity_ID> node_gids_, edge_gids_, face_gids_, cell_gids_;
+  ArrayView<Entity_ID> edge_nodes_;
+  SnapshotCSR<Entity_ID> cell_nodes_, node_cells_, face_nodes_, face_cells_,
+    node_faces_, cell_edges_;
+  SnapshotCSR<Entity_ID> cell_faces_, cell_faces_ordered_, face_edges_,
+    cell_edges2d_;
+  ArrayView<dir_t> cell_face_dirs_, cell_face_dirs_ordered_, face_edge_dirs_,
+    cell_edge_dirs2d_;
+};
+
+}  // close namespace Jali
+
+#endif /* _MESH_SNAPSHOT_H_ */
@@ -0,0 +1,379 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "UnitTest++.h"
+
+#include "../Mesh_snapshot.hh"
+#include "MeshFactory.hh"
+#include "MeshSet.hh"
+#include "MeshTile.hh"
+
+// A mesh mapped back from a snapshot must be indistinguishable from
+// the mesh that was written
+
+void check_same_mesh(Jali::Mesh const& mesh, Jali::Mesh const& smesh,
+                     bool const all_kinds = false) {
+  CHECK_EQUAL(mesh.space_dimension(), smesh.space_dimension());
+  CHECK_EQUAL(mesh.manifold_dimension(), smesh.manifold_dimension());
+  CHECK(mesh.mesh_type() == smesh.mesh_type());
+  CHECK_EQUAL(mesh.num_nodes(), smesh.num_nodes());
+  CHECK_EQUAL(mesh.num_edges(), smesh.num_edges());
+  CHECK_EQUAL(mesh.num_faces(), smesh.num_faces());
+  CHECK_EQUAL(mesh.num_cells(), smesh.num_cells());
+  if (all_kinds) {
+    CHECK_EQUAL(mesh.num_sides(), smesh.num_sides());
+    CHECK_EQUAL(mesh.num_wedges(), smesh.num_wedges());
+    CHECK_EQUAL(mesh.num_corners(), smesh.num_corners());
+  }
+  CHECK(mesh.cells<Jali::Entity_type::PARALLEL_OWNED>() ==
+        smesh.cells<Jali::Entity_type::PARALLEL_OWNED>());
+  CHECK(mesh.cells<Jali::Entity_type::PARALLEL_GHOST>() ==
+        smesh.cells<Jali::Entity_type::PARALLEL_GHOST>());
+  CHECK(mesh.nodes<Jali::Entity_type::PARALLEL_GHOST>() ==
+        smesh.nodes<Jali::Entity_type::PARALLEL_GHOST>());
+
+  int const dim = mesh.space_dimension();
+  for (auto const c : mesh.cells()) {
+    CHECK_EQUAL(mesh.GID(c, Jali::Entity_kind::CELL),
+                smesh.GID(c, Jali::Entity_kind::CELL));
+    CHECK(mesh.cell_get_type(c) == smesh.cell_get_type(c));
+
+    Jali::Entity_ID_List cfaces, scfaces, cnodes, scnodes, adj, sadj;
+    std::vector<Jali::dir_t> cfdirs, scfdirs;
+    for (bool ordered : {false, true}) {
+      mesh.cell_get_faces_and_dirs(c, &cfaces, &cfdirs, ordered);
+      smesh.cell_get_faces_and_dirs(c, &scfaces, &scfdirs, ordered);
+      CHECK(cfaces == scfaces);
+      CHECK(cfdirs == scfdirs);
+    }
+
+    mesh.cell_get_nodes(c, &cnodes);
+    smesh.cell_get_nodes(c, &scnodes);
+    CHECK(cnodes == scnodes);
+
+    mesh.cell_get_face_adj_cells(c, Jali::Entity_type::ALL, &adj);
+    smesh.cell_get_face_adj_cells(c, Jali::Entity_type::ALL, &sadj);
+    std::sort(adj.begin(), adj.end());
+    std::sort(sadj.begin(), sadj.end());
+    CHECK(adj == sadj);
+
+    CHECK_CLOSE(mesh.cell_volume(c), smesh.cell_volume(c), 1.0e-12);
+    JaliGeometry::Point cen = mesh.cell_centroid(c);
+    JaliGeometry::Point scen = smesh.cell_centroid(c);
+    for (int d = 0; d < dim; d++)
+      CHECK_CLOSE(cen[d], scen[d], 1.0e-12);
+
+    if (all_kinds) {
+      CHECK(mesh.cell_get_sides_view(c).to_vector() ==
+            smesh.cell_get_sides_view(c).to_vector());
+      CHECK(mesh.cell_get_corners_view(c).to_vector() ==
+            smesh.cell_get_corners_view(c).to_vector());
+    }
+  }
+
+  for (auto const f : mesh.faces()) {
+    CHECK_EQUAL(mesh.GID(f, Jali::Entity_kind::FACE),
+                smesh.GID(f, Jali::Entity_kind::FACE));
+    Jali::Entity_ID_List fcells, sfcells, fnodes, sfnodes;
+    mesh.face_get_cells(f, Jali::Entity_type::ALL, &fcells);
+    smesh.face_get_cells(f, Jali::Entity_type::ALL, &sfcells);
+    CHECK(fcells == sfcells);
+    mesh.face_get_nodes(f, &fnodes);
+    smesh.face_get_nodes(f, &sfnodes);
+    CHECK(fnodes == sfnodes);
+  }
+
+  for (auto const e : mesh.edges()) {
+    Jali::Entity_ID n0, n1, sn0, sn1;
+    mesh.edge_get_nodes(e, &n0, &n1);
+    smesh.edge_get_nodes(e, &sn0, &sn1);
+    CHECK_EQUAL(n0, sn0);
+    CHECK_EQUAL(n1, sn1);
+  }
+
+  for (auto const n : mesh.nodes()) {
+    CHECK_EQUAL(mesh.GID(n, Jali::Entity_kind::NODE),
+                smesh.GID(n, Jali::Entity_kind::NODE));
+    JaliGeometry::Point p, sp;
+    mesh.node_get_coordinates(n, &p);
+    smesh.node_get_coordinates(n, &sp);
+    for (int d = 0; d < dim; d++)
+      CHECK_EQUAL(p[d], sp[d]);
+
+    Jali::Entity_ID_List ncells, sncells;
+    mesh.node_get_cells(n, Jali::Entity_type::ALL, &ncells);
+    smesh.node_get_cells(n, Jali::Entity_type::ALL, &sncells);
+    CHECK(ncells == sncells);
+  }
+}
+
+
+TEST(SNAPSHOT_ROUNDTRIP) {
+  int nprocs;
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+  // Renumbered, tiled mesh with a mesh set
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  if (nprocs == 1) {
+    factory.framework(Jali::Simple);
+  } else if (Jali::framework_generates(Jali::MSTK, true, 3)) {
+    factory.framework(Jali::MSTK);
+  } else {
+    return;
+  }
+  factory.num_tiles(5);
+  factory.num_ghost_layers_tile(1);
+  factory.partitioner(Jali::Partitioner_type::RCB);
+  factory.ordering(Jali::Entity_ordering::HILBERT);
+  std::shared_ptr<Jali::Mesh> mesh =
+      factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 6, 5, 4);
+
+  Jali::Entity_ID_List lower;
+  for (auto const c : mesh->cells<Jali::Entity_type::PARALLEL_OWNED>())
+    if (mesh->cell_centroid(c)[2] < 0.5) lower.push_back(c);
+  Jali::make_meshset("lower", *mesh, Jali::Entity_kind::CELL, lower, {});
+
+  std::string const filename = "test_snapshot_roundtrip.jsnap";
+  mesh->write_snapshot(filename);
+  CHECK(Jali::is_mesh_snapshot(filename, MPI_COMM_WORLD));
+
+  // The snapshot is recognized whatever the framework and options of
+  // the factory
+
+  Jali::MeshFactory factory2(MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> smesh = factory2(filename);
+  CHECK(std::dynamic_pointer_cast<Jali::Mesh_snapshot>(smesh) != nullptr);
+  check_same_mesh(*mesh, *smesh);
+
+  // Mesh sets and tiles come back as they were
+
+  std::shared_ptr<Jali::MeshSet> set =
+      smesh->find_meshset("lower", Jali::Entity_kind::CELL);
+  CHECK(set != nullptr);
+  if (set)
+    CHECK(set->entities<Jali::Entity_type::PARALLEL_OWNED>() == lower);
+
+  CHECK_EQUAL(mesh->num_tiles(), smesh->num_tiles());
+  for (int t = 0; t < mesh->num_tiles(); t++) {
+    auto const& tile = mesh->tiles()[t];
+    auto const& stile = smesh->tiles()[t];
+    CHECK(tile->cells<Jali::Entity_type::PARALLEL_OWNED>() ==
+          stile->cells<Jali::Entity_type::PARALLEL_OWNED>());
+    CHECK(tile->cells<Jali::Entity_type::PARALLEL_GHOST>() ==
+          stile->cells<Jali::Entity_type::PARALLEL_GHOST>());
+  }
+
+  // Moving a node changes the mesh in memory but not the file
+
+  JaliGeometry::Point p, p0;
+  smesh->node_get_coordinates(0, &p0);
+  p = p0;
+  p[0] -= 0.01;
+  smesh->node_set_coordinates(0, p);
+  smesh->node_get_coordinates(0, &p);
+  CHECK_CLOSE(p0[0] - 0.01, p[0], 1.0e-14);
+
+  std::shared_ptr<Jali::Mesh> smesh2 = factory2(filename);
+  smesh2->node_get_coordinates(0, &p);
+  CHECK_EQUAL(p0[0], p[0]);
+
+  std::remove(Jali::snapshot_filename(filename, MPI_COMM_WORLD).c_str());
+}
+
+
+TEST(SNAPSHOT_ALL_ENTITY_KINDS) {
+  int nprocs;
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+  if (nprocs > 1) return;
+
+  Jali::MeshFactory factory(MPI_COMM_SELF);
+  factory.framework(Jali::Structured);
+  factory.included_entities(Jali::Entity_kind::ALL_KIND);
+
+  std::string const filename = "test_snapshot_kinds.jsnap";
+  for (int dim = 2; dim <= 3; dim++) {
+    std::shared_ptr<Jali::Mesh> mesh = (dim == 2) ?
+        factory(0.0, 0.0, 1.0, 2.0, 3, 4) :
+        factory(0.0, 0.0, 0.0, 1.0, 2.0, 3.0, 2, 3, 2);
+    mesh->write_snapshot(filename);
+
+    std::shared_ptr<Jali::Mesh> smesh =
+        std::make_shared<Jali::Mesh_snapshot>(filename, MPI_COMM_SELF);
+    CHECK(smesh->num_edges() > 0);
+    CHECK(smesh->num_corners() > 0);
+    check_same_mesh(*mesh, *smesh, true);
+
+    for (auto const f : mesh->faces()) {
+      Jali::Entity_ID_List fedges, sfedges;
+      std::vector<Jali::dir_t> fedirs, sfedirs;
+      mesh->face_get_edges_and_dirs(f, &fedges, &fedirs, true);
+      smesh->face_get_edges_and_dirs(f, &sfedges, &sfedirs, true);
+      CHECK(fedges == sfedges);
+      CHECK(fedirs == sfedirs);
+    }
+    for (auto const w : mesh->wedges())
+      CHECK_CLOSE(mesh->wedge_volume(w), smesh->wedge_volume(w), 1.0e-12);
+  }
+  std::remove(filename.c_str());
+}
+
+
+TEST(SNAPSHOT_INVALID_FILES) {
+  int nprocs;
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+  if (nprocs > 1) return;
+
+  // Not a snapshot
+
+  std::string const filename = "test_snapshot_invalid.jsnap";
+  {
+    std::ofstream os(filename.c_str());
+    os << "not a mesh snapshot\n";
+  }
+  CHECK(!Jali::is_mesh_snapshot(filename, MPI_COMM_SELF));
+  CHECK(!Jali::is_mesh_snapshot("no_such_file.jsnap", MPI_COMM_SELF));
+  CHECK_THROW(Jali::Mesh_snapshot(filename, MPI_COMM_SELF), Errors::Message);
+
+  Jali::MeshFactory factory(MPI_COMM_SELF);
+  factory.framework(Jali::Simple);
+  std::shared_ptr<Jali::Mesh> mesh =
+      factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 2, 2, 2);
+  mesh->write_snapshot(filename);
+
+  std::vector<char> bytes;
+  {
+    std::ifstream is(filename.c_str(), std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(is),
+                 std::istreambuf_iterator<char>());
+  }
+  auto write_bytes = [&](std::vector<char> const& b) {
+    std::ofstream os(filename.c_str(), std::ios::binary | std::ios::trunc);
+    os.write(b.data(), b.size());
+  };
+
+  // Another version of the format
+
+  std::vector<char> modified = bytes;
+  Jali::SnapshotHeader header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  header.version = Jali::SNAPSHOT_VERSION + 1;
+  std::memcpy(modified.data(), &header, sizeof(header));
+  write_bytes(modified);
+  CHECK(Jali::is_mesh_snapshot(filename, MPI_COMM_SELF));
+  CHECK_THROW(Jali::Mesh_snapshot(filename, MPI_COMM_SELF), Errors::Message);
+
+  // Written on another number of ranks
+
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  header.nprocs = 4;
+  std::memcpy(modified.data(), &header, sizeof(header));
+  write_bytes(modified);
+  CHECK_THROW(Jali::Mesh_snapshot(filename, MPI_COMM_SELF), Errors::Message);
+
+  // Truncated
+
+  modified.assign(bytes.begin(), bytes.begin() + bytes.size()/2);
+  write_bytes(modified);
+  CHECK_THROW(Jali::Mesh_snapshot(filename, MPI_COMM_SELF), Errors::Message);
+
+  // Damaged relationships - offsets that decrease and a cell node
+  // that does not exist
+
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  auto section_offset = [&](std::string const& name) -> std::size_t {
+    for (int i = 0; i < header.num_sections; i++) {
+      Jali::SnapshotSection section;
+      std::memcpy(&section, bytes.data() + header.table_offset +
+                  i*sizeof(section), sizeof(section));
+      if (name == section.name) return section.offset;
+    }
+    return 0;
+  };
+
+  std::uint64_t const bad_offset = 1000;
+  modified = bytes;
+  std::memcpy(modified.data() + section_offset("cell.nodes.offsets") +
+              sizeof(std::uint64_t), &bad_offset, sizeof(bad_offset));
+  write_bytes(modified);
+  CHECK_THROW(Jali::Mesh_snapshot(filename, MPI_COMM_SELF), Errors::Message);
+
+  Jali::Entity_ID const bad_node = 27;
+  modified = bytes;
+  std::memcpy(modified.data() + section_offset("cell.nodes.data"),
+              &bad_node, sizeof(bad_node));
+  write_bytes(modified);
+  CHECK_THROW(Jali::Mesh_snapshot(filename, MPI_COMM_SELF), Errors::Message);
+
+  // Intact
+
+  write_bytes(bytes);
+  Jali::Mesh_snapshot smesh(filename, MPI_COMM_SELF);
+  CHECK_EQUAL(8, smesh.num_cells());
+
+  // Without tiles, the topology is read from the mapping and not
+  // copied
+
+  std::map<Jali::Mesh_cache, std::size_t> report = smesh.memory_report();
+  CHECK_EQUAL(0, report[Jali::Mesh_cache::CELL2NODE]);
+  CHECK_EQUAL(0, report[Jali::Mesh_cache::CELL2FACE]);
+  CHECK_EQUAL(0, report[Jali::Mesh_cache::FACE2NODE]);
+  CHECK(report[Jali::Mesh_cache::CELL_GEOMETRY] > 0);
+
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,727 @@
+/*
+Copyright (c) 2019, Triad National Security, LLC
+All rights reserved.
+
+Copyright 2019. Triad National Security, LLC. This software was
+produced under U.S. Government contract 89233218CNA000001 for Los
+Alamos National Laboratory (LANL), which is operated by Triad
+National Security, LLC for the U.S. Department of Energy. 
+All rights in the program are reserved by Triad National Security,
+LLC, and the U.S. Department of Energy/National Nuclear Security
+Administration. The Government is granted for itself and others acting
+on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+in this material to reproduce, prepare derivative works, distribute
+copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+ 
+
+This is open source software distributed under the 3-clause BSD license.
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+1. Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Triad National Security, LLC, Los Alamos
+   National Laboratory, LANL, the U.S. Government, nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+ 
+THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <algorithm>
+#include <cassert>
+
+#include "Mesh_structured.hh"
+
+#include "mpi.h"
+
+#include "errors.hh"
+
+namespace Jali {
+
+namespace {
+
+// Offsets of the nodes of a cell from its lower left node in the
+// standard order (Exodus II for hexes, ccw for quads). A 2D cell
+// uses the first 4 and a 1D cell the first 2
+
+int const cell_node_offsets[8][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0},
+                                     {0, 1, 0}, {0, 0, 1}, {1, 0, 1},
+                                     {1, 1, 1}, {0, 1, 1}};
+
+// Faces of a cell as (direction, side) pairs in the standard order -
+// y=lo, x=hi, y=hi, x=lo, z=lo, z=hi in 3D and the first four of
+// those (ccw) in 2D
+
+int const cell_face_slots[6][2] = {{1, 0}, {0, 1}, {1, 1},
+                                   {0, 0}, {2, 0}, {2, 1}};
+int const cell_face_slots_1d[2][2] = {{0, 0}, {0, 1}};
+
+// Offsets of the nodes of a face from its lower left node, ccw about
+// the face normal, for faces normal to x, y and z
+
+int const face_node_offsets[3][4][3] = {
+  {{0, 0, 0}, {0, 1, 0}, {0, 1, 1}, {0, 0, 1}},
+  {{0, 0, 0}, {1, 0, 0}, {1, 0, 1}, {0, 0, 1}},
+  {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}}
+};
+
+// Pairs of local nodes (see cell_node_offsets) forming the edges of a hex
+
+int const hex_edge_nodes[12][2] = {{0, 1}, {1, 2}, {2, 3}, {3, 0},
+                                   {4, 5}, {5, 6}, {6, 7}, {7, 4},
+                                   {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+
+}  // anonymous namespace
+
+
+Mesh_structured::Mesh_structured(double x0, double y0, double z0,
+                                 double x1, double y1, double z1,
+                                 int nx, int ny, int nz,
+                                 const MPI_Comm& mycomm,
+                                 const JaliGeometry::GeometricModelPtr& gm,
+                                 const bool request_faces,
+                                 const bool request_edges,
+                                 const bool request_sides,
+                                 const bool request_wedges,
+                                 const bool request_corners,
+                                 const int num_tiles_ini,
+                                 const int num_ghost_layers_tile,
+                                 const int num_ghost_layers_distmesh,
+                                 const bool boundary_ghosts_requested,
+                                 const Partitioner_type partitioner) :
+    Mesh(request_faces, request_edges, request_sides, request_wedges,
+         request_corners, num_tiles_ini, num_ghost_layers_tile,
+         num_ghost_layers_distmesh, boundary_ghosts_requested,
+         partitioner, JaliGeometry::Geom_type::CARTESIAN, mycomm) {
+
+  assert(!boundary_ghosts_requested);  // Cannot yet make boundary ghosts
+
+  double lo[3] = {x0, y0, z0}, hi[3] = {x1, y1, z1};
+  std::array<int, 3> n = {{nx, ny, nz}};
+  for (int d = 0; d < 3; d++) {
+    axis_coords_[d].resize(n[d]+1);
+    double h = (hi[d] - lo[d])/n[d];
+    for (int i = 0; i <= n[d]; i++)
+      axis_coords_[d][i] = lo[d] + i*h;
+  }
+
+  init_index_space_(3, n);
+
+  Mesh::set_mesh_type(Mesh_type::RECTANGULAR);
+  if (gm != (JaliGeometry::GeometricModelPtr) NULL)
+    Mesh::set_geometric_model(gm);
+
+  init_entity_lists_();
+
+  implicit_topology_ = true;  // queries below are cheaper than lookups
+  cache_extra_variables();
+
+  if (Mesh::num_tiles_ini_)
+    Mesh::build_tiles();
+}
+
+
+Mesh_structured::Mesh_structured(double x0, double y0,
+                                 double x1, double y1,
+                                 int nx, int ny,
+                                 const MPI_Comm& mycomm,
+                                 const JaliGeometry::GeometricModelPtr& gm,
+                                 const bool request_faces,
+                                 const bool request_edges,
+                                 const bool request_sides,
+                                 const bool request_wedges,
+                                 const bool request_corners,
+                                 const int num_tiles_ini,
+                                 const int num_ghost_layers_tile,
+                                 const int num_ghost_layers_distmesh,
+                                 const bool boundary_ghosts_requested,
+                                 const Partitioner_type partitioner,
+                                 const JaliGeometry::Geom_type geom_type) :
+    Mesh(request_faces, request_edges, request_sides, request_wedges,
+         request_corners, num_tiles_ini, num_ghost_layers_tile,
+         num_ghost_layers_distmesh, boundary_ghosts_requested,
+         partitioner, geom_type, mycomm) {
+  set_space_dimension(2);
+  set_manifold_dimension(2);
+
+  assert(!boundary_ghosts_requested);  // Cannot yet make boundary ghosts
+
+  double lo[2] = {x0, y0}, hi[2] = {x1, y1};
+  std::array<int, 3> n = {{nx, ny, 1}};
+  for (int d = 0; d < 2; d++) {
+    axis_coords_[d].resize(n[d]+1);
+    double h = (hi[d] - lo[d])/n[d];
+    for (int i = 0; i <= n[d]; i++)
+      axis_coords_[d][i] = lo[d] + i*h;
+  }
+
+  init_index_space_(2, n);
+
+  Mesh::set_mesh_type(Mesh_type::RECTANGULAR);
+  if (gm != (JaliGeometry::GeometricModelPtr) NULL)
+    Mesh::set_geometric_model(gm);
+
+  init_entity_lists_();
+
+  implicit_topology_ = true;  // queries below are cheaper than lookups
+  cache_extra_variables();
+
+  if (Mesh::num_tiles_ini_)
+    Mesh::build_tiles();
+}
+
+
+Mesh_structured::Mesh_structured(const std::vector<double>& x,
+                                 const MPI_Comm& mycomm,
+                                 const JaliGeometry::GeometricModelPtr& gm,
+                                 const bool request_faces,
+                                 const bool request_edges,
+                                 const bool request_sides,
+                                 const bool request_wedges,
+                                 const bool request_corners,
+                                 const int num_tiles_ini,
+                                 const int num_ghost_layers_tile,
+                                 const int num_ghost_layers_distmesh,
+                                 const bool boundary_ghosts_requested,
+                                 const Partitioner_type partitioner,
+                                 const JaliGeometry::Geom_type geom_type) :
+    Mesh(request_faces, request_edges, request_sides, request_wedges,
+         request_corners, num_tiles_ini, num_ghost_layers_tile,
+         num_ghost_layers_distmesh, boundary_ghosts_requested,
+         partitioner, geom_type, mycomm) {
+  set_space_dimension(1);
+  set_manifold_dimension(1);
+
+  assert(!boundary_ghosts_requested);  // Cannot yet make boundary ghosts
+
+  axis_coords_[0] = x;
+
+  init_index_space_(1, {{static_cast<int>(x.size())-1, 1, 1}});
+
+  Mesh::set_mesh_type(Mesh_type::RECTANGULAR);
+  if (gm != (JaliGeometry::GeometricModelPtr) NULL)
+    Mesh::set_geometric_model(gm);
+
+  init_entity_lists_();
+
+  implicit_topology_ = true;  // queries below are cheaper than lookups
+  cache_extra_variables();
+
+  if (Mesh::num_tiles_ini_)
+    Mesh::build_tiles();
+}
+
+
+Mesh_structured::~Mesh_structured() { }
+
+
+// Set up the extents and starting IDs of all the entity groups
+
+void Mesh_structured::init_index_space_(int const dim,
+                                        std::array<int, 3> const& ncells) {
+  for (int d = 0; d < 3; d++) {
+    ncells_[d] = (d < dim) ? ncells[d] : 1;
+    nnodes_[d] = (d < dim) ? ncells[d]+1 : 1;
+  }
+
+  num_cells_ = ncells_[0]*ncells_[1]*ncells_[2];
+  num_nodes_ = nnodes_[0]*nnodes_[1]*nnodes_[2];
+
+  // Faces normal to the highest direction are numbered first
+
+  num_faces_ = 0;
+  for (int d = dim-1; d >= 0; d--) {
+    for (int e = 0; e < 3; e++)
+      face_extents_[d][e] = (e == d) ? nnodes_[e] : ncells_[e];
+    face_offset_[d] = num_faces_;
+    num_faces_ += face_extents_[d][0]*face_extents_[d][1]*face_extents_[d][2];
+  }
+
+  num_edges_ = 0;
+  if (dim == 1) {
+    num_edges_ = num_nodes_;
+  } else if (dim == 2) {
+    num_edges_ = num_faces_;
+  } else {
+    for (int d = 0; d < 3; d++) {
+      for (int e = 0; e < 3; e++)
+        edge_extents_[d][e] = (e == d) ? ncells_[e] : nnodes_[e];
+      edge_offset_[d] = num_edges_;
+      num_edges_ +=
+          edge_extents_[d][0]*edge_extents_[d][1]*edge_extents_[d][2];
+    }
+  }
+}
+
+
+// Populate entity ids arrays in the base class so that iterators work
+
+void Mesh_structured::init_entity_lists_() {
+  auto fill = [](int const n, std::vector<Entity_ID> *owned,
+                 std::vector<Entity_ID> *ghost, std::vector<Entity_ID> *all) {
+    owned->resize(n);
+    for (int i = 0; i < n; ++i)
+      (*owned)[i] = i;
+    ghost->clear();
+    *all = *owned;
+  };
+
+  fill(num_nodes_, &nodeids_owned_, &nodeids_ghost_, &nodeids_all_);
+  fill(Mesh::edges_requested ? num_edges_ : 0,
+       &edgeids_owned_, &edgeids_ghost_, &edgeids_all_);
+  fill(Mesh::faces_requested ? num_faces_ : 0,
+       &faceids_owned_, &faceids_ghost_, &faceids_all_);
+  fill(num_cells_, &cellids_owned_, &cellids_ghost_, &cellids_all_);
+}
+
+
+Cell_type Mesh_structured::cell_get_type(const Entity_ID cellid) const {
+  switch (manifold_dim_) {
+    case 3: return Cell_type::HEX;
+    case 2: return Cell_type::QUAD;
+    default: return Cell_type::CELLTYPE_UNKNOWN;
+  }
+}
+
+
+Entity_ID Mesh_structured::GID(const Entity_ID lid,
+                               const Entity_kind kind) const {
+  return lid;  // Its a serial code
+}
+
+
+int Mesh_structured::face_get_ijk(const Entity_ID faceid, int ijk[3]) const {
+  for (int d = 0; d < static_cast<int>(manifold_dim_); d++) {
+    std::array<int, 3> const& ext = face_extents_[d];
+    int local = faceid - face_offset_[d];
+    if (local >= 0 && local < ext[0]*ext[1]*ext[2]) {
+      ijk_of(local, ext, ijk);
+      return d;
+    }
+  }
+  Errors::Message mesg("Mesh_structured: invalid face ID");
+  Exceptions::Jali_throw(mesg);
+  return -1;
+}
+
+
+Entity_ID Mesh_structured::edge_between_(const Entity_ID n0,
+                                         const Entity_ID n1,
+                                         dir_t *edir) const {
+  int ijk0[3], ijk1[3];
+  node_get_ijk(n0, ijk0);
+  node_get_ijk(n1, ijk1);
+
+  int d = (ijk0[0] != ijk1[0]) ? 0 : ((ijk0[1] != ijk1[1]) ? 1 : 2);
+  bool forward = (ijk0[d] < ijk1[d]);
+  *edir = forward ? 1 : -1;
+  return edge_id_(d, forward ? ijk0 : ijk1);
+}
+
+
+// Downward adjacencies
+//---------------------
+
+void Mesh_structured::cell_get_nodes(const Entity_ID cellid,
+                                     Entity_ID_List *nodeids) const {
+  int ijk[3];
+  cell_get_ijk(cellid, ijk);
+
+  int nn = 1 << manifold_dim_;
+  nodeids->resize(nn);
+  for (int n = 0; n < nn; n++) {
+    int const *off = cell_node_offsets[n];
+    (*nodeids)[n] = node_id(ijk[0]+off[0], ijk[1]+off[1], ijk[2]+off[2]);
+  }
+}
+
+
+void Mesh_structured::face_get_nodes(const Entity_ID faceid,
+                                     Entity_ID_List *nodeids) const {
+  int ijk[3];
+  int d = face_get_ijk(faceid, ijk);
+
+  if (manifold_dim_ == 1) {
+    nodeids->assign(1, node_id(ijk[0]));
+  } else if (manifold_dim_ == 2) {
+    // the edge runs along the other direction
+    nodeids->resize(2);
+    (*nodeids)[0] = node_id(ijk[0], ijk[1]);
+    (*nodeids)[1] = (d == 0) ? node_id(ijk[0], ijk[1]+1) :
+        node_id(ijk[0]+1, ijk[1]);
+  } else {
+    nodeids->resize(4);
+    for (int n = 0; n < 4; n++) {
+      int const *off = face_node_offsets[d][n];
+      (*nodeids)[n] = node_id(ijk[0]+off[0], ijk[1]+off[1], ijk[2]+off[2]);
+    }
+  }
+}
+
+
+void Mesh_structured::cell_get_faces_and_dirs_internal(const Entity_ID cellid,
+                                                       Entity_ID_List *faceids,
+                                                       std::vector<dir_t>
+                                                       *face_dirs,
+                                                       const bool ordered)
+    const {
+  int ijk[3];
+  cell_get_ijk(cellid, ijk);
+
+  int nf = 2*manifold_dim_;
+  auto const *slots = (manifold_dim_ == 1) ? cell_face_slots_1d :
+      cell_face_slots;
+
+  faceids->resize(nf);
+  if (face_dirs) face_dirs->resize(nf);
+  for (int i = 0; i < nf; i++) {
+    int d = slots[i][0], side = slots[i][1];
+    int fijk[3] = {ijk[0], ijk[1], ijk[2]};
+    fijk[d] += side;
+    (*faceids)[i] = face_id(d, fijk[0], fijk[1], fijk[2]);
+
+    // The face normal points out of the cell on its hi side
+    if (face_dirs)
+      (*face_dirs)[i] = side ? face_sign_(d) : -face_sign_(d);
+  }
+}
+
+
+// Edges of a face with the directions in which the face uses them
+
+void Mesh_structured::face_get_edges_and_dirs_internal(const Entity_ID faceid,
+                                                       Entity_ID_List *edgeids,
+                                                       std::vector<dir_t>
+                                                       *edge_dirs,
+                                                       const bool ordered)
+    const {
+  edgeids->clear();
+  if (edge_dirs) edge_dirs->clear();
+
+  if (manifold_dim_ == 1) {
+    return;
+  } else if (manifold_dim_ == 2) {
+    edgeids->push_back(faceid);  // edges and faces are the same in 2D
+    if (edge_dirs) edge_dirs->push_back(1);
+  } else {
+    Entity_ID_List fnodes;
+    face_get_nodes(faceid, &fnodes);
+    for (int i = 0; i < 4; i++) {
+      dir_t edir;
+      edgeids->push_back(edge_between_(fnodes[i], fnodes[(i+1)%4], &edir));
+      if (edge_dirs) edge_dirs->push_back(edir);
+    }
+  }
+}
+
+
+void Mesh_structured::cell_get_edges_internal(const Entity_ID cellid,
+                                              Entity_ID_List *edgeids) const {
+  if (manifold_dim_ == 1) {
+    cell_get_nodes(cellid, edgeids);  // edges are the same as nodes in 1D
+  } else if (manifold_dim_ == 2) {
+    cell_get_faces_and_dirs_internal(cellid, edgeids, nullptr);
+  } else {
+    Entity_ID_List cnodes;
+    cell_get_nodes(cellid, &cnodes);
+
+    edgeids->resize(12);
+    for (int i = 0; i < 12; i++) {
+      dir_t edir;
+      (*edgeids)[i] = edge_between_(cnodes[hex_edge_nodes[i][0]],
+                                    cnodes[hex_edge_nodes[i][1]], &edir);
+    }
+  }
+}
+
+
+void Mesh_structured::cell_2D_get_edges_and_dirs_internal(
+    const Entity_ID cellid, Entity_ID_List *edgeids,
+    std::vector<dir_t> *edge_dirs) const {
+  if (manifold_dim_ != 2) {
+    Errors::Message mesg("cell_2D_get_edges_and_dirs called on a non-2D mesh");
+    Exceptions::Jali_throw(mesg);
+  }
+
+  // Edges are the faces in 2D and the faces of a cell are already in
+  // ccw order with directions relative to the cell boundary
+  cell_get_faces_and_dirs_internal(cellid, edgeids, edge_dirs);
+}
+
+
+void Mesh_structured::edge_get_nodes_internal(const Entity_ID edgeid,
+                                              Entity_ID *nodeid0,
+                                              Entity_ID *nodeid1) const {
+  if (manifold_dim_ == 1) {
+    // edges are the same as nodes in 1D
+    *nodeid0 = edgeid;
+    *nodeid1 = edgeid;
+  } else if (manifold_dim_ == 2) {
+    Entity_ID_List fnodes;
+    face_get_nodes(edgeid, &fnodes);
+    *nodeid0 = fnodes[0];
+    *nodeid1 = fnodes[1];
+  } else {
+    int d = (edgeid >= edge_offset_[2]) ? 2 :
+        ((edgeid >= edge_offset_[1]) ? 1 : 0);
+    int ijk[3];
+    ijk_of(edgeid - edge_offset_[d], edge_extents_[d], ijk);
+    *nodeid0 = node_id(ijk[0], ijk[1], ijk[2]);
+    ijk[d]++;
+    *nodeid1 = node_id(ijk[0], ijk[1], ijk[2]);
+  }
+}
+
+
+// Upward adjacencies
+//-------------------
+
+// Cells connected to a face - the cell for which the face normal
+// points inwards comes first
+
+void Mesh_structured::face_get_cells_internal(const Entity_ID faceid,
+                                              const Entity_type ptype,
+                                              Entity_ID_List *cellids) const {
+  int ijk[3];
+  int d = face_get_ijk(faceid, ijk);
+
+  cellids->clear();
+
+  Entity_ID hicell = -1, locell = -1;
+  if (ijk[d] < ncells_[d])
+    hicell = cell_id(ijk[0], ijk[1], ijk[2]);
+  if (ijk[d] > 0) {
+    ijk[d]--;
+    locell = cell_id(ijk[0], ijk[1], ijk[2]);
+  }
+
+  Entity_ID first = (face_sign_(d) == 1) ? hicell : locell;
+  Entity_ID second = (face_sign_(d) == 1) ? locell : hicell;
+  if (first != -1) cellids->push_back(first);
+  if (second != -1) cellids->push_back(second);
+}
+
+
+void Mesh_structured::node_get_cells(const Entity_ID nodeid,
+                                     const Entity_type ptype,
+                                     Entity_ID_List *cellids) const {
+  int ijk[3];
+  node_get_ijk(nodeid, ijk);
+
+  int lo[3], hi[3];
+  for (int d = 0; d < 3; d++) {
+    lo[d] = std::max(ijk[d]-1, 0);
+    hi[d] = std::min(ijk[d], ncells_[d]-1);
+  }
+
+  cellids->clear();
+  for (int k = lo[2]; k <= hi[2]; k++)
+    for (int j = lo[1]; j <= hi[1]; j++)
+      for (int i = lo[0]; i <= hi[0]; i++)
+        cellids->push_back(cell_id(i, j, k));
+}
+
+
+void Mesh_structured::node_get_faces(const Entity_ID nodeid,
+                                     const Entity_type ptype,
+                                     Entity_ID_List *faceids) const {
+  int ijk[3];
+  node_get_ijk(nodeid, ijk);
+
+  faceids->clear();
+  for (int d = manifold_dim_-1; d >= 0; d--) {
+    // Faces normal to d through the node - in the other directions
+    // the node is the hi or lo node of the face
+    int lo[3], hi[3];
+    for (int e = 0; e < 3; e++) {
+      if (e == d) {
+        lo[e] = hi[e] = ijk[e];
+      } else {
+        lo[e] = std::max(ijk[e]-1, 0);
+        hi[e] = std::min(ijk[e], face_extents_[d][e]-1);
+      }
+    }
+    for (int k = lo[2]; k <= hi[2]; k++)
+      for (int j = lo[1]; j <= hi[1]; j++)
+        for (int i = lo[0]; i <= hi[0]; i++)
+          faceids->push_back(face_id(d, i, j, k));
+  }
+}
+
+
+void Mesh_structured::node_get_cell_faces(const Entity_ID nodeid,
+                                          const Entity_ID cellid,
+                                          const Entity_type ptype,
+                                          Entity_ID_List *faceids) const {
+  int nijk[3], cijk[3];
+  node_get_ijk(nodeid, nijk);
+  cell_get_ijk(cellid, cijk);
+
+  Entity_ID_List cfaces;
+  cell_get_faces_and_dirs_internal(cellid, &cfaces, nullptr);
+  auto const *slots = (manifold_dim_ == 1) ? cell_face_slots_1d :
+      cell_face_slots;
+
+  faceids->clear();
+  for (std::size_t i = 0; i < cfaces.size(); i++) {
+    int d = slots[i][0], side = slots[i][1];
+    if (nijk[d] == cijk[d] + side)
+      faceids->push_back(cfaces[i]);
+  }
+}
+
+
+// Same level adjacencies
+//-----------------------
+
+void Mesh_structured::cell_get_face_adj_cells(const Entity_ID cellid,
+                                              const Entity_type ptype,
+                                              Entity_ID_List *fadj_cellids)
+    const {
+  int ijk[3];
+  cell_get_ijk(cellid, ijk);
+
+  int nf = 2*manifold_dim_;
+  auto const *slots = (manifold_dim_ == 1) ? cell_face_slots_1d :
+      cell_face_slots;
+
+  fadj_cellids->clear();
+  for (int i = 0; i < nf; i++) {
+    int d = slots[i][0], side = slots[i][1];
+    int aijk[3] = {ijk[0], ijk[1], ijk[2]};
+    aijk[d] += side ? 1 : -1;
+    if (aijk[d] >= 0 && aijk[d] < ncells_[d])
+      fadj_cellids->push_back(cell_id(aijk[0], aijk[1], aijk[2]));
+  }
+}
+
+
+void Mesh_structured::cell_get_node_adj_cells(const Entity_ID cellid,
+                                              const Entity_type ptype,
+                                              Entity_ID_List *nadj_cellids)
+    const {
+  int ijk[3];
+  cell_get_ijk(cellid, ijk);
+
+  int lo[3], hi[3];
+  for (int d = 0; d < 3; d++) {
+    lo[d] = std::max(ijk[d]-1, 0);
+    hi[d] = std::min(ijk[d]+1, ncells_[d]-1);
+  }
+
+  nadj_cellids->clear();
+  for (int k = lo[2]; k <= hi[2]; k++)
+    for (int j = lo[1]; j <= hi[1]; j++)
+      for (int i = lo[0]; i <= hi[0]; i++) {
+        Entity_ID c = cell_id(i, j, k);
+        if (c != cellid) nadj_cellids->push_back(c);
+      }
+}
+
+
+// Coordinate getters and setters
+// ------------------------------
+
+void Mesh_structured::node_get_coordinates(const Entity_ID nodeid,
+                                           JaliGeometry::Point *ncoord) const {
+  int const dim = space_dim_;
+  if (!coordinates_.empty()) {
+    ncoord->set(dim, &(coordinates_[dim*nodeid]));
+  } else {
+    int ijk[3];
+    node_get_ijk(nodeid, ijk);
+    double xyz[3];
+    for (int d = 0; d < dim; d++)
+      xyz[d] = axis_coords_[d][ijk[d]];
+    ncoord->set(dim, xyz);
+  }
+}
+
+
+void Mesh_structured::face_get_coordinates(const Entity_ID faceid,
+                                           std::vector<JaliGeometry::Point>
+                                           *fcoords) const {
+  Entity_ID_List fnodes;
+  face_get_nodes(faceid, &fnodes);
+
+  fcoords->resize(fnodes.size());
+  for (std::size_t i = 0; i < fnodes.size(); i++)
+    node_get_coordinates(fnodes[i], &((*fcoords)[i]));
+}
+
+
+void Mesh_structured::cell_get_coordinates(const Entity_ID cellid,
+                                           std::vector<JaliGeometry::Point>
+                                           *ccoords) const {
+  Entity_ID_List cnodes;
+  cell_get_nodes(cellid, &cnodes);
+
+  ccoords->resize(cnodes.size());
+  for (std::size_t i = 0; i < cnodes.size(); i++)
+    node_get_coordinates(cnodes[i], &((*ccoords)[i]));
+}
+
+
+void Mesh_structured::node_set_coordinates(const Entity_ID nodeid,
+                                           const double *ncoord) {
+  assert(ncoord != NULL);
+
+  int const dim = space_dim_;
+  if (coordinates_.empty()) {
+    // The mesh no longer follows the axis coordinates - switch to an
+    // explicit coordinate array
+    std::vector<double> coords(dim*num_nodes_);
+    JaliGeometry::Point p;
+    for (int n = 0; n < num_nodes_; n++) {
+      node_get_coordinates(n, &p);
+      for (int d = 0; d < dim; d++)
+        coords[dim*n+d] = p[d];
+    }
+    coordinates_.swap(coords);
+  }
+
+  std::copy(ncoord, ncoord+dim, coordinates_.begin() + dim*nodeid);
+
+  Mesh::node_coordinates_changed(nodeid, &(coordinates_[dim*nodeid]));
+}
+
+
+void Mesh_structured::node_set_coordinates(const Entity_ID nodeid,
+                                           const JaliGeometry::Point ncoord) {
+  double xyz[3];
+  for (unsigned int d = 0; d < space_dim_; d++)
+    xyz[d] = ncoord[d];
+  node_set_coordinates(nodeid, xyz);
+}
+
+
+void Mesh_structured::get_labeled_set_entities(
+    const JaliGeometry::LabeledSetRegionPtr r, const Entity_kind kind,
+    Entity_ID_List *owned_entities, Entity_ID_List *ghost_entities) const {
+  // structured mesh is generated, not read, so it cannot have
+  // pre-existing labeled sets
+
+  owned_entities->clear();
+  ghost_entities->clear();
+}
+
+}  // close namespace Jali
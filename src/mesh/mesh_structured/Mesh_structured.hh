@@ -0,0 +1,379 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef _MESH_STRUCTURED_H_
+#define _MESH_STRUCTURED_H_
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <string>
+#include "mpi.h"
+
+#include "Mesh.hh"
+#include "Region.hh"
+
+#include "Geometry.hh"
+#include "GeometricModel.hh"
+#include "errors.hh"
+
+namespace Jali {
+
+// Mesh framework for logically rectangular (tensor product) meshes in
+// 1D, 2D and 3D. The topology is never stored - all adjacencies are
+// computed from the (i,j,k) indices of the entities, so the framework
+// needs O(1) memory for topology and O(nx+ny+nz) memory for the axis
+// coordinates. A full coordinate array is created only if nodes are
+// moved with node_set_coordinates.
+//
+// The mesh is marked as having implicit topology, so the list based
+// adjacency queries and the geometry computations of the base class
+// come straight here and the base class adjacency caches are not
+// built either. The views (cell_get_nodes_view etc.) need storage to
+// point into, so each of them builds its cache on first use, as do
+// sides, wedges, corners and tiles if they are requested.
+//
+// Entity numbering (i fastest, then j, then k):
+//
+//   nodes - i + j*(nx+1) + k*(nx+1)*(ny+1)
+//   cells - i + j*nx + k*nx*ny
+//   faces - grouped by the axis they are normal to, highest axis
+//           first (z-faces, y-faces, x-faces in 3D) and numbered by
+//           their lower left node within each group. In 3D and 2D
+//           x- and z-faces point in the +ve axis direction and
+//           y-faces point in the -ve y direction
+//   edges - x-edges, y-edges then z-edges numbered by their lower
+//           node (3D only; edges are the faces in 2D and the nodes in 1D)
+//
+// The numbering, the ordering of faces in a cell and the face
+// directions are the same as those of the Simple framework in 3D and 1D
+
+class Mesh_structured : public virtual Mesh {
+ public:
+
+  // Hexahedral mesh of the box [x0,x1]x[y0,y1]x[z0,z1]
+  Mesh_structured(double x0, double y0, double z0,
+                  double x1, double y1, double z1,
+                  int nx, int ny, int nz, const MPI_Comm& communicator,
+                  const JaliGeometry::GeometricModelPtr& gm =
+                  (JaliGeometry::GeometricModelPtr) NULL,
+                  const bool request_faces = true,
+                  const bool request_edges = false,
+                  const bool request_sides = false,
+                  const bool request_wedges = false,
+                  const bool request_corners = false,
+                  const int num_tiles_ini = 0,
+                  const int num_ghost_layers_tile = 0,
+                  const int num_ghost_layers_distmesh = 0,
+                  const bool request_boundary_ghosts = false,
+                  const Partitioner_type partitioner = Partitioner_type::METIS);
+
+  // Quadrilateral mesh of the rectangle [x0,x1]x[y0,y1]
+  Mesh_structured(double x0, double y0,
+                  double x1, double y1,
+                  int nx, int ny, const MPI_Comm& communicator,
+                  const JaliGeometry::GeometricModelPtr& gm =
+                  (JaliGeometry::GeometricModelPtr) NULL,
+                  const bool request_faces = true,
+                  const bool request_edges = false,
+                  const bool request_sides = false,
+                  const bool request_wedges = false,
+                  const bool request_corners = false,
+                  const int num_tiles_ini = 0,
+                  const int num_ghost_layers_tile = 0,
+                  const int num_ghost_layers_distmesh = 0,
+                  const bool request_boundary_ghosts = false,
+                  const Partitioner_type partitioner = Partitioner_type::METIS,
+                  const JaliGeometry::Geom_type geom_type =
+                  JaliGeometry::Geom_type::CARTESIAN);
+
+  // 1D mesh with the given node coordinates (need not be uniform)
+  Mesh_structured(const std::vector<double>& x, const MPI_Comm& communicator,
+                  const JaliGeometry::GeometricModelPtr& gm =
+                  (JaliGeometry::GeometricModelPtr) NULL,
+                  const bool request_faces = true,
+                  const bool request_edges = false,
+                  const bool request_sides = false,
+                  const bool request_wedges = false,
+                  const bool request_corners = false,
+                  const int num_tiles_ini = 0,
+                  const int num_ghost_layers_tile = 0,
+                  const int num_ghost_layers_distmesh = 0,
+                  const bool request_boundary_ghosts = false,
+                  const Partitioner_type partitioner = Partitioner_type::METIS,
+                  const JaliGeometry::Geom_type geom_type =
+                  JaliGeometry::Geom_type::CARTESIAN);
+
+  virtual ~Mesh_structured();
+
+
+  // Structured index space
+  //-----------------------
+
+  // These are inline and branch free so that loops over (i,j,k)
+  // can be vectorized. Indices of unused directions must be 0
+
+  // Number of cells along a coordinate direction (1 for directions
+  // beyond the mesh dimension)
+  int num_cells_along(const int dir) const { return ncells_[dir]; }
+
+  // Cell with indices (i,j,k)
+  Entity_ID cell_id(const int i, const int j = 0, const int k = 0) const {
+    return i + ncells_[0]*(j + ncells_[1]*k);
+  }
+
+  // Node with indices (i,j,k)
+  Entity_ID node_id(const int i, const int j = 0, const int k = 0) const {
+    return i + nnodes_[0]*(j + nnodes_[1]*k);
+  }
+
+  // Face normal to direction 'dir' whose lower left node is (i,j,k)
+  Entity_ID face_id(const int dir, const int i, const int j = 0,
+                    const int k = 0) const {
+    std::array<int, 3> const& ext = face_extents_[dir];
+    return face_offset_[dir] + i + ext[0]*(j + ext[1]*k);
+  }
+
+  // Indices of a cell
+  void cell_get_ijk(const Entity_ID cellid, int ijk[3]) const {
+    ijk_of(cellid, ncells_, ijk);
+  }
+
+  // Indices of a node
+  void node_get_ijk(const Entity_ID nodeid, int ijk[3]) const {
+    ijk_of(nodeid, nnodes_, ijk);
+  }
+
+  // Direction a face is normal to and the indices of its lower left node
+  int face_get_ijk(const Entity_ID faceid, int ijk[3]) const;
+
+  // Coordinates of the nodes along direction 'dir' (as originally
+  // generated - not updated by node_set_coordinates)
+  std::vector<double> const& axis_coordinates(const int dir) const {
+    return axis_coords_[dir];
+  }
+
+
+  // Get cell type
+  Cell_type cell_get_type(const Entity_ID cellid) const;
+
+  // Global ID of any entity
+  Entity_ID GID(const Entity_ID lid, const Entity_kind kind) const;
+
+  //
+  // Mesh Entity Adjacencies
+  //-------------------------
+
+  // Downward Adjacencies
+  //---------------------
+
+  // Get nodes of cell in the standard order (Exodus II convention in
+  // 3D, counter-clockwise in 2D)
+  void cell_get_nodes(const Entity_ID cellid,
+                      Entity_ID_List *nodeids) const;
+
+  // Get nodes of face (ccw about the face normal in 3D, tail to
+  // head in 2D)
+  void face_get_nodes(const Entity_ID faceid,
+                      Entity_ID_List *nodeids) const;
+
+  // Upward adjacencies
+  //-------------------
+
+  // Cells of type 'ptype' connected to a node
+  void node_get_cells(const Entity_ID nodeid,
+                      const Entity_type ptype,
+                      Entity_ID_List *cellids) const;
+
+  // Faces of type 'ptype' connected to a node
+  void node_get_faces(const Entity_ID nodeid,
+                      const Entity_type ptype,
+                      Entity_ID_List *faceids) const;
+
+  // Get faces of ptype of a particular cell that are connected to the
+  // given node
+  void node_get_cell_faces(const Entity_ID nodeid,
+                           const Entity_ID cellid,
+                           const Entity_type ptype,
+                           Entity_ID_List *faceids) const;
+
+  // Same level adjacencies
+  //-----------------------
+
+  // Face connected neighboring cells of given cell in the order of
+  // the cell's faces (boundary faces are skipped)
+  void cell_get_face_adj_cells(const Entity_ID cellid,
+                               const Entity_type ptype,
+                               Entity_ID_List *fadj_cellids) const;
+
+  // Node connected neighboring cells of given cell in ascending order
+  void cell_get_node_adj_cells(const Entity_ID cellid,
+                               const Entity_type ptype,
+                               Entity_ID_List *nadj_cellids) const;
+
+  //
+  // Mesh entity geometry
+  //--------------
+  //
+
+  // Node coordinates (the other variants come from the base class)
+  using Mesh::node_get_coordinates;
+  void node_get_coordinates(const Entity_ID nodeid,
+                            JaliGeometry::Point *ncoord) const;
+
+  // Face coordinates - conventions same as face_get_nodes
+  void face_get_coordinates(const Entity_ID faceid,
+                            std::vector<JaliGeometry::Point> *fcoords) const;
+
+  // Cell coordinates - conventions same as cell_get_nodes
+  void cell_get_coordinates(const Entity_ID cellid,
+                            std::vector<JaliGeometry::Point> *ccoords) const;
+
+  // Modify the coordinates of a node. The first call creates an
+  // explicit coordinate array for all nodes
+
+  void node_set_coordinates(const Entity_ID nodeid,
+                            const JaliGeometry::Point coords);
+
+  void node_set_coordinates(const Entity_ID nodeid, const double *coords);
+
+
+  void write_to_exodus_file(const std::string exodusfilename,
+                            const bool with_fields) const
+  {}
+
+  void write_to_gmv_file(const std::string gmvfilename,
+                         const bool with_fields) const
+  {}
+
+ protected:
+
+  // Boundary Conditions or Sets
+  //----------------------------
+
+  void get_labeled_set_entities(const JaliGeometry::LabeledSetRegionPtr r,
+                                const Entity_kind kind,
+                                Entity_ID_List *owned_entities,
+                                Entity_ID_List *ghost_entities) const;
+
+  // Framework queries cached by the base class
+  //-------------------------------------------
+
+  void cell_get_faces_and_dirs_internal(const Entity_ID cellid,
+                                        Entity_ID_List *faceids,
+                                        std::vector<dir_t> *face_dirs,
+                                        const bool ordered = false) const;
+
+  void face_get_cells_internal(const Entity_ID faceid,
+                               const Entity_type ptype,
+                               Entity_ID_List *cellids) const;
+
+  void face_get_edges_and_dirs_internal(const Entity_ID faceid,
+                                        Entity_ID_List *edgeids,
+                                        std::vector<dir_t> *edge_dirs,
+                                        const bool ordered = true) const;
+
+  void cell_get_edges_internal(const Entity_ID cellid,
+                               Entity_ID_List *edgeids) const;
+
+  void cell_2D_get_edges_and_dirs_internal(const Entity_ID cellid,
+                                           Entity_ID_List *edgeids,
+                                           std::vector<dir_t> *edge_dirs)
+      const;
+
+  void edge_get_nodes_internal(const Entity_ID edgeid, Entity_ID *nodeid0,
+                               Entity_ID *nodeid1) const;
+
+ private:
+  void init_index_space_(int const dim, std::array<int, 3> const& ncells);
+  void init_entity_lists_();
+
+  // Decompose 'id' into indices in a box with extents 'ext'
+  static void ijk_of(Entity_ID const id, std::array<int, 3> const& ext,
+                     int ijk[3]) {
+    ijk[0] = id % ext[0];
+    ijk[1] = (id / ext[0]) % ext[1];
+    ijk[2] = id / (ext[0]*ext[1]);
+  }
+
+  // Edge along direction 'dir' whose lower node is (i,j,k) (3D only)
+  Entity_ID edge_id_(const int dir, const int ijk[3]) const {
+    std::array<int, 3> const& ext = edge_extents_[dir];
+    return edge_offset_[dir] + ijk[0] + ext[0]*(ijk[1] + ext[1]*ijk[2]);
+  }
+
+  // Edge connecting two nodes that differ in one index and the
+  // direction in which the edge is traversed going from n0 to n1
+  Entity_ID edge_between_(const Entity_ID n0, const Entity_ID n1,
+                          dir_t *edir) const;
+
+  // Sign of the face normal relative to the axis it is normal to
+  int face_sign_(const int dir) const { return (dir == 1) ? -1 : 1; }
+
+  // Number of cells and nodes along each direction (1 for unused ones)
+  std::array<int, 3> ncells_ = {{1, 1, 1}};
+  std::array<int, 3> nnodes_ = {{1, 1, 1}};
+
+  // Extents and starting IDs of each group of faces and edges
+  std::array<std::array<int, 3>, 3> face_extents_;
+  std::array<int, 3> face_offset_ = {{0, 0, 0}};
+  std::array<std::array<int, 3>, 3> edge_extents_;
+  std::array<int, 3> edge_offset_ = {{0, 0, 0}};
+
+  int num_cells_ = 0, num_nodes_ = 0, num_faces_ = 0, num_edges_ = 0;
+
+  // Node coordinates along each axis
+  std::array<std::vector<double>, 3> axis_coords_;
+
+  // Explicit node coordinates - empty until a node is moved
+  std::vector<double> coordinates_;
+};
+
+}  // close namespace Jali
+
+#endif /* _MESH_STRUCTURED_H_ */
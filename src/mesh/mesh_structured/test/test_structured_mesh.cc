@@ -0,0 +1,418 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "UnitTest++.h"
+
+#include "../Mesh_structured.hh"
+#include "Mesh_simple.hh"
+#include "MeshFactory.hh"
+
+// The structured framework uses the same numbering and conventions
+// as the Simple framework so the two meshes must be identical
+
+TEST(STRUCTURED_MESH_MATCHES_SIMPLE_3D) {
+  Jali::Mesh_structured smesh(0.0, 0.0, 0.0, 1.0, 2.0, 3.0, 3, 4, 5,
+                              MPI_COMM_WORLD);
+  Jali::Mesh_simple mesh(0.0, 0.0, 0.0, 1.0, 2.0, 3.0, 3, 4, 5,
+                         MPI_COMM_WORLD);
+
+  CHECK(smesh.mesh_type() == Jali::Mesh_type::RECTANGULAR);
+  CHECK_EQUAL(mesh.num_cells(), smesh.num_cells());
+  CHECK_EQUAL(mesh.num_faces(), smesh.num_faces());
+  CHECK_EQUAL(mesh.num_nodes(), smesh.num_nodes());
+
+  for (auto const c : mesh.cells()) {
+    Jali::Entity_ID_List cfaces, scfaces, cnodes, scnodes, adj, sadj;
+    std::vector<Jali::dir_t> cfdirs, scfdirs;
+    mesh.cell_get_faces_and_dirs(c, &cfaces, &cfdirs);
+    smesh.cell_get_faces_and_dirs(c, &scfaces, &scfdirs);
+    CHECK(cfaces == scfaces);
+    CHECK(cfdirs == scfdirs);
+
+    mesh.cell_get_nodes(c, &cnodes);
+    smesh.cell_get_nodes(c, &scnodes);
+    CHECK(cnodes == scnodes);
+
+    mesh.cell_get_face_adj_cells(c, Jali::Entity_type::ALL, &adj);
+    smesh.cell_get_face_adj_cells(c, Jali::Entity_type::ALL, &sadj);
+    CHECK(adj == sadj);
+
+    mesh.cell_get_node_adj_cells(c, Jali::Entity_type::ALL, &adj);
+    smesh.cell_get_node_adj_cells(c, Jali::Entity_type::ALL, &sadj);
+    std::sort(adj.begin(), adj.end());
+    CHECK(adj == sadj);
+
+    CHECK_CLOSE(mesh.cell_volume(c), smesh.cell_volume(c), 1.0e-12);
+    JaliGeometry::Point cen = mesh.cell_centroid(c);
+    JaliGeometry::Point scen = smesh.cell_centroid(c);
+    for (int d = 0; d < 3; d++)
+      CHECK_CLOSE(cen[d], scen[d], 1.0e-12);
+  }
+
+  for (auto const f : mesh.faces()) {
+    Jali::Entity_ID_List fcells, sfcells, fnodes, sfnodes;
+    mesh.face_get_cells(f, Jali::Entity_type::ALL, &fcells);
+    smesh.face_get_cells(f, Jali::Entity_type::ALL, &sfcells);
+    CHECK(fcells == sfcells);
+
+    mesh.face_get_nodes(f, &fnodes);
+    smesh.face_get_nodes(f, &sfnodes);
+    CHECK(fnodes == sfnodes);
+
+    CHECK_CLOSE(mesh.face_area(f), smesh.face_area(f), 1.0e-12);
+    JaliGeometry::Point normal = mesh.face_normal(f);
+    JaliGeometry::Point snormal = smesh.face_normal(f);
+    for (int d = 0; d < 3; d++)
+      CHECK_CLOSE(normal[d], snormal[d], 1.0e-12);
+  }
+
+  for (auto const n : mesh.nodes()) {
+    Jali::Entity_ID_List ncells, sncells;
+    mesh.node_get_cells(n, Jali::Entity_type::ALL, &ncells);
+    smesh.node_get_cells(n, Jali::Entity_type::ALL, &sncells);
+    std::sort(ncells.begin(), ncells.end());
+    std::sort(sncells.begin(), sncells.end());
+    CHECK(ncells == sncells);
+
+    JaliGeometry::Point p, sp;
+    mesh.node_get_coordinates(n, &p);
+    smesh.node_get_coordinates(n, &sp);
+    for (int d = 0; d < 3; d++)
+      CHECK_CLOSE(p[d], sp[d], 1.0e-12);
+  }
+}
+
+
+TEST(STRUCTURED_MESH_INDEX_SPACE) {
+  Jali::Mesh_structured mesh(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 3, 4, 5,
+                             MPI_COMM_WORLD);
+
+  CHECK_EQUAL(3, mesh.num_cells_along(0));
+  CHECK_EQUAL(4, mesh.num_cells_along(1));
+  CHECK_EQUAL(5, mesh.num_cells_along(2));
+
+  for (int k = 0; k < 5; k++)
+    for (int j = 0; j < 4; j++)
+      for (int i = 0; i < 3; i++) {
+        Jali::Entity_ID c = mesh.cell_id(i, j, k);
+        int ijk[3];
+        mesh.cell_get_ijk(c, ijk);
+        CHECK_EQUAL(i, ijk[0]);
+        CHECK_EQUAL(j, ijk[1]);
+        CHECK_EQUAL(k, ijk[2]);
+
+        // first node of the cell is its lower left node and the
+        // second face is the x-face on its hi side
+        Jali::Entity_ID_List cnodes, cfaces;
+        mesh.cell_get_nodes(c, &cnodes);
+        CHECK_EQUAL(mesh.node_id(i, j, k), cnodes[0]);
+        mesh.cell_get_faces(c, &cfaces);
+        CHECK_EQUAL(mesh.face_id(0, i+1, j, k), cfaces[1]);
+      }
+
+  for (auto const f : mesh.faces()) {
+    int ijk[3];
+    int dir = mesh.face_get_ijk(f, ijk);
+    CHECK_EQUAL(f, mesh.face_id(dir, ijk[0], ijk[1], ijk[2]));
+    JaliGeometry::Point normal = mesh.face_normal(f);
+    CHECK(std::fabs(normal[dir]) > 0.0);
+  }
+}
+
+
+TEST(STRUCTURED_MESH_EDGES_3D) {
+  Jali::Mesh_structured mesh(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 2, 3, 4,
+                             MPI_COMM_WORLD,
+                             (JaliGeometry::GeometricModelPtr) NULL,
+                             true, true);
+
+  CHECK_EQUAL(2*4*5 + 3*3*5 + 3*4*4, mesh.num_edges());
+
+  for (auto const e : mesh.edges()) {
+    Jali::Entity_ID n0, n1;
+    mesh.edge_get_nodes(e, &n0, &n1);
+    CHECK_CLOSE(mesh.edge_length(e), 1.0/(e < 40 ? 2 : (e < 85 ? 3 : 4)),
+                1.0e-12);
+  }
+
+  // The edges of a face form a closed loop through the face nodes
+  for (auto const f : mesh.faces()) {
+    Jali::Entity_ID_List fedges, fnodes;
+    std::vector<Jali::dir_t> fedirs;
+    mesh.face_get_edges_and_dirs(f, &fedges, &fedirs);
+    mesh.face_get_nodes(f, &fnodes);
+    CHECK_EQUAL(4, fedges.size());
+    for (int i = 0; i < 4; i++) {
+      Jali::Entity_ID n0, n1;
+      mesh.edge_get_nodes(fedges[i], &n0, &n1);
+      if (fedirs[i] == -1) std::swap(n0, n1);
+      CHECK_EQUAL(fnodes[i], n0);
+      CHECK_EQUAL(fnodes[(i+1)%4], n1);
+    }
+  }
+
+  for (auto const c : mesh.cells()) {
+    Jali::Entity_ID_List cedges;
+    mesh.cell_get_edges(c, &cedges);
+    CHECK_EQUAL(12, cedges.size());
+    std::sort(cedges.begin(), cedges.end());
+    CHECK(std::unique(cedges.begin(), cedges.end()) == cedges.end());
+  }
+}
+
+
+TEST(STRUCTURED_MESH_2D) {
+  Jali::Mesh_structured mesh(0.0, 0.0, 2.0, 1.0, 4, 2, MPI_COMM_WORLD,
+                             (JaliGeometry::GeometricModelPtr) NULL,
+                             true, true, true, true, true);
+
+  CHECK_EQUAL(2, mesh.space_dimension());
+  CHECK_EQUAL(8, mesh.num_cells());
+  CHECK_EQUAL(15, mesh.num_nodes());
+  CHECK_EQUAL(5*2 + 4*3, mesh.num_faces());
+  CHECK_EQUAL(mesh.num_faces(), mesh.num_edges());
+
+  for (auto const c : mesh.cells()) {
+    CHECK(mesh.cell_get_type(c) == Jali::Cell_type::QUAD);
+    CHECK_CLOSE(0.25, mesh.cell_volume(c), 1.0e-12);
+
+    // outward normals of a closed cell sum to zero
+    Jali::Entity_ID_List cfaces;
+    mesh.cell_get_faces(c, &cfaces);
+    CHECK_EQUAL(4, cfaces.size());
+    JaliGeometry::Point sum(0.0, 0.0);
+    for (auto const f : cfaces)
+      sum += mesh.face_normal(f, false, c);
+    CHECK_CLOSE(0.0, norm(sum), 1.0e-12);
+
+    // nodes are counter-clockwise
+    std::vector<JaliGeometry::Point> ccoords;
+    mesh.cell_get_coordinates(c, &ccoords);
+    double area2 = 0.0;
+    for (int i = 0; i < 4; i++) {
+      JaliGeometry::Point const& p0 = ccoords[i];
+      JaliGeometry::Point const& p1 = ccoords[(i+1)%4];
+      area2 += p0[0]*p1[1] - p1[0]*p0[1];
+    }
+    CHECK_CLOSE(0.5, area2, 1.0e-12);
+
+    // sides, wedges and corners tile the cell
+    double sidevol = 0.0, cornervol = 0.0;
+    for (auto const s : mesh.cell_get_sides_view(c))
+      sidevol += mesh.side_volume(s);
+    for (auto const cn : mesh.cell_get_corners_view(c))
+      cornervol += mesh.corner_volume(cn);
+    CHECK_CLOSE(0.25, sidevol, 1.0e-12);
+    CHECK_CLOSE(0.25, cornervol, 1.0e-12);
+  }
+
+  // interior node has 4 cells, corner node has 1
+  Jali::Entity_ID_List ncells;
+  mesh.node_get_cells(mesh.node_id(1, 1), Jali::Entity_type::ALL, &ncells);
+  CHECK_EQUAL(4, ncells.size());
+  mesh.node_get_cells(mesh.node_id(4, 2), Jali::Entity_type::ALL, &ncells);
+  CHECK_EQUAL(1, ncells.size());
+
+  Jali::Entity_ID_List nfaces;
+  mesh.node_get_faces(mesh.node_id(1, 1), Jali::Entity_type::ALL, &nfaces);
+  CHECK_EQUAL(4, nfaces.size());
+}
+
+
+TEST(STRUCTURED_MESH_MATCHES_SIMPLE_1D) {
+  std::vector<double> x = {0.0, 0.5, 1.5, 3.0, 5.0};
+  Jali::Mesh_structured smesh(x, MPI_COMM_WORLD);
+  Jali::Mesh_simple mesh(x, MPI_COMM_WORLD);
+
+  CHECK_EQUAL(mesh.num_cells(), smesh.num_cells());
+  CHECK_EQUAL(mesh.num_faces(), smesh.num_faces());
+
+  for (auto const c : mesh.cells()) {
+    Jali::Entity_ID_List cfaces, scfaces;
+    std::vector<Jali::dir_t> cfdirs, scfdirs;
+    mesh.cell_get_faces_and_dirs(c, &cfaces, &cfdirs);
+    smesh.cell_get_faces_and_dirs(c, &scfaces, &scfdirs);
+    CHECK(cfaces == scfaces);
+    CHECK(cfdirs == scfdirs);
+    CHECK_CLOSE(mesh.cell_volume(c), smesh.cell_volume(c), 1.0e-12);
+  }
+
+  for (auto const f : mesh.faces()) {
+    Jali::Entity_ID_List fcells, sfcells;
+    mesh.face_get_cells(f, Jali::Entity_type::ALL, &fcells);
+    smesh.face_get_cells(f, Jali::Entity_type::ALL, &sfcells);
+    CHECK(fcells == sfcells);
+  }
+}
+
+
+TEST(STRUCTURED_MESH_MOVE_NODES) {
+  Jali::Mesh_structured mesh(0.0, 0.0, 0.0, 2.0, 2.0, 2.0, 2, 2, 2,
+                             MPI_COMM_WORLD);
+
+  // move one domain boundary out as in the Simple mesh geometry test
+  for (int k = 0; k <= 2; k++)
+    for (int j = 0; j <= 2; j++) {
+      Jali::Entity_ID n = mesh.node_id(2, j, k);
+      mesh.node_set_coordinates(n, JaliGeometry::Point(3.0, 1.0*j, 1.0*k));
+    }
+  mesh.update_geometric_quantities();
+
+  for (int k = 0; k < 2; k++)
+    for (int j = 0; j < 2; j++) {
+      CHECK_CLOSE(1.0, mesh.cell_volume(mesh.cell_id(0, j, k)), 1.0e-12);
+      CHECK_CLOSE(2.0, mesh.cell_volume(mesh.cell_id(1, j, k)), 1.0e-12);
+    }
+
+  JaliGeometry::Point p;
+  mesh.node_get_coordinates(mesh.node_id(2, 1, 1), &p);
+  CHECK_CLOSE(3.0, p[0], 1.0e-12);
+  mesh.node_get_coordinates(mesh.node_id(1, 1, 1), &p);
+  CHECK_CLOSE(1.0, p[0], 1.0e-12);
+}
+
+
+TEST(STRUCTURED_MESH_FACTORY) {
+  CHECK(Jali::framework_available(Jali::Structured));
+  CHECK(Jali::framework_generates(Jali::Structured, false, 2));
+
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  mf.framework(Jali::Structured);
+  mf.included_entities(Jali::Entity_kind::ALL_KIND);
+
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 2, 2, 2);
+  CHECK(std::dynamic_pointer_cast<Jali::Mesh_structured>(mesh) != nullptr);
+  CHECK_EQUAL(8, mesh->num_cells());
+  CHECK_EQUAL(8*48, mesh->num_wedges());
+
+  double vol = 0.0;
+  for (auto const cn : mesh->corners())
+    vol += mesh->corner_volume(cn);
+  CHECK_CLOSE(1.0, vol, 1.0e-12);
+
+  mesh = mf(0.0, 0.0, 1.0, 1.0, 3, 3);
+  CHECK_EQUAL(9, mesh->num_cells());
+  CHECK_EQUAL(2, mesh->space_dimension());
+}
+
+
+// Adjacency lists and geometry of a structured mesh are computed from
+// the indices; only the views keep a copy of the topology
+
+TEST(STRUCTURED_MESH_IMPLICIT_TOPOLOGY) {
+  Jali::Mesh_structured smesh(0.0, 0.0, 0.0, 1.0, 2.0, 3.0, 3, 4, 5,
+                              MPI_COMM_WORLD,
+                              (JaliGeometry::GeometricModelPtr) NULL,
+                              true, true);
+  Jali::Mesh_simple mesh(0.0, 0.0, 0.0, 1.0, 2.0, 3.0, 3, 4, 5,
+                         MPI_COMM_WORLD);
+
+  std::vector<Jali::Mesh_cache> const topology =
+      {Jali::Mesh_cache::CELL2NODE, Jali::Mesh_cache::NODE2CELL,
+       Jali::Mesh_cache::CELL2FACE, Jali::Mesh_cache::FACE2CELL,
+       Jali::Mesh_cache::FACE2NODE, Jali::Mesh_cache::CELL2EDGE,
+       Jali::Mesh_cache::FACE2EDGE, Jali::Mesh_cache::EDGE2NODE};
+
+  for (auto const c : mesh.cells()) {
+    Jali::Entity_ID_List cfaces, scfaces, cedges;
+    std::vector<Jali::dir_t> cfdirs, scfdirs;
+    mesh.cell_get_faces_and_dirs(c, &cfaces, &cfdirs);
+    smesh.cell_get_faces_and_dirs(c, &scfaces, &scfdirs);
+    CHECK(cfaces == scfaces);
+    CHECK(cfdirs == scfdirs);
+    CHECK_EQUAL(6, smesh.cell_get_num_faces(c));
+
+    smesh.cell_get_edges(c, &cedges);
+    CHECK_EQUAL(12, cedges.size());
+
+    CHECK_CLOSE(mesh.cell_volume(c), smesh.cell_volume(c), 1.0e-12);
+  }
+
+  for (auto const f : mesh.faces()) {
+    Jali::Entity_ID_List fcells, sfcells, fedges;
+    std::vector<Jali::dir_t> fedirs;
+    mesh.face_get_cells(f, Jali::Entity_type::ALL, &fcells);
+    smesh.face_get_cells(f, Jali::Entity_type::ALL, &sfcells);
+    CHECK(fcells == sfcells);
+
+    smesh.face_get_edges_and_dirs(f, &fedges, &fedirs);
+    CHECK_EQUAL(4, fedges.size());
+
+    CHECK_CLOSE(mesh.face_area(f), smesh.face_area(f), 1.0e-12);
+    JaliGeometry::Point normal = mesh.face_normal(f);
+    JaliGeometry::Point snormal = smesh.face_normal(f);
+    for (int d = 0; d < 3; d++)
+      CHECK_CLOSE(normal[d], snormal[d], 1.0e-12);
+  }
+
+  for (auto const e : smesh.edges()) {
+    Jali::Entity_ID n0, n1;
+    smesh.edge_get_nodes(e, &n0, &n1);
+    CHECK(n0 != n1);
+    CHECK(smesh.edge_length(e) > 0.0);
+  }
+
+  std::map<Jali::Mesh_cache, std::size_t> report = smesh.memory_report();
+  for (auto const cache : topology)
+    CHECK_EQUAL(0, report[cache]);
+  CHECK(report[Jali::Mesh_cache::CELL_GEOMETRY] > 0);
+  CHECK(report[Jali::Mesh_cache::FACE_GEOMETRY] > 0);
+
+  // A view needs storage to point into, so it builds its cache
+  Jali::Entity_ID_View cnodes = smesh.cell_get_nodes_view(0);
+  CHECK_EQUAL(8, cnodes.size());
+  report = smesh.memory_report();
+  CHECK(report[Jali::Mesh_cache::CELL2NODE] > 0);
+  CHECK_EQUAL(0, report[Jali::Mesh_cache::FACE2EDGE]);
+}
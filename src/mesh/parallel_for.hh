@@ -0,0 +1,204 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+/*!
+ * @file   parallel_for.hh
+ * @brief  Minimal on-node threading layer used by mesh kernels
+ *
+ * The backend is chosen at configure time through Jali_THREAD_BACKEND
+ * which defines Jali_HAVE_OPENMP (OpenMP) or Jali_HAVE_STD_THREAD
+ * (std::thread). Without either, loops run serially on the calling
+ * thread.
+ */
+
+#ifndef _JALI_PARALLEL_FOR_HH_
+#define _JALI_PARALLEL_FOR_HH_
+
+#include <cstdlib>
+#include <algorithm>
+#include <exception>
+
+#if defined(Jali_HAVE_OPENMP)
+#include <omp.h>
+#elif defined(Jali_HAVE_STD_THREAD)
+#include <thread>
+#include <vector>
+#endif
+
+namespace Jali {
+
+namespace detail {
+
+// Number of threads requested through set_num_threads (0 means use
+// the backend default)
+
+inline int& requested_num_threads() {
+  static int nthreads = 0;
+  return nthreads;
+}
+
+// First index of block t when [0, n) is split into nthreads
+// contiguous blocks whose sizes differ by at most one
+
+inline int block_begin(int const t, int const n, int const nthreads) {
+  return t*(n/nthreads) + std::min(t, n%nthreads);
+}
+
+}  // namespace detail
+
+
+/*!
+  @brief Number of threads used by parallel_for
+
+  Defaults to omp_get_max_threads() for OpenMP and to the environment
+  variable JALI_NUM_THREADS or std::thread::hardware_concurrency() for
+  std::thread. Always 1 if no threading backend is enabled
+*/
+
+inline int num_threads() {
+#if defined(Jali_HAVE_OPENMP) || defined(Jali_HAVE_STD_THREAD)
+  int nthreads = detail::requested_num_threads();
+  if (nthreads > 0) return nthreads;
+#if defined(Jali_HAVE_OPENMP)
+  return omp_get_max_threads();
+#else
+  char const * const envstr = std::getenv("JALI_NUM_THREADS");
+  if (envstr && std::atoi(envstr) > 0)
+    return std::atoi(envstr);
+  return std::max(1u, std::thread::hardware_concurrency());
+#endif
+#else
+  return 1;
+#endif
+}
+
+//! Override the number of threads used by parallel_for (n <= 0
+//! restores the default)
+
+inline void set_num_threads(int const n) {
+  detail::requested_num_threads() = std::max(n, 0);
+}
+
+
+/*!
+  @brief Apply kernel to the index range [0, n) using on-node threads
+
+  @param n       Number of items
+  @param kernel  Callable as kernel(ibegin, iend, ithread); it is
+                 called once per thread with a contiguous block of
+                 indices. ithread is in [0, num_threads()) and can be
+                 used to pick per-thread scratch space
+  @param grain   Ranges with fewer than grain items per thread are
+                 processed with fewer threads
+
+  The index range is split statically into contiguous blocks, so the
+  assignment of items to threads depends only on n and the number of
+  threads. An exception thrown by the kernel is rethrown on the
+  calling thread after all threads finish.
+*/
+
+template<typename Kernel>
+void parallel_for(int const n, Kernel const& kernel, int const grain = 256) {
+  if (n <= 0) return;
+
+  int nthreads = std::min(num_threads(), std::max(1, n/std::max(grain, 1)));
+  if (nthreads == 1) {
+    kernel(0, n, 0);
+    return;
+  }
+
+  std::exception_ptr error = nullptr;
+
+#if defined(Jali_HAVE_OPENMP)
+#pragma omp parallel num_threads(nthreads)
+  {
+    // The runtime may give us fewer threads than requested, so each
+    // thread takes every nteam'th block
+
+    int const nteam = omp_get_num_threads();
+    for (int t = omp_get_thread_num(); t < nthreads; t += nteam) {
+      try {
+        kernel(detail::block_begin(t, n, nthreads),
+               detail::block_begin(t+1, n, nthreads), t);
+      } catch (...) {
+#pragma omp critical(jali_parallel_for_error)
+        if (!error) error = std::current_exception();
+      }
+    }
+  }
+#elif defined(Jali_HAVE_STD_THREAD)
+  std::vector<std::exception_ptr> errors(nthreads, nullptr);
+  std::vector<std::thread> workers;
+  workers.reserve(nthreads-1);
+  for (int t = 1; t < nthreads; t++)
+    workers.emplace_back([&, t]() {
+        try {
+          kernel(detail::block_begin(t, n, nthreads),
+                 detail::block_begin(t+1, n, nthreads), t);
+        } catch (...) {
+          errors[t] = std::current_exception();
+        }
+      });
+  try {
+    kernel(detail::block_begin(0, n, nthreads),
+           detail::block_begin(1, n, nthreads), 0);  // calling thread
+  } catch (...) {
+    errors[0] = std::current_exception();
+  }
+  for (auto& w : workers) w.join();
+  for (auto const& e : errors)
+    if (e) { error = e; break; }
+#endif
+
+  if (error) std::rethrow_exception(error);
+}
+
+}  // end namespace Jali
+
+#endif  /* _JALI_PARALLEL_FOR_HH_ */
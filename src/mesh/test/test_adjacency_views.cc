@@ -0,0 +1,346 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+/**
+ * @file   test_adjacency_views.cc
+ *
+ * @brief  Test compressed row storage of cached adjacencies and the
+ *         views (optionally restricted by parallel type) returned into it
+ *
+ */
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <algorithm>
+
+#include "Mesh.hh"
+#include "MeshFactory.hh"
+
+TEST(CSR_ARRAY) {
+  Jali::CSRArray<Jali::Entity_ID> csr;
+  CHECK_EQUAL(0, csr.num_rows());
+
+  // Rows appended in order
+
+  csr.append_row(std::vector<Jali::Entity_ID>({3, 4, 5}));
+  csr.append_row(std::vector<Jali::Entity_ID>());
+  csr.append_row(std::vector<Jali::Entity_ID>({7}));
+
+  CHECK_EQUAL(3, csr.num_rows());
+  CHECK_EQUAL(4, csr.num_entries());
+  CHECK_EQUAL(3, csr.row_size(0));
+  CHECK_EQUAL(0, csr.row_size(1));
+  CHECK(csr[1].empty());
+  CHECK_EQUAL(7, csr[2][0]);
+
+  Jali::Entity_ID_View row0 = csr[0];
+  int expected = 3;
+  for (auto const& e : row0)
+    CHECK_EQUAL(expected++, e);
+  CHECK_EQUAL(4, row0.slice(1, 2).front());
+  CHECK_EQUAL(5, row0.slice(1, 2).back());
+
+  // Rows sized upfront and filled out of order
+
+  std::vector<int> rowsizes = {2, 1, 3};
+  csr.set_row_sizes(rowsizes);
+  CHECK_EQUAL(3, csr.num_rows());
+  CHECK_EQUAL(6, csr.num_entries());
+  csr.row_data(2)[2] = 10;
+  csr.row_data(0)[0] = 11;
+  CHECK_EQUAL(11, csr[0][0]);
+  CHECK_EQUAL(10, csr[2][2]);
+  CHECK_EQUAL(0, csr[1][0]);
+
+  csr.clear();
+  CHECK_EQUAL(0, csr.num_rows());
+  CHECK_EQUAL(0, csr.num_entries());
+}
+
+
+// Check that the views of cached adjacencies match the lists
+// returned by the copying routines
+
+void check_adjacency_views(Jali::Mesh const& mesh) {
+  Jali::Entity_ID_List list;
+  std::vector<Jali::dir_t> dirs;
+  std::vector<Jali::Entity_type> ptypes = {Jali::Entity_type::PARALLEL_OWNED,
+                                           Jali::Entity_type::PARALLEL_GHOST,
+                                           Jali::Entity_type::BOUNDARY_GHOST};
+
+  for (auto const& c : mesh.cells()) {
+    mesh.cell_get_nodes(c, &list);
+    Jali::Entity_ID_View cnodes = mesh.cell_get_nodes_view(c);
+    CHECK_EQUAL(list.size(), cnodes.size());
+    CHECK_ARRAY_EQUAL(list, cnodes, list.size());
+
+    mesh.cell_get_faces_and_dirs(c, &list, &dirs);
+    Jali::Entity_ID_View cfaces = mesh.cell_get_faces_view(c);
+    Jali::Dir_View cfdirs = mesh.cell_get_face_dirs_view(c);
+    CHECK_EQUAL(list.size(), cfaces.size());
+    CHECK_EQUAL(mesh.cell_get_num_faces(c), cfaces.size());
+    CHECK_ARRAY_EQUAL(list, cfaces, list.size());
+    CHECK_ARRAY_EQUAL(dirs, cfdirs, dirs.size());
+
+    mesh.cell_get_edges(c, &list);
+    Jali::Entity_ID_View cedges = mesh.cell_get_edges_view(c);
+    CHECK_EQUAL(list.size(), cedges.size());
+    CHECK_ARRAY_EQUAL(list, cedges, list.size());
+
+    mesh.cell_get_sides(c, &list);
+    Jali::Entity_ID_View csides = mesh.cell_get_sides_view(c);
+    CHECK_EQUAL(list.size(), csides.size());
+    CHECK_ARRAY_EQUAL(list, csides, list.size());
+    for (auto const& s : csides)
+      CHECK_EQUAL(c, mesh.side_get_cell(s));
+
+    mesh.cell_get_corners(c, &list);
+    Jali::Entity_ID_View ccorners = mesh.cell_get_corners_view(c);
+    CHECK_EQUAL(list.size(), ccorners.size());
+    CHECK_ARRAY_EQUAL(list, ccorners, list.size());
+
+    for (auto const& cn : ccorners) {
+      mesh.corner_get_wedges(cn, &list);
+      Jali::Entity_ID_View cnwedges = mesh.corner_get_wedges_view(cn);
+      CHECK_EQUAL(list.size(), cnwedges.size());
+      CHECK_ARRAY_EQUAL(list, cnwedges, list.size());
+      for (auto const& w : cnwedges)
+        CHECK_EQUAL(cn, mesh.wedge_get_corner(w));
+    }
+  }
+
+  for (auto const& f : mesh.faces()) {
+    mesh.face_get_edges_and_dirs(f, &list, &dirs);
+    Jali::Entity_ID_View fedges = mesh.face_get_edges_view(f);
+    Jali::Dir_View fedirs = mesh.face_get_edge_dirs_view(f);
+    CHECK_EQUAL(list.size(), fedges.size());
+    CHECK_ARRAY_EQUAL(list, fedges, list.size());
+    CHECK_ARRAY_EQUAL(dirs, fedirs, dirs.size());
+
+    mesh.face_get_nodes(f, &list);
+    Jali::Entity_ID_View fnodes = mesh.face_get_nodes_view(f);
+    CHECK_EQUAL(list.size(), fnodes.size());
+    CHECK_ARRAY_EQUAL(list, fnodes, list.size());
+
+    for (auto const& type : {Jali::Entity_type::ALL,
+            Jali::Entity_type::PARALLEL_OWNED,
+            Jali::Entity_type::PARALLEL_GHOST}) {
+      mesh.face_get_cells(f, type, &list);
+      Jali::Entity_ID_View fcells = mesh.face_get_cells_view(f, type);
+      CHECK_EQUAL(list.size(), fcells.size());
+      CHECK_ARRAY_EQUAL(list, fcells, list.size());
+
+      // Position and direction of the face in each of its cells
+
+      Jali::Dir_View fcdirs = mesh.face_get_cell_dirs_view(f, type);
+      Jali::ArrayView<int> fcslots =
+          mesh.face_get_cell_local_indices_view(f, type);
+      CHECK_EQUAL(fcells.size(), fcdirs.size());
+      CHECK_EQUAL(fcells.size(), fcslots.size());
+      for (int i = 0; i < fcells.size(); i++) {
+        int c = fcells[i];
+        CHECK_EQUAL(f, mesh.cell_get_faces_view(c)[fcslots[i]]);
+        CHECK_EQUAL(mesh.cell_get_face_dirs_view(c)[fcslots[i]], fcdirs[i]);
+        CHECK_EQUAL(fcslots[i], mesh.face_get_local_index_in_cell(f, c));
+        CHECK_EQUAL(fcdirs[i], mesh.face_get_dir_in_cell(f, c));
+      }
+    }
+
+    // Cells not connected to the face
+
+    Jali::Entity_ID_View fcells = mesh.face_get_cells_view(f);
+    for (auto const& c : {0, 7}) {
+      if (std::find(fcells.begin(), fcells.end(), c) == fcells.end()) {
+        CHECK_EQUAL(-1, mesh.face_get_local_index_in_cell(f, c));
+        CHECK_EQUAL(0, mesh.face_get_dir_in_cell(f, c));
+      }
+    }
+    CHECK_EQUAL(-1, mesh.face_get_local_index_in_cell(f, -1));
+  }
+
+  for (auto const& n : mesh.nodes()) {
+    mesh.node_get_corners(n, Jali::Entity_type::ALL, &list);
+    Jali::Entity_ID_View ncorners = mesh.node_get_corners_view(n);
+    CHECK_EQUAL(list.size(), ncorners.size());
+    CHECK_ARRAY_EQUAL(list, ncorners, list.size());
+    for (auto const& cn : ncorners)
+      CHECK_EQUAL(n, mesh.corner_get_node(cn));
+
+    int nncorners = 0;
+    for (auto const& type : ptypes) {
+      ncorners = mesh.node_get_corners_view(n, type);
+      for (auto const& cn : ncorners)
+        CHECK_EQUAL(type, mesh.entity_get_type(Jali::Entity_kind::CORNER, cn));
+      nncorners += ncorners.size();
+    }
+    CHECK_EQUAL(list.size(), nncorners);
+
+    // Cells of a node are sorted by type in the view so compare sets
+
+    Jali::Entity_ID_List ncells_all;
+    mesh.node_get_cells(n, Jali::Entity_type::ALL, &ncells_all);
+    std::sort(ncells_all.begin(), ncells_all.end());
+
+    Jali::Entity_ID_View ncells = mesh.node_get_cells_view(n);
+    Jali::Entity_ID_List ncells_sorted = ncells.to_vector();
+    std::sort(ncells_sorted.begin(), ncells_sorted.end());
+    CHECK_EQUAL(ncells_all.size(), ncells_sorted.size());
+    CHECK_ARRAY_EQUAL(ncells_all, ncells_sorted, ncells_all.size());
+
+    int nncells = 0;
+    for (auto const& type : ptypes) {
+      ncells = mesh.node_get_cells_view(n, type);
+      for (auto const& c : ncells)
+        CHECK_EQUAL(type, mesh.entity_get_type(Jali::Entity_kind::CELL, c));
+      nncells += ncells.size();
+    }
+    CHECK_EQUAL(ncells_all.size(), nncells);
+  }
+}
+
+
+TEST(MESH_ADJACENCY_VIEWS_2D) {
+  if (!Jali::framework_available(Jali::MSTK)) return;
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::MSTK);
+  factory.included_entities({Jali::Entity_kind::EDGE, Jali::Entity_kind::FACE,
+          Jali::Entity_kind::SIDE, Jali::Entity_kind::WEDGE,
+          Jali::Entity_kind::CORNER});
+  std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 1.0, 1.0, 4, 4);
+  CHECK(mesh);
+
+  check_adjacency_views(*mesh);
+
+  for (auto const& c : mesh->cells()) {
+    Jali::Entity_ID_List cedges;
+    std::vector<Jali::dir_t> cedirs;
+    mesh->cell_2D_get_edges_and_dirs(c, &cedges, &cedirs);
+    Jali::Dir_View cedirs_view = mesh->cell_2D_get_edge_dirs_view(c);
+    CHECK_EQUAL(cedirs.size(), cedirs_view.size());
+    CHECK_ARRAY_EQUAL(cedirs, cedirs_view, cedirs.size());
+  }
+}
+
+
+TEST(MESH_ADJACENCY_VIEWS_3D) {
+  if (!Jali::framework_available(Jali::MSTK)) return;
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::MSTK);
+  factory.included_entities({Jali::Entity_kind::EDGE, Jali::Entity_kind::FACE,
+          Jali::Entity_kind::SIDE, Jali::Entity_kind::WEDGE,
+          Jali::Entity_kind::CORNER});
+  std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                             3, 3, 3);
+  CHECK(mesh);
+
+  check_adjacency_views(*mesh);
+}
+
+
+TEST(MESH_ADJACENCY_VIEWS_1D) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  if (!Jali::framework_generates(Jali::Simple, nproc > 1, 1)) return;
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::Simple);
+  factory.included_entities({Jali::Entity_kind::EDGE, Jali::Entity_kind::FACE,
+          Jali::Entity_kind::SIDE, Jali::Entity_kind::WEDGE,
+          Jali::Entity_kind::CORNER});
+  std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 1.0, 10);
+  CHECK(mesh);
+
+  check_adjacency_views(*mesh);
+}
+
+
+
+// The slot and direction of a face in each of its cells agree with
+// the face lists of the cells and with the orientation returned by
+// face_normal
+
+TEST(MESH_FACE_CELL_SLOTS_AND_DIRS) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  for (auto const& the_framework : frameworks) {
+    if (!Jali::framework_available(the_framework)) continue;
+    if (!Jali::framework_generates(the_framework, nproc > 1, 3)) continue;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                               3, 2, 2);
+    CHECK(mesh);
+
+    for (auto const& f : mesh->faces()) {
+      Jali::Entity_ID_View fcells = mesh->face_get_cells_view(f);
+      Jali::Dir_View fcdirs = mesh->face_get_cell_dirs_view(f);
+      Jali::ArrayView<int> fcslots = mesh->face_get_cell_local_indices_view(f);
+      CHECK_EQUAL(fcells.size(), fcdirs.size());
+      CHECK_EQUAL(fcells.size(), fcslots.size());
+      for (int i = 0; i < fcells.size(); i++) {
+        int c = fcells[i];
+        CHECK_EQUAL(f, mesh->cell_get_faces_view(c)[fcslots[i]]);
+        CHECK_EQUAL(mesh->cell_get_face_dirs_view(c)[fcslots[i]], fcdirs[i]);
+        CHECK_EQUAL(fcslots[i], mesh->face_get_local_index_in_cell(f, c));
+        CHECK_EQUAL(fcdirs[i], mesh->face_get_dir_in_cell(f, c));
+
+        int orientation = 0;
+        mesh->face_normal(f, false, c, &orientation);
+        CHECK_EQUAL(fcdirs[i], orientation);
+      }
+    }
+  }
+}
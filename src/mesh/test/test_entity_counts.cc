@@ -81,8 +81,9 @@ TEST(MESH_SETS_3D) {
 
   int dim = 3;
 
-  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
-  const char *framework_names[] = {"MSTK", "Simple"};
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple,
+                                              Jali::Structured};
+  const char *framework_names[] = {"MSTK", "Simple", "Structured"};
   const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
   Jali::MeshFramework_t the_framework;
   for (int i = 0; i < numframeworks; i++) {
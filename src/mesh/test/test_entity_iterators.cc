@@ -73,8 +73,9 @@ TEST(ENTITY_ITERATORS) {
   MPI_Comm_size(MPI_COMM_WORLD, &nproc);
   MPI_Comm_rank(MPI_COMM_WORLD, &me);
 
-  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
-  const char *framework_names[] = {"MSTK", "Simple"};
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple,
+                                              Jali::Structured};
+  const char *framework_names[] = {"MSTK", "Simple", "Structured"};
   const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
   Jali::MeshFramework_t the_framework;
   for (int i = 0; i < numframeworks; i++) {
@@ -0,0 +1,215 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+/**
+ * @file   test_geometric_partition.cc
+ *
+ * @brief  Test the built-in RCB and HILBERT partitioners of points and
+ *         of mesh tiles
+ *
+ */
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "Mesh.hh"
+#include "MeshTile.hh"
+#include "MeshFactory.hh"
+#include "geometric_partition.hh"
+#include "parallel_for.hh"
+
+namespace {
+
+// Total weight of each part
+
+std::vector<double> part_weights(std::vector<int> const& part,
+                                 std::vector<double> const& weights,
+                                 int const num_parts) {
+  std::vector<double> sum(num_parts, 0.0);
+  for (int i = 0; i < part.size(); i++)
+    sum[part[i]] += weights.empty() ? 1.0 : weights[i];
+  return sum;
+}
+
+}  // namespace
+
+
+TEST(GEOMETRIC_PARTITION_POINTS) {
+  // 20x10 grid of points; the right half is three times as costly
+
+  int const nx = 20, ny = 10, npoints = nx*ny;
+  std::vector<double> coords(2*npoints), weights(npoints);
+  for (int j = 0; j < ny; j++)
+    for (int i = 0; i < nx; i++) {
+      int const k = j*nx + i;
+      coords[2*k] = i + 0.5;
+      coords[2*k+1] = j + 0.5;
+      weights[k] = (i < nx/2) ? 1.0 : 3.0;
+    }
+
+  for (int num_parts : {1, 2, 5, 8}) {
+    std::vector<int> part;
+    Jali::rcb_partition(2, npoints, coords.data(), nullptr, num_parts, &part);
+    CHECK_EQUAL(npoints, part.size());
+    std::vector<double> sum = part_weights(part, {}, num_parts);
+    double const lo = *std::min_element(sum.begin(), sum.end());
+    double const hi = *std::max_element(sum.begin(), sum.end());
+    CHECK(lo > 0.0);
+    CHECK(hi - lo <= 1.0);  // point counts differ by at most one
+
+    // Weighted parts are of about equal weight, not size
+
+    Jali::rcb_partition(2, npoints, coords.data(), weights.data(), num_parts,
+                        &part);
+    sum = part_weights(part, weights, num_parts);
+    double const total = 2.0*npoints;
+    for (auto const& w : sum)
+      CHECK_CLOSE(total/num_parts, w, 3.0);
+
+    Jali::sfc_partition(Jali::Entity_ordering::HILBERT, 2, npoints,
+                        coords.data(), weights.data(), num_parts, &part);
+    sum = part_weights(part, weights, num_parts);
+    for (auto const& w : sum)
+      CHECK_CLOSE(total/num_parts, w, 3.0);
+  }
+
+  // With two parts the costly half is cut off from the cheap half
+  // plus one third of the costly half - i.e. at x = 40/3 or so
+
+  std::vector<int> part;
+  Jali::rcb_partition(2, npoints, coords.data(), weights.data(), 2, &part);
+  for (int k = 0; k < npoints; k++) {
+    if (coords[2*k] < 13.0) CHECK_EQUAL(part[0], part[k]);
+    if (coords[2*k] > 14.0) CHECK(part[k] != part[0]);
+  }
+
+  // The result does not depend on the number of threads
+
+  int const nthreads = Jali::num_threads();
+  std::vector<int> part1, part4;
+  Jali::set_num_threads(1);
+  Jali::rcb_partition(2, npoints, coords.data(), weights.data(), 7, &part1);
+  Jali::set_num_threads(4);
+  Jali::rcb_partition(2, npoints, coords.data(), weights.data(), 7, &part4);
+  Jali::set_num_threads(nthreads);
+  CHECK(part1 == part4);
+}
+
+
+TEST(GEOMETRIC_PARTITION_TILES) {
+  Jali::MeshFactory factory(MPI_COMM_SELF);
+  factory.framework(Jali::Simple);
+  factory.num_tiles(8);
+  factory.num_ghost_layers_tile(0);
+
+  for (auto const parttype : {Jali::Partitioner_type::RCB,
+          Jali::Partitioner_type::HILBERT}) {
+    factory.partitioner(parttype);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 6, 6, 6);
+    CHECK_EQUAL(8, mesh->num_tiles());
+
+    // Every owned cell is in exactly one tile and the tiles are of
+    // equal size
+
+    int const ncells = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+    std::vector<int> count(ncells, 0);
+    for (auto const& t : mesh->tiles()) {
+      CHECK_EQUAL(27, t->num_cells<Jali::Entity_type::PARALLEL_OWNED>());
+      for (auto const& c : t->cells<Jali::Entity_type::PARALLEL_OWNED>())
+        count[c]++;
+    }
+    for (int c = 0; c < ncells; c++)
+      CHECK_EQUAL(1, count[c]);
+
+    // RCB tiles of a 6x6x6 cube are 3x3x3 cubes
+
+    if (parttype == Jali::Partitioner_type::RCB) {
+      for (auto const& t : mesh->tiles()) {
+        JaliGeometry::Point lo(1.0, 1.0, 1.0), hi(0.0, 0.0, 0.0);
+        for (auto const& c : t->cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+          JaliGeometry::Point cen = mesh->cell_centroid(c);
+          for (int d = 0; d < 3; d++) {
+            lo[d] = std::min(lo[d], cen[d]);
+            hi[d] = std::max(hi[d], cen[d]);
+          }
+        }
+        for (int d = 0; d < 3; d++)
+          CHECK_CLOSE(1.0/3.0, hi[d] - lo[d], 1.0e-10);
+      }
+    }
+
+    // Rebuild the tiles with cells in the lower half (z < 0.5) seven
+    // times as costly as those in the upper half
+
+    std::vector<double> weights(ncells);
+    for (int c = 0; c < ncells; c++)
+      weights[c] = (mesh->cell_centroid(c)[2] < 0.5) ? 7.0 : 1.0;
+    mesh->rebuild_tiles(weights);
+    CHECK_EQUAL(8, mesh->num_tiles());
+
+    std::fill(count.begin(), count.end(), 0);
+    for (auto const& t : mesh->tiles()) {
+      double w = 0.0;
+      for (auto const& c : t->cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+        w += weights[c];
+        count[c]++;
+      }
+      CHECK_CLOSE(4.0*ncells/8, w, 7.0);
+    }
+    for (int c = 0; c < ncells; c++)
+      CHECK_EQUAL(1, count[c]);
+
+    CHECK_THROW(mesh->rebuild_tiles(std::vector<double>(3, 1.0)),
+                Errors::Message);
+  }
+}
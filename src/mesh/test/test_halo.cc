@@ -0,0 +1,287 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+/**
+ * @file   test_halo.cc
+ *
+ * @brief  Test the persistent ghost exchange plans (MeshHalo) and
+ *         batched non-blocking updates of ghost values (HaloUpdate)
+ *
+ */
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <vector>
+#include <memory>
+
+#include "errors.hh"
+#include "Mesh.hh"
+#include "MeshHalo.hh"
+#include "MeshFactory.hh"
+
+// Entities distributed as a chain - each rank owns 'n' consecutive
+// global IDs and has ghost copies of the last entity of the previous
+// rank and the first entity of the next rank
+
+TEST(HALO_FROM_LISTS) {
+  int nproc, me;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  MPI_Comm_rank(MPI_COMM_WORLD, &me);
+
+  int const n = 5;
+  std::vector<Jali::Entity_ID> owned(n), owned_gids(n);
+  for (int i = 0; i < n; i++) {
+    owned[i] = i;
+    owned_gids[i] = me*n + i;
+  }
+  std::vector<Jali::Entity_ID> ghost, ghost_gids;
+  if (me < nproc-1) {  // list the ghosts out of order on purpose
+    ghost.push_back(ghost.size() + n);
+    ghost_gids.push_back((me+1)*n);
+  }
+  if (me > 0) {
+    ghost.push_back(ghost.size() + n);
+    ghost_gids.push_back(me*n - 1);
+  }
+  int nall = n + ghost.size();
+
+  auto halo = std::make_shared<Jali::MeshHalo const>(Jali::Entity_kind::CELL,
+                                                     owned, owned_gids,
+                                                     ghost, ghost_gids,
+                                                     MPI_COMM_WORLD);
+
+  int nnbrs = (me > 0) + (me < nproc-1);
+  CHECK_EQUAL(nnbrs, halo->num_send_neighbors());
+  CHECK_EQUAL(nnbrs, halo->num_recv_neighbors());
+  for (int i = 0; i < halo->num_send_neighbors(); i++) {
+    CHECK_EQUAL(1, halo->send_entities(i).size());
+    int nbr = halo->send_neighbor(i);
+    CHECK_EQUAL(nbr < me ? 0 : n-1, halo->send_entities(i)[0]);
+  }
+
+  // Two fields of different types are exchanged in one update and
+  // the plan is reused for a second update
+
+  struct Vec3 { double x, y, z; };
+  std::vector<int> ivals(nall);
+  std::vector<Vec3> vvals(nall);
+
+  for (int iter = 0; iter < 2; iter++) {
+    for (int i = 0; i < n; i++) {
+      ivals[i] = owned_gids[i] + iter;
+      vvals[i] = {1.0*owned_gids[i], 2.0*owned_gids[i], 3.0*iter};
+    }
+    for (int i = n; i < nall; i++) {
+      ivals[i] = -1;
+      vvals[i] = {-1.0, -1.0, -1.0};
+    }
+
+    Jali::HaloUpdate update(halo);
+    update.add(ivals.data());
+    update.add(vvals.data());
+    update.start();
+    CHECK(update.in_progress());
+    update.finish();
+    CHECK(!update.in_progress());
+
+    for (int i = 0; i < ghost.size(); i++) {
+      int gid = ghost_gids[i];
+      CHECK_EQUAL(gid + iter, ivals[ghost[i]]);
+      CHECK_EQUAL(1.0*gid, vvals[ghost[i]].x);
+      CHECK_EQUAL(2.0*gid, vvals[ghost[i]].y);
+      CHECK_EQUAL(3.0*iter, vvals[ghost[i]].z);
+    }
+  }
+}
+
+
+// Ghost values of nodes and cells of a distributed mesh must be
+// those of their owners after an update
+
+TEST(MESH_HALO) {
+  int nproc, me;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  MPI_Comm_rank(MPI_COMM_WORLD, &me);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int fr = 0; fr < numframeworks; fr++) {
+
+    Jali::MeshFramework_t the_framework = frameworks[fr];
+    if (!Jali::framework_available(the_framework)) continue;
+    if (the_framework == Jali::Simple && nproc > 1) continue;
+
+    std::cerr << "Testing halo exchange with " << framework_names[fr] <<
+        std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    std::shared_ptr<Jali::Mesh> mesh;
+
+    int ierr = 0;
+    int aerr = 0;
+    try {
+      factory.framework(the_framework);
+      factory.included_entities({Jali::Entity_kind::FACE});
+      mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 4, 4, 4);
+    } catch (const Errors::Message& e) {
+      std::cerr << ": mesh error: " << e.what() << std::endl;
+      ierr++;
+    } catch (const std::exception& e) {
+      std::cerr << ": error: " << e.what() << std::endl;
+      ierr++;
+    }
+
+    MPI_Allreduce(&ierr, &aerr, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    CHECK_EQUAL(aerr, 0);
+
+    // Plans are built once per entity kind and reused
+
+    CHECK(mesh->halo(Jali::Entity_kind::CELL) ==
+          mesh->halo(Jali::Entity_kind::CELL));
+
+    Jali::Entity_kind const kinds[] = {Jali::Entity_kind::NODE,
+                                       Jali::Entity_kind::FACE,
+                                       Jali::Entity_kind::CELL};
+    for (auto kind : kinds) {
+      auto halo = mesh->halo(kind);
+      CHECK_EQUAL(kind, halo->kind());
+
+      int nowned = mesh->num_entities(kind, Jali::Entity_type::PARALLEL_OWNED);
+      int nall = mesh->num_entities(kind, Jali::Entity_type::ALL);
+
+      int nrecv = 0;
+      for (int i = 0; i < halo->num_recv_neighbors(); i++) {
+        CHECK(halo->recv_neighbor(i) != me);
+        for (auto const& g : halo->recv_entities(i)) {
+          CHECK(g >= nowned);
+          CHECK_EQUAL(Jali::Entity_type::PARALLEL_GHOST,
+                      mesh->entity_get_type(kind, g));
+        }
+        nrecv += halo->recv_entities(i).size();
+      }
+      CHECK_EQUAL(mesh->num_entities(kind, Jali::Entity_type::PARALLEL_GHOST),
+                  nrecv);
+      if (nproc == 1) {
+        CHECK_EQUAL(0, halo->num_send_neighbors());
+        CHECK_EQUAL(0, halo->num_recv_neighbors());
+      }
+
+      std::vector<double> values(nall, -1.0);
+      for (int i = 0; i < nall; i++)
+        if (mesh->entity_get_type(kind, i) == Jali::Entity_type::PARALLEL_OWNED)
+          values[i] = mesh->GID(i, kind);
+
+      Jali::HaloUpdate update(halo);
+      update.add(values.data());
+      update.start();
+      update.finish();
+
+      for (int i = 0; i < nall; i++)
+        CHECK_EQUAL(static_cast<double>(mesh->GID(i, kind)), values[i]);
+    }
+  }
+}
+
+
+// A field defined only on a subset of cells is exchanged using the
+// slots of the cells in the set
+
+TEST(MESH_HALO_SUBSET) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int fr = 0; fr < numframeworks; fr++) {
+
+    Jali::MeshFramework_t the_framework = frameworks[fr];
+    if (!Jali::framework_available(the_framework)) continue;
+    if (the_framework == Jali::Simple && nproc > 1) continue;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.included_entities({Jali::Entity_kind::FACE});
+    std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                               4, 4, 4);
+
+    // Cells whose global ID is even, including ghosts
+
+    std::vector<Jali::Entity_ID> setcells, setcells_owned;
+    for (auto const& c : mesh->cells()) {
+      if (mesh->GID(c, Jali::Entity_kind::CELL) % 2) continue;
+      setcells.push_back(c);
+      if (mesh->entity_get_type(Jali::Entity_kind::CELL, c) ==
+          Jali::Entity_type::PARALLEL_OWNED)
+        setcells_owned.push_back(c);
+    }
+    std::vector<Jali::Entity_ID> setcells_ghost(setcells.begin() +
+                                                setcells_owned.size(),
+                                                setcells.end());
+    std::shared_ptr<Jali::MeshSet> set =
+        Jali::make_meshset("evencells", *mesh, Jali::Entity_kind::CELL,
+                           setcells_owned, setcells_ghost);
+
+    std::vector<int> values(setcells.size(), -1);
+    for (int i = 0; i < setcells_owned.size(); i++)
+      values[i] = mesh->GID(setcells_owned[i], Jali::Entity_kind::CELL);
+
+    Jali::HaloUpdate update(mesh->halo(Jali::Entity_kind::CELL));
+    update.add(values.data(), set);
+    update.start();
+    update.finish();
+
+    for (int i = 0; i < setcells.size(); i++)
+      CHECK_EQUAL(mesh->GID(set->entities()[i], Jali::Entity_kind::CELL),
+                  values[i]);
+  }
+}
@@ -0,0 +1,187 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+/**
+ * @file   test_instrumentation.cc
+ *
+ * @brief  Test phase timers and counters on mesh construction and the
+ *         JSON report they produce
+ *
+ */
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "instrumentation.hh"
+#include "Mesh.hh"
+#include "MeshFactory.hh"
+
+TEST(INSTRUMENTATION_ENTRIES) {
+  Instrumentation::Entry& e = Instrumentation::entry("test::entry");
+  CHECK(&e == &Instrumentation::entry("test::entry"));
+
+  bool was_enabled = Instrumentation::enabled();
+
+  Instrumentation::enable(true);
+  Instrumentation::reset();
+  {
+    Instrumentation::ScopedTimer timer(e);
+    Instrumentation::count_bytes(e, 128);
+  }
+  CHECK_EQUAL(1, e.calls.load());
+  CHECK_EQUAL(128, e.bytes.load());
+  CHECK(e.nanoseconds.load() >= 0);
+
+  // Nothing is recorded when instrumentation is off
+
+  Instrumentation::enable(false);
+  {
+    Instrumentation::ScopedTimer timer(e);
+    Instrumentation::count(e, 10);
+    Instrumentation::count_bytes(e, 128);
+  }
+  CHECK_EQUAL(1, e.calls.load());
+  CHECK_EQUAL(128, e.bytes.load());
+
+  Instrumentation::reset();
+  CHECK_EQUAL(0, e.calls.load());
+  CHECK_EQUAL(0, e.bytes.load());
+  CHECK_EQUAL(0, e.nanoseconds.load());
+
+  Instrumentation::enable(was_enabled);
+}
+
+
+TEST(INSTRUMENTATION_REPORT) {
+  int rank, nprocs;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+  bool was_enabled = Instrumentation::enabled();
+  Instrumentation::enable(true);
+  Instrumentation::reset();
+
+  // Only rank 0 records this one - the report must still include it
+
+  if (rank == 0)
+    Instrumentation::count(Instrumentation::entry("test::rank0_only"), 2);
+  Instrumentation::count(Instrumentation::entry("test::all_ranks"), 3);
+
+  std::ostringstream os;
+  Instrumentation::report(MPI_COMM_WORLD, os);
+
+  if (rank == 0) {
+    std::string json = os.str();
+    std::ostringstream nprocs_str;
+    nprocs_str << "\"nprocs\": " << nprocs;
+    CHECK(json.find(nprocs_str.str()) != std::string::npos);
+    CHECK(json.find("\"test::rank0_only\"") != std::string::npos);
+    CHECK(json.find("\"test::all_ranks\"") != std::string::npos);
+    CHECK(json.find("\"seconds\"") != std::string::npos);
+    CHECK(json.find("\"bytes\"") != std::string::npos);
+  } else {
+    CHECK(os.str().empty());
+  }
+
+  Instrumentation::reset();
+  Instrumentation::enable(was_enabled);
+}
+
+
+#ifdef Jali_HAVE_INSTRUMENTATION
+
+TEST(INSTRUMENTATION_MESH_PHASES) {
+  // Simple meshes are serial - build one on each rank
+
+  Jali::MeshFactory mf(MPI_COMM_SELF);
+  mf.framework(Jali::Simple);
+
+  bool was_enabled = Instrumentation::enabled();
+  Instrumentation::enable(true);
+  Instrumentation::reset();
+
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 4, 4, 4);
+  CHECK(mesh);
+
+  // Mesh construction caches the adjacencies and computes the
+  // geometric quantities - each phase is timed once and reports the
+  // memory held by what it built
+
+  std::vector<std::string> phases = {"MeshFactory::create(3d)",
+                                     "Mesh::cache_cell2face_info",
+                                     "Mesh::cache_face2cell_info",
+                                     "Mesh::compute_cell_geometric_quantities"};
+  for (auto const& name : phases) {
+    Instrumentation::Entry& e = Instrumentation::entry(name);
+    CHECK_EQUAL(1, e.calls.load());
+    CHECK(e.nanoseconds.load() > 0);
+  }
+  CHECK(Instrumentation::entry("Mesh::cache_cell2face_info").bytes.load() >=
+        static_cast<long long>(6*64*sizeof(Jali::Entity_ID)));
+  CHECK(Instrumentation::entry("Mesh::compute_cell_geometric_quantities").
+        bytes.load() >= static_cast<long long>(64*sizeof(double)));
+
+  // Caches already built are not rebuilt (or recorded) again
+
+  std::vector<Jali::Entity_ID> cfaces;
+  mesh->cell_get_faces(0, &cfaces);
+  CHECK_EQUAL(1, Instrumentation::entry("Mesh::cache_cell2face_info").
+              calls.load());
+
+  Instrumentation::reset();
+  Instrumentation::enable(was_enabled);
+}
+
+#endif
@@ -450,8 +450,9 @@ TEST(MESH_GEOMETRY_SOLID) {
   MPI_Comm_size(MPI_COMM_WORLD, &nproc);
   MPI_Comm_rank(MPI_COMM_WORLD, &me);
 
-  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
-  const char *framework_names[] = {"MSTK", "Simple"};
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple,
+                                              Jali::Structured};
+  const char *framework_names[] = {"MSTK", "Simple", "Structured"};
   const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
   Jali::MeshFramework_t the_framework;
   for (int fr = 0; fr < numframeworks; fr++) {
@@ -715,3 +716,83 @@ TEST(MESH_GEOMETRY_SOLID) {
 
 }
 
+
+
+TEST(MESH_NODE_COORDINATE_ARRAYS) {
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple,
+                                              Jali::Structured};
+  const char *framework_names[] = {"MSTK", "Simple", "Structured"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int fr = 0; fr < numframeworks; fr++) {
+    if (!Jali::framework_available(frameworks[fr])) continue;
+    std::cerr << "Testing contiguous node coordinates with " <<
+        framework_names[fr] << std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(frameworks[fr]);
+    std::shared_ptr<Jali::Mesh> mesh =
+        factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 3, 3, 3);
+
+    int nnodes = mesh->num_entities(Jali::Entity_kind::NODE,
+                                    Jali::Entity_type::ALL);
+    int dim = mesh->space_dimension();
+
+    // Interleaved and structure-of-arrays coordinates agree with the
+    // framework
+
+    Jali::Coordinate_View xyz = mesh->node_coordinates();
+    CHECK_EQUAL(dim*nnodes, xyz.size());
+    for (int d = 0; d < dim; d++)
+      CHECK_EQUAL(nnodes, mesh->node_coordinates(d).size());
+
+    for (int n = 0; n < nnodes; n++) {
+      JaliGeometry::Point p;
+      mesh->node_get_coordinates(n, &p);
+      for (int d = 0; d < dim; d++) {
+        CHECK_EQUAL(p[d], xyz[dim*n+d]);
+        CHECK_EQUAL(p[d], mesh->node_coordinates(d)[n]);
+      }
+    }
+
+    // Moving nodes updates both arrays in place and the geometry
+    // computed from them
+
+    double cvol0 = 0.0;
+    for (auto const& c : mesh->cells())
+      cvol0 += mesh->cell_volume(c);
+
+    JaliGeometry::Point shift(0.01, 0.02, 0.03);
+    for (int n = 0; n < nnodes; n++) {
+      JaliGeometry::Point p;
+      mesh->node_get_coordinates(n, &p);
+      if (p[0] > 0.99) mesh->node_set_coordinates(n, p + shift);
+    }
+    mesh->update_geometric_quantities();
+
+    for (int n = 0; n < nnodes; n++) {
+      JaliGeometry::Point p;
+      mesh->node_get_coordinates(n, &p);
+      for (int d = 0; d < dim; d++) {
+        CHECK_EQUAL(p[d], mesh->node_coordinates()[dim*n+d]);
+        CHECK_EQUAL(p[d], mesh->node_coordinates(d)[n]);
+      }
+    }
+
+    double cvol1 = 0.0;
+    for (auto const& c : mesh->cells())
+      cvol1 += mesh->cell_volume(c);
+    CHECK_CLOSE(cvol0*1.01, cvol1, 1.0e-12);
+
+    for (auto const& c : mesh->cells()) {
+      std::vector<JaliGeometry::Point> ccoords;
+      mesh->cell_get_coordinates(c, &ccoords);
+      Jali::Entity_ID_List cnodes;
+      mesh->cell_get_nodes(c, &cnodes);
+      CHECK_EQUAL(cnodes.size(), ccoords.size());
+      for (int i = 0; i < cnodes.size(); i++)
+        for (int d = 0; d < dim; d++)
+          CHECK_EQUAL(mesh->node_coordinates(d)[cnodes[i]], ccoords[i][d]);
+    }
+  }
+}
@@ -0,0 +1,248 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+/**
+ * @file   test_mesh_memory.cc
+ *
+ * @brief  Test the memory report of the mesh caches, releasing caches
+ *         and evicting them under a memory budget
+ *
+ */
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Mesh.hh"
+#include "MeshFactory.hh"
+
+namespace {
+
+// Meshes with sides, wedges and corners
+
+std::vector<std::shared_ptr<Jali::Mesh>> make_meshes() {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  std::vector<std::shared_ptr<Jali::Mesh>> meshes;
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.included_entities({Jali::Entity_kind::EDGE, Jali::Entity_kind::FACE,
+          Jali::Entity_kind::CORNER});
+
+  if (Jali::framework_generates(Jali::MSTK, nproc > 1, 2)) {
+    factory.framework(Jali::MSTK);
+    meshes.push_back(factory(0.0, 0.0, 1.0, 1.0, 6, 6));
+  }
+  if (Jali::framework_generates(Jali::Simple, nproc > 1, 1)) {
+    factory.framework(Jali::Simple);
+    meshes.push_back(factory(0.0, 1.0, 20));
+  }
+  return meshes;
+}
+
+// Check that the answers of a mesh are the same as those of a mesh
+// with all its caches intact
+
+void check_same_answers(Jali::Mesh const& mesh, Jali::Mesh const& ref) {
+  for (auto const& c : ref.cells()) {
+    CHECK_CLOSE(ref.cell_volume(c), mesh.cell_volume(c), 1.0e-12);
+    Jali::Entity_ID_View reffaces = ref.cell_get_faces_view(c);
+    Jali::Entity_ID_View faces = mesh.cell_get_faces_view(c);
+    CHECK_ARRAY_EQUAL(reffaces.begin(), faces.begin(), reffaces.size());
+    Jali::Entity_ID_View refnodes = ref.cell_get_nodes_view(c);
+    Jali::Entity_ID_View nodes = mesh.cell_get_nodes_view(c);
+    CHECK_ARRAY_EQUAL(refnodes.begin(), nodes.begin(), refnodes.size());
+  }
+  for (auto const& f : ref.faces())
+    CHECK_CLOSE(ref.face_area(f), mesh.face_area(f), 1.0e-12);
+  for (auto const& s : ref.sides()) {
+    CHECK_EQUAL(ref.side_get_cell(s), mesh.side_get_cell(s));
+    CHECK_EQUAL(ref.side_get_node(s, 0), mesh.side_get_node(s, 0));
+    CHECK_EQUAL(ref.side_get_opposite_side(s),
+                mesh.side_get_opposite_side(s));
+    CHECK_CLOSE(ref.side_volume(s), mesh.side_volume(s), 1.0e-12);
+  }
+  for (auto const& w : ref.wedges())
+    CHECK_EQUAL(ref.wedge_get_corner(w), mesh.wedge_get_corner(w));
+  for (auto const& cn : ref.corners())
+    CHECK_CLOSE(ref.corner_volume(cn), mesh.corner_volume(cn), 1.0e-12);
+}
+
+}  // namespace
+
+
+TEST(MESH_MEMORY_REPORT_AND_RELEASE) {
+  std::vector<std::shared_ptr<Jali::Mesh>> refmeshes = make_meshes();
+  std::vector<std::shared_ptr<Jali::Mesh>> meshes = make_meshes();
+
+  for (int i = 0; i < meshes.size(); i++) {
+    Jali::Mesh& mesh = *(meshes[i]);
+
+    // Everything requested is built with the mesh
+
+    std::map<Jali::Mesh_cache, std::size_t> report = mesh.memory_report();
+    CHECK_EQUAL(Jali::NUM_MESH_CACHES, report.size());
+    std::size_t total = 0, side_total = 0;
+    for (auto const& kv : report) {
+      CHECK(kv.second > 0);
+      total += kv.second;
+      if (Jali::Mesh_cache_entity_kind(kv.first) == Jali::Entity_kind::SIDE)
+        side_total += kv.second;
+    }
+    CHECK_EQUAL(total, mesh.memory_size());
+    CHECK_EQUAL(side_total, mesh.memory_size(Jali::Entity_kind::SIDE));
+    CHECK_EQUAL(report[Jali::Mesh_cache::SIDE] +
+                report[Jali::Mesh_cache::SIDE_GEOMETRY], side_total);
+
+    // Releasing frees the memory (releasing wedges releases corners,
+    // which refer to them)
+
+    mesh.release(Jali::Mesh_cache::SIDE);
+    mesh.release(Jali::Mesh_cache::SIDE_GEOMETRY);
+    mesh.release(Jali::Mesh_cache::WEDGE);
+    mesh.release(Jali::Mesh_cache::CELL2FACE);
+    mesh.release(Jali::Mesh_cache::FACE_GEOMETRY);
+
+    report = mesh.memory_report();
+    CHECK_EQUAL(0, report[Jali::Mesh_cache::SIDE]);
+    CHECK_EQUAL(0, report[Jali::Mesh_cache::SIDE_GEOMETRY]);
+    CHECK_EQUAL(0, report[Jali::Mesh_cache::WEDGE]);
+    CHECK_EQUAL(0, report[Jali::Mesh_cache::CORNER]);
+    CHECK_EQUAL(0, report[Jali::Mesh_cache::CELL2FACE]);
+    CHECK_EQUAL(0, report[Jali::Mesh_cache::FACE_GEOMETRY]);
+    CHECK(report[Jali::Mesh_cache::CELL2NODE] > 0);
+    CHECK_EQUAL(0, mesh.memory_size(Jali::Entity_kind::SIDE));
+    CHECK(mesh.memory_size() < total);
+
+    // ... and the caches are rebuilt when they are queried
+
+    check_same_answers(mesh, *(refmeshes[i]));
+
+    report = mesh.memory_report();
+    CHECK(report[Jali::Mesh_cache::SIDE] > 0);
+    CHECK(report[Jali::Mesh_cache::CORNER] > 0);
+    CHECK(report[Jali::Mesh_cache::CELL2FACE] > 0);
+  }
+}
+
+
+TEST(MESH_MEMORY_BUDGET) {
+  std::vector<std::shared_ptr<Jali::Mesh>> refmeshes = make_meshes();
+  std::vector<std::shared_ptr<Jali::Mesh>> meshes = make_meshes();
+
+  for (int i = 0; i < meshes.size(); i++) {
+    Jali::Mesh& mesh = *(meshes[i]);
+
+    CHECK_EQUAL(0, mesh.memory_budget());
+
+    // Setting a budget evicts least recently used caches first. The
+    // cell to node adjacency was the first cache built with the mesh
+    // but querying it makes it the most recently used
+
+    for (auto const& c : mesh.cells())
+      mesh.cell_get_nodes_view(c);
+    std::size_t total = mesh.memory_size();
+    mesh.memory_budget(total-1);
+    CHECK_EQUAL(total-1, mesh.memory_budget());
+    std::map<Jali::Mesh_cache, std::size_t> report = mesh.memory_report();
+    CHECK(mesh.memory_size() < total);
+    CHECK(report[Jali::Mesh_cache::CELL2NODE] > 0);
+
+    // A budget too small for anything evicts everything ...
+
+    mesh.memory_budget(1);
+    CHECK_EQUAL(0, mesh.memory_size());
+
+    // Neither prepare() nor queries evict caches
+
+    mesh.prepare({Jali::Entity_kind::CORNER});
+    report = mesh.memory_report();
+    CHECK(report[Jali::Mesh_cache::CORNER] > 0);
+    for (auto const& c : mesh.cells())
+      mesh.cell_volume(c);
+    CHECK(mesh.memory_report()[Jali::Mesh_cache::CORNER] > 0);
+
+    // Trimming keeps the caches used since the budget was set (or
+    // since the last trim) ...
+
+    mesh.trim_caches();
+    report = mesh.memory_report();
+    CHECK(report[Jali::Mesh_cache::CELL_GEOMETRY] > 0);
+    CHECK(report[Jali::Mesh_cache::SIDE] > 0);
+    CHECK(report[Jali::Mesh_cache::WEDGE] > 0);
+    CHECK(report[Jali::Mesh_cache::CORNER] > 0);
+    CHECK(report[Jali::Mesh_cache::SIDE_GEOMETRY] > 0);
+    CHECK(report[Jali::Mesh_cache::CORNER_GEOMETRY] > 0);
+
+    // ... so a later phase working on cells evicts the subcell data
+    // of the previous phase but not the caches it queried
+
+    mesh.prepare({Jali::Entity_kind::CELL});
+    for (auto const& c : mesh.cells())
+      mesh.cell_get_faces_view(c);
+    mesh.trim_caches();
+    report = mesh.memory_report();
+    CHECK(report[Jali::Mesh_cache::CELL2FACE] > 0);
+    CHECK(report[Jali::Mesh_cache::CELL2NODE] > 0);
+    CHECK_EQUAL(0, report[Jali::Mesh_cache::SIDE]);
+    CHECK_EQUAL(0, report[Jali::Mesh_cache::CORNER]);
+    CHECK_EQUAL(0, report[Jali::Mesh_cache::SIDE_GEOMETRY]);
+
+    // Whatever was evicted comes back when it is needed
+
+    mesh.memory_budget(0);
+    check_same_answers(mesh, *(refmeshes[i]));
+  }
+}
@@ -0,0 +1,180 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+/**
+ * @file   test_mesh_prepare.cc
+ *
+ * @brief  Test building of cached mesh data on demand with
+ *         Mesh::prepare, including concurrent calls from several threads
+ *
+ */
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+#include "errors.hh"
+#include "Mesh.hh"
+#include "MeshFactory.hh"
+#include "parallel_for.hh"
+
+// Compare side, wedge and corner data of a mesh on which they were
+// built by prepare with a mesh on which they were requested upfront
+
+void check_same_sides_and_corners(Jali::Mesh const& mesh1,
+                                  Jali::Mesh const& mesh2) {
+  CHECK_EQUAL(mesh2.num_sides(), mesh1.num_sides());
+  CHECK_EQUAL(mesh2.num_wedges(), mesh1.num_wedges());
+  CHECK_EQUAL(mesh2.num_corners(), mesh1.num_corners());
+
+  for (auto const& s : mesh2.sides()) {
+    CHECK_EQUAL(mesh2.side_get_cell(s), mesh1.side_get_cell(s));
+    CHECK_EQUAL(mesh2.side_get_node(s, 0), mesh1.side_get_node(s, 0));
+    CHECK_EQUAL(mesh2.side_get_node(s, 1), mesh1.side_get_node(s, 1));
+    CHECK_EQUAL(mesh2.side_volume(s), mesh1.side_volume(s));
+  }
+  for (auto const& w : mesh2.wedges())
+    CHECK_EQUAL(mesh2.wedge_volume(w), mesh1.wedge_volume(w));
+  for (auto const& cn : mesh2.corners()) {
+    CHECK_EQUAL(mesh2.corner_get_node(cn), mesh1.corner_get_node(cn));
+    CHECK_EQUAL(mesh2.corner_volume(cn), mesh1.corner_volume(cn));
+  }
+}
+
+
+TEST(MESH_PREPARE_1D) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  if (!Jali::framework_generates(Jali::Simple, nproc > 1, 1)) return;
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::Simple);
+  factory.included_entities({Jali::Entity_kind::EDGE,
+          Jali::Entity_kind::FACE});
+  std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 1.0, 2000);
+  CHECK(mesh);
+
+  // Every thread asks for corners on the fresh mesh at the same time
+  // and then uses them right away
+
+  std::vector<double> cvol(mesh->num_cells(), 0.0);
+  Jali::parallel_for(mesh->num_cells(), [&](int cbegin, int cend, int) {
+      mesh->prepare({Jali::Entity_kind::CORNER});
+      for (int c = cbegin; c < cend; c++) {
+        Jali::Entity_ID_List ccorners;
+        mesh->cell_get_corners(c, &ccorners);
+        for (auto const& cn : ccorners)  // signed in 1D
+          cvol[c] += std::fabs(mesh->corner_volume(cn));
+      }
+    }, 16);
+
+  for (auto const& c : mesh->cells())
+    CHECK_CLOSE(mesh->cell_volume(c), cvol[c], 1.0e-12);
+
+  // Preparing again is a no-op
+
+  mesh->prepare({Jali::Entity_kind::SIDE, Jali::Entity_kind::CORNER});
+
+  Jali::MeshFactory factory2(MPI_COMM_WORLD);
+  factory2.framework(Jali::Simple);
+  factory2.included_entities({Jali::Entity_kind::EDGE,
+          Jali::Entity_kind::FACE, Jali::Entity_kind::CORNER});
+  std::shared_ptr<Jali::Mesh> mesh2 = factory2(0.0, 1.0, 2000);
+
+  check_same_sides_and_corners(*mesh, *mesh2);
+}
+
+
+TEST(MESH_PREPARE_2D) {
+  if (!Jali::framework_available(Jali::MSTK)) return;
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::MSTK);
+  factory.included_entities({Jali::Entity_kind::EDGE,
+          Jali::Entity_kind::FACE});
+  std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 1.0, 1.0, 20, 20);
+  CHECK(mesh);
+
+  Jali::parallel_for(mesh->num_cells(), [&](int cbegin, int cend, int) {
+      mesh->prepare({Jali::Entity_kind::CORNER});
+    }, 16);
+
+  Jali::MeshFactory factory2(MPI_COMM_WORLD);
+  factory2.framework(Jali::MSTK);
+  factory2.included_entities({Jali::Entity_kind::EDGE, Jali::Entity_kind::FACE,
+          Jali::Entity_kind::SIDE, Jali::Entity_kind::WEDGE,
+          Jali::Entity_kind::CORNER});
+  std::shared_ptr<Jali::Mesh> mesh2 = factory2(0.0, 0.0, 1.0, 1.0, 20, 20);
+
+  check_same_sides_and_corners(*mesh, *mesh2);
+}
+
+
+TEST(MESH_PREPARE_MISSING_ENTITIES) {
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::Simple);
+  factory.included_entities({Jali::Entity_kind::FACE});
+  std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                             2, 2, 2);
+  CHECK(mesh);
+
+  // Entities built into the mesh are always available
+
+  mesh->prepare({Jali::Entity_kind::NODE, Jali::Entity_kind::FACE,
+          Jali::Entity_kind::CELL});
+
+  // Edges cannot be added after the mesh is created and sides need them
+
+  CHECK_THROW(mesh->prepare({Jali::Entity_kind::EDGE}), Errors::Message);
+  CHECK_THROW(mesh->prepare({Jali::Entity_kind::SIDE}), Errors::Message);
+}
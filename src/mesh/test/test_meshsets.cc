@@ -66,8 +66,13 @@
 
 #include <mpi.h>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <string>
 
 #include "Mesh.hh"
+#include "MeshSet.hh"
 #include "MeshFactory.hh"
 #include "Point.hh"
 #include "BoxRegion.hh"
@@ -148,8 +153,9 @@ TEST(MESH_SETS_3D) {
   JaliGeometry::GeometricModel gm(dim, gregions);
     
 
-  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
-  const char *framework_names[] = {"MSTK", "Simple"};
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple,
+                                              Jali::Structured};
+  const char *framework_names[] = {"MSTK", "Simple", "Structured"};
   const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
   Jali::MeshFramework_t the_framework;
   for (int fr = 0; fr < numframeworks; fr++) {
@@ -504,8 +510,9 @@ TEST(MESH_SETS_3D_INIT) {
       {{"box1", {Jali::Entity_kind::CELL, Jali::Entity_kind::FACE}},
        {"plane2", {Jali::Entity_kind::NODE}}};
 
-  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
-  const char *framework_names[] = {"MSTK", "Simple"};
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple,
+                                              Jali::Structured};
+  const char *framework_names[] = {"MSTK", "Simple", "Structured"};
   const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
   Jali::MeshFramework_t the_framework;
   for (int i = 0; i < numframeworks; i++) {
@@ -1091,3 +1098,165 @@ TEST(MESH_SETS_LABELED_3D) {
     
   }
 }
+
+
+// Set operations on sparse sets (sorted and merged) and dense sets
+// (marked in a bitmap), with entities listed out of order, must match
+// a brute force evaluation
+
+TEST(MESH_SETS_ALGEBRA) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple,
+                                              Jali::Structured};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int fr = 0; fr < numframeworks; fr++) {
+    Jali::MeshFramework_t the_framework = frameworks[fr];
+    if (!Jali::framework_available(the_framework)) continue;
+    if (!Jali::framework_generates(the_framework, nproc > 1, 3)) continue;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                               10, 10, 10);
+
+    int nowned = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+    int nghost = mesh->num_cells<Jali::Entity_type::PARALLEL_GHOST>();
+
+    // Membership rules of the test sets
+
+    std::vector<std::function<bool(int)>> rules = {
+      [](int c) { return c % 2 == 0; },          // dense
+      [](int c) { return c % 3 == 0; },          // dense
+      [](int c) { return c % 97 == 5; },         // sparse
+      [](int c) { return c % 101 == 5; }};       // sparse
+
+    std::vector<std::shared_ptr<Jali::MeshSet>> sets;
+    for (int i = 0; i < rules.size(); i++) {
+      Jali::Entity_ID_List owned, ghost;
+      for (int c = nowned-1; c >= 0; c--)  // reverse order on purpose
+        if (rules[i](c)) owned.push_back(c);
+      for (int c = nowned+nghost-1; c >= nowned; c--)
+        if (rules[i](c)) ghost.push_back(c);
+      sets.push_back(Jali::make_meshset("set" + std::to_string(i), *mesh,
+                                        Jali::Entity_kind::CELL,
+                                        owned, ghost));
+    }
+
+    auto check_set = [&](std::shared_ptr<Jali::MeshSet> set,
+                         std::function<bool(int)> rule) {
+      Jali::Entity_ID_List expected;
+      for (int c = 0; c < nowned+nghost; c++)
+        if (rule(c)) expected.push_back(c);
+      auto const& entities = set->entities();
+      CHECK_EQUAL(expected.size(), entities.size());
+      if (expected.size() == entities.size())
+        CHECK_ARRAY_EQUAL(expected, entities, expected.size());
+    };
+
+    std::vector<std::vector<int>> combos = {{0, 1}, {2, 3}, {0, 2},
+                                            {2, 0}, {0, 1, 2, 3}};
+    for (auto const& combo : combos) {
+      std::vector<std::shared_ptr<Jali::MeshSet>> inpsets;
+      for (auto const& i : combo) inpsets.push_back(sets[i]);
+
+      auto in_any = [&](int c) {
+        for (auto const& i : combo) if (rules[i](c)) return true;
+        return false;
+      };
+      auto in_all = [&](int c) {
+        for (auto const& i : combo) if (!rules[i](c)) return false;
+        return true;
+      };
+      auto in_first_only = [&](int c) {
+        if (!rules[combo[0]](c)) return false;
+        for (int k = 1; k < combo.size(); k++)
+          if (rules[combo[k]](c)) return false;
+        return true;
+      };
+
+      check_set(Jali::merge(inpsets, true), in_any);
+      check_set(Jali::intersect(inpsets, true), in_all);
+      check_set(Jali::complement(inpsets, true),
+                [&](int c) { return !in_any(c); });
+      std::vector<std::shared_ptr<Jali::MeshSet>> rest(inpsets.begin()+1,
+                                                       inpsets.end());
+      check_set(Jali::subtract(inpsets[0], rest, true), in_first_only);
+    }
+  }
+}
+
+
+// Additions and removals queued on a set take effect on commit, which
+// keeps the order of the remaining entities and reports where they
+// came from
+
+TEST(MESH_SETS_STAGED_UPDATES) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple,
+                                              Jali::Structured};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int fr = 0; fr < numframeworks; fr++) {
+    Jali::MeshFramework_t the_framework = frameworks[fr];
+    if (!Jali::framework_available(the_framework)) continue;
+    if (!Jali::framework_generates(the_framework, nproc > 1, 3)) continue;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                               4, 4, 4);
+    int nowned = mesh->num_cells<Jali::Entity_type::PARALLEL_OWNED>();
+
+    for (bool reverse_map : {true, false}) {
+      Jali::Entity_ID_List owned = {9, 3, 7, 1, 5}, ghost;
+      std::shared_ptr<Jali::MeshSet> set =
+          Jali::make_meshset("staged", *mesh, Jali::Entity_kind::CELL,
+                             owned, ghost, reverse_map);
+
+      set->stage_rem_entities({7, 1, 7, 20});  // duplicate and non-member
+      set->stage_add_entities({11, 3, 11, 1});  // member and duplicate
+      CHECK(set->has_staged_changes());
+      CHECK_EQUAL(5, set->num_entities());  // nothing changes until commit
+
+      std::vector<int> new2old;
+      set->commit(&new2old);
+      CHECK(!set->has_staged_changes());
+
+      // 1 is removed and added back so it goes to the end
+
+      Jali::Entity_ID_List expected = {9, 3, 5, 11, 1};
+      std::vector<int> expected_new2old = {0, 1, 4, -1, -1};
+      auto const& entities = set->entities();
+      CHECK_EQUAL(expected.size(), entities.size());
+      CHECK_EQUAL(expected.size(), new2old.size());
+      if (expected.size() == entities.size() &&
+          expected.size() == new2old.size()) {
+        CHECK_ARRAY_EQUAL(expected, entities, expected.size());
+        CHECK_ARRAY_EQUAL(expected_new2old, new2old, expected.size());
+      }
+      for (int i = 0; i < expected.size(); i++)
+        CHECK_EQUAL(i, set->index_in_set(expected[i]));
+      CHECK_EQUAL(-1, set->index_in_set(7));
+
+      // Immediate updates (rem_entity moves the last owned entity
+      // into the place of the removed one)
+
+      set->rem_entity(3);
+      set->add_entity(nowned-1);
+      set->add_entity(5);  // already in set
+      set->rem_entity(20);  // not in set
+      set->rem_entities({9, 11});
+      set->add_entities({2, 2});
+      expected = {1, 5, nowned-1, 2};
+      auto const& entities2 = set->entities<Jali::Entity_type::PARALLEL_OWNED>();
+      CHECK_EQUAL(expected.size(), entities2.size());
+      if (expected.size() == entities2.size())
+        CHECK_ARRAY_EQUAL(expected, entities2, expected.size());
+      for (int i = 0; i < expected.size(); i++)
+        CHECK_EQUAL(i, set->index_in_set(expected[i]));
+    }
+  }
+}
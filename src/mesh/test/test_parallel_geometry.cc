@@ -0,0 +1,245 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+/**
+ * @file   test_parallel_geometry.cc
+ *
+ * @brief  Test the on-node threading layer and check that geometric
+ *         quantities do not depend on the number of threads used to
+ *         compute them
+ *
+ */
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+
+#include "Mesh.hh"
+#include "MeshFactory.hh"
+#include "parallel_for.hh"
+
+TEST(PARALLEL_FOR) {
+  int const n = 10007;
+  int const nthreads = Jali::num_threads();
+  CHECK(nthreads >= 1);
+
+  // Every index is visited exactly once and thread ids are in range
+
+  std::vector<int> count(n, 0);
+  std::vector<int> owner(n, -1);
+  Jali::parallel_for(n, [&](int ibegin, int iend, int ithread) {
+      for (int i = ibegin; i < iend; i++) {
+        count[i]++;
+        owner[i] = ithread;
+      }
+    }, 16);
+
+  for (int i = 0; i < n; i++) {
+    CHECK_EQUAL(1, count[i]);
+    CHECK(owner[i] >= 0 && owner[i] < nthreads);
+  }
+
+  // Blocks are contiguous and in thread order
+
+  for (int i = 1; i < n; i++)
+    CHECK(owner[i-1] <= owner[i]);
+
+  // Exceptions thrown in a kernel reach the caller
+
+  CHECK_THROW(Jali::parallel_for(n, [&](int ibegin, int iend, int ithread) {
+        if (ibegin <= n/2 && n/2 < iend)
+          throw std::runtime_error("kernel failure");
+      }, 16), std::runtime_error);
+
+  // Empty range never calls the kernel
+
+  bool called = false;
+  Jali::parallel_for(0, [&](int ibegin, int iend, int ithread) {
+      called = true;
+    });
+  CHECK(!called);
+}
+
+
+// Geometric quantities of a mesh computed by a given number of threads
+
+struct Mesh_geometry {
+  std::vector<double> cell_volumes, face_areas, side_volumes, corner_volumes;
+  std::vector<JaliGeometry::Point> cell_centroids, face_centroids,
+    face_normals, side_normals;
+};
+
+Mesh_geometry compute_geometry(Jali::Mesh& mesh, int nthreads) {
+  Jali::set_num_threads(nthreads);
+  mesh.update_geometric_quantities();
+  Jali::set_num_threads(0);
+
+  Mesh_geometry geom;
+  for (auto const& c : mesh.cells()) {
+    geom.cell_volumes.push_back(mesh.cell_volume(c));
+    geom.cell_centroids.push_back(mesh.cell_centroid(c));
+  }
+  for (auto const& f : mesh.faces()) {
+    geom.face_areas.push_back(mesh.face_area(f));
+    geom.face_centroids.push_back(mesh.face_centroid(f));
+    geom.face_normals.push_back(mesh.face_normal(f));
+  }
+  for (auto const& s : mesh.sides()) {
+    geom.side_volumes.push_back(mesh.side_volume(s));
+    geom.side_normals.push_back(mesh.side_facet_normal(s));
+  }
+  for (auto const& cn : mesh.corners())
+    geom.corner_volumes.push_back(mesh.corner_volume(cn));
+  return geom;
+}
+
+// Results must be bitwise identical, not just close
+
+void check_same_geometry(Mesh_geometry const& g1, Mesh_geometry const& g2,
+                         int dim) {
+  CHECK_ARRAY_EQUAL(g1.cell_volumes, g2.cell_volumes, g1.cell_volumes.size());
+  CHECK_ARRAY_EQUAL(g1.face_areas, g2.face_areas, g1.face_areas.size());
+  CHECK_ARRAY_EQUAL(g1.side_volumes, g2.side_volumes, g1.side_volumes.size());
+  CHECK_ARRAY_EQUAL(g1.corner_volumes, g2.corner_volumes,
+                    g1.corner_volumes.size());
+  for (int i = 0; i < g1.cell_centroids.size(); i++)
+    for (int d = 0; d < dim; d++)
+      CHECK_EQUAL(g1.cell_centroids[i][d], g2.cell_centroids[i][d]);
+  for (int i = 0; i < g1.face_centroids.size(); i++)
+    for (int d = 0; d < dim; d++) {
+      CHECK_EQUAL(g1.face_centroids[i][d], g2.face_centroids[i][d]);
+      CHECK_EQUAL(g1.face_normals[i][d], g2.face_normals[i][d]);
+    }
+  for (int i = 0; i < g1.side_normals.size(); i++)
+    for (int d = 0; d < dim; d++)
+      CHECK_EQUAL(g1.side_normals[i][d], g2.side_normals[i][d]);
+}
+
+
+TEST(MESH_PARALLEL_GEOMETRY_1D) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  if (!Jali::framework_generates(Jali::Simple, nproc > 1, 1)) return;
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::Simple);
+  factory.included_entities({Jali::Entity_kind::EDGE, Jali::Entity_kind::FACE,
+          Jali::Entity_kind::SIDE, Jali::Entity_kind::WEDGE,
+          Jali::Entity_kind::CORNER});
+  std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 1.0, 5000);
+  CHECK(mesh);
+
+  Mesh_geometry g1 = compute_geometry(*mesh, 1);
+  Mesh_geometry g4 = compute_geometry(*mesh, 4);
+  check_same_geometry(g1, g4, 1);
+
+  // Recomputing must overwrite, not append to, the stored quantities
+
+  for (auto const& s : mesh->sides()) {
+    JaliGeometry::Point n0 = mesh->side_facet_normal(s);
+    JaliGeometry::Point n1 = mesh->side_facet_normal(s, true);
+    CHECK_EQUAL(n1[0], n0[0]);
+  }
+}
+
+
+TEST(MESH_PARALLEL_GEOMETRY_2D) {
+  if (!Jali::framework_available(Jali::MSTK)) return;
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::MSTK);
+  factory.included_entities({Jali::Entity_kind::EDGE, Jali::Entity_kind::FACE,
+          Jali::Entity_kind::SIDE, Jali::Entity_kind::WEDGE,
+          Jali::Entity_kind::CORNER});
+  std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 1.0, 1.0, 40, 40);
+  CHECK(mesh);
+
+  Mesh_geometry g1 = compute_geometry(*mesh, 1);
+  Mesh_geometry g4 = compute_geometry(*mesh, 4);
+  check_same_geometry(g1, g4, 2);
+}
+
+
+TEST(MESH_PARALLEL_GEOMETRY_3D) {
+  Jali::MeshFramework_t frameworks[2] = {Jali::MSTK, Jali::Simple};
+
+  for (int i = 0; i < 2; i++) {
+    if (!Jali::framework_available(frameworks[i])) continue;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(frameworks[i]);
+    if (frameworks[i] == Jali::MSTK)
+      factory.included_entities({Jali::Entity_kind::EDGE,
+              Jali::Entity_kind::FACE, Jali::Entity_kind::SIDE,
+              Jali::Entity_kind::WEDGE, Jali::Entity_kind::CORNER});
+    else
+      factory.included_entities({Jali::Entity_kind::FACE});
+    std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                               12, 12, 12);
+    CHECK(mesh);
+
+    // Perturb the nodes so that cells are not all identical
+
+    for (auto const& n : mesh->nodes()) {
+      JaliGeometry::Point xyz;
+      mesh->node_get_coordinates(n, &xyz);
+      double dx = 0.01*((n*7919) % 13)/13.0;
+      double newxyz[3] = {xyz[0] + dx, xyz[1] - dx, xyz[2] + 0.5*dx};
+      mesh->node_set_coordinates(n, newxyz);
+    }
+
+    Mesh_geometry g1 = compute_geometry(*mesh, 1);
+    Mesh_geometry g4 = compute_geometry(*mesh, 4);
+    check_same_geometry(g1, g4, 3);
+  }
+}
@@ -0,0 +1,433 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+/**
+ * @file   test_reorder.cc
+ *
+ * @brief  Test locality-improving orderings of points and graphs and
+ *         renumbering of mesh entities with them
+ *
+ */
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+
+#include "errors.hh"
+#include "Mesh.hh"
+#include "MeshFactory.hh"
+#include "entity_ordering.hh"
+
+namespace {
+
+// Is 'order' a permutation of 0..n-1?
+
+bool is_permutation(std::vector<int> const& order, int const n) {
+  if (order.size() != n) return false;
+  std::vector<int> sorted(order);
+  std::sort(sorted.begin(), sorted.end());
+  for (int i = 0; i < n; i++)
+    if (sorted[i] != i) return false;
+  return true;
+}
+
+// Bandwidth of the adjacency matrix of a graph with vertices
+// renumbered so that new vertex k is old vertex order[k]
+
+int bandwidth(std::vector<int> const& offsets,
+              std::vector<int> const& adjacency,
+              std::vector<int> const& order) {
+  int n = offsets.size()-1;
+  std::vector<int> newid(n);
+  for (int k = 0; k < n; k++)
+    newid[order[k]] = k;
+  int bw = 0;
+  for (int v = 0; v < n; v++)
+    for (int j = offsets[v]; j < offsets[v+1]; j++)
+      bw = std::max(bw, std::abs(newid[v]-newid[adjacency[j]]));
+  return bw;
+}
+
+// Average number of distinct nodes used by runs of 'window'
+// consecutively numbered cells - the fewer nodes, the fewer cache
+// lines a loop over the cells touches when it gathers node data
+
+double mean_nodes_per_window(Jali::Mesh const& mesh, int const window) {
+  int ncells = mesh.num_cells();
+  int nwindows = ncells/window;
+  double sum = 0.0;
+  for (int w = 0; w < nwindows; w++) {
+    std::vector<int> wnodes;
+    for (int c = w*window; c < (w+1)*window; c++) {
+      Jali::Entity_ID_List cnodes;
+      mesh.cell_get_nodes(c, &cnodes);
+      wnodes.insert(wnodes.end(), cnodes.begin(), cnodes.end());
+    }
+    std::sort(wnodes.begin(), wnodes.end());
+    sum += std::unique(wnodes.begin(), wnodes.end()) - wnodes.begin();
+  }
+  return sum/nwindows;
+}
+
+}  // namespace
+
+
+TEST(SFC_ORDER) {
+  // Points of a n x n grid in scrambled order
+
+  int const n = 8;
+  std::vector<std::array<int, 2>> ij;
+  for (int i = 0; i < n; i++)
+    for (int j = 0; j < n; j++)
+      ij.push_back({i, j});
+  std::mt19937 gen(42);
+  std::shuffle(ij.begin(), ij.end(), gen);
+  std::vector<double> coords;
+  for (auto const& p : ij) {
+    coords.push_back(p[0]*0.25);
+    coords.push_back(p[1]*0.25);
+  }
+
+  // Consecutive points along a Hilbert curve through a 2^k x 2^k
+  // grid are neighbors
+
+  std::vector<int> order;
+  Jali::sfc_order(Jali::Entity_ordering::HILBERT, 2, n*n, coords.data(),
+                  &order);
+  CHECK(is_permutation(order, n*n));
+  for (int k = 1; k < n*n; k++) {
+    auto const& p0 = ij[order[k-1]];
+    auto const& p1 = ij[order[k]];
+    CHECK_EQUAL(1, std::abs(p0[0]-p1[0]) + std::abs(p0[1]-p1[1]));
+  }
+
+  // A Morton curve visits each 2 x 2 block of the grid in turn
+
+  Jali::sfc_order(Jali::Entity_ordering::MORTON, 2, n*n, coords.data(),
+                  &order);
+  CHECK(is_permutation(order, n*n));
+  for (int k = 0; k < n*n; k += 4) {
+    auto const& p0 = ij[order[k]];
+    CHECK(p0[0] % 2 == 0 && p0[1] % 2 == 0);
+    for (int l = 1; l < 4; l++) {
+      auto const& p = ij[order[k+l]];
+      CHECK_EQUAL(p0[0]/2, p[0]/2);
+      CHECK_EQUAL(p0[1]/2, p[1]/2);
+    }
+  }
+
+  // Same for a Hilbert curve through a 3D grid
+
+  int const m = 4;
+  std::vector<std::array<int, 3>> ijk;
+  for (int i = 0; i < m; i++)
+    for (int j = 0; j < m; j++)
+      for (int k = 0; k < m; k++)
+        ijk.push_back({i, j, k});
+  std::shuffle(ijk.begin(), ijk.end(), gen);
+  coords.clear();
+  for (auto const& p : ijk)
+    for (int d = 0; d < 3; d++)
+      coords.push_back(1.0 + 3.0*p[d]);
+
+  Jali::sfc_order(Jali::Entity_ordering::HILBERT, 3, m*m*m, coords.data(),
+                  &order);
+  CHECK(is_permutation(order, m*m*m));
+  for (int k = 1; k < m*m*m; k++) {
+    auto const& p0 = ijk[order[k-1]];
+    auto const& p1 = ijk[order[k]];
+    CHECK_EQUAL(1, (std::abs(p0[0]-p1[0]) + std::abs(p0[1]-p1[1]) +
+                    std::abs(p0[2]-p1[2])));
+  }
+}
+
+
+TEST(RCM_ORDER) {
+  // Graph of a nx x ny grid with randomly numbered vertices plus an
+  // isolated vertex (a second component)
+
+  int const nx = 20, ny = 5, n = nx*ny+1;
+  std::vector<int> label(n);
+  std::iota(label.begin(), label.end(), 0);
+  std::mt19937 gen(7);
+  std::shuffle(label.begin(), label.end(), gen);
+
+  std::vector<std::vector<int>> nbrs(n);
+  for (int i = 0; i < nx; i++)
+    for (int j = 0; j < ny; j++) {
+      int v = label[i*ny+j];
+      if (i > 0) nbrs[v].push_back(label[(i-1)*ny+j]);
+      if (i < nx-1) nbrs[v].push_back(label[(i+1)*ny+j]);
+      if (j > 0) nbrs[v].push_back(label[i*ny+j-1]);
+      if (j < ny-1) nbrs[v].push_back(label[i*ny+j+1]);
+    }
+  std::vector<int> offsets(1, 0), adjacency;
+  for (auto const& vnbrs : nbrs) {
+    adjacency.insert(adjacency.end(), vnbrs.begin(), vnbrs.end());
+    offsets.push_back(adjacency.size());
+  }
+
+  std::vector<int> identity(n);
+  std::iota(identity.begin(), identity.end(), 0);
+  int bw0 = bandwidth(offsets, adjacency, identity);
+
+  std::vector<int> order;
+  Jali::rcm_order(offsets, adjacency, &order);
+  CHECK(is_permutation(order, n));
+
+  // RCM starts from a corner of the grid and sweeps along its long
+  // direction in diagonal fronts that are at most ny vertices wide
+
+  int bw = bandwidth(offsets, adjacency, order);
+  CHECK(bw <= 2*ny);
+  CHECK(bw < bw0);
+}
+
+
+TEST(MESH_REORDER) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+
+  const Jali::Entity_ordering orderings[] = {Jali::Entity_ordering::MORTON,
+                                             Jali::Entity_ordering::HILBERT,
+                                             Jali::Entity_ordering::RCM};
+
+  for (int fr = 0; fr < numframeworks; fr++) {
+    Jali::MeshFramework_t the_framework = frameworks[fr];
+    if (!Jali::framework_available(the_framework)) continue;
+    if (!Jali::framework_generates(the_framework, nproc > 1, 3)) continue;
+
+    std::cerr << "Testing entity reordering with " << framework_names[fr] <<
+        "\n";
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    std::shared_ptr<Jali::Mesh> refmesh = factory(0.0, 0.0, 0.0,
+                                                  1.0, 1.0, 1.0, 8, 8, 8);
+    CHECK(refmesh);
+    CHECK(refmesh->entity_new_to_old(Jali::Entity_kind::CELL).empty());
+    double refnodes = mean_nodes_per_window(*refmesh, 8);
+
+    for (auto const& ordering : orderings) {
+      factory.ordering(ordering);
+      std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 0.0,
+                                                 1.0, 1.0, 1.0, 8, 8, 8);
+      CHECK(mesh);
+
+      std::vector<int> const& cell_new2old =
+          mesh->entity_new_to_old(Jali::Entity_kind::CELL);
+      std::vector<int> const& face_new2old =
+          mesh->entity_new_to_old(Jali::Entity_kind::FACE);
+      std::vector<int> const& node_new2old =
+          mesh->entity_new_to_old(Jali::Entity_kind::NODE);
+      CHECK(is_permutation(cell_new2old, mesh->num_cells()));
+      CHECK(is_permutation(face_new2old, mesh->num_faces()));
+      CHECK(is_permutation(node_new2old, mesh->num_nodes()));
+
+      // Entities are renumbered only among entities of the same type
+
+      for (auto const& c : mesh->cells())
+        CHECK(mesh->entity_get_type(Jali::Entity_kind::CELL, c) ==
+              refmesh->entity_get_type(Jali::Entity_kind::CELL,
+                                       cell_new2old[c]));
+      for (auto const& n : mesh->nodes())
+        CHECK(mesh->entity_get_type(Jali::Entity_kind::NODE, n) ==
+              refmesh->entity_get_type(Jali::Entity_kind::NODE,
+                                       node_new2old[n]));
+
+      // The renumbered mesh is the same mesh
+
+      for (auto const& n : mesh->nodes()) {
+        JaliGeometry::Point p, refp;
+        mesh->node_get_coordinates(n, &p);
+        refmesh->node_get_coordinates(node_new2old[n], &refp);
+        CHECK_ARRAY_EQUAL(&(refp[0]), &(p[0]), 3);
+      }
+
+      for (auto const& c : mesh->cells()) {
+        int oldc = cell_new2old[c];
+        CHECK_CLOSE(refmesh->cell_volume(oldc), mesh->cell_volume(c), 1.0e-12);
+        JaliGeometry::Point cen = mesh->cell_centroid(c);
+        JaliGeometry::Point refcen = refmesh->cell_centroid(oldc);
+        CHECK_ARRAY_CLOSE(&(refcen[0]), &(cen[0]), 3, 1.0e-12);
+
+        Jali::Entity_ID_List cnodes, refcnodes;
+        mesh->cell_get_nodes(c, &cnodes);
+        refmesh->cell_get_nodes(oldc, &refcnodes);
+        CHECK_EQUAL(refcnodes.size(), cnodes.size());
+        for (int i = 0; i < cnodes.size(); i++)
+          CHECK_EQUAL(refcnodes[i], node_new2old[cnodes[i]]);
+
+        Jali::Entity_ID_List cfaces, refcfaces;
+        std::vector<Jali::dir_t> cfdirs, refcfdirs;
+        mesh->cell_get_faces_and_dirs(c, &cfaces, &cfdirs);
+        refmesh->cell_get_faces_and_dirs(oldc, &refcfaces, &refcfdirs);
+        CHECK_EQUAL(refcfaces.size(), cfaces.size());
+        for (int i = 0; i < cfaces.size(); i++) {
+          CHECK_EQUAL(refcfaces[i], face_new2old[cfaces[i]]);
+          CHECK_EQUAL(refcfdirs[i], cfdirs[i]);
+        }
+      }
+
+      for (auto const& f : mesh->faces()) {
+        int oldf = face_new2old[f];
+        Jali::Entity_ID_List fnodes, reffnodes;
+        mesh->face_get_nodes(f, &fnodes);
+        refmesh->face_get_nodes(oldf, &reffnodes);
+        CHECK_EQUAL(reffnodes.size(), fnodes.size());
+        for (int i = 0; i < fnodes.size(); i++)
+          CHECK_EQUAL(reffnodes[i], node_new2old[fnodes[i]]);
+        JaliGeometry::Point normal = mesh->face_normal(f);
+        JaliGeometry::Point refnormal = refmesh->face_normal(oldf);
+        CHECK_ARRAY_CLOSE(&(refnormal[0]), &(normal[0]), 3, 1.0e-12);
+      }
+
+      // Cells along a space filling curve come in compact blocks that
+      // share more nodes than a run of cells along a row. RCM orders
+      // cells in wavefronts and only guarantees a small bandwidth
+
+      double nodes = mean_nodes_per_window(*mesh, 8);
+      if (ordering != Jali::Entity_ordering::RCM)
+        CHECK(nodes < refnodes);
+    }
+  }
+}
+
+
+TEST(MESH_REORDER_SETS_AND_SIDES) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  if (!Jali::framework_generates(Jali::Simple, nproc > 1, 1)) return;
+
+  // Sides, wedges and corners and mesh sets on a 1D mesh
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::Simple);
+  factory.included_entities({Jali::Entity_kind::EDGE, Jali::Entity_kind::FACE,
+          Jali::Entity_kind::CORNER});
+  std::shared_ptr<Jali::Mesh> refmesh = factory(0.0, 1.0, 50);
+  std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 1.0, 50);
+
+  Jali::Entity_ID_List setcells = {3, 17, 4, 40}, noghosts;
+  std::shared_ptr<Jali::MeshSet> cellset =
+      Jali::make_meshset("cells", *mesh, Jali::Entity_kind::CELL,
+                         setcells, noghosts);
+  Jali::Entity_ID_List setcorners = {11, 3, 60};
+  std::shared_ptr<Jali::MeshSet> cornerset =
+      Jali::make_meshset("corners", *mesh, Jali::Entity_kind::CORNER,
+                         setcorners, noghosts);
+
+  mesh->reorder_entities(Jali::Entity_ordering::RCM);
+
+  std::vector<int> const& cell_new2old =
+      mesh->entity_new_to_old(Jali::Entity_kind::CELL);
+  std::vector<int> const& node_new2old =
+      mesh->entity_new_to_old(Jali::Entity_kind::NODE);
+  std::vector<int> const& side_new2old =
+      mesh->entity_new_to_old(Jali::Entity_kind::SIDE);
+  std::vector<int> const& corner_new2old =
+      mesh->entity_new_to_old(Jali::Entity_kind::CORNER);
+  CHECK(is_permutation(cell_new2old, mesh->num_cells()));
+  CHECK(is_permutation(side_new2old, mesh->num_sides()));
+  CHECK(is_permutation(corner_new2old, mesh->num_corners()));
+  CHECK(is_permutation(mesh->entity_new_to_old(Jali::Entity_kind::WEDGE),
+                       mesh->num_wedges()));
+
+  // Sets keep their order and refer to the same entities
+
+  std::vector<int> const& cells = cellset->entities();
+  CHECK_EQUAL(setcells.size(), cells.size());
+  for (int i = 0; i < cells.size(); i++) {
+    CHECK_EQUAL(setcells[i], cell_new2old[cells[i]]);
+    CHECK_EQUAL(i, cellset->index_in_set(cells[i]));
+  }
+  std::vector<int> const& corners = cornerset->entities();
+  CHECK_EQUAL(setcorners.size(), corners.size());
+  for (int i = 0; i < corners.size(); i++)
+    CHECK_EQUAL(setcorners[i], corner_new2old[corners[i]]);
+
+  // Sides and corners are the same
+
+  for (auto const& s : mesh->sides()) {
+    int olds = side_new2old[s];
+    CHECK_EQUAL(refmesh->side_get_cell(olds),
+                cell_new2old[mesh->side_get_cell(s)]);
+    CHECK_EQUAL(refmesh->side_get_node(olds, 0),
+                node_new2old[mesh->side_get_node(s, 0)]);
+    CHECK_CLOSE(refmesh->side_volume(olds), mesh->side_volume(s), 1.0e-12);
+  }
+  for (auto const& cn : mesh->corners()) {
+    int oldcn = corner_new2old[cn];
+    CHECK_EQUAL(refmesh->corner_get_node(oldcn),
+                node_new2old[mesh->corner_get_node(cn)]);
+    CHECK_CLOSE(refmesh->corner_volume(oldcn), mesh->corner_volume(cn),
+                1.0e-12);
+  }
+
+  // Frameworks that cannot renumber their entities say so
+
+  if (Jali::framework_available(Jali::Structured)) {
+    factory.framework(Jali::Structured);
+    factory.ordering(Jali::Entity_ordering::HILBERT);
+    CHECK_THROW(factory(0.0, 1.0, 50), Errors::Message);
+  }
+}
@@ -0,0 +1,325 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+
+/**
+ * @file   test_spatial_index.cc
+ *
+ * @brief  Test point location and box queries of the mesh spatial
+ *         index against brute force searches
+ *
+ */
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <map>
+#include <string>
+#include <algorithm>
+
+#include "Mesh.hh"
+#include "MeshSet.hh"
+#include "MeshSpatialIndex.hh"
+#include "BoxRegion.hh"
+#include "PointRegion.hh"
+#include "GeometricModel.hh"
+#include "MeshFactory.hh"
+
+void check_spatial_index(Jali::Mesh const& mesh) {
+  int spdim = mesh.space_dimension();
+  auto index = mesh.spatial_index();
+
+  // Index is built once and reused
+
+  CHECK(index == mesh.spatial_index());
+
+  // Cell centroids are in their own cells
+
+  for (auto const& c : mesh.cells<Jali::Entity_type::PARALLEL_OWNED>())
+    CHECK_EQUAL(c, mesh.find_cell_containing(mesh.cell_centroid(c)));
+
+  // A node is in all the cells connected to it and is its own
+  // nearest node
+
+  for (auto const& n : mesh.nodes()) {
+    JaliGeometry::Point xyz;
+    mesh.node_get_coordinates(n, &xyz);
+
+    CHECK_EQUAL(n, index->nearest_node(xyz));
+
+    Jali::Entity_ID_List ncells, ncells2;
+    mesh.node_get_cells(n, Jali::Entity_type::ALL, &ncells);
+    std::sort(ncells.begin(), ncells.end());
+    index->cells_containing(xyz, &ncells2);
+    CHECK_EQUAL(ncells.size(), ncells2.size());
+    if (ncells.size() == ncells2.size())
+      CHECK_ARRAY_EQUAL(ncells, ncells2, ncells.size());
+  }
+
+  // Points outside the mesh are in no cell
+
+  JaliGeometry::Point far(spdim);
+  for (int d = 0; d < spdim; d++) far[d] = 10.0;
+  CHECK_EQUAL(-1, mesh.find_cell_containing(far));
+
+  // Nodes near a point and in a box match a search over all nodes
+
+  JaliGeometry::Point p(spdim), lo(spdim), hi(spdim);
+  for (int d = 0; d < spdim; d++) {
+    p[d] = 0.3 + 0.1*d;
+    lo[d] = 0.6 - 0.2*d;  // corners deliberately not ordered in y
+    hi[d] = 0.2 + 0.4*d;
+  }
+  double radius = 0.35;
+
+  Jali::Entity_ID_List nearnodes, boxnodes, nearnodes2, boxnodes2;
+  for (auto const& n : mesh.nodes()) {
+    JaliGeometry::Point xyz;
+    mesh.node_get_coordinates(n, &xyz);
+    if ((xyz-p)*(xyz-p) <= radius*radius)
+      nearnodes.push_back(n);
+    bool inbox = true;
+    for (int d = 0; d < spdim; d++)
+      if (xyz[d] < std::min(lo[d], hi[d]) || xyz[d] > std::max(lo[d], hi[d]))
+        inbox = false;
+    if (inbox) boxnodes.push_back(n);
+  }
+
+  mesh.nodes_near(p, radius, &nearnodes2);
+  CHECK(nearnodes.size() > 0);
+  CHECK_EQUAL(nearnodes.size(), nearnodes2.size());
+  if (nearnodes.size() == nearnodes2.size())
+    CHECK_ARRAY_EQUAL(nearnodes, nearnodes2, nearnodes.size());
+
+  index->nodes_in_box(lo, hi, &boxnodes2);
+  CHECK(boxnodes.size() > 0);
+  CHECK_EQUAL(boxnodes.size(), boxnodes2.size());
+  if (boxnodes.size() == boxnodes2.size())
+    CHECK_ARRAY_EQUAL(boxnodes, boxnodes2, boxnodes.size());
+
+  // Every cell with its centroid in the box is found by a box query
+
+  Jali::Entity_ID_List boxcells;
+  index->cells_in_box(lo, hi, &boxcells);
+  CHECK(std::is_sorted(boxcells.begin(), boxcells.end()));
+  for (auto const& c : mesh.cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+    JaliGeometry::Point cen = mesh.cell_centroid(c);
+    bool inbox = true;
+    for (int d = 0; d < spdim; d++)
+      if (cen[d] < std::min(lo[d], hi[d]) || cen[d] > std::max(lo[d], hi[d]))
+        inbox = false;
+    if (inbox)
+      CHECK(std::binary_search(boxcells.begin(), boxcells.end(), c));
+  }
+}
+
+
+TEST(MESH_SPATIAL_INDEX_1D) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+  if (!Jali::framework_generates(Jali::Simple, nproc > 1, 1)) return;
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::Simple);
+  factory.included_entities({Jali::Entity_kind::FACE});
+
+  std::vector<double> x(12);
+  for (int i = 0; i < 12; i++) x[i] = i*i/121.0;  // graded
+  std::shared_ptr<Jali::Mesh> mesh = factory(x);
+
+  check_spatial_index(*mesh);
+}
+
+
+TEST(MESH_SPATIAL_INDEX_2D) {
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK};
+  const char *framework_names[] = {"MSTK"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int fr = 0; fr < numframeworks; fr++) {
+    Jali::MeshFramework_t the_framework = frameworks[fr];
+    if (!Jali::framework_available(the_framework)) continue;
+
+    std::cerr << "Testing spatial index with " << framework_names[fr] <<
+        std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.included_entities({Jali::Entity_kind::FACE});
+    std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 1.0, 1.0, 7, 9);
+
+    check_spatial_index(*mesh);
+  }
+}
+
+
+TEST(MESH_SPATIAL_INDEX_3D) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const char *framework_names[] = {"MSTK", "Simple"};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int fr = 0; fr < numframeworks; fr++) {
+    Jali::MeshFramework_t the_framework = frameworks[fr];
+    if (!Jali::framework_available(the_framework)) continue;
+    if (!Jali::framework_generates(the_framework, nproc > 1, 3)) continue;
+
+    std::cerr << "Testing spatial index with " << framework_names[fr] <<
+        std::endl;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.included_entities({Jali::Entity_kind::FACE});
+    std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                               5, 6, 7);
+
+    check_spatial_index(*mesh);
+
+    // The index follows changes of node coordinates
+
+    JaliGeometry::Point xyz;
+    for (auto const& n : mesh->nodes()) {
+      mesh->node_get_coordinates(n, &xyz);
+      xyz[0] += 2.0;
+      mesh->node_set_coordinates(n, xyz);
+    }
+    mesh->update_geometric_quantities();
+
+    JaliGeometry::Point cen = mesh->cell_centroid(0);
+    CHECK_EQUAL(0, mesh->find_cell_containing(cen));
+  }
+}
+
+
+// Sets built from box and point regions with the help of the spatial
+// index must match sets found by testing every entity
+
+TEST(MESH_SPATIAL_INDEX_REGION_SETS) {
+  int nproc;
+  MPI_Comm_size(MPI_COMM_WORLD, &nproc);
+
+  JaliGeometry::Point boxlo(0.2, 0.3, 0.1), boxhi(0.7, 0.55, 0.8);
+  JaliGeometry::BoxRegion box("box", 1, boxlo, boxhi);
+  JaliGeometry::Point pnt1(0.5, 0.5, 0.5);  // node shared by 8 cells
+  JaliGeometry::PointRegion point1("point1", 2, pnt1);
+  JaliGeometry::Point pnt2(0.3, 0.4, 0.1);  // inside one cell
+  JaliGeometry::PointRegion point2("point2", 3, pnt2);
+  std::vector<JaliGeometry::RegionPtr> gregions = {&box, &point1, &point2};
+  JaliGeometry::GeometricModel gm(3, gregions);
+
+  const Jali::MeshFramework_t frameworks[] = {Jali::MSTK, Jali::Simple};
+  const int numframeworks = sizeof(frameworks)/sizeof(Jali::MeshFramework_t);
+  for (int fr = 0; fr < numframeworks; fr++) {
+    Jali::MeshFramework_t the_framework = frameworks[fr];
+    if (!Jali::framework_available(the_framework)) continue;
+    if (!Jali::framework_generates(the_framework, nproc > 1, 3)) continue;
+
+    Jali::MeshFactory factory(MPI_COMM_WORLD);
+    factory.framework(the_framework);
+    factory.included_entities({Jali::Entity_kind::FACE});
+    factory.geometric_model(&gm);
+    std::shared_ptr<Jali::Mesh> mesh = factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                               4, 4, 4);
+    std::map<std::string, std::vector<Jali::Entity_kind>> point_kinds =
+        {{"point1", {Jali::Entity_kind::CELL, Jali::Entity_kind::NODE}},
+         {"point2", {Jali::Entity_kind::CELL, Jali::Entity_kind::NODE}}};
+    mesh->init_sets_from_geometric_model(point_kinds);
+
+    // Box sets
+
+    Jali::Entity_ID_List cells, faces, nodes;
+    for (auto const& c : mesh->cells<Jali::Entity_type::PARALLEL_OWNED>())
+      if (box.inside(mesh->cell_centroid(c))) cells.push_back(c);
+    for (auto const& f : mesh->faces<Jali::Entity_type::PARALLEL_OWNED>())
+      if (box.inside(mesh->face_centroid(f))) faces.push_back(f);
+    for (auto const& n : mesh->nodes<Jali::Entity_type::PARALLEL_OWNED>()) {
+      JaliGeometry::Point xyz;
+      mesh->node_get_coordinates(n, &xyz);
+      if (box.inside(xyz)) nodes.push_back(n);
+    }
+
+    auto cellset = mesh->find_meshset("box", Jali::Entity_kind::CELL);
+    auto faceset = mesh->find_meshset("box", Jali::Entity_kind::FACE);
+    auto nodeset = mesh->find_meshset("box", Jali::Entity_kind::NODE);
+    CHECK(cellset && faceset && nodeset);
+    if (!cellset || !faceset || !nodeset) continue;
+
+    auto const& setcells =
+        cellset->entities<Jali::Entity_type::PARALLEL_OWNED>();
+    auto const& setfaces =
+        faceset->entities<Jali::Entity_type::PARALLEL_OWNED>();
+    auto const& setnodes =
+        nodeset->entities<Jali::Entity_type::PARALLEL_OWNED>();
+    CHECK_EQUAL(cells.size(), setcells.size());
+    CHECK_EQUAL(faces.size(), setfaces.size());
+    CHECK_EQUAL(nodes.size(), setnodes.size());
+    if (cells.size() == setcells.size())
+      CHECK_ARRAY_EQUAL(cells, setcells, cells.size());
+    if (faces.size() == setfaces.size())
+      CHECK_ARRAY_EQUAL(faces, setfaces, faces.size());
+    if (nodes.size() == setnodes.size())
+      CHECK_ARRAY_EQUAL(nodes, setnodes, nodes.size());
+
+    // Point sets - cells containing the point and the node at it
+
+    if (nproc == 1) {
+      CHECK_EQUAL(8, mesh->get_set_size("point1", Jali::Entity_kind::CELL,
+                                        Jali::Entity_type::ALL));
+      CHECK_EQUAL(1, mesh->get_set_size("point1", Jali::Entity_kind::NODE,
+                                        Jali::Entity_type::ALL));
+      CHECK_EQUAL(1, mesh->get_set_size("point2", Jali::Entity_kind::CELL,
+                                        Jali::Entity_type::ALL));
+      CHECK_EQUAL(0, mesh->get_set_size("point2", Jali::Entity_kind::NODE,
+                                        Jali::Entity_type::ALL));
+    }
+  }
+}
@@ -0,0 +1,453 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+/**
+ * @file   test_tile_parallel.cc
+ *
+ * @brief  Test the work-stealing thread pool and the tile-parallel
+ *         execution entry points of Mesh
+ *
+ */
+
+#include <UnitTest++.h>
+
+#include <mpi.h>
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+#include "Mesh.hh"
+#include "MeshTile.hh"
+#include "MeshFactory.hh"
+#include "ThreadPool.hh"
+
+TEST(THREAD_POOL) {
+  Jali::set_num_threads(4);
+
+  Jali::ThreadPool& pool = Jali::ThreadPool::instance();
+  int const nthreads = pool.num_threads();
+  CHECK(nthreads >= 1);
+
+  // Every task runs exactly once on a thread in range
+
+  int const ntasks = 1001;
+  std::vector<int> count(ntasks, 0);
+  std::vector<int> thread(ntasks, -1);
+  pool.run(ntasks, [&](int itask, int ithread) {
+      count[itask]++;
+      thread[itask] = ithread;
+    });
+  for (int i = 0; i < ntasks; i++) {
+    CHECK_EQUAL(1, count[i]);
+    CHECK(thread[i] >= 0 && thread[i] < nthreads);
+  }
+  CHECK_EQUAL(0, pool.home_thread(nthreads));
+
+  // Per-thread partial sums
+
+  Jali::PerThread<long> partial(0);
+  CHECK_EQUAL(nthreads, partial.size());
+  pool.run(ntasks, [&](int itask, int ithread) {
+      partial[ithread] += itask;
+    });
+  CHECK_EQUAL(ntasks*(ntasks-1L)/2,
+              partial.combine(0L, [](long a, long b) { return a + b; }));
+
+  // Nested calls run serially inside the task (UnitTest++ checks are
+  // not thread safe, so failures are counted and checked afterwards)
+
+  std::atomic<int> nested(0), bad(0);
+  pool.run(8, [&](int itask, int ithread) {
+      if (!Jali::ThreadPool::in_task()) bad++;
+      pool.run(10, [&](int jtask, int jthread) {
+          if (jthread != ithread) bad++;
+          nested++;
+        });
+    });
+  CHECK_EQUAL(80, nested.load());
+  CHECK_EQUAL(0, bad.load());
+  CHECK(!Jali::ThreadPool::in_task());
+
+  // Exceptions thrown in a task reach the caller and the pool remains
+  // usable afterwards
+
+  CHECK_THROW(pool.run(ntasks, [&](int itask, int ithread) {
+        if (itask == ntasks/2) throw std::runtime_error("task failure");
+      }), std::runtime_error);
+
+  std::atomic<int> done(0);
+  pool.run(ntasks, [&](int itask, int ithread) { done++; });
+  CHECK_EQUAL(ntasks, done.load());
+
+  // Changing the number of threads resizes the pool
+
+  Jali::set_num_threads(2);
+  CHECK(pool.num_threads() <= 2);
+  done = 0;
+  pool.run(ntasks, [&](int itask, int ithread) {
+      if (ithread >= 2) bad++;
+      done++;
+    });
+  CHECK_EQUAL(ntasks, done.load());
+  CHECK_EQUAL(0, bad.load());
+
+  Jali::set_num_threads(0);
+}
+
+
+TEST(MESH_TILE_PARALLEL) {
+  Jali::MeshFactory factory(MPI_COMM_SELF);
+  factory.framework(Jali::Simple);
+  factory.num_tiles(7);
+  factory.num_ghost_layers_tile(1);
+  std::shared_ptr<Jali::Mesh> mesh =
+      factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 6, 5, 4);
+  CHECK(mesh);
+  CHECK_EQUAL(7, mesh->num_tiles());
+
+  Jali::set_num_threads(4);
+
+  // Each tile-owned cell is written by exactly one tile
+
+  int const ncells = mesh->num_cells();
+  std::vector<int> tile_of_cell(ncells, -1), count(ncells, 0);
+  mesh->for_each_tile([&](Jali::MeshTile const& tile, int ithread) {
+      for (auto const& c : tile.cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+        count[c]++;
+        tile_of_cell[c] = tile.ID();
+      }
+    });
+  for (int c = 0; c < ncells; c++) {
+    CHECK_EQUAL(1, count[c]);
+    CHECK_EQUAL(mesh->master_tile_ID_of_cell(c), tile_of_cell[c]);
+  }
+
+  // Tile reductions are independent of the number of threads
+
+  auto tile_volume = [&](Jali::MeshTile const& tile, int ithread) {
+    double vol = 0.0;
+    for (auto const& c : tile.cells<Jali::Entity_type::PARALLEL_OWNED>())
+      vol += mesh->cell_volume(c);
+    return vol;
+  };
+  auto sum = [](double a, double b) { return a + b; };
+
+  double const volume = mesh->reduce_tiles(0.0, tile_volume, sum);
+  CHECK_CLOSE(1.0, volume, 1.0e-12);
+  for (int nthreads = 1; nthreads <= 3; nthreads++) {
+    Jali::set_num_threads(nthreads);
+    CHECK_EQUAL(volume, mesh->reduce_tiles(0.0, tile_volume, sum));
+  }
+
+  // Entity loops visit every entity of the requested type once
+
+  Jali::set_num_threads(4);
+  std::vector<int> node_count(mesh->num_nodes(), 0);
+  Jali::PerThread<int> nvisited(0);
+  mesh->parallel_for(Jali::Entity_kind::NODE, Jali::Entity_type::ALL,
+                     [&](Jali::Entity_ID n, int ithread) {
+                       node_count[n]++;
+                       nvisited[ithread]++;
+                     }, 16);
+  for (auto const& n : node_count)
+    CHECK_EQUAL(1, n);
+  CHECK_EQUAL(static_cast<int>(mesh->num_nodes()),
+              nvisited.combine(0, [](int a, int b) { return a + b; }));
+
+  std::vector<Jali::Entity_ID> owned_faces;
+  std::mutex mutex;
+  mesh->parallel_for(Jali::Entity_kind::FACE,
+                     Jali::Entity_type::PARALLEL_OWNED,
+                     [&](Jali::Entity_ID f, int ithread) {
+                       std::lock_guard<std::mutex> lock(mutex);
+                       owned_faces.push_back(f);
+                     }, 16);
+  std::sort(owned_faces.begin(), owned_faces.end());
+  std::vector<Jali::Entity_ID> expected = mesh->faces();
+  std::sort(expected.begin(), expected.end());
+  CHECK(owned_faces == expected);
+
+  Jali::set_num_threads(0);
+}
+
+
+TEST(MESH_TILE_COLORING) {
+  Jali::MeshFactory factory(MPI_COMM_SELF);
+  factory.framework(Jali::Simple);
+  factory.num_tiles(9);
+  factory.num_ghost_layers_tile(1);
+  std::shared_ptr<Jali::Mesh> mesh =
+      factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 6, 6, 6);
+  CHECK(mesh);
+
+  // Every tile has exactly one color and tiles of the same color do
+  // not share nodes of their owned cells
+
+  std::vector<std::vector<int>> const& tile_colors = mesh->tile_colors();
+  CHECK(tile_colors.size() > 1);
+  std::vector<int> tile_color(mesh->num_tiles(), -1);
+  for (int k = 0; k < tile_colors.size(); k++)
+    for (auto const& t : tile_colors[k]) {
+      CHECK_EQUAL(-1, tile_color[t]);
+      tile_color[t] = k;
+    }
+  for (auto const& k : tile_color)
+    CHECK(k >= 0);
+
+  std::vector<std::vector<int>> node_tiles(mesh->num_nodes());
+  for (auto const& tile : mesh->tiles())
+    for (auto const& c : tile->cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+      Jali::Entity_ID_List cnodes;
+      mesh->cell_get_nodes(c, &cnodes);
+      for (auto const& n : cnodes)
+        node_tiles[n].push_back(tile->ID());
+    }
+  for (auto const& tiles : node_tiles)
+    for (auto const& t1 : tiles)
+      for (auto const& t2 : tiles)
+        if (t1 != t2) CHECK(tile_color[t1] != tile_color[t2]);
+
+  // Cells of one color within a tile do not share nodes
+
+  for (auto const& tile : mesh->tiles()) {
+    std::vector<std::vector<Jali::Entity_ID>> const& cell_colors =
+        mesh->cell_colors(tile->ID());
+    int ncolored = 0;
+    for (auto const& cells : cell_colors) {
+      std::vector<int> node_used(mesh->num_nodes(), 0);
+      for (auto const& c : cells) {
+        CHECK_EQUAL(tile->ID(), mesh->master_tile_ID_of_cell(c));
+        Jali::Entity_ID_List cnodes;
+        mesh->cell_get_nodes(c, &cnodes);
+        for (auto const& n : cnodes)
+          CHECK_EQUAL(1, ++node_used[n]);
+      }
+      ncolored += cells.size();
+    }
+    CHECK_EQUAL(static_cast<int>(tile->num_cells<Jali::Entity_type::PARALLEL_OWNED>()),
+                ncolored);
+  }
+  CHECK_THROW(mesh->cell_colors(mesh->num_tiles()), Errors::Message);
+
+  // Scatter-add of cell volumes to nodes without locks matches the
+  // serial result
+
+  std::vector<double> serial_vol(mesh->num_nodes(), 0.0);
+  for (auto const& c : mesh->cells()) {
+    Jali::Entity_ID_List cnodes;
+    mesh->cell_get_nodes(c, &cnodes);
+    for (auto const& n : cnodes)
+      serial_vol[n] += mesh->cell_volume(c)/cnodes.size();
+  }
+
+  Jali::set_num_threads(4);
+  std::vector<double> node_vol(mesh->num_nodes(), 0.0);
+  mesh->for_each_tile_by_color([&](Jali::MeshTile const& tile, int ithread) {
+      for (auto const& c : tile.cells<Jali::Entity_type::PARALLEL_OWNED>()) {
+        Jali::Entity_ID_List cnodes;
+        mesh->cell_get_nodes(c, &cnodes);
+        for (auto const& n : cnodes)
+          node_vol[n] += mesh->cell_volume(c)/cnodes.size();
+      }
+    });
+  Jali::set_num_threads(0);
+  for (int n = 0; n < mesh->num_nodes(); n++)
+    CHECK_CLOSE(serial_vol[n], node_vol[n], 1.0e-12);
+
+  // Colorings are recomputed when the tiles are rebuilt
+
+  mesh->reorder_entities(Jali::Entity_ordering::HILBERT);
+  CHECK_EQUAL(9, mesh->num_tiles());
+  int ntiles_colored = 0;
+  for (auto const& tiles : mesh->tile_colors())
+    ntiles_colored += tiles.size();
+  CHECK_EQUAL(9, ntiles_colored);
+  for (auto const& tile : mesh->tiles())
+    for (auto const& cells : mesh->cell_colors(tile->ID()))
+      for (auto const& c : cells)
+        CHECK_EQUAL(tile->ID(), mesh->master_tile_ID_of_cell(c));
+}
+
+
+// Entities of the cells of a tile worked out by hand: the owned ones
+// in the order in which the owned cells use them (the tile becomes
+// the master of entities without one) and the set of ghost ones
+
+template <typename CellEntities>
+void expected_tile_entities(std::vector<Jali::Entity_ID> const& owned_cells,
+                            std::vector<Jali::Entity_ID> const& ghost_cells,
+                            int const tileid, CellEntities cell_entities,
+                            std::vector<int> *master,
+                            std::vector<Jali::Entity_ID> *owned,
+                            std::set<Jali::Entity_ID> *ghost) {
+  std::set<Jali::Entity_ID> seen;
+  for (auto const& c : owned_cells)
+    for (auto const& e : cell_entities(c)) {
+      if (!seen.insert(e).second) continue;
+      if ((*master)[e] == -1) (*master)[e] = tileid;
+      if ((*master)[e] == tileid)
+        owned->push_back(e);
+      else
+        ghost->insert(e);
+    }
+  for (auto const& c : ghost_cells)
+    for (auto const& e : cell_entities(c))
+      if (!seen.count(e)) ghost->insert(e);
+}
+
+
+TEST(MESH_TILE_BUILD) {
+  // Tiles built on several threads with 1 and 2 halo layers have the
+  // entity lists and master tile IDs of tiles built one after another
+
+  for (int nthreads : {2, 4}) {
+    for (int nlayers = 1; nlayers <= 2; nlayers++) {
+      Jali::set_num_threads(nthreads);
+      Jali::MeshFactory factory(MPI_COMM_SELF);
+      factory.framework(Jali::Simple);
+      factory.num_tiles(7);
+      factory.num_ghost_layers_tile(nlayers);
+      std::shared_ptr<Jali::Mesh> mesh =
+          factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 6, 5, 4);
+      Jali::set_num_threads(0);
+      CHECK_EQUAL(7, mesh->num_tiles());
+
+      int const ncells = mesh->num_cells();
+      std::vector<Jali::Entity_ID_List> cnodes(ncells), cfaces(ncells);
+      for (int c = 0; c < ncells; c++) {
+        mesh->cell_get_nodes(c, &cnodes[c]);
+        mesh->cell_get_faces(c, &cfaces[c]);
+      }
+
+      std::vector<int> cell_tile(ncells, -1);
+      std::vector<int> node_master(mesh->num_nodes(), -1);
+      std::vector<int> face_master(mesh->num_faces(), -1);
+      for (auto const& tile : mesh->tiles()) {
+        int const t = tile->ID();
+        std::vector<Jali::Entity_ID> const& owned_cells =
+            tile->cells<Jali::Entity_type::PARALLEL_OWNED>();
+        for (auto const& c : owned_cells) {
+          CHECK_EQUAL(-1, cell_tile[c]);
+          cell_tile[c] = t;
+          CHECK_EQUAL(t, mesh->master_tile_ID_of_cell(c));
+        }
+
+        // Halo layer i has the cells sharing a node with layer i-1
+
+        std::vector<int> layer(ncells, -1);
+        for (auto const& c : owned_cells) layer[c] = 0;
+        for (int i = 1; i <= nlayers; i++) {
+          std::vector<bool> layer_node(mesh->num_nodes(), false);
+          for (int c = 0; c < ncells; c++)
+            if (layer[c] == i-1)
+              for (auto const& n : cnodes[c]) layer_node[n] = true;
+          for (int c = 0; c < ncells; c++)
+            if (layer[c] == -1)
+              for (auto const& n : cnodes[c])
+                if (layer_node[n]) layer[c] = i;
+        }
+        std::vector<Jali::Entity_ID> ghost_cells;
+        for (int c = 0; c < ncells; c++)
+          if (layer[c] > 0) ghost_cells.push_back(c);
+
+        std::vector<Jali::Entity_ID> tile_ghost_cells =
+            tile->cells<Jali::Entity_type::PARALLEL_GHOST>();
+        std::sort(tile_ghost_cells.begin(), tile_ghost_cells.end());
+        CHECK(tile_ghost_cells == ghost_cells);
+
+        std::vector<Jali::Entity_ID> owned_nodes, owned_faces;
+        std::set<Jali::Entity_ID> ghost_nodes, ghost_faces;
+        expected_tile_entities(owned_cells, ghost_cells, t,
+                               [&](int c) { return cnodes[c]; },
+                               &node_master, &owned_nodes, &ghost_nodes);
+        expected_tile_entities(owned_cells, ghost_cells, t,
+                               [&](int c) { return cfaces[c]; },
+                               &face_master, &owned_faces, &ghost_faces);
+
+        CHECK(tile->nodes<Jali::Entity_type::PARALLEL_OWNED>() ==
+              owned_nodes);
+        std::vector<Jali::Entity_ID> const& tile_ghost_nodes =
+            tile->nodes<Jali::Entity_type::PARALLEL_GHOST>();
+        CHECK_EQUAL(ghost_nodes.size(), tile_ghost_nodes.size());
+        CHECK(std::set<Jali::Entity_ID>(tile_ghost_nodes.begin(),
+                                        tile_ghost_nodes.end()) ==
+              ghost_nodes);
+
+        CHECK(tile->faces<Jali::Entity_type::PARALLEL_OWNED>() ==
+              owned_faces);
+        std::vector<Jali::Entity_ID> const& tile_ghost_faces =
+            tile->faces<Jali::Entity_type::PARALLEL_GHOST>();
+        CHECK_EQUAL(ghost_faces.size(), tile_ghost_faces.size());
+        CHECK(std::set<Jali::Entity_ID>(tile_ghost_faces.begin(),
+                                        tile_ghost_faces.end()) ==
+              ghost_faces);
+
+        // ALL lists are the owned entities followed by the ghosts
+
+        std::vector<Jali::Entity_ID> all_nodes = owned_nodes;
+        all_nodes.insert(all_nodes.end(), tile_ghost_nodes.begin(),
+                         tile_ghost_nodes.end());
+        CHECK(tile->nodes<Jali::Entity_type::ALL>() == all_nodes);
+        std::vector<Jali::Entity_ID> all_faces = owned_faces;
+        all_faces.insert(all_faces.end(), tile_ghost_faces.begin(),
+                         tile_ghost_faces.end());
+        CHECK(tile->faces<Jali::Entity_type::ALL>() == all_faces);
+      }
+
+      for (int c = 0; c < ncells; c++)
+        CHECK(cell_tile[c] != -1);
+      for (int n = 0; n < mesh->num_nodes(); n++)
+        CHECK_EQUAL(node_master[n], mesh->master_tile_ID_of_node(n));
+      for (int f = 0; f < mesh->num_faces(); f++)
+        CHECK_EQUAL(face_master[f], mesh->master_tile_ID_of_face(f));
+    }
+  }
+}
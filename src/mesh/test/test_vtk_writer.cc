@@ -0,0 +1,438 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <mpi.h>
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef Jali_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "UnitTest++.h"
+
+#include "Mesh.hh"
+#include "MeshFactory.hh"
+#include "MeshSnapshot.hh"
+#include "Mesh_snapshot.hh"
+
+// Minimal reader of the pieces written by Mesh::write_to_vtk_file
+
+class VTUFile {
+ public:
+  explicit VTUFile(std::string const& filename) {
+    std::ifstream is(filename.c_str(), std::ios::binary);
+    std::stringstream contents;
+    contents << is.rdbuf();
+    contents_ = contents.str();
+    data_ = contents_.find("<AppendedData encoding=\"raw\">");
+    data_ = contents_.find('_', data_) + 1;
+    compressed_ = header().find("vtkZLibDataCompressor") != std::string::npos;
+  }
+
+  std::string header() const { return contents_.substr(0, data_); }
+
+  bool compressed() const { return compressed_; }
+
+  int attribute(std::string const& name) const {
+    std::size_t const pos = contents_.find(name + "=\"");
+    return std::stoi(contents_.substr(pos + name.size() + 2));
+  }
+
+  bool has_array(std::string const& name) const {
+    return header().find("Name=\"" + name + "\"") != std::string::npos;
+  }
+
+  // Values of an array of a section (PointData, CellData, Points or
+  // Cells) of the piece
+
+  template <typename T>
+  std::vector<T> array(std::string const& section,
+                       std::string const& name = "") const {
+    std::size_t pos = contents_.find("<" + section + ">");
+    if (!name.empty()) pos = contents_.find("Name=\"" + name + "\"", pos);
+    pos = contents_.find("offset=\"", pos) + 8;
+    std::size_t const offset = std::stoull(contents_.substr(pos, 32));
+    char const *p = contents_.data() + data_ + offset;
+
+    std::vector<char> bytes;
+    std::uint64_t header[3];
+    std::memcpy(header, p, sizeof(header));
+    if (!compressed_) {
+      bytes.assign(p + 8, p + 8 + header[0]);
+    } else {
+#ifdef Jali_HAVE_ZLIB
+      std::uint64_t const nblocks = header[0];
+      std::vector<std::uint64_t> zsizes(nblocks);
+      std::memcpy(zsizes.data(), p + sizeof(header), nblocks*8);
+      char const *z = p + sizeof(header) + nblocks*8;
+      for (std::uint64_t b = 0; b < nblocks; b++) {
+        uLongf size = (b == nblocks-1 && header[2]) ? header[2] : header[1];
+        std::size_t const start = bytes.size();
+        bytes.resize(start + size);
+        CHECK_EQUAL(Z_OK, uncompress(reinterpret_cast<Bytef *>(&bytes[start]),
+                                     &size,
+                                     reinterpret_cast<Bytef const *>(z),
+                                     zsizes[b]));
+        z += zsizes[b];
+      }
+#endif
+    }
+    std::vector<T> values(bytes.size()/sizeof(T));
+    std::memcpy(values.data(), bytes.data(), bytes.size());
+    return values;
+  }
+
+ private:
+  std::string contents_;
+  std::size_t data_;
+  bool compressed_;
+};
+
+
+// Signed volume of the parallelepiped spanned at node 0 of a VTK hex
+// or tet - positive if the nodes are in VTK order
+
+double corner_volume(std::vector<double> const& points,
+                     Jali::Entity_ID const *nodes, int const i1,
+                     int const i2, int const i3) {
+  double e[3][3];
+  int const k[3] = {i1, i2, i3};
+  for (int i = 0; i < 3; i++)
+    for (int d = 0; d < 3; d++)
+      e[i][d] = points[3*nodes[k[i]]+d] - points[3*nodes[0]+d];
+  return (e[0][0]*(e[1][1]*e[2][2] - e[1][2]*e[2][1]) -
+          e[0][1]*(e[1][0]*e[2][2] - e[1][2]*e[2][0]) +
+          e[0][2]*(e[1][0]*e[2][1] - e[1][1]*e[2][0]));
+}
+
+
+// Change the order of the nodes of a cell in a mesh snapshot file
+
+void permute_cell_nodes(std::string const& filename, int const c,
+                        std::vector<int> const& perm) {
+  std::vector<Jali::Entity_ID> nodes;
+  std::size_t offset;
+  {
+    Jali::MeshSnapshotFile file(filename, MPI_COMM_SELF);
+    Jali::Entity_ID_View row = file.csr<Jali::Entity_ID>("cell.nodes")[c];
+    for (int const i : perm) nodes.push_back(row[i]);
+    offset = reinterpret_cast<char const *>(row.begin()) -
+        reinterpret_cast<char const *>(&file.header());
+  }
+  std::fstream fs(filename.c_str(),
+                  std::ios::in | std::ios::out | std::ios::binary);
+  fs.seekp(offset);
+  fs.write(reinterpret_cast<char const *>(nodes.data()),
+           nodes.size()*sizeof(Jali::Entity_ID));
+}
+
+
+TEST(VTK_WRITER_HEX) {
+  int nprocs;
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+  if (nprocs > 1) return;
+
+  Jali::MeshFactory factory(MPI_COMM_SELF);
+  factory.framework(Jali::Structured);
+  std::shared_ptr<Jali::Mesh> mesh =
+      factory(0.0, 0.0, 0.0, 3.0, 2.0, 1.0, 3, 2, 2);
+  int const ncells = mesh->num_cells();
+  int const nnodes = mesh->num_nodes();
+
+  std::vector<double> density(ncells);
+  std::vector<int> ids(ncells);
+  for (int c = 0; c < ncells; c++) {
+    density[c] = 2.0*c + 0.5;
+    ids[c] = c;
+  }
+  std::vector<std::array<double, 3>> velocity(nnodes);
+  JaliGeometry::Point p;
+  for (int n = 0; n < nnodes; n++) {
+    mesh->node_get_coordinates(n, &p);
+    velocity[n] = {{p[0], -p[1], 2.0*p[2]}};
+  }
+
+  std::vector<bool> compress_options = {false};
+#ifdef Jali_HAVE_ZLIB
+  compress_options.push_back(true);
+#endif
+
+  for (bool const compress : compress_options) {
+    mesh->write_to_vtk_file("test_vtk_hex.pvtu",
+                            {Jali::vtk_field("density", Jali::Entity_kind::CELL,
+                                             density.data()),
+                             Jali::vtk_field("id", Jali::Entity_kind::CELL,
+                                             ids.data()),
+                             Jali::vtk_field("velocity",
+                                             Jali::Entity_kind::NODE,
+                                             velocity.data())},
+                            compress);
+
+    // On one rank there is just the piece
+
+    CHECK(!std::ifstream("test_vtk_hex.pvtu"));
+    VTUFile vtu("test_vtk_hex.vtu");
+    CHECK_EQUAL(compress, vtu.compressed());
+    CHECK_EQUAL(nnodes, vtu.attribute("NumberOfPoints"));
+    CHECK_EQUAL(ncells, vtu.attribute("NumberOfCells"));
+    CHECK(!vtu.has_array("faces"));
+
+    std::vector<double> points = vtu.array<double>("Points");
+    CHECK_EQUAL(3*nnodes, points.size());
+    for (int n = 0; n < nnodes; n++) {
+      mesh->node_get_coordinates(n, &p);
+      for (int d = 0; d < 3; d++)
+        CHECK_EQUAL(p[d], points[3*n+d]);
+    }
+
+    std::vector<Jali::Entity_ID> conn =
+        vtu.array<Jali::Entity_ID>("Cells", "connectivity");
+    std::vector<std::uint64_t> offsets =
+        vtu.array<std::uint64_t>("Cells", "offsets");
+    std::vector<std::uint8_t> types = vtu.array<std::uint8_t>("Cells", "types");
+    CHECK_EQUAL(8*ncells, conn.size());
+    CHECK_EQUAL(ncells, offsets.size());
+    CHECK_EQUAL(ncells, types.size());
+    for (int c = 0; c < ncells; c++) {
+      CHECK_EQUAL(12, types[c]);  // VTK_HEXAHEDRON
+      CHECK_EQUAL(8*(c+1), offsets[c]);
+      Jali::Entity_ID_List cnodes;
+      mesh->cell_get_nodes(c, &cnodes);
+      CHECK(std::equal(cnodes.begin(), cnodes.end(), &conn[8*c]));
+      CHECK(corner_volume(points, &conn[8*c], 1, 3, 4) > 0.0);
+    }
+
+    std::vector<double> rdensity = vtu.array<double>("CellData", "density");
+    std::vector<int> rids = vtu.array<int>("CellData", "id");
+    std::vector<double> rvelocity = vtu.array<double>("PointData", "velocity");
+    CHECK(rdensity == density);
+    CHECK(rids == ids);
+    CHECK_EQUAL(3*nnodes, rvelocity.size());
+    for (int n = 0; n < nnodes; n++)
+      for (int d = 0; d < 3; d++)
+        CHECK_EQUAL(velocity[n][d], rvelocity[3*n+d]);
+
+    for (auto const ghost : vtu.array<std::uint8_t>("CellData",
+                                                    "vtkGhostType"))
+      CHECK_EQUAL(0, ghost);
+    CHECK_EQUAL(nnodes, vtu.array<std::uint8_t>("PointData",
+                                                "vtkGhostType").size());
+  }
+
+  // Without fields stored on the mesh there are only the ghost flags
+
+  mesh->write_to_vtk_file("test_vtk_hex");
+  VTUFile vtu("test_vtk_hex.vtu");
+  CHECK(!vtu.has_array("density"));
+  CHECK(vtu.has_array("vtkGhostType"));
+
+  std::remove("test_vtk_hex.vtu");
+}
+
+
+TEST(VTK_WRITER_REORDERED_AND_POLYHEDRAL_CELLS) {
+  int nprocs;
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+  if (nprocs > 1) return;
+
+  // Hexes whose nodes the framework lists in a different order - cell
+  // 0 mirrored and cell 1 in no standard order at all - and a quad
+  // listed as a bowtie
+
+  Jali::MeshFactory factory(MPI_COMM_SELF);
+  factory.framework(Jali::Structured);
+  std::string const snapfile = "test_vtk_cells.jsnap";
+
+  factory(0.0, 0.0, 0.0, 2.0, 2.0, 1.0, 2, 2, 1)->write_snapshot(snapfile);
+  permute_cell_nodes(snapfile, 0, {0, 3, 2, 1, 4, 7, 6, 5});
+  permute_cell_nodes(snapfile, 1, {6, 1, 2, 3, 4, 5, 0, 7});
+  std::shared_ptr<Jali::Mesh> mesh =
+      std::make_shared<Jali::Mesh_snapshot>(snapfile, MPI_COMM_SELF);
+  int const ncells = mesh->num_cells();
+
+  mesh->write_to_vtk_file("test_vtk_cells");
+  VTUFile vtu("test_vtk_cells.vtu");
+  std::vector<double> points = vtu.array<double>("Points");
+  std::vector<Jali::Entity_ID> conn =
+      vtu.array<Jali::Entity_ID>("Cells", "connectivity");
+  std::vector<std::uint8_t> types = vtu.array<std::uint8_t>("Cells", "types");
+  std::vector<std::int64_t> faceoffsets =
+      vtu.array<std::int64_t>("Cells", "faceoffsets");
+  std::vector<Jali::Entity_ID> faces =
+      vtu.array<Jali::Entity_ID>("Cells", "faces");
+
+  CHECK_EQUAL(ncells, types.size());
+  CHECK_EQUAL(ncells, faceoffsets.size());
+  for (int c = 0; c < ncells; c++) {
+    if (c == 1) continue;
+    CHECK_EQUAL(12, types[c]);
+    CHECK_EQUAL(-1, faceoffsets[c]);
+    CHECK(corner_volume(points, &conn[8*c], 1, 3, 4) > 0.0);
+  }
+
+  // The polyhedron lists its nodes as they are and its faces with
+  // outward normals
+
+  CHECK_EQUAL(42, types[1]);  // VTK_POLYHEDRON
+  CHECK_EQUAL(1 + 6*5, faceoffsets[1]);
+  CHECK_EQUAL(faceoffsets[1], faces.size());
+  Jali::Entity_ID_List cnodes;
+  mesh->cell_get_nodes(1, &cnodes);
+  CHECK(std::equal(cnodes.begin(), cnodes.end(), &conn[8]));
+
+  JaliGeometry::Point ccen = mesh->cell_centroid(1);
+  CHECK_EQUAL(6, faces[0]);
+  for (int f = 0; f < 6; f++) {
+    Jali::Entity_ID const *fnodes = &faces[1 + 5*f];
+    CHECK_EQUAL(4, fnodes[0]);
+    double normal[3] = {0.0, 0.0, 0.0}, fcen[3] = {0.0, 0.0, 0.0};
+    for (int i = 0; i < 4; i++) {
+      double const *a = &points[3*fnodes[1+i]];
+      double const *b = &points[3*fnodes[1+(i+1)%4]];
+      normal[0] += (a[1] - b[1])*(a[2] + b[2]);
+      normal[1] += (a[2] - b[2])*(a[0] + b[0]);
+      normal[2] += (a[0] - b[0])*(a[1] + b[1]);
+      for (int d = 0; d < 3; d++) fcen[d] += 0.25*a[d];
+    }
+    double dot = 0.0;
+    for (int d = 0; d < 3; d++) dot += normal[d]*(fcen[d] - ccen[d]);
+    CHECK(dot > 0.0);
+  }
+
+  // 2D - the bowtie is written as a proper quad
+
+  factory(0.0, 0.0, 2.0, 1.0, 2, 1)->write_snapshot(snapfile);
+  permute_cell_nodes(snapfile, 0, {0, 2, 1, 3});
+  mesh = std::make_shared<Jali::Mesh_snapshot>(snapfile, MPI_COMM_SELF);
+
+  mesh->write_to_vtk_file("test_vtk_cells");
+  VTUFile vtu2("test_vtk_cells.vtu");
+  conn = vtu2.array<Jali::Entity_ID>("Cells", "connectivity");
+  types = vtu2.array<std::uint8_t>("Cells", "types");
+  CHECK_EQUAL(2, types.size());
+  CHECK_EQUAL(9, types[0]);  // VTK_QUAD
+  CHECK(!vtu2.has_array("faces"));
+
+  Jali::Entity_ID_List cfaces, fnodes;
+  mesh->cell_get_faces(0, &cfaces);
+  for (int i = 0; i < 4; i++) {
+    Jali::Entity_ID const a = conn[i], b = conn[(i+1)%4];
+    bool is_edge = false;
+    for (auto const f : cfaces) {
+      mesh->face_get_nodes(f, &fnodes);
+      is_edge |= ((fnodes[0] == a && fnodes[1] == b) ||
+                  (fnodes[0] == b && fnodes[1] == a));
+    }
+    CHECK(is_edge);
+  }
+
+  std::remove("test_vtk_cells.vtu");
+  std::remove(snapfile.c_str());
+}
+
+
+TEST(VTK_WRITER_PARALLEL) {
+  int nprocs, rank;
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  if (nprocs == 1 || !Jali::framework_generates(Jali::MSTK, true, 3)) return;
+
+  Jali::MeshFactory factory(MPI_COMM_WORLD);
+  factory.framework(Jali::MSTK);
+  std::shared_ptr<Jali::Mesh> mesh =
+      factory(0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 4, 4, 4);
+
+  std::vector<int> owner(mesh->num_cells(), rank);
+  mesh->write_to_vtk_file("test_vtk_parallel",
+                          {Jali::vtk_field("owner", Jali::Entity_kind::CELL,
+                                           owner.data())});
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  // Each rank wrote its piece with its ghosts flagged
+
+  std::string const piece =
+      Jali::snapshot_filename("test_vtk_parallel", MPI_COMM_WORLD) + ".vtu";
+  VTUFile vtu(piece);
+  CHECK_EQUAL(mesh->num_nodes(), vtu.attribute("NumberOfPoints"));
+  CHECK_EQUAL(mesh->num_cells(), vtu.attribute("NumberOfCells"));
+  CHECK(vtu.array<int>("CellData", "owner") == owner);
+
+  int nghost = 0;
+  for (auto const ghost : vtu.array<std::uint8_t>("CellData", "vtkGhostType"))
+    nghost += (ghost != 0);
+  CHECK_EQUAL(mesh->num_cells<Jali::Entity_type::PARALLEL_GHOST>() +
+              mesh->num_cells<Jali::Entity_type::BOUNDARY_GHOST>(), nghost);
+
+  // and rank 0 the index of the pieces
+
+  if (rank == 0) {
+    std::ifstream is("test_vtk_parallel.pvtu");
+    std::stringstream pvtu;
+    pvtu << is.rdbuf();
+    CHECK(pvtu.str().find("Name=\"owner\"") != std::string::npos);
+    for (int p = 0; p < nprocs; p++) {
+      std::stringstream source;
+      source << "Source=\"test_vtk_parallel." << nprocs << "." << p << ".vtu\"";
+      CHECK(pvtu.str().find(source.str()) != std::string::npos);
+    }
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  std::remove(piece.c_str());
+  if (rank == 0) std::remove("test_vtk_parallel.pvtu");
+}
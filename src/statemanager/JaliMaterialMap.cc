@@ -0,0 +1,98 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "JaliMaterialMap.h"
+
+#include <algorithm>
+
+#include "MeshSet.hh"
+
+namespace Jali {
+
+MaterialMap::MaterialMap(int ncells,
+                         std::vector<std::shared_ptr<MeshSet>> const& matsets) {
+  int nmats = matsets.size();
+
+  // Material-centric rows are just the material sets
+
+  std::vector<int> matsizes(nmats, 0);
+  for (int m = 0; m < nmats; m++)
+    if (matsets[m]) matsizes[m] = matsets[m]->entities().size();
+  matcells_.set_row_sizes(matsizes);
+  for (int m = 0; m < nmats; m++) {
+    if (!matsets[m]) continue;
+    Entity_ID_List const& cells = matsets[m]->entities();
+    std::copy(cells.begin(), cells.end(), matcells_.row_data(m));
+  }
+
+  // Count the materials in each cell and then fill the cell-centric
+  // rows by going over the materials in order, so that each row comes
+  // out sorted by material
+
+  std::vector<int> nmatcells(ncells, 0);
+  for (int m = 0; m < nmats; m++)
+    for (int const c : matcells_.row(m))
+      nmatcells[c]++;
+  cellmats_.set_row_sizes(nmatcells);
+  cellmatindices_.set_row_sizes(nmatcells);
+
+  std::fill(nmatcells.begin(), nmatcells.end(), 0);
+  for (int m = 0; m < nmats; m++) {
+    ArrayView<int> cells = matcells_.row(m);
+    int ncm = cells.size();
+    for (int i = 0; i < ncm; i++) {
+      int c = cells[i];
+      int k = nmatcells[c]++;
+      cellmats_.row_data(c)[k] = m;
+      cellmatindices_.row_data(c)[k] = i;
+    }
+  }
+}
+
+}  // namespace Jali
@@ -0,0 +1,156 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef JALI_MATERIAL_MAP_H_
+#define JALI_MATERIAL_MAP_H_
+
+#include <memory>
+#include <vector>
+
+#include "MeshDefs.hh"
+#include "MeshCSR.hh"
+
+namespace Jali {
+
+class MeshSet;
+
+/*!
+  @class MaterialMap JaliMaterialMap.h
+  @brief Which materials are in which cells, in compressed row form
+  both by cell and by material
+
+  Cell-centric: the entries of cell c are offsets()[c] to
+  offsets()[c+1]-1 and list the materials in the cell in increasing
+  order together with the index of the cell in each material's
+  set. Material-centric: the cells of material m in the order of the
+  material set (which is also the order of the material's data in a
+  MultiStateVector).
+
+  The map is a snapshot of the material sets at the time it is built
+  - the State builds a new one after its materials change (see
+  State::material_map)
+*/
+
+class MaterialMap {
+ public:
+
+  /// Build the map for 'ncells' cells and the cell sets of the materials
+
+  MaterialMap(int ncells,
+              std::vector<std::shared_ptr<MeshSet>> const& matsets);
+
+  /// Number of cells
+
+  int num_cells() const { return cellmats_.num_rows(); }
+
+  /// Number of materials
+
+  int num_materials() const { return matcells_.num_rows(); }
+
+  /// Total number of (cell, material) pairs
+
+  int num_entries() const { return cellmats_.num_entries(); }
+
+  /// Start of the entries of each cell (size num_cells()+1)
+
+  std::vector<std::size_t> const& offsets() const {
+    return cellmats_.offsets();
+  }
+
+  /// Materials in cell c (in increasing order)
+
+  ArrayView<int> cell_materials(int c) const { return cellmats_.row(c); }
+
+  /// Index of cell c in the set of each of its materials
+
+  ArrayView<int> cell_material_indices(int c) const {
+    return cellmatindices_.row(c);
+  }
+
+  /// Material of each cell-centric entry
+
+  std::vector<int> const& entry_materials() const { return cellmats_.data(); }
+
+  /// Index in the material set of each cell-centric entry
+
+  std::vector<int> const& entry_material_indices() const {
+    return cellmatindices_.data();
+  }
+
+  /// Cell-centric entry for material m in cell c (-1 if the cell does
+  /// not contain the material)
+
+  int entry(int c, int m) const {
+    std::size_t const kbeg = cellmats_.offsets()[c];
+    std::size_t const kend = cellmats_.offsets()[c+1];
+    std::vector<int> const& mats = cellmats_.data();
+    for (std::size_t k = kbeg; k < kend; k++)
+      if (mats[k] == m) return k;
+    return -1;
+  }
+
+  /// Cells of material m in the order of the material set
+
+  ArrayView<int> material_cells(int m) const { return matcells_.row(m); }
+
+  /// Start of the cells of each material (size num_materials()+1)
+
+  std::vector<std::size_t> const& material_offsets() const {
+    return matcells_.offsets();
+  }
+
+ private:
+  CSRArray<int> cellmats_;         // materials of each cell
+  CSRArray<int> cellmatindices_;   // index of cell in each material set
+  CSRArray<int> matcells_;         // cells of each material
+};
+
+}  // namespace Jali
+
+#endif  // JALI_MATERIAL_MAP_H_
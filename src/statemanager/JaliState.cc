@@ -48,6 +48,10 @@
 
 #include <cassert>
 #include <memory>
+#include <algorithm>
+#include <map>
+#include <array>
+#include <string>
 
 #include "JaliState.h"
 #include "JaliStateVector.h"
@@ -78,6 +82,7 @@ void State::add_material(std::string const& matname,
   matset->add_entities(matcells);
 
   material_cellsets_.push_back(matset);
+  material_map_.reset();
 
   int matid = num_materials()-1;
   if (cell_materials_.size() == 0)
@@ -111,6 +116,7 @@ void State::rem_material(int m) {
   }
 
   material_cellsets_.erase(material_cellsets_.begin()+m);
+  material_map_.reset();
 
   // GO TO EACH MMStateVector AND REMOVE ENTRIES FOR THIS MATERIAL
   for (auto &sv : state_vectors_) {
@@ -125,33 +131,151 @@ void State::rem_material(int m) {
 
 void State::add_cells_to_material(int m, std::vector<int> const& cells) {
   assert(m < material_cellsets_.size());
-  material_cellsets_[m]->add_entities(cells);
+  std::vector<int> new2old;
+  material_cellsets_[m]->stage_add_entities(cells);
+  material_cellsets_[m]->commit(&new2old);
+  material_map_.reset();
 
   for (auto const& c : cells)
-    cell_materials_[c].push_back(m);
+    if (std::find(cell_materials_[c].begin(), cell_materials_[c].end(), m) ==
+        cell_materials_[c].end())
+      cell_materials_[c].push_back(m);
 
-  for (auto & sv : state_vectors_) {
-    if (sv->type() == StateVector_type::MULTIVAL) {
+  remap_material_data(m, new2old);
+}
+
+/// Remove cells from a material
+
+void State::rem_cells_from_material(int m, std::vector<int> const& cells) {
+  assert(m < static_cast<int>(material_cellsets_.size()));
+  std::vector<int> new2old;
+  material_cellsets_[m]->stage_rem_entities(cells);
+  material_cellsets_[m]->commit(&new2old);
+  material_map_.reset();
+
+  for (auto const& c : cells) {
+    auto it = std::find(cell_materials_[c].begin(), cell_materials_[c].end(),
+                        m);
+    if (it != cell_materials_[c].end())
+      cell_materials_[c].erase(it);
+  }
+
+  remap_material_data(m, new2old);
+}
+
+namespace {
+
+// Mesh entities of a kind and parallel type
+
+template<Entity_type type>
+std::vector<int> const& mesh_entities(Mesh const& mesh, Entity_kind kind) {
+  switch (kind) {
+    case Entity_kind::NODE: return mesh.nodes<type>();
+    case Entity_kind::EDGE: return mesh.edges<type>();
+    case Entity_kind::FACE: return mesh.faces<type>();
+    case Entity_kind::SIDE: return mesh.sides<type>();
+    case Entity_kind::WEDGE: return mesh.wedges<type>();
+    case Entity_kind::CORNER: return mesh.corners<type>();
+    default: return mesh.cells<type>();
+  }
+}
+
+std::vector<int> const& mesh_entities(Mesh const& mesh, Entity_kind kind,
+                                      Entity_type type) {
+  switch (type) {
+    case Entity_type::PARALLEL_OWNED:
+      return mesh_entities<Entity_type::PARALLEL_OWNED>(mesh, kind);
+    case Entity_type::PARALLEL_GHOST:
+      return mesh_entities<Entity_type::PARALLEL_GHOST>(mesh, kind);
+    case Entity_type::BOUNDARY_GHOST:
+      return mesh_entities<Entity_type::BOUNDARY_GHOST>(mesh, kind);
+    default:
+      return mesh_entities<Entity_type::ALL>(mesh, kind);
+  }
+}
+
+}  // namespace
+
+
+/// Carry the data over to a new numbering of mesh entities
+
+void State::renumber_entities(Entity_kind kind,
+                              std::vector<int> const& new2old) {
+  if (new2old.empty()) return;
+
+  // Vectors on a subset of the entities (e.g. the owned ones) are
+  // indexed by position in the mesh's list of entities of that
+  // type. Renumbering keeps the IDs of each type, so these lists are
+  // the same before and after
+
+  auto local_new2old = [&](Entity_type type) {
+    std::vector<int> const& ents = mesh_entities(*mymesh_, kind, type);
+    std::vector<int> pos(new2old.size(), -1);
+    int nents = ents.size();
+    for (int i = 0; i < nents; i++)
+      pos[ents[i]] = i;
+    std::vector<int> local(nents);
+    for (int i = 0; i < nents; i++)
+      local[i] = pos[new2old[ents[i]]];
+    return local;
+  };
+
+  std::map<Entity_type, std::vector<int>> new2old_by_type;
+  for (auto const& index : entity_indexes_[static_cast<int>(kind)]) {
+    auto const& sv = state_vectors_[index];
+    if (sv->type() == StateVector_type::UNIVAL) {
+      auto uv = std::dynamic_pointer_cast<UniStateVectorBase<Mesh>>(sv);
+      if (!uv || uv->domain() != mymesh_ || !uv->size()) continue;
+
+      Entity_type type = uv->entity_type();
+      if (type == Entity_type::ALL) {
+        uv->permute(new2old);
+      } else {
+        auto it = new2old_by_type.find(type);
+        if (it == new2old_by_type.end())
+          it = new2old_by_type.emplace(type, local_new2old(type)).first;
+        uv->permute(it->second);
+      }
+    } else if (kind == Entity_kind::CELL) {
       auto mv = std::dynamic_pointer_cast<MultiStateVectorBase<Mesh>>(sv);
-      int size = mv->size(m);
-      mv->resize(m, size+cells.size());
+      if (mv) mv->set_storage_layout(Data_layout::MATERIAL_CENTRIC);
+    }
+  }
+
+  if (kind == Entity_kind::CELL) {
+    if (cell_materials_.size()) {
+      std::vector<std::vector<int>> old_cell_materials;
+      old_cell_materials.swap(cell_materials_);
+      cell_materials_.resize(old_cell_materials.size());
+      int nc = new2old.size();
+      for (int c = 0; c < nc; c++)
+        cell_materials_[c].swap(old_cell_materials[new2old[c]]);
     }
+    material_map_.reset();
   }
 }
 
-/// Remove cells from a material
 
-void State::rem_cells_from_material(int m, std::vector<int> const& cells) {
+/// Compressed row map of materials and cells
 
-  // NOT IMPLEMENTED - THERE ARE MAJOR CONSIDERATIONS OF EFFICIENCY
-  // IN HOW WE DO THIS - IF WE REMOVE THESE ENTRIES FROM THE LIST
-  // THEN WE HAVE TO REMOVE ENTRIES FROM ALL STATE VECTORS FROM
-  // CORRESPONDING TO THIS MATERIAL AS WELL. BESIDES MESHSETS DO
-  // FUNKY THINGS WITH REMOVING CELLS AND THAT HAS TO BE TAKEN
-  // INTO ACCOUNT (See MeshSet::rem_entities)
+std::shared_ptr<MaterialMap const> State::material_map() const {
+  if (!material_map_) {
+    int ncells = mymesh_->num_entities(Entity_kind::CELL, Entity_type::ALL);
+    material_map_ = std::make_shared<MaterialMap>(ncells, material_cellsets_);
+  }
+  return material_map_;
+}
 
-  throw std::runtime_error("rem_cells_from_material NOT IMPLEMENTED");
+/// Carry the entries of material 'm' in multi-material state vectors
+/// over to the new order of cells in the material set
 
+void State::remap_material_data(int m, std::vector<int> const& new2old) {
+  for (auto & sv : state_vectors_) {
+    if (sv->type() == StateVector_type::MULTIVAL) {
+      auto mv = std::dynamic_pointer_cast<MultiStateVectorBase<Mesh>>(sv);
+      if (mv) mv->remap(m, new2old);
+    }
+  }
 }
 
 
@@ -230,31 +354,18 @@ void State::export_to_mesh() {
   while (it != cend()) {
     const std::shared_ptr<StateVectorBase> vec = *it;
     std::string name = vec->name();
-    Entity_kind entity_kind = vec->entity_kind();
     bool status = false;
 
-    // We only know how to store univalued data with the mesh
-    if (vec->type() == StateVector_type::UNIVAL) {
-      if (vec->data_type() == typeid(double)) {
-        auto svec = std::dynamic_pointer_cast<UniStateVector<double>>(vec);
-        status = mymesh_->store_field(name, entity_kind, svec->get_raw_data());
-      } else if (vec->data_type() == typeid(int)) {
-        auto svec = std::dynamic_pointer_cast<UniStateVector<int>>(vec);
-        status = mymesh_->store_field(name, entity_kind, svec->get_raw_data());
-      } else if (vec->data_type() == typeid(std::array<double, 2>)) {
-        auto svec =
-            std::dynamic_pointer_cast<UniStateVector<std::array<double, 2>>>(vec);
-        status = mymesh_->store_field(name, entity_kind, svec->get_raw_data());
-      } else if (vec->data_type() == typeid(std::array<double, 3>)) {
-        auto svec =
-            std::dynamic_pointer_cast<UniStateVector<std::array<double, 3>>>(vec);
-        status = mymesh_->store_field(name, entity_kind, svec->get_raw_data());
-      } else if (vec->data_type() == typeid(std::array<double, 6>)) {
-        auto svec =
-            std::dynamic_pointer_cast<UniStateVector<std::array<double, 6>>>(vec);
-        status = mymesh_->store_field(name, entity_kind, svec->get_raw_data());
-      }
-    }
+    if (vec->data_type() == typeid(double))
+      status = export_vector_to_mesh<double>(vec);
+    else if (vec->data_type() == typeid(int))
+      status = export_vector_to_mesh<int>(vec);
+    else if (vec->data_type() == typeid(std::array<double, 2>))
+      status = export_vector_to_mesh<std::array<double, 2>>(vec);
+    else if (vec->data_type() == typeid(std::array<double, 3>))
+      status = export_vector_to_mesh<std::array<double, 3>>(vec);
+    else if (vec->data_type() == typeid(std::array<double, 6>))
+      status = export_vector_to_mesh<std::array<double, 6>>(vec);
 
     if (!status)
       std::cerr << "Could not export vector " << name << " to mesh file\n";
@@ -264,6 +375,125 @@ void State::export_to_mesh() {
 }
 
 
+template <class T>
+bool State::export_vector_to_mesh(std::shared_ptr<StateVectorBase> const&
+                                  vec) {
+  Entity_kind const kind = vec->entity_kind();
+  int const nent = mymesh_->num_entities(kind, Entity_type::ALL);
+
+  // The mesh takes values for all entities of a kind
+
+  if (vec->type() == StateVector_type::UNIVAL) {
+    auto svec = std::dynamic_pointer_cast<UniStateVector<T>>(vec);
+    if (!svec || static_cast<int>(svec->size()) != nent) return false;
+    return mymesh_->store_field(vec->name(), kind, svec->get_raw_data());
+  }
+
+  auto mvec = std::dynamic_pointer_cast<MultiStateVector<T>>(vec);
+  if (!mvec || kind != Entity_kind::CELL) return false;
+
+  int const nmats = mvec->size();
+  std::vector<std::vector<T>> values;
+  material_arrays(*mvec, &values);
+
+  bool status = true;
+  for (int m = 0; m < nmats; m++)
+    status &= mymesh_->store_field(vec->name() + "_" + material_name(m), kind,
+                                   values[m].data());
+  return status;
+}
+
+
+template <class T>
+void State::material_arrays(MultiStateVector<T> const& mvec,
+                            std::vector<std::vector<T>> *values) const {
+  int const nmats = mvec.size();
+  int const nent = mymesh_->num_entities(Entity_kind::CELL, Entity_type::ALL);
+  values->assign(nmats, std::vector<T>(nent, T()));
+  if (mvec.storage_layout() == Data_layout::MATERIAL_CENTRIC) {
+    for (int m = 0; m < nmats; m++) {
+      std::vector<int> const& cells = material_cells(m);
+      std::vector<T> const& matdata = mvec.get_matdata(m);
+      for (std::size_t i = 0; i < matdata.size(); i++)
+        (*values)[m][cells[i]] = matdata[i];
+    }
+  } else {
+    MaterialMap const& map = mvec.cell_centric_map();
+    std::vector<T> const& data = mvec.get_cell_centric_data();
+    std::vector<int> const& emats = map.entry_materials();
+    int const ncells = map.num_cells();
+    for (int c = 0; c < ncells; c++)
+      for (std::size_t k = map.offsets()[c]; k < map.offsets()[c+1]; k++)
+        (*values)[emats[k]][c] = data[k];
+  }
+}
+
+
+void State::write_to_vtk_file(std::string const& filename,
+                              bool const compress) const {
+  std::vector<VTKField> fields;
+  std::vector<std::shared_ptr<void>> storage;
+
+  State::const_iterator it = cbegin();
+
+  while (it != cend()) {
+    const std::shared_ptr<StateVectorBase> vec = *it;
+    bool status = false;
+
+    if (vec->data_type() == typeid(double))
+      status = add_vtk_fields<double>(vec, &fields, &storage);
+    else if (vec->data_type() == typeid(float))
+      status = add_vtk_fields<float>(vec, &fields, &storage);
+    else if (vec->data_type() == typeid(int))
+      status = add_vtk_fields<int>(vec, &fields, &storage);
+    else if (vec->data_type() == typeid(std::array<double, 2>))
+      status = add_vtk_fields<std::array<double, 2>>(vec, &fields, &storage);
+    else if (vec->data_type() == typeid(std::array<double, 3>))
+      status = add_vtk_fields<std::array<double, 3>>(vec, &fields, &storage);
+    else if (vec->data_type() == typeid(std::array<double, 6>))
+      status = add_vtk_fields<std::array<double, 6>>(vec, &fields, &storage);
+
+    if (!status)
+      std::cerr << "Could not write vector " << vec->name() <<
+          " to VTK file\n";
+
+    ++it;
+  }
+
+  mymesh_->write_to_vtk_file(filename, fields, compress);
+}
+
+
+template <class T>
+bool State::add_vtk_fields(std::shared_ptr<StateVectorBase> const& vec,
+                           std::vector<VTKField> *fields,
+                           std::vector<std::shared_ptr<void>> *storage) const {
+  Entity_kind const kind = vec->entity_kind();
+  if (kind != Entity_kind::NODE && kind != Entity_kind::CELL) return false;
+  int const nent = mymesh_->num_entities(kind, Entity_type::ALL);
+
+  if (vec->type() == StateVector_type::UNIVAL) {
+    auto svec = std::dynamic_pointer_cast<UniStateVector<T>>(vec);
+    if (!svec || static_cast<int>(svec->size()) != nent) return false;
+    T const *data = nent ? svec->get_raw_data() : nullptr;
+    fields->push_back(vtk_field(vec->name(), kind, data));
+    return true;
+  }
+
+  auto mvec = std::dynamic_pointer_cast<MultiStateVector<T>>(vec);
+  if (!mvec || kind != Entity_kind::CELL) return false;
+
+  auto values = std::make_shared<std::vector<std::vector<T>>>();
+  material_arrays(*mvec, values.get());
+  storage->push_back(values);
+  int const nmats = values->size();
+  for (int m = 0; m < nmats; m++)
+    fields->push_back(vtk_field(vec->name() + "_" + material_name(m), kind,
+                                (*values)[m].data()));
+  return true;
+}
+
+
 //! Print all state vectors
 
 std::ostream & operator<<(std::ostream & os, State const & s) {
@@ -65,9 +65,13 @@
 #include <string>
 #include <memory>
 #include <cassert>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
 
 #include "Mesh.hh"    // Jali mesh header
 #include "JaliStateVector.h"
+#include "JaliMaterialMap.h"
 
 namespace Jali {
 
@@ -211,6 +215,18 @@ class State : public std::enable_shared_from_this<State> {
   }
 
 
+  /*!
+    @brief Cells of each material and materials of each cell in
+    compressed row form (see MaterialMap)
+
+    The map is built on first use after the materials or their cells
+    change and shared until the next change. Holders of an older map
+    keep a valid (but outdated) snapshot
+  */
+
+  std::shared_ptr<MaterialMap const> material_map() const;
+
+
   /// Cell index in material set
 
   int cell_index_in_material(int c, int m) {
@@ -218,14 +234,33 @@ class State : public std::enable_shared_from_this<State> {
     return material_cellsets_[m]->index_in_set(c);
   }
 
-  /// Add cells to a material
+  /// Add cells to a material (cells already in it are ignored). Entries
+  /// of the new cells in multi-material state vectors are default
+  /// initialized
 
   void add_cells_to_material(int m, std::vector<int> const& cells);
 
-  /// Remove cells from a material (EXPENSIVE - NOT IMPLEMENTED)
+  /// Remove cells from a material. Entries of the remaining cells in
+  /// multi-material state vectors are kept
 
   void rem_cells_from_material(int m, std::vector<int> const& cells);
 
+  /*!
+    @brief Carry the data over to a new numbering of mesh entities
+    @param kind     Kind of entities that were renumbered
+    @param new2old  Old ID of each entity (see Mesh::entity_new_to_old)
+
+    Reorders the entries of all single-valued state vectors on entities
+    of this kind on the mesh. For cells, the materials of the cells are
+    renumbered too (the material sets are mesh sets, which the mesh
+    renumbers itself) and multi-material vectors are brought back to
+    MATERIAL_CENTRIC storage, which is unaffected since it follows
+    the order of the material sets. Vectors on mesh tiles are not
+    touched - tiles are rebuilt when the mesh is renumbered
+  */
+
+  void renumber_entities(Entity_kind kind, std::vector<int> const& new2old);
+
   //! Typedefs for iterators for going through all the state vectors
 
   typedef
@@ -294,18 +329,9 @@ class State : public std::enable_shared_from_this<State> {
                 Entity_kind kind = Entity_kind::ANY_KIND,
                 Entity_type type = Entity_type::ALL) {
 
-    iterator it = state_vectors_.begin();
-    while (it != state_vectors_.end()) {
-      std::shared_ptr<StateVectorBase> bv = *it;
-      if (bv->name() == name &&
-          ((kind == Entity_kind::ANY_KIND) || (bv->entity_kind() == kind)) &&
-          ((type == Entity_type::ALL) || (bv->entity_type() == type)))
-        break;
-      else
-        ++it;
-    }
-
-    return it;
+    int i = find_index(name, kind, type,
+                       [](Field_entry const&) { return true; });
+    return state_vectors_.begin() + i;
   }
 
 
@@ -334,18 +360,9 @@ class State : public std::enable_shared_from_this<State> {
                       Entity_kind kind = Entity_kind::ANY_KIND,
                       Entity_type type = Entity_type::ALL) const {
 
-    const_iterator it = state_vectors_.cbegin();
-    while (it != state_vectors_.cend()) {
-      std::shared_ptr<StateVectorBase> bv = *it;
-      if (bv->name() == name &&
-          ((kind == Entity_kind::ANY_KIND) || (bv->entity_kind() == kind)) &&
-          ((type == Entity_type::ALL) || (bv->entity_type() == type)))
-        break;
-      else
-        ++it;
-    }
-
-    return it;
+    int i = find_index(name, kind, type,
+                       [](Field_entry const&) { return true; });
+    return state_vectors_.cbegin() + i;
   }
 
 
@@ -373,31 +390,12 @@ class State : public std::enable_shared_from_this<State> {
                 Entity_kind kind = Entity_kind::ANY_KIND,
                 Entity_type type = Entity_type::ALL) {
 
-    iterator it = state_vectors_.begin();
-    while (it != state_vectors_.end()) {
-      std::shared_ptr<StateVectorBase> bv = *it;
-
-      if (bv->name() == name &&
-          ((kind == Entity_kind::ANY_KIND) || (bv->entity_kind() == kind)) &&
-          ((type == Entity_type::ALL) || (bv->entity_type() == type))) {
-
-        StateVector_type bvectype = bv->type();
-        if (bvectype == StateVector_type::UNIVAL) {
-          auto uvec =
-              std::dynamic_pointer_cast<UniStateVectorBase<DomainType>>(bv);
-          if (uvec && uvec->domain() == domain)
-            break;
-        } else if (bvectype == StateVector_type::MULTIVAL) {
-          auto mvec =
-              std::dynamic_pointer_cast<MultiStateVectorBase<DomainType>>(bv);
-          if (mvec && mvec->domain() == domain)
-            break;
-        }
-      }
-      ++it;
-    }
-
-    return it;
+    void const *dom = domain.get();
+    int i = find_index(name, kind, type,
+                       [dom](Field_entry const& f) {
+                         return f.domain == dom;
+                       });
+    return state_vectors_.begin() + i;
   }
 
 
@@ -427,31 +425,12 @@ class State : public std::enable_shared_from_this<State> {
                       Entity_kind kind = Entity_kind::ANY_KIND,
                       Entity_type type = Entity_type::ALL) const {
 
-    const_iterator it = state_vectors_.cbegin();
-    while (it != state_vectors_.cend()) {
-      std::shared_ptr<StateVectorBase> bv = *it;
-
-      if (bv->name() == name &&
-          ((kind == Entity_kind::ANY_KIND) || (bv->entity_kind() == kind)) &&
-          ((type == Entity_type::ALL) || (bv->entity_type() == type))) {
-
-        StateVector_type bvectype = bv->type();
-        if (bvectype == StateVector_type::UNIVAL) {
-          auto uvec =
-              std::dynamic_pointer_cast<UniStateVectorBase<DomainType>>(bv);
-          if (uvec && uvec->domain() == domain)
-            break;
-        } else if (bvectype == StateVector_type::MULTIVAL) {
-          auto mvec =
-              std::dynamic_pointer_cast<MultiStateVectorBase<DomainType>>(bv);
-          if (mvec && mvec->domain() == domain)
-            break;
-        }
-      }
-      ++it;
-    }
-
-    return it;
+    void const *dom = domain.get();
+    int i = find_index(name, kind, type,
+                       [dom](Field_entry const& f) {
+                         return f.domain == dom;
+                       });
+    return state_vectors_.cbegin() + i;
   }
 
 
@@ -480,33 +459,12 @@ class State : public std::enable_shared_from_this<State> {
                 Entity_kind kind = Entity_kind::ANY_KIND,
                 Entity_type type = Entity_type::ALL) {
 
-    iterator it = state_vectors_.begin();
-    while (it != state_vectors_.end()) {
-      std::shared_ptr<StateVectorBase> bv = *it;
-
-      if (bv->name() == name &&
-          ((kind == Entity_kind::ANY_KIND) || (bv->entity_kind() == kind)) &&
-          ((type == Entity_type::ALL) || (bv->entity_type() == type))) {
-
-        StateVector_type bvectype = bv->type();
-        if (vectype == StateVector_type::UNIVAL &&
-            bvectype == StateVector_type::UNIVAL) {
-          auto uvec =
-              std::dynamic_pointer_cast<UniStateVectorBase<DomainType>>(bv);
-          if (uvec && uvec->domain() == domain)
-            break;
-        } else if (vectype == StateVector_type::MULTIVAL &&
-                   bvectype == StateVector_type::MULTIVAL) {
-          auto mvec =
-              std::dynamic_pointer_cast<MultiStateVectorBase<DomainType>>(bv);
-          if (mvec && mvec->domain() == domain)
-            break;
-        }
-      }
-      ++it;
-    }
-
-    return it;
+    void const *dom = domain.get();
+    int i = find_index(name, kind, type,
+                       [dom](Field_entry const& f) {
+                         return f.domain == dom && f.vectype == vectype;
+                       });
+    return state_vectors_.begin() + i;
   }
 
 
@@ -537,33 +495,12 @@ class State : public std::enable_shared_from_this<State> {
                 Entity_kind kind = Entity_kind::ANY_KIND,
                 Entity_type type = Entity_type::ALL) const {
 
-    const_iterator it = state_vectors_.cbegin();
-    while (it != state_vectors_.cend()) {
-      std::shared_ptr<StateVectorBase> bv = *it;
-
-      if (bv->name() == name &&
-          ((kind == Entity_kind::ANY_KIND) || (bv->entity_kind() == kind)) &&
-          ((type == Entity_type::ALL) || (bv->entity_type() == type))) {
-
-        StateVector_type bvectype = bv->type();
-        if (vectype == StateVector_type::UNIVAL &&
-            bvectype == StateVector_type::UNIVAL) {
-          auto uvec =
-              std::dynamic_pointer_cast<UniStateVectorBase<DomainType>>(bv);
-          if (uvec && uvec->domain() == domain)
-            break;
-        } else if (vectype == StateVector_type::MULTIVAL &&
-                   bvectype == StateVector_type::MULTIVAL) {
-          auto mvec =
-              std::dynamic_pointer_cast<MultiStateVectorBase<DomainType>>(bv);
-          if (mvec && mvec->domain() == domain)
-            break;
-        }
-      }
-      ++it;
-    }
-
-    return it;
+    void const *dom = domain.get();
+    int i = find_index(name, kind, type,
+                       [dom](Field_entry const& f) {
+                         return f.domain == dom && f.vectype == vectype;
+                       });
+    return state_vectors_.cbegin() + i;
   }
 
 
@@ -661,22 +598,15 @@ class State : public std::enable_shared_from_this<State> {
                 Entity_kind kind = Entity_kind::ANY_KIND,
                 Entity_type type = Entity_type::ALL) {
 
-    iterator it = state_vectors_.begin();
-    while (it != state_vectors_.end()) {
-      std::shared_ptr<StateVecType<T, DomainType>> sv =
-          std::dynamic_pointer_cast<StateVecType<T, DomainType>>(*it);
-
-      // Check if we were able to cast the shared_ptr to BaseVector to
-      // StateVecType and all the other characteristics match
-      if (sv && (sv->name() == name) && (sv->domain() == domain) &&
-          ((kind == Entity_kind::ANY_KIND) || (sv->entity_kind() == kind)) &&
-          ((type == Entity_type::ALL) || (sv->entity_type() == type)))
-        break;
-      else
-        ++it;
-    }
-
-    return it;
+    // Compare the recorded concrete type of the vector instead of
+    // trying a dynamic cast on every candidate
+    void const *dom = domain.get();
+    std::type_index vt(typeid(StateVecType<T, DomainType>));
+    int i = find_index(name, kind, type,
+                       [dom, &vt](Field_entry const& f) {
+                         return f.domain == dom && f.vt == vt;
+                       });
+    return state_vectors_.begin() + i;
   }
 
 
@@ -707,22 +637,84 @@ class State : public std::enable_shared_from_this<State> {
                       Entity_kind kind = Entity_kind::ANY_KIND,
                       Entity_type type = Entity_type::ALL) const {
 
-    const_iterator it = state_vectors_.cbegin();
-    while (it != state_vectors_.cend()) {
-      std::shared_ptr<StateVecType<T, DomainType>> sv =
-          std::dynamic_pointer_cast<StateVecType<T, DomainType>>(*it);
-
-      // Check if we were able to cast the shared_ptr to BaseVector to
-      // StateVecType and all the other characteristics match
-      if (sv && (sv->name() == name) && (sv->domain() == domain) &&
-          ((kind == Entity_kind::ANY_KIND) || (sv->entity_kind() == kind)) &&
-          ((type == Entity_type::ALL) || (sv->entity_type() == type)))
-        break;
-      else
-        ++it;
-    }
+    // Compare the recorded concrete type of the vector instead of
+    // trying a dynamic cast on every candidate
+    void const *dom = domain.get();
+    std::type_index vt(typeid(StateVecType<T, DomainType>));
+    int i = find_index(name, kind, type,
+                       [dom, &vt](Field_entry const& f) {
+                         return f.domain == dom && f.vt == vt;
+                       });
+    return state_vectors_.cbegin() + i;
+  }
+
+
+
+  /// Handle to a state vector in the state manager - its position in
+  /// the list of state vectors. Vectors are never removed from the
+  /// state so a handle stays valid for the life of the state
+
+  typedef int Field_ID;
+
+  /*!
+    @brief Resolve the handle of a state vector of data type T
+    @tparam T          Data type
+    @tparam DomainType Type of domain data is defined on (Mesh, MeshTile)
+    @tparam StateVecType  State vector class (UniStateVector or MultiStateVector)
+    @param name        String identifier for vector
+    @param domain      Shared pointer to the domain
+    @param kind        What kind of entity data is defined on (CELL, NODE, etc.)
+    @param type        What type of entity data is defined on (PARALLEL_OWNED, PARALLEL_GHOST, BOUNDARY_GHOST, ALL etc.)
+
+    Returns the handle of the vector that find would return, or -1 if
+    there is no such vector. Kernels that access the same fields every
+    time step can resolve the handles once and then call field()
+    without any further lookups by name
+  */
+
+  template<class T, class DomainType,
+           template<class /* T */, class /* DomainType */> class StateVecType>
+  Field_ID field_id(std::string const& name,
+                    std::shared_ptr<DomainType> domain,
+                    Entity_kind kind = Entity_kind::ANY_KIND,
+                    Entity_type type = Entity_type::ALL) const {
+    const_iterator it = find<T, DomainType, StateVecType>(name, domain, kind,
+                                                          type);
+    return (it == cend()) ? -1 : static_cast<Field_ID>(it - cbegin());
+  }
+
+  /*!
+    @brief State vector with a given handle
+    @tparam T          Data type
+    @tparam DomainType Type of domain data is defined on (Mesh, MeshTile)
+    @tparam StateVecType  State vector class (UniStateVector or MultiStateVector)
+    @param id          Handle obtained from field_id with the same template parameters
+  */
+
+  template<class T, class DomainType,
+           template<class /* T */, class /* DomainType */> class StateVecType>
+  StateVecType<T, DomainType>& field(Field_ID id) {
+    assert(id >= 0 && id < size());
+    assert((dynamic_cast<StateVecType<T, DomainType> *>(
+        state_vectors_[id].get())));
+    return static_cast<StateVecType<T, DomainType>&>(*state_vectors_[id]);
+  }
 
-    return it;
+  /*!
+    @brief Const state vector with a given handle
+    @tparam T          Data type
+    @tparam DomainType Type of domain data is defined on (Mesh, MeshTile)
+    @tparam StateVecType  State vector class (UniStateVector or MultiStateVector)
+    @param id          Handle obtained from field_id with the same template parameters
+  */
+
+  template<class T, class DomainType,
+           template<class /* T */, class /* DomainType */> class StateVecType>
+  StateVecType<T, DomainType> const& field(Field_ID id) const {
+    assert(id >= 0 && id < size());
+    assert((dynamic_cast<StateVecType<T, DomainType> const *>(
+        state_vectors_[id].get())));
+    return static_cast<StateVecType<T, DomainType> const&>(*state_vectors_[id]);
   }
 
 
@@ -1065,19 +1057,11 @@ class State : public std::enable_shared_from_this<State> {
       // empty, so add the vector to the list; if not, warn about duplicate
       // state data
 
-      // add the index of this vector in state_vectors_ to the vector of
-      // indexes for this entity type, to allow iteration over state
-      // vectors on this entity type with a permutation iterator
-
-      int ikind = static_cast<int>(kind);
-      entity_indexes_[ikind].emplace_back(state_vectors_.size()-1);
-      names_.emplace_back(name);
-
       auto vector =
           std::make_shared<StateVecType<T, DomainType>>(name, domain,
                                                         shared_from_this(),
                                                         kind, type);
-      state_vectors_.emplace_back(vector);
+      register_vector(vector, domain.get());
       return (*vector);
     } else {
       // found a state vector by same name
@@ -1119,20 +1103,12 @@ class State : public std::enable_shared_from_this<State> {
       // empty, so add the vector to the list; if not, warn about duplicate
       // state data
 
-      // add the index of this vector in state_vectors_ to the vector of
-      // indexes for this entity type, to allow iteration over state
-      // vectors on this entity type with a permutation iterator
-
-      int ikind = static_cast<int>(kind);
-      entity_indexes_[ikind].emplace_back(state_vectors_.size()-1);
-      names_.emplace_back(name);
-
       auto vector =
           std::make_shared<UniStateVector<T, DomainType>>(name, domain,
                                                        shared_from_this(),
                                                        kind, type,
                                                        data);
-      state_vectors_.emplace_back(vector);
+      register_vector(vector, domain.get());
       return (*vector);
     } else {  // found a state vector by same name
       std::cerr << "Attempted to add duplicate state vector. Ignoring\n";
@@ -1172,20 +1148,12 @@ class State : public std::enable_shared_from_this<State> {
       // empty, so add the vector to the list; if not, warn about duplicate
       // state data
 
-      // add the index of this vector in state_vectors_ to the vector of
-      // indexes for this entity type, to allow iteration over state
-      // vectors on this entity type with a permutation iterator
-
-      int ikind = static_cast<int>(kind);
-      entity_indexes_[ikind].emplace_back(state_vectors_.size()-1);
-      names_.emplace_back(name);
-
       auto vector =
           std::make_shared<MultiStateVector<T, DomainType>>(name, domain,
                                                          shared_from_this(),
                                                          kind, type, layout,
                                                          data);
-      state_vectors_.emplace_back(vector);
+      register_vector(vector, domain.get());
       return (*vector);
     } else {  // found a state vector by same name
       std::cerr << "Attempted to add duplicate state vector. Ignoring\n";
@@ -1261,19 +1229,7 @@ class State : public std::enable_shared_from_this<State> {
           std::make_shared<StateVecType<T, DomainType>>(name, domain,
                                                         shared_from_this(),
                                                         kind, type, data);
-      state_vectors_.emplace_back(vector);
-
-      // add the index of this vector in state_vectors_ to the vector of
-      // indexes for this entity type, to allow iteration over state
-      // vectors on this entity type with a permutation iterator
-
-      int ikind = static_cast<int>(kind);
-      entity_indexes_[ikind].emplace_back(state_vectors_.size()-1);
-      names_.emplace_back(name);
-
-      // emplace back may cause reallocation of the vector so the iterator
-      // may not be valid. Use [] operator to get reference to vector
-
+      register_vector(vector, domain.get());
       return (*vector);
     } else {
       // found a state vector by same name
@@ -1335,21 +1291,8 @@ class State : public std::enable_shared_from_this<State> {
       } else {
         vector_copy = std::make_shared<StateVecType<T, DomainType>>(in_vec);
       }
-      state_vectors_.emplace_back(vector_copy);
-
-      // add the index of this vector in state_vectors_ to the vector of
-      // indexes for this entity type, to allow iteration over state
-      // vectors on this entity type with a permutation iterator
-
-      int nvec = state_vectors_.size();
-      int ikind = static_cast<int>(kind);
-      entity_indexes_[ikind].emplace_back(nvec-1);
-      names_.emplace_back(in_vec.name());
-
-      // emplace back may cause reallocation of the vector so the iterator
-      // may not be valid. Use [] operator to get reference to vector
-
-      return (*(std::dynamic_pointer_cast<StateVecType<T, DomainType>>(state_vectors_[nvec-1])));
+      register_vector(vector_copy, vector_copy->domain().get());
+      return (*vector_copy);
     } else {
       // found a state vector by same name
       std::cerr << "Attempted to add duplicate state vector. Ignoring\n" <<
@@ -1364,8 +1307,33 @@ class State : public std::enable_shared_from_this<State> {
 
 
   /// @brief Export field data to mesh
+  //
+  // Single-valued vectors are exported as they are and multi-material
+  // vectors as one cell field per material (<name>_<material>). This
+  // copies and writes synchronously; use a StateWriter
+  // (JaliStateWriter.h) to write the state without waiting for I/O
   void export_to_mesh();
 
+
+  /// @brief Write the mesh and the state to parallel VTK XML files
+  //
+  // Node and cell vectors are written straight from their storage
+  // without being stored on the mesh first, multi-material vectors
+  // as one cell array per material (<name>_<material>, zero outside
+  // the material). See Mesh::write_to_vtk_file. Collective
+  void write_to_vtk_file(std::string const& filename,
+                         bool compress = false) const;
+
+
+  /// @brief Read the vectors of a state file written by a StateWriter
+  //
+  // Reads this rank's file of 'filename' (see snapshot_filename).
+  // Vectors of the state with the name of a field in the file are
+  // overwritten, others are added. The mesh, the number of ranks and
+  // the cells of the materials must be those at the time of the
+  // write. Defined with the file format in JaliStateWriter.cc
+  void read_state_file(std::string const& filename);
+
  protected:
 
   /// Constructor (Private - Use create_state)
@@ -1386,6 +1354,30 @@ class State : public std::enable_shared_from_this<State> {
 
  private:
 
+  // Reorder entries of material m in multi-material state vectors
+  // after cells were added to or removed from the material
+  void remap_material_data(int m, std::vector<int> const& new2old);
+
+  // Store a state vector with values of type T on the mesh in one
+  // copy per array - a multi-material vector as one cell field per
+  // material (named <vector>_<material>, zero outside the material)
+  template <class T>
+  bool export_vector_to_mesh(std::shared_ptr<StateVectorBase> const& vec);
+
+  // Values of a multi-material vector as one array over all cells per
+  // material (zero outside the material)
+  template <class T>
+  void material_arrays(MultiStateVector<T> const& mvec,
+                       std::vector<std::vector<T>> *values) const;
+
+  // Describe a state vector with values of type T as arrays to write
+  // to a VTK file - the vector itself or, for a multi-material
+  // vector, per-material arrays kept alive in 'storage'
+  template <class T>
+  bool add_vtk_fields(std::shared_ptr<StateVectorBase> const& vec,
+                      std::vector<VTKField> *fields,
+                      std::vector<std::shared_ptr<void>> *storage) const;
+
   // Constant pointer to the mesh associated with this state
   const std::shared_ptr<Mesh> mymesh_;
 
@@ -1404,6 +1396,10 @@ class State : public std::enable_shared_from_this<State> {
   // Lists of materials in cells
   std::vector<std::vector<int>> cell_materials_;
 
+  // Compressed row map of materials and cells (built on demand,
+  // discarded whenever materials change)
+  mutable std::shared_ptr<MaterialMap const> material_map_;
+
   // All the state vectors
   std::vector<std::shared_ptr<StateVectorBase>> state_vectors_;
 
@@ -1414,6 +1410,62 @@ class State : public std::enable_shared_from_this<State> {
   // Names of the state vectors
   std::vector<std::string> names_;
 
+  // What a state vector is looked up by besides its name - recorded
+  // when the vector is added so that find can screen candidates
+  // without casting or calling into the vectors
+  struct Field_entry {
+    int index;                  // position in state_vectors_
+    Entity_kind kind;
+    Entity_type type;
+    void const *domain;         // Mesh or MeshTile the vector lives on
+    StateVector_type vectype;   // UNIVAL or MULTIVAL
+    std::type_index vt;         // concrete class of the vector
+  };
+
+  // State vectors hashed by name. Vectors sharing a name (on
+  // different entity kinds or domains) are kept in the order in which
+  // they were added so find returns the same vector a linear search
+  // over state_vectors_ would
+  std::unordered_map<std::string, std::vector<Field_entry>> field_index_;
+
+  // Append a state vector to the list and record it in the indexes
+
+  void register_vector(std::shared_ptr<StateVectorBase> vector,
+                       void const *domain) {
+    int index = state_vectors_.size();
+    Entity_kind kind = vector->entity_kind();
+    state_vectors_.emplace_back(vector);
+
+    // add the index of this vector in state_vectors_ to the vector of
+    // indexes for this entity type, to allow iteration over state
+    // vectors on this entity type with a permutation iterator
+
+    entity_indexes_[static_cast<int>(kind)].emplace_back(index);
+    names_.emplace_back(vector->name());
+
+    StateVectorBase const& v = *vector;
+    field_index_[vector->name()].push_back({index, kind,
+            vector->entity_type(), domain, vector->type(),
+            std::type_index(typeid(v))});
+  }
+
+  // Index of the first state vector with the given name, kind and
+  // type (ANY_KIND and ALL match anything) that also satisfies
+  // 'match'; size() if there is none
+
+  template <class Predicate>
+  int find_index(std::string const& name, Entity_kind kind, Entity_type type,
+                 Predicate match) const {
+    auto it = field_index_.find(name);
+    if (it == field_index_.end())
+      return state_vectors_.size();
+    for (Field_entry const& f : it->second)
+      if ((kind == Entity_kind::ANY_KIND || f.kind == kind) &&
+          (type == Entity_type::ALL || f.type == type) && match(f))
+        return f.index;
+    return state_vectors_.size();
+  }
+
 };
 
 std::ostream & operator<<(std::ostream & os, State const & s);
@@ -55,6 +55,7 @@
 
 #include "JaliStateVector.h"
 
+#include "errors.hh"
 #include "Mesh.hh"    // jali mesh header
 #include "MeshSet.hh"
 #include "JaliState.h"
@@ -78,4 +79,24 @@ std::shared_ptr<MeshSet> state_get_material_set(std::weak_ptr<State> state,
   return nullptr;
 }
 
+std::shared_ptr<MaterialMap const>
+state_get_material_map(std::weak_ptr<State> state) {
+  if (!state.expired()) {
+    std::shared_ptr<State> state_shared_ptr = state.lock();
+    return state_shared_ptr->material_map();
+  }
+  return nullptr;
+}
+
+void StateVectorBase::check_halo_update(HaloUpdate const& update) const {
+  if (entity_type_ != Entity_type::ALL) {
+    Errors::Message mesg("Ghost entries can only be updated for vectors on ALL entities");
+    Exceptions::Jali_throw(mesg);
+  }
+  if (entity_kind_ != update.halo()->kind()) {
+    Errors::Message mesg("Halo update is for a different entity kind than the vector");
+    Exceptions::Jali_throw(mesg);
+  }
+}
+
 }  // namespace Jali
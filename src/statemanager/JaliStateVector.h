@@ -55,9 +55,12 @@
 #include <string>
 #include <algorithm>
 #include <typeinfo>
+#include <type_traits>
 #include <cassert>
 
 #include "Mesh.hh"    // jali mesh header
+#include "MeshHalo.hh"
+#include "JaliMaterialMap.h"
 
 namespace Jali {
 
@@ -72,6 +75,8 @@ class State;
 int state_get_num_materials(std::weak_ptr<State> state);
 std::shared_ptr<MeshSet> state_get_material_set(std::weak_ptr<State> state,
                                                  int matindex);
+std::shared_ptr<MaterialMap const>
+state_get_material_map(std::weak_ptr<State> state);
 
 //! Send a std::array to output stream
 
@@ -139,6 +144,13 @@ class StateVectorBase {
   Entity_type entity_type() const { return entity_type_; }
 
  protected:
+
+  // Throw an exception if ghost entries of this vector cannot be
+  // refreshed by 'update' (vector has no ghost entries or is on
+  // entities of a different kind)
+
+  void check_halo_update(HaloUpdate const& update) const;
+
   std::string myname_;
   Entity_kind entity_kind_;
   Entity_type entity_type_;
@@ -250,6 +262,9 @@ class UniStateVectorBase : public StateVectorBase {
   /// Clear the vector -> number of entries will become 0
   virtual void clear() = 0;
 
+  /// Reorder the entries - new entry i is old entry new2old[i]
+  virtual void permute(std::vector<int> const& new2old) = 0;
+
  protected:
   std::shared_ptr<DomainType> mydomain_;
 
@@ -422,6 +437,47 @@ class UniStateVector : public UniStateVectorBase<DomainType> {
 
   void clear() {mydata_->clear();}
 
+  void permute(std::vector<int> const& new2old) {
+    assert(new2old.size() == mydata_->size());
+    std::vector<T> old(std::move(*mydata_));
+    mydata_->clear();
+    mydata_->reserve(old.size());
+    for (auto const& i : new2old)
+      mydata_->push_back(std::move(old[i]));
+  }
+
+  //! Refresh ghost entries of the vector together with other vectors
+  //! registered with 'update' (see HaloUpdate). The vector must be
+  //! defined on ALL entities of a mesh
+
+  void add_to_update(HaloUpdate *update) {
+    static_assert(std::is_same<DomainType, Mesh>::value,
+                  "Ghost entries can only be updated on vectors on a Mesh");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Ghost entries can only be updated for trivially copyable data");
+    StateVectorBase::check_halo_update(*update);
+    update->add(mydata_->data());
+  }
+
+  //! Start refreshing ghost entries from the values of their owners
+  //! on other ranks. Collective and non-blocking - ghost entries must
+  //! not be read and owned entries must not be modified until
+  //! finish_update is called
+
+  void start_update() {
+    myupdate_ = std::make_shared<HaloUpdate>(
+        this->mesh().halo(StateVectorBase::entity_kind_));
+    add_to_update(myupdate_.get());
+    myupdate_->start();
+  }
+
+  //! Complete the update of ghost entries begun by start_update
+
+  void finish_update() {
+    if (myupdate_) myupdate_->finish();
+    myupdate_.reset();
+  }
+
   //! Output the data
 
   std::ostream& print(std::ostream& os) const {
@@ -439,6 +495,7 @@ class UniStateVector : public UniStateVectorBase<DomainType> {
 
  private:
   std::shared_ptr<std::vector<T>> mydata_;
+  std::shared_ptr<HaloUpdate> myupdate_;  // ghost update in progress
 };  // UniStateVector
 
 //! Send UniStateVector to output stream
@@ -572,6 +629,14 @@ class MultiStateVectorBase : public StateVectorBase {
   // Remove a material and its entries from the vector
   virtual void rem_material(int m) = 0;
 
+  /// Reorder entries of a material after cells were added to or
+  /// removed from it - new entry i is old entry new2old[i] or a
+  /// default value if new2old[i] is -1 (see MeshSet::commit)
+  virtual void remap(int m, std::vector<int> const& new2old) = 0;
+
+  /// Store the data material by material or compactly cell by cell
+  virtual void set_storage_layout(Data_layout layout) = 0;
+
   //! Output the data (but only if it is arithmetic type)
   // DISABLED UNTIL WE CAN ENABLE IT ONLY FOR THOSE TYPES THAT CAN BE STREAMED
 
@@ -619,7 +684,14 @@ class MultiStateVectorBase : public StateVectorBase {
   materialID) operator. MultiStateVectors can be associated with a mesh
   or a mesh tile but as far as we can see, it does not make sense to
   associate it with a meshset.
-  t
+
+  By default the data is stored material by material - the entries of
+  material m are contiguous and in the order of the material's cell
+  set. Kernels that go over all the materials of each cell can switch
+  the vector to compact cell-centric storage (set_storage_layout) in
+  which the entries of a cell are contiguous and laid out as in the
+  State's MaterialMap
+
   @tparam DomainType  Mesh or Mesh Tile 
 */
 
@@ -713,6 +785,9 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
     mydata_ =
     std::make_shared<std::vector<std::vector<T>>>((in_vector.mydata_)->begin(),
                                                   (in_vector.mydata_)->end());
+    compact_ = in_vector.compact_ ?
+        std::make_shared<CompactData>(*(in_vector.compact_)) :
+        std::make_shared<CompactData>();
   }
 
   /*!
@@ -731,6 +806,7 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
     MultiStateVectorBase<DomainType>::mydomain_ = in_vector.mydomain_;
 
     mydata_ = in_vector.mydata_;  // shared_ptr counter will increment
+    compact_ = in_vector.compact_;
 
     return *this;
   }
@@ -743,6 +819,7 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
   void allocate() {
     int nummats = state_get_num_materials(StateVectorBase::mystate_);
     mydata_ = std::make_shared<std::vector<std::vector<T>>>(nummats);
+    compact_ = std::make_shared<CompactData>();
     for (int m = 0; m < nummats; m++) {
       // get entities in the material set 'm'
       std::shared_ptr<MeshSet> mset =
@@ -764,6 +841,7 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
   */
 
   void assign(Data_layout layout, T const * const * const data) {
+    to_material_centric();
     int nummats = state_get_num_materials(StateVectorBase::mystate_);
     mydata_->resize(nummats);
     
@@ -798,6 +876,7 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
   */
 
   void assign(T initval) {
+    to_material_centric();
     int nummats = state_get_num_materials(StateVectorBase::mystate_);
     mydata_->resize(nummats);
     
@@ -822,25 +901,88 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
 
   T *get_raw_data() { return &((*mydata_)[0]); }
 
-  /// Get the raw data for a material
+  /// Get the raw data for a material (material-centric storage only)
 
-  T *get_raw_data(int m) { return &((*mydata_)[m][0]); }
+  T *get_raw_data(int m) {
+    assert(!cell_centric());
+    return &((*mydata_)[m][0]);
+  }
 
-  /// Get the raw data for a material
+  /// Get the raw data for a material (material-centric storage only)
 
-  T const *get_raw_data(int m) const { return &((*mydata_)[m][0]); }
+  T const *get_raw_data(int m) const {
+    assert(!cell_centric());
+    return &((*mydata_)[m][0]);
+  }
 
   /// Get a shared ptr to the data
 
   std::shared_ptr<std::vector<std::vector<T>>> get_data() { return mydata_; }
 
-  /// Get a reference to the data for one material
+  /// Get a reference to the data for one material (material-centric
+  /// storage only)
+
+  std::vector<T>& get_matdata(int m) {
+    assert(!cell_centric());
+    return (*mydata_)[m];
+  }
+
+  /// Get a reference to the data for one material (material-centric
+  /// storage only)
 
-  std::vector<T>& get_matdata(int m) { return (*mydata_)[m]; }
+  std::vector<T> const& get_matdata(int m) const {
+    assert(!cell_centric());
+    return (*mydata_)[m];
+  }
+
+  /// Layout in which the data is currently stored
+
+  Data_layout storage_layout() const {
+    return cell_centric() ? Data_layout::CELL_CENTRIC :
+        Data_layout::MATERIAL_CENTRIC;
+  }
 
-  /// Get a reference to the data for one material
+  /*!
+    @brief Store the data material by material or compactly cell by cell
+    @param layout   MATERIAL_CENTRIC (default) or CELL_CENTRIC
+
+    With CELL_CENTRIC storage, the values of all materials in cell c
+    are entries offsets()[c] to offsets()[c+1]-1 of
+    get_cell_centric_data(), where offsets() and the material of each
+    entry come from cell_centric_map(). Per-material accessors
+    (get_matdata, get_raw_data(m), begin(m), ...) cannot be used in
+    this layout. Changes to the materials of the State or ghost
+    updates bring the vector back to MATERIAL_CENTRIC storage
+  */
+
+  void set_storage_layout(Data_layout layout) {
+    if (layout == Data_layout::CELL_CENTRIC)
+      to_cell_centric();
+    else
+      to_material_centric();
+  }
+
+  /// Material map that cell-centric data is laid out by (CELL_CENTRIC
+  /// storage only)
+
+  MaterialMap const& cell_centric_map() const {
+    assert(cell_centric());
+    return *(compact_->map);
+  }
 
-  std::vector<T> const& get_matdata(int m) const { return (*mydata_)[m]; }
+  /// Values of all materials in all cells (CELL_CENTRIC storage only)
+
+  std::vector<T>& get_cell_centric_data() {
+    assert(cell_centric());
+    return compact_->data;
+  }
+
+  /// Values of all materials in all cells (CELL_CENTRIC storage only)
+
+  std::vector<T> const& get_cell_centric_data() const {
+    assert(cell_centric());
+    return compact_->data;
+  }
 
   /// Type of data
 
@@ -854,10 +996,22 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
   typedef typename std::vector<T>::iterator iterator;
   typedef typename std::vector<T>::const_iterator const_iterator;
 
-  iterator begin(int m) { return (*mydata_)[m].begin(); }
-  iterator end(int m) { return (*mydata_)[m].end(); }
-  const_iterator cbegin(int m) const { return (*mydata_)[m].cbegin(); }
-  const_iterator cend(int m) const { return (*mydata_)[m].cend(); }
+  iterator begin(int m) {
+    assert(!cell_centric());
+    return (*mydata_)[m].begin();
+  }
+  iterator end(int m) {
+    assert(!cell_centric());
+    return (*mydata_)[m].end();
+  }
+  const_iterator cbegin(int m) const {
+    assert(!cell_centric());
+    return (*mydata_)[m].cbegin();
+  }
+  const_iterator cend(int m) const {
+    assert(!cell_centric());
+    return (*mydata_)[m].cend();
+  }
 
   
   /// @brief Value of field for a material 'm' in a cell 'c'
@@ -884,11 +1038,21 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
   /// This could be more efficient if 'c' were a local index in the
   /// material - then we wouldn't have to check for the local index in
   /// the material
+  ///
+  /// With CELL_CENTRIC storage, the entry is found among the few
+  /// entries of the cell without going through the State or the
+  /// material sets
 
   T operator()(int i, int j,
                Data_layout layout = Data_layout::MATERIAL_CENTRIC) const {
     int m = (layout == Data_layout::MATERIAL_CENTRIC) ? i : j;
     int c = (layout == Data_layout::MATERIAL_CENTRIC) ? j : i;
+
+    if (cell_centric()) {
+      int k = compact_->map->entry(c, m);
+      return (k != -1) ? compact_->data[k] : T(0);
+    }
+
     assert(m < state_get_num_materials(StateVectorBase::mystate_));
 
     std::shared_ptr<MeshSet> mset =
@@ -916,7 +1080,13 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
                        Data_layout layout = Data_layout::MATERIAL_CENTRIC) {
     int m = (layout == Data_layout::MATERIAL_CENTRIC) ? i : j;
     int c = (layout == Data_layout::MATERIAL_CENTRIC) ? j : i;
-    assert(m < state_get_num_materials(StateVectorBase::mystate_));
+
+    if (cell_centric()) {
+      int k = compact_->map->entry(c, m);
+      if (k == -1)
+        throw std::runtime_error("Cell does not contain material. Add it in the statemanager");
+      return compact_->data[k];
+    }
 
     assert(m < state_get_num_materials(StateVectorBase::mystate_));
     std::shared_ptr<MeshSet> mset =
@@ -932,24 +1102,38 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
   size_t size() const { return mydata_->size(); }
 
   /// Size of a particular material array
-  size_t size(int m) const { return (*mydata_)[m].size(); }
+  size_t size(int m) const {
+    return cell_centric() ? compact_->map->material_cells(m).size() :
+        (*mydata_)[m].size();
+  }
 
   /// Resize a particular material array
-  void resize(int m, size_t newsize) { (*mydata_)[m].resize(newsize); }
+  void resize(int m, size_t newsize) {
+    to_material_centric();
+    (*mydata_)[m].resize(newsize);
+  }
 
   /// Resize a particular material array and initialize new elements to val
   void resize(int m, size_t newsize, T val) {
+    to_material_centric();
     (*mydata_)[m].resize(newsize, val);
   }
 
   /// Clear out all the data
-  void clear() { mydata_->clear(); }
+  void clear() {
+    to_material_centric();
+    mydata_->clear();
+  }
 
   /// Clear out data for a material
-  void clear(int m) { (*mydata_)[m].clear(); }
+  void clear(int m) {
+    to_material_centric();
+    (*mydata_)[m].clear();
+  }
 
   /// Add a material and its entries to the vector
   void add_material(int ncells) {
+    to_material_centric();
     size_t nmats = mydata_->size();
     mydata_->resize(nmats+1);
     (*mydata_)[nmats].resize(ncells);
@@ -957,9 +1141,60 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
 
   // Remove a material and its entries from the vector
   void rem_material(int m) {
+    to_material_centric();
     mydata_->erase(mydata_->begin()+m);
   }
 
+  /// Reorder entries of a material after cells were added to or
+  /// removed from it (see MeshSet::commit)
+  void remap(int m, std::vector<int> const& new2old) {
+    to_material_centric();
+    std::vector<T>& olddata = (*mydata_)[m];
+    std::vector<T> newdata(new2old.size());
+    int n = new2old.size();
+    for (int i = 0; i < n; i++)
+      if (new2old[i] >= 0 && new2old[i] < static_cast<int>(olddata.size()))
+        newdata[i] = std::move(olddata[new2old[i]]);
+    olddata.swap(newdata);
+  }
+
+  //! Refresh ghost entries of all materials together with other
+  //! vectors registered with 'update' (see HaloUpdate). The vector
+  //! must be defined on ALL cells of a mesh and a ghost cell must be
+  //! in a material exactly when its owner is
+
+  void add_to_update(HaloUpdate *update) {
+    static_assert(std::is_same<DomainType, Mesh>::value,
+                  "Ghost entries can only be updated on vectors on a Mesh");
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Ghost entries can only be updated for trivially copyable data");
+    StateVectorBase::check_halo_update(*update);
+    to_material_centric();
+    int nmats = mydata_->size();
+    for (int m = 0; m < nmats; m++)
+      update->add((*mydata_)[m].data(),
+                  state_get_material_set(StateVectorBase::mystate_, m));
+  }
+
+  //! Start refreshing ghost entries from the values of their owners
+  //! on other ranks. Collective and non-blocking - ghost entries must
+  //! not be read and owned entries must not be modified until
+  //! finish_update is called
+
+  void start_update() {
+    myupdate_ = std::make_shared<HaloUpdate>(
+        this->mesh().halo(StateVectorBase::entity_kind_));
+    add_to_update(myupdate_.get());
+    myupdate_->start();
+  }
+
+  //! Complete the update of ghost entries begun by start_update
+
+  void finish_update() {
+    if (myupdate_) myupdate_->finish();
+    myupdate_.reset();
+  }
+
   //! Output the data (but only if it is arithmetic type)
   // DISABLED UNTIL WE CAN ENABLE IT ONLY FOR THOSE TYPES THAT CAN BE STREAMED
 
@@ -980,11 +1215,60 @@ class MultiStateVector : public MultiStateVectorBase<DomainType> {
   // }
 
  private:
-  // Should we flatten this for read access and rework it when the
-  // state manager adds new cells to material sets (same as adding
-  // materials to cells)? May be needed for accelerators
+  // Cell-centric compact storage. 'map' is the material map the data
+  // is laid out by and is null when the data is in mydata_ instead
+  struct CompactData {
+    std::shared_ptr<MaterialMap const> map;
+    std::vector<T> data;
+  };
+
+  bool cell_centric() const { return compact_ && compact_->map; }
+
+  // Gather the per-material arrays into cell-centric order
+
+  void to_cell_centric() {
+    if (cell_centric()) return;
+    std::shared_ptr<MaterialMap const> map =
+        state_get_material_map(StateVectorBase::mystate_);
+    assert(map && map->num_materials() ==
+           static_cast<int>(mydata_->size()));
+
+    std::vector<int> const& emats = map->entry_materials();
+    std::vector<int> const& eindices = map->entry_material_indices();
+    int nentries = map->num_entries();
+    compact_->data.resize(nentries);
+    for (int k = 0; k < nentries; k++) {
+      assert(eindices[k] < static_cast<int>((*mydata_)[emats[k]].size()));
+      compact_->data[k] = std::move((*mydata_)[emats[k]][eindices[k]]);
+    }
+    for (auto & matdata : *mydata_)
+      std::vector<T>().swap(matdata);
+    compact_->map = map;
+  }
+
+  // Scatter cell-centric data back into per-material arrays, using
+  // the map the data was laid out by (materials may have changed since)
+
+  void to_material_centric() {
+    if (!cell_centric()) return;
+    MaterialMap const& map = *(compact_->map);
+    int nmats = map.num_materials();
+    mydata_->resize(nmats);
+    for (int m = 0; m < nmats; m++)
+      (*mydata_)[m].resize(map.material_cells(m).size());
+
+    std::vector<int> const& emats = map.entry_materials();
+    std::vector<int> const& eindices = map.entry_material_indices();
+    int nentries = map.num_entries();
+    for (int k = 0; k < nentries; k++)
+      (*mydata_)[emats[k]][eindices[k]] = std::move(compact_->data[k]);
+    std::vector<T>().swap(compact_->data);
+    compact_->map.reset();
+  }
 
   std::shared_ptr<std::vector<std::vector<T>>> mydata_;
+  std::shared_ptr<CompactData> compact_;
+  std::shared_ptr<HaloUpdate> myupdate_;  // ghost update in progress
 };  // MultiStateVector
 
 
@@ -0,0 +1,614 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "JaliStateWriter.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <typeinfo>
+
+#include "errors.hh"
+#include "instrumentation.hh"
+#include "MeshSnapshot.hh"
+#include "JaliState.h"
+#include "JaliStateVector.h"
+
+namespace Jali {
+
+namespace {
+
+char const STATE_FILE_MAGIC[8] = {'J', 'A', 'L', 'I', 'S', 'T', 'A', 'T'};
+std::uint32_t const STATE_FILE_BYTE_ORDER = 0x01020304;
+
+double seconds_since(std::chrono::steady_clock::time_point const start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+// Appends items to a staging buffer, each at a multiple of 8 bytes.
+// clear() on the buffer keeps its capacity, so a reused buffer only
+// grows when a file is larger than any before it
+
+class StagingBuffer {
+ public:
+  explicit StagingBuffer(std::vector<char> *buffer) : buf_(*buffer) {}
+
+  std::size_t size() const { return buf_.size(); }
+
+  // Make room for nbytes and return where they start
+
+  std::size_t reserve(std::size_t const nbytes) {
+    std::size_t const pos = buf_.size();
+    buf_.resize(pos + (nbytes + 7)/8*8);
+    return pos;
+  }
+
+  std::size_t append(void const *data, std::size_t const nbytes) {
+    std::size_t const pos = reserve(nbytes);
+    if (nbytes) std::memcpy(&buf_[pos], data, nbytes);
+    return pos;
+  }
+
+  char *at(std::size_t const pos) { return &buf_[pos]; }
+
+ private:
+  std::vector<char>& buf_;
+};
+
+
+// Start a field record; the caller fills in nbytes once the data is
+// appended
+
+std::size_t begin_field(std::shared_ptr<StateVectorBase> const& vec,
+                        StateFile_scalar const scalar_type,
+                        int const num_components, int const num_materials,
+                        StagingBuffer *buf) {
+  std::string const name = vec->name();
+  StateFileField field = {};
+  field.name_length = name.size();
+  field.entity_kind = static_cast<std::int32_t>(vec->entity_kind());
+  field.entity_type = static_cast<std::int32_t>(vec->entity_type());
+  field.vector_type = static_cast<std::int32_t>(vec->type());
+  field.scalar_type = static_cast<std::int32_t>(scalar_type);
+  field.num_components = num_components;
+  field.num_materials = num_materials;
+  std::size_t const pos = buf->append(&field, sizeof(field));
+  buf->append(name.data(), name.size());
+  return pos;
+}
+
+void end_field(std::size_t const pos, StagingBuffer *buf) {
+  std::uint64_t const nbytes = buf->size() - pos - sizeof(StateFileField);
+  std::memcpy(buf->at(pos) + offsetof(StateFileField, nbytes), &nbytes,
+              sizeof(nbytes));
+}
+
+
+// Stage a vector if its values are of type T (on the whole mesh)
+
+template <class T>
+bool stage_vector(std::shared_ptr<StateVectorBase> const& vec,
+                  State const& state, StateFile_scalar const scalar_type,
+                  int const num_components, StagingBuffer *buf) {
+  if (vec->type() == StateVector_type::UNIVAL) {
+    auto uvec = std::dynamic_pointer_cast<UniStateVector<T>>(vec);
+    if (!uvec) return false;
+
+    std::size_t const pos = begin_field(vec, scalar_type, num_components, 1,
+                                        buf);
+    std::uint64_t const count = uvec->size();
+    buf->append(&count, sizeof(count));
+    if (count) buf->append(uvec->get_raw_data(), count*sizeof(T));
+    end_field(pos, buf);
+    return true;
+  }
+
+  auto mvec = std::dynamic_pointer_cast<MultiStateVector<T>>(vec);
+  if (!mvec) return false;
+
+  int const nmats = mvec->size();
+  std::size_t const pos = begin_field(vec, scalar_type, num_components, nmats,
+                                      buf);
+
+  if (mvec->storage_layout() == Data_layout::MATERIAL_CENTRIC) {
+    for (int m = 0; m < nmats; m++) {
+      std::vector<int> const& cells = state.material_cells(m);
+      std::vector<T> const& matdata = mvec->get_matdata(m);
+      assert(cells.size() == matdata.size());
+      std::uint64_t const count = matdata.size();
+      buf->append(&count, sizeof(count));
+      buf->append(cells.data(), count*sizeof(int));
+      buf->append(matdata.data(), count*sizeof(T));
+    }
+  } else {
+    // Lay out the materials one after the other and then scatter the
+    // cell-centric entries into them in a single pass
+
+    MaterialMap const& map = mvec->cell_centric_map();
+    std::vector<std::size_t> matpos(nmats);
+    for (int m = 0; m < nmats; m++) {
+      ArrayView<int> const cells = map.material_cells(m);
+      std::uint64_t const count = cells.size();
+      buf->append(&count, sizeof(count));
+      buf->append(cells.data(), count*sizeof(int));
+      matpos[m] = buf->reserve(count*sizeof(T));
+    }
+
+    std::vector<T> const& data = mvec->get_cell_centric_data();
+    std::vector<int> const& emats = map.entry_materials();
+    std::vector<int> const& eindices = map.entry_material_indices();
+    int const nentries = map.num_entries();
+    for (int k = 0; k < nentries; k++)
+      std::memcpy(buf->at(matpos[emats[k]] + eindices[k]*sizeof(T)),
+                  &data[k], sizeof(T));
+  }
+
+  end_field(pos, buf);
+  return true;
+}
+
+
+// Stage a vector of any of the types that can be written
+
+bool stage_any_vector(std::shared_ptr<StateVectorBase> const& vec,
+                      State const& state, StagingBuffer *buf) {
+  std::type_info const& type = vec->data_type();
+  if (type == typeid(double))
+    return stage_vector<double>(vec, state, StateFile_scalar::FLOAT64, 1, buf);
+  else if (type == typeid(int))
+    return stage_vector<int>(vec, state, StateFile_scalar::INT32, 1, buf);
+  else if (type == typeid(float))
+    return stage_vector<float>(vec, state, StateFile_scalar::FLOAT32, 1, buf);
+  else if (type == typeid(std::array<double, 2>))
+    return stage_vector<std::array<double, 2>>(vec, state,
+                                               StateFile_scalar::FLOAT64, 2,
+                                               buf);
+  else if (type == typeid(std::array<double, 3>))
+    return stage_vector<std::array<double, 3>>(vec, state,
+                                               StateFile_scalar::FLOAT64, 3,
+                                               buf);
+  else if (type == typeid(std::array<double, 6>))
+    return stage_vector<std::array<double, 6>>(vec, state,
+                                               StateFile_scalar::FLOAT64, 6,
+                                               buf);
+  return false;
+}
+
+
+void throw_bad_file(std::string const& filename, std::string const& what) {
+  Errors::Message mesg("State file " + filename + ": " + what);
+  Exceptions::Jali_throw(mesg);
+}
+
+
+// Takes the items of a state file in order, checking that each lies
+// within the file
+
+class FileReader {
+ public:
+  FileReader(std::vector<char> const& bytes, std::string const& filename) :
+      bytes_(bytes), filename_(filename) {}
+
+  std::size_t pos() const { return pos_; }
+
+  char const *take(std::size_t const nbytes) {
+    if (nbytes > bytes_.size() - pos_)
+      throw_bad_file(filename_, "truncated");
+    char const *data = bytes_.data() + pos_;
+    pos_ = std::min(pos_ + (nbytes + 7)/8*8, bytes_.size());
+    return data;
+  }
+
+  template <class U> U get() {
+    U u;
+    std::memcpy(&u, take(sizeof(U)), sizeof(U));
+    return u;
+  }
+
+ private:
+  std::vector<char> const& bytes_;
+  std::string const& filename_;
+  std::size_t pos_ = 0;
+};
+
+
+// Read a field with values of type T into a new or existing vector
+
+template <class T>
+void read_vector(StateFileField const& field, std::string const& name,
+                 std::string const& filename, FileReader *file,
+                 State *state) {
+  std::shared_ptr<Mesh> mesh = state->mesh();
+  Entity_kind const kind = static_cast<Entity_kind>(field.entity_kind);
+  Entity_type const type = static_cast<Entity_type>(field.entity_type);
+
+  if (field.vector_type == static_cast<std::int32_t>(StateVector_type::UNIVAL)) {
+    std::uint64_t const count = file->get<std::uint64_t>();
+    if (count != mesh->num_entities(kind, type))
+      throw_bad_file(filename, "vector " + name +
+                     " does not match the entities of the mesh");
+    char const *data = file->take(count*sizeof(T));
+
+    auto it = state->find<T, Mesh, UniStateVector>(name, mesh, kind, type);
+    if (it == state->end()) {
+      if (state->find<Mesh, StateVector_type::UNIVAL>(name, mesh, kind, type)
+          != state->end())
+        throw_bad_file(filename, "vector " + name +
+                       " has another data type in the state");
+      state->add<T, Mesh, UniStateVector>(name, mesh, kind, type, T());
+      it = state->find<T, Mesh, UniStateVector>(name, mesh, kind, type);
+    }
+    auto uvec = std::dynamic_pointer_cast<UniStateVector<T>>(*it);
+    if (count) std::memcpy(uvec->get_raw_data(), data, count*sizeof(T));
+    return;
+  }
+
+  int const nmats = state->num_materials();
+  if (field.num_materials != static_cast<std::uint32_t>(nmats))
+    throw_bad_file(filename, "vector " + name +
+                   " does not match the materials of the state");
+
+  auto it = state->find<T, Mesh, MultiStateVector>(name, mesh, kind, type);
+  if (it == state->end()) {
+    if (state->find<Mesh, StateVector_type::MULTIVAL>(name, mesh, kind, type)
+        != state->end())
+      throw_bad_file(filename, "vector " + name +
+                     " has another data type in the state");
+    state->add<T, Mesh, MultiStateVector>(name, mesh, kind, type, T());
+    it = state->find<T, Mesh, MultiStateVector>(name, mesh, kind, type);
+  }
+  auto mvec = std::dynamic_pointer_cast<MultiStateVector<T>>(*it);
+
+  for (int m = 0; m < nmats; m++) {
+    std::uint64_t const count = file->get<std::uint64_t>();
+    char const *cells = file->take(count*sizeof(int));
+    char const *data = file->take(count*sizeof(T));
+
+    std::vector<int> const& matcells = state->material_cells(m);
+    if (count != matcells.size() ||
+        (count && std::memcmp(cells, matcells.data(), count*sizeof(int))))
+      throw_bad_file(filename, "vector " + name +
+                     " does not match the materials of the state");
+
+    if (mvec->storage_layout() == Data_layout::MATERIAL_CENTRIC) {
+      if (count) std::memcpy(mvec->get_matdata(m).data(), data,
+                             count*sizeof(T));
+    } else {
+      for (std::size_t i = 0; i < count; i++)
+        std::memcpy(&(*mvec)(m, matcells[i]), data + i*sizeof(T), sizeof(T));
+    }
+  }
+}
+
+
+// Read a field of any of the types that can be written
+
+void read_any_vector(StateFileField const& field, std::string const& name,
+                     std::string const& filename, FileReader *file,
+                     State *state) {
+  if (field.vector_type != static_cast<std::int32_t>(StateVector_type::UNIVAL) &&
+      field.vector_type != static_cast<std::int32_t>(StateVector_type::MULTIVAL))
+    throw_bad_file(filename, "vector " + name + " has an unknown type");
+
+  StateFile_scalar const scalar_type =
+      static_cast<StateFile_scalar>(field.scalar_type);
+  if (scalar_type == StateFile_scalar::FLOAT64) {
+    if (field.num_components == 1)
+      return read_vector<double>(field, name, filename, file, state);
+    else if (field.num_components == 2)
+      return read_vector<std::array<double, 2>>(field, name, filename, file,
+                                                state);
+    else if (field.num_components == 3)
+      return read_vector<std::array<double, 3>>(field, name, filename, file,
+                                                state);
+    else if (field.num_components == 6)
+      return read_vector<std::array<double, 6>>(field, name, filename, file,
+                                                state);
+  } else if (field.num_components == 1) {
+    if (scalar_type == StateFile_scalar::INT32)
+      return read_vector<int>(field, name, filename, file, state);
+    else if (scalar_type == StateFile_scalar::FLOAT32)
+      return read_vector<float>(field, name, filename, file, state);
+  }
+  throw_bad_file(filename, "vector " + name + " has an unknown data type");
+}
+
+}  // namespace
+
+
+StateWriter::StateWriter(std::shared_ptr<State> state, int max_pending) :
+    state_(state), max_pending_(std::max(max_pending, 1)) {
+  MPI_Comm const comm = state_->mesh()->get_comm();
+  MPI_Comm_size(comm, &nprocs_);
+  MPI_Comm_rank(comm, &rank_);
+  thread_ = std::thread(&StateWriter::run, this);
+}
+
+
+StateWriter::~StateWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();  // the I/O thread finishes the queue before it stops
+
+  if (error_) {
+    try {
+      std::rethrow_exception(error_);
+    } catch (std::exception const& e) {
+      std::cerr << "StateWriter: " << e.what() << "\n";
+    }
+  }
+}
+
+
+void StateWriter::write(std::string const& filename) {
+  write(filename, std::vector<std::string>());
+}
+
+
+void StateWriter::write(std::string const& filename,
+                        std::vector<std::string> const& names) {
+  JALI_TIME_SCOPE("StateWriter::write");
+
+  // Get a free staging buffer, waiting for the I/O thread if all of
+  // them are in use
+
+  std::unique_ptr<Job> job;
+  {
+    auto const start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&]() {
+        return error_ || !free_.empty() || num_jobs_ < max_pending_;
+      });
+    rethrow_error();
+    if (!free_.empty()) {
+      job = std::move(free_.back());
+      free_.pop_back();
+    } else {
+      job.reset(new Job);
+      num_jobs_++;
+    }
+    stats_.stall_seconds += seconds_since(start);
+  }
+
+  auto const start = std::chrono::steady_clock::now();
+  job->filename = snapshot_filename(filename,
+                                    state_->mesh()->get_comm());
+  stage(names.empty() ? nullptr : &names, job.get());
+  double const stage_seconds = seconds_since(start);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.stage_seconds += stage_seconds;
+    queue_.push_back(std::move(job));
+    stats_.max_queued = std::max(stats_.max_queued,
+                                 static_cast<int>(queue_.size()));
+  }
+  cv_.notify_all();
+}
+
+
+void StateWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [&]() { return queue_.empty() && !busy_; });
+  rethrow_error();
+}
+
+
+StateWriter::Statistics StateWriter::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+
+// Copy the selected vectors into the job's buffer laid out as the file
+
+void StateWriter::stage(std::vector<std::string> const *names,
+                        Job *job) const {
+  job->buffer.clear();
+  StagingBuffer buf(&job->buffer);
+
+  StateFileHeader header = {};
+  buf.append(&header, sizeof(header));
+
+  std::uint32_t nfields = 0;
+  State const& state = *state_;
+  for (auto it = state.cbegin(); it != state.cend(); ++it) {
+    std::shared_ptr<StateVectorBase> const& vec = *it;
+    if (names && std::find(names->begin(), names->end(), vec->name()) ==
+        names->end())
+      continue;
+
+    if (stage_any_vector(vec, state, &buf))
+      nfields++;
+    else
+      std::cerr << "Could not write vector " << vec->name() <<
+          " to state file\n";
+  }
+
+  std::memcpy(header.magic, STATE_FILE_MAGIC, sizeof(header.magic));
+  header.version = STATE_FILE_VERSION;
+  header.byte_order = STATE_FILE_BYTE_ORDER;
+  header.nprocs = nprocs_;
+  header.rank = rank_;
+  header.num_fields = nfields;
+  header.file_size = buf.size();
+  std::memcpy(buf.at(0), &header, sizeof(header));
+}
+
+
+// Write a staged file (on the I/O thread). The data go to a temporary
+// file that is moved into place when complete so that a failed write
+// does not leave a partial file behind
+
+void StateWriter::write_file(Job const& job) const {
+  std::string const tmpfile = job.filename + ".tmp";
+  {
+    std::ofstream os(tmpfile.c_str(), std::ios::binary | std::ios::trunc);
+    os.write(job.buffer.data(), job.buffer.size());
+    os.close();
+    if (!os) {
+      std::remove(tmpfile.c_str());
+      Errors::Message mesg("Error writing state file " + tmpfile);
+      Exceptions::Jali_throw(mesg);
+    }
+  }
+  if (std::rename(tmpfile.c_str(), job.filename.c_str()) != 0) {
+    Errors::Message mesg("Cannot rename " + tmpfile + " to " + job.filename);
+    Exceptions::Jali_throw(mesg);
+  }
+  JALI_COUNT_BYTES("StateWriter::write_file", job.buffer.size());
+}
+
+
+// I/O thread - write staged files in order until stopped and the
+// queue is empty
+
+void StateWriter::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [&]() { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) return;  // stopped
+
+    std::unique_ptr<Job> job = std::move(queue_.front());
+    queue_.pop_front();
+    busy_ = true;
+    lock.unlock();
+
+    auto const start = std::chrono::steady_clock::now();
+    bool written = false;
+    try {
+      write_file(*job);
+      written = true;
+    } catch (...) {
+      lock.lock();
+      if (!error_) error_ = std::current_exception();
+      lock.unlock();
+    }
+    double const write_seconds = seconds_since(start);
+
+    lock.lock();
+    busy_ = false;
+    if (written) {
+      stats_.files_written++;
+      stats_.bytes_written += job->buffer.size();
+    }
+    stats_.write_seconds += write_seconds;
+    free_.push_back(std::move(job));
+    cv_.notify_all();
+  }
+}
+
+
+// Throw the first error of the I/O thread (called with mutex_ held).
+// The error is reported once
+
+void StateWriter::rethrow_error() {
+  if (!error_) return;
+  std::exception_ptr error = error_;
+  error_ = nullptr;
+  std::rethrow_exception(error);
+}
+
+
+void State::read_state_file(std::string const& filename) {
+  JALI_TIME_SCOPE("State::read_state_file");
+
+  MPI_Comm const comm = mymesh_->get_comm();
+  std::string const rankfile = snapshot_filename(filename, comm);
+  std::ifstream is(rankfile.c_str(), std::ios::binary);
+  if (!is) {
+    Errors::Message mesg("Cannot open state file " + rankfile);
+    Exceptions::Jali_throw(mesg);
+  }
+  std::vector<char> const bytes((std::istreambuf_iterator<char>(is)),
+                                std::istreambuf_iterator<char>());
+  JALI_COUNT_BYTES("State::read_state_file", bytes.size());
+
+  FileReader file(bytes, rankfile);
+  StateFileHeader const header = file.get<StateFileHeader>();
+  if (std::memcmp(header.magic, STATE_FILE_MAGIC, sizeof(header.magic)))
+    throw_bad_file(rankfile, "not a state file");
+  if (header.byte_order != STATE_FILE_BYTE_ORDER)
+    throw_bad_file(rankfile, "written with another byte order");
+  if (header.version != STATE_FILE_VERSION)
+    throw_bad_file(rankfile, "unknown version " +
+                   std::to_string(header.version));
+  if (header.file_size != bytes.size())
+    throw_bad_file(rankfile, "truncated");
+
+  int nprocs, rank;
+  MPI_Comm_size(comm, &nprocs);
+  MPI_Comm_rank(comm, &rank);
+  if (header.nprocs != nprocs || header.rank != rank)
+    throw_bad_file(rankfile, "written by rank " +
+                   std::to_string(header.rank) + " of " +
+                   std::to_string(header.nprocs));
+
+  for (std::uint32_t i = 0; i < header.num_fields; i++) {
+    StateFileField const field = file.get<StateFileField>();
+    std::size_t const end = file.pos() + field.nbytes;
+    std::string const name(file.take(field.name_length), field.name_length);
+    read_any_vector(field, name, rankfile, &file, this);
+    if (file.pos() != end)
+      throw_bad_file(rankfile, "vector " + name + " has a bad size");
+  }
+}
+
+}  // namespace Jali
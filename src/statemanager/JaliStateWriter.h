@@ -0,0 +1,216 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef JALI_STATE_WRITER_H_
+#define JALI_STATE_WRITER_H_
+
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+namespace Jali {
+
+class State;
+
+/*!
+  @file JaliStateWriter.h
+  @brief Binary state files written in the background
+
+  A state file holds the data of the selected state vectors of one
+  rank - 'filename' on one rank and 'filename.<nprocs>.<rank>' on
+  more (see snapshot_filename). It is written in the byte order of
+  the writing machine:
+
+    StateFileHeader
+    num_fields records, each a StateFileField followed by
+
+      the name (name_length chars)
+      UNIVAL:   std::uint64_t count, count values
+      MULTIVAL: for each material, std::uint64_t count, the count
+                cells of the material (int) and their count values
+
+  Every item starts at a multiple of 8 bytes. A value is
+  num_components scalars of scalar_type.
+
+  State::read_state_file reads a state file back into a State.
+*/
+
+/// Version of the state file format written by StateWriter
+
+const std::uint32_t STATE_FILE_VERSION = 1;
+
+/// Scalar type of the values of a field in a state file
+
+enum class StateFile_scalar : std::int32_t {INT32, FLOAT32, FLOAT64};
+
+struct StateFileHeader {
+  char magic[8];                 // "JALISTAT"
+  std::uint32_t version;
+  std::uint32_t byte_order;      // 0x01020304 as written
+  std::int32_t nprocs;
+  std::int32_t rank;
+  std::uint32_t num_fields;
+  std::uint32_t reserved;
+  std::uint64_t file_size;
+};
+
+struct StateFileField {
+  std::uint64_t nbytes;          // bytes of the record after this struct
+  std::uint32_t name_length;
+  std::int32_t entity_kind;      // Entity_kind
+  std::int32_t entity_type;      // Entity_type
+  std::int32_t vector_type;      // StateVector_type
+  std::int32_t scalar_type;      // StateFile_scalar
+  std::uint32_t num_components;
+  std::uint32_t num_materials;   // 1 for UNIVAL
+  std::uint32_t reserved;
+};
+
+
+/*!
+  @class StateWriter JaliStateWriter.h
+  @brief Write state files without stalling the simulation
+
+  write() copies the data of the state vectors into a staging buffer
+  laid out as the file and returns; a background I/O thread writes
+  the buffer out. At most max_pending files are staged or being
+  written at a time (two by default, i.e. double buffering) - a
+  write() beyond that waits for the oldest file to be written. The
+  staging buffers are reused so that writes in steady state do not
+  allocate.
+
+  Vectors of int, float, double and std::array<double, 2|3|6> on the
+  whole mesh (UniStateVector and MultiStateVector) can be written;
+  others are skipped with a message. Writing is local to each rank -
+  no communication is involved.
+
+  An error in the background is rethrown by the next write() or
+  flush(). The destructor waits for pending files to be written.
+*/
+
+class StateWriter {
+ public:
+
+  /// Writer for vectors of 'state' keeping at most max_pending files
+  /// staged or in flight
+
+  explicit StateWriter(std::shared_ptr<State> state, int max_pending = 2);
+
+  StateWriter(StateWriter const&) = delete;
+  StateWriter& operator=(StateWriter const&) = delete;
+
+  /// Wait for pending files and stop the I/O thread
+
+  ~StateWriter();
+
+  /// Stage all the (writable) state vectors and write them to
+  /// 'filename' in the background
+
+  void write(std::string const& filename);
+
+  /// Stage the state vectors with the given names and write them to
+  /// 'filename' in the background
+
+  void write(std::string const& filename,
+             std::vector<std::string> const& names);
+
+  /// Wait until all staged files have been written
+
+  void flush();
+
+  /// What the writer has done so far
+
+  struct Statistics {
+    int files_written = 0;
+    std::uint64_t bytes_written = 0;
+    double stall_seconds = 0.0;   // write() waiting for a free buffer
+    double stage_seconds = 0.0;   // write() copying the data
+    double write_seconds = 0.0;   // I/O thread writing files
+    int max_queued = 0;           // most files staged at one time
+  };
+
+  Statistics statistics() const;
+
+ private:
+  struct Job {
+    std::string filename;
+    std::vector<char> buffer;
+  };
+
+  void stage(std::vector<std::string> const* names, Job *job) const;
+  void write_file(Job const& job) const;
+  void run();
+  void rethrow_error();
+
+  std::shared_ptr<State> state_;
+  int const max_pending_;
+  int nprocs_ = 1, rank_ = 0;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::unique_ptr<Job>> queue_;   // staged, oldest first
+  std::vector<std::unique_ptr<Job>> free_;   // written, for reuse
+  int num_jobs_ = 0;                         // allocated jobs
+  bool busy_ = false;                        // I/O thread writing
+  bool stop_ = false;
+  std::exception_ptr error_;
+  Statistics stats_;
+
+  std::thread thread_;
+};
+
+}  // namespace Jali
+
+#endif  // JALI_STATE_WRITER_H_
@@ -48,7 +48,11 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <mpi.h>
 #include <stdlib.h>
 
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 
 #include "JaliState.h"
 #include "JaliStateVector.h"
@@ -1290,3 +1294,474 @@ TEST(State_Write_Read_With_Mesh) {
     CHECK(found);
   }
 }
+
+
+// Test moving cells between materials - entries of the cells that
+// stay in a material must be preserved in multi-material vectors
+
+TEST(Jali_MMState_Move_Cells) {
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                        3, 3, 3);
+  int ncells = mesh->num_cells();
+
+  std::shared_ptr<Jali::State> mystate = Jali::State::create(mesh);
+
+  std::vector<int> matcells0(ncells), matcells1;
+  for (int c = 0; c < ncells; c++) {
+    matcells0[c] = c;
+    if (c < 10) matcells1.push_back(c);
+  }
+  mystate->add_material("mat0", matcells0);
+  mystate->add_material("mat1", matcells1);
+
+  Jali::MultiStateVector<double>& vf =
+      mystate->add<double, Jali::Mesh, Jali::MultiStateVector>("volfrac", mesh,
+                   Jali::Entity_kind::CELL, Jali::Entity_type::ALL);
+  for (int m = 0; m < 2; m++)
+    for (auto const& c : (m == 0 ? matcells0 : matcells1))
+      vf(m, c) = 100*m + c;
+
+  // Move cells 2, 5 and 7 from material 1 to material 0 and cells 20
+  // and 21 from material 0 to material 1
+
+  std::vector<int> cells01 = {20, 21}, cells10 = {2, 5, 7};
+  mystate->rem_cells_from_material(1, cells10);
+  mystate->rem_cells_from_material(0, cells01);
+  mystate->add_cells_to_material(1, cells01);
+  mystate->add_cells_to_material(0, cells10);  // already in mat 0 - no-op
+
+  for (int c = 0; c < ncells; c++) {
+    bool in0 = (c != 20 && c != 21);
+    bool in1 = (c < 10 && c != 2 && c != 5 && c != 7) || !in0;
+
+    CHECK_EQUAL(in0, mystate->cell_index_in_material(c, 0) >= 0);
+    CHECK_EQUAL(in1, mystate->cell_index_in_material(c, 1) >= 0);
+    CHECK_EQUAL(in0 + in1, mystate->num_cell_materials(c));
+
+    if (in0 && c != 2 && c != 5 && c != 7)
+      CHECK_EQUAL(c, vf(0, c));
+    if (in1 && c < 10)
+      CHECK_EQUAL(100 + c, vf(1, c));
+  }
+
+  CHECK_EQUAL(ncells - 2, vf.get_matdata(0).size());
+  CHECK_EQUAL(10 - 3 + 2, vf.get_matdata(1).size());
+}
+
+
+TEST(Jali_State_Field_Index) {
+
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> mesh1 = mf(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                         2, 2, 2);
+  std::shared_ptr<Jali::Mesh> mesh2 = mf(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                         3, 3, 3);
+  CHECK(mesh1 != nullptr);
+  CHECK(mesh2 != nullptr);
+
+  std::shared_ptr<Jali::State> mystate = Jali::State::create(mesh1);
+
+  // Vectors sharing a name but differing in the entity kind, data
+  // type or domain they are on
+
+  mystate->add<double, Jali::Mesh, Jali::UniStateVector>("density", mesh1,
+                   Jali::Entity_kind::CELL, Jali::Entity_type::ALL, 1.0);
+  mystate->add<double, Jali::Mesh, Jali::UniStateVector>("density", mesh1,
+                   Jali::Entity_kind::NODE, Jali::Entity_type::ALL, 2.0);
+  mystate->add<int, Jali::Mesh, Jali::UniStateVector>("density", mesh2,
+                   Jali::Entity_kind::CELL, Jali::Entity_type::ALL, 3);
+  for (int i = 0; i < 50; i++)
+    mystate->add<double, Jali::Mesh, Jali::UniStateVector>(
+        "field" + std::to_string(i), mesh1, Jali::Entity_kind::CELL,
+        Jali::Entity_type::ALL, static_cast<double>(i));
+  CHECK_EQUAL(53, mystate->size());
+
+  // Untyped finds return the first vector added that matches
+
+  CHECK(mystate->find("density") == mystate->begin());
+  CHECK(mystate->find("density", Jali::Entity_kind::NODE) ==
+        mystate->begin() + 1);
+  CHECK(mystate->find("density", mesh2) == mystate->begin() + 2);
+  CHECK(mystate->find("pressure") == mystate->end());
+  CHECK(mystate->find("density", Jali::Entity_kind::FACE) == mystate->end());
+
+  // Typed finds also screen by data type
+
+  CHECK((mystate->find<double, Jali::Mesh, Jali::UniStateVector>("density",
+                                                                 mesh2) ==
+         mystate->end()));
+  CHECK((mystate->find<int, Jali::Mesh, Jali::UniStateVector>("density",
+                                                              mesh2) ==
+         mystate->begin() + 2));
+  CHECK((mystate->find<double, Jali::Mesh, Jali::MultiStateVector>("density",
+                                                                   mesh1) ==
+         mystate->end()));
+  CHECK((mystate->find<Jali::Mesh, Jali::StateVector_type::UNIVAL>("field7",
+                                                                   mesh1) ==
+         mystate->begin() + 10));
+
+  // Handles resolve once and then give the same vector as find/get
+
+  Jali::State::Field_ID id =
+      mystate->field_id<double, Jali::Mesh, Jali::UniStateVector>(
+          "density", mesh1, Jali::Entity_kind::NODE);
+  CHECK_EQUAL(1, id);
+  CHECK_EQUAL(-1, (mystate->field_id<double, Jali::Mesh,
+                   Jali::UniStateVector>("pressure", mesh1)));
+
+  Jali::UniStateVector<double, Jali::Mesh>& nodevec =
+      mystate->field<double, Jali::Mesh, Jali::UniStateVector>(id);
+  CHECK_EQUAL("density", nodevec.name());
+  CHECK(Jali::Entity_kind::NODE == nodevec.entity_kind());
+  nodevec[0] = 7.0;
+
+  Jali::UniStateVector<double, Jali::Mesh> nodevec2;
+  CHECK(mystate->get("density", mesh1, Jali::Entity_kind::NODE,
+                     Jali::Entity_type::ALL, &nodevec2));
+  CHECK_EQUAL(7.0, nodevec2[0]);
+
+  for (int i = 0; i < 50; i++) {
+    Jali::State::Field_ID fid =
+        mystate->field_id<double, Jali::Mesh, Jali::UniStateVector>(
+            "field" + std::to_string(i), mesh1);
+    CHECK_EQUAL(i+3, fid);
+    auto const& fvec = mystate->field<double, Jali::Mesh,
+                                      Jali::UniStateVector>(fid);
+    CHECK_EQUAL(static_cast<double>(i), fvec[0]);
+  }
+
+  // Adding a duplicate does not create another vector
+
+  mystate->add<double, Jali::Mesh, Jali::UniStateVector>("field3", mesh1,
+                   Jali::Entity_kind::CELL, Jali::Entity_type::ALL, 9.0);
+  CHECK_EQUAL(53, mystate->size());
+}
+
+
+TEST(Jali_MMState_Compact_Storage) {
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                        3, 3, 3);
+  int ncells = mesh->num_cells();
+
+  std::shared_ptr<Jali::State> mystate = Jali::State::create(mesh);
+
+  std::vector<int> matcells[3];
+  for (int c = 0; c < ncells; c++) {
+    if (c < 14) matcells[0].push_back(c);
+    if (c >= 10) matcells[1].push_back(c);
+  }
+  matcells[2] = {20, 12, 5};
+  for (int m = 0; m < 3; m++)
+    mystate->add_material("mat" + std::to_string(m), matcells[m]);
+
+  // Check the material map against the material sets
+
+  std::shared_ptr<Jali::MaterialMap const> map = mystate->material_map();
+  CHECK_EQUAL(ncells, map->num_cells());
+  CHECK_EQUAL(3, map->num_materials());
+  CHECK_EQUAL(14 + ncells - 10 + 3, map->num_entries());
+  CHECK(map == mystate->material_map());  // cached until materials change
+
+  for (int c = 0; c < ncells; c++) {
+    Jali::ArrayView<int> cmats = map->cell_materials(c);
+    Jali::ArrayView<int> cindices = map->cell_material_indices(c);
+    CHECK_EQUAL(mystate->num_cell_materials(c), cmats.size());
+    CHECK_EQUAL(map->offsets()[c+1] - map->offsets()[c], cmats.size());
+    for (int i = 0; i < cmats.size(); i++) {
+      if (i) CHECK(cmats[i-1] < cmats[i]);
+      CHECK_EQUAL(mystate->cell_index_in_material(c, cmats[i]), cindices[i]);
+      CHECK_EQUAL(map->offsets()[c] + i, map->entry(c, cmats[i]));
+    }
+  }
+  CHECK_EQUAL(-1, map->entry(0, 1));
+  for (int m = 0; m < 3; m++) {
+    Jali::ArrayView<int> mcells = map->material_cells(m);
+    std::vector<int> const& setcells = mystate->material_set(m)->entities();
+    CHECK_EQUAL(setcells.size(), mcells.size());
+    CHECK_ARRAY_EQUAL(setcells, mcells, mcells.size());
+  }
+
+  // Fill a multi-material vector and switch it to cell-centric storage
+
+  Jali::MultiStateVector<double>& rho =
+      mystate->add<double, Jali::Mesh, Jali::MultiStateVector>("density", mesh,
+                   Jali::Entity_kind::CELL, Jali::Entity_type::ALL);
+  for (int m = 0; m < 3; m++)
+    for (auto const& c : matcells[m])
+      rho(m, c) = 100*m + c;
+
+  CHECK(rho.storage_layout() == Jali::Data_layout::MATERIAL_CENTRIC);
+  rho.set_storage_layout(Jali::Data_layout::CELL_CENTRIC);
+  CHECK(rho.storage_layout() == Jali::Data_layout::CELL_CENTRIC);
+  CHECK_EQUAL(3, rho.size());
+  CHECK_EQUAL(3, rho.size(2));
+
+  Jali::MaterialMap const& cmap = rho.cell_centric_map();
+  std::vector<double>& cdata = rho.get_cell_centric_data();
+  CHECK_EQUAL(cmap.num_entries(), cdata.size());
+  for (int c = 0; c < ncells; c++) {
+    for (int k = cmap.offsets()[c]; k < cmap.offsets()[c+1]; k++) {
+      int m = cmap.entry_materials()[k];
+      CHECK_EQUAL(100*m + c, cdata[k]);
+      CHECK_EQUAL(100*m + c, rho(c, m, Jali::Data_layout::CELL_CENTRIC));
+      cdata[k] += 0.5;
+    }
+  }
+  rho(1, 20) = -1.0;
+  CHECK_EQUAL(-1.0, cdata[cmap.entry(20, 1)]);
+
+  rho.set_storage_layout(Jali::Data_layout::MATERIAL_CENTRIC);
+  for (int m = 0; m < 3; m++) {
+    std::vector<double> const& matdata = rho.get_matdata(m);
+    std::vector<int> const& setcells = mystate->material_set(m)->entities();
+    CHECK_EQUAL(setcells.size(), matdata.size());
+    for (int i = 0; i < setcells.size(); i++) {
+      int c = setcells[i];
+      CHECK_EQUAL((m == 1 && c == 20) ? -1.0 : 100*m + c + 0.5, matdata[i]);
+    }
+  }
+
+  // Changing materials brings a cell-centric vector back to
+  // material-centric storage and gives a new map
+
+  rho.set_storage_layout(Jali::Data_layout::CELL_CENTRIC);
+  std::vector<int> newcells = {0, 1};
+  mystate->add_cells_to_material(2, newcells);
+  CHECK(rho.storage_layout() == Jali::Data_layout::MATERIAL_CENTRIC);
+  CHECK(map != mystate->material_map());
+  CHECK_EQUAL(5, mystate->material_map()->material_cells(2).size());
+  CHECK_EQUAL(5, rho.get_matdata(2).size());
+  CHECK_EQUAL(205.5, rho(2, 5));
+  CHECK_EQUAL(220.5, rho(2, 20));
+}
+
+
+TEST(Jali_State_Renumber_Entities) {
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                        4, 4, 4);
+  int ncells = mesh->num_cells();
+  int nnodes = mesh->num_nodes();
+
+  std::shared_ptr<Jali::State> mystate = Jali::State::create(mesh);
+
+  std::vector<double> cdata(ncells), ndata(nnodes);
+  for (int c = 0; c < ncells; c++) cdata[c] = 10.0*c;
+  for (int n = 0; n < nnodes; n++) ndata[n] = -1.0*n;
+  mystate->add("cellvar", mesh, Jali::Entity_kind::CELL,
+               Jali::Entity_type::ALL, cdata.data());
+  mystate->add("nodevar", mesh, Jali::Entity_kind::NODE,
+               Jali::Entity_type::ALL, ndata.data());
+
+  std::vector<int> matcells = {2, 7, 30, 41, 63};
+  mystate->add_material("mat0", matcells);
+  Jali::MultiStateVector<double>& rho =
+      mystate->add<double, Jali::Mesh, Jali::MultiStateVector>("density", mesh,
+                   Jali::Entity_kind::CELL, Jali::Entity_type::ALL);
+  for (auto const& c : matcells)
+    rho(0, c) = 1000.0 + c;
+  rho.set_storage_layout(Jali::Data_layout::CELL_CENTRIC);
+
+  // Renumber the mesh and carry the state over
+
+  mesh->reorder_entities(Jali::Entity_ordering::HILBERT);
+  std::vector<int> const& cell_new2old =
+      mesh->entity_new_to_old(Jali::Entity_kind::CELL);
+  std::vector<int> const& node_new2old =
+      mesh->entity_new_to_old(Jali::Entity_kind::NODE);
+  mystate->renumber_entities(Jali::Entity_kind::CELL, cell_new2old);
+  mystate->renumber_entities(Jali::Entity_kind::NODE, node_new2old);
+
+  Jali::UniStateVector<double, Jali::Mesh> cellvar, nodevar;
+  CHECK(mystate->get("cellvar", mesh, Jali::Entity_kind::CELL,
+                     Jali::Entity_type::ALL, &cellvar));
+  CHECK(mystate->get("nodevar", mesh, Jali::Entity_kind::NODE,
+                     Jali::Entity_type::ALL, &nodevar));
+  for (int c = 0; c < ncells; c++)
+    CHECK_EQUAL(10.0*cell_new2old[c], cellvar[c]);
+  for (int n = 0; n < nnodes; n++)
+    CHECK_EQUAL(-1.0*node_new2old[n], nodevar[n]);
+
+  // Material data stays with the same physical cells
+
+  CHECK(rho.storage_layout() == Jali::Data_layout::MATERIAL_CENTRIC);
+  std::vector<int> const& setcells = mystate->material_set(0)->entities();
+  CHECK_EQUAL(matcells.size(), setcells.size());
+  for (int i = 0; i < setcells.size(); i++) {
+    int c = setcells[i];
+    CHECK_EQUAL(matcells[i], cell_new2old[c]);
+    CHECK_EQUAL(1, mystate->num_cell_materials(c));
+    CHECK_EQUAL(1000.0 + cell_new2old[c], rho(0, c));
+  }
+  CHECK_EQUAL(setcells.size(), mystate->material_map()->num_entries());
+}
+
+
+// Export single- and multi-material vectors to the mesh as whole
+// arrays and read them back
+
+TEST(Jali_State_Export_Arrays) {
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                        3, 3, 3);
+  int ncells = mesh->num_cells();
+  int nnodes = mesh->num_nodes();
+
+  std::shared_ptr<Jali::State> mystate = Jali::State::create(mesh);
+
+  std::vector<double> pressure(ncells);
+  for (int c = 0; c < ncells; c++) pressure[c] = 2.0*c;
+  Jali::UniStateVector<double>& pvec0 =
+      mystate->add("pressure", mesh, Jali::Entity_kind::CELL,
+                   Jali::Entity_type::ALL, pressure.data());
+
+  std::vector<std::array<double, 3>> velocity(nnodes);
+  for (int n = 0; n < nnodes; n++) velocity[n] = {{1.0*n, 2.0*n, 3.0*n}};
+  mystate->add("velocity", mesh, Jali::Entity_kind::NODE,
+               Jali::Entity_type::ALL, velocity.data());
+
+  std::vector<int> matcells[2];
+  for (int c = 0; c < ncells; c++)
+    matcells[c % 2].push_back(c);
+  matcells[1].push_back(0);  // mixed cell
+  mystate->add_material("steel", matcells[0]);
+  mystate->add_material("copper", matcells[1]);
+
+  Jali::MultiStateVector<double>& rho =
+      mystate->add<double, Jali::Mesh, Jali::MultiStateVector>("density", mesh,
+                   Jali::Entity_kind::CELL, Jali::Entity_type::ALL);
+  for (int m = 0; m < 2; m++)
+    for (auto const& c : matcells[m])
+      rho(m, c) = 100.0*(m+1) + c;
+  rho.set_storage_layout(Jali::Data_layout::CELL_CENTRIC);
+
+  mystate->export_to_mesh();
+
+  // The mesh has the values as contiguous arrays, one field per
+  // material for the multi-material vector
+
+  double const *p = mesh->field_data<double>("pressure",
+                                             Jali::Entity_kind::CELL);
+  CHECK(p != nullptr);
+  CHECK(mesh->field_data<int>("pressure", Jali::Entity_kind::CELL) ==
+        nullptr);
+  CHECK(mesh->field_data<double>("pressure", Jali::Entity_kind::NODE) ==
+        nullptr);
+  for (int c = 0; c < ncells; c++)
+    CHECK_EQUAL(2.0*c, p[c]);
+
+  auto v = mesh->field_data<std::array<double, 3>>("velocity",
+                                                   Jali::Entity_kind::NODE);
+  CHECK(v != nullptr);
+  for (int n = 0; n < nnodes; n++)
+    CHECK_EQUAL(3.0*n, v[n][2]);
+
+  double const *rho_steel =
+      mesh->field_data<double>("density_steel", Jali::Entity_kind::CELL);
+  double const *rho_copper =
+      mesh->field_data<double>("density_copper", Jali::Entity_kind::CELL);
+  CHECK(rho_steel && rho_copper);
+  for (int c = 0; c < ncells; c++) {
+    CHECK_EQUAL((c % 2 == 0) ? 100.0 + c : 0.0, rho_steel[c]);
+    CHECK_EQUAL((c % 2 == 1 || c == 0) ? 200.0 + c : 0.0, rho_copper[c]);
+  }
+
+  // Another state on the mesh picks the fields up from the mesh
+
+  std::shared_ptr<Jali::State> state2 = Jali::State::create(mesh);
+  state2->init_from_mesh();
+  Jali::UniStateVector<double, Jali::Mesh> pvec;
+  CHECK(state2->get("pressure", mesh, Jali::Entity_kind::CELL,
+                    Jali::Entity_type::ALL, &pvec));
+  for (int c = 0; c < ncells; c++)
+    CHECK_EQUAL(2.0*c, pvec[c]);
+  Jali::UniStateVector<double, Jali::Mesh> svec;
+  CHECK(state2->get("density_steel", mesh, Jali::Entity_kind::CELL,
+                    Jali::Entity_type::ALL, &svec));
+
+  // Exporting again overwrites the values
+
+  for (int c = 0; c < ncells; c++) pvec0[c] = -1.0;
+  mystate->export_to_mesh();
+  CHECK_EQUAL(-1.0, mesh->field_data<double>("pressure",
+                                             Jali::Entity_kind::CELL)[0]);
+
+  // The stored values follow their entities when the mesh is renumbered
+
+  mesh->reorder_entities(Jali::Entity_ordering::HILBERT);
+  std::vector<int> const& node_new2old =
+      mesh->entity_new_to_old(Jali::Entity_kind::NODE);
+  v = mesh->field_data<std::array<double, 3>>("velocity",
+                                              Jali::Entity_kind::NODE);
+  for (int n = 0; n < nnodes; n++)
+    CHECK_EQUAL(1.0*node_new2old[n], v[n][0]);
+}
+
+
+TEST(Jali_State_Write_VTK) {
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                        3, 3, 3);
+  int ncells = mesh->num_cells();
+  int nnodes = mesh->num_nodes();
+  int nprocs, rank;
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  std::shared_ptr<Jali::State> mystate = Jali::State::create(mesh);
+
+  std::vector<double> pressure(ncells, 1.0);
+  mystate->add("pressure", mesh, Jali::Entity_kind::CELL,
+               Jali::Entity_type::ALL, pressure.data());
+  std::vector<std::array<double, 3>> velocity(nnodes, {{1.0, 2.0, 3.0}});
+  mystate->add("velocity", mesh, Jali::Entity_kind::NODE,
+               Jali::Entity_type::ALL, velocity.data());
+
+  std::vector<int> matcells[2];
+  for (int c = 0; c < ncells; c++)
+    matcells[c % 2].push_back(c);
+  mystate->add_material("steel", matcells[0]);
+  mystate->add_material("copper", matcells[1]);
+  mystate->add<double, Jali::Mesh, Jali::MultiStateVector>("density", mesh,
+               Jali::Entity_kind::CELL, Jali::Entity_type::ALL);
+
+  // The piece of this rank declares a node or cell array for every
+  // vector and one per material for the multi-material vector
+
+  std::stringstream piece;
+  piece << "test_state_vtk";
+  if (nprocs > 1) piece << "." << nprocs << "." << rank;
+  piece << ".vtu";
+
+  auto read_file = [](std::string const& filename) {
+    std::ifstream is(filename.c_str(), std::ios::binary);
+    std::stringstream contents;
+    contents << is.rdbuf();
+    return contents.str();
+  };
+
+  mystate->write_to_vtk_file("test_state_vtk");
+  std::string contents = read_file(piece.str());
+  CHECK(contents.find("Name=\"pressure\" NumberOfComponents=\"1\"") !=
+        std::string::npos);
+  CHECK(contents.find("Name=\"velocity\" NumberOfComponents=\"3\"") !=
+        std::string::npos);
+  CHECK(contents.find("Name=\"density_steel\"") != std::string::npos);
+  CHECK(contents.find("Name=\"density_copper\"") != std::string::npos);
+
+  // Fields exported to the mesh are written with the mesh
+
+  mesh->write_to_vtk_file("test_state_vtk", false);
+  CHECK(read_file(piece.str()).find("Name=\"pressure\"") ==
+        std::string::npos);
+  mystate->export_to_mesh();
+  mesh->write_to_vtk_file("test_state_vtk");
+  CHECK(read_file(piece.str()).find("Name=\"pressure\"") !=
+        std::string::npos);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  std::remove(piece.str().c_str());
+  if (nprocs > 1 && rank == 0) std::remove("test_state_vtk.pvtu");
+}
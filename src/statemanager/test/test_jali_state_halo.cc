@@ -0,0 +1,143 @@
+/*
+Copyright (c) 2019, Triad National Security, LLC
+All rights reserved.
+
+Copyright 2019. Triad National Security, LLC. This software was
+produced under U.S. Government contract 89233218CNA000001 for Los
+Alamos National Laboratory (LANL), which is operated by Triad
+National Security, LLC for the U.S. Department of Energy. 
+All rights in the program are reserved by Triad National Security,
+LLC, and the U.S. Department of Energy/National Nuclear Security
+Administration. The Government is granted for itself and others acting
+on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+in this material to reproduce, prepare derivative works, distribute
+copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+ 
+
+This is open source software distributed under the 3-clause BSD license.
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+
+1. Redistributions of source code must retain the above copyright notice,
+   this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Triad National Security, LLC, Los Alamos
+   National Laboratory, LANL, the U.S. Government, nor the names of its
+   contributors may be used to endorse or promote products derived from this
+   software without specific prior written permission.
+
+ 
+THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <mpi.h>
+
+#include <iostream>
+#include <vector>
+
+#include "errors.hh"
+#include "JaliState.h"
+#include "JaliStateVector.h"
+#include "Mesh.hh"
+#include "MeshHalo.hh"
+#include "MeshFactory.hh"
+
+#include "UnitTest++.h"
+
+// Test updating of ghost entries of single and multi-material state
+// vectors from the values of their owners
+
+TEST(Jali_State_Halo_Update) {
+
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  mf.included_entities({Jali::Entity_kind::FACE});
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                        4, 4, 4);
+  CHECK(mesh != nullptr);
+
+  std::shared_ptr<Jali::State> mystate = Jali::State::create(mesh);
+
+  // Material 0 is in cells with even global IDs and material 1 in all
+  // cells. List owned cells before ghost cells so that the entries of
+  // the material vectors are in the same order as the material sets
+
+  std::vector<std::vector<int>> matcells(2);
+  for (auto const& c : mesh->cells()) {
+    if (mesh->GID(c, Jali::Entity_kind::CELL) % 2 == 0)
+      matcells[0].push_back(c);
+    matcells[1].push_back(c);
+  }
+  mystate->add_material("mat0", matcells[0]);
+  mystate->add_material("mat1", matcells[1]);
+
+  Jali::UniStateVector<double, Jali::Mesh>& rho =
+      mystate->add<double, Jali::Mesh, Jali::UniStateVector>("density",
+                   mesh, Jali::Entity_kind::CELL, Jali::Entity_type::ALL, -1.0);
+
+  Jali::UniStateVector<int, Jali::Mesh>& nodeid =
+      mystate->add<int, Jali::Mesh, Jali::UniStateVector>("nodeid",
+                   mesh, Jali::Entity_kind::NODE, Jali::Entity_type::ALL, -1);
+
+  Jali::MultiStateVector<double, Jali::Mesh>& rhomat =
+      mystate->add<double, Jali::Mesh, Jali::MultiStateVector>("mat_density",
+                   mesh, Jali::Entity_kind::CELL, Jali::Entity_type::ALL);
+
+  for (auto const& c : mesh->cells<Jali::Entity_type::PARALLEL_OWNED>())
+    rho[c] = mesh->GID(c, Jali::Entity_kind::CELL);
+  for (auto const& n : mesh->nodes<Jali::Entity_type::PARALLEL_OWNED>())
+    nodeid[n] = mesh->GID(n, Jali::Entity_kind::NODE);
+  for (int m = 0; m < 2; m++) {
+    std::vector<double>& matdata = rhomat.get_matdata(m);
+    CHECK_EQUAL(matcells[m].size(), matdata.size());
+    for (int i = 0; i < matcells[m].size(); i++) {
+      int c = matcells[m][i];
+      if (mesh->entity_get_type(Jali::Entity_kind::CELL, c) ==
+          Jali::Entity_type::PARALLEL_OWNED)
+        matdata[i] = (m+1)*mesh->GID(c, Jali::Entity_kind::CELL);
+      else
+        matdata[i] = -1.0;
+    }
+  }
+
+  // Update the two cell vectors with one message per neighbor and
+  // the node vector by itself
+
+  Jali::HaloUpdate update(mesh->halo(Jali::Entity_kind::CELL));
+  rho.add_to_update(&update);
+  rhomat.add_to_update(&update);
+  update.start();
+  nodeid.start_update();
+  update.finish();
+  nodeid.finish_update();
+
+  for (auto const& c : mesh->cells())
+    CHECK_EQUAL(mesh->GID(c, Jali::Entity_kind::CELL), rho[c]);
+  for (auto const& n : mesh->nodes())
+    CHECK_EQUAL(mesh->GID(n, Jali::Entity_kind::NODE), nodeid[n]);
+  for (int m = 0; m < 2; m++) {
+    std::vector<double> const& matdata = rhomat.get_matdata(m);
+    for (int i = 0; i < matcells[m].size(); i++)
+      CHECK_EQUAL((m+1)*mesh->GID(matcells[m][i], Jali::Entity_kind::CELL),
+                  matdata[i]);
+  }
+
+  // A node vector cannot be updated with the plan for cells
+
+  Jali::HaloUpdate update2(mesh->halo(Jali::Entity_kind::CELL));
+  CHECK_THROW(nodeid.add_to_update(&update2), Errors::Message);
+}
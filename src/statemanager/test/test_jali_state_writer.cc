@@ -0,0 +1,432 @@
+/*
+ Copyright (c) 2019, Triad National Security, LLC
+ All rights reserved.
+
+ Copyright 2019. Triad National Security, LLC. This software was
+ produced under U.S. Government contract 89233218CNA000001 for Los
+ Alamos National Laboratory (LANL), which is operated by Triad
+ National Security, LLC for the U.S. Department of Energy. 
+ All rights in the program are reserved by Triad National Security,
+ LLC, and the U.S. Department of Energy/National Nuclear Security
+ Administration. The Government is granted for itself and others acting
+ on its behalf a nonexclusive, paid-up, irrevocable worldwide license
+ in this material to reproduce, prepare derivative works, distribute
+ copies to the public, perform publicly and display publicly, and to
+ permit others to do so
+
+ 
+ This is open source software distributed under the 3-clause BSD license.
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+ 
+ 1. Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. Neither the name of Triad National Security, LLC, Los Alamos
+    National Laboratory, LANL, the U.S. Government, nor the names of its
+    contributors may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ 
+ THIS SOFTWARE IS PROVIDED BY TRIAD NATIONAL SECURITY, LLC AND
+ CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ TRIAD NATIONAL SECURITY, LLC OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include <mpi.h>
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "JaliState.h"
+#include "JaliStateVector.h"
+#include "JaliStateWriter.h"
+#include "Mesh.hh"
+#include "MeshFactory.hh"
+#include "MeshSnapshot.hh"
+
+#include "UnitTest++.h"
+
+// A field read back from a state file
+
+struct FileField {
+  Jali::StateFileField info;
+  std::vector<std::vector<int>> cells;      // MULTIVAL only
+  std::vector<std::vector<char>> values;    // one array per material
+};
+
+// Read a state file into fields by name (empty if it is not one)
+
+std::map<std::string, FileField> read_state_file(std::string const& filename,
+                                                 Jali::StateFileHeader *header) {
+  std::map<std::string, FileField> fields;
+  std::ifstream is(filename.c_str(), std::ios::binary);
+  std::vector<char> bytes((std::istreambuf_iterator<char>(is)),
+                          std::istreambuf_iterator<char>());
+  if (bytes.size() < sizeof(*header)) return fields;
+  std::memcpy(header, bytes.data(), sizeof(*header));
+  if (std::memcmp(header->magic, "JALISTAT", 8) ||
+      header->file_size != bytes.size())
+    return fields;
+
+  auto padded = [](std::size_t n) { return (n + 7)/8*8; };
+  std::size_t pos = sizeof(*header);
+  for (int i = 0; i < header->num_fields; i++) {
+    FileField field;
+    std::memcpy(&field.info, &bytes[pos], sizeof(field.info));
+    std::size_t const end = pos + sizeof(field.info) + field.info.nbytes;
+    pos += sizeof(field.info);
+    std::string name(&bytes[pos], field.info.name_length);
+    pos += padded(field.info.name_length);
+
+    std::size_t const value_size = field.info.num_components *
+        (field.info.scalar_type ==
+         static_cast<int>(Jali::StateFile_scalar::FLOAT64) ? 8 : 4);
+    bool const multi = (field.info.vector_type ==
+                        static_cast<int>(Jali::StateVector_type::MULTIVAL));
+    for (int m = 0; m < field.info.num_materials; m++) {
+      std::uint64_t count;
+      std::memcpy(&count, &bytes[pos], sizeof(count));
+      pos += 8;
+      if (multi) {
+        std::vector<int> cells(count);
+        std::memcpy(cells.data(), &bytes[pos], count*sizeof(int));
+        field.cells.push_back(cells);
+        pos += padded(count*sizeof(int));
+      }
+      field.values.emplace_back(&bytes[pos], &bytes[pos] + count*value_size);
+      pos += padded(count*value_size);
+    }
+    CHECK_EQUAL(end, pos);
+    fields[name] = field;
+  }
+  CHECK_EQUAL(bytes.size(), pos);
+  return fields;
+}
+
+template <class T>
+T value(FileField const& field, int m, int i) {
+  T v;
+  std::memcpy(&v, &field.values[m][i*sizeof(T)], sizeof(T));
+  return v;
+}
+
+
+TEST(State_Writer_Fields) {
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 1.0, 1.0, 4, 4);
+  int const ncells = mesh->num_cells();
+  int const nnodes = mesh->num_nodes();
+
+  std::shared_ptr<Jali::State> mystate = Jali::State::create(mesh);
+
+  std::vector<double> pressure(ncells);
+  for (int c = 0; c < ncells; c++) pressure[c] = 0.5*c;
+  Jali::UniStateVector<double>& pvec =
+      mystate->add("pressure", mesh, Jali::Entity_kind::CELL,
+                   Jali::Entity_type::ALL, pressure.data());
+
+  std::vector<int> nodeflag(nnodes);
+  for (int n = 0; n < nnodes; n++) nodeflag[n] = n % 3;
+  mystate->add("nodeflag", mesh, Jali::Entity_kind::NODE,
+               Jali::Entity_type::ALL, nodeflag.data());
+
+  std::vector<std::array<double, 2>> velocity(nnodes);
+  for (int n = 0; n < nnodes; n++) velocity[n] = {{1.0*n, -1.0*n}};
+  mystate->add("velocity", mesh, Jali::Entity_kind::NODE,
+               Jali::Entity_type::ALL, velocity.data());
+
+  std::vector<int> matcells[2];
+  for (int c = 0; c < ncells; c++) {
+    if (c < 10) matcells[0].push_back(c);
+    if (c >= 6) matcells[1].push_back(c);
+  }
+  mystate->add_material("mat0", matcells[0]);
+  mystate->add_material("mat1", matcells[1]);
+
+  Jali::MultiStateVector<double>& rho =
+      mystate->add<double, Jali::Mesh, Jali::MultiStateVector>("density", mesh,
+                   Jali::Entity_kind::CELL, Jali::Entity_type::ALL);
+  for (int m = 0; m < 2; m++)
+    for (auto const& c : matcells[m])
+      rho(m, c) = 100*m + c;
+
+  std::string const filename = "test_state_writer_fields.jsf";
+  std::string const rankfile =
+      Jali::snapshot_filename(filename, MPI_COMM_WORLD);
+
+  // Write the data as it is, then change it - the file has the data
+  // at the time of the write
+
+  Jali::StateWriter writer(mystate);
+  writer.write(filename);
+  for (int c = 0; c < ncells; c++) pvec[c] = -1.0;
+  writer.flush();
+
+  Jali::StateFileHeader header;
+  std::map<std::string, FileField> fields = read_state_file(rankfile, &header);
+  CHECK_EQUAL(Jali::STATE_FILE_VERSION, header.version);
+  CHECK_EQUAL(4, header.num_fields);
+  CHECK_EQUAL(4, fields.size());
+
+  FileField const& fp = fields["pressure"];
+  CHECK_EQUAL(static_cast<int>(Jali::Entity_kind::CELL), fp.info.entity_kind);
+  CHECK_EQUAL(1, fp.info.num_components);
+  CHECK_EQUAL(ncells*sizeof(double), fp.values[0].size());
+  for (int c = 0; c < ncells; c++)
+    CHECK_EQUAL(0.5*c, value<double>(fp, 0, c));
+
+  FileField const& fn = fields["nodeflag"];
+  CHECK_EQUAL(static_cast<int>(Jali::StateFile_scalar::INT32),
+              fn.info.scalar_type);
+  for (int n = 0; n < nnodes; n++)
+    CHECK_EQUAL(n % 3, value<int>(fn, 0, n));
+
+  FileField const& fv = fields["velocity"];
+  CHECK_EQUAL(2, fv.info.num_components);
+  for (int n = 0; n < nnodes; n++) {
+    std::array<double, 2> v = value<std::array<double, 2>>(fv, 0, n);
+    CHECK_EQUAL(1.0*n, v[0]);
+    CHECK_EQUAL(-1.0*n, v[1]);
+  }
+
+  // Multi-material data comes out material by material with the
+  // cells of each material in either storage layout
+
+  for (int pass = 0; pass < 2; pass++) {
+    if (pass == 1) {
+      rho.set_storage_layout(Jali::Data_layout::CELL_CENTRIC);
+      writer.write(filename, {"density"});
+      writer.flush();
+      fields = read_state_file(rankfile, &header);
+      CHECK_EQUAL(1, fields.size());
+    }
+    FileField const& fd = fields["density"];
+    CHECK_EQUAL(static_cast<int>(Jali::StateVector_type::MULTIVAL),
+                fd.info.vector_type);
+    CHECK_EQUAL(2, fd.info.num_materials);
+    for (int m = 0; m < 2; m++) {
+      CHECK(fd.cells[m] == matcells[m]);
+      for (int i = 0; i < matcells[m].size(); i++)
+        CHECK_EQUAL(100*m + matcells[m][i], value<double>(fd, m, i));
+    }
+  }
+
+  Jali::StateWriter::Statistics stats = writer.statistics();
+  CHECK_EQUAL(2, stats.files_written);
+  CHECK(stats.bytes_written > ncells*sizeof(double));
+
+  std::remove(rankfile.c_str());
+}
+
+
+TEST(State_Writer_Backpressure) {
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 0.0, 1.0, 1.0, 1.0,
+                                        8, 8, 8);
+  int const ncells = mesh->num_cells();
+
+  std::shared_ptr<Jali::State> mystate = Jali::State::create(mesh);
+  Jali::UniStateVector<double>& temp =
+      mystate->add<double, Jali::Mesh, Jali::UniStateVector>("temperature",
+                   mesh, Jali::Entity_kind::CELL, Jali::Entity_type::ALL, 0.0);
+
+  // Queue more files than there are buffers - each write waits for a
+  // buffer only while all of them are in use and every file is written
+  // with the data at the time of its write
+
+  int const nfiles = 6;
+  int const max_pending = 2;
+  std::vector<std::string> rankfiles;
+  {
+    Jali::StateWriter writer(mystate, max_pending);
+    for (int i = 0; i < nfiles; i++) {
+      for (int c = 0; c < ncells; c++) temp[c] = 1000*i + c;
+      std::string const filename =
+          "test_state_writer_" + std::to_string(i) + ".jsf";
+      writer.write(filename);
+      rankfiles.push_back(Jali::snapshot_filename(filename, MPI_COMM_WORLD));
+    }
+    writer.flush();
+
+    Jali::StateWriter::Statistics stats = writer.statistics();
+    CHECK_EQUAL(nfiles, stats.files_written);
+    CHECK(stats.max_queued <= max_pending);
+    CHECK(stats.stall_seconds >= 0.0);
+
+    std::uint64_t nbytes = 0;
+    for (int i = 0; i < nfiles; i++) {
+      std::ifstream is(rankfiles[i].c_str(),
+                       std::ios::binary | std::ios::ate);
+      nbytes += is.tellg();
+    }
+    CHECK_EQUAL(nbytes, stats.bytes_written);
+  }
+
+  for (int i = 0; i < nfiles; i++) {
+    Jali::StateFileHeader header;
+    std::map<std::string, FileField> fields =
+        read_state_file(rankfiles[i], &header);
+    FileField const& ft = fields["temperature"];
+    CHECK_EQUAL(ncells*sizeof(double), ft.values[0].size());
+    for (int c = 0; c < ncells; c++)
+      CHECK_EQUAL(1000*i + c, value<double>(ft, 0, c));
+    std::remove(rankfiles[i].c_str());
+  }
+}
+
+
+TEST(State_Writer_Errors) {
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 1.0, 1.0, 2, 2);
+  std::shared_ptr<Jali::State> mystate = Jali::State::create(mesh);
+  mystate->add<double, Jali::Mesh, Jali::UniStateVector>("pressure", mesh,
+               Jali::Entity_kind::CELL, Jali::Entity_type::ALL, 1.0);
+
+  // A failed write in the background is reported by the next call
+
+  Jali::StateWriter writer(mystate);
+  writer.write("no_such_directory/state.jsf");
+  CHECK_THROW(writer.flush(), Errors::Message);
+
+  // and only once - the writer can go on
+
+  std::string const filename = "test_state_writer_errors.jsf";
+  writer.write(filename);
+  writer.flush();
+  CHECK_EQUAL(1, writer.statistics().files_written);
+  std::remove(Jali::snapshot_filename(filename, MPI_COMM_WORLD).c_str());
+}
+
+
+TEST(State_Writer_Read) {
+  Jali::MeshFactory mf(MPI_COMM_WORLD);
+  std::shared_ptr<Jali::Mesh> mesh = mf(0.0, 0.0, 1.0, 1.0, 4, 4);
+  int const ncells = mesh->num_cells();
+  int const nnodes = mesh->num_nodes();
+
+  std::shared_ptr<Jali::State> mystate = Jali::State::create(mesh);
+  Jali::UniStateVector<double>& pvec =
+      mystate->add<double, Jali::Mesh, Jali::UniStateVector>("pressure", mesh,
+                   Jali::Entity_kind::CELL, Jali::Entity_type::ALL, 0.0);
+  for (int c = 0; c < ncells; c++) pvec[c] = 0.5*c;
+
+  Jali::UniStateVector<int>& fvec =
+      mystate->add<int, Jali::Mesh, Jali::UniStateVector>("nodeflag", mesh,
+                   Jali::Entity_kind::NODE, Jali::Entity_type::ALL, 0);
+  for (int n = 0; n < nnodes; n++) fvec[n] = n % 3;
+
+  Jali::UniStateVector<std::array<double, 3>>& vvec =
+      mystate->add<std::array<double, 3>, Jali::Mesh, Jali::UniStateVector>(
+          "velocity", mesh, Jali::Entity_kind::NODE, Jali::Entity_type::ALL,
+          std::array<double, 3>{{0.0, 0.0, 0.0}});
+  for (int n = 0; n < nnodes; n++) vvec[n] = {{1.0*n, -1.0*n, 2.0*n}};
+
+  std::vector<int> matcells[2];
+  for (int c = 0; c < ncells; c++) {
+    if (c < 10) matcells[0].push_back(c);
+    if (c >= 6) matcells[1].push_back(c);
+  }
+  mystate->add_material("mat0", matcells[0]);
+  mystate->add_material("mat1", matcells[1]);
+
+  Jali::MultiStateVector<double>& rho =
+      mystate->add<double, Jali::Mesh, Jali::MultiStateVector>("density", mesh,
+                   Jali::Entity_kind::CELL, Jali::Entity_type::ALL);
+  for (int m = 0; m < 2; m++)
+    for (auto const& c : matcells[m])
+      rho(m, c) = 100*m + c;
+
+  std::string const filename = "test_state_writer_read.jsf";
+  std::string const rankfile =
+      Jali::snapshot_filename(filename, MPI_COMM_WORLD);
+  {
+    Jali::StateWriter writer(mystate);
+    writer.write(filename);
+    writer.flush();
+  }
+
+  // Reading into a state without the vectors adds them
+
+  std::shared_ptr<Jali::State> newstate = Jali::State::create(mesh);
+  newstate->add_material("mat0", matcells[0]);
+  newstate->add_material("mat1", matcells[1]);
+  newstate->read_state_file(filename);
+
+  Jali::UniStateVector<double, Jali::Mesh> pvec2;
+  CHECK(newstate->get("pressure", mesh, Jali::Entity_kind::CELL,
+                      Jali::Entity_type::ALL, &pvec2));
+  for (int c = 0; c < ncells; c++)
+    CHECK_EQUAL(0.5*c, pvec2[c]);
+
+  Jali::UniStateVector<int, Jali::Mesh> fvec2;
+  CHECK(newstate->get("nodeflag", mesh, Jali::Entity_kind::NODE,
+                      Jali::Entity_type::ALL, &fvec2));
+  Jali::UniStateVector<std::array<double, 3>, Jali::Mesh> vvec2;
+  CHECK(newstate->get("velocity", mesh, Jali::Entity_kind::NODE,
+                      Jali::Entity_type::ALL, &vvec2));
+  for (int n = 0; n < nnodes; n++) {
+    CHECK_EQUAL(n % 3, fvec2[n]);
+    CHECK(vvec2[n] == vvec[n]);
+  }
+
+  Jali::MultiStateVector<double, Jali::Mesh> rho2;
+  CHECK(newstate->get("density", mesh, Jali::Entity_kind::CELL,
+                      Jali::Entity_type::ALL, &rho2));
+  for (int m = 0; m < 2; m++)
+    for (auto const& c : matcells[m])
+      CHECK_EQUAL(100*m + c, rho2(m, c));
+
+  // Reading into a state with the vectors overwrites them, whatever
+  // the storage layout of the multi-material vectors
+
+  rho.set_storage_layout(Jali::Data_layout::CELL_CENTRIC);
+  for (int c = 0; c < ncells; c++) pvec[c] = -1.0;
+  for (int m = 0; m < 2; m++)
+    for (auto const& c : matcells[m])
+      rho(m, c) = -1.0;
+  int const nvectors = std::distance(mystate->cbegin(), mystate->cend());
+  mystate->read_state_file(filename);
+  CHECK_EQUAL(nvectors, std::distance(mystate->cbegin(), mystate->cend()));
+  for (int c = 0; c < ncells; c++)
+    CHECK_EQUAL(0.5*c, pvec[c]);
+  for (int m = 0; m < 2; m++)
+    for (auto const& c : matcells[m])
+      CHECK_EQUAL(100*m + c, rho(m, c));
+
+  // The materials must be those of the file
+
+  std::shared_ptr<Jali::State> otherstate = Jali::State::create(mesh);
+  otherstate->add_material("mat0", matcells[1]);
+  otherstate->add_material("mat1", matcells[0]);
+  CHECK_THROW(otherstate->read_state_file(filename), Errors::Message);
+
+  // and only state files can be read
+
+  {
+    std::ofstream os(rankfile.c_str(), std::ios::binary | std::ios::trunc);
+    os << "not a state file, not a state file, not a state file\n";
+  }
+  CHECK_THROW(newstate->read_state_file(filename), Errors::Message);
+  std::remove(rankfile.c_str());
+  CHECK_THROW(newstate->read_state_file(filename), Errors::Message);
+}